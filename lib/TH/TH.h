@@ -13,6 +13,10 @@
 #include "THLogAdd.h"
 #include "THRandom.h"
 #include "THSize.h"
+#include "THArena.h"
+#include "THCachingAllocator.h"
+#include "THMemoryPolicy.h"
+#include "THMemoryStats.h"
 #include "THStorage.h"
 #include "THTensor.h"
 #include "THTensorApply.h"
@@ -1,9 +1,17 @@
+/* THAtomic.h tells from ATOMIC_INT_LOCK_FREE whether the refcounts of
+ * THRefcountedMapAllocator work across processes */
+#if defined(USE_C11_ATOMICS)
+#include <stdatomic.h>
+#endif
 #include "THAllocator.h"
 #include "THAtomic.h"
+#include "THMemoryStats.h"
 
 /* stuff for mapped files */
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sched.h>
 #endif
 
 #if HAVE_MMAP
@@ -27,12 +35,29 @@ static void THDefaultAllocator_free(void* ctx, void* ptr) {
   THFree(ptr);
 }
 
+static void *THDefaultAllocator_calloc(void* ctx, ptrdiff_t size) {
+  return THCalloc(size);
+}
+
 THAllocator THDefaultAllocator = {
   &THDefaultAllocator_alloc,
   &THDefaultAllocator_realloc,
-  &THDefaultAllocator_free
+  &THDefaultAllocator_free,
+  &THDefaultAllocator_calloc
 };
 
+static THAllocator *storageAllocator = &THDefaultAllocator;
+
+void THSetStorageAllocator(THAllocator *allocator)
+{
+  storageAllocator = allocator ? allocator : &THDefaultAllocator;
+}
+
+THAllocator* THGetStorageAllocator(void)
+{
+  return storageAllocator;
+}
+
 #if defined(_WIN32) || defined(HAVE_MMAP)
 
 struct THMapAllocatorContext_ {
@@ -44,6 +69,11 @@ struct THMapAllocatorContext_ {
 
 #define TH_ALLOC_ALIGNMENT 64
 
+/* flags which do not change how the file is opened */
+#define TH_MAP_HINTS (TH_ALLOCATOR_MAPPED_READONLY | TH_ALLOCATOR_MAPPED_POPULATE | \
+                      TH_ALLOCATOR_MAPPED_SEQUENTIAL | TH_ALLOCATOR_MAPPED_RANDOM | \
+                      TH_ALLOCATOR_MAPPED_WILLNEED)
+
 typedef struct {
   int refcount;
 } THMapInfo;
@@ -56,9 +86,14 @@ THMapAllocatorContext *THMapAllocatorContext_new(const char *filename, int flags
 
   if (!(flags & TH_ALLOCATOR_MAPPED_SHARED) && !(flags & TH_ALLOCATOR_MAPPED_SHAREDMEM))
     flags &= ~TH_ALLOCATOR_MAPPED_NOCREATE;
-  if ((flags ^ TH_ALLOCATOR_MAPPED_EXCLUSIVE) == 0)
+  if (((flags & ~TH_MAP_HINTS) ^ TH_ALLOCATOR_MAPPED_EXCLUSIVE) == 0)
     THError("TH_ALLOCATOR_MAPPED_EXCLUSIVE flag requires opening the file "
         "in shared mode");
+  if ((flags & TH_ALLOCATOR_MAPPED_READONLY) &&
+      (flags & (TH_ALLOCATOR_MAPPED_SHARED | TH_ALLOCATOR_MAPPED_SHAREDMEM)))
+    THError("TH_ALLOCATOR_MAPPED_READONLY flag requires a private mapping");
+  if ((flags & TH_ALLOCATOR_MAPPED_SEQUENTIAL) && (flags & TH_ALLOCATOR_MAPPED_RANDOM))
+    THError("a mapping cannot be both sequential and random");
 
   if (filename) {
     ctx->filename = THAlloc(strlen(filename)+1);
@@ -105,12 +140,12 @@ void THMapAllocatorContext_free(THMapAllocatorContext *ctx)
 
 static void *_map_alloc(void* ctx_, ptrdiff_t size)
 {
-  if (size == 0) {
-    return NULL;
-  }
-
   THMapAllocatorContext *ctx = ctx_;
   void *data = NULL;
+  /* size 0 maps all of a file */
+  if (size == 0 && (ctx->flags & TH_ALLOCATOR_MAPPED_SHAREDMEM)) {
+    return NULL;
+  }
 
 #ifdef _WIN32
   {
@@ -129,7 +164,7 @@ static void *_map_alloc(void* ctx_, ptrdiff_t size)
 
     /* open file */
     /* FILE_FLAG_RANDOM_ACCESS ? */
-    if(ctx->flags)
+    if(ctx->flags & ~TH_MAP_HINTS)
     {
       hfile = CreateFileA(ctx->filename, GENERIC_READ|GENERIC_WRITE, FILE_SHARE_WRITE|FILE_SHARE_READ, 0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
       if (hfile == INVALID_HANDLE_VALUE)
@@ -151,7 +186,7 @@ static void *_map_alloc(void* ctx_, ptrdiff_t size)
     {
       if(size > hfilesz.QuadPart)
       {
-        if(ctx->flags)
+        if(ctx->flags & ~TH_MAP_HINTS)
         {
           hfilesz.QuadPart = size;
           if(SetFilePointerEx(hfile, hfilesz, NULL, FILE_BEGIN) == 0)
@@ -175,12 +210,18 @@ static void *_map_alloc(void* ctx_, ptrdiff_t size)
     else
       size = hfilesz.QuadPart;
 
+    if(size == 0)
+    {
+      CloseHandle(hfile);
+      return NULL; /* nothing to map */
+    }
+
     ctx->size = size; /* if we are here, it must be the right size */
 
     hfilesz.QuadPart = ctx->size;
 
     /* get map handle */
-    if(ctx->flags)
+    if(ctx->flags & ~TH_MAP_HINTS)
     {
       if( (hmfile = CreateFileMapping(hfile, NULL, PAGE_READWRITE, hfilesz.HighPart, hfilesz.LowPart, NULL)) == NULL )
         THError("could not create a map on file <%s>; error code: <%d>", ctx->filename, GetLastError());
@@ -192,8 +233,10 @@ static void *_map_alloc(void* ctx_, ptrdiff_t size)
     }
 
     /* map the stuff */
-    if(ctx->flags)
+    if(ctx->flags & ~TH_MAP_HINTS)
       data = MapViewOfFile(hmfile, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    else if(ctx->flags & TH_ALLOCATOR_MAPPED_READONLY)
+      data = MapViewOfFile(hmfile, FILE_MAP_READ, 0, 0, 0);
     else
       data = MapViewOfFile(hmfile, FILE_MAP_COPY, 0, 0, 0);
 
@@ -205,6 +248,8 @@ static void *_map_alloc(void* ctx_, ptrdiff_t size)
     /* open file */
     int fd;
     int flags;
+    int prot = PROT_READ|PROT_WRITE;
+    int mapflags;
     struct stat file_stat;
 
     if (ctx->flags & (TH_ALLOCATOR_MAPPED_SHARED | TH_ALLOCATOR_MAPPED_SHAREDMEM))
@@ -252,7 +297,7 @@ static void *_map_alloc(void* ctx_, ptrdiff_t size)
     {
       if(size > file_stat.st_size)
       {
-        if(ctx->flags)
+        if(ctx->flags & ~TH_MAP_HINTS)
         {
           if(ftruncate(fd, size) == -1)
             THError("unable to resize file <%s> to the right size", ctx->filename);
@@ -282,13 +327,27 @@ static void *_map_alloc(void* ctx_, ptrdiff_t size)
     else
       size = file_stat.st_size;
 
+    if(size == 0)
+    {
+      if (!(ctx->flags & TH_ALLOCATOR_MAPPED_FROMFD))
+        close(fd);
+      return NULL; /* nothing to map */
+    }
+
     ctx->size = size; /* if we are here, it must be the right size */
 
     /* map it */
     if (ctx->flags & (TH_ALLOCATOR_MAPPED_SHARED | TH_ALLOCATOR_MAPPED_SHAREDMEM))
-      data = mmap(NULL, ctx->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+      mapflags = MAP_SHARED;
     else
-      data = mmap(NULL, ctx->size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+      mapflags = MAP_PRIVATE;
+    if (ctx->flags & TH_ALLOCATOR_MAPPED_READONLY)
+      prot = PROT_READ;
+#ifdef MAP_POPULATE
+    if (ctx->flags & TH_ALLOCATOR_MAPPED_POPULATE)
+      mapflags |= MAP_POPULATE;
+#endif
+    data = mmap(NULL, ctx->size, prot, mapflags, fd, 0);
 
     if (ctx->flags & TH_ALLOCATOR_MAPPED_KEEPFD) {
       ctx->fd = fd;
@@ -320,6 +379,24 @@ static void *_map_alloc(void* ctx_, ptrdiff_t size)
       data = NULL; /* let's be sure it is NULL */
       THError("$ Torch: unable to mmap memory: you tried to mmap %dGB.", ctx->size/1073741824);
     }
+
+    /* hints only: failures are ignored */
+#ifdef MADV_SEQUENTIAL
+    if (ctx->flags & TH_ALLOCATOR_MAPPED_SEQUENTIAL)
+      madvise(data, ctx->size, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_RANDOM
+    if (ctx->flags & TH_ALLOCATOR_MAPPED_RANDOM)
+      madvise(data, ctx->size, MADV_RANDOM);
+#endif
+#ifdef MADV_WILLNEED
+#ifdef MAP_POPULATE
+    if (ctx->flags & TH_ALLOCATOR_MAPPED_WILLNEED)
+#else
+    if (ctx->flags & (TH_ALLOCATOR_MAPPED_WILLNEED | TH_ALLOCATOR_MAPPED_POPULATE))
+#endif
+      madvise(data, ctx->size, MADV_WILLNEED);
+#endif
   }
 #endif
 
@@ -494,6 +571,21 @@ int THRefcountedMapAllocator_decref(THMapAllocatorContext *ctx, void *data)
 
 #endif
 
+void THMapAllocator_prefetch(void *data, ptrdiff_t size)
+{
+#if defined(HAVE_MMAP) && defined(MADV_WILLNEED)
+  /* madvise wants the start of a page */
+  static ptrdiff_t pageSize = 0;
+  ptrdiff_t offset;
+  if (size <= 0)
+    return;
+  if (pageSize == 0)
+    pageSize = sysconf(_SC_PAGESIZE);
+  offset = (ptrdiff_t)((size_t)data % pageSize);
+  madvise((char*)data - offset, size + offset, MADV_WILLNEED);
+#endif
+}
+
 THAllocator THMapAllocator = {
   &THMapAllocator_alloc,
   &THMapAllocator_realloc,
@@ -505,3 +597,93 @@ THAllocator THRefcountedMapAllocator = {
   &THRefcountedMapAllocator_realloc,
   &THRefcountedMapAllocator_free
 };
+
+THCopyOnWriteContext *THCopyOnWriteContext_new(THAllocator *allocator,
+    void *allocatorContext, int freeData, ptrdiff_t bytes, int type)
+{
+  THCopyOnWriteContext *ctx = THAlloc(sizeof(THCopyOnWriteContext));
+  ctx->refcount = 1;
+  ctx->freeData = freeData;
+  ctx->allocator = allocator;
+  ctx->allocatorContext = allocatorContext;
+  ctx->bytes = bytes;
+  ctx->type = type;
+  return ctx;
+}
+
+int THCopyOnWrite_canShare(THAllocator *allocator, void *allocatorContext)
+{
+  if(allocator == &THRefcountedMapAllocator)
+    return 0;
+#if defined(_WIN32) || defined(HAVE_MMAP)
+  if(allocator == &THMapAllocator) {
+    THMapAllocatorContext *ctx = allocatorContext;
+    return !(ctx->flags & (TH_ALLOCATOR_MAPPED_SHARED | TH_ALLOCATOR_MAPPED_SHAREDMEM));
+  }
+#endif
+  return 1;
+}
+
+#define TH_COPY_ON_WRITE_LOCKS 64
+static int copyOnWriteLocks[TH_COPY_ON_WRITE_LOCKS];
+
+static int volatile *THCopyOnWrite_lockOf(const void *storage)
+{
+  return &copyOnWriteLocks[((size_t)storage / 64) % TH_COPY_ON_WRITE_LOCKS];
+}
+
+void THCopyOnWrite_lock(const void *storage)
+{
+  int volatile *l = THCopyOnWrite_lockOf(storage);
+  while (!THAtomicCompareAndSwap(l, 0, 1)) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+  }
+}
+
+void THCopyOnWrite_unlock(const void *storage)
+{
+  THAtomicSet(THCopyOnWrite_lockOf(storage), 0);
+}
+
+static int copyOnWriteClone = 0;
+
+void THSetCopyOnWriteClone(int enabled)
+{
+  copyOnWriteClone = enabled;
+}
+
+int THGetCopyOnWriteClone(void)
+{
+  return copyOnWriteClone;
+}
+
+static void *THCopyOnWriteAllocator_alloc(void* ctx, ptrdiff_t size) {
+  THError("cannot allocate from a copy-on-write storage, unshare it first");
+  return NULL;
+}
+
+static void *THCopyOnWriteAllocator_realloc(void* ctx, void* ptr, ptrdiff_t size) {
+  THError("cannot realloc copy-on-write data, unshare it first");
+  return NULL;
+}
+
+static void THCopyOnWriteAllocator_free(void* ctx_, void* data) {
+  THCopyOnWriteContext *ctx = ctx_;
+  if(THAtomicDecrementRef(&ctx->refcount)) {
+    if(ctx->freeData) {
+      THMemoryStats_record(ctx->allocator, ctx->type, -ctx->bytes);
+      ctx->allocator->free(ctx->allocatorContext, data);
+    }
+    THFree(ctx);
+  }
+}
+
+THAllocator THCopyOnWriteAllocator = {
+  &THCopyOnWriteAllocator_alloc,
+  &THCopyOnWriteAllocator_realloc,
+  &THCopyOnWriteAllocator_free
+};
@@ -10,13 +10,27 @@
 #define TH_ALLOCATOR_MAPPED_KEEPFD 16
 #define TH_ALLOCATOR_MAPPED_FROMFD 32
 #define TH_ALLOCATOR_MAPPED_UNLINK 64
+/* READONLY maps a file privately without write access: the storage is
+ * marked TH_STORAGE_READONLY, functions that would write it raise an error,
+ * and writes through its data pointer fault. POPULATE reads all of the
+ * mapping in at once. Together, for small tables that are read a lot. */
+#define TH_ALLOCATOR_MAPPED_READONLY 128
+#define TH_ALLOCATOR_MAPPED_POPULATE 256
+/* access pattern of the mapping, given to the kernel (madvise); they are
+ * hints, ignored where not supported */
+#define TH_ALLOCATOR_MAPPED_SEQUENTIAL 512
+#define TH_ALLOCATOR_MAPPED_RANDOM 1024
+#define TH_ALLOCATOR_MAPPED_WILLNEED 2048
 
 /* Custom allocator
+ * calloc is optional: it returns zeroed memory, for allocators that can
+ * get it for less than malloc and memset.
  */
 typedef struct THAllocator {
   void* (*malloc)(void*, ptrdiff_t);
   void* (*realloc)(void*, void*, ptrdiff_t);
   void (*free)(void*, void*);
+  void* (*calloc)(void*, ptrdiff_t);
 } THAllocator;
 
 /* default malloc/free allocator. malloc and realloc raise an error (using
@@ -24,6 +38,13 @@ typedef struct THAllocator {
  */
 extern THAllocator THDefaultAllocator;
 
+/* Allocator of the storages created by THStorage_(new) and
+ * THStorage_(newWithSize). Defaults to THDefaultAllocator; passing NULL
+ * restores it. Storages keep the allocator they were created with.
+ */
+TH_API void THSetStorageAllocator(THAllocator *allocator);
+TH_API THAllocator* THGetStorageAllocator(void);
+
 /* file map allocator
  */
 typedef struct THMapAllocatorContext_  THMapAllocatorContext;
@@ -36,8 +57,44 @@ TH_API ptrdiff_t THMapAllocatorContext_size(THMapAllocatorContext *ctx);
 TH_API void THMapAllocatorContext_free(THMapAllocatorContext *ctx);
 TH_API void THRefcountedMapAllocator_incref(THMapAllocatorContext *ctx, void *data);
 TH_API int THRefcountedMapAllocator_decref(THMapAllocatorContext *ctx, void *data);
+/* Starts reading the pages of [data, data+size) of a mapping in, without
+ * waiting for them. Does nothing where not supported. */
+TH_API void THMapAllocator_prefetch(void *data, ptrdiff_t size);
 
 extern THAllocator THMapAllocator;
 extern THAllocator THRefcountedMapAllocator;
 
+/* copy-on-write sharing
+ * The storages sharing a buffer copy-on-write have THCopyOnWriteAllocator
+ * and one context, which holds the allocator the buffer came from. The
+ * buffer goes back to it when the last of them is freed or unshared.
+ * malloc and realloc raise an error: a storage is unshared before it is
+ * resized.
+ */
+typedef struct THCopyOnWriteContext {
+  int refcount;                /* storages sharing the buffer */
+  int freeData;                /* whether the buffer is freed at the end */
+  THAllocator *allocator;
+  void *allocatorContext;
+  ptrdiff_t bytes;             /* size of the buffer, for THMemoryStats */
+  int type;                    /* TH_MEMORY_TYPE_* of the buffer */
+} THCopyOnWriteContext;
+
+TH_API THCopyOnWriteContext *THCopyOnWriteContext_new(THAllocator *allocator,
+    void *allocatorContext, int freeData, ptrdiff_t bytes, int type);
+/* Whether data from this allocator may be shared copy-on-write: not when
+ * the writes have to reach a file or shared memory. */
+TH_API int THCopyOnWrite_canShare(THAllocator *allocator, void *allocatorContext);
+/* The allocator, context and TH_STORAGE_COW flag of a storage only change
+ * under the lock of its address, one of a fixed set, so that the storage
+ * can be shared and unshared from several threads at once. */
+TH_API void THCopyOnWrite_lock(const void *storage);
+TH_API void THCopyOnWrite_unlock(const void *storage);
+
+/* Whether THTensor_(newCopyOnWrite) shares storages (off by default) */
+TH_API void THSetCopyOnWriteClone(int enabled);
+TH_API int THGetCopyOnWriteClone(void);
+
+extern THAllocator THCopyOnWriteAllocator;
+
 #endif
@@ -0,0 +1,217 @@
+#include "THArena.h"
+
+#ifndef TH_HAVE_THREAD
+#define __thread
+#elif _MSC_VER
+#define __thread __declspec( thread )
+#endif
+
+#define TH_ARENA_HEADER 64          /* chunk header, keeps the data aligned */
+#define TH_ARENA_CHUNK 1048576      /* smallest chunk */
+#define TH_ARENA_MAX_DEPTH 64
+
+typedef struct THArenaChunk {
+  struct THArenaChunk *next;
+  ptrdiff_t size;  /* bytes of data */
+  ptrdiff_t used;  /* bytes in use, up to date for the chunks before the current one */
+} THArenaChunk;
+
+typedef struct THArenaMark {
+  THArenaChunk *chunk;
+  ptrdiff_t offset;
+} THArenaMark;
+
+typedef struct THArena {
+  THArenaChunk *first;
+  THArenaChunk *current;
+  ptrdiff_t offset;     /* in the current chunk */
+  int depth;
+  THArenaMark marks[TH_ARENA_MAX_DEPTH];
+} THArena;
+
+/* The chunks of a thread that exits without THArena_release() are lost. */
+static __thread THArena arena;
+
+#define TH_ARENA_DATA(chunk) ((char*)(chunk) + TH_ARENA_HEADER)
+
+static THArenaChunk* THArena_newChunk(ptrdiff_t size, THArenaChunk *next)
+{
+  THArenaChunk *chunk = THAlloc(TH_ARENA_HEADER + size);
+  chunk->next = next;
+  chunk->size = size;
+  chunk->used = 0;
+  return chunk;
+}
+
+int THArena_enter(void)
+{
+  if(arena.depth == TH_ARENA_MAX_DEPTH)
+    THError("THArena: more than %d nested scopes", TH_ARENA_MAX_DEPTH);
+  arena.marks[arena.depth].chunk = arena.current;
+  arena.marks[arena.depth].offset = arena.offset;
+  return arena.depth++;
+}
+
+void THArena_exit(int scope)
+{
+  THArenaChunk *chunk;
+  if(scope < 0 || scope >= arena.depth)
+    THError("THArena_exit: scope %d is not open", scope);
+  arena.depth = scope;
+  arena.current = arena.marks[scope].chunk;
+  arena.offset = arena.marks[scope].offset;
+
+  if(arena.depth > 0)
+    return;
+
+  /* a step that needed several chunks gets one chunk of their total size
+   * next time */
+  if(arena.first && arena.first->next) {
+    ptrdiff_t size = 0;
+    while((chunk = arena.first)) {
+      arena.first = chunk->next;
+      size += chunk->size;
+      THFree(chunk);
+    }
+    arena.first = THArena_newChunk(size, NULL);
+  }
+  arena.current = NULL;
+  arena.offset = 0;
+}
+
+int THArena_active(void)
+{
+  return arena.depth > 0;
+}
+
+void* THArena_alloc(ptrdiff_t size)
+{
+  ptrdiff_t align = size >= 256 ? 64 : 16;
+  if(arena.depth == 0)
+    THError("THArena_alloc: no scope is open");
+  if(size < 0)
+    THError("$ Torch: invalid memory size -- maybe an overflow?");
+
+  if(!arena.current) {
+    if(!arena.first)
+      arena.first = THArena_newChunk(size > TH_ARENA_CHUNK ? size : TH_ARENA_CHUNK, NULL);
+    arena.current = arena.first;
+    arena.offset = 0;
+  }
+  for(;;) {
+    ptrdiff_t start = (arena.offset + align - 1) / align * align;
+    if(start + size <= arena.current->size) {
+      arena.offset = start + size;
+      return TH_ARENA_DATA(arena.current) + start;
+    }
+    /* on to the next chunk, or a new one that fits when it does not */
+    arena.current->used = arena.offset;
+    if(!arena.current->next || arena.current->next->size < size) {
+      ptrdiff_t chunkSize = 2 * arena.current->size;
+      arena.current->next = THArena_newChunk(chunkSize > size ? chunkSize : size,
+                                             arena.current->next);
+    }
+    arena.current = arena.current->next;
+    arena.offset = 0;
+  }
+}
+
+int THArena_owns(const void *ptr)
+{
+  const char *p = ptr;
+  THArenaMark *mark;
+  THArenaChunk *chunk;
+  if(arena.depth == 0 || !arena.current)
+    return 0;
+  mark = &arena.marks[arena.depth-1];
+  for(chunk = mark->chunk ? mark->chunk : arena.first; chunk; chunk = chunk->next) {
+    ptrdiff_t begin = chunk == mark->chunk ? mark->offset : 0;
+    ptrdiff_t end = chunk == arena.current ? arena.offset : chunk->used;
+    if(p >= TH_ARENA_DATA(chunk) + begin && p < TH_ARENA_DATA(chunk) + end)
+      return 1;
+    if(chunk == arena.current)
+      break;
+  }
+  return 0;
+}
+
+ptrdiff_t THArena_reserved(void)
+{
+  ptrdiff_t size = 0;
+  THArenaChunk *chunk;
+  for(chunk = arena.first; chunk; chunk = chunk->next)
+    size += TH_ARENA_HEADER + chunk->size;
+  return size;
+}
+
+void THArena_release(void)
+{
+  THArenaChunk *chunk;
+  if(arena.depth > 0)
+    THError("THArena_release: a scope is open");
+  while((chunk = arena.first)) {
+    arena.first = chunk->next;
+    THFree(chunk);
+  }
+  arena.current = NULL;
+  arena.offset = 0;
+}
+
+/* Blocks of THArenaAllocator: the data is preceded by TH_ARENA_HEADER bytes
+ * ending with the capacity of the block, negated for the blocks on the
+ * heap. */
+
+#define TH_ARENA_CAPACITY(ptr) (((ptrdiff_t*)(ptr))[-1])
+
+static void* THArenaAllocator_block(ptrdiff_t size, int fromArena)
+{
+  char *base = fromArena ? THArena_alloc(TH_ARENA_HEADER + size) : THAlloc(TH_ARENA_HEADER + size);
+  char *ptr = base + TH_ARENA_HEADER;
+  TH_ARENA_CAPACITY(ptr) = fromArena ? size : -size;
+  return ptr;
+}
+
+/* ctx is the storage, if any: its data comes from the arena only while the
+ * scope that created the storage is the innermost one */
+static void* THArenaAllocator_alloc(void *ctx, ptrdiff_t size)
+{
+  if(size == 0)
+    return NULL;
+  return THArenaAllocator_block(size, ctx ? THArena_owns(ctx) : THArena_active());
+}
+
+static void THArenaAllocator_free(void *ctx, void *ptr)
+{
+  if(ptr && TH_ARENA_CAPACITY(ptr) < 0)
+    THFree((char*)ptr - TH_ARENA_HEADER);
+}
+
+static void* THArenaAllocator_realloc(void *ctx, void *ptr, ptrdiff_t size)
+{
+  ptrdiff_t capacity;
+  void *newptr;
+  if(!ptr)
+    return THArenaAllocator_alloc(ctx, size);
+  if(size == 0) {
+    THArenaAllocator_free(ctx, ptr);
+    return NULL;
+  }
+  capacity = TH_ARENA_CAPACITY(ptr);
+  if(capacity < 0)
+    capacity = -capacity;
+  if(size <= capacity)
+    return ptr;
+
+  /* the arena only serves the blocks of the innermost scope, which lives
+   * as long as their storage */
+  newptr = THArenaAllocator_block(size, THArena_owns(ptr));
+  memcpy(newptr, ptr, capacity);
+  THArenaAllocator_free(ctx, ptr);
+  return newptr;
+}
+
+THAllocator THArenaAllocator = {
+  &THArenaAllocator_alloc,
+  &THArenaAllocator_realloc,
+  &THArenaAllocator_free
+};
@@ -0,0 +1,45 @@
+#ifndef TH_ARENA_INC
+#define TH_ARENA_INC
+
+#include "THAllocator.h"
+
+/* Per-thread arena for the temporaries of a computation step.
+ *
+ * Between THArena_enter() and the matching THArena_exit(), the tensor
+ * headers, storages and storage data created by the calling thread are
+ * bump-allocated from a thread-local arena, and THTensor_(free) /
+ * THStorage_(free) give nothing back. THArena_exit() releases everything
+ * allocated since the matching THArena_enter() at once. Scopes nest.
+ *
+ * Tensors and storages created inside a scope must not be used after it
+ * exits; results that outlive the step have to be allocated before the
+ * scope is entered (resizing them inside is fine) or copied out. Other
+ * threads, such as OpenMP workers, allocate as usual unless they open a
+ * scope of their own.
+ *
+ * The memory of the arena is kept for the next scope; THArena_release()
+ * gives it back to the system.
+ */
+
+/* THArena_enter() returns the scope to pass to THArena_exit(), which also
+ * closes the scopes nested in it that an error left open. */
+TH_API int THArena_enter(void);
+TH_API void THArena_exit(int scope);
+/* whether the calling thread is inside a scope */
+TH_API int THArena_active(void);
+/* size bytes from the innermost scope of the calling thread, aligned to 16
+ * bytes (64 from 256 bytes on); raises an error outside of a scope */
+TH_API void* THArena_alloc(ptrdiff_t size);
+/* whether ptr was allocated in the innermost scope of the calling thread */
+TH_API int THArena_owns(const void *ptr);
+/* bytes held by the arena of the calling thread */
+TH_API ptrdiff_t THArena_reserved(void);
+/* frees the memory of the arena of the calling thread, outside of a scope */
+TH_API void THArena_release(void);
+
+/* Allocator of the storages created in a scope, with the storage as
+ * context. Its blocks remember whether they come from the arena, so that a
+ * storage grown outside of the scope that created it moves to the heap. */
+extern THAllocator THArenaAllocator;
+
+#endif
@@ -0,0 +1,470 @@
+#include "THCachingAllocator.h"
+#include "THAtomic.h"
+#include "THMemoryPolicy.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+#ifndef TH_HAVE_THREAD
+#define __thread
+#elif _MSC_VER
+#define __thread __declspec( thread )
+#endif
+
+/*
+ * Caching allocator for CPU memory, after THCCachingAllocator.
+ *
+ * - Memory is obtained from the system in segments, which are carved into
+ *   blocks. A block starts with a header of TH_CACHING_HEADER bytes, so the
+ *   memory handed out keeps the 64-byte alignment of the segments.
+ * - Free blocks are kept in lists binned by size, four bins per power of
+ *   two. An allocation takes a block from the smallest bin that fits and
+ *   splits it if the rest is large enough; a freed block is merged with its
+ *   free neighbours.
+ * - Small requests (blocks up to 1 MiB) are rounded up to the size of their
+ *   bin and carved from 2 MiB segments. Large requests are rounded up to
+ *   128 KiB and get a segment of their own when no cached block fits.
+ * - Each thread keeps up to TH_CACHING_THREAD_BYTES of the small blocks it
+ *   frees, and serves allocations of the same bin from them without taking
+ *   the shared lock. The blocks go back to the shared lists when the thread
+ *   exits (not on Windows, where they stay until emptyCache).
+ * - If the system runs out of memory, the cached segments are released
+ *   and the allocation retried.
+ */
+
+#define TH_CACHING_HEADER 64
+#define TH_CACHING_BINS 224               /* enough for any ptrdiff_t size */
+#define TH_CACHING_SMALL_BLOCK 1048576    /* largest "small" block is 1 MiB */
+#define TH_CACHING_SMALL_SEGMENT 2097152  /* small blocks come from 2 MiB segments */
+#define TH_CACHING_SMALL_SPLIT 512        /* smallest remainder of a small block split */
+#define TH_CACHING_ROUND_LARGE 131072     /* round up large blocks to 128 KiB */
+
+#ifndef TH_CACHING_THREAD_BYTES
+#define TH_CACHING_THREAD_BYTES 8388608   /* per-thread cache of small blocks */
+#endif
+
+typedef struct THCachingBlock {
+  ptrdiff_t size;                   /* bytes, header included */
+  int allocated;                    /* in use, or held by a thread cache */
+  int small;                        /* from a small segment */
+  struct THCachingBlock *prev;      /* previous block of the segment */
+  struct THCachingBlock *next;      /* next block of the segment */
+  struct THCachingBlock *prevFree;  /* neighbours in a free list */
+  struct THCachingBlock *nextFree;
+} THCachingBlock;
+
+typedef struct THCachingThreadCache {
+  int lock;
+  THCachingBlock *bins[TH_CACHING_BINS];  /* stacks linked by nextFree */
+  ptrdiff_t bytes;
+  long hits;
+  struct THCachingThreadCache *next;      /* all the caches ever created */
+} THCachingThreadCache;
+
+/* Shared state, guarded by lock */
+static int lock = 0;
+static THCachingBlock *smallBins[TH_CACHING_BINS];
+static THCachingBlock *largeBins[TH_CACHING_BINS];
+static THCachingThreadCache *threadCaches = NULL;
+static ptrdiff_t cachedBytes = 0;
+static ptrdiff_t reservedBytes = 0;
+static long sharedAllocations = 0;
+static long segments = 0;
+static long systemAllocations = 0;
+static long retiredHits = 0;             /* of the caches of exited threads */
+
+static __thread THCachingThreadCache *threadCache = NULL;
+#ifndef _WIN32
+static pthread_key_t threadCacheKey;     /* its destructor flushes the cache */
+static pthread_once_t threadCacheKeyOnce = PTHREAD_ONCE_INIT;
+#endif
+
+static void THCachingAllocator_lock(int volatile *l)
+{
+  while (!THAtomicCompareAndSwap(l, 0, 1)) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+  }
+}
+
+static void THCachingAllocator_unlock(int volatile *l)
+{
+  THAtomicSet(l, 0);
+}
+
+/* Bin of a size, a multiple of 64: 64, 128, 192, then four bins per power
+ * of two from 256 on. A bin holds the sizes from its size up to the next. */
+static int THCachingAllocator_bin(ptrdiff_t size)
+{
+  int k = 0;
+  if (size < 256)
+    return (int)(size / 64) - 1;
+  while ((size >> k) > 1)
+    k++;
+  return 3 + (k - 8) * 4 + (int)((size >> (k - 2)) & 3);
+}
+
+/* Block size for a request of size bytes */
+static ptrdiff_t THCachingAllocator_round(ptrdiff_t size)
+{
+  ptrdiff_t step = 64;
+  size += TH_CACHING_HEADER;
+  if (size > TH_CACHING_SMALL_BLOCK) {
+    step = TH_CACHING_ROUND_LARGE;
+  } else if (size > 256) {
+    /* up to the size of the next bin */
+    int k = 0;
+    while (((size - 1) >> k) > 1)
+      k++;
+    step = (ptrdiff_t)1 << (k - 2);
+  }
+  return (size + step - 1) / step * step;
+}
+
+static void THCachingAllocator_insert(THCachingBlock *block)
+{
+  THCachingBlock **bins = block->small ? smallBins : largeBins;
+  int bin = THCachingAllocator_bin(block->size);
+  block->prevFree = NULL;
+  block->nextFree = bins[bin];
+  if (bins[bin])
+    bins[bin]->prevFree = block;
+  bins[bin] = block;
+  cachedBytes += block->size;
+}
+
+static void THCachingAllocator_remove(THCachingBlock *block)
+{
+  THCachingBlock **bins = block->small ? smallBins : largeBins;
+  if (block->prevFree)
+    block->prevFree->nextFree = block->nextFree;
+  else
+    bins[THCachingAllocator_bin(block->size)] = block->nextFree;
+  if (block->nextFree)
+    block->nextFree->prevFree = block->prevFree;
+  cachedBytes -= block->size;
+}
+
+/* Smallest cached block of at least size bytes, removed from its bin */
+static THCachingBlock* THCachingAllocator_find(ptrdiff_t size, int small)
+{
+  THCachingBlock **bins = small ? smallBins : largeBins;
+  THCachingBlock *block;
+  int bin = THCachingAllocator_bin(size);
+  for (block = bins[bin]; block; block = block->nextFree)
+    if (block->size >= size)
+      break;
+  /* any block of the larger bins fits */
+  for (bin++; !block && bin < TH_CACHING_BINS; bin++)
+    block = bins[bin];
+  if (block)
+    THCachingAllocator_remove(block);
+  return block;
+}
+
+/* Moves a block into the free lists, merging it with its free neighbours */
+static void THCachingAllocator_release(THCachingBlock *block)
+{
+  THCachingBlock *prev = block->prev, *next = block->next;
+  block->allocated = 0;
+  if (prev && !prev->allocated) {
+    THCachingAllocator_remove(prev);
+    prev->size += block->size;
+    prev->next = next;
+    if (next)
+      next->prev = prev;
+    block = prev;
+  }
+  if (next && !next->allocated) {
+    THCachingAllocator_remove(next);
+    block->size += next->size;
+    block->next = next->next;
+    if (block->next)
+      block->next->prev = block;
+  }
+  THCachingAllocator_insert(block);
+}
+
+static void* THCachingAllocator_systemAlloc(ptrdiff_t size)
+{
+  void *ptr;
+#if (defined(__unix) || defined(__APPLE__)) && (!defined(DISABLE_POSIX_MEMALIGN))
+  if (posix_memalign(&ptr, THMemoryPolicy_alignment(size), size) != 0)
+    ptr = NULL;
+#else
+  ptr = malloc(size);
+#endif
+  if (ptr) {
+    THMemoryPolicy_apply(ptr, size);
+    THHeapUpdate(size);
+  }
+  return ptr;
+}
+
+static void THCachingAllocator_systemFree(void *ptr, ptrdiff_t size)
+{
+  THHeapUpdate(-size);
+  free(ptr);
+}
+
+/* Moves the blocks of a thread cache to the free lists; lock must be held */
+static void THCachingAllocator_flush(THCachingThreadCache *cache)
+{
+  THCachingBlock *block;
+  int bin;
+
+  THCachingAllocator_lock(&cache->lock);
+  for (bin = 0; bin < TH_CACHING_BINS; bin++) {
+    while ((block = cache->bins[bin])) {
+      cache->bins[bin] = block->nextFree;
+      THCachingAllocator_release(block);
+    }
+  }
+  cache->bytes = 0;
+  THCachingAllocator_unlock(&cache->lock);
+}
+
+#ifndef _WIN32
+/* Destructor of threadCacheKey: the cache of an exiting thread goes away.
+ * Should the thread free blocks after it, from another key destructor, it
+ * gets a new cache, and pthreads runs this again. */
+static void THCachingAllocator_threadExit(void *ptr)
+{
+  THCachingThreadCache *cache = ptr, **link;
+
+  THCachingAllocator_lock(&lock);
+  THCachingAllocator_flush(cache);
+  for (link = &threadCaches; *link != cache; link = &(*link)->next)
+    ;
+  *link = cache->next;
+  retiredHits += cache->hits;
+  THCachingAllocator_unlock(&lock);
+  threadCache = NULL;
+  THFree(cache);
+}
+
+static void THCachingAllocator_createKey(void)
+{
+  if (pthread_key_create(&threadCacheKey, THCachingAllocator_threadExit) != 0)
+    THError("THCachingAllocator: cannot create the key of the thread caches");
+}
+#endif
+
+static THCachingThreadCache* THCachingAllocator_threadCache(void)
+{
+  if (!threadCache) {
+    THCachingThreadCache *cache = THAlloc(sizeof(THCachingThreadCache));
+    memset(cache, 0, sizeof(THCachingThreadCache));
+#ifndef _WIN32
+    pthread_once(&threadCacheKeyOnce, THCachingAllocator_createKey);
+    pthread_setspecific(threadCacheKey, cache);
+#endif
+    THCachingAllocator_lock(&lock);
+    cache->next = threadCaches;
+    threadCaches = cache;
+    THCachingAllocator_unlock(&lock);
+    threadCache = cache;
+  }
+  return threadCache;
+}
+
+static void* THCachingAllocator_alloc(void *ctx, ptrdiff_t size)
+{
+  THCachingBlock *block = NULL;
+  ptrdiff_t blockSize;
+  int small;
+
+  if (size < 0)
+    THError("$ Torch: invalid memory size -- maybe an overflow?");
+  if (size == 0)
+    return NULL;
+
+  blockSize = THCachingAllocator_round(size);
+  small = blockSize <= TH_CACHING_SMALL_BLOCK;
+
+  /* fast path: a block of this bin freed earlier by the thread */
+  if (small) {
+    THCachingThreadCache *cache = THCachingAllocator_threadCache();
+    int bin = THCachingAllocator_bin(blockSize);
+    THCachingAllocator_lock(&cache->lock);
+    block = cache->bins[bin];
+    if (block) {
+      cache->bins[bin] = block->nextFree;
+      cache->bytes -= block->size;
+      cache->hits++;
+    }
+    THCachingAllocator_unlock(&cache->lock);
+    if (block)
+      return (char*)block + TH_CACHING_HEADER;
+  }
+
+  THCachingAllocator_lock(&lock);
+  block = THCachingAllocator_find(blockSize, small);
+  if (!block) {
+    ptrdiff_t segmentSize = small ? TH_CACHING_SMALL_SEGMENT : blockSize;
+    THCachingAllocator_unlock(&lock);
+    block = THCachingAllocator_systemAlloc(segmentSize);
+    if (!block) {
+      THCachingAllocator_emptyCache();
+      block = THCachingAllocator_systemAlloc(segmentSize);
+    }
+    if (!block)
+      THError("$ Torch: not enough memory: you tried to allocate %dGB. Buy new RAM!",
+              size/1073741824);
+    block->size = segmentSize;
+    block->small = small;
+    block->prev = block->next = NULL;
+    THCachingAllocator_lock(&lock);
+    reservedBytes += segmentSize;
+    segments++;
+    systemAllocations++;
+  }
+
+  /* split off the rest if it is worth keeping */
+  if (block->size - blockSize >= (small ? TH_CACHING_SMALL_SPLIT : TH_CACHING_SMALL_BLOCK + 1)) {
+    THCachingBlock *rest = (THCachingBlock*)((char*)block + blockSize);
+    rest->size = block->size - blockSize;
+    rest->small = small;
+    rest->allocated = 0;
+    rest->prev = block;
+    rest->next = block->next;
+    if (rest->next)
+      rest->next->prev = rest;
+    block->next = rest;
+    block->size = blockSize;
+    THCachingAllocator_insert(rest);
+  }
+  block->allocated = 1;
+  sharedAllocations++;
+  THCachingAllocator_unlock(&lock);
+
+  return (char*)block + TH_CACHING_HEADER;
+}
+
+static void THCachingAllocator_free(void *ctx, void *ptr)
+{
+  THCachingBlock *block;
+  if (!ptr)
+    return;
+  block = (THCachingBlock*)((char*)ptr - TH_CACHING_HEADER);
+
+  /* fast path: keep small blocks for the thread while its cache has room */
+  if (block->small) {
+    THCachingThreadCache *cache = THCachingAllocator_threadCache();
+    int kept = 0;
+    THCachingAllocator_lock(&cache->lock);
+    if (cache->bytes + block->size <= TH_CACHING_THREAD_BYTES) {
+      int bin = THCachingAllocator_bin(block->size);
+      block->nextFree = cache->bins[bin];
+      cache->bins[bin] = block;
+      cache->bytes += block->size;
+      kept = 1;
+    }
+    THCachingAllocator_unlock(&cache->lock);
+    if (kept)
+      return;
+  }
+
+  THCachingAllocator_lock(&lock);
+  THCachingAllocator_release(block);
+  THCachingAllocator_unlock(&lock);
+}
+
+static void* THCachingAllocator_realloc(void *ctx, void *ptr, ptrdiff_t size)
+{
+  THCachingBlock *block;
+  ptrdiff_t capacity;
+  void *newptr;
+
+  if (!ptr)
+    return THCachingAllocator_alloc(ctx, size);
+  if (size == 0) {
+    THCachingAllocator_free(ctx, ptr);
+    return NULL;
+  }
+
+  /* keep the block if the new size fits and does not waste most of it */
+  block = (THCachingBlock*)((char*)ptr - TH_CACHING_HEADER);
+  capacity = block->size - TH_CACHING_HEADER;
+  if (size <= capacity && size > capacity / 2)
+    return ptr;
+
+  newptr = THCachingAllocator_alloc(ctx, size);
+  memcpy(newptr, ptr, size < capacity ? size : capacity);
+  THCachingAllocator_free(ctx, ptr);
+  return newptr;
+}
+
+void THCachingAllocator_emptyCache(void)
+{
+  THCachingThreadCache *cache;
+  THCachingBlock *unused = NULL, *block;
+  int bin, pool;
+
+  THCachingAllocator_lock(&lock);
+
+  /* return the blocks held by the thread caches */
+  for (cache = threadCaches; cache; cache = cache->next)
+    THCachingAllocator_flush(cache);
+
+  /* take out the segments that are entirely free */
+  for (pool = 0; pool < 2; pool++) {
+    THCachingBlock **bins = pool ? largeBins : smallBins;
+    for (bin = 0; bin < TH_CACHING_BINS; bin++) {
+      THCachingBlock *next;
+      for (block = bins[bin]; block; block = next) {
+        next = block->nextFree;
+        if (!block->prev && !block->next) {
+          THCachingAllocator_remove(block);
+          reservedBytes -= block->size;
+          segments--;
+          block->nextFree = unused;
+          unused = block;
+        }
+      }
+    }
+  }
+  THCachingAllocator_unlock(&lock);
+
+  while ((block = unused)) {
+    unused = block->nextFree;
+    THCachingAllocator_systemFree(block, block->size);
+  }
+}
+
+void THCachingAllocator_getStats(THCachingAllocatorStats *stats)
+{
+  THCachingThreadCache *cache;
+
+  THCachingAllocator_lock(&lock);
+  stats->cached = cachedBytes;
+  stats->reserved = reservedBytes;
+  stats->allocations = sharedAllocations;
+  stats->threadCacheHits = retiredHits;
+  stats->segments = segments;
+  stats->systemAllocations = systemAllocations;
+  stats->threadCaches = 0;
+  for (cache = threadCaches; cache; cache = cache->next) {
+    THCachingAllocator_lock(&cache->lock);
+    stats->cached += cache->bytes;
+    stats->threadCacheHits += cache->hits;
+    stats->threadCaches++;
+    THCachingAllocator_unlock(&cache->lock);
+  }
+  stats->allocations += stats->threadCacheHits;
+  stats->allocated = stats->reserved - stats->cached;
+  THCachingAllocator_unlock(&lock);
+}
+
+THAllocator THCachingAllocator = {
+  &THCachingAllocator_alloc,
+  &THCachingAllocator_realloc,
+  &THCachingAllocator_free
+};
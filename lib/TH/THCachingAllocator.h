@@ -0,0 +1,30 @@
+#ifndef TH_CACHING_ALLOCATOR_INC
+#define TH_CACHING_ALLOCATOR_INC
+
+#include "THAllocator.h"
+
+/* Caching allocator for CPU memory, in the spirit of THCCachingAllocator:
+ * freed blocks are kept in size-binned free lists and reused, instead of
+ * going back to the system on every free. Install it for the storages
+ * with THSetStorageAllocator(&THCachingAllocator).
+ */
+extern THAllocator THCachingAllocator;
+
+typedef struct THCachingAllocatorStats {
+  ptrdiff_t allocated;     /* bytes of the blocks in use */
+  ptrdiff_t cached;        /* bytes of the free blocks, thread caches included */
+  ptrdiff_t reserved;      /* bytes obtained from the system: allocated + cached */
+  long allocations;        /* blocks handed out so far */
+  long threadCacheHits;    /* of which served by a thread cache */
+  long segments;           /* system allocations currently held */
+  long systemAllocations;  /* system allocations made so far */
+  long threadCaches;       /* caches of the threads alive */
+} THCachingAllocatorStats;
+
+/* Returns the cached memory that is not in use to the system. */
+TH_API void THCachingAllocator_emptyCache(void);
+/* Statistics of the allocator; only approximate while other threads
+ * allocate. */
+TH_API void THCachingAllocator_getStats(THCachingAllocatorStats *stats);
+
+#endif
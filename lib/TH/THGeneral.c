@@ -1,5 +1,6 @@
 #include "THGeneral.h"
 #include "THAtomic.h"
+#include "THMemoryPolicy.h"
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -21,6 +22,12 @@
 #include <malloc/malloc.h>
 #endif
 
+#if defined(__linux__) && defined(HAVE_MMAP)
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
 /* Torch Error Handling */
 static void defaultErrorHandlerFunction(const char *msg, void *data)
 {
@@ -223,14 +230,41 @@ void THHeapUpdate(ptrdiff_t size) {
   }
 }
 
-static void* THAllocInternal(ptrdiff_t size)
+/* Blocks of THCalloc from that size on are zeroed lazily. */
+#define TH_LAZY_ZERO_SIZE 1048576
+
+/* Zeroes a new block. On Linux the whole pages of a large block are given
+ * back with madvise(MADV_DONTNEED) instead of being written, and the kernel
+ * maps zero pages on first access; a fresh block from mmap has no pages to
+ * give back, which makes large zeroed blocks almost free. The malloc
+ * bookkeeping lies outside of these pages. */
+static void THZeroBlock(void *ptr, ptrdiff_t size)
+{
+#if defined(__linux__) && defined(HAVE_MMAP) && defined(MADV_DONTNEED)
+  if (size >= TH_LAZY_ZERO_SIZE)
+  {
+    uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    char *begin = (char*)(((uintptr_t)ptr + pageSize - 1) / pageSize * pageSize);
+    char *end = (char*)(((uintptr_t)ptr + size) / pageSize * pageSize);
+    if (madvise(begin, end - begin, MADV_DONTNEED) == 0)
+    {
+      memset(ptr, 0, begin - (char*)ptr);
+      memset(end, 0, (char*)ptr + size - end);
+      return;
+    }
+  }
+#endif
+  memset(ptr, 0, size);
+}
+
+static void* THAllocInternal(ptrdiff_t size, int zero)
 {
   void *ptr;
 
   if (size > 5120)
   {
 #if (defined(__unix) || defined(__APPLE__)) && (!defined(DISABLE_POSIX_MEMALIGN))
-    if (posix_memalign(&ptr, 64, size) != 0)
+    if (posix_memalign(&ptr, THMemoryPolicy_alignment(size), size) != 0)
       ptr = NULL;
 /*
 #elif defined(_WIN32)
@@ -245,11 +279,14 @@ static void* THAllocInternal(ptrdiff_t size)
     ptr = malloc(size);
   }
 
+  if (ptr && zero)
+    THZeroBlock(ptr, size);
+  THMemoryPolicy_apply(ptr, size);
   THHeapUpdate(getAllocSize(ptr));
   return ptr;
 }
 
-void* THAlloc(ptrdiff_t size)
+static void* THAllocWithGC(ptrdiff_t size, int zero)
 {
   void *ptr;
 
@@ -259,11 +296,11 @@ void* THAlloc(ptrdiff_t size)
   if(size == 0)
     return NULL;
 
-  ptr = THAllocInternal(size);
+  ptr = THAllocInternal(size, zero);
 
   if(!ptr && torchGCFunction) {
     torchGCFunction(torchGCData);
-    ptr = THAllocInternal(size);
+    ptr = THAllocInternal(size, zero);
   }
 
   if(!ptr)
@@ -272,6 +309,16 @@ void* THAlloc(ptrdiff_t size)
   return ptr;
 }
 
+void* THAlloc(ptrdiff_t size)
+{
+  return THAllocWithGC(size, 0);
+}
+
+void* THCalloc(ptrdiff_t size)
+{
+  return THAllocWithGC(size, 1);
+}
+
 void* THRealloc(void *ptr, ptrdiff_t size)
 {
   if(!ptr)
@@ -297,6 +344,8 @@ void* THRealloc(void *ptr, ptrdiff_t size)
   if(!newptr)
     THError("$ Torch: not enough memory: you tried to reallocate %dGB. Buy new RAM!", size/1073741824);
 
+  THMemoryPolicy_apply(newptr, size);
+
   // update heapSize only after successfully reallocated
   THHeapUpdate(oldSize + getAllocSize(newptr));
 
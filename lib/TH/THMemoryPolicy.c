@@ -0,0 +1,198 @@
+#include "THMemoryPolicy.h"
+#include "THAtomic.h"
+
+#include <stdint.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__unix) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && defined(SYS_mbind)
+#define TH_HAVE_MBIND 1
+/* from <linux/mempolicy.h>, not always installed; MPOL_PREFERRED without
+ * nodes means the local node */
+#define TH_MPOL_PREFERRED  1
+#define TH_MPOL_INTERLEAVE 3
+#define TH_MAX_NODES 1024
+#define TH_NODE_WORDS (TH_MAX_NODES / (8 * sizeof(unsigned long)))
+static unsigned long nodeMask[TH_NODE_WORDS];
+#endif
+
+static THMemoryPolicy policy = {TH_HUGE_PAGE_SIZE, 0, TH_NUMA_DEFAULT, 0};
+static int policyInitialized = 0;
+static int numNodes = 0;
+
+static int THMemoryPolicy_envFlag(const char *name, int value)
+{
+  const char *env = getenv(name);
+  if(!env || !*env)
+    return value;
+  if(!strcmp(env, "0") || !strcmp(env, "off") || !strcmp(env, "false"))
+    return 0;
+  return 1;
+}
+
+/* the online nodes, as listed in /sys, e.g. "0-1,4" */
+static void THMemoryPolicy_initNodes(void)
+{
+#ifdef TH_HAVE_MBIND
+  FILE *f = fopen("/sys/devices/system/node/online", "r");
+  int first, last, n;
+  char sep;
+  numNodes = 1;
+  if(!f)
+    return;
+  numNodes = 0;
+  while(fscanf(f, "%d", &first) == 1) {
+    last = first;
+    sep = (char)fgetc(f);
+    if(sep == '-') {
+      if(fscanf(f, "%d", &last) != 1)
+        break;
+      sep = (char)fgetc(f);
+    }
+    for(n = first; n <= last && n < TH_MAX_NODES; n++) {
+      nodeMask[n / (8 * sizeof(unsigned long))] |= 1UL << (n % (8 * sizeof(unsigned long)));
+      numNodes++;
+    }
+    if(sep != ',')
+      break;
+  }
+  fclose(f);
+  if(numNodes == 0)
+    numNodes = 1;
+#else
+  numNodes = 1;
+#endif
+}
+
+/* The policy is read from the environment on first use. Should several
+ * threads get there at once, they read the same values. */
+static void THMemoryPolicy_init(void)
+{
+  const char *env;
+  if(policyInitialized)
+    return;
+
+  THMemoryPolicy_initNodes();
+
+  policy.hugePages = THMemoryPolicy_envFlag("TH_HUGEPAGES", policy.hugePages);
+  policy.firstTouch = THMemoryPolicy_envFlag("TH_FIRST_TOUCH", policy.firstTouch);
+  env = getenv("TH_NUMA");
+  if(env && !strcmp(env, "interleave"))
+    policy.numa = TH_NUMA_INTERLEAVE;
+  else if(env && !strcmp(env, "local"))
+    policy.numa = TH_NUMA_LOCAL;
+  env = getenv("TH_MEMORY_POLICY_MIN_SIZE");
+  if(env && *env) {
+    long long minSize = atoll(env);
+    if(minSize > 0)
+      policy.minSize = (ptrdiff_t)minSize;
+  }
+  policyInitialized = 1;
+}
+
+void THGetMemoryPolicy(THMemoryPolicy *policy_)
+{
+  THMemoryPolicy_init();
+  *policy_ = policy;
+}
+
+void THSetMemoryPolicy(const THMemoryPolicy *policy_)
+{
+  THArgCheck(policy_->minSize > 0, 1, "minSize should be positive");
+  THArgCheck(policy_->numa >= TH_NUMA_DEFAULT && policy_->numa <= TH_NUMA_LOCAL, 1,
+             "unknown NUMA policy %d", policy_->numa);
+  THMemoryPolicy_init();
+  policy = *policy_;
+}
+
+int THMemoryPolicy_numNodes(void)
+{
+  THMemoryPolicy_init();
+  return numNodes;
+}
+
+ptrdiff_t THMemoryPolicy_alignment(ptrdiff_t size)
+{
+  THMemoryPolicy_init();
+  if(policy.hugePages && size >= policy.minSize)
+    return TH_HUGE_PAGE_SIZE;
+  return 64;
+}
+
+static ptrdiff_t THMemoryPolicy_pageSize(void)
+{
+#if defined(__unix) || defined(__APPLE__)
+  static ptrdiff_t pageSize = 0;
+  if(pageSize == 0)
+    pageSize = sysconf(_SC_PAGESIZE);
+  return pageSize;
+#else
+  return 4096;
+#endif
+}
+
+/* the pages lying entirely within [ptr, ptr+size), aligned to align */
+static ptrdiff_t THMemoryPolicy_range(void *ptr, ptrdiff_t size, ptrdiff_t align, char **begin)
+{
+  uintptr_t first = ((uintptr_t)ptr + align - 1) / align * align;
+  uintptr_t last = ((uintptr_t)ptr + size) / align * align;
+  *begin = (char*)first;
+  return last > first ? (ptrdiff_t)(last - first) : 0;
+}
+
+void THMemoryPolicy_apply(void *ptr, ptrdiff_t size)
+{
+  ptrdiff_t pageSize, length;
+  char *begin;
+
+  THMemoryPolicy_init();
+  if(!ptr || size < policy.minSize)
+    return;
+  pageSize = THMemoryPolicy_pageSize();
+
+#if defined(HAVE_MMAP) && defined(MADV_HUGEPAGE)
+  if(policy.hugePages) {
+    length = THMemoryPolicy_range(ptr, size, TH_HUGE_PAGE_SIZE, &begin);
+    if(length > 0)
+      madvise(begin, length, MADV_HUGEPAGE);
+  }
+#endif
+
+#ifdef TH_HAVE_MBIND
+  /* failures (no NUMA support in the kernel, a restrictive cpuset) leave
+   * the pages to the default policy */
+  if(policy.numa != TH_NUMA_DEFAULT && numNodes > 1) {
+    length = THMemoryPolicy_range(ptr, size, pageSize, &begin);
+    if(length > 0) {
+      if(policy.numa == TH_NUMA_INTERLEAVE)
+        syscall(SYS_mbind, begin, length, TH_MPOL_INTERLEAVE, nodeMask, TH_MAX_NODES + 1, 0);
+      else
+        syscall(SYS_mbind, begin, length, TH_MPOL_PREFERRED, NULL, 0, 0);
+    }
+  }
+#endif
+
+  if(policy.firstTouch) {
+    /* adding 0 to the first word of each page faults it in from the thread
+     * that gets it in a static schedule, as the parallel loops of TH do; a
+     * plain read would map the zero page and fault again on the write */
+    ptrdiff_t nPages, i;
+    length = THMemoryPolicy_range(ptr, size, pageSize, &begin);
+    nPages = length / pageSize;
+#pragma omp parallel for schedule(static) private(i)
+    for(i = 0; i < nPages; i++)
+      THAtomicAdd((int*)(begin + i * pageSize), 0);
+  }
+}
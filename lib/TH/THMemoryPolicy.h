@@ -0,0 +1,55 @@
+#ifndef TH_MEMORY_POLICY_INC
+#define TH_MEMORY_POLICY_INC
+
+#include "THGeneral.h"
+
+/* Placement of the large blocks obtained by THAlloc, and so of the data
+ * of large storages.
+ *
+ * - hugePages asks for transparent huge pages: the blocks are aligned to
+ *   TH_HUGE_PAGE_SIZE and madvise(MADV_HUGEPAGE)'d, which takes effect
+ *   when the kernel has THP in "madvise" or "always" mode.
+ * - numa binds the pages of the blocks, when the machine has more than one
+ *   node: interleaved over all nodes, or on the node of the thread that
+ *   first writes each page.
+ * - firstTouch writes every page of a new block from the OpenMP threads,
+ *   with the same static schedule as the parallel loops of TH, so that
+ *   under the local policy each thread finds its part of a contiguous
+ *   tensor on its own node (and the page faults are taken in parallel).
+ *
+ * The default policy changes nothing. It is read once from the
+ * environment:
+ *   TH_HUGEPAGES=0|1
+ *   TH_NUMA=default|interleave|local
+ *   TH_FIRST_TOUCH=0|1
+ *   TH_MEMORY_POLICY_MIN_SIZE=<bytes>  (blocks it applies to, 2 MiB)
+ * and can be changed with THSetMemoryPolicy() before the memory it should
+ * apply to is allocated.
+ */
+
+#define TH_HUGE_PAGE_SIZE 2097152
+
+#define TH_NUMA_DEFAULT    0
+#define TH_NUMA_INTERLEAVE 1
+#define TH_NUMA_LOCAL      2
+
+typedef struct THMemoryPolicy {
+  ptrdiff_t minSize;  /* blocks from that many bytes on follow the policy */
+  int hugePages;
+  int numa;           /* TH_NUMA_* */
+  int firstTouch;
+} THMemoryPolicy;
+
+TH_API void THGetMemoryPolicy(THMemoryPolicy *policy);
+TH_API void THSetMemoryPolicy(const THMemoryPolicy *policy);
+/* the memory nodes of the machine, 1 when it is not NUMA or unknown */
+TH_API int THMemoryPolicy_numNodes(void);
+
+/* Alignment for a block of size bytes under the current policy. */
+TH_API ptrdiff_t THMemoryPolicy_alignment(ptrdiff_t size);
+/* Applies the current policy to a block of size bytes. The contents are
+ * preserved, so that it applies to reallocated blocks as well, but pages
+ * already in use are not moved. For allocators. */
+TH_API void THMemoryPolicy_apply(void *ptr, ptrdiff_t size);
+
+#endif
@@ -0,0 +1,471 @@
+#include "THMemoryStats.h"
+#include "THAtomic.h"
+#include "THArena.h"
+#include "THCachingAllocator.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+#ifndef TH_HAVE_THREAD
+#define __thread
+#elif _MSC_VER
+#define __thread __declspec( thread )
+#endif
+
+/* slots are claimed by one thread and then read by all */
+#define TH_SLOT_FREE     0
+#define TH_SLOT_CLAIMING 1
+#define TH_SLOT_READY    2
+
+typedef struct THMemoryAllocatorSlot {
+  int state;
+  THAllocator *allocator;
+  const char *name;
+  THMemoryCounters counters;
+} THMemoryAllocatorSlot;
+
+typedef struct THMemorySiteSlot {
+  int state;
+  const char *site;
+  ptrdiff_t allocations;
+  ptrdiff_t bytes;
+} THMemorySiteSlot;
+
+static THMemoryCounters total;
+static THMemoryCounters types[TH_MEMORY_NUM_TYPES];
+static THMemoryAllocatorSlot allocators[TH_MEMORY_MAX_ALLOCATORS] = {
+  {TH_SLOT_READY, &THDefaultAllocator, "default"},
+  {TH_SLOT_READY, &THCachingAllocator, "caching"},
+  {TH_SLOT_READY, &THArenaAllocator, "arena"},
+  {TH_SLOT_READY, &THMapAllocator, "map"},
+  {TH_SLOT_READY, &THRefcountedMapAllocator, "shared memory"},
+};
+
+/* The counters of a thread, added to the shared ones above in batches: when
+ * the bytes it allocated less those it freed since the last batch go past
+ * TH_MEMORY_BATCH either way, and when the counters are read. Its peaks are
+ * the highest of those bytes since the last batch. The lock is only taken
+ * by another thread when it reads the counters. */
+#define TH_MEMORY_BATCH ((ptrdiff_t)1 << 20)
+
+typedef struct THMemoryThreadStats {
+  int lock;
+  THMemoryCounters total;
+  THMemoryCounters types[TH_MEMORY_NUM_TYPES];
+  THMemoryCounters allocators[TH_MEMORY_MAX_ALLOCATORS];
+  int sitesUsed;
+  ptrdiff_t siteAllocations[TH_MEMORY_MAX_SITES + 1];  /* the last is "other" */
+  ptrdiff_t siteBytes[TH_MEMORY_MAX_SITES + 1];
+  THAllocator *lastAllocator;                          /* and its slot */
+  int lastAllocatorIndex;
+  struct THMemoryThreadStats *next;                    /* all the live threads */
+} THMemoryThreadStats;
+
+/* guards the list of the threads */
+static int threadsLock = 0;
+static THMemoryThreadStats *threads = NULL;
+static __thread THMemoryThreadStats *threadStats = NULL;
+#ifndef _WIN32
+static pthread_key_t threadStatsKey;     /* its destructor adds the counters */
+static pthread_once_t threadStatsKeyOnce = PTHREAD_ONCE_INIT;
+#endif
+
+static int siteTracking = 0;
+static __thread const char *threadSite = NULL;
+static THMemorySiteSlot sites[TH_MEMORY_MAX_SITES];
+static THMemorySiteSlot otherSite = {TH_SLOT_READY, "other"};
+
+/* the bytes allocated less the bytes freed by the thread while it has scopes,
+ * and their highest value in its innermost scope */
+static __thread int threadScopes = 0;
+static __thread ptrdiff_t threadLive = 0;
+static __thread ptrdiff_t threadPeak = 0;
+
+static void THMemoryStats_updatePeak(ptrdiff_t *peak, ptrdiff_t live)
+{
+  ptrdiff_t old = THAtomicGetPtrdiff(peak);
+  while(live > old && !THAtomicCompareAndSwapPtrdiff(peak, old, live))
+    old = THAtomicGetPtrdiff(peak);
+}
+
+static void THMemoryStats_lock(int volatile *l)
+{
+  while(!THAtomicCompareAndSwap(l, 0, 1)) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+  }
+}
+
+static void THMemoryStats_unlock(int volatile *l)
+{
+  THAtomicSet(l, 0);
+}
+
+/* counters of a thread, which only it updates */
+static void THMemoryCounters_add(THMemoryCounters *counters, ptrdiff_t bytes)
+{
+  counters->live += bytes;
+  if(bytes > 0) {
+    counters->allocations++;
+    counters->peak = counters->live > counters->peak ? counters->live : counters->peak;
+  } else {
+    counters->frees++;
+  }
+}
+
+/* adds the counters of a thread to the shared ones, and clears them */
+static void THMemoryCounters_flush(THMemoryCounters *counters, THMemoryCounters *shared)
+{
+  ptrdiff_t live;
+
+  if(counters->allocations == 0 && counters->frees == 0)
+    return;
+  live = THAtomicAddPtrdiff(&shared->live, counters->live);
+  THMemoryStats_updatePeak(&shared->peak, live + counters->peak);
+  if(counters->allocations)
+    THAtomicAddPtrdiff(&shared->allocations, counters->allocations);
+  if(counters->frees)
+    THAtomicAddPtrdiff(&shared->frees, counters->frees);
+  memset(counters, 0, sizeof(THMemoryCounters));
+}
+
+static void THMemoryCounters_get(THMemoryCounters *counters, THMemoryCounters *out)
+{
+  out->live = THAtomicGetPtrdiff(&counters->live);
+  out->peak = THAtomicGetPtrdiff(&counters->peak);
+  out->allocations = THAtomicGetPtrdiff(&counters->allocations);
+  out->frees = THAtomicGetPtrdiff(&counters->frees);
+}
+
+/* waits for a slot being claimed by another thread */
+static int THMemoryStats_slotState(int *state)
+{
+  int value;
+  while((value = THAtomicGet(state)) == TH_SLOT_CLAIMING)
+    ;
+  return value;
+}
+
+/* the slot of allocator, claimed on first use; NULL when all are taken */
+static THMemoryAllocatorSlot* THMemoryStats_allocatorSlot(THAllocator *allocator)
+{
+  int i;
+  for(i = 0; i < TH_MEMORY_MAX_ALLOCATORS; i++) {
+    THMemoryAllocatorSlot *slot = &allocators[i];
+    int state = THMemoryStats_slotState(&slot->state);
+    if(state == TH_SLOT_FREE) {
+      if(!THAtomicCompareAndSwap(&slot->state, TH_SLOT_FREE, TH_SLOT_CLAIMING)) {
+        state = THMemoryStats_slotState(&slot->state);
+      } else {
+        slot->allocator = allocator;
+        slot->name = "unnamed";
+        THAtomicSet(&slot->state, TH_SLOT_READY);
+        return slot;
+      }
+    }
+    if(state == TH_SLOT_READY && slot->allocator == allocator)
+      return slot;
+  }
+  return NULL;
+}
+
+/* the index of the slot of site, found by the hash of its address, or
+ * TH_MEMORY_MAX_SITES for "other": sites are told apart by address, so
+ * that no string is compared */
+static int THMemoryStats_siteSlot(const char *site)
+{
+  size_t hash = (size_t)site;
+  int i;
+
+  hash ^= hash >> 16;
+  hash *= 0x45d9f3b;
+  hash ^= hash >> 16;
+  for(i = 0; i < TH_MEMORY_MAX_SITES; i++) {
+    int index = (int)((hash + i) & (TH_MEMORY_MAX_SITES - 1));
+    THMemorySiteSlot *slot = &sites[index];
+    int state = THMemoryStats_slotState(&slot->state);
+    if(state == TH_SLOT_FREE) {
+      if(!THAtomicCompareAndSwap(&slot->state, TH_SLOT_FREE, TH_SLOT_CLAIMING)) {
+        state = THMemoryStats_slotState(&slot->state);
+      } else {
+        slot->site = site;
+        THAtomicSet(&slot->state, TH_SLOT_READY);
+        return index;
+      }
+    }
+    if(state == TH_SLOT_READY && slot->site == site)
+      return index;
+  }
+  return TH_MEMORY_MAX_SITES;
+}
+
+/* adds the counters of a thread to the shared ones; under its lock */
+static void THMemoryStats_flush(THMemoryThreadStats *stats)
+{
+  int i;
+
+  THMemoryCounters_flush(&stats->total, &total);
+  for(i = 0; i < TH_MEMORY_NUM_TYPES; i++)
+    THMemoryCounters_flush(&stats->types[i], &types[i]);
+  for(i = 0; i < TH_MEMORY_MAX_ALLOCATORS; i++)
+    THMemoryCounters_flush(&stats->allocators[i], &allocators[i].counters);
+  if(stats->sitesUsed) {
+    for(i = 0; i <= TH_MEMORY_MAX_SITES; i++) {
+      THMemorySiteSlot *slot = i < TH_MEMORY_MAX_SITES ? &sites[i] : &otherSite;
+      if(stats->siteAllocations[i]) {
+        THAtomicAddPtrdiff(&slot->allocations, stats->siteAllocations[i]);
+        THAtomicAddPtrdiff(&slot->bytes, stats->siteBytes[i]);
+        stats->siteAllocations[i] = 0;
+        stats->siteBytes[i] = 0;
+      }
+    }
+    stats->sitesUsed = 0;
+  }
+}
+
+/* adds the counters of all the threads to the shared ones, before they are
+ * read */
+static void THMemoryStats_merge(void)
+{
+  THMemoryThreadStats *stats;
+
+  THMemoryStats_lock(&threadsLock);
+  for(stats = threads; stats; stats = stats->next) {
+    THMemoryStats_lock(&stats->lock);
+    THMemoryStats_flush(stats);
+    THMemoryStats_unlock(&stats->lock);
+  }
+  THMemoryStats_unlock(&threadsLock);
+}
+
+#ifndef _WIN32
+/* Destructor of threadStatsKey: the counters of an exiting thread are added
+ * to the shared ones. Should the thread record after it, from another key
+ * destructor, it gets new counters, and pthreads runs this again. */
+static void THMemoryStats_threadExit(void *ptr)
+{
+  THMemoryThreadStats *stats = ptr, **link;
+
+  THMemoryStats_lock(&threadsLock);
+  THMemoryStats_flush(stats);
+  for(link = &threads; *link != stats; link = &(*link)->next)
+    ;
+  *link = stats->next;
+  THMemoryStats_unlock(&threadsLock);
+  threadStats = NULL;
+  THFree(stats);
+}
+
+static void THMemoryStats_createKey(void)
+{
+  if(pthread_key_create(&threadStatsKey, THMemoryStats_threadExit) != 0)
+    THError("THMemoryStats: cannot create the key of the thread counters");
+}
+#endif
+
+static THMemoryThreadStats* THMemoryStats_threadStats(void)
+{
+  if(!threadStats) {
+    THMemoryThreadStats *stats = THAlloc(sizeof(THMemoryThreadStats));
+    memset(stats, 0, sizeof(THMemoryThreadStats));
+    stats->lastAllocatorIndex = -1;
+#ifndef _WIN32
+    pthread_once(&threadStatsKeyOnce, THMemoryStats_createKey);
+    pthread_setspecific(threadStatsKey, stats);
+#endif
+    THMemoryStats_lock(&threadsLock);
+    stats->next = threads;
+    threads = stats;
+    THMemoryStats_unlock(&threadsLock);
+    threadStats = stats;
+  }
+  return threadStats;
+}
+
+void THMemoryStats_record(THAllocator *allocator, int type, ptrdiff_t bytes)
+{
+  THMemoryThreadStats *stats;
+
+  if(bytes == 0)
+    return;
+  stats = THMemoryStats_threadStats();
+  THMemoryStats_lock(&stats->lock);
+  THMemoryCounters_add(&stats->total, bytes);
+  THMemoryCounters_add(&stats->types[type], bytes);
+  if(allocator != stats->lastAllocator) {
+    THMemoryAllocatorSlot *slot = THMemoryStats_allocatorSlot(allocator);
+    stats->lastAllocator = allocator;
+    stats->lastAllocatorIndex = slot ? (int)(slot - allocators) : -1;
+  }
+  if(stats->lastAllocatorIndex >= 0)
+    THMemoryCounters_add(&stats->allocators[stats->lastAllocatorIndex], bytes);
+
+  if(siteTracking && bytes > 0) {
+    int site = THMemoryStats_siteSlot(threadSite ? threadSite : "unknown");
+    stats->siteAllocations[site]++;
+    stats->siteBytes[site] += bytes;
+    stats->sitesUsed = 1;
+  }
+
+  if(stats->total.peak > TH_MEMORY_BATCH || stats->total.live < -TH_MEMORY_BATCH)
+    THMemoryStats_flush(stats);
+  THMemoryStats_unlock(&stats->lock);
+
+  if(threadScopes > 0) {
+    threadLive += bytes;
+    threadPeak = threadLive > threadPeak ? threadLive : threadPeak;
+  }
+}
+
+void THMemoryStats_total(THMemoryCounters *counters)
+{
+  THMemoryStats_merge();
+  THMemoryCounters_get(&total, counters);
+}
+
+void THMemoryStats_byType(int type, THMemoryCounters *counters)
+{
+  THArgCheck(type >= 0 && type < TH_MEMORY_NUM_TYPES, 1, "unknown type %d", type);
+  THMemoryStats_merge();
+  THMemoryCounters_get(&types[type], counters);
+}
+
+int THMemoryStats_numAllocators(void)
+{
+  int n = 0;
+  while(n < TH_MEMORY_MAX_ALLOCATORS && THMemoryStats_slotState(&allocators[n].state) == TH_SLOT_READY)
+    n++;
+  return n;
+}
+
+const char* THMemoryStats_byAllocator(int index, THMemoryCounters *counters)
+{
+  THArgCheck(index >= 0 && index < THMemoryStats_numAllocators(), 1, "no allocator %d", index);
+  THMemoryStats_merge();
+  THMemoryCounters_get(&allocators[index].counters, counters);
+  return allocators[index].name;
+}
+
+void THMemoryStats_registerAllocator(THAllocator *allocator, const char *name)
+{
+  THMemoryAllocatorSlot *slot = THMemoryStats_allocatorSlot(allocator);
+  if(!slot)
+    THError("too many allocators, at most %d are counted", TH_MEMORY_MAX_ALLOCATORS);
+  slot->name = name;
+}
+
+void THMemoryStats_resetPeak(void)
+{
+  int i, n = THMemoryStats_numAllocators();
+  THMemoryStats_merge();
+  THAtomicSetPtrdiff(&total.peak, THAtomicGetPtrdiff(&total.live));
+  for(i = 0; i < TH_MEMORY_NUM_TYPES; i++)
+    THAtomicSetPtrdiff(&types[i].peak, THAtomicGetPtrdiff(&types[i].live));
+  for(i = 0; i < n; i++)
+    THAtomicSetPtrdiff(&allocators[i].counters.peak, THAtomicGetPtrdiff(&allocators[i].counters.live));
+}
+
+void THMemoryStats_beginScope(THMemoryScope *scope)
+{
+  THMemoryThreadStats *stats = THMemoryStats_threadStats();
+  /* the bytes of the other threads since their last batch are left out */
+  THMemoryStats_lock(&stats->lock);
+  scope->base = THAtomicGetPtrdiff(&total.live) + stats->total.live;
+  THMemoryStats_unlock(&stats->lock);
+  scope->start = threadLive;
+  scope->outerPeak = threadPeak;
+  threadPeak = threadLive;
+  threadScopes++;
+}
+
+ptrdiff_t THMemoryStats_scopePeak(const THMemoryScope *scope)
+{
+  return scope->base + threadPeak - scope->start;
+}
+
+ptrdiff_t THMemoryStats_endScope(THMemoryScope *scope)
+{
+  ptrdiff_t peak = THMemoryStats_scopePeak(scope);
+  threadScopes--;
+  threadPeak = scope->outerPeak > threadPeak ? scope->outerPeak : threadPeak;
+  return peak;
+}
+
+void THMemoryStats_setSiteTracking(int enabled)
+{
+  siteTracking = enabled;
+}
+
+int THMemoryStats_siteTracking(void)
+{
+  return siteTracking;
+}
+
+const char* THMemoryStats_setSite(const char *site)
+{
+  const char *previous = threadSite;
+  threadSite = site;
+  return previous;
+}
+
+/* the index-th site in use, or NULL */
+static THMemorySiteSlot* THMemoryStats_siteAt(int index)
+{
+  int i;
+  for(i = 0; i < TH_MEMORY_MAX_SITES; i++) {
+    if(THMemoryStats_slotState(&sites[i].state) == TH_SLOT_READY && index-- == 0)
+      return &sites[i];
+  }
+  return index == 0 && THAtomicGetPtrdiff(&otherSite.allocations) > 0 ? &otherSite : NULL;
+}
+
+int THMemoryStats_numSites(void)
+{
+  int i, n = 0;
+  THMemoryStats_merge();
+  for(i = 0; i < TH_MEMORY_MAX_SITES; i++)
+    n += THMemoryStats_slotState(&sites[i].state) == TH_SLOT_READY;
+  return n + (THAtomicGetPtrdiff(&otherSite.allocations) > 0);
+}
+
+const char* THMemoryStats_site(int index, ptrdiff_t *allocations, ptrdiff_t *bytes)
+{
+  THMemorySiteSlot *slot;
+  THMemoryStats_merge();
+  slot = index >= 0 ? THMemoryStats_siteAt(index) : NULL;
+  THArgCheck(slot != NULL, 1, "no site %d", index);
+  *allocations = THAtomicGetPtrdiff(&slot->allocations);
+  *bytes = THAtomicGetPtrdiff(&slot->bytes);
+  return slot->site;
+}
+
+/* not while other threads allocate */
+void THMemoryStats_resetSites(void)
+{
+  THMemoryThreadStats *stats;
+  int i;
+  THMemoryStats_lock(&threadsLock);
+  for(stats = threads; stats; stats = stats->next) {
+    THMemoryStats_lock(&stats->lock);
+    memset(stats->siteAllocations, 0, sizeof(stats->siteAllocations));
+    memset(stats->siteBytes, 0, sizeof(stats->siteBytes));
+    stats->sitesUsed = 0;
+    THMemoryStats_unlock(&stats->lock);
+  }
+  THMemoryStats_unlock(&threadsLock);
+  for(i = 0; i < TH_MEMORY_MAX_SITES; i++) {
+    sites[i].allocations = 0;
+    sites[i].bytes = 0;
+    sites[i].site = NULL;
+    sites[i].state = TH_SLOT_FREE;
+  }
+  otherSite.allocations = 0;
+  otherSite.bytes = 0;
+}
@@ -0,0 +1,89 @@
+#ifndef TH_MEMORY_STATS_INC
+#define TH_MEMORY_STATS_INC
+
+#include "THAllocator.h"
+
+/* Accounting of the data of CPU storages.
+ *
+ * Every block a storage allocates, adopts or frees through its allocator
+ * is counted: live and peak bytes, and the number of allocations and
+ * frees, in total, by allocator and by scalar type. A buffer shared
+ * copy-on-write is counted once, for the storage it was cloned from.
+ * Storage headers, tensors and the scratch memory of the kernels are not
+ * counted; THHeapUpdate still tracks all of THAlloc for the GC hook.
+ *
+ * The counters are always on. Each thread counts in counters of its own,
+ * which are added to the shared ones in batches and whenever the counters
+ * are read, so that counting takes no atomic operation on shared memory.
+ * The peaks are exact for the allocations of one thread; with several,
+ * those of each thread are counted at the live bytes of the others at the
+ * end of its batch. The histogram of the allocations by site, a label set
+ * by the calling thread, is optional.
+ */
+
+#define TH_MEMORY_TYPE_Byte   0
+#define TH_MEMORY_TYPE_Char   1
+#define TH_MEMORY_TYPE_Short  2
+#define TH_MEMORY_TYPE_Int    3
+#define TH_MEMORY_TYPE_Long   4
+#define TH_MEMORY_TYPE_Float  5
+#define TH_MEMORY_TYPE_Double 6
+#define TH_MEMORY_TYPE_Half   7
+#define TH_MEMORY_NUM_TYPES   8
+
+#define TH_MEMORY_MAX_ALLOCATORS 16
+#define TH_MEMORY_MAX_SITES 256  /* a power of two */
+
+typedef struct THMemoryCounters {
+  ptrdiff_t live;         /* bytes */
+  ptrdiff_t peak;         /* bytes, since the start or the last reset */
+  ptrdiff_t allocations;
+  ptrdiff_t frees;
+} THMemoryCounters;
+
+/* Counts an allocation of bytes (a free when negative) of storage data of
+ * a TH_MEMORY_TYPE_* from allocator. For storages. */
+TH_API void THMemoryStats_record(THAllocator *allocator, int type, ptrdiff_t bytes);
+
+TH_API void THMemoryStats_total(THMemoryCounters *counters);
+TH_API void THMemoryStats_byType(int type, THMemoryCounters *counters);
+/* The allocators seen so far, numbered from 0. The allocators of TH are
+ * named; others are "unnamed" unless registered. */
+TH_API int THMemoryStats_numAllocators(void);
+TH_API const char* THMemoryStats_byAllocator(int index, THMemoryCounters *counters);
+TH_API void THMemoryStats_registerAllocator(THAllocator *allocator, const char *name);
+/* sets all peaks to the live bytes */
+TH_API void THMemoryStats_resetPeak(void);
+
+/* Peak of the live bytes between begin and end, as seen by the calling
+ * thread: the total live bytes at the beginning (less what the other
+ * threads have not added yet), plus the highest that the bytes allocated
+ * less the bytes freed by the thread got since. Scopes nest within a
+ * thread, and end on the thread they began on; the total peak is left
+ * alone. */
+typedef struct THMemoryScope {
+  ptrdiff_t base;       /* total live bytes at the beginning */
+  ptrdiff_t start;      /* bytes of the thread at the beginning */
+  ptrdiff_t outerPeak;  /* of the enclosing scope of the thread */
+} THMemoryScope;
+
+TH_API void THMemoryStats_beginScope(THMemoryScope *scope);
+/* the peak so far of the innermost scope of the thread, in bytes */
+TH_API ptrdiff_t THMemoryStats_scopePeak(const THMemoryScope *scope);
+/* returns the peak of the scope */
+TH_API ptrdiff_t THMemoryStats_endScope(THMemoryScope *scope);
+
+/* Allocation-site histogram: while enabled, the allocations are counted
+ * by the site of the calling thread, a string that has to outlive the
+ * histogram (a literal), or "unknown". Sites are told apart by address,
+ * so a label used from two places may be counted twice. At most
+ * TH_MEMORY_MAX_SITES sites are kept; the others count as "other". */
+TH_API void THMemoryStats_setSiteTracking(int enabled);
+TH_API int THMemoryStats_siteTracking(void);
+/* returns the previous site of the calling thread */
+TH_API const char* THMemoryStats_setSite(const char *site);
+TH_API int THMemoryStats_numSites(void);
+TH_API const char* THMemoryStats_site(int index, ptrdiff_t *allocations, ptrdiff_t *bytes);
+TH_API void THMemoryStats_resetSites(void);
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "THGeneral.h"
 #include "THAllocator.h"
+#include "THArena.h"
+#include "THMemoryStats.h"
 
 #define THStorage        TH_CONCAT_3(TH,Real,Storage)
 #define THStorage_(NAME) TH_CONCAT_4(TH,Real,Storage_,NAME)
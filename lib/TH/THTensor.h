@@ -6,6 +6,7 @@
 
 #define THTensor          TH_CONCAT_3(TH,Real,Tensor)
 #define THTensor_(NAME)   TH_CONCAT_4(TH,Real,Tensor_,NAME)
+#define THTensorView      TH_CONCAT_3(TH,Real,TensorView)
 
 /* basics */
 #include "generic/THTensor.h"
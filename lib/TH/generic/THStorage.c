@@ -12,11 +12,25 @@ ptrdiff_t THStorage_(size)(const THStorage *self)
   return self->size;
 }
 
+ptrdiff_t THStorage_(capacity)(const THStorage *self)
+{
+  return self->capacity;
+}
+
 size_t THStorage_(elementSize)()
 {
   return sizeof(real);
 }
 
+/* The data a storage owns is counted by THMemoryStats, except for shared
+ * copy-on-write buffers, which count for their first owner. */
+static void THStorage_(record)(THStorage *storage, ptrdiff_t capacity)
+{
+  if((storage->flag & TH_STORAGE_FREEMEM) && storage->allocator != &THCopyOnWriteAllocator)
+    THMemoryStats_record(storage->allocator, TH_CONCAT_2(TH_MEMORY_TYPE_, Real),
+                         sizeof(real)*capacity);
+}
+
 THStorage* THStorage_(new)(void)
 {
   return THStorage_(newWithSize)(0);
@@ -24,7 +38,27 @@ THStorage* THStorage_(new)(void)
 
 THStorage* THStorage_(newWithSize)(ptrdiff_t size)
 {
-  return THStorage_(newWithAllocator)(size, &THDefaultAllocator, NULL);
+  if(THArena_active())
+  {
+    /* header and data of temporaries come from the arena */
+    THStorage *storage = THArena_alloc(sizeof(THStorage));
+    storage->data = NULL;
+    storage->size = 0;
+    storage->capacity = 0;
+    storage->refcount = 1;
+    storage->flag = TH_STORAGE_REFCOUNTED | TH_STORAGE_RESIZABLE | TH_STORAGE_FREEMEM | TH_STORAGE_ARENA;
+    storage->allocator = &THArenaAllocator;
+    storage->allocatorContext = storage;
+    if(size > 0)
+    {
+      storage->data = THArenaAllocator.malloc(storage, sizeof(real)*size);
+      storage->size = size;
+      storage->capacity = size;
+      THStorage_(record)(storage, size);
+    }
+    return storage;
+  }
+  return THStorage_(newWithAllocator)(size, THGetStorageAllocator(), NULL);
 }
 
 THStorage* THStorage_(newWithAllocator)(ptrdiff_t size,
@@ -34,10 +68,12 @@ THStorage* THStorage_(newWithAllocator)(ptrdiff_t size,
   THStorage *storage = THAlloc(sizeof(THStorage));
   storage->data = allocator->malloc(allocatorContext, sizeof(real)*size);
   storage->size = size;
+  storage->capacity = size;
   storage->refcount = 1;
   storage->flag = TH_STORAGE_REFCOUNTED | TH_STORAGE_RESIZABLE | TH_STORAGE_FREEMEM;
   storage->allocator = allocator;
   storage->allocatorContext = allocatorContext;
+  THStorage_(record)(storage, size);
   return storage;
 }
 
@@ -49,8 +85,25 @@ THStorage* THStorage_(newWithMapping)(const char *filename, ptrdiff_t size, int
                                                     &THMapAllocator,
                                                     ctx);
 
-  if(size <= 0)
-    storage->size = THMapAllocatorContext_size(ctx)/sizeof(real);
+  if(size <= 0) {
+    storage->size = storage->capacity = THMapAllocatorContext_size(ctx)/sizeof(real);
+    THStorage_(record)(storage, storage->capacity);
+  }
+
+  THStorage_(clearFlag)(storage, TH_STORAGE_RESIZABLE);
+  if(flags & TH_ALLOCATOR_MAPPED_READONLY)
+    THStorage_(setFlag)(storage, TH_STORAGE_READONLY);
+
+  return storage;
+}
+
+THStorage* THStorage_(newWithSharedMemory)(const char *name, ptrdiff_t size, int flags)
+{
+  THMapAllocatorContext *ctx = THMapAllocatorContext_new(name, TH_ALLOCATOR_MAPPED_SHAREDMEM | flags);
+
+  THStorage *storage = THStorage_(newWithAllocator)(size,
+                                                    &THRefcountedMapAllocator,
+                                                    ctx);
 
   THStorage_(clearFlag)(storage, TH_STORAGE_RESIZABLE);
 
@@ -93,11 +146,16 @@ THStorage* THStorage_(newWithSize4)(real data0, real data1, real data2, real dat
 
 void THStorage_(setFlag)(THStorage *storage, const char flag)
 {
+  int owned = storage->flag & TH_STORAGE_FREEMEM;
   storage->flag |= flag;
+  if((flag & TH_STORAGE_FREEMEM) && !owned)
+    THStorage_(record)(storage, storage->capacity);
 }
 
 void THStorage_(clearFlag)(THStorage *storage, const char flag)
 {
+  if(flag & TH_STORAGE_FREEMEM)
+    THStorage_(record)(storage, -storage->capacity);
   storage->flag &= ~flag;
 }
 
@@ -117,12 +175,14 @@ void THStorage_(free)(THStorage *storage)
     if(THAtomicDecrementRef(&storage->refcount))
     {
       if(storage->flag & TH_STORAGE_FREEMEM) {
+        THStorage_(record)(storage, -storage->capacity);
         storage->allocator->free(storage->allocatorContext, storage->data);
       }
       if(storage->flag & TH_STORAGE_VIEW) {
         THStorage_(free)(storage->view);
       }
-      THFree(storage);
+      if(!(storage->flag & TH_STORAGE_ARENA))
+        THFree(storage);
     }
   }
 }
@@ -139,10 +199,12 @@ THStorage* THStorage_(newWithDataAndAllocator)(real* data, ptrdiff_t size,
   THStorage *storage = THAlloc(sizeof(THStorage));
   storage->data = data;
   storage->size = size;
+  storage->capacity = size;
   storage->refcount = 1;
   storage->flag = TH_STORAGE_REFCOUNTED | TH_STORAGE_RESIZABLE | TH_STORAGE_FREEMEM;
   storage->allocator = allocator;
   storage->allocatorContext = allocatorContext;
+  THStorage_(record)(storage, size);
   return storage;
 }
 
@@ -150,6 +212,13 @@ void THStorage_(resize)(THStorage *storage, ptrdiff_t size)
 {
   if(storage->flag & TH_STORAGE_RESIZABLE)
   {
+    if(storage->flag & (TH_STORAGE_COW | TH_STORAGE_READONLY))
+      THStorage_(unshare)(storage);
+    if(size >= storage->size && size <= storage->capacity) {
+      storage->size = size;
+      return;
+    }
+    THStorage_(record)(storage, -storage->capacity);
     if(storage->allocator->realloc == NULL) {
       /* case when the allocator does not have a realloc defined */
       real *old_data = storage->data;
@@ -172,28 +241,121 @@ void THStorage_(resize)(THStorage *storage, ptrdiff_t size)
 	}
 	storage->allocator->free(storage->allocatorContext, old_data);
       }
+      storage->capacity = size;
     } else {
       storage->data = storage->allocator->realloc(
 						  storage->allocatorContext,
 						  storage->data,
 						  sizeof(real)*size);
       storage->size = size;
+      storage->capacity = size;
     }
+    THStorage_(record)(storage, size);
   } else {
     THError("Trying to resize storage that is not resizable");
   }
 }
 
+void THStorage_(reserve)(THStorage *storage, ptrdiff_t capacity)
+{
+  if(capacity <= storage->capacity)
+    return;
+  if(!(storage->flag & TH_STORAGE_RESIZABLE))
+    THError("Trying to reserve storage that is not resizable");
+  if(storage->flag & (TH_STORAGE_COW | TH_STORAGE_READONLY))
+    THStorage_(unshare)(storage);
+
+  THStorage_(record)(storage, capacity - storage->capacity);
+  if(storage->allocator->realloc == NULL) {
+    real *old_data = storage->data;
+    storage->data = storage->allocator->malloc(storage->allocatorContext, sizeof(real)*capacity);
+    if(old_data != NULL) {
+      if(storage->size > 0)
+        memcpy(storage->data, old_data, sizeof(real)*storage->size);
+      storage->allocator->free(storage->allocatorContext, old_data);
+    }
+  } else {
+    storage->data = storage->allocator->realloc(storage->allocatorContext,
+                                                storage->data,
+                                                sizeof(real)*capacity);
+  }
+  storage->capacity = capacity;
+}
+
+/* lets go of shared data without copying it, leaving an empty storage
+ * of the storage allocator */
+static void THStorage_(dropShared)(THStorage *storage)
+{
+  THCopyOnWrite_lock(storage);
+  if(storage->flag & TH_STORAGE_COW) {
+    storage->allocator->free(storage->allocatorContext, storage->data);
+    storage->data = NULL;
+    storage->size = 0;
+    storage->capacity = 0;
+    storage->allocator = THGetStorageAllocator();
+    storage->allocatorContext = NULL;
+    storage->flag &= ~TH_STORAGE_COW;
+  }
+  THCopyOnWrite_unlock(storage);
+}
+
+void THStorage_(resizeAndZero)(THStorage *storage, ptrdiff_t size)
+{
+  real *old_data;
+
+  if(!(storage->flag & TH_STORAGE_RESIZABLE))
+    THError("Trying to resize storage that is not resizable");
+
+  if(storage->flag & TH_STORAGE_COW)
+    THStorage_(dropShared)(storage);
+  old_data = storage->data;
+
+  if(size <= storage->size || size <= storage->capacity) {
+    THStorage_(resize)(storage, size);
+    if(size > 0)
+      memset(storage->data, 0, sizeof(real)*size);
+    return;
+  }
+
+  /* the old data goes first, so that both are never held at once */
+  THStorage_(record)(storage, -storage->capacity);
+  storage->data = NULL;
+  storage->size = 0;
+  storage->capacity = 0;
+  if(old_data != NULL)
+    storage->allocator->free(storage->allocatorContext, old_data);
+
+  if(storage->allocator->calloc) {
+    storage->data = storage->allocator->calloc(storage->allocatorContext, sizeof(real)*size);
+  } else {
+    storage->data = storage->allocator->malloc(storage->allocatorContext, sizeof(real)*size);
+    memset(storage->data, 0, sizeof(real)*size);
+  }
+  storage->size = size;
+  storage->capacity = size;
+  THStorage_(record)(storage, size);
+}
+
 void THStorage_(fill)(THStorage *storage, real value)
 {
   ptrdiff_t i;
+  if(storage->flag & (TH_STORAGE_COW | TH_STORAGE_READONLY))
+    THStorage_(unshare)(storage);
   for(i = 0; i < storage->size; i++)
     storage->data[i] = value;
 }
 
+void THStorage_(prefetch)(THStorage *storage, ptrdiff_t offset, ptrdiff_t size)
+{
+  THArgCheck(offset >= 0 && size >= 0 && offset + size <= storage->size, 2, "out of bounds");
+  THMapAllocator_prefetch(storage->data + offset, sizeof(real)*size);
+}
+
 void THStorage_(set)(THStorage *self, ptrdiff_t idx, real value)
 {
   THArgCheck((idx >= 0) && (idx < self->size), 2, "out of bounds");
+  if(self->flag & (TH_STORAGE_COW | TH_STORAGE_READONLY))
+    THStorage_(unshare)(self);
   self->data[idx] = value;
 }
 
@@ -203,11 +365,132 @@ real THStorage_(get)(const THStorage *self, ptrdiff_t idx)
   return self->data[idx];
 }
 
+int THStorage_(canShare)(const THStorage *self)
+{
+  if(self->flag & TH_STORAGE_COW)
+    return 1;
+  return !(self->flag & (TH_STORAGE_VIEW | TH_STORAGE_ARENA | TH_STORAGE_READONLY)) &&
+         THCopyOnWrite_canShare(self->allocator, self->allocatorContext);
+}
+
+THStorage* THStorage_(newCopyOnWrite)(THStorage *self)
+{
+  THCopyOnWriteContext *ctx, *fresh = NULL;
+  THStorage *storage;
+
+  if(!THStorage_(canShare)(self)) {
+    storage = THStorage_(newWithSize)(self->size);
+    THStorage_(copy)(storage, self);
+    return storage;
+  }
+
+  /* the lock keeps two threads from sharing self for the first time at
+     once, and an unshare from freeing the context before the count goes
+     up; nothing is allocated under it */
+  storage = THAlloc(sizeof(THStorage));
+  for(;;) {
+    THCopyOnWrite_lock(self);
+    if((self->flag & TH_STORAGE_COW) || fresh)
+      break;
+    THCopyOnWrite_unlock(self);
+    fresh = THCopyOnWriteContext_new(NULL, NULL, 0, 0, TH_CONCAT_2(TH_MEMORY_TYPE_, Real));
+  }
+
+  /* the first share hands the data over to a copy-on-write context */
+  if(!(self->flag & TH_STORAGE_COW)) {
+    fresh->allocator = self->allocator;
+    fresh->allocatorContext = self->allocatorContext;
+    fresh->freeData = self->flag & TH_STORAGE_FREEMEM;
+    fresh->bytes = sizeof(real)*self->capacity;
+    self->allocator = &THCopyOnWriteAllocator;
+    self->allocatorContext = fresh;
+    self->flag |= TH_STORAGE_COW | TH_STORAGE_FREEMEM;
+    fresh = NULL;
+  }
+  ctx = self->allocatorContext;
+  THAtomicIncrementRef(&ctx->refcount);
+  storage->data = self->data;
+  storage->size = self->size;
+  THCopyOnWrite_unlock(self);
+  if(fresh)
+    THFree(fresh);
+
+  storage->capacity = storage->size;
+  storage->refcount = 1;
+  storage->flag = TH_STORAGE_REFCOUNTED | TH_STORAGE_RESIZABLE | TH_STORAGE_FREEMEM | TH_STORAGE_COW;
+  storage->allocator = &THCopyOnWriteAllocator;
+  storage->allocatorContext = ctx;
+  storage->view = NULL;
+  return storage;
+}
+
+void THStorage_(unshare)(THStorage *self)
+{
+  THCopyOnWriteContext *ctx;
+  THAllocator *allocator;
+  real *data, *old;
+
+  if(self->flag & TH_STORAGE_READONLY)
+    THError("the storage is mapped read-only and cannot be written; clone it first");
+  if(!(self->flag & TH_STORAGE_COW))
+    return;
+  THCopyOnWrite_lock(self);
+  if(!(self->flag & TH_STORAGE_COW)) {
+    THCopyOnWrite_unlock(self);
+    return;
+  }
+  ctx = self->allocatorContext;
+
+  /* the last sharer takes the data back: nobody else holds the context,
+     and it cannot be shared again while we hold the lock */
+  if(THAtomicGet(&ctx->refcount) == 1) {
+    self->allocator = ctx->allocator;
+    self->allocatorContext = ctx->allocatorContext;
+    self->capacity = ctx->bytes / sizeof(real);
+    if(!ctx->freeData)
+      self->flag &= ~TH_STORAGE_FREEMEM;
+    self->flag &= ~TH_STORAGE_COW;
+    THCopyOnWrite_unlock(self);
+    THFree(ctx);
+    return;
+  }
+
+  /* copied without the lock, which the allocation may leave with an error;
+     self keeps its share of the context meanwhile, so the data stays, and
+     a clone made meanwhile shares it too */
+  THCopyOnWrite_unlock(self);
+  allocator = THGetStorageAllocator();
+  old = self->data;
+  data = NULL;
+  if(self->size > 0) {
+    data = allocator->malloc(NULL, sizeof(real)*self->size);
+    memcpy(data, old, sizeof(real)*self->size);
+  }
+
+  THCopyOnWrite_lock(self);
+  if(!(self->flag & TH_STORAGE_COW) || self->allocatorContext != ctx) {
+    /* unshared by another thread in the meantime */
+    THCopyOnWrite_unlock(self);
+    if(data)
+      allocator->free(NULL, data);
+    return;
+  }
+  self->data = data;
+  self->capacity = self->size;
+  self->allocator = allocator;
+  self->allocatorContext = NULL;
+  self->flag &= ~TH_STORAGE_COW;
+  THCopyOnWrite_unlock(self);
+  THCopyOnWriteAllocator.free(ctx, old);
+  THStorage_(record)(self, self->size);
+}
+
 void THStorage_(swap)(THStorage *storage1, THStorage *storage2)
 {
 #define SWAP(val) { val = storage1->val; storage1->val = storage2->val; storage2->val = val; }
     real *data;
     ptrdiff_t size;
+    ptrdiff_t capacity;
     char flag;
     THAllocator *allocator;
     void *allocatorContext;
@@ -215,8 +498,13 @@ void THStorage_(swap)(THStorage *storage1, THStorage *storage2)
 
     SWAP(data);
     SWAP(size);
+    SWAP(capacity);
     SWAP(flag);
-    // don't swap refcount!
+    // don't swap refcount, nor where the headers live!
+    if((storage1->flag ^ storage2->flag) & TH_STORAGE_ARENA) {
+      storage1->flag ^= TH_STORAGE_ARENA;
+      storage2->flag ^= TH_STORAGE_ARENA;
+    }
     SWAP(allocator);
     SWAP(allocatorContext);
     SWAP(view);
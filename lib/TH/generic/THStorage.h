@@ -20,11 +20,15 @@
 #define TH_STORAGE_RESIZABLE  2
 #define TH_STORAGE_FREEMEM    4
 #define TH_STORAGE_VIEW       8
+#define TH_STORAGE_ARENA     16  /* the header is in a THArena scope */
+#define TH_STORAGE_COW       32  /* the data is shared copy-on-write */
+#define TH_STORAGE_READONLY  64  /* the data is mapped read-only */
 
 typedef struct THStorage
 {
     real *data;
     ptrdiff_t size;
+    ptrdiff_t capacity;  /* elements data has room for, at least size */
     int refcount;
     char flag;
     THAllocator *allocator;
@@ -34,6 +38,7 @@ typedef struct THStorage
 
 TH_API real* THStorage_(data)(const THStorage*);
 TH_API ptrdiff_t THStorage_(size)(const THStorage*);
+TH_API ptrdiff_t THStorage_(capacity)(const THStorage*);
 TH_API size_t THStorage_(elementSize)(void);
 
 /* slow access -- checks everything */
@@ -46,7 +51,13 @@ TH_API THStorage* THStorage_(newWithSize1)(real);
 TH_API THStorage* THStorage_(newWithSize2)(real, real);
 TH_API THStorage* THStorage_(newWithSize3)(real, real, real);
 TH_API THStorage* THStorage_(newWithSize4)(real, real, real, real);
+/* maps all of the file when size is 0; flags are TH_ALLOCATOR_MAPPED_* */
 TH_API THStorage* THStorage_(newWithMapping)(const char *filename, ptrdiff_t size, int flags);
+/* size elements of the shared memory object name, with
+ * THRefcountedMapAllocator: the object is removed when the last process
+ * mapping it frees it. flags may add TH_ALLOCATOR_MAPPED_EXCLUSIVE (create
+ * it) or TH_ALLOCATOR_MAPPED_NOCREATE (open an existing one). */
+TH_API THStorage* THStorage_(newWithSharedMemory)(const char *name, ptrdiff_t size, int flags);
 
 /* takes ownership of data */
 TH_API THStorage* THStorage_(newWithData)(real *data, ptrdiff_t size);
@@ -65,7 +76,27 @@ TH_API void THStorage_(swap)(THStorage *storage1, THStorage *storage2);
 
 /* might differ with other API (like CUDA) */
 TH_API void THStorage_(free)(THStorage *storage);
+/* grows within the capacity without reallocating; otherwise reallocates
+ * to exactly size */
 TH_API void THStorage_(resize)(THStorage *storage, ptrdiff_t size);
+/* makes room for capacity elements, keeping the size and the contents */
+TH_API void THStorage_(reserve)(THStorage *storage, ptrdiff_t capacity);
+/* resize to zeros: the contents are dropped instead of being copied, and a
+ * storage that grows gets zeroed memory from its allocator */
+TH_API void THStorage_(resizeAndZero)(THStorage *storage, ptrdiff_t size);
 TH_API void THStorage_(fill)(THStorage *storage, real value);
+/* starts reading in the size elements from offset, of a mapped storage
+ * (see THMapAllocator_prefetch); returns without waiting for them */
+TH_API void THStorage_(prefetch)(THStorage *storage, ptrdiff_t offset, ptrdiff_t size);
+
+/* Copy-on-write: returns a storage with the contents of self that shares
+ * its data until either of them is unshared (or resized). Storages which
+ * cannot share theirs (views, arena storages, shared or read-only mappings)
+ * are copied. Whoever writes to the data of a storage that may be shared
+ * calls unshare first, which copies it if it is still shared, and raises an
+ * error if the storage is read-only. */
+TH_API THStorage* THStorage_(newCopyOnWrite)(THStorage *self);
+TH_API int THStorage_(canShare)(const THStorage *self);
+TH_API void THStorage_(unshare)(THStorage *self);
 
 #endif
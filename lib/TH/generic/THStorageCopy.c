@@ -5,6 +5,7 @@
 void THStorage_(rawCopy)(THStorage *storage, real *src)
 {
   ptrdiff_t i;
+  THStorage_(unshare)(storage);
   for(i = 0; i < storage->size; i++)
     storage->data[i] = src[i];
 }
@@ -19,6 +20,7 @@ void THStorage_(copy)(THStorage *storage, THStorage *src)
 void THStorage_(copy##TYPENAMESRC)(THStorage *storage, TH##TYPENAMESRC##Storage *src) \
 { \
   ptrdiff_t i;                                                        \
+  THStorage_(unshare)(storage);                                       \
   for(i = 0; i < storage->size; i++)                                  \
     storage->data[i] = (real)src->data[i];                            \
 }
@@ -28,6 +30,7 @@ void THStorage_(copy##TYPENAMESRC)(THStorage *storage, TH##TYPENAMESRC##Storage
 { \
   THArgCheck(storage->size == src->size, 2, "size mismatch"); \
   ptrdiff_t i;								\
+  THStorage_(unshare)(storage);						\
   for(i = 0; i < storage->size; i++)					\
     storage->data[i] = (real)TH_half2float(src->data[i]);		\
 }
@@ -37,6 +40,7 @@ void THStorage_(copy##TYPENAMESRC)(THStorage *storage, TH##TYPENAMESRC##Storage
 { \
   THArgCheck(storage->size == src->size, 2, "size mismatch"); \
   ptrdiff_t i;								\
+  THStorage_(unshare)(storage);						\
   for(i = 0; i < storage->size; i++)					\
     storage->data[i] = TH_float2half((float)(src->data[i]));		\
 }
@@ -46,6 +50,7 @@ void THStorage_(copy##TYPENAMESRC)(THStorage *storage, TH##TYPENAMESRC##Storage
 { \
   THArgCheck(storage->size == src->size, 2, "size mismatch"); \
   ptrdiff_t i;								\
+  THStorage_(unshare)(storage);						\
   for(i = 0; i < storage->size; i++)					\
     storage->data[i] = src->data[i];		\
 }
@@ -67,21 +67,36 @@ void THTensor_(clearFlag)(THTensor *self, const char flag)
 /**** creation methods ****/
 
 static void THTensor_(rawInit)(THTensor *self);
+static void THTensor_(reallocDims)(THTensor *self, int nDimension);
 
+/* Headers of temporaries come from the arena */
+static THTensor *THTensor_(newHeader)(void)
+{
+  THTensor *self;
+  if(THArena_active())
+  {
+    self = THArena_alloc(sizeof(THTensor));
+    THTensor_(rawInit)(self);
+    self->flag |= TH_TENSOR_ARENA;
+  }
+  else
+  {
+    self = THAlloc(sizeof(THTensor));
+    THTensor_(rawInit)(self);
+  }
+  return self;
+}
 
 /* Empty init */
 THTensor *THTensor_(new)(void)
 {
-  THTensor *self = THAlloc(sizeof(THTensor));
-  THTensor_(rawInit)(self);
-  return self;
+  return THTensor_(newHeader)();
 }
 
 /* Pointer-copy init */
 THTensor *THTensor_(newWithTensor)(THTensor *tensor)
 {
-  THTensor *self = THAlloc(sizeof(THTensor));
-  THTensor_(rawInit)(self);
+  THTensor *self = THTensor_(newHeader)();
   THTensor_(setStorageNd)(self,
                           tensor->storage,
                           tensor->storageOffset,
@@ -94,11 +109,11 @@ THTensor *THTensor_(newWithTensor)(THTensor *tensor)
 /* Storage init */
 THTensor *THTensor_(newWithStorage)(THStorage *storage, ptrdiff_t storageOffset, THLongStorage *size, THLongStorage *stride)
 {
-  THTensor *self = THAlloc(sizeof(THTensor));
+  THTensor *self;
   if(size && stride)
     THArgCheck(size->size == stride->size, 4, "inconsistent size");
 
-  THTensor_(rawInit)(self);
+  self = THTensor_(newHeader)();
 #ifdef DEBUG
   THAssert((size ? size->size : (stride ? stride->size : 0)) <= INT_MAX);
 #endif
@@ -141,8 +156,7 @@ THTensor *THTensor_(newWithStorage4d)(THStorage *storage, ptrdiff_t storageOffse
   long size[4] = {size0, size1, size2, size3};
   long stride[4] = {stride0, stride1, stride2, stride3};
 
-  THTensor *self = THAlloc(sizeof(THTensor));
-  THTensor_(rawInit)(self);
+  THTensor *self = THTensor_(newHeader)();
   THTensor_(setStorageNd)(self, storage, storageOffset, 4, size, stride);
 
   return self;
@@ -172,8 +186,7 @@ THTensor *THTensor_(newWithSize4d)(long size0, long size1, long size2, long size
 {
   long size[4] = {size0, size1, size2, size3};
 
-  THTensor *self = THAlloc(sizeof(THTensor));
-  THTensor_(rawInit)(self);
+  THTensor *self = THTensor_(newHeader)();
   THTensor_(resizeNd)(self, 4, size, NULL);
 
   return self;
@@ -187,6 +200,54 @@ THTensor *THTensor_(newClone)(THTensor *self)
   return tensor;
 }
 
+THTensor *THTensor_(newCopyOnWrite)(THTensor *self)
+{
+  THTensor *tensor;
+  THStorage *storage;
+
+  /* sharing a storage only part of which is cloned would keep all of it
+   * alive and copy all of it on the first write */
+  if(!THGetCopyOnWriteClone() || !self->storage || self->storageOffset != 0 ||
+     THTensor_(nElement)(self) == 0 ||
+     THTensor_(nElement)(self) != self->storage->size ||
+     !THTensor_(isContiguous)(self) || !THStorage_(canShare)(self->storage))
+    return THTensor_(newClone)(self);
+
+  storage = THStorage_(newCopyOnWrite)(self->storage);
+  tensor = THTensor_(newHeader)();
+  THTensor_(setStorageNd)(tensor, storage, 0, self->nDimension, self->size, self->stride);
+  THStorage_(free)(storage);
+  return tensor;
+}
+
+void THTensor_(unshare)(THTensor *self)
+{
+  if(self->storage && (self->storage->flag & (TH_STORAGE_COW | TH_STORAGE_READONLY)))
+    THStorage_(unshare)(self->storage);
+}
+
+void THTensor_(prefetch)(THTensor *self, long index, long count)
+{
+  ptrdiff_t first, last;
+  int d;
+
+  THArgCheck(self->nDimension > 0, 1, "cannot prefetch slices of an empty tensor");
+  THArgCheck(index >= 0 && count >= 0 && index + count <= self->size[0], 2, "out of range");
+  if(count == 0)
+    return;
+
+  /* all the data of the slices lies within [first, last] */
+  first = self->storageOffset + index*self->stride[0];
+  last = first + (count-1)*self->stride[0];
+  for(d = 1; d < self->nDimension; d++)
+  {
+    if(self->size[d] == 0)
+      return;
+    last += (self->size[d]-1)*self->stride[d];
+  }
+  THStorage_(prefetch)(self->storage, first, last - first + 1);
+}
+
 THTensor *THTensor_(newContiguous)(THTensor *self)
 {
   if(!THTensor_(isContiguous)(self))
@@ -237,6 +298,60 @@ THTensor *THTensor_(newView)(THTensor *tensor, THLongStorage *size)
   return self;
 }
 
+/* Stack views */
+THTensor *THTensor_(viewWithStorage)(THTensorView *view, THStorage *storage, ptrdiff_t storageOffset,
+                                     int nDimension, long *size, long *stride)
+{
+  THTensor *self = &view->tensor;
+  if(storageOffset < 0)
+    THError("Tensor: invalid storage offset");
+  self->size = view->size;
+  self->stride = view->stride;
+  self->nDimension = 0;
+  self->storage = storage;
+  self->storageOffset = storageOffset;
+  self->refcount = 0;
+  self->flag = TH_TENSOR_VIEW;
+  THTensor_(resizeNd)(self, nDimension, size, stride);
+  return self;
+}
+
+THTensor *THTensor_(viewWithStorage2d)(THTensorView *view, THStorage *storage, ptrdiff_t storageOffset,
+                                       long size0, long stride0,
+                                       long size1, long stride1)
+{
+  long size[2] = {size0, size1};
+  long stride[2] = {stride0, stride1};
+  return THTensor_(viewWithStorage)(view, storage, storageOffset, 2, size, stride);
+}
+
+THTensor *THTensor_(viewOf)(THTensorView *view, THTensor *tensor)
+{
+  return THTensor_(viewWithStorage)(view, tensor->storage, tensor->storageOffset,
+                                    tensor->nDimension, tensor->size, tensor->stride);
+}
+
+THTensor *THTensor_(viewSelect)(THTensorView *view, THTensor *tensor, int dimension, long sliceIndex)
+{
+  THTensor *self = THTensor_(viewOf)(view, tensor);
+  THTensor_(select)(self, NULL, dimension, sliceIndex);
+  return self;
+}
+
+THTensor *THTensor_(viewNarrow)(THTensorView *view, THTensor *tensor, int dimension, long firstIndex, long size)
+{
+  THTensor *self = THTensor_(viewOf)(view, tensor);
+  THTensor_(narrow)(self, NULL, dimension, firstIndex, size);
+  return self;
+}
+
+THTensor *THTensor_(viewTranspose)(THTensorView *view, THTensor *tensor, int dimension1, int dimension2)
+{
+  THTensor *self = THTensor_(viewOf)(view, tensor);
+  THTensor_(transpose)(self, NULL, dimension1, dimension2);
+  return self;
+}
+
 /* Resize */
 void THTensor_(resize)(THTensor *self, THLongStorage *size, THLongStorage *stride)
 {
@@ -285,6 +400,58 @@ void THTensor_(resize5d)(THTensor *self, long size0, long size1, long size2, lon
   THTensor_(resizeNd)(self, 5, size, NULL);
 }
 
+void THTensor_(append)(THTensor *self, THTensor *src)
+{
+  THTensorView view;
+  long rows, rowSize;
+  ptrdiff_t needed;
+  int d;
+
+  if(src->nDimension == 0)
+    return;
+  if(self->nDimension == 0)
+  {
+    THTensor_(resizeAs)(self, src);
+    THTensor_(copy)(self, src);
+    return;
+  }
+
+  THArgCheck(self->nDimension == src->nDimension, 2, "appending a %dD tensor to a %dD tensor",
+             src->nDimension, self->nDimension);
+  for(d = 1; d < self->nDimension; d++)
+    THArgCheck(self->size[d] == src->size[d], 2, "size mismatch in dimension %d: %ld and %ld",
+               d + TH_INDEX_BASE, self->size[d], src->size[d]);
+  THArgCheck(THTensor_(isContiguous)(self), 1, "tensor must be contiguous");
+
+  rows = self->size[0];
+  rowSize = THTensor_(nElement)(self) / rows;
+  /* a view, or a tensor whose storage other tensors hold, would write over
+   * what lies past it: it is moved to a storage of its own first */
+  if(self->storageOffset + rows * rowSize != self->storage->size ||
+     THAtomicGet(&self->storage->refcount) != 1)
+  {
+    THTensor *old = THTensor_(newWithTensor)(self);
+    THStorage *storage = THStorage_(newWithSize)(0);
+    THStorage_(reserve)(storage, (rows + src->size[0]) * rowSize);
+    THTensor_(setStorageNd)(self, storage, 0, old->nDimension, old->size, NULL);
+    THStorage_(free)(storage);
+    THTensor_(copy)(self, old);
+    THTensor_(free)(old);
+  }
+
+  /* the storage grows by half when it is full, so that appending n rows
+   * one by one copies each element a constant number of times on average */
+  needed = self->storageOffset + (rows + src->size[0]) * rowSize;
+  if(needed > self->storage->capacity)
+    THStorage_(reserve)(self->storage, THMax(needed, self->storage->capacity + self->storage->capacity / 2));
+  if(needed > self->storage->size)
+    THStorage_(resize)(self->storage, needed);
+  self->size[0] = rows + src->size[0];
+  self->stride[0] = rowSize;
+
+  THTensor_(copy)(THTensor_(viewNarrow)(&view, self, 0, rows, src->size[0]), src);
+}
+
 THTensor* THTensor_(newExpand)(THTensor *tensor, THLongStorage *sizes) {
   THTensor *result = THTensor_(new)();
   THTensor_(expand)(result, tensor, sizes);
@@ -492,10 +659,6 @@ void THTensor_(transpose)(THTensor *self, THTensor *src, int dimension1, int dim
 
 void THTensor_(unfold)(THTensor *self, THTensor *src, int dimension, long size, long step)
 {
-  long *newSize;
-  long *newStride;
-  int d;
-
   if(!src)
     src = self;
 
@@ -506,30 +669,12 @@ void THTensor_(unfold)(THTensor *self, THTensor *src, int dimension, long size,
 
   THTensor_(set)(self, src);
 
-  newSize = THAlloc(sizeof(long)*(self->nDimension+1));
-  newStride = THAlloc(sizeof(long)*(self->nDimension+1));
+  THTensor_(reallocDims)(self, self->nDimension+1);
 
-  newSize[self->nDimension] = size;
-  newStride[self->nDimension] = self->stride[dimension];
-  for(d = 0; d < self->nDimension; d++)
-  {
-    if(d == dimension)
-    {
-      newSize[d] = (self->size[d] - size) / step + 1;
-      newStride[d] = step*self->stride[d];
-    }
-    else
-    {
-      newSize[d] = self->size[d];
-      newStride[d] = self->stride[d];
-    }
-  }
-
-  THFree(self->size);
-  THFree(self->stride);
-
-  self->size = newSize;
-  self->stride = newStride;
+  self->size[self->nDimension] = size;
+  self->stride[self->nDimension] = self->stride[dimension];
+  self->size[dimension] = (self->size[dimension] - size) / step + 1;
+  self->stride[dimension] = step*self->stride[dimension];
   self->nDimension++;
 }
 
@@ -601,8 +746,7 @@ void THTensor_(unsqueeze1d)(THTensor *self, THTensor *src, int dimension)
 
   THTensor_(set)(self, src);
 
-  self->size = (long*)THRealloc(self->size, sizeof(long)*(self->nDimension+1));
-  self->stride = (long*)THRealloc(self->stride, sizeof(long)*(self->nDimension+1));
+  THTensor_(reallocDims)(self, self->nDimension+1);
   self->nDimension++;
   for (d = self->nDimension-1; d > dimension; d--) {
     self->size[d] = self->size[d-1];
@@ -732,11 +876,15 @@ void THTensor_(free)(THTensor *self)
   {
     if(THAtomicDecrementRef(&self->refcount))
     {
-      THFree(self->size);
-      THFree(self->stride);
+      if(!(self->flag & TH_TENSOR_ARENA_DIMS))
+      {
+        THFree(self->size);
+        THFree(self->stride);
+      }
       if(self->storage)
         THStorage_(free)(self->storage);
-      THFree(self);
+      if(!(self->flag & TH_TENSOR_ARENA))
+        THFree(self);
     }
   }
 }
@@ -762,11 +910,67 @@ static void THTensor_(rawInit)(THTensor *self)
   self->flag = TH_TENSOR_REFCOUNTED;
 }
 
+/* Reallocates size and stride for nDimension dimensions, keeping the
+ * current ones. They are in the arena while the header is in the innermost
+ * scope, and move to the heap otherwise. */
+static void THTensor_(reallocDims)(THTensor *self, int nDimension)
+{
+  long *size, *stride;
+  int inArena, keep;
+
+  /* views have room for TH_TENSOR_VIEW_MAX_DIM dimensions */
+  if(self->flag & TH_TENSOR_VIEW)
+  {
+    if(nDimension > TH_TENSOR_VIEW_MAX_DIM)
+      THError("Tensor: a tensor view has at most %d dimensions", TH_TENSOR_VIEW_MAX_DIM);
+    return;
+  }
+
+  inArena = (self->flag & TH_TENSOR_ARENA) && THArena_owns(self);
+  keep = (self->nDimension < nDimension ? self->nDimension : nDimension);
+
+  if(!inArena && !(self->flag & TH_TENSOR_ARENA_DIMS))
+  {
+    self->size = THRealloc(self->size, sizeof(long)*nDimension);
+    self->stride = THRealloc(self->stride, sizeof(long)*nDimension);
+    return;
+  }
+
+  if(inArena)
+  {
+    size = THArena_alloc(sizeof(long)*nDimension);
+    stride = THArena_alloc(sizeof(long)*nDimension);
+  }
+  else
+  {
+    size = THAlloc(sizeof(long)*nDimension);
+    stride = THAlloc(sizeof(long)*nDimension);
+  }
+  if(keep > 0)
+  {
+    memcpy(size, self->size, sizeof(long)*keep);
+    memcpy(stride, self->stride, sizeof(long)*keep);
+  }
+  if(!(self->flag & TH_TENSOR_ARENA_DIMS))
+  {
+    THFree(self->size);
+    THFree(self->stride);
+  }
+  self->size = size;
+  self->stride = stride;
+  if(inArena)
+    self->flag |= TH_TENSOR_ARENA_DIMS;
+  else
+    self->flag &= ~TH_TENSOR_ARENA_DIMS;
+}
+
 void THTensor_(setStorageNd)(THTensor *self, THStorage *storage, ptrdiff_t storageOffset, int nDimension, long *size, long *stride)
 {
   /* storage */
   if(self->storage != storage)
   {
+    if(self->flag & TH_TENSOR_VIEW)
+      THError("Tensor: cannot change the storage of a tensor view");
     if(self->storage)
       THStorage_(free)(self->storage);
 
@@ -788,7 +992,9 @@ void THTensor_(setStorageNd)(THTensor *self, THStorage *storage, ptrdiff_t stora
   THTensor_(resizeNd)(self, nDimension, size, stride);
 }
 
-void THTensor_(resizeNd)(THTensor *self, int nDimension, long *size, long *stride)
+/* With forZero, a tensor that covers its whole storage when it grows gets
+ * a zeroed one in place of its contents; returns whether that happened. */
+static int THTensor_(resizeNdInternal)(THTensor *self, int nDimension, long *size, long *stride, int forZero)
 {
   int d;
   int nDimension_;
@@ -816,14 +1022,13 @@ void THTensor_(resizeNd)(THTensor *self, int nDimension, long *size, long *strid
     hascorrectsize = 0;
 
   if(hascorrectsize)
-    return;
+    return 0;
 
   if(nDimension > 0)
   {
     if(nDimension != self->nDimension)
     {
-      self->size = THRealloc(self->size, sizeof(long)*nDimension);
-      self->stride = THRealloc(self->stride, sizeof(long)*nDimension);
+      THTensor_(reallocDims)(self, nDimension);
       self->nDimension = nDimension;
     }
 
@@ -846,13 +1051,39 @@ void THTensor_(resizeNd)(THTensor *self, int nDimension, long *size, long *strid
     if(totalSize+self->storageOffset > 0)
     {
       if(!self->storage)
-        self->storage = THStorage_(new)();
+      {
+        if(self->flag & TH_TENSOR_VIEW)
+          THError("Tensor: a tensor view has no storage to resize");
+        /* a tensor from outside of the arena scope keeps its data outside */
+        if(THArena_active() && !((self->flag & TH_TENSOR_ARENA) && THArena_owns(self)))
+          self->storage = THStorage_(newWithAllocator)(0, THGetStorageAllocator(), NULL);
+        else
+          self->storage = THStorage_(new)();
+      }
       if(totalSize+self->storageOffset > self->storage->size)
+      {
+        if(forZero && !stride && self->storageOffset == 0)
+        {
+          THStorage_(resizeAndZero)(self->storage, totalSize);
+          return 1;
+        }
         THStorage_(resize)(self->storage, totalSize+self->storageOffset);
+      }
     }
   }
   else
     self->nDimension = 0;
+  return 0;
+}
+
+void THTensor_(resizeNd)(THTensor *self, int nDimension, long *size, long *stride)
+{
+  THTensor_(resizeNdInternal)(self, nDimension, size, stride, 0);
+}
+
+int THTensor_(resizeNdForZero)(THTensor *self, int nDimension, long *size, long *stride)
+{
+  return THTensor_(resizeNdInternal)(self, nDimension, size, stride, 1);
 }
 
 void THTensor_(set1d)(THTensor *tensor, long x0, real value)
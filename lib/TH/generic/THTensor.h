@@ -5,6 +5,8 @@
 /* a la lua? dim, storageoffset, ...  et les methodes ? */
 
 #define TH_TENSOR_REFCOUNTED 1
+#define TH_TENSOR_ARENA      2  /* the header is in a THArena scope */
+#define TH_TENSOR_ARENA_DIMS 4  /* so are size and stride */
 
 typedef struct THTensor
 {
@@ -22,6 +24,24 @@ typedef struct THTensor
 
 } THTensor;
 
+#define TH_TENSOR_VIEW       8  /* size and stride belong to a THTensorView */
+#define TH_TENSOR_VIEW_MAX_DIM 8
+
+/* A tensor view that lives on the stack: the THTensor it holds is not
+ * refcounted and does not retain its storage, so that setting it up costs
+ * no allocation. Fill it with one of the THTensor_(view*) functions and
+ * pass the THTensor* they return to any function taking a tensor; freeing
+ * or retaining it does nothing. It must not outlive the storage it looks
+ * at. It can be resized in place up to TH_TENSOR_VIEW_MAX_DIM dimensions,
+ * but not given another storage.
+ */
+typedef struct THTensorView
+{
+    THTensor tensor;
+    long size[TH_TENSOR_VIEW_MAX_DIM];
+    long stride[TH_TENSOR_VIEW_MAX_DIM];
+} THTensorView;
+
 
 /**** access methods ****/
 TH_API THStorage* THTensor_(storage)(const THTensor *self);
@@ -65,6 +85,15 @@ TH_API THTensor *THTensor_(newWithSize3d)(long size0_, long size1_, long size2_)
 TH_API THTensor *THTensor_(newWithSize4d)(long size0_, long size1_, long size2_, long size3_);
 
 TH_API THTensor *THTensor_(newClone)(THTensor *self);
+/* Like newClone, but while THSetCopyOnWriteClone(1) is in effect a
+ * contiguous tensor covering its whole storage is not copied: the clone
+ * shares the storage copy-on-write (see THStorage_(newCopyOnWrite)).
+ * Writers of the data of either tensor call unshare first. */
+TH_API THTensor *THTensor_(newCopyOnWrite)(THTensor *self);
+TH_API void THTensor_(unshare)(THTensor *self);
+/* starts reading in the data of the slices [index, index+count) of the
+ * first dimension, for tensors on mapped files (see THStorage_(prefetch)) */
+TH_API void THTensor_(prefetch)(THTensor *self, long index, long count);
 TH_API THTensor *THTensor_(newContiguous)(THTensor *tensor);
 TH_API THTensor *THTensor_(newSelect)(THTensor *tensor, int dimension_, long sliceIndex_);
 TH_API THTensor *THTensor_(newNarrow)(THTensor *tensor, int dimension_, long firstIndex_, long size_);
@@ -73,17 +102,37 @@ TH_API THTensor *THTensor_(newUnfold)(THTensor *tensor, int dimension_, long siz
 TH_API THTensor *THTensor_(newView)(THTensor *tensor, THLongStorage *size);
 TH_API THTensor *THTensor_(newExpand)(THTensor *tensor, THLongStorage *size);
 
+/* stack views, see THTensorView */
+TH_API THTensor *THTensor_(viewWithStorage)(THTensorView *view, THStorage *storage, ptrdiff_t storageOffset,
+                                            int nDimension, long *size, long *stride);
+TH_API THTensor *THTensor_(viewWithStorage2d)(THTensorView *view, THStorage *storage, ptrdiff_t storageOffset,
+                                              long size0_, long stride0_,
+                                              long size1_, long stride1_);
+TH_API THTensor *THTensor_(viewOf)(THTensorView *view, THTensor *tensor);
+TH_API THTensor *THTensor_(viewSelect)(THTensorView *view, THTensor *tensor, int dimension_, long sliceIndex_);
+TH_API THTensor *THTensor_(viewNarrow)(THTensorView *view, THTensor *tensor, int dimension_, long firstIndex_, long size_);
+TH_API THTensor *THTensor_(viewTranspose)(THTensorView *view, THTensor *tensor, int dimension1_, int dimension2_);
+
 TH_API void THTensor_(expand)(THTensor *r, THTensor *tensor, THLongStorage *size);
 TH_API void THTensor_(expandNd)(THTensor **rets, THTensor **ops, int count);
 
 TH_API void THTensor_(resize)(THTensor *tensor, THLongStorage *size, THLongStorage *stride);
 TH_API void THTensor_(resizeAs)(THTensor *tensor, THTensor *src);
 TH_API void THTensor_(resizeNd)(THTensor *tensor, int nDimension, long *size, long *stride);
+/* resizeNd for a tensor about to be zeroed: a contiguous tensor whose
+ * storage has to grow gets zeroed memory rather than a copy of its old
+ * contents. Returns whether the tensor is zero already. */
+TH_API int THTensor_(resizeNdForZero)(THTensor *tensor, int nDimension, long *size, long *stride);
 TH_API void THTensor_(resize1d)(THTensor *tensor, long size0_);
 TH_API void THTensor_(resize2d)(THTensor *tensor, long size0_, long size1_);
 TH_API void THTensor_(resize3d)(THTensor *tensor, long size0_, long size1_, long size2_);
 TH_API void THTensor_(resize4d)(THTensor *tensor, long size0_, long size1_, long size2_, long size3_);
 TH_API void THTensor_(resize5d)(THTensor *tensor, long size0_, long size1_, long size2_, long size3_, long size4_);
+/* appends src along the first dimension, in amortized constant time per
+ * element: the storage is grown geometrically, see THStorage_(reserve).
+ * A tensor which does not end its storage, or whose storage is shared with
+ * other tensors, is first moved to a storage of its own. */
+TH_API void THTensor_(append)(THTensor *tensor, THTensor *src);
 
 TH_API void THTensor_(set)(THTensor *self, THTensor *src);
 TH_API void THTensor_(setStorage)(THTensor *self, THStorage *storage_, ptrdiff_t storageOffset_, THLongStorage *size_, THLongStorage *stride_);
@@ -1915,8 +1915,29 @@ void THTensor_(cminValue)(THTensor *r, THTensor *t, real value) {
 
 void THTensor_(zeros)(THTensor *r_, THLongStorage *size)
 {
-  THTensor_(resize)(r_, size, NULL);
-  THTensor_(zero)(r_);
+  THTensor_(resizeAndZero)(r_, size, NULL);
+}
+
+void THTensor_(resizeAndZeroNd)(THTensor *r_, int nDimension, long *size, long *stride)
+{
+  if(!THTensor_(resizeNdForZero)(r_, nDimension, size, stride))
+    THTensor_(zero)(r_);
+}
+
+void THTensor_(resizeAndZero)(THTensor *r_, THLongStorage *size, THLongStorage *stride)
+{
+  THArgCheck(size != NULL, 2, "invalid size");
+  if(stride)
+    THArgCheck(stride->size == size->size, 3, "invalid stride");
+  THTensor_(resizeAndZeroNd)(r_, size->size, size->data, (stride ? stride->data : NULL));
+}
+
+void THTensor_(resizeAsAndZero)(THTensor *r_, THTensor *src)
+{
+  if(THTensor_(isSameSizeAs)(r_, src))
+    THTensor_(zero)(r_);
+  else
+    THTensor_(resizeAndZeroNd)(r_, src->nDimension, src->size, NULL);
 }
 
 void THTensor_(ones)(THTensor *r_, THLongStorage *size)
@@ -1935,13 +1956,13 @@ void THTensor_(diag)(THTensor *r_, THTensor *t, int k)
     long t_stride_0 = THTensor_(stride)(t, 0);
     long t_size = THTensor_(size)(t, 0);
     long sz = t_size + (k >= 0 ? k : -k);
+    long r__size[2] = {sz, sz};
     real *r__data;
     long r__stride_0;
     long r__stride_1;
     long i;
 
-    THTensor_(resize2d)(r_, sz, sz);
-    THTensor_(zero)(r_);
+    THTensor_(resizeAndZeroNd)(r_, 2, r__size, NULL);
     r__data = THTensor_(data)(r_);
     r__stride_0 = THTensor_(stride)(r_, 0);
     r__stride_1 = THTensor_(stride)(r_, 1);
@@ -1978,14 +1999,16 @@ void THTensor_(eye)(THTensor *r_, long n, long m)
 {
   real *r__data;
   long i, sz;
+  long r__size[2];
 
   THArgCheck(n > 0, 1, "invalid argument");
 
   if(m <= 0)
     m = n;
 
-  THTensor_(resize2d)(r_, n, m);
-  THTensor_(zero)(r_);
+  r__size[0] = n;
+  r__size[1] = m;
+  THTensor_(resizeAndZeroNd)(r_, 2, r__size, NULL);
 
   i = 0;
   r__data = THTensor_(data)(r_);
@@ -3211,8 +3234,7 @@ void THTensor_(histc)(THTensor *hist, THTensor *tensor, long nbins, real minvalu
   real maxval;
   real *h_data;
 
-  THTensor_(resize1d)(hist, nbins);
-  THTensor_(zero)(hist);
+  THTensor_(resizeAndZeroNd)(hist, 1, &nbins, NULL);
   minval = minvalue;
   maxval = maxvalue;
   if (minval == maxval)
@@ -90,6 +90,10 @@ TH_API void THTensor_(cmaxValue)(THTensor *r, THTensor *t, real value);
 TH_API void THTensor_(cminValue)(THTensor *r, THTensor *t, real value);
 
 TH_API void THTensor_(zeros)(THTensor *r_, THLongStorage *size);
+/* resize then zero; the zeros of a storage that grows are allocated lazily */
+TH_API void THTensor_(resizeAndZero)(THTensor *r_, THLongStorage *size, THLongStorage *stride);
+TH_API void THTensor_(resizeAndZeroNd)(THTensor *r_, int nDimension, long *size, long *stride);
+TH_API void THTensor_(resizeAsAndZero)(THTensor *r_, THTensor *src);
 TH_API void THTensor_(ones)(THTensor *r_, THLongStorage *size);
 TH_API void THTensor_(diag)(THTensor *r_, THTensor *t, int k);
 TH_API void THTensor_(eye)(THTensor *r_, long n, long m);
@@ -8,7 +8,9 @@ void THNN_(Abs_updateOutput)(
           THTensor *output)
 {
   THTensor_(resizeAs)(output, input);
-  THTensor_(abs)(output, input);
+  THNN_TENSOR_APPLY2(real, output, real, input,
+    *output_data = fabs(*input_data);
+  );
 }
 
 void THNN_(Abs_updateGradInput)(
@@ -19,7 +21,7 @@ void THNN_(Abs_updateGradInput)(
 {
   THNN_CHECK_NELEMENT(input, gradOutput);
   THTensor_(resizeAs)(gradInput, input);
-  TH_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, input,
+  THNN_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, input,
     real z = *input_data;
     *gradInput_data = *gradOutput_data * (z >= 0 ? 1 : -1);
   );
@@ -9,9 +9,9 @@ void THNN_(AbsCriterion_updateOutput)(
           THTensor *output,
           bool sizeAverage)
 {
-  real sum = 0;
+  accreal sum = 0;
   THNN_CHECK_NELEMENT(input, target);
-  TH_TENSOR_APPLY2(real, input, real, target,
+  THNN_TENSOR_APPLY2_REDUCE(real, input, real, target, reduction(+:sum),
     sum += fabs(*input_data - *target_data);
   );
 
@@ -32,9 +32,34 @@ void THNN_(AbsCriterion_updateGradInput)(
   real norm = (sizeAverage ? 1./((real)THTensor_(nElement)(input)) : 1.);
 
   THTensor_(resizeAs)(gradInput, input);
-  TH_TENSOR_APPLY3(real, gradInput, real, input, real, target,
+  THNN_TENSOR_APPLY3(real, gradInput, real, input, real, target,
     *gradInput_data = (*input_data - *target_data) >= 0 ? norm : -norm;
   );
 }
 
+void THNN_(AbsCriterion_updateOutputAndGradInput)(
+          THNNState *state,
+          THTensor *input,
+          THTensor *target,
+          THTensor *output,
+          THTensor *gradInput,
+          bool sizeAverage)
+{
+  accreal sum = 0;
+  THNN_CHECK_NELEMENT(input, target);
+  real norm = (sizeAverage ? 1./((real)THTensor_(nElement)(input)) : 1.);
+
+  THTensor_(resizeAs)(gradInput, input);
+  THNN_TENSOR_APPLY3_REDUCE(real, gradInput, real, input, real, target, reduction(+:sum),
+    real z = *input_data - *target_data;
+    sum += fabs(z);
+    *gradInput_data = z >= 0 ? norm : -norm;
+  );
+
+  if (sizeAverage)
+    sum /= THTensor_(nElement)(input);
+
+  THTensor_(set1d)(output, 0, sum);
+}
+
 #endif
@@ -4,6 +4,11 @@
 
 #define EPS 1e-12
 
+/* The loops count the inputs outside [0, 1] (NaNs included) instead of
+ * raising an error from inside a parallel region; it is raised afterwards. */
+#define BCE_CHECK_RANGE(invalid) \
+  THArgCheck(invalid == 0, 2, "input value should be between 0~1")
+
 void THNN_(BCECriterion_updateOutput)(THNNState *state, THTensor *input,
 				      THTensor *target, THTensor *output,
 				      bool sizeAverage, THTensor *weights)
@@ -11,28 +16,28 @@ void THNN_(BCECriterion_updateOutput)(THNNState *state, THTensor *input,
   THNN_CHECK_NELEMENT(input, target);
   THNN_CHECK_NELEMENT(input, weights);
   THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
-  real sum = 0;
+  accreal sum = 0;
+  long invalid = 0;
 
   if(weights)
-    TH_TENSOR_APPLY3(real, input, real, target, real, weights,
+    THNN_TENSOR_APPLY3_REDUCE(real, input, real, target, real, weights,
+                              reduction(+:sum) reduction(+:invalid),
       real x = *input_data;
       real y = *target_data;
       real w = *weights_data;
-      THAssertMsg(x >= 0. && x <= 1.,
-        "input value should be between 0~1, but got %f",
-		  (double) x);
+      invalid += !(x >= 0. && x <= 1.);
       sum -= (log(x + EPS) * y + log(1. - x + EPS) * (1. - y)) * w;
     )
   else
-    TH_TENSOR_APPLY2(real, input, real, target,
+    THNN_TENSOR_APPLY2_REDUCE(real, input, real, target,
+                              reduction(+:sum) reduction(+:invalid),
       real x = *input_data;
       real y = *target_data;
-      THAssertMsg(x >= 0. && x <= 1.,
-        "input value should be between 0~1, but got %f",
-		  (double) x);
+      invalid += !(x >= 0. && x <= 1.);
       sum -= log(x + EPS) * y + log(1. - x + EPS) * (1. - y);
     );
 
+  BCE_CHECK_RANGE(invalid);
 
   if (sizeAverage)
     sum /= THTensor_(nElement)(input);
@@ -51,7 +56,7 @@ void THNN_(BCECriterion_updateGradInput)(THNNState *state, THTensor *input,
 
   THTensor_(resizeAs)(gradInput, input);
 
-  TH_TENSOR_APPLY3(real, gradInput, real, input, real, target,
+  THNN_TENSOR_APPLY3(real, gradInput, real, input, real, target,
     real x = *input_data;
     real y = *target_data;
     *gradInput_data = - norm * (y - x) / ((1. - x + EPS) * (x + EPS));
@@ -61,6 +66,63 @@ void THNN_(BCECriterion_updateGradInput)(THNNState *state, THTensor *input,
     THTensor_(cmul)(gradInput, gradInput, weights);
 }
 
+void THNN_(BCECriterion_updateOutputAndGradInput)(THNNState *state, THTensor *input,
+						  THTensor *target, THTensor *output,
+						  THTensor *gradInput, bool sizeAverage,
+						  THTensor *weights)
+{
+  THNN_CHECK_NELEMENT(input, target);
+  THNN_CHECK_NELEMENT(input, weights);
+  THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
+
+  real norm = (sizeAverage ? 1./((real)THTensor_(nElement)(input)) : 1.);
+  accreal sum = 0;
+  long invalid = 0;
+
+  THTensor_(resizeAs)(gradInput, input);
+
+  if (!weights) {
+    THNN_TENSOR_APPLY3_REDUCE(real, gradInput, real, input, real, target,
+                              reduction(+:sum) reduction(+:invalid),
+      real x = *input_data;
+      real y = *target_data;
+      invalid += !(x >= 0. && x <= 1.);
+      sum -= log(x + EPS) * y + log(1. - x + EPS) * (1. - y);
+      *gradInput_data = - norm * (y - x) / ((1. - x + EPS) * (x + EPS));
+    );
+  } else if (THTensor_(isContiguous)(gradInput) && THTensor_(isContiguous)(input) &&
+             THTensor_(isContiguous)(target) && THTensor_(isContiguous)(weights)) {
+    /* four operands: no TENSOR_APPLY for that, write the flat loop out */
+    real *gradInput_data = THTensor_(data)(gradInput);
+    real *input_data = THTensor_(data)(input);
+    real *target_data = THTensor_(data)(target);
+    real *weights_data = THTensor_(data)(weights);
+    ptrdiff_t i, n = THTensor_(nElement)(input);
+    THNN_PRAGMA(THNN_OMP_FOR_REDUCE if (n > THNN_OMP_OVERHEAD_THRESHOLD)
+                reduction(+:sum) reduction(+:invalid))
+    for (i = 0; i < n; i++) {
+      real x = input_data[i];
+      real y = target_data[i];
+      real w = weights_data[i];
+      invalid += !(x >= 0. && x <= 1.);
+      sum -= (log(x + EPS) * y + log(1. - x + EPS) * (1. - y)) * w;
+      gradInput_data[i] = - norm * (y - x) / ((1. - x + EPS) * (x + EPS)) * w;
+    }
+  } else {
+    THNN_(BCECriterion_updateOutput)(state, input, target, output, sizeAverage, weights);
+    THNN_(BCECriterion_updateGradInput)(state, input, target, gradInput, sizeAverage, weights);
+    return;
+  }
+
+  BCE_CHECK_RANGE(invalid);
+
+  if (sizeAverage)
+    sum /= THTensor_(nElement)(input);
+
+  THTensor_(set1d)(output, 0, sum);
+}
+
+#undef BCE_CHECK_RANGE
 #undef EPS
 
 #endif
@@ -16,8 +16,9 @@ void THNN_(BatchNormalization_updateOutput)(
 
   #pragma omp parallel for
   for (f = 0; f < nInput; ++f) {
-    THTensor *in = THTensor_(newSelect)(input, 1, f);
-    THTensor *out = THTensor_(newSelect)(output, 1, f);
+    THTensorView inView, outView;
+    THTensor *in = THTensor_(viewSelect)(&inView, input, 1, f);
+    THTensor *out = THTensor_(viewSelect)(&outView, output, 1, f);
 
     real mean, invstd;
 
@@ -59,9 +60,6 @@ void THNN_(BatchNormalization_updateOutput)(
 
     TH_TENSOR_APPLY2(real, in, real, out,
       *out_data = (real) (((*in_data - mean) * invstd) * w + b););
-
-    THTensor_(free)(out);
-    THTensor_(free)(in);
   }
 }
 
@@ -79,8 +77,9 @@ void THNN_(BatchNormalization_backward)(
 
   #pragma omp parallel for
   for (f = 0; f < nInput; ++f) {
-    THTensor *in = THTensor_(newSelect)(input, 1, f);
-    THTensor *gradOut = THTensor_(newSelect)(gradOutput, 1, f);
+    THTensorView inView, gradOutView;
+    THTensor *in = THTensor_(viewSelect)(&inView, input, 1, f);
+    THTensor *gradOut = THTensor_(viewSelect)(&gradOutView, gradOutput, 1, f);
     real w = weight ? THTensor_(get1d)(weight, f) : 1;
     real mean, invstd;
     if (train) {
@@ -102,7 +101,8 @@ void THNN_(BatchNormalization_backward)(
 
     if (gradInput) {
       THTensor_(resizeAs)(gradInput, input);      
-      THTensor *gradIn = THTensor_(newSelect)(gradInput, 1, f);
+      THTensorView gradInView;
+      THTensor *gradIn = THTensor_(viewSelect)(&gradInView, gradInput, 1, f);
 
       if (train) {
         // when in training mode
@@ -127,8 +127,6 @@ void THNN_(BatchNormalization_backward)(
         TH_TENSOR_APPLY2(real, gradIn, real, gradOut,
           *gradIn_data = *gradOut_data * invstd * w;);
       }
-
-      THTensor_(free)(gradIn);
     }
 
     if (gradWeight) {
@@ -140,9 +138,6 @@ void THNN_(BatchNormalization_backward)(
       real val = THTensor_(get1d)(gradBias, f);
       THTensor_(set1d)(gradBias, f, val + scale * sum);
     }
-
-    THTensor_(free)(gradOut);
-    THTensor_(free)(in);
   }
 }
 
@@ -0,0 +1,187 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/CrossEntropyCriterion.c"
+#else
+
+/* LogSoftMax followed by ClassNLLCriterion, without materializing the
+ * log-probabilities: the forward pass keeps the max and log(sum(exp(x - max)))
+ * of each row, which the backward pass turns into softmax(input) -
+ * onehot(target). */
+
+static void THNN_(CrossEntropyCriterion_checkSizes)(
+          THTensor *input,
+          THIndexTensor *target,
+          THTensor *weights,
+          long ignore_index,
+          long *nframe,
+          long *dim)
+{
+  long i;
+  THIndex_t *target_data;
+
+  if (THIndexTensor_(nDimension)(target) > 1) {
+    THError("multi-target not supported");
+  }
+  if (THTensor_(nDimension)(input) == 1) {
+    *nframe = 1;
+    *dim = THTensor_(size)(input, 0);
+  } else if (THTensor_(nDimension)(input) == 2) {
+    *nframe = THTensor_(size)(input, 0);
+    *dim = THTensor_(size)(input, 1);
+  } else {
+    THError("input tensor should be 1D or 2D");
+  }
+  if (THIndexTensor_(nElement)(target) != *nframe) {
+    THDescBuff s1 = THTensor_(sizeDesc)(input);
+    THDescBuff s2 = THIndexTensor_(sizeDesc)(target);
+    THError("input and target sizes do not match: input %s, target %s", s1.str, s2.str);
+  }
+  if (weights && THTensor_(nElement)(weights) != *dim) {
+    THDescBuff s1 = THTensor_(sizeDesc)(weights);
+    THError("weight tensor should be defined either for all %ld classes or no classes"
+            " but got weight tensor of shape: %s", *dim, s1.str);
+  }
+
+  /* targets are validated up front so that the row loops below can run in
+     parallel regions without raising errors */
+  target = THIndexTensor_(newContiguous)(target);
+  target_data = THIndexTensor_(data)(target);
+  for (i = 0; i < *nframe; i++) {
+    long cur_target = target_data[i] - TH_INDEX_BASE;
+    if (cur_target != ignore_index && (cur_target < 0 || cur_target >= *dim)) {
+      THIndexTensor_(free)(target);
+      THError("target %ld out of range for %ld classes", cur_target + TH_INDEX_BASE, *dim);
+    }
+  }
+  THIndexTensor_(free)(target);
+}
+
+void THNN_(CrossEntropyCriterion_updateOutput)(
+          THNNState *state,
+          THTensor *input,
+          THIndexTensor *target,
+          THTensor *output,
+          bool sizeAverage,
+          THTensor *weights,
+          THTensor *total_weight,
+          THTensor *logsumexp,
+          long ignore_index)
+{
+  long nframe = 0, dim = 0, t;
+  accreal loss = 0, totalWeight = 0;
+
+  THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
+  THNN_CHECK_DIM_SIZE(total_weight, 1, 0, 1);
+  ignore_index -= TH_INDEX_BASE;
+  THNN_(CrossEntropyCriterion_checkSizes)(input, target, weights, ignore_index, &nframe, &dim);
+
+  input = THTensor_(newContiguous)(input);
+  target = THIndexTensor_(newContiguous)(target);
+  weights = weights ? THTensor_(newContiguous)(weights) : NULL;
+  THTensor_(resize2d)(logsumexp, nframe, 2);
+
+  real *input_data = THTensor_(data)(input);
+  THIndex_t *target_data = THIndexTensor_(data)(target);
+  real *weights_data = weights ? THTensor_(data)(weights) : NULL;
+  real *logsumexp_data = THTensor_(data)(logsumexp);
+
+#pragma omp parallel for private(t) reduction(+:loss, totalWeight) if (nframe*dim > THNN_SOFTMAX_OMP_THRESHOLD)
+  for (t = 0; t < nframe; t++)
+  {
+    real *input_ptr = input_data + t*dim;
+    long cur_target = target_data[t] - TH_INDEX_BASE;
+    real maxInput, logSum, cur_weight;
+    accreal sum;
+
+    /* max + log(sum) is not rounded to real: that would cost an ulp of
+     * the max in every exp(x - max - log(sum)) of the backward pass */
+    THNN_(softmax_rowMaxSum)(input_ptr, dim, &maxInput, &sum);
+    logSum = log(sum);
+    logsumexp_data[2*t] = maxInput;
+    logsumexp_data[2*t+1] = logSum;
+    if (cur_target != ignore_index) {
+      cur_weight = weights ? weights_data[cur_target] : 1;
+      totalWeight += cur_weight;
+      loss += ((maxInput - input_ptr[cur_target]) + logSum) * cur_weight;
+    }
+  }
+
+  if (sizeAverage && totalWeight) {
+    loss /= totalWeight;
+  }
+  THTensor_(set1d)(output, 0, loss);
+  THTensor_(set1d)(total_weight, 0, totalWeight);
+
+  if (weights) {
+    THTensor_(free)(weights);
+  }
+  THTensor_(free)(input);
+  THIndexTensor_(free)(target);
+}
+
+void THNN_(CrossEntropyCriterion_updateGradInput)(
+          THNNState *state,
+          THTensor *input,
+          THIndexTensor *target,
+          THTensor *gradInput,
+          bool sizeAverage,
+          THTensor *weights,
+          THTensor *total_weight,
+          THTensor *logsumexp,
+          long ignore_index)
+{
+  long nframe = 0, dim = 0, t;
+  real totalWeight;
+
+  ignore_index -= TH_INDEX_BASE;
+  THNN_(CrossEntropyCriterion_checkSizes)(input, target, weights, ignore_index, &nframe, &dim);
+  THNN_CHECK_DIM_SIZE(logsumexp, 2, 0, nframe);
+  totalWeight = THTensor_(get1d)(total_weight, 0);
+
+  input = THTensor_(newContiguous)(input);
+  target = THIndexTensor_(newContiguous)(target);
+  weights = weights ? THTensor_(newContiguous)(weights) : NULL;
+  logsumexp = THTensor_(newContiguous)(logsumexp);
+  THTensor_(resizeAs)(gradInput, input);
+
+  real *input_data = THTensor_(data)(input);
+  real *gradInput_data = THTensor_(data)(gradInput);
+  THIndex_t *target_data = THIndexTensor_(data)(target);
+  real *weights_data = weights ? THTensor_(data)(weights) : NULL;
+  real *logsumexp_data = THTensor_(data)(logsumexp);
+
+#pragma omp parallel for private(t) if (nframe*dim > THNN_SOFTMAX_OMP_THRESHOLD)
+  for (t = 0; t < nframe; t++)
+  {
+    real *input_ptr = input_data + t*dim;
+    real *gradInput_ptr = gradInput_data + t*dim;
+    long cur_target = target_data[t] - TH_INDEX_BASE;
+    real maxInput = logsumexp_data[2*t];
+    real logSum = logsumexp_data[2*t+1];
+    real scale = 0;
+    long d;
+
+    if (cur_target != ignore_index) {
+      scale = weights ? weights_data[cur_target] : 1;
+      if (sizeAverage) {
+        scale = totalWeight ? scale / totalWeight : 0;
+      }
+    }
+    if (scale == 0) {
+      for (d = 0; d < dim; d++)
+        gradInput_ptr[d] = 0;
+      continue;
+    }
+    for (d = 0; d < dim; d++)
+      gradInput_ptr[d] = THNN_(softmax_exp)((input_ptr[d] - maxInput) - logSum) * scale;
+    gradInput_ptr[cur_target] -= scale;
+  }
+
+  if (weights) {
+    THTensor_(free)(weights);
+  }
+  THTensor_(free)(input);
+  THTensor_(free)(logsumexp);
+  THIndexTensor_(free)(target);
+}
+
+#endif
@@ -12,9 +12,9 @@ void THNN_(DistKLDivCriterion_updateOutput)(
   THNN_CHECK_NELEMENT(input, target);
   THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
   
-  real sum = 0;
+  accreal sum = 0;
 
-  TH_TENSOR_APPLY2(real, input, real, target,
+  THNN_TENSOR_APPLY2_REDUCE(real, input, real, target, reduction(+:sum),
     sum += *target_data > 0 ? *target_data * (log(*target_data) - *input_data) : 0;
   );
 
@@ -36,9 +36,36 @@ void THNN_(DistKLDivCriterion_updateGradInput)(
   real norm = (sizeAverage ? 1./((real)THTensor_(nElement)(input)) : 1.);
 
   THTensor_(resizeAs)(gradInput, input);
-  TH_TENSOR_APPLY3(real, gradInput, real, input, real, target,
+  THNN_TENSOR_APPLY3(real, gradInput, real, input, real, target,
     *gradInput_data = *target_data > 0 ? norm * (-*target_data) : 0;
   );
 }
 
+void THNN_(DistKLDivCriterion_updateOutputAndGradInput)(
+          THNNState *state,
+          THTensor *input,
+          THTensor *target,
+          THTensor *output,
+          THTensor *gradInput,
+          bool sizeAverage)
+{
+  THNN_CHECK_NELEMENT(input, target);
+  THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
+
+  real norm = (sizeAverage ? 1./((real)THTensor_(nElement)(input)) : 1.);
+  accreal sum = 0;
+
+  THTensor_(resizeAs)(gradInput, input);
+  THNN_TENSOR_APPLY3_REDUCE(real, gradInput, real, input, real, target, reduction(+:sum),
+    real y = *target_data;
+    sum += y > 0 ? y * (log(y) - *input_data) : 0;
+    *gradInput_data = y > 0 ? norm * (-y) : 0;
+  );
+
+  if (sizeAverage)
+    sum /= THTensor_(nElement)(input);
+
+  THTensor_(set1d)(output, 0, sum);
+}
+
 #endif
@@ -0,0 +1,286 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/EmbeddingBag.c"
+#else
+
+/*
+ * LookupTable followed by a sum, mean or max over each bag of indices.
+ * input holds the indices of all bags back to back and offsets the
+ * position of the first index of each bag, so that no [batch, bagLen, dim]
+ * intermediate is needed. The backward pass reuses the sorted reduction
+ * of LookupTable.c.
+ */
+
+#ifndef THNN_EMBEDDING_BAG_SUM
+#define THNN_EMBEDDING_BAG_SUM 0
+#define THNN_EMBEDDING_BAG_MEAN 1
+#define THNN_EMBEDDING_BAG_MAX 2
+#endif
+
+static long THNN_(EmbeddingBag_checkSizes)(
+          THIndexTensor *input,
+          THIndexTensor *offsets,
+          THTensor *perSampleWeights,
+          long numw,
+          int mode)
+{
+  long nbag, b;
+  ptrdiff_t numel = THIndexTensor_(nElement)(input);
+
+  if (mode != THNN_EMBEDDING_BAG_SUM && mode != THNN_EMBEDDING_BAG_MEAN
+      && mode != THNN_EMBEDDING_BAG_MAX)
+    THError("unknown mode %d, expected 0 (sum), 1 (mean) or 2 (max)", mode);
+  if (THIndexTensor_(nDimension)(input) != 1) {
+    THDescBuff s1 = THIndexTensor_(sizeDesc)(input);
+    THError("input must be a vector, but is of shape: %s", s1.str);
+  }
+  if (THIndexTensor_(nDimension)(offsets) != 1 || !THIndexTensor_(isContiguous)(offsets)) {
+    THDescBuff s1 = THIndexTensor_(sizeDesc)(offsets);
+    THError("offsets must be a contiguous vector, but is of shape: %s", s1.str);
+  }
+  THNN_(LookupTable_checkInput)(input, numw);
+
+  nbag = THIndexTensor_(size)(offsets, 0);
+  THIndex_t *offsets_data = THIndexTensor_(data)(offsets);
+  for (b = 0; b < nbag; b++) {
+    THIndex_t start = offsets_data[b] - TH_INDEX_BASE;
+    THIndex_t end = b + 1 < nbag ? offsets_data[b+1] - TH_INDEX_BASE : numel;
+    if (start < 0 || start > end || end > numel)
+      THError("offsets must be non-decreasing and in the range %ld <= offset <= %ld, "
+              "but got offset %ld for bag %ld", TH_INDEX_BASE, numel + TH_INDEX_BASE,
+              offsets_data[b], b);
+  }
+
+  if (perSampleWeights) {
+    if (mode == THNN_EMBEDDING_BAG_MAX)
+      THError("per sample weights are only supported for sum and mean pooling");
+    if (THTensor_(nElement)(perSampleWeights) != numel) {
+      THDescBuff s1 = THTensor_(sizeDesc)(perSampleWeights);
+      THError("perSampleWeights should have one weight per index (%ld), "
+              "but got tensor of shape: %s", (long)numel, s1.str);
+    }
+  }
+  return nbag;
+}
+
+void THNN_(EmbeddingBag_updateOutput)(
+          THNNState *state,
+          THIndexTensor *input,
+          THIndexTensor *offsets,
+          THTensor *weight,
+          THTensor *output,
+          THTensor *perSampleWeights,
+          THIndexTensor *maxIndices,
+          int mode)
+{
+  long b;
+
+  THNN_ARGCHECK(weight->nDimension == 2, 4, weight,
+                "2D weight tensor expected, but got: %s");
+  long numw = THTensor_(size)(weight, 0);
+  long dim = THTensor_(size)(weight, 1);
+  long nbag = THNN_(EmbeddingBag_checkSizes)(input, offsets, perSampleWeights, numw, mode);
+  ptrdiff_t numel = THIndexTensor_(nElement)(input);
+
+  weight = THTensor_(newContiguous)(weight);
+  perSampleWeights = perSampleWeights ? THTensor_(newContiguous)(perSampleWeights) : NULL;
+  THTensor_(resize2d)(output, nbag, dim);
+  if (mode == THNN_EMBEDDING_BAG_MAX)
+    THIndexTensor_(resize2d)(maxIndices, nbag, dim);
+
+  THIndex_t *input_data = THIndexTensor_(data)(input);
+  THIndex_t *offsets_data = THIndexTensor_(data)(offsets);
+  real *weight_data = THTensor_(data)(weight);
+  real *output_data = THTensor_(data)(output);
+  real *psw_data = perSampleWeights ? THTensor_(data)(perSampleWeights) : NULL;
+  THIndex_t *maxIndices_data = mode == THNN_EMBEDDING_BAG_MAX ? THIndexTensor_(data)(maxIndices) : NULL;
+
+  // bags have different lengths, hence the dynamic schedule
+#pragma omp parallel for private(b) schedule(dynamic, 16) if (numel * dim > THNN_LOOKUP_TABLE_OMP_THRESHOLD * 64)
+  for (b = 0; b < nbag; b++)
+  {
+    ptrdiff_t start = offsets_data[b] - TH_INDEX_BASE;
+    ptrdiff_t end = b + 1 < nbag ? offsets_data[b+1] - TH_INDEX_BASE : numel;
+    real *out = output_data + b*dim;
+    ptrdiff_t i;
+    long d;
+
+    if (mode == THNN_EMBEDDING_BAG_MAX) {
+      THIndex_t *idx = maxIndices_data + b*dim;
+      if (start == end) {
+        // empty bags get a zero output and no gradient
+        THVector_(fill)(out, 0, dim);
+        for (d = 0; d < dim; d++)
+          idx[d] = TH_INDEX_BASE - 1;
+        continue;
+      }
+      THVector_(copy)(out, weight_data + (input_data[start] - TH_INDEX_BASE)*dim, dim);
+      for (d = 0; d < dim; d++)
+        idx[d] = input_data[start];
+      for (i = start + 1; i < end; i++) {
+        real *row = weight_data + (input_data[i] - TH_INDEX_BASE)*dim;
+        for (d = 0; d < dim; d++) {
+          if (row[d] > out[d]) {
+            out[d] = row[d];
+            idx[d] = input_data[i];
+          }
+        }
+      }
+    } else {
+      THVector_(fill)(out, 0, dim);
+      for (i = start; i < end; i++)
+        THVector_(cadd)(out, out, weight_data + (input_data[i] - TH_INDEX_BASE)*dim,
+                        psw_data ? psw_data[i] : 1, dim);
+      if (mode == THNN_EMBEDDING_BAG_MEAN && end > start)
+        THVector_(muls)(out, out, (real)1 / (end - start), dim);
+    }
+  }
+
+  THTensor_(free)(weight);
+  if (perSampleWeights)
+    THTensor_(free)(perSampleWeights);
+}
+
+/*
+ * Gradient w.r.t. the weight, accumulated into gradWeight, or returned as
+ * the indices and values of a coalesced sparse tensor if gradIndices is
+ * given. For sum and mean, entry i of the input contributes its bag's
+ * gradOutput row, weighted by perSampleWeights[i] (and 1/bag length for
+ * mean); for max, each element of gradOutput goes to the row that won it.
+ */
+static void THNN_(EmbeddingBag_gradParameters)(
+          THIndexTensor *input,
+          THIndexTensor *offsets,
+          THTensor *gradOutput,
+          THTensor *perSampleWeights,
+          THIndexTensor *maxIndices,
+          long numw,
+          int mode,
+          real scale,
+          THTensor *gradWeight,
+          THIndexTensor *gradIndices,
+          THTensor *gradValues)
+{
+  long nbag = THNN_(EmbeddingBag_checkSizes)(input, offsets, perSampleWeights, numw, mode);
+  ptrdiff_t numel = THIndexTensor_(nElement)(input);
+  long dim = THTensor_(nDimension)(gradOutput) == 2 ? THTensor_(size)(gradOutput, 1) : 0;
+  ptrdiff_t nkeys, nseg, s;
+  THIndex_t *keys;
+  real *dst;
+
+  THNN_ARGCHECK(THTensor_(nDimension)(gradOutput) == 2 && THTensor_(size)(gradOutput, 0) == nbag,
+                3, gradOutput, "gradOutput should have one row per bag, but got: %s");
+  if (gradWeight && (!THTensor_(isContiguous)(gradWeight) || THTensor_(size)(gradWeight, 1) != dim))
+    THError("gradWeight must be contiguous and have as many columns as gradOutput");
+
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  real *go = THTensor_(data)(gradOutput);
+
+  if (mode == THNN_EMBEDDING_BAG_MAX) {
+    THNN_CHECK_DIM_SIZE_INDICES(maxIndices, 2, 0, nbag);
+    maxIndices = THIndexTensor_(newContiguous)(maxIndices);
+    keys = THIndexTensor_(data)(maxIndices);
+    nkeys = nbag * dim;
+  } else {
+    keys = THIndexTensor_(data)(input);
+    nkeys = numel;
+  }
+
+  THNN_(LookupTableEntry) *entries = THAlloc(sizeof(THNN_(LookupTableEntry)) * nkeys);
+  ptrdiff_t *segStart = THAlloc(sizeof(ptrdiff_t) * (nkeys + 1));
+  nseg = THNN_(LookupTable_sortIndices)(keys, nkeys, numw, TH_INDEX_BASE - 1, entries, segStart);
+
+  if (gradIndices) {
+    THIndexTensor_(resize2d)(gradIndices, 1, nseg);
+    THTensor_(resize2d)(gradValues, nseg, dim);
+    THTensor_(zero)(gradValues);
+    THIndex_t *gradIndices_data = THIndexTensor_(data)(gradIndices);
+    for (s = 0; s < nseg; s++)
+      gradIndices_data[s] = entries[segStart[s]].key;
+    dst = THTensor_(data)(gradValues);
+  } else {
+    dst = THTensor_(data)(gradWeight);
+  }
+
+  if (mode == THNN_EMBEDDING_BAG_MAX) {
+    // each run holds the elements of gradOutput won by one row
+#pragma omp parallel for private(s) schedule(dynamic, 16) if (nkeys > THNN_LOOKUP_TABLE_OMP_THRESHOLD * 64)
+    for (s = 0; s < nseg; s++) {
+      real *row = dst + (gradIndices ? s : entries[segStart[s]].key)*dim;
+      ptrdiff_t j;
+      for (j = segStart[s]; j < segStart[s+1]; j++)
+        row[entries[j].pos % dim] += scale * go[entries[j].pos];
+    }
+    THIndexTensor_(free)(maxIndices);
+  } else {
+    THIndex_t *offsets_data = THIndexTensor_(data)(offsets);
+    THIndex_t *bagOf = THAlloc(sizeof(THIndex_t) * numel);
+    real *entryWeight = THAlloc(sizeof(real) * numel);
+    real *psw_data = NULL;
+    long b;
+
+    perSampleWeights = perSampleWeights ? THTensor_(newContiguous)(perSampleWeights) : NULL;
+    psw_data = perSampleWeights ? THTensor_(data)(perSampleWeights) : NULL;
+
+#pragma omp parallel for private(b) if (numel > THNN_LOOKUP_TABLE_OMP_THRESHOLD)
+    for (b = 0; b < nbag; b++) {
+      ptrdiff_t start = offsets_data[b] - TH_INDEX_BASE;
+      ptrdiff_t end = b + 1 < nbag ? offsets_data[b+1] - TH_INDEX_BASE : numel;
+      real w = mode == THNN_EMBEDDING_BAG_MEAN && end > start ? (real)1 / (end - start) : 1;
+      ptrdiff_t i;
+      for (i = start; i < end; i++) {
+        bagOf[i] = b;
+        entryWeight[i] = psw_data ? psw_data[i] * w : w;
+      }
+    }
+
+    THNN_(LookupTable_reduceSegments)(entries, segStart, nseg, NULL, go, bagOf, entryWeight,
+                                      dst, dim, scale, gradIndices != NULL);
+
+    THFree(bagOf);
+    THFree(entryWeight);
+    if (perSampleWeights)
+      THTensor_(free)(perSampleWeights);
+  }
+
+  THFree(entries);
+  THFree(segStart);
+  THTensor_(free)(gradOutput);
+}
+
+void THNN_(EmbeddingBag_accGradParameters)(
+          THNNState *state,
+          THIndexTensor *input,
+          THIndexTensor *offsets,
+          THTensor *gradOutput,
+          THTensor *gradWeight,
+          THTensor *perSampleWeights,
+          THIndexTensor *maxIndices,
+          int mode,
+          accreal scale)
+{
+  THNN_ARGCHECK(gradWeight->nDimension == 2, 5, gradWeight,
+                "2D gradWeight tensor expected, but got: %s");
+  THNN_(EmbeddingBag_gradParameters)(input, offsets, gradOutput, perSampleWeights, maxIndices,
+                                     THTensor_(size)(gradWeight, 0), mode,
+                                     TH_CONVERT_ACCREAL_TO_REAL(scale), gradWeight, NULL, NULL);
+}
+
+void THNN_(EmbeddingBag_sparseGradParameters)(
+          THNNState *state,
+          THIndexTensor *input,
+          THIndexTensor *offsets,
+          THTensor *gradOutput,
+          THIndexTensor *gradIndices,
+          THTensor *gradValues,
+          THTensor *perSampleWeights,
+          THIndexTensor *maxIndices,
+          long numWeights,
+          int mode,
+          accreal scale)
+{
+  THNN_(EmbeddingBag_gradParameters)(input, offsets, gradOutput, perSampleWeights, maxIndices,
+                                     numWeights, mode, TH_CONVERT_ACCREAL_TO_REAL(scale),
+                                     NULL, gradIndices, gradValues);
+}
+
+#endif
@@ -2,6 +2,130 @@
 #define TH_GENERIC_FILE "generic/FusedRNNKernel.c"
 #else
 
+#include <stdarg.h>
+
+#if defined(TH_REAL_IS_FLOAT)
+#define THNN_FUSED_RNN_MATH(fn) fn##f
+#else
+#define THNN_FUSED_RNN_MATH(fn) fn
+#endif
+#define THNN_FUSED_RNN_SIGMOID(x) (1 / (1 + THNN_FUSED_RNN_MATH(exp)(-(x))))
+
+/* Threshold used to trigger multithreading */
+#ifndef THNN_FUSED_RNN_OMP_THRESHOLD
+#define THNN_FUSED_RNN_OMP_THRESHOLD 4096
+#endif
+
+/* Number of hidden units handled by one work item. Work is split over
+ * batch x hidden blocks, so that small batches with a large hidden size
+ * still spread across threads while each block keeps a contiguous,
+ * vectorizable inner loop over the gate buffer. */
+#ifndef THNN_FUSED_RNN_BLOCK
+#define THNN_FUSED_RNN_BLOCK 256
+#endif
+
+/* Per-element cell math shared by the per-timestep kernels below and by the
+ * whole-sequence layers in FusedRNNSequence.c. */
+static inline void THNN_(LSTMFused_cellForward)(
+          real *ig, real *fg, real *cg, real *og,  // in: pre-activations, out: activated gates
+          real cx, real *cy, real *hy)
+{
+  *ig = THNN_FUSED_RNN_SIGMOID(*ig);
+  *fg = THNN_FUSED_RNN_SIGMOID(*fg);
+  *cg = THNN_FUSED_RNN_MATH(tanh)(*cg);
+  *og = THNN_FUSED_RNN_SIGMOID(*og);
+  *cy = (*fg * cx) + (*ig * *cg);
+  *hy = *og * THNN_FUSED_RNN_MATH(tanh)(*cy);
+}
+
+static inline void THNN_(LSTMFused_cellBackward)(
+          real ig, real fg, real cg, real og,      // activated gates
+          real cx, real cy, real go, real goc,
+          real *gig, real *gfg, real *gcg, real *gog, real *gcx)
+{
+  real tcy = THNN_FUSED_RNN_MATH(tanh)(cy);
+  real gc = go * og * (1 - tcy*tcy) + goc;
+  *gig = gc * cg * (1-ig) * ig;
+  *gfg = gc * cx * (1-fg) * fg;
+  *gcg = gc * ig * (1-cg*cg);
+  *gog = go * tcy * (1-og) * og;
+  *gcx = gc * fg;
+}
+
+static inline void THNN_(GRUFused_cellForward)(
+          real *rg, real *ig, real *ng,            // in: pre-activations, out: activated gates
+          real hn, real hx, real *hy)              // hn includes the hidden-side new gate bias
+{
+  *rg = THNN_FUSED_RNN_SIGMOID(*rg);
+  *ig = THNN_FUSED_RNN_SIGMOID(*ig);
+  *ng = THNN_FUSED_RNN_MATH(tanh)(*ng + *rg * hn);
+  *hy = *ng + *ig * (hx - *ng);
+}
+
+static inline void THNN_(GRUFused_cellBackward)(
+          real rg, real ig, real ng, real hx, real hn, real go,
+          real *grg, real *gig, real *gin, real *ghn, real *ghx)
+{
+  *gig = go*(hx-ng)*(1-ig)*(ig);
+  *ghx = go*(ig);
+  *gin = go*(1-ig)*(1-ng*ng);
+  *ghn = *gin*rg;
+  *grg = *gin*hn*(1-rg)*rg;
+}
+
+//factor will be 3 for GRU and 4 for LSTM
+static void THNN_(FusedRNNAssertSizes)(int factor, int count, ...)
+{
+  va_list list;
+  va_start(list, count);
+  THTensor *input = va_arg(list, THTensor*);
+  THTensor *hidden = va_arg(list, THTensor*);
+  THArgCheck(THTensor_(nElement)(input) ==
+             THTensor_(nElement)(hidden),
+             3, "Input and Hidden tensor sizes should be the same.");
+
+  for (int arg=2; arg < count; ++arg){
+    THTensor *tens = va_arg(list, THTensor*);
+    THArgCheck(THTensor_(nElement)(input) ==
+               THTensor_(nElement)(tens)*factor,
+               3, "A pointwise tensor was not the right size, should have 1/%d the elements of input/hidden tensor.", factor);
+  }
+
+  va_end(list);
+}
+
+/* Packs the two optional biases into one contiguous buffer, so that the
+ * fused loops never branch on their presence. The first nsum gates of bias1
+ * and bias2 are pre-summed; the remaining (factor - nsum) gates are stored
+ * for bias1, then for bias2. */
+static THTensor* THNN_(FusedRNNPackBias)(
+          THTensor *bias1,
+          THTensor *bias2,
+          int factor,
+          int nsum,
+          long hsz)
+{
+  long nrest = (factor - nsum) * hsz;
+  THTensor *bias = THTensor_(newWithSize1d)(nsum*hsz + 2*nrest);
+  real *bias_data = THTensor_(data)(bias);
+  THTensor *biases[2] = {bias1, bias2};
+  int k;
+
+  THTensor_(zero)(bias);
+  for (k = 0; k < 2; k++) {
+    if (biases[k] == NULL)
+      continue;
+    THArgCheck(THTensor_(nElement)(biases[k]) == factor*hsz, 3+k,
+               "Bias in pointwise operation is an incorrect size, must be %d x feature size.", factor);
+    THTensor *b = THTensor_(newContiguous)(biases[k]);
+    real *b_data = THTensor_(data)(b);
+    THVector_(cadd)(bias_data, bias_data, b_data, 1, nsum*hsz);
+    THVector_(copy)(bias_data + nsum*hsz + k*nrest, b_data + nsum*hsz, nrest);
+    THTensor_(free)(b);
+  }
+  return bias;
+}
+
 void THNN_(GRUFused_updateOutput)(
           THNNState *state,
           THTensor *input,
@@ -12,7 +136,71 @@ void THNN_(GRUFused_updateOutput)(
           THTensor *hy,
           THTensor *storage)
 {
-  THAssertMsg(false, "Not implemented for CPU");
+  THTensor_(resizeAs)(hy, hx);
+  THNN_(FusedRNNAssertSizes)(3, 4, input, hidden, hx, hy);
+  THArgCheck(THTensor_(nElement)(storage) == THTensor_(nElement)(hx)*5, 8,
+             "storage should have 5 x the elements of hx");
+
+  long hsz = hx->size[hx->nDimension-1];
+  long nbatch = THTensor_(nElement)(hx) / hsz;
+  long nblock = (hsz + THNN_FUSED_RNN_BLOCK - 1) / THNN_FUSED_RNN_BLOCK;
+
+  // layout: [b1r+b2r, b1i+b2i, b1n, b2n]
+  THTensor *bias = THNN_(FusedRNNPackBias)(bias1, bias2, 3, 2, hsz);
+  input = THTensor_(newContiguous)(input);
+  hidden = THTensor_(newContiguous)(hidden);
+  hx = THTensor_(newContiguous)(hx);
+  THTensor *hy_c = THTensor_(newContiguous)(hy);
+  THTensor *storage_c = THTensor_(newContiguous)(storage);
+
+  real *input_data = THTensor_(data)(input);
+  real *hidden_data = THTensor_(data)(hidden);
+  real *bias_data = THTensor_(data)(bias);
+  real *hx_data = THTensor_(data)(hx);
+  real *hy_data = THTensor_(data)(hy_c);
+  real *storage_data = THTensor_(data)(storage_c);
+
+  long t;
+#pragma omp parallel for private(t) if (nbatch*hsz > THNN_FUSED_RNN_OMP_THRESHOLD)
+  for (t = 0; t < nbatch*nblock; t++)
+  {
+    long b = t / nblock;
+    long j0 = (t % nblock) * THNN_FUSED_RNN_BLOCK;
+    long j1 = THMin(j0 + THNN_FUSED_RNN_BLOCK, hsz);
+    long j;
+
+    real *ir = input_data + b*3*hsz, *ii = ir + hsz, *in = ii + hsz;
+    real *hr = hidden_data + b*3*hsz, *hi = hr + hsz, *hn = hi + hsz;
+    real *br = bias_data, *bi = br + hsz, *b1n = bi + hsz, *b2n = b1n + hsz;
+    real *hx_b = hx_data + b*hsz;
+    real *hy_b = hy_data + b*hsz;
+    real *sr = storage_data + b*5*hsz, *si = sr + hsz, *sn = si + hsz;
+    real *shx = sn + hsz, *shn = shx + hsz;
+
+    for (j = j0; j < j1; j++)
+    {
+      real rg = ir[j] + hr[j] + br[j];
+      real ig = ii[j] + hi[j] + bi[j];
+      real ng = in[j] + b1n[j];
+      real hnb = hn[j] + b2n[j];
+      real h = hx_b[j];
+      THNN_(GRUFused_cellForward)(&rg, &ig, &ng, hnb, h, &hy_b[j]);
+
+      //SAVE FOR BACKWARDS
+      sr[j] = rg;
+      si[j] = ig;
+      sn[j] = ng;
+      shx[j] = h;
+      shn[j] = hnb;
+    }
+  }
+
+  THTensor_(free)(bias);
+  THTensor_(free)(input);
+  THTensor_(free)(hidden);
+  THTensor_(free)(hx);
+  THTensor_(freeCopyTo)(hy_c, hy);
+  THTensor_(freeCopyTo)(storage_c, storage);
 }
 
 void THNN_(GRUFused_updateGradInput)(
@@ -23,7 +211,68 @@ void THNN_(GRUFused_updateGradInput)(
           THTensor *gradInputHx,
           THTensor *storage)
 {
-  THAssertMsg(false, "Not implemented for CPU");
+  THTensor_(resizeAs)(gradInputHx, gradOutput);
+  THNN_(FusedRNNAssertSizes)(3, 4, gradInInput, gradInHidden, gradOutput, gradInputHx);
+  THArgCheck(THTensor_(nElement)(storage) == THTensor_(nElement)(gradOutput)*5, 6,
+             "storage should have 5 x the elements of gradOutput");
+
+  long hsz = gradOutput->size[gradOutput->nDimension-1];
+  long nbatch = THTensor_(nElement)(gradOutput) / hsz;
+  long nblock = (hsz + THNN_FUSED_RNN_BLOCK - 1) / THNN_FUSED_RNN_BLOCK;
+
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  storage = THTensor_(newContiguous)(storage);
+  THTensor *gradInInput_c = THTensor_(newContiguous)(gradInInput);
+  THTensor *gradInHidden_c = THTensor_(newContiguous)(gradInHidden);
+  THTensor *gradInputHx_c = THTensor_(newContiguous)(gradInputHx);
+
+  real *gradOutput_data = THTensor_(data)(gradOutput);
+  real *storage_data = THTensor_(data)(storage);
+  real *gradInInput_data = THTensor_(data)(gradInInput_c);
+  real *gradInHidden_data = THTensor_(data)(gradInHidden_c);
+  real *gradInputHx_data = THTensor_(data)(gradInputHx_c);
+
+  long t;
+#pragma omp parallel for private(t) if (nbatch*hsz > THNN_FUSED_RNN_OMP_THRESHOLD)
+  for (t = 0; t < nbatch*nblock; t++)
+  {
+    long b = t / nblock;
+    long j0 = (t % nblock) * THNN_FUSED_RNN_BLOCK;
+    long j1 = THMin(j0 + THNN_FUSED_RNN_BLOCK, hsz);
+    long j;
+
+    real *sr = storage_data + b*5*hsz, *si = sr + hsz, *sn = si + hsz;
+    real *shx = sn + hsz, *shn = shx + hsz;
+    real *go_b = gradOutput_data + b*hsz;
+    real *ghx_b = gradInputHx_data + b*hsz;
+    real *gir = gradInInput_data + b*3*hsz, *gii = gir + hsz, *gin_ = gii + hsz;
+    real *ghr = gradInHidden_data + b*3*hsz, *ghi = ghr + hsz, *ghn_ = ghi + hsz;
+
+    for (j = j0; j < j1; j++)
+    {
+      real rg = sr[j], ig = si[j], ng = sn[j], hx = shx[j], hn = shn[j];
+      real go = go_b[j];
+
+      real grg, gig, gin, ghn, ghx;
+      THNN_(GRUFused_cellBackward)(rg, ig, ng, hx, hn, go, &grg, &gig, &gin, &ghn, &ghx);
+
+      ghx_b[j] = ghx;
+
+      gir[j] = grg;
+      gii[j] = gig;
+      gin_[j] = gin;
+
+      ghr[j] = grg;
+      ghi[j] = gig;
+      ghn_[j] = ghn;
+    }
+  }
+
+  THTensor_(free)(gradOutput);
+  THTensor_(free)(storage);
+  THTensor_(freeCopyTo)(gradInInput_c, gradInInput);
+  THTensor_(freeCopyTo)(gradInHidden_c, gradInHidden);
+  THTensor_(freeCopyTo)(gradInputHx_c, gradInputHx);
 }
 
 void THNN_(LSTMFused_updateOutput)(
@@ -36,20 +285,138 @@ void THNN_(LSTMFused_updateOutput)(
           THTensor *hy,
           THTensor *cy)
 {
-  THAssertMsg(false, "Not implemented for CPU");
+  THTensor_(resizeAs)(hy, cx);
+  THTensor_(resizeAs)(cy, cx);
+  THNN_(FusedRNNAssertSizes)(4, 5, input, hidden, hy, cy, cx);
+
+  long hsz = cx->size[cx->nDimension-1];
+  long nbatch = THTensor_(nElement)(cx) / hsz;
+  long nblock = (hsz + THNN_FUSED_RNN_BLOCK - 1) / THNN_FUSED_RNN_BLOCK;
+
+  THTensor *bias = THNN_(FusedRNNPackBias)(bias1, bias2, 4, 4, hsz);
+  // the activated gates are written back into input for the backward pass
+  THTensor *input_c = THTensor_(newContiguous)(input);
+  hidden = THTensor_(newContiguous)(hidden);
+  cx = THTensor_(newContiguous)(cx);
+  THTensor *hy_c = THTensor_(newContiguous)(hy);
+  THTensor *cy_c = THTensor_(newContiguous)(cy);
+
+  real *input_data = THTensor_(data)(input_c);
+  real *hidden_data = THTensor_(data)(hidden);
+  real *bias_data = THTensor_(data)(bias);
+  real *cx_data = THTensor_(data)(cx);
+  real *hy_data = THTensor_(data)(hy_c);
+  real *cy_data = THTensor_(data)(cy_c);
+
+  long t;
+#pragma omp parallel for private(t) if (nbatch*hsz > THNN_FUSED_RNN_OMP_THRESHOLD)
+  for (t = 0; t < nbatch*nblock; t++)
+  {
+    long b = t / nblock;
+    long j0 = (t % nblock) * THNN_FUSED_RNN_BLOCK;
+    long j1 = THMin(j0 + THNN_FUSED_RNN_BLOCK, hsz);
+    long j;
+
+    real *iig = input_data + b*4*hsz, *ifg = iig + hsz, *icg = ifg + hsz, *iog = icg + hsz;
+    real *hig = hidden_data + b*4*hsz, *hfg = hig + hsz, *hcg = hfg + hsz, *hog = hcg + hsz;
+    real *bi = bias_data, *bf = bi + hsz, *bc = bf + hsz, *bo = bc + hsz;
+    real *cx_b = cx_data + b*hsz;
+    real *hy_b = hy_data + b*hsz;
+    real *cy_b = cy_data + b*hsz;
+
+    for (j = j0; j < j1; j++)
+    {
+      real ig = iig[j] + hig[j] + bi[j];
+      real fg = ifg[j] + hfg[j] + bf[j];
+      real cg = icg[j] + hcg[j] + bc[j];
+      real og = iog[j] + hog[j] + bo[j];
+      THNN_(LSTMFused_cellForward)(&ig, &fg, &cg, &og, cx_b[j], &cy_b[j], &hy_b[j]);
+
+      //SAVE FOR BACKWARDS
+      iig[j] = ig;
+      ifg[j] = fg;
+      icg[j] = cg;
+      iog[j] = og;
+    }
+  }
+
+  THTensor_(free)(bias);
+  THTensor_(free)(hidden);
+  THTensor_(free)(cx);
+  THTensor_(freeCopyTo)(input_c, input);
+  THTensor_(freeCopyTo)(hy_c, hy);
+  THTensor_(freeCopyTo)(cy_c, cy);
 }
 
 void THNN_(LSTMFused_updateGradInput)(
           THNNState *state,
           THTensor *storage,
           THTensor *gradInGates,
-          THTensor *prevC,
+          THTensor *cx,
           THTensor *cy,
           THTensor *gradOutput,
           THTensor *gradOutputCell,
           THTensor *gradInputCx)
 {
-  THAssertMsg(false, "Not implemented for CPU");
+  THTensor_(resizeAs)(gradInputCx, gradOutput);
+  THNN_(FusedRNNAssertSizes)(4, 7, storage, gradInGates, cx, cy,
+                             gradOutput, gradOutputCell, gradInputCx);
+
+  long hsz = gradOutput->size[gradOutput->nDimension-1];
+  long nbatch = THTensor_(nElement)(gradOutput) / hsz;
+  long nblock = (hsz + THNN_FUSED_RNN_BLOCK - 1) / THNN_FUSED_RNN_BLOCK;
+
+  storage = THTensor_(newContiguous)(storage);
+  cx = THTensor_(newContiguous)(cx);
+  cy = THTensor_(newContiguous)(cy);
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  gradOutputCell = THTensor_(newContiguous)(gradOutputCell);
+  THTensor *gradInGates_c = THTensor_(newContiguous)(gradInGates);
+  THTensor *gradInputCx_c = THTensor_(newContiguous)(gradInputCx);
+
+  real *storage_data = THTensor_(data)(storage);
+  real *cx_data = THTensor_(data)(cx);
+  real *cy_data = THTensor_(data)(cy);
+  real *gradOutput_data = THTensor_(data)(gradOutput);
+  real *gradOutputCell_data = THTensor_(data)(gradOutputCell);
+  real *gradInGates_data = THTensor_(data)(gradInGates_c);
+  real *gradInputCx_data = THTensor_(data)(gradInputCx_c);
+
+  long t;
+#pragma omp parallel for private(t) if (nbatch*hsz > THNN_FUSED_RNN_OMP_THRESHOLD)
+  for (t = 0; t < nbatch*nblock; t++)
+  {
+    long b = t / nblock;
+    long j0 = (t % nblock) * THNN_FUSED_RNN_BLOCK;
+    long j1 = THMin(j0 + THNN_FUSED_RNN_BLOCK, hsz);
+    long j;
+
+    real *sig = storage_data + b*4*hsz, *sfg = sig + hsz, *scg = sfg + hsz, *sog = scg + hsz;
+    real *ih = gradInGates_data + b*4*hsz, *fh = ih + hsz, *ch = fh + hsz, *oh = ch + hsz;
+    real *cx_b = cx_data + b*hsz;
+    real *cy_b = cy_data + b*hsz;
+    real *go_b = gradOutput_data + b*hsz;
+    real *goc_b = gradOutputCell_data + b*hsz;
+    real *gi_b = gradInputCx_data + b*hsz;
+
+    for (j = j0; j < j1; j++)
+    {
+      THNN_(LSTMFused_cellBackward)(sig[j], sfg[j], scg[j], sog[j],
+                                    cx_b[j], cy_b[j], go_b[j], goc_b[j],
+                                    &ih[j], &fh[j], &ch[j], &oh[j], &gi_b[j]);
+    }
+  }
+
+  THTensor_(free)(storage);
+  THTensor_(free)(cx);
+  THTensor_(free)(cy);
+  THTensor_(free)(gradOutput);
+  THTensor_(free)(gradOutputCell);
+  THTensor_(freeCopyTo)(gradInGates_c, gradInGates);
+  THTensor_(freeCopyTo)(gradInputCx_c, gradInputCx);
 }
 
+#undef THNN_FUSED_RNN_SIGMOID
+#undef THNN_FUSED_RNN_MATH
+
 #endif
@@ -0,0 +1,635 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/FusedRNNSequence.c"
+#else
+
+/* Whole-sequence LSTM/GRU layers.
+ *
+ * Sequences are given as a packed batch: the rows of input/output are the
+ * timesteps one after another, and batchSizes[t] is the number of sequences
+ * still running at timestep t (sequences sorted by decreasing length, so
+ * batchSizes is non-increasing). Finished sequences simply drop out of the
+ * recurrence.
+ *
+ * The input projection of all timesteps is done up front as one GEMM. The
+ * recurrent weight is then repacked into panels of THNN_RNN_SEQUENCE_BLOCK
+ * hidden units (all gates of those units side by side). During the
+ * recurrence each thread owns the same panels at every timestep, so its
+ * share of the recurrent weight stays in its cache, and it applies the fused
+ * gate kernel to its hidden units right after its panel GEMM.
+ */
+
+/* Width, in hidden units, of one panel of the packed recurrent weight. */
+#ifndef THNN_RNN_SEQUENCE_BLOCK
+#define THNN_RNN_SEQUENCE_BLOCK 64
+#endif
+
+static long *THNN_(RNNSequence_offsets)(
+          THIndexTensor *batchSizes,
+          long nrows,
+          long maxBatch)
+{
+  THArgCheck(THIndexTensor_(nDimension)(batchSizes) == 1, 2,
+             "batchSizes should be a 1D tensor");
+  long nsteps = THIndexTensor_(size)(batchSizes, 0);
+  THArgCheck(nsteps > 0, 2, "batchSizes should not be empty");
+
+  long *offsets = THAlloc(sizeof(long) * (nsteps + 1));
+  long t;
+  offsets[0] = 0;
+  for (t = 0; t < nsteps; t++) {
+    long bs = THIndexTensor_(get1d)(batchSizes, t);
+    if (bs <= 0 || bs > (t == 0 ? maxBatch : offsets[t] - offsets[t-1])) {
+      THFree(offsets);
+      THArgCheck(0, 2, "batchSizes should be positive and non-increasing, "
+                 "and start with the batch size of the initial hidden state");
+    }
+    offsets[t+1] = offsets[t] + bs;
+  }
+  if (offsets[0+1] != maxBatch || offsets[nsteps] != nrows) {
+    THFree(offsets);
+    THArgCheck(0, 2, "batchSizes does not match the sizes of input and initial hidden state");
+  }
+  return offsets;
+}
+
+/* Repacks weight (factor*hsz x hsz) so that the recurrent projection of
+ * hidden units [j0, j0+bw) for every gate is one contiguous, row-major
+ * hsz x (factor*bw) panel: panel column g*bw + jj holds weight row
+ * g*hsz + j0 + jj. */
+static void THNN_(RNNSequence_packWeight)(
+          THTensor *weight,
+          THTensor *packed,
+          int factor,
+          long hsz)
+{
+  long nblock = (hsz + THNN_RNN_SEQUENCE_BLOCK - 1) / THNN_RNN_SEQUENCE_BLOCK;
+  long kb;
+
+  THTensor_(resize1d)(packed, factor*hsz*hsz);
+  weight = THTensor_(newContiguous)(weight);
+  real *weight_data = THTensor_(data)(weight);
+  real *packed_data = THTensor_(data)(packed);
+
+#pragma omp parallel for private(kb)
+  for (kb = 0; kb < nblock; kb++) {
+    long j0 = kb * THNN_RNN_SEQUENCE_BLOCK;
+    long bw = THMin(THNN_RNN_SEQUENCE_BLOCK, hsz - j0);
+    real *panel = packed_data + j0*factor*hsz;
+    long k, g, jj;
+    for (k = 0; k < hsz; k++)
+      for (g = 0; g < factor; g++)
+        for (jj = 0; jj < bw; jj++)
+          panel[(k*factor + g)*bw + jj] = weight_data[(g*hsz + j0 + jj)*hsz + k];
+  }
+
+  THTensor_(free)(weight);
+}
+
+/* gates = input * weightIH^T + bias, for all timesteps at once. gates may be
+ * a column slice of a wider buffer. */
+static void THNN_(RNNSequence_inputProjection)(
+          THTensor *gates,
+          THTensor *input,
+          THTensor *weightIH,
+          real *bias_data)
+{
+  long nrows = THTensor_(size)(gates, 0);
+  long ngates = THTensor_(size)(gates, 1);
+  long r;
+
+  THTensor *tweight = THTensor_(newTranspose)(weightIH, 0, 1);
+  THTensor_(addmm)(gates, 0, gates, 1, input, tweight);
+  THTensor_(free)(tweight);
+
+  real *gates_data = THTensor_(data)(gates);
+  long stride = gates->stride[0];
+#pragma omp parallel for private(r) if (nrows*ngates > THNN_FUSED_RNN_OMP_THRESHOLD)
+  for (r = 0; r < nrows; r++)
+    THVector_(cadd)(gates_data + r*stride, gates_data + r*stride, bias_data, 1, ngates);
+}
+
+/* Stacks the hidden state every packed row was computed from:
+ * hx for the first timestep, the previous timestep's output otherwise. */
+static THTensor* THNN_(RNNSequence_previousHidden)(
+          THTensor *hx,
+          THTensor *output,
+          long *offsets,
+          long nsteps)
+{
+  long hsz = THTensor_(size)(hx, 1);
+  THTensor *hprev = THTensor_(newWithSize2d)(offsets[nsteps], hsz);
+  real *hprev_data = THTensor_(data)(hprev);
+  real *hx_data = THTensor_(data)(hx);
+  real *output_data = THTensor_(data)(output);
+  long t;
+
+  for (t = 0; t < nsteps; t++) {
+    real *src = t == 0 ? hx_data : output_data + offsets[t-1]*hsz;
+    THVector_(copy)(hprev_data + offsets[t]*hsz, src, (offsets[t+1] - offsets[t])*hsz);
+  }
+  return hprev;
+}
+
+/* Accumulates the weight and bias gradients from the packed gate gradients
+ * with one GEMM per weight. */
+static void THNN_(RNNSequence_accGradParameters)(
+          THTensor *gradGatesIH,
+          THTensor *gradGatesHH,
+          THTensor *input,
+          THTensor *hprev,
+          THTensor *gradWeightIH,
+          THTensor *gradWeightHH,
+          THTensor *gradBias1,
+          THTensor *gradBias2,
+          real scale)
+{
+  THTensor *tgrad = THTensor_(newTranspose)(gradGatesIH, 0, 1);
+  THTensor_(addmm)(gradWeightIH, 1, gradWeightIH, scale, tgrad, input);
+  THTensor_(free)(tgrad);
+
+  tgrad = THTensor_(newTranspose)(gradGatesHH, 0, 1);
+  THTensor_(addmm)(gradWeightHH, 1, gradWeightHH, scale, tgrad, hprev);
+  THTensor_(free)(tgrad);
+
+  THTensor *sum = THTensor_(new)();
+  if (gradBias1) {
+    THTensor_(sum)(sum, gradGatesIH, 0, 0);
+    THTensor_(cadd)(gradBias1, gradBias1, scale, sum);
+  }
+  if (gradBias2) {
+    THTensor_(sum)(sum, gradGatesHH, 0, 0);
+    THTensor_(cadd)(gradBias2, gradBias2, scale, sum);
+  }
+  THTensor_(free)(sum);
+}
+
+static void THNN_(RNNSequence_checkSizes)(
+          int factor,
+          THTensor *input,
+          THTensor *weightIH,
+          THTensor *weightHH,
+          THTensor *hx)
+{
+  THNN_ARGCHECK(input->nDimension == 2, 2, input,
+                "2D packed input expected, but got: %s");
+  THNN_ARGCHECK(hx->nDimension == 2, 8, hx,
+                "2D initial hidden state expected, but got: %s");
+  long hsz = hx->size[1];
+  THNN_CHECK_DIM_SIZE(weightIH, 2, 0, factor*hsz);
+  THNN_CHECK_DIM_SIZE(weightIH, 2, 1, input->size[1]);
+  THNN_CHECK_DIM_SIZE(weightHH, 2, 0, factor*hsz);
+  THNN_CHECK_DIM_SIZE(weightHH, 2, 1, hsz);
+}
+
+void THNN_(LSTMSequence_updateOutput)(
+          THNNState *state,
+          THTensor *input,
+          THIndexTensor *batchSizes,
+          THTensor *weightIH,
+          THTensor *weightHH,
+          THTensor *bias1,
+          THTensor *bias2,
+          THTensor *hx,
+          THTensor *cx,
+          THTensor *output,
+          THTensor *hy,
+          THTensor *cy,
+          THTensor *gates,
+          THTensor *cells,
+          THTensor *packedWeight)
+{
+  THNN_(RNNSequence_checkSizes)(4, input, weightIH, weightHH, hx);
+  THNN_CHECK_SHAPE(hx, cx);
+
+  long hsz = hx->size[1];
+  long maxBatch = hx->size[0];
+  long nrows = input->size[0];
+  long nsteps = THIndexTensor_(size)(batchSizes, 0);
+  long nblock = (hsz + THNN_RNN_SEQUENCE_BLOCK - 1) / THNN_RNN_SEQUENCE_BLOCK;
+  long *offsets = THNN_(RNNSequence_offsets)(batchSizes, nrows, maxBatch);
+  long t, b;
+
+  input = THTensor_(newContiguous)(input);
+  hx = THTensor_(newContiguous)(hx);
+  cx = THTensor_(newContiguous)(cx);
+  THTensor_(resize2d)(output, nrows, hsz);
+  THTensor_(resize2d)(gates, nrows, 4*hsz);
+  THTensor_(resize2d)(cells, nrows, hsz);
+  THTensor_(resizeAs)(hy, hx);
+  THTensor_(resizeAs)(cy, cx);
+
+  THTensor *bias = THNN_(FusedRNNPackBias)(bias1, bias2, 4, 4, hsz);
+  THNN_(RNNSequence_inputProjection)(gates, input, weightIH, THTensor_(data)(bias));
+  THNN_(RNNSequence_packWeight)(weightHH, packedWeight, 4, hsz);
+  THTensor *hbuf = THTensor_(newWithSize1d)(maxBatch*4*hsz);
+
+  real *gates_data = THTensor_(data)(gates);
+  real *cells_data = THTensor_(data)(cells);
+  real *output_data = THTensor_(data)(output);
+  real *hx_data = THTensor_(data)(hx);
+  real *cx_data = THTensor_(data)(cx);
+  real *packed_data = THTensor_(data)(packedWeight);
+  real *hbuf_data = THTensor_(data)(hbuf);
+
+#pragma omp parallel private(t)
+  for (t = 0; t < nsteps; t++)
+  {
+    long off = offsets[t];
+    long bs = offsets[t+1] - off;
+    real *hprev = t == 0 ? hx_data : output_data + offsets[t-1]*hsz;
+    real *cprev = t == 0 ? cx_data : cells_data + offsets[t-1]*hsz;
+    long kb;
+
+#pragma omp for schedule(static)
+    for (kb = 0; kb < nblock; kb++)
+    {
+      long j0 = kb * THNN_RNN_SEQUENCE_BLOCK;
+      long bw = THMin(THNN_RNN_SEQUENCE_BLOCK, hsz - j0);
+      real *panel = packed_data + j0*4*hsz;
+      real *hb = hbuf_data + j0*4*maxBatch;
+      long bb, jj;
+
+      THBlas_(gemm)('n', 'n', 4*bw, bs, hsz, 1, panel, 4*bw, hprev, hsz, 0, hb, 4*bw);
+
+      for (bb = 0; bb < bs; bb++)
+      {
+        real *g = gates_data + (off + bb)*4*hsz + j0;
+        real *h = hb + bb*4*bw;
+        real *c = cells_data + (off + bb)*hsz + j0;
+        real *o = output_data + (off + bb)*hsz + j0;
+        real *cp = cprev + bb*hsz + j0;
+        for (jj = 0; jj < bw; jj++)
+        {
+          real ig = g[jj] + h[jj];
+          real fg = g[hsz + jj] + h[bw + jj];
+          real cg = g[2*hsz + jj] + h[2*bw + jj];
+          real og = g[3*hsz + jj] + h[3*bw + jj];
+          THNN_(LSTMFused_cellForward)(&ig, &fg, &cg, &og, cp[jj], &c[jj], &o[jj]);
+          g[jj] = ig;
+          g[hsz + jj] = fg;
+          g[2*hsz + jj] = cg;
+          g[3*hsz + jj] = og;
+        }
+      }
+    }
+  }
+
+  // sequences leaving the batch after timestep t hold their final state there
+  real *hy_data = THTensor_(data)(hy);
+  real *cy_data = THTensor_(data)(cy);
+  for (t = 0; t < nsteps; t++) {
+    long next = t + 1 < nsteps ? offsets[t+2] - offsets[t+1] : 0;
+    for (b = next; b < offsets[t+1] - offsets[t]; b++) {
+      THVector_(copy)(hy_data + b*hsz, output_data + (offsets[t] + b)*hsz, hsz);
+      THVector_(copy)(cy_data + b*hsz, cells_data + (offsets[t] + b)*hsz, hsz);
+    }
+  }
+
+  THFree(offsets);
+  THTensor_(free)(hbuf);
+  THTensor_(free)(bias);
+  THTensor_(free)(input);
+  THTensor_(free)(hx);
+  THTensor_(free)(cx);
+}
+
+void THNN_(LSTMSequence_backward)(
+          THNNState *state,
+          THTensor *input,
+          THIndexTensor *batchSizes,
+          THTensor *weightIH,
+          THTensor *weightHH,
+          THTensor *hx,
+          THTensor *cx,
+          THTensor *output,
+          THTensor *gates,
+          THTensor *cells,
+          THTensor *gradOutput,
+          THTensor *gradHy,
+          THTensor *gradCy,
+          THTensor *gradInput,
+          THTensor *gradHx,
+          THTensor *gradCx,
+          THTensor *gradWeightIH,
+          THTensor *gradWeightHH,
+          THTensor *gradBias1,
+          THTensor *gradBias2,
+          THTensor *gradGates,
+          accreal scale_)
+{
+  real scale = TH_CONVERT_ACCREAL_TO_REAL(scale_);
+  THNN_(RNNSequence_checkSizes)(4, input, weightIH, weightHH, hx);
+  THNN_CHECK_SHAPE(hx, cx);
+  THNN_CHECK_SHAPE(output, gradOutput);
+  THNN_CHECK_SHAPE(hx, gradHy);
+  THNN_CHECK_SHAPE(cx, gradCy);
+
+  long hsz = hx->size[1];
+  long nrows = input->size[0];
+  long nsteps = THIndexTensor_(size)(batchSizes, 0);
+  long nblock = (hsz + THNN_FUSED_RNN_BLOCK - 1) / THNN_FUSED_RNN_BLOCK;
+  long *offsets = THNN_(RNNSequence_offsets)(batchSizes, nrows, hx->size[0]);
+  long t;
+
+  input = THTensor_(newContiguous)(input);
+  weightHH = THTensor_(newContiguous)(weightHH);
+  hx = THTensor_(newContiguous)(hx);
+  cx = THTensor_(newContiguous)(cx);
+  output = THTensor_(newContiguous)(output);
+  gates = THTensor_(newContiguous)(gates);
+  cells = THTensor_(newContiguous)(cells);
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+
+  // gradHx and gradCx carry the running gradients w.r.t. the hidden and cell
+  // state; once the first timestep is done they are the gradients w.r.t. hx, cx
+  THTensor_(resizeAs)(gradHx, hx);
+  THTensor_(resizeAs)(gradCx, cx);
+  if (gradHy) THTensor_(copy)(gradHx, gradHy); else THTensor_(zero)(gradHx);
+  if (gradCy) THTensor_(copy)(gradCx, gradCy); else THTensor_(zero)(gradCx);
+  THTensor_(resize2d)(gradGates, nrows, 4*hsz);
+
+  real *weightHH_data = THTensor_(data)(weightHH);
+  real *cx_data = THTensor_(data)(cx);
+  real *gates_data = THTensor_(data)(gates);
+  real *cells_data = THTensor_(data)(cells);
+  real *gradOutput_data = THTensor_(data)(gradOutput);
+  real *dh_data = THTensor_(data)(gradHx);
+  real *dc_data = THTensor_(data)(gradCx);
+  real *gradGates_data = THTensor_(data)(gradGates);
+
+  for (t = nsteps - 1; t >= 0; t--)
+  {
+    long off = offsets[t];
+    long bs = offsets[t+1] - off;
+    real *cprev = t == 0 ? cx_data : cells_data + offsets[t-1]*hsz;
+    long k;
+
+#pragma omp parallel for private(k) if (bs*hsz > THNN_FUSED_RNN_OMP_THRESHOLD)
+    for (k = 0; k < bs*nblock; k++)
+    {
+      long bb = k / nblock;
+      long j0 = (k % nblock) * THNN_FUSED_RNN_BLOCK;
+      long j1 = THMin(j0 + THNN_FUSED_RNN_BLOCK, hsz);
+      long r = off + bb;
+      real *g = gates_data + r*4*hsz;
+      real *gg = gradGates_data + r*4*hsz;
+      real *c = cells_data + r*hsz;
+      real *go = gradOutput_data + r*hsz;
+      real *cp = cprev + bb*hsz;
+      real *dh = dh_data + bb*hsz;
+      real *dc = dc_data + bb*hsz;
+      long j;
+      for (j = j0; j < j1; j++)
+      {
+        THNN_(LSTMFused_cellBackward)(g[j], g[hsz + j], g[2*hsz + j], g[3*hsz + j],
+                                      cp[j], c[j], dh[j] + go[j], dc[j],
+                                      &gg[j], &gg[hsz + j], &gg[2*hsz + j], &gg[3*hsz + j],
+                                      &dc[j]);
+      }
+    }
+
+    // dh = gradGates * weightHH for the sequences active at this timestep
+    THBlas_(gemm)('n', 'n', hsz, bs, 4*hsz, 1, weightHH_data, hsz,
+                  gradGates_data + off*4*hsz, 4*hsz, 0, dh_data, hsz);
+  }
+
+  THTensor_(resize2d)(gradInput, nrows, input->size[1]);
+  THTensor_(addmm)(gradInput, 0, gradInput, 1, gradGates, weightIH);
+
+  THTensor *hprev = THNN_(RNNSequence_previousHidden)(hx, output, offsets, nsteps);
+  THNN_(RNNSequence_accGradParameters)(gradGates, gradGates, input, hprev,
+                                       gradWeightIH, gradWeightHH,
+                                       gradBias1, gradBias2, scale);
+
+  THFree(offsets);
+  THTensor_(free)(hprev);
+  THTensor_(free)(input);
+  THTensor_(free)(weightHH);
+  THTensor_(free)(hx);
+  THTensor_(free)(cx);
+  THTensor_(free)(output);
+  THTensor_(free)(gates);
+  THTensor_(free)(cells);
+  THTensor_(free)(gradOutput);
+}
+
+void THNN_(GRUSequence_updateOutput)(
+          THNNState *state,
+          THTensor *input,
+          THIndexTensor *batchSizes,
+          THTensor *weightIH,
+          THTensor *weightHH,
+          THTensor *bias1,
+          THTensor *bias2,
+          THTensor *hx,
+          THTensor *output,
+          THTensor *hy,
+          THTensor *gates,
+          THTensor *packedWeight)
+{
+  THNN_(RNNSequence_checkSizes)(3, input, weightIH, weightHH, hx);
+
+  long hsz = hx->size[1];
+  long maxBatch = hx->size[0];
+  long nrows = input->size[0];
+  long nsteps = THIndexTensor_(size)(batchSizes, 0);
+  long nblock = (hsz + THNN_RNN_SEQUENCE_BLOCK - 1) / THNN_RNN_SEQUENCE_BLOCK;
+  long *offsets = THNN_(RNNSequence_offsets)(batchSizes, nrows, maxBatch);
+  long t, b;
+
+  input = THTensor_(newContiguous)(input);
+  hx = THTensor_(newContiguous)(hx);
+  THTensor_(resize2d)(output, nrows, hsz);
+  THTensor_(resize2d)(gates, nrows, 4*hsz);
+  THTensor_(resizeAs)(hy, hx);
+
+  // gates rows are [r, i, n, hn]: the first three hold the input projection,
+  // hn the recurrent projection of the new gate, both kept for backward
+  // bias layout: [b1r+b2r, b1i+b2i, b1n, b2n]
+  THTensor *bias = THNN_(FusedRNNPackBias)(bias1, bias2, 3, 2, hsz);
+  THTensor *xgates = THTensor_(newNarrow)(gates, 1, 0, 3*hsz);
+  THNN_(RNNSequence_inputProjection)(xgates, input, weightIH, THTensor_(data)(bias));
+  THTensor_(free)(xgates);
+  THNN_(RNNSequence_packWeight)(weightHH, packedWeight, 3, hsz);
+  THTensor *hbuf = THTensor_(newWithSize1d)(maxBatch*3*hsz);
+
+  real *gates_data = THTensor_(data)(gates);
+  real *output_data = THTensor_(data)(output);
+  real *hx_data = THTensor_(data)(hx);
+  real *b2n = THTensor_(data)(bias) + 3*hsz;
+  real *packed_data = THTensor_(data)(packedWeight);
+  real *hbuf_data = THTensor_(data)(hbuf);
+
+#pragma omp parallel private(t)
+  for (t = 0; t < nsteps; t++)
+  {
+    long off = offsets[t];
+    long bs = offsets[t+1] - off;
+    real *hprev = t == 0 ? hx_data : output_data + offsets[t-1]*hsz;
+    long kb;
+
+#pragma omp for schedule(static)
+    for (kb = 0; kb < nblock; kb++)
+    {
+      long j0 = kb * THNN_RNN_SEQUENCE_BLOCK;
+      long bw = THMin(THNN_RNN_SEQUENCE_BLOCK, hsz - j0);
+      real *panel = packed_data + j0*3*hsz;
+      real *hb = hbuf_data + j0*3*maxBatch;
+      long bb, jj;
+
+      THBlas_(gemm)('n', 'n', 3*bw, bs, hsz, 1, panel, 3*bw, hprev, hsz, 0, hb, 3*bw);
+
+      for (bb = 0; bb < bs; bb++)
+      {
+        real *g = gates_data + (off + bb)*4*hsz + j0;
+        real *h = hb + bb*3*bw;
+        real *o = output_data + (off + bb)*hsz + j0;
+        real *hp = hprev + bb*hsz + j0;
+        for (jj = 0; jj < bw; jj++)
+        {
+          real rg = g[jj] + h[jj];
+          real ig = g[hsz + jj] + h[bw + jj];
+          real ng = g[2*hsz + jj];
+          real hn = h[2*bw + jj] + b2n[j0 + jj];
+          THNN_(GRUFused_cellForward)(&rg, &ig, &ng, hn, hp[jj], &o[jj]);
+          g[jj] = rg;
+          g[hsz + jj] = ig;
+          g[2*hsz + jj] = ng;
+          g[3*hsz + jj] = hn;
+        }
+      }
+    }
+  }
+
+  // sequences leaving the batch after timestep t hold their final state there
+  real *hy_data = THTensor_(data)(hy);
+  for (t = 0; t < nsteps; t++) {
+    long next = t + 1 < nsteps ? offsets[t+2] - offsets[t+1] : 0;
+    for (b = next; b < offsets[t+1] - offsets[t]; b++)
+      THVector_(copy)(hy_data + b*hsz, output_data + (offsets[t] + b)*hsz, hsz);
+  }
+
+  THFree(offsets);
+  THTensor_(free)(hbuf);
+  THTensor_(free)(bias);
+  THTensor_(free)(input);
+  THTensor_(free)(hx);
+}
+
+void THNN_(GRUSequence_backward)(
+          THNNState *state,
+          THTensor *input,
+          THIndexTensor *batchSizes,
+          THTensor *weightIH,
+          THTensor *weightHH,
+          THTensor *hx,
+          THTensor *output,
+          THTensor *gates,
+          THTensor *gradOutput,
+          THTensor *gradHy,
+          THTensor *gradInput,
+          THTensor *gradHx,
+          THTensor *gradWeightIH,
+          THTensor *gradWeightHH,
+          THTensor *gradBias1,
+          THTensor *gradBias2,
+          THTensor *gradGates,
+          accreal scale_)
+{
+  real scale = TH_CONVERT_ACCREAL_TO_REAL(scale_);
+  THNN_(RNNSequence_checkSizes)(3, input, weightIH, weightHH, hx);
+  THNN_CHECK_SHAPE(output, gradOutput);
+  THNN_CHECK_SHAPE(hx, gradHy);
+
+  long hsz = hx->size[1];
+  long nrows = input->size[0];
+  long nsteps = THIndexTensor_(size)(batchSizes, 0);
+  long nblock = (hsz + THNN_FUSED_RNN_BLOCK - 1) / THNN_FUSED_RNN_BLOCK;
+  long *offsets = THNN_(RNNSequence_offsets)(batchSizes, nrows, hx->size[0]);
+  long t;
+
+  input = THTensor_(newContiguous)(input);
+  weightHH = THTensor_(newContiguous)(weightHH);
+  hx = THTensor_(newContiguous)(hx);
+  output = THTensor_(newContiguous)(output);
+  gates = THTensor_(newContiguous)(gates);
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+
+  // gradHx carries the running gradient w.r.t. the hidden state
+  THTensor_(resizeAs)(gradHx, hx);
+  if (gradHy) THTensor_(copy)(gradHx, gradHy); else THTensor_(zero)(gradHx);
+  // gradGates rows are [r, i, n] for the input side, then [r, i, hn] for the
+  // hidden side
+  THTensor_(resize2d)(gradGates, nrows, 6*hsz);
+
+  real *weightHH_data = THTensor_(data)(weightHH);
+  real *hx_data = THTensor_(data)(hx);
+  real *output_data = THTensor_(data)(output);
+  real *gates_data = THTensor_(data)(gates);
+  real *gradOutput_data = THTensor_(data)(gradOutput);
+  real *dh_data = THTensor_(data)(gradHx);
+  real *gradGates_data = THTensor_(data)(gradGates);
+
+  for (t = nsteps - 1; t >= 0; t--)
+  {
+    long off = offsets[t];
+    long bs = offsets[t+1] - off;
+    real *hprev = t == 0 ? hx_data : output_data + offsets[t-1]*hsz;
+    long k;
+
+#pragma omp parallel for private(k) if (bs*hsz > THNN_FUSED_RNN_OMP_THRESHOLD)
+    for (k = 0; k < bs*nblock; k++)
+    {
+      long bb = k / nblock;
+      long j0 = (k % nblock) * THNN_FUSED_RNN_BLOCK;
+      long j1 = THMin(j0 + THNN_FUSED_RNN_BLOCK, hsz);
+      long r = off + bb;
+      real *g = gates_data + r*4*hsz;
+      real *gg = gradGates_data + r*6*hsz;
+      real *go = gradOutput_data + r*hsz;
+      real *hp = hprev + bb*hsz;
+      real *dh = dh_data + bb*hsz;
+      long j;
+      for (j = j0; j < j1; j++)
+      {
+        real grg, gig, gin, ghn, ghx;
+        THNN_(GRUFused_cellBackward)(g[j], g[hsz + j], g[2*hsz + j], hp[j], g[3*hsz + j],
+                                     dh[j] + go[j], &grg, &gig, &gin, &ghn, &ghx);
+        gg[j] = grg;
+        gg[hsz + j] = gig;
+        gg[2*hsz + j] = gin;
+        gg[3*hsz + j] = grg;
+        gg[4*hsz + j] = gig;
+        gg[5*hsz + j] = ghn;
+        dh[j] = ghx;
+      }
+    }
+
+    // dh += hidden side gradGates * weightHH for the sequences active at this timestep
+    THBlas_(gemm)('n', 'n', hsz, bs, 3*hsz, 1, weightHH_data, hsz,
+                  gradGates_data + off*6*hsz + 3*hsz, 6*hsz, 1, dh_data, hsz);
+  }
+
+  THTensor *gradGatesIH = THTensor_(newNarrow)(gradGates, 1, 0, 3*hsz);
+  THTensor *gradGatesHH = THTensor_(newNarrow)(gradGates, 1, 3*hsz, 3*hsz);
+  THTensor_(resize2d)(gradInput, nrows, input->size[1]);
+  THTensor_(addmm)(gradInput, 0, gradInput, 1, gradGatesIH, weightIH);
+
+  THTensor *hprev = THNN_(RNNSequence_previousHidden)(hx, output, offsets, nsteps);
+  THNN_(RNNSequence_accGradParameters)(gradGatesIH, gradGatesHH, input, hprev,
+                                       gradWeightIH, gradWeightHH,
+                                       gradBias1, gradBias2, scale);
+
+  THFree(offsets);
+  THTensor_(free)(gradGatesIH);
+  THTensor_(free)(gradGatesHH);
+  THTensor_(free)(hprev);
+  THTensor_(free)(input);
+  THTensor_(free)(weightHH);
+  THTensor_(free)(hx);
+  THTensor_(free)(output);
+  THTensor_(free)(gates);
+  THTensor_(free)(gradOutput);
+}
+
+#endif
@@ -11,13 +11,8 @@ void THNN_(HardShrink_updateOutput)(
   real lambda = TH_CONVERT_ACCREAL_TO_REAL(lambda_);
   THTensor_(resizeAs)(output, input);
 
-  TH_TENSOR_APPLY2(real, output, real, input,
-    if (*input_data > lambda)
-      *output_data = *input_data;
-    else if (*input_data < -lambda)
-      *output_data = *input_data;
-    else
-      *output_data = 0;
+  THNN_TENSOR_APPLY2(real, output, real, input,
+    *output_data = (*input_data > lambda || *input_data < -lambda) ? *input_data : 0;
   );
 }
 
@@ -31,11 +26,8 @@ void THNN_(HardShrink_updateGradInput)(
   real lambda = TH_CONVERT_ACCREAL_TO_REAL(lambda_);
   THNN_CHECK_NELEMENT(input, gradOutput);
   THTensor_(resizeAs)(gradInput, input);
-  TH_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, input,
-    if (*input_data > lambda || *input_data < -lambda)
-      *gradInput_data = *gradOutput_data;
-    else
-      *gradInput_data = 0;
+  THNN_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, input,
+    *gradInput_data = (*input_data > lambda || *input_data < -lambda) ? *gradOutput_data : 0;
   );
 }
 
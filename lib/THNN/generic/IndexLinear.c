@@ -6,21 +6,28 @@
 #include <omp.h>
 #endif
 
-/* Threshold used to trigger multithreading */
-#ifndef THNN_SPARSE_OMP_THRESHOLD
-#define THNN_SPARSE_OMP_THRESHOLD 100000
-#endif
-
-/* Threshold used to trigger BLAS axpy call */
-#ifndef THNN_SPARSE_OUTDIM_THRESHOLD
-#define THNN_SPARSE_OUTDIM_THRESHOLD 49
-#endif
-
 /* sign MACRO */
 #ifndef THNN_INDEXLINEAR_SIGN
 #define THNN_INDEXLINEAR_SIGN(a) ( ( (a) < 0 )  ?  -1   : ( (a) > 0 ) )
 #endif
 
+/* Hash of the 64-bit keys for the hashed mode: the finalizer of
+ * MurmurHash3 on the key xor a seed. Define it beforehand to use another
+ * hash. */
+#ifndef THNN_INDEXLINEAR_HASH
+#define THNN_INDEXLINEAR_HASH(key, seed) THNN_indexLinearHash(key, seed)
+static inline unsigned long long THNN_indexLinearHash(long key, long seed)
+{
+  unsigned long long h = (unsigned long long)key ^ (unsigned long long)seed;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+#endif
+
 static bool THNN_(checkKeysValues)(THLongTensor* keys, THTensor* values)
 {
   return THLongTensor_size(keys, 0) == THTensor_(nElement)(values)
@@ -28,8 +35,77 @@ static bool THNN_(checkKeysValues)(THLongTensor* keys, THTensor* values)
                 && THLongTensor_nDimension(keys) == 1;
 }
 
-void THNN_(IndexLinear_updateOutput)(
-          THNNState *state,
+/* Hashed mode: key k is stored in the weight row (bucket) hash(k) modulo
+ * numBuckets. With signHash its value is also multiplied by the sign in
+ * signs, taken from the top bit of the hash, so that colliding keys cancel
+ * out on average rather than add up. buckets or signs may be NULL. */
+static void THNN_(IndexLinear_hashKeys)(
+          const long *keys,
+          long keysOffset,
+          long n,
+          long numBuckets,
+          long hashSeed,
+          long *buckets,
+          real *signs)
+{
+  long i;
+#pragma omp parallel for private(i) if (n > THNN_SPARSE_OMP_THRESHOLD)
+  for (i = 0; i < n; i++)
+  {
+    unsigned long long h = THNN_INDEXLINEAR_HASH(keys[i] + keysOffset, hashSeed);
+    if (buckets)
+      buckets[i] = h % numBuckets;
+    if (signs)
+      signs[i] = (h >> 63) ? -1 : 1;
+  }
+}
+
+/* Hashes keys into the rows of buckets (resized to the number of keys)
+ * and returns their signs, NULL without signHash. */
+static real* THNN_(IndexLinear_hash)(
+          THLongTensor *keys,
+          long keysOffset,
+          long numBuckets,
+          long hashSeed,
+          int signHash,
+          THLongTensor *buckets)
+{
+  long n = THLongTensor_size(keys, 0);
+  THArgCheck(THLongTensor_isContiguous(keys), 1, "keys vector must be contiguous");
+  THLongTensor_resize1d(buckets, n);
+  real *signs = signHash ? THAlloc(sizeof(real) * n) : NULL;
+  THNN_(IndexLinear_hashKeys)(THLongTensor_data(keys), keysOffset, n, numBuckets,
+                              hashSeed, THLongTensor_data(buckets), signs);
+  return signs;
+}
+
+/* The keys and values of the batch as a CSR batch: row j ends at
+ * cumSumSizes[j]. rowPtr must hold batchSize + 1 offsets. */
+static void THNN_(IndexLinear_batch)(
+          THNN_(CSRBatch) *batch,
+          long *rowPtr,
+          THLongTensor *keys,
+          long keysOffset,
+          const real *values,
+          THLongTensor *cumSumSizes)
+{
+  long batchSize = THLongTensor_size(cumSumSizes, 0);
+  THArgCheck(THLongTensor_isContiguous(cumSumSizes), 5, "cumSumSizes must be contiguous");
+  rowPtr[0] = 0;
+  memcpy(rowPtr + 1, THLongTensor_data(cumSumSizes), sizeof(long) * batchSize);
+  THArgCheck(rowPtr[batchSize] <= THLongTensor_size(keys, 0), 5,
+             "cumSumSizes runs past the end of the keys");
+
+  batch->batchSize = batchSize;
+  batch->rowPtr = rowPtr;
+  batch->cols = THLongTensor_data(keys);
+  batch->values = values;
+  batch->colOffset = keysOffset;
+}
+
+/* updateOutput, the values of the keys being multiplied by signs if not
+ * NULL. */
+static void THNN_(IndexLinear_forward)(
           THLongTensor *keys,
           long keysOffset,
           THTensor *values,
@@ -39,7 +115,8 @@ void THNN_(IndexLinear_updateOutput)(
           THTensor *weight,
           THTensor *bias,
           THTensor *normalizedValues,
-          int  train)
+          int  train,
+          const real *signs)
 {
   /* Retrieve all the dimensions of the problem */
   long batchSize = THLongTensor_size(sizes, 0);
@@ -47,19 +124,26 @@ void THNN_(IndexLinear_updateOutput)(
   long outDim = THTensor_(size)(bias, 0);
   long woutDim = THTensor_(size)(weight, 1);
   int maxNormalize = woutDim - outDim;
-  long* sizesData = THLongTensor_data(sizes);
-  long* cumSumSizesData = THLongTensor_data(cumSumSizes);
+
+  /* Make sure these inputs are contiguous to accelerate computations */
+  THArgCheck(THLongTensor_isContiguous(keys), 1, "keys vector must be contiguous");
+  THArgCheck(THTensor_(isContiguous)(values), 3, "values vector must be contiguous");
+  THArgCheck(THTensor_(isContiguous)(weight), 7, "weight matrix must be contiguous");
+  THArgCheck(THTensor_(isContiguous)(bias), 8, "bias vector must be contiguous");
+  THArgCheck(THNN_(checkKeysValues)(keys, values), 1, "Keys and values should have the same number of elements");
 
   /* Define/resize the normalized values tensor if maxNormalize is  > 0 */
   real* normalizedValuesData = NULL;
   if (maxNormalize)
   {
     THTensor_(resize1d)(normalizedValues, keysSize);
+    THArgCheck(THTensor_(isContiguous)(normalizedValues), 9, "normalizedValues vector must be contiguous");
     normalizedValuesData = THTensor_(data)(normalizedValues);
   }
 
   /* Resize the output */
   THTensor_(resize2d)(output, batchSize, outDim);
+  THArgCheck(THTensor_(isContiguous)(output), 6, "output vector must be contiguous");
 
   /* Access the storage data/strides */
   real* outputData = THTensor_(data)(output);
@@ -69,171 +153,127 @@ void THNN_(IndexLinear_updateOutput)(
   real* biasData = THTensor_(data)(bias);
   long* keysData = THLongTensor_data(keys);
 
-  /* Make sure these inputs are contiguous to accelerate computations */
-  THArgCheck(THLongTensor_isContiguous(keys), 1, "keys vector must be contiguous");
-  THArgCheck(THTensor_(isContiguous)(values), 3, "values vector must be contiguous");
-  THArgCheck(THTensor_(isContiguous)(output), 6, "output vector must be contiguous");
-  THArgCheck(THTensor_(isContiguous)(weight), 7, "weight matrix must be contiguous");
-  THArgCheck(THTensor_(isContiguous)(bias), 8, "bias vector must be contiguous");
-  THArgCheck(THNN_(checkKeysValues)(keys, values), 1, "Keys and values should have the same number of elements");
-  THArgCheck(THTensor_(isContiguous)(normalizedValues), 9, "normalizedValues vector must be contiguous");
-  long i,j,k;
+  long* rowPtr = THAlloc(sizeof(long) * (batchSize + 1));
+  THNN_(CSRBatch) batch;
+  THNN_(IndexLinear_batch)(&batch, rowPtr, keys, keysOffset, valuesData, cumSumSizes);
+  long i,j;
 
-  /* Separate cases: output dimension is == 1, or > 1
-   * This allows for some optimizations. */
-  if (outDim == 1)
+  long badKey;
+  if (THNN_(CSRBatch_checkColumns)(&batch, THTensor_(size)(weight, 0), &badKey))
+    THError("key out of bound. updateOutput: %ld not between 0 and %ld",
+            badKey, THTensor_(size)(weight, 0) - 1);
+
+  if (maxNormalize)
   {
-    THVector_(fill)(outputData, *biasData, batchSize);
-    if (maxNormalize)
+    /* Normalize the values first. When training this updates the
+     * statistics of each key in batch order: the keys are bucketed, each
+     * bucket visited in order by a single thread. */
+    THNN_(CSRPartition) part;
+    THNN_(CSRPartition_init)(&part, &batch, outDim);
+    long p;
+#pragma omp parallel for private(i,p) schedule(dynamic) if (part.parts > 1)
+    for (p = 0; p < part.parts; p++)
     {
-      /* Parallelize on the batch itself */
-#pragma omp parallel                                                    \
-    for private(i,j)                                                    \
-    firstprivate(outDim, keysOffset,                                    \
-                 weightData, keysData,                                  \
-                 valuesData, outputData,                                \
-                 cumSumSizesData, sizesData)                            \
-    schedule(static)                                                    \
-    if(keysSize*outDim > THNN_SPARSE_OMP_THRESHOLD && batchSize > 1)
-      for (j = 0; j < batchSize; j++)
+      long n;
+      for (n = part.partPtr[p]; n < part.partPtr[p+1]; n++)
       {
-        real* loutputData = outputData + j;
-        real val = 0;
-        real absVal = 0;
-        long offset = j == 0 ? 0 : cumSumSizesData[j - 1];
-
-        for (i = 0; i < sizesData[j]; i++)
+        i = part.order[n];
+        real val = valuesData[i];
+        real absVal = fabs(val);
+        long woffset = weightStride0*(keysData[i] + keysOffset);
+        if (train)
         {
-          long woffset = weightStride0*(keysData[offset] + keysOffset);
-          absVal = fabs(valuesData[offset]);
-          if (train)
+          if (absVal > weightData[woffset])
           {
-            if (absVal > weightData[woffset])
-            {
-              weightData[woffset] = absVal;
-              weightData[woffset+1] = 1/absVal;
-            }
-
-            /*
-             * The following can be used to scale the size of the updates
-             * depending on some rule, e.g. the frequency of a feature, ...
-             * This is used at update time.
-             * TODO: implement a smarter update scale.
-             */
-            weightData[woffset+2] = 1;
+            weightData[woffset] = absVal;
+            weightData[woffset+1] = 1/absVal;
           }
-          normalizedValuesData[offset] = (absVal > weightData[woffset] ? THNN_INDEXLINEAR_SIGN(valuesData[offset]):valuesData[offset]*weightData[woffset+1]) + weightData[woffset+3];
-          val += normalizedValuesData[offset] * weightData[woffset+maxNormalize];
-          offset++;
-        }
-        *loutputData += val;
-      }
-    }
-    else
-    {
-      /* Parallelize on the batch itself */
-#pragma omp parallel                                                    \
-    for private(i,j)                                                    \
-    firstprivate(outDim, weightData,                                    \
-                 keysData, valuesData,                                  \
-                 outputData, cumSumSizesData,                           \
-                 sizesData)                                             \
-    schedule(static)                                                    \
-    if(keysSize*outDim > THNN_SPARSE_OMP_THRESHOLD && batchSize > 1)
-      for (j = 0; j < batchSize; j++)
-      {
-        long offset = j == 0 ? 0 : cumSumSizesData[j - 1];
-        real* loutputData = outputData + j;
-        real val = 0;
 
-        for (i = 0; i < sizesData[j]; i++)
-        {
-          val += weightData[weightStride0*(keysData[offset] + keysOffset)] * valuesData[offset];
-          offset++;
+          /*
+           * The following can be used to scale the size of the updates
+           * depending on some rule, e.g. the frequency of a feature, ...
+           * The commented section thereafter is just an example of what can be done:
+           *
+           *```
+           * weightData[woffset+2] = weightData[woffset+2]==0?1:(weightData[woffset+2] / (weightData[woffset+2] + 1));
+           * real alpha = 1;
+           * real beta = 0.01;
+           * real gamma = 1 - 0.000001;
+           * real l = weightData[woffset+2]==0?1/gamma:(weightData[woffset+2] - beta) / (alpha - beta);
+           * l = gamma*l;
+           * weightData[woffset+2] = (alpha-beta)*l + beta;
+           * ```
+           *
+           * TODO: implement a smarter update scale.
+           */
+          weightData[woffset+2] = 1;
         }
-        *loutputData += val;
+
+        /* Normalize + Clamp */
+        normalizedValuesData[i] = (absVal > weightData[woffset] ? THNN_INDEXLINEAR_SIGN(val):val*weightData[woffset+1]) + weightData[woffset+3];
       }
     }
+    THNN_(CSRPartition_free)(&part);
+    batch.values = normalizedValuesData;
   }
-  else {
-#pragma omp parallel                                                    \
-    for private(i,j,k)                                                  \
-    firstprivate(outDim, weightData,                                    \
-                 keysData, valuesData,                                  \
-                 biasData, outputData,                                  \
-                 cumSumSizesData, sizesData)                            \
-    schedule(static)                                                    \
-    if(keysSize*outDim > THNN_SPARSE_OMP_THRESHOLD && batchSize > 1)
-    for (j = 0; j < batchSize; j++)
-    {
-      long offset = j == 0 ? 0 : cumSumSizesData[j -  1];
-      real val = 0;
-      real* loutputData = outputData + j*outDim;
-      real* lweightData = weightData;
-      memcpy(loutputData, biasData, outDim*sizeof(real));
-      for (i = 0; i < sizesData[j]; i++)
-      {
-        real val;
-        long woffset = weightStride0*(keysData[offset] + keysOffset);
-        if (maxNormalize)
-        {
-          val = valuesData[offset];
-          real absVal = fabs(val);
-          if (train)
-          {
-            if (absVal > weightData[woffset])
-            {
-              weightData[woffset] = absVal;
-              weightData[woffset+1] = 1/absVal;
-            }
-
-            /*
-             * The following can be used to scale the size of the updates
-             * depending on some rule, e.g. the frequency of a feature, ...
-             * The commented section thereafter is just an example of what can be done:
-             *
-             *```
-             * weightData[woffset+2] = weightData[woffset+2]==0?1:(weightData[woffset+2] / (weightData[woffset+2] + 1));
-             * real alpha = 1;
-             * real beta = 0.01;
-             * real gamma = 1 - 0.000001;
-             * real l = weightData[woffset+2]==0?1/gamma:(weightData[woffset+2] - beta) / (alpha - beta);
-             * l = gamma*l;
-             * weightData[woffset+2] = (alpha-beta)*l + beta;
-             * ```
-             *
-             * TODO: implement a smarter update scale.
-             */
-            weightData[woffset+2] = 1;
-          }
 
-          /* Normalize + Clamp */
-          val = (absVal > weightData[woffset] ? THNN_INDEXLINEAR_SIGN(val):val*weightData[woffset+1]) + weightData[woffset+3];
-          normalizedValuesData[offset] = val;
-
-          lweightData = weightData + woffset + maxNormalize;
-        }
-        else
-        {
-          val = valuesData[offset];
-          lweightData = weightData + woffset;
-        }
-        if (outDim > THNN_SPARSE_OUTDIM_THRESHOLD)
-        {
-          THBlas_(axpy)(outDim, val, lweightData, 1, loutputData, 1);
-        }
-        else
-        {
-          for (k=0; k < outDim; k++)
-          {
-            loutputData[k] += lweightData[k] * val;
-          }
-        }
-        offset++;
-      }
-    }
+  real* signedValuesData = NULL;
+  if (signs)
+  {
+    signedValuesData = THAlloc(sizeof(real) * keysSize);
+#pragma omp parallel for private(i) if (keysSize > THNN_SPARSE_OMP_THRESHOLD)
+    for (i = 0; i < keysSize; i++)
+      signedValuesData[i] = batch.values[i] * signs[i];
+    batch.values = signedValuesData;
   }
-  return;
+
+  /* output = bias + batch * weight, in parallel over tiles of the batch
+   * and of the output columns */
+  THNN_(CSRBatch_multiply)(&batch, weightData + maxNormalize, weightStride0, 1,
+                           outDim, biasData, outputData);
+  THFree(signedValuesData);
+  THFree(rowPtr);
+}
+
+void THNN_(IndexLinear_updateOutput)(
+          THNNState *state,
+          THLongTensor *keys,
+          long keysOffset,
+          THTensor *values,
+          THLongTensor *sizes,
+          THLongTensor *cumSumSizes,
+          THTensor *output,
+          THTensor *weight,
+          THTensor *bias,
+          THTensor *normalizedValues,
+          int  train)
+{
+  THNN_(IndexLinear_forward)(keys, keysOffset, values, sizes, cumSumSizes, output,
+                             weight, bias, normalizedValues, train, NULL);
+}
+
+void THNN_(HashedIndexLinear_updateOutput)(
+          THNNState *state,
+          THLongTensor *keys,
+          long keysOffset,
+          THTensor *values,
+          THLongTensor *sizes,
+          THLongTensor *cumSumSizes,
+          THTensor *output,
+          THTensor *weight,
+          THTensor *bias,
+          THTensor *normalizedValues,
+          THLongTensor *hashedKeys,
+          int  train,
+          long hashSeed,
+          int  signHash)
+{
+  /* The rows of the keys are kept in hashedKeys for updateParameters */
+  real* signs = THNN_(IndexLinear_hash)(keys, keysOffset, THTensor_(size)(weight, 0),
+                                        hashSeed, signHash, hashedKeys);
+  THNN_(IndexLinear_forward)(hashedKeys, 0, values, sizes, cumSumSizes, output,
+                             weight, bias, normalizedValues, train, signs);
+  THFree(signs);
 }
 
 void THNN_(IndexLinear_updateParameters)(
@@ -271,68 +311,48 @@ void THNN_(IndexLinear_updateParameters)(
   THArgCheck(THTensor_(isContiguous)(bias), 4, "gradBias vector must be contiguous");
   THArgCheck(THLongTensor_isContiguous(runningKeys), 5, "keys vector must be contiguous");
 
-  int j,k;
-  long offset = 0;
-
   /* Update the bias first */
   THVector_(cadd)(biasData, biasData, gradBiasData, -learningRate, outDim);
 
-  /* Separate cases: output dimension is == 1, or > 1
-   * This allows for some optimizations.
-   * No multithreading here as this could
-   * corrupt the results (hogwild style) */
-  if (outDim == 1)
+  /* A key may come up several times: the updates are bucketed by key, each
+   * bucket applied in order by a single thread, so that no two threads
+   * update the same weights. */
+  long parts = THNN_(sparse_parts)(keysSize, outDim);
+  long* partPtr = THAlloc(sizeof(long) * (parts + 1));
+  long* order = THAlloc(sizeof(long) * keysSize);
+  THNN_(sparse_partition)(keysData, keysOffset, keysSize, parts, partPtr, order);
+  long p;
+
+#pragma omp parallel for schedule(dynamic) if (parts > 1) private(p)
+  for (p = 0; p < parts; p++)
   {
-    if (maxNormalize)
+    long n, k;
+    for (n = partPtr[p]; n < partPtr[p+1]; n++)
     {
-      if (weightDecay)
+      long j = order[n];
+      long woffset = weightStride0*(keysData[j] + keysOffset);
+
+      /* Separate cases: output dimension is == 1, or > 1
+       * This allows for some optimizations. */
+      if (outDim == 1)
       {
-        for (j = 0; j < keysSize; j++)
+        if (maxNormalize)
         {
-          long woffset = weightStride0*(keysData[j] + keysOffset) + maxNormalize;
+          woffset += maxNormalize;
           real lr = learningRate*weightData[woffset-2];
           weightData[woffset-1] -= weightData[woffset]*gradWeightData[2*j]*lr;
           weightData[woffset] -= gradWeightData[2*j+1]*lr - weightDecay * weightData[woffset-2] * weightData[woffset];
         }
-      }
-      else
-      {
-        for (j = 0; j < keysSize; j++)
-        {
-          long woffset = weightStride0*(keysData[j] + keysOffset) + maxNormalize;
-          real lr = learningRate*weightData[woffset-2];
-          weightData[woffset-1] -= weightData[woffset]*gradWeightData[2*j]*lr;
-          weightData[woffset] -= gradWeightData[2*j+1]*lr;
-        }
-      }
-    }
-    else
-    {
-      if (weightDecay)
-      {
-        for (j = 0; j < keysSize; j++)
+        else
         {
-          long woffset = weightStride0*(keysData[j] + keysOffset);
           weightData[woffset] -= gradWeightData[j]*learningRate + weightDecay * weightData[woffset];
         }
+        continue;
       }
-      else
-      {
-        for (j = 0; j < keysSize; j++)
-        {
-          weightData[weightStride0*(keysData[j] + keysOffset)] -= gradWeightData[j]*learningRate;
-        }
-      }
-    }
-  }
-  else
-  {
-    for (j = 0; j < keysSize; j++)
-    {
+
       real lr = learningRate;
       real wd = weightDecay;
       real* lweightData;
-      long woffset = weightStride0*(keysData[j] + keysOffset);
       real* lgradWeightData = gradWeightData + j*outDim;
       if (maxNormalize)
       {
@@ -378,11 +398,15 @@ void THNN_(IndexLinear_updateParameters)(
       }
     }
   }
+
+  THFree(partPtr);
+  THFree(order);
 }
 
 
-void THNN_(IndexLinear_accUpdateGradParameters)(
-          THNNState *state,
+/* accUpdateGradParameters, the values of the keys being multiplied by
+ * signs if not NULL. */
+static void THNN_(IndexLinear_accUpdate)(
           THLongTensor *keys,
           long keysOffset,
           THTensor *values,
@@ -391,14 +415,12 @@ void THNN_(IndexLinear_accUpdateGradParameters)(
           THTensor *gradOutput,
           THTensor *weight,
           THTensor *bias,
-          accreal weightDecay_,
-          accreal scale_)
+          real weightDecay,
+          real scale,
+          const real *signs)
 {
-  real weightDecay = TH_CONVERT_ACCREAL_TO_REAL(weightDecay_);
-  real scale = TH_CONVERT_ACCREAL_TO_REAL(scale_);
   /* Retrieve all the dimensions of the problem */
   long batchSize = THLongTensor_size(sizes, 0);
-  long keysSize = THLongTensor_size(keys, 0);
   long outDim = THTensor_(size)(bias, 0);
   long woutDim = THTensor_(size)(weight, 1);
   int maxNormalize = woutDim - outDim;
@@ -410,9 +432,7 @@ void THNN_(IndexLinear_accUpdateGradParameters)(
   real* weightData = THTensor_(data)(weight);
   real* biasData = THTensor_(data)(bias);
   long weightStride0 = weight->stride[0];
-  long biasStride = bias->stride[0];
   long* keysData = THLongTensor_data(keys);
-  long* sizesData = THLongTensor_data(sizes);
 
   /* Make sure these inputs are contiguous to accelerate computations */
   THArgCheck(THLongTensor_isContiguous(keys), 1, "keys vector must be contiguous");
@@ -421,173 +441,196 @@ void THNN_(IndexLinear_accUpdateGradParameters)(
   THArgCheck(THTensor_(isContiguous)(weight), 7, "weight matrix must be contiguous");
   THArgCheck(THTensor_(isContiguous)(bias), 8, "bias matrix must be contiguous");
 
-  int i,j,k;
+  long* rowPtr = THAlloc(sizeof(long) * (batchSize + 1));
+  THNN_(CSRBatch) batch;
+  THNN_(IndexLinear_batch)(&batch, rowPtr, keys, keysOffset, valuesData, cumSumSizes);
 
-  /* Separate cases: output dimension is == 1, or > 1
-   * This allows for some optimizations.
-   * No multithreading here as this could
-   * corrupt the results (hogwild style) */
-  if (outDim == 1)
+  long j;
+  for (j = 0; j < batchSize; j++)
   {
-    if (maxNormalize)
+    THVector_(cadd)(biasData, biasData, gradOutputData + j*outDim, -scale, outDim);
+  }
+
+  /* A key may come up several times: the updates are bucketed by key, each
+   * bucket applied in batch order by a single thread, so that no two
+   * threads update the same weights. */
+  THNN_(CSRPartition) part;
+  THNN_(CSRPartition_init)(&part, &batch, outDim);
+  long p;
+
+#pragma omp parallel for schedule(dynamic) if (part.parts > 1) private(p)
+  for (p = 0; p < part.parts; p++)
+  {
+    long n, k;
+    for (n = part.partPtr[p]; n < part.partPtr[p+1]; n++)
     {
-        long offset = 0;
-        for (j = 0; j < batchSize; j++)
-        {
-          real* lgradOutputData = gradOutputData + j;
-          *biasData -= *lgradOutputData * scale;
-          real val = *lgradOutputData * scale;
-          real* lweightData = weightData;
-          for (i = 0; i < sizesData[j]; i++)
-          {
-            long idx = weightStride0*(keysData[offset] + keysOffset) + maxNormalize;
-            weightData[idx-1] -= weightData[idx]*val*weightData[idx-2];
-            weightData[idx] -= (val*valuesData[offset] - weightDecay * weightData[idx])*weightData[idx-2];
-            offset++;
-          }
-        }
+      long i = part.order[n];
+      real* lgradOutputData = gradOutputData + part.rows[i]*outDim;
+      real lscale = signs ? scale * signs[i] : scale;
 
-        offset = 0;
-        for (j = 0; j < batchSize; j++)
+      /* Separate cases: output dimension is == 1, or > 1
+       * This allows for some optimizations. */
+      if (outDim == 1)
+      {
+        real val = *lgradOutputData * lscale;
+        long idx = weightStride0*(keysData[i] + keysOffset) + maxNormalize;
+        if (maxNormalize)
         {
-          real* lweightData = weightData;
-          for (i = 0; i < sizesData[j]; i++)
-          {
-            long idx = weightStride0*(keysData[offset] + keysOffset) + maxNormalize;
-            weightData[idx-2] = 0;
-            offset++;
-          }
+          weightData[idx-1] -= weightData[idx]*val*weightData[idx-2];
+          weightData[idx] -= (val*valuesData[i] - weightDecay * weightData[idx])*weightData[idx-2];
         }
-    }
-    else
-    {
-      if (weightDecay)
-      {
-        long offset = 0;
-        for (j = 0; j < batchSize; j++)
+        else
         {
-          real* lgradOutputData = gradOutputData + j;
-          *biasData -= *lgradOutputData * scale;
-          real val = *lgradOutputData * scale;
-          real* lweightData = weightData;
-          for (i = 0; i < sizesData[j]; i++)
-          {
-            long idx = weightStride0*(keysData[offset] + keysOffset);
-            weightData[idx] -= val * valuesData[offset] + weightData[idx] * weightDecay;
-            offset++;
-          }
+          weightData[idx] -= val * valuesData[i] + weightData[idx] * weightDecay;
         }
+        continue;
       }
-      else
+
+      real val = valuesData[i] * lscale;
+      real wd = weightDecay;
+      real* lweightData;
+
+      // Max normalize case
+      if (maxNormalize)
       {
-        long offset = 0;
-        for (j = 0; j < batchSize; j++)
+        lweightData = weightData + weightStride0*(keysData[i] + keysOffset) + (maxNormalize-2);
+        val *= lweightData[0];
+        wd *= lweightData[0];
+        for (k=0; k < outDim; k++)
         {
-          real val = gradOutputData[j] * scale;
-          for (i = 0; i < sizesData[j]; i++)
-          {
-            weightData[(keysData[offset] + keysOffset)*weightStride0] -= val * valuesData[offset];
-            offset++;
-          }
-          *biasData -= val;
+          lweightData[1] -= lweightData[k+2]*lscale*lgradOutputData[k]*lweightData[0];
         }
+        lweightData += 2;
       }
-    }
-  }
-  else {
-    long offset = 0;
-    for (j = 0; j < batchSize; j++)
-    {
-      real val = 0;
-      real* lgradOutputData = gradOutputData + j*outDim;
-      real* lweightData = weightData;
-      THVector_(cadd)(biasData, biasData, lgradOutputData, -scale, outDim);
-      for (i = 0; i < sizesData[j]; i++)
+      else
       {
-        real val = valuesData[offset] * scale;
-        real wd = weightDecay;
+        lweightData = weightData + weightStride0*(keysData[i] + keysOffset);
+      }
 
-        // Max normalize case
-        if (maxNormalize)
+      /* We do sparse weight decay.
+       * We think it makes more sense. */
+      if (weightDecay)
+      {
+        if (outDim > THNN_SPARSE_OUTDIM_THRESHOLD)
         {
-          lweightData = weightData + weightStride0*(keysData[offset] + keysOffset) + (maxNormalize-2);
-          val *= lweightData[0];
-          wd *= lweightData[0];
-          for (k=0; k < outDim; k++)
-          {
-            lweightData[1] -= lweightData[k+2]*scale*lgradOutputData[k]*lweightData[0];
-          }
-          lweightData += 2;
+          THBlas_(axpy)(outDim, -wd, lweightData, 1, lweightData, 1);
         }
         else
         {
-          lweightData = weightData + weightStride0*(keysData[offset] + keysOffset);
-        }
-
-        /* We do sparse weight decay.
-         * We think it makes more sense. */
-        if (weightDecay)
-        {
-          if (outDim > THNN_SPARSE_OUTDIM_THRESHOLD)
-          {
-            THBlas_(axpy)(outDim, -wd, lweightData, 1, lweightData, 1);
-          }
-          else
+          for (k=0; k < outDim; k++)
           {
-            for (k=0; k < outDim; k++)
-            {
-              lweightData[k] -= wd * lweightData[k];
-            }
+            lweightData[k] -= wd * lweightData[k];
           }
         }
+      }
 
-        if (outDim > THNN_SPARSE_OUTDIM_THRESHOLD)
+      if (outDim > THNN_SPARSE_OUTDIM_THRESHOLD)
+      {
+        THBlas_(axpy)(outDim, -val, lgradOutputData, 1, lweightData, 1);
+      }
+      else
+      {
+        for (k=0; k < outDim; k++)
         {
-          THBlas_(axpy)(outDim, -val, lgradOutputData, 1, lweightData, 1);
+          lweightData[k] -= val * lgradOutputData[k];
         }
-        else
-        {
-          for (k=0; k < outDim; k++)
-          {
-            lweightData[k] -= val * lgradOutputData[k];
-          }
-        }
-        offset++;
       }
     }
+  }
+
+  /* Max Normalize case with a single output: reset the smart update
+   * scaling once all the updates are done. */
+  if (outDim == 1 && maxNormalize)
+  {
+#pragma omp parallel for schedule(dynamic) if (part.parts > 1) private(p)
+    for (p = 0; p < part.parts; p++)
+    {
+      long n;
+      for (n = part.partPtr[p]; n < part.partPtr[p+1]; n++)
+      {
+        long i = part.order[n];
+        weightData[weightStride0*(keysData[i] + keysOffset) + maxNormalize - 2] = 0;
+      }
+    }
+  }
 
-    /* Max Normalize case:
-     * Reset the smart update scaling if
-     * one does it batch-wise.
-     * TODO: Decide what to do with that piece of code.
-     * NB: If the code belowe is uncommented, so should the commented
-     * code in IndexLinear:zeroGradParameters() */
+  /* Max Normalize case:
+   * Reset the smart update scaling if
+   * one does it batch-wise.
+   * TODO: Decide what to do with that piece of code.
+   * NB: If the code belowe is uncommented, so should the commented
+   * code in IndexLinear:zeroGradParameters() */
 
-    /*
-    if (maxNormalize)
+  /*
+  if (maxNormalize)
+  {
+    offset = 0;
+    for (j = 0; j < batchSize; j++)
     {
-      offset = 0;
-      for (j = 0; j < batchSize; j++)
+      real* lweightData = weightData;
+      for (i = 0; i < sizesData[j]; i++)
       {
-        real* lweightData = weightData;
-        for (i = 0; i < sizesData[j]; i++)
-        {
-          real val = valuesData[offset] * scale;
-          real wd = weightDecay;
+        real val = valuesData[offset] * scale;
+        real wd = weightDecay;
 
-          lweightData = weightData + weightStride0*(keysData[offset] + keysOffset) + (maxNormalize-2);
-          lweightData[0] = 0;
-          offset++;
-        }
+        lweightData = weightData + weightStride0*(keysData[offset] + keysOffset) + (maxNormalize-2);
+        lweightData[0] = 0;
+        offset++;
       }
     }
-    */
   }
-  return;
+  */
+
+  THNN_(CSRPartition_free)(&part);
+  THFree(rowPtr);
 }
 
-void THNN_(IndexLinear_accGradParameters)(
+void THNN_(IndexLinear_accUpdateGradParameters)(
           THNNState *state,
+          THLongTensor *keys,
+          long keysOffset,
+          THTensor *values,
+          THLongTensor *sizes,
+          THLongTensor *cumSumSizes,
+          THTensor *gradOutput,
+          THTensor *weight,
+          THTensor *bias,
+          accreal weightDecay_,
+          accreal scale_)
+{
+  THNN_(IndexLinear_accUpdate)(keys, keysOffset, values, sizes, cumSumSizes, gradOutput,
+                               weight, bias, TH_CONVERT_ACCREAL_TO_REAL(weightDecay_),
+                               TH_CONVERT_ACCREAL_TO_REAL(scale_), NULL);
+}
+
+void THNN_(HashedIndexLinear_accUpdateGradParameters)(
+          THNNState *state,
+          THLongTensor *keys,
+          long keysOffset,
+          THTensor *values,
+          THLongTensor *sizes,
+          THLongTensor *cumSumSizes,
+          THTensor *gradOutput,
+          THTensor *weight,
+          THTensor *bias,
+          accreal weightDecay_,
+          accreal scale_,
+          long hashSeed,
+          int  signHash)
+{
+  THLongTensor* hashedKeys = THLongTensor_new();
+  real* signs = THNN_(IndexLinear_hash)(keys, keysOffset, THTensor_(size)(weight, 0),
+                                        hashSeed, signHash, hashedKeys);
+  THNN_(IndexLinear_accUpdate)(hashedKeys, 0, values, sizes, cumSumSizes, gradOutput,
+                               weight, bias, TH_CONVERT_ACCREAL_TO_REAL(weightDecay_),
+                               TH_CONVERT_ACCREAL_TO_REAL(scale_), signs);
+  THFree(signs);
+  THLongTensor_free(hashedKeys);
+}
+
+/* accGradParameters, the values of the keys being multiplied by signs if
+ * not NULL. */
+static void THNN_(IndexLinear_accGrad)(
           THLongTensor *keys,
           long keysOffset,
           THTensor *values,
@@ -599,11 +642,10 @@ void THNN_(IndexLinear_accGradParameters)(
           THTensor *weight,
           THTensor *bias,
           THTensor *valuesBuffer,
-          accreal weightDecay_,
-          accreal scale_)
+          real weightDecay,
+          real scale,
+          const real *signs)
 {
-  real weightDecay = TH_CONVERT_ACCREAL_TO_REAL(weightDecay_);
-  real scale = TH_CONVERT_ACCREAL_TO_REAL(scale_);
   /* Retrieve all the dimensions of the problem */
   long batchSize = THLongTensor_size(sizes, 0);
   long keysSize = THLongTensor_size(keys, 0);
@@ -611,12 +653,6 @@ void THNN_(IndexLinear_accGradParameters)(
   long woutDim = THTensor_(size)(weight, 1);
   long maxNormalize = (woutDim - outDim) > 0 ?1:0;
   THArgCheck(THNN_(checkKeysValues)(keys, values), 1, "Keys and values should have the same number of elements");
-  long* sizesData = THLongTensor_data(sizes);
-
-  /* COmpute the cumulative sizes */
-  THLongTensor* cumSizes = THLongTensor_new();
-  THLongTensor_cumsum(cumSizes, sizes, 0);
-  long* cumSizesData = THLongTensor_data(cumSizes);
 
   /* Resize the gradWeight buffer to keep it dense.
    * That speeds up updates A LOT assuming random mem access. */
@@ -626,11 +662,7 @@ void THNN_(IndexLinear_accGradParameters)(
   real* gradOutputData = THTensor_(data)(gradOutput);
   real* valuesData =THTensor_(data)(values);
   real* gradWeightData = THTensor_(data)(gradWeight);
-  real* weightData = THTensor_(data)(weight);
   real* gradBiasData = THTensor_(data)(gradBias);
-  long gradWeightStride0 = gradWeight->stride[0];
-  long weightStride0 = weight->stride[0];
-  long* keysData = THLongTensor_data(keys);
 
   /* Make sure these inputs are contiguous to accelerate computations */
   THArgCheck(THLongTensor_isContiguous(keys), 1, "keys vector must be contiguous");
@@ -642,21 +674,27 @@ void THNN_(IndexLinear_accGradParameters)(
   THArgCheck(THTensor_(isContiguous)(bias), 10, "bias vector must be contiguous");
   THArgCheck(THTensor_(isContiguous)(valuesBuffer), 11, "valuesBuffer must be contiguous");
 
-  int i,j,k;
+  long* rowPtr = THAlloc(sizeof(long) * (batchSize + 1));
+  THNN_(CSRBatch) batch;
+  THNN_(IndexLinear_batch)(&batch, rowPtr, keys, keysOffset, valuesData, cumSumSizes);
+
+  long i,j,k;
 
-  /* Separate cases: output dimension is == 1, or > 1
-   * This allows for some optimizations.
-   * No multithreading here as this could
-   * corrupt the results (hogwild style) */
+  /* The gradient is kept dense: a row per key of the batch, so the rows
+   * of the batch write disjoint parts of it and run in parallel.
+   * Separate cases: output dimension is == 1, or > 1
+   * This allows for some optimizations. */
   if (outDim == 1)
   {
+#pragma omp parallel for private(i,j) schedule(static) \
+    if(keysSize > THNN_SPARSE_OMP_THRESHOLD && batchSize > 1)
     for (j = 0; j < batchSize; j++)
     {
-      long offset = j==0?0:cumSizesData[j-1];
+      long offset = rowPtr[j];
       real val = gradOutputData[j] * scale;
       real* lgradWeightData = gradWeightData + offset;
       real* lvaluesData = valuesData + offset;
-      long end = sizesData[j];
+      long end = rowPtr[j+1] - offset;
 
       if (maxNormalize)
       {
@@ -684,38 +722,47 @@ void THNN_(IndexLinear_accGradParameters)(
           lgradWeightData[i] = val * lvaluesData[i];
         }
       }
-      *gradBiasData += val;
-      offset += end;
+
+      if (signs)
+      {
+        long width = maxNormalize ? 2 : 1;
+        for (i = 0; i < end*width; i++)
+        {
+          lgradWeightData[i] *= signs[offset + i/width];
+        }
+      }
+    }
+    for (j = 0; j < batchSize; j++)
+    {
+      *gradBiasData += gradOutputData[j] * scale;
     }
   }
   else {
+#pragma omp parallel for private(i,j,k) schedule(static) \
+    if(keysSize*outDim > THNN_SPARSE_OMP_THRESHOLD && batchSize > 1)
     for (j = 0; j < batchSize; j++)
     {
-      long offset = j==0?0:cumSizesData[j-1];
-      real val = 0;
       real* lgradOutputData = gradOutputData + j*outDim;
-      real* lgradWeightData = gradWeightData;
-      real* lweightData = weightData;
-      THVector_(cadd)(gradBiasData, gradBiasData, lgradOutputData, scale, outDim);
-      for (i = 0; i < sizesData[j]; i++)
+      for (i = rowPtr[j]; i < rowPtr[j+1]; i++)
       {
-        real val = valuesData[offset] * scale;
-        lgradWeightData = gradWeightData + offset*outDim;
+        real lscale = signs ? scale * signs[i] : scale;
+        real val = valuesData[i] * lscale;
+        real* lgradWeightData = gradWeightData + i*outDim;
         if (maxNormalize)
         {
-          lgradWeightData += offset*outDim;
+          lgradWeightData += i*outDim;
           k = 0;
           for(;k < outDim-4; k += 4)
           {
-            lgradWeightData[k] = lgradOutputData[k]*scale;
-            lgradWeightData[k+1] = lgradOutputData[k+1]*scale;
-            lgradWeightData[k+2] = lgradOutputData[k+2]*scale;
-            lgradWeightData[k+3] = lgradOutputData[k+3]*scale;
+            lgradWeightData[k] = lgradOutputData[k]*lscale;
+            lgradWeightData[k+1] = lgradOutputData[k+1]*lscale;
+            lgradWeightData[k+2] = lgradOutputData[k+2]*lscale;
+            lgradWeightData[k+3] = lgradOutputData[k+3]*lscale;
           }
 
           for(; k < outDim; k++)
           {
-            lgradWeightData[k] = lgradOutputData[k]*scale;
+            lgradWeightData[k] = lgradOutputData[k]*lscale;
           }
           lgradWeightData += outDim;
         }
@@ -732,11 +779,72 @@ void THNN_(IndexLinear_accGradParameters)(
         {
           lgradWeightData[k] = val * lgradOutputData[k];
         }
-        offset++;
       }
     }
+    for (j = 0; j < batchSize; j++)
+    {
+      THVector_(cadd)(gradBiasData, gradBiasData, gradOutputData + j*outDim, scale, outDim);
+    }
   }
-  THLongTensor_free(cumSizes);
+  THFree(rowPtr);
   return;
 }
+
+void THNN_(IndexLinear_accGradParameters)(
+          THNNState *state,
+          THLongTensor *keys,
+          long keysOffset,
+          THTensor *values,
+          THLongTensor *sizes,
+          THLongTensor *cumSumSizes,
+          THTensor *gradOutput,
+          THTensor *gradWeight,
+          THTensor *gradBias,
+          THTensor *weight,
+          THTensor *bias,
+          THTensor *valuesBuffer,
+          accreal weightDecay_,
+          accreal scale_)
+{
+  THNN_(IndexLinear_accGrad)(keys, keysOffset, values, sizes, cumSumSizes, gradOutput,
+                             gradWeight, gradBias, weight, bias, valuesBuffer,
+                             TH_CONVERT_ACCREAL_TO_REAL(weightDecay_),
+                             TH_CONVERT_ACCREAL_TO_REAL(scale_), NULL);
+}
+
+void THNN_(HashedIndexLinear_accGradParameters)(
+          THNNState *state,
+          THLongTensor *keys,
+          long keysOffset,
+          THTensor *values,
+          THLongTensor *sizes,
+          THLongTensor *cumSumSizes,
+          THTensor *gradOutput,
+          THTensor *gradWeight,
+          THTensor *gradBias,
+          THTensor *weight,
+          THTensor *bias,
+          THTensor *valuesBuffer,
+          accreal weightDecay_,
+          accreal scale_,
+          long hashSeed,
+          int  signHash)
+{
+  /* The gradient has a row per key of the batch, whatever its weight row:
+   * only the signs depend on the hash. */
+  real* signs = NULL;
+  if (signHash)
+  {
+    long n = THLongTensor_size(keys, 0);
+    THArgCheck(THLongTensor_isContiguous(keys), 1, "keys vector must be contiguous");
+    signs = THAlloc(sizeof(real) * n);
+    THNN_(IndexLinear_hashKeys)(THLongTensor_data(keys), keysOffset, n, 1,
+                                hashSeed, NULL, signs);
+  }
+  THNN_(IndexLinear_accGrad)(keys, keysOffset, values, sizes, cumSumSizes, gradOutput,
+                             gradWeight, gradBias, weight, bias, valuesBuffer,
+                             TH_CONVERT_ACCREAL_TO_REAL(weightDecay_),
+                             TH_CONVERT_ACCREAL_TO_REAL(scale_), signs);
+  THFree(signs);
+}
 #endif
@@ -11,7 +11,7 @@ void THNN_(LogSigmoid_updateOutput)(
   THTensor_(resizeAs)(output, input);
   THTensor_(resizeAs)(buffer, input);
 
-  TH_TENSOR_APPLY3(real, output, real, input, real, buffer,
+  THNN_TENSOR_APPLY3(real, output, real, input, real, buffer,
     real z = exp(-*input_data);
     *buffer_data = z;
     *output_data = -log(1. + z);
@@ -27,7 +27,7 @@ void THNN_(LogSigmoid_updateGradInput)(
 {
   THNN_CHECK_NELEMENT(input, gradOutput);
   THTensor_(resizeAs)(gradInput, buffer);
-  TH_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, buffer,
+  THNN_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, buffer,
     real z = *buffer_data;
     *gradInput_data = *gradOutput_data * z / (1. + z);
   );
@@ -41,28 +41,52 @@ void THNN_(LogSoftMax_updateOutput)(
   input = THTensor_(newContiguous)(input);
   THTensor_(resizeAs)(output, input);
 
-  real *input_data0 = THTensor_(data)(input);
-  real *output_data0 = THTensor_(data)(output);
+  input_data = THTensor_(data)(input);
+  output_data = THTensor_(data)(output);
 
-  accreal logsum;
-  real maxInput;
-  #pragma omp parallel for private(t, d, maxInput, logsum, input_data, output_data)
-  for (t = 0; t < stride*nframe; t++)
+  if (stride == 1)
   {
-    logsum = 0;
-    maxInput = -THInf;
-    input_data = input_data0 + (t/stride)*dim*stride + t % stride;
-    output_data = output_data0 + (t/stride)*dim*stride + t % stride;
-
-    for (d = 0; d < dim; d++)
-      maxInput = THMax(maxInput, input_data[d*stride]);
-
-    for (d = 0; d < dim; d++)
-      logsum += exp(input_data[d*stride] - maxInput);
-    logsum = maxInput + log(logsum);
-
-    for (d = 0; d < dim; d++)
-      output_data[d*stride] = input_data[d*stride] - logsum;
+#pragma omp parallel for private(t, d) if (nframe*dim > THNN_SOFTMAX_OMP_THRESHOLD)
+    for (t = 0; t < nframe; t++)
+    {
+      real *input_ptr = input_data + t*dim;
+      real *output_ptr = output_data + t*dim;
+      real maxInput, logsum;
+      accreal sum;
+
+      // x - max is exact for the largest inputs, unlike x - (max + log(sum))
+      THNN_(softmax_rowMaxSum)(input_ptr, dim, &maxInput, &sum);
+      logsum = log(sum);
+      for (d = 0; d < dim; d++)
+        output_ptr[d] = (input_ptr[d] - maxInput) - logsum;
+    }
+  }
+  else
+  {
+    ptrdiff_t nblock = (stride + THNN_SOFTMAX_BLOCK - 1) / THNN_SOFTMAX_BLOCK;
+
+#pragma omp parallel for private(t, d) if (nframe*dim*stride > THNN_SOFTMAX_OMP_THRESHOLD)
+    for (t = 0; t < nframe*nblock; t++)
+    {
+      ptrdiff_t s0 = (t % nblock) * THNN_SOFTMAX_BLOCK;
+      ptrdiff_t len = stride - s0 < THNN_SOFTMAX_BLOCK ? stride - s0 : THNN_SOFTMAX_BLOCK;
+      real *input_ptr = input_data + (t/nblock)*dim*stride + s0;
+      real *output_ptr = output_data + (t/nblock)*dim*stride + s0;
+      real maxInput[THNN_SOFTMAX_BLOCK], logsum[THNN_SOFTMAX_BLOCK];
+      accreal sum[THNN_SOFTMAX_BLOCK];
+      ptrdiff_t s;
+
+      THNN_(softmax_lanesMaxSum)(input_ptr, dim, stride, len, maxInput, sum);
+      for (s = 0; s < len; s++)
+        logsum[s] = log(sum[s]);
+      for (d = 0; d < dim; d++)
+      {
+        real *in = input_ptr + d*stride;
+        real *out = output_ptr + d*stride;
+        for (s = 0; s < len; s++)
+          out[s] = (in[s] - maxInput[s]) - logsum[s];
+      }
+    }
   }
 
   THTensor_(free)(input);
@@ -111,23 +135,56 @@ void THNN_(LogSoftMax_updateGradInput)(
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
   THTensor_(resizeAs)(gradInput, output);
-  real *gradInput_data0 = THTensor_(data)(gradInput);
-  real *output_data0 = THTensor_(data)(output);
-  real *gradOutput_data0 = THTensor_(data)(gradOutput);
-  accreal sum;
-  #pragma omp parallel for private(t, sum, d, gradInput_data, output_data, gradOutput_data)
-  for (t = 0; t < stride*nframe; t++)
-  {
-    sum = 0;
-    gradInput_data = gradInput_data0 + (t/stride)*dim*stride + t % stride;
-    output_data = output_data0 + (t/stride)*dim*stride + t % stride;
-    gradOutput_data = gradOutput_data0 + (t/stride)*dim*stride + t % stride;
-
-    for (d = 0; d < dim; d++)
-      sum += gradOutput_data[d*stride];
+  gradInput_data = THTensor_(data)(gradInput);
+  output_data = THTensor_(data)(output);
+  gradOutput_data = THTensor_(data)(gradOutput);
 
-    for (d = 0; d < dim; d++)
-      gradInput_data[d*stride] = gradOutput_data[d*stride] - exp(output_data[d*stride])*sum;
+  if (stride == 1)
+  {
+#pragma omp parallel for private(t, d) if (nframe*dim > THNN_SOFTMAX_OMP_THRESHOLD)
+    for (t = 0; t < nframe; t++)
+    {
+      real *gradInput_ptr = gradInput_data + t*dim;
+      real *output_ptr = output_data + t*dim;
+      real *gradOutput_ptr = gradOutput_data + t*dim;
+      accreal sum = 0;
+
+      for (d = 0; d < dim; d++)
+        sum += gradOutput_ptr[d];
+      for (d = 0; d < dim; d++)
+        gradInput_ptr[d] = gradOutput_ptr[d] - THNN_(softmax_exp)(output_ptr[d])*sum;
+    }
+  }
+  else
+  {
+    ptrdiff_t nblock = (stride + THNN_SOFTMAX_BLOCK - 1) / THNN_SOFTMAX_BLOCK;
+
+#pragma omp parallel for private(t, d) if (nframe*dim*stride > THNN_SOFTMAX_OMP_THRESHOLD)
+    for (t = 0; t < nframe*nblock; t++)
+    {
+      ptrdiff_t s0 = (t % nblock) * THNN_SOFTMAX_BLOCK;
+      ptrdiff_t len = stride - s0 < THNN_SOFTMAX_BLOCK ? stride - s0 : THNN_SOFTMAX_BLOCK;
+      ptrdiff_t offset = (t/nblock)*dim*stride + s0;
+      accreal sum[THNN_SOFTMAX_BLOCK];
+      ptrdiff_t s;
+
+      for (s = 0; s < len; s++)
+        sum[s] = 0;
+      for (d = 0; d < dim; d++)
+      {
+        real *gradOut = gradOutput_data + offset + d*stride;
+        for (s = 0; s < len; s++)
+          sum[s] += gradOut[s];
+      }
+      for (d = 0; d < dim; d++)
+      {
+        real *gradIn = gradInput_data + offset + d*stride;
+        real *out = output_data + offset + d*stride;
+        real *gradOut = gradOutput_data + offset + d*stride;
+        for (s = 0; s < len; s++)
+          gradIn[s] = gradOut[s] - THNN_(softmax_exp)(out[s])*sum[s];
+      }
+    }
   }
 
   THTensor_(free)(gradOutput);
@@ -22,6 +22,248 @@ static void THNN_(LookupTable_resetCount)(
   }
 }
 
+#ifndef THNN_LOOKUP_TABLE_OMP_THRESHOLD
+#define THNN_LOOKUP_TABLE_OMP_THRESHOLD 1000
+#endif
+
+typedef struct {
+  THIndex_t key;
+  ptrdiff_t pos;
+} THNN_(LookupTableEntry);
+
+static int THNN_(compare_LookupTableEntry)(const void* a, const void* b)
+{
+  const THNN_(LookupTableEntry) *x = a, *y = b;
+  if (x->key != y->key)
+    return x->key < y->key ? -1 : 1;
+  return x->pos < y->pos ? -1 : (x->pos > y->pos);
+}
+
+static void THNN_(LookupTable_checkInput)(
+          THIndexTensor *input,
+          long numw)
+{
+  ptrdiff_t i;
+
+  if (!THIndexTensor_(isContiguous)(input))
+    THError("input must be contiguous");
+  if (THIndexTensor_(nDimension)(input) != 1 && THIndexTensor_(nDimension)(input) != 2) {
+    THDescBuff s1 = THIndexTensor_(sizeDesc)(input);
+    THError("input must be a vector or matrix, but is of shape: %s", s1.str);
+  }
+
+  THIndex_t *input_data = THIndexTensor_(data)(input);
+  ptrdiff_t numel = THIndexTensor_(nElement)(input);
+
+  // check that inputs are all within range
+  for (i=0; i<numel; i++)
+    if (input_data[i] < TH_INDEX_BASE || input_data[i] >= numw + TH_INDEX_BASE) {
+      THError("inputs need to be in the range %ld <= input < %ld, "
+	      "but got input of value: %ld", TH_INDEX_BASE, (numw + TH_INDEX_BASE),
+	      input_data[i]);
+    }
+}
+
+/*
+ * Sorts the non-padding entries of the input by row, then by position.
+ * Entries are first scattered into buckets of consecutive rows, in
+ * parallel over sections of the input, and each bucket is then sorted on
+ * its own. Fills segStart with the offset of each run of equal rows (plus
+ * the total number of entries at the end) and returns the number of runs.
+ */
+static ptrdiff_t THNN_(LookupTable_sortIndices)(
+          THIndex_t *input_data,
+          ptrdiff_t numel,
+          long numw,
+          int paddingValue,
+          THNN_(LookupTableEntry) *entries,
+          ptrdiff_t *segStart)
+{
+  int maxthreads = 1;
+#ifdef _OPENMP
+  maxthreads = omp_get_max_threads();
+#endif
+  ptrdiff_t *hist = THAlloc(sizeof(ptrdiff_t) * maxthreads * 4 * maxthreads);
+  ptrdiff_t *bucketStart = THAlloc(sizeof(ptrdiff_t) * (4 * maxthreads + 1));
+  ptrdiff_t *heads = THAlloc(sizeof(ptrdiff_t) * maxthreads);
+  ptrdiff_t nseg = 0;
+
+  #pragma omp parallel if (numel > THNN_LOOKUP_TABLE_OMP_THRESHOLD)
+  {
+    int tid = 0, nthreads = 1, t;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+    nthreads = omp_get_num_threads();
+#endif
+    long nbucket = 4 * nthreads;
+    long width = (numw + nbucket - 1) / nbucket;
+    ptrdiff_t *myhist = hist + tid * nbucket;
+    ptrdiff_t i0 = numel * tid / nthreads, i1 = numel * (tid + 1) / nthreads;
+    ptrdiff_t i, j0, j1, n, count;
+    long b;
+
+    for (b = 0; b < nbucket; b++)
+      myhist[b] = 0;
+    for (i = i0; i < i1; i++)
+      if (input_data[i] != paddingValue)
+        myhist[(input_data[i] - TH_INDEX_BASE) / width]++;
+
+    #pragma omp barrier
+    #pragma omp single
+    {
+      ptrdiff_t offset = 0;
+      for (b = 0; b < nbucket; b++) {
+        bucketStart[b] = offset;
+        for (t = 0; t < nthreads; t++) {
+          ptrdiff_t c = hist[t*nbucket + b];
+          hist[t*nbucket + b] = offset;
+          offset += c;
+        }
+      }
+      bucketStart[nbucket] = offset;
+    }
+
+    for (i = i0; i < i1; i++)
+      if (input_data[i] != paddingValue) {
+        THIndex_t k = input_data[i] - TH_INDEX_BASE;
+        THNN_(LookupTableEntry) *e = entries + myhist[k / width]++;
+        e->key = k;
+        e->pos = i;
+      }
+
+    #pragma omp barrier
+    #pragma omp for schedule(dynamic, 1)
+    for (b = 0; b < nbucket; b++)
+      qsort(entries + bucketStart[b], bucketStart[b+1] - bucketStart[b],
+            sizeof(THNN_(LookupTableEntry)), THNN_(compare_LookupTableEntry));
+
+    // find the start of each run of equal rows
+    n = bucketStart[nbucket];
+    j0 = n * tid / nthreads;
+    j1 = n * (tid + 1) / nthreads;
+    count = 0;
+    for (i = j0; i < j1; i++)
+      if (i == 0 || entries[i].key != entries[i-1].key)
+        count++;
+    heads[tid] = count;
+
+    #pragma omp barrier
+    #pragma omp single
+    {
+      for (t = 0; t < nthreads; t++) {
+        ptrdiff_t c = heads[t];
+        heads[t] = nseg;
+        nseg += c;
+      }
+      segStart[nseg] = n;
+    }
+
+    count = heads[tid];
+    for (i = j0; i < j1; i++)
+      if (i == 0 || entries[i].key != entries[i-1].key)
+        segStart[count++] = i;
+  }
+
+  THFree(hist);
+  THFree(bucketStart);
+  THFree(heads);
+  return nseg;
+}
+
+/*
+ * Sums the gradOutput rows of each run of equal rows and adds scale times
+ * the sum to row dstRow of dst, where dstRow is the row of the run or, if
+ * sparse, the index of the run. Entry pos reads row goRow[pos] of
+ * gradOutput, weighted by entryWeight[pos]; both default to pos and 1.
+ * Threads split the sorted entries evenly, whatever the length of the runs:
+ * a run shared by several threads is reduced into per-thread partial sums,
+ * which are added once all threads are done, so that each row of dst is
+ * only written by one thread at a time.
+ */
+static void THNN_(LookupTable_reduceSegments)(
+          THNN_(LookupTableEntry) *entries,
+          ptrdiff_t *segStart,
+          ptrdiff_t nseg,
+          THInteger_t *count_data,
+          real *go,
+          THIndex_t *goRow,
+          real *entryWeight,
+          real *dst,
+          long dim,
+          real scale,
+          bool sparse)
+{
+  int maxthreads = 1, slot;
+#ifdef _OPENMP
+  maxthreads = omp_get_max_threads();
+#endif
+  ptrdiff_t n = segStart[nseg];
+  real *sum = THAlloc(sizeof(real) * maxthreads * dim);
+  real *partial = THAlloc(sizeof(real) * 2 * maxthreads * dim);
+  ptrdiff_t *partialSeg = THAlloc(sizeof(ptrdiff_t) * 2 * maxthreads);
+
+  for (slot = 0; slot < 2 * maxthreads; slot++)
+    partialSeg[slot] = -1;
+
+  #pragma omp parallel if (n * dim > THNN_LOOKUP_TABLE_OMP_THRESHOLD * 64)
+  {
+    int tid = 0, nthreads = 1;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+    nthreads = omp_get_num_threads();
+#endif
+    ptrdiff_t j0 = n * tid / nthreads, j1 = n * (tid + 1) / nthreads;
+    ptrdiff_t j = j0, s = 0, lo = 0, hi = nseg - 1;
+    real *mysum = sum + tid * dim;
+
+    // last run starting at or before j0
+    while (lo < hi) {
+      ptrdiff_t mid = (lo + hi + 1) / 2;
+      if (segStart[mid] <= j0)
+        lo = mid;
+      else
+        hi = mid - 1;
+    }
+    s = lo;
+
+    for (; j < j1; s++) {
+      ptrdiff_t end = segStart[s+1] < j1 ? segStart[s+1] : j1;
+      THVector_(fill)(mysum, 0, dim);
+      for (; j < end; j++) {
+        ptrdiff_t pos = entries[j].pos;
+        THVector_(cadd)(mysum, mysum, go + (goRow ? goRow[pos] : pos)*dim,
+                        entryWeight ? entryWeight[pos] : 1, dim);
+      }
+
+      if (segStart[s] < j0 || segStart[s+1] > j1) {
+        int myslot = 2*tid + (segStart[s] < j0 ? 0 : 1);
+        memcpy(partial + myslot*dim, mysum, sizeof(real) * dim);
+        partialSeg[myslot] = s;
+      } else {
+        long k = entries[segStart[s]].key;
+        real scale_ = scale;
+        if (count_data) scale_ /= count_data[k];
+        THVector_(cadd)(dst + (sparse ? s : k)*dim, dst + (sparse ? s : k)*dim, mysum, scale_, dim);
+      }
+    }
+  }
+
+  for (slot = 0; slot < 2 * maxthreads; slot++) {
+    ptrdiff_t s = partialSeg[slot];
+    if (s >= 0) {
+      long k = entries[segStart[s]].key;
+      real scale_ = scale;
+      if (count_data) scale_ /= count_data[k];
+      THVector_(cadd)(dst + (sparse ? s : k)*dim, dst + (sparse ? s : k)*dim,
+                      partial + slot*dim, scale_, dim);
+    }
+  }
+
+  THFree(sum);
+  THFree(partial);
+  THFree(partialSeg);
+}
+
 void THNN_(LookupTable_accGradParameters)(
           THNNState *state,
           THIndexTensor *input,
@@ -35,7 +277,6 @@ void THNN_(LookupTable_accGradParameters)(
           accreal ascale)
 {
   real scale = TH_CONVERT_ACCREAL_TO_REAL(ascale);
-  ptrdiff_t i;
   THInteger_t *count_data = NULL;
 
   if (scaleGradByFreq)
@@ -46,24 +287,11 @@ void THNN_(LookupTable_accGradParameters)(
 
   if (!THTensor_(isContiguous)(gradWeight))
     THError("gradWeight must be contiguous");
-  if (!THIndexTensor_(isContiguous)(input))
-    THError("input must be contiguous");
-  if (THIndexTensor_(nDimension)(input) != 1 && THIndexTensor_(nDimension)(input) != 2) {
-    THDescBuff s1 = THIndexTensor_(sizeDesc)(input);
-    THError("input must be a vector or matrix, but is of shape: %s", s1.str);
-  }
+  long numw = THTensor_(size)(gradWeight, 0);
+  THNN_(LookupTable_checkInput)(input, numw);
 
   THIndex_t *input_data = THIndexTensor_(data)(input);
   ptrdiff_t numel = THIndexTensor_(nElement)(input);
-  long numw = THTensor_(size)(gradWeight, 0);
-
-  // check that inputs are all within range
-  for (i=0; i<numel; i++)
-    if (input_data[i] < TH_INDEX_BASE || input_data[i] >= numw + TH_INDEX_BASE) {
-      THError("inputs need to be in the range %ld <= input < %ld, "
-	      "but got input of value: %ld", TH_INDEX_BASE, (numw + TH_INDEX_BASE),
-	      input_data[i]);
-    }
 
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
@@ -74,51 +302,71 @@ void THNN_(LookupTable_accGradParameters)(
   if (count_data)
     THNN_(LookupTable_resetCount)(count_data, input);
 
-#ifdef _OPENMP
-  if (numel > 1000)
-  {
-    // The strategy is to parallelize over sections of the vocabulary, so that
-    // thread 1 handles updates to gradWeight[0..nVocab/nThreads]. Every thread
-    // has to traverse the entire input, but the dominating factor is the axpy
-    // BLAS call.
-    #pragma omp parallel private(i)
-    {
-      int tid = omp_get_thread_num();
-      int nthreads = omp_get_num_threads();
-
-      long start = tid * (numw/nthreads + 1);
-      long end = start + (numw/nthreads + 1);
-      for (i=0; i<numel; i++)
-      {
-        if (input_data[i] != paddingValue)
-        {
-            long k = input_data[i] - TH_INDEX_BASE;
-            if (k >= start && k < end)
-            {
-                real scale_ = scale;
-                if (count_data) scale_ /= count_data[k];
-                THBlas_(axpy)(stride, scale_, go + i*stride, 1, gw + k*stride, 1);
-            }
-        }
-      }
-    }
+  // Duplicate rows are summed once per row and each row of gradWeight is
+  // updated by a single thread, so that the work is balanced over the input
+  // entries rather than over sections of the vocabulary.
+  THNN_(LookupTableEntry) *entries = THAlloc(sizeof(THNN_(LookupTableEntry)) * numel);
+  ptrdiff_t *segStart = THAlloc(sizeof(ptrdiff_t) * (numel + 1));
+  ptrdiff_t nseg = THNN_(LookupTable_sortIndices)(input_data, numel, numw, paddingValue,
+                                                   entries, segStart);
+  THNN_(LookupTable_reduceSegments)(entries, segStart, nseg, count_data, go, NULL, NULL,
+                                    gw, stride, scale, false);
 
-    THTensor_(free)(gradOutput);
-    return;
-  }
-#endif
+  THFree(entries);
+  THFree(segStart);
+  THTensor_(free)(gradOutput);
+}
 
-  for (i=0; i<numel; i++)
+void THNN_(LookupTable_sparseGradParameters)(
+          THNNState *state,
+          THIndexTensor *input,
+          THTensor *gradOutput,
+          THIndexTensor *gradIndices,
+          THTensor *gradValues,
+          THIntegerTensor *count,
+          long numWeights,
+          bool scaleGradByFreq,
+          int paddingValue,
+          accreal ascale)
+{
+  real scale = TH_CONVERT_ACCREAL_TO_REAL(ascale);
+  THInteger_t *count_data = NULL;
+  ptrdiff_t s;
+
+  if (scaleGradByFreq)
   {
-    if (input_data[i] != paddingValue)
-    {
-        long k = input_data[i] - TH_INDEX_BASE;
-        real scale_ = scale;
-        if (count_data) scale_ /= count_data[k];
-        THBlas_(axpy)(stride, scale_, go + i*stride, 1, gw + k*stride, 1);
-     }
+    THIntegerTensor_(resize1d)(count, numWeights);
+    count_data = THIntegerTensor_(data)(count);
   }
 
+  THNN_(LookupTable_checkInput)(input, numWeights);
+
+  THIndex_t *input_data = THIndexTensor_(data)(input);
+  ptrdiff_t numel = THIndexTensor_(nElement)(input);
+
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  long dim = numel > 0 ? THTensor_(nElement)(gradOutput) / numel : 0;
+
+  if (count_data)
+    THNN_(LookupTable_resetCount)(count_data, input);
+
+  THNN_(LookupTableEntry) *entries = THAlloc(sizeof(THNN_(LookupTableEntry)) * numel);
+  ptrdiff_t *segStart = THAlloc(sizeof(ptrdiff_t) * (numel + 1));
+  ptrdiff_t nseg = THNN_(LookupTable_sortIndices)(input_data, numel, numWeights, paddingValue,
+                                                   entries, segStart);
+
+  THIndexTensor_(resize2d)(gradIndices, 1, nseg);
+  THTensor_(resize2d)(gradValues, nseg, dim);
+  THTensor_(zero)(gradValues);
+  THIndex_t *gradIndices_data = THIndexTensor_(data)(gradIndices);
+  for (s = 0; s < nseg; s++)
+    gradIndices_data[s] = entries[segStart[s]].key;
+  THNN_(LookupTable_reduceSegments)(entries, segStart, nseg, count_data,
+                                    THTensor_(data)(gradOutput), NULL, NULL,
+                                    THTensor_(data)(gradValues), dim, scale, true);
+
+  THFree(entries);
+  THFree(segStart);
   THTensor_(free)(gradOutput);
 }
 
@@ -12,9 +12,9 @@ void THNN_(MSECriterion_updateOutput)(
   THNN_CHECK_NELEMENT(input, target);
   THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
 
-  real sum = 0;
+  accreal sum = 0;
 
-  TH_TENSOR_APPLY2(real, input, real, target,
+  THNN_TENSOR_APPLY2_REDUCE(real, input, real, target, reduction(+:sum),
     real z = (*input_data - *target_data);
     sum += z*z;
   );
@@ -37,9 +37,36 @@ void THNN_(MSECriterion_updateGradInput)(
   real norm = (sizeAverage ? 2./((real)THTensor_(nElement)(input)) : 2.);
 
   THTensor_(resizeAs)(gradInput, input);
-  TH_TENSOR_APPLY3(real, gradInput, real, input, real, target,
+  THNN_TENSOR_APPLY3(real, gradInput, real, input, real, target,
     *gradInput_data = norm * (*input_data - *target_data);
   );
 }
 
+void THNN_(MSECriterion_updateOutputAndGradInput)(
+          THNNState *state,
+          THTensor *input,
+          THTensor *target,
+          THTensor *output,
+          THTensor *gradInput,
+          bool sizeAverage)
+{
+  THNN_CHECK_NELEMENT(input, target);
+  THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
+
+  real norm = (sizeAverage ? 2./((real)THTensor_(nElement)(input)) : 2.);
+  accreal sum = 0;
+
+  THTensor_(resizeAs)(gradInput, input);
+  THNN_TENSOR_APPLY3_REDUCE(real, gradInput, real, input, real, target, reduction(+:sum),
+    real z = (*input_data - *target_data);
+    sum += z*z;
+    *gradInput_data = norm * z;
+  );
+
+  if (sizeAverage)
+    sum /= THTensor_(nElement)(input);
+
+  THTensor_(set1d)(output, 0, sum);
+}
+
 #endif
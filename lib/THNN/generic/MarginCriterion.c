@@ -13,9 +13,9 @@ void THNN_(MarginCriterion_updateOutput)(
   real margin = TH_CONVERT_ACCREAL_TO_REAL(margin_);
   THNN_CHECK_NELEMENT(input, target);
   THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
-  real sum = 0;
+  accreal sum = 0;
 
-  TH_TENSOR_APPLY2(real, input, real, target,
+  THNN_TENSOR_APPLY2_REDUCE(real, input, real, target, reduction(+:sum),
     real z = (margin - *input_data * *target_data);
     sum += z>0 ? z : 0;
   );
@@ -39,9 +39,38 @@ void THNN_(MarginCriterion_updateGradInput)(
   real norm = (sizeAverage ? 1./((real)THTensor_(nElement)(input)) : 1.);
 
   THTensor_(resizeAs)(gradInput, input);
-  TH_TENSOR_APPLY3(real, gradInput, real, input, real, target,
+  THNN_TENSOR_APPLY3(real, gradInput, real, input, real, target,
     *gradInput_data = (*input_data * *target_data) < margin ? -norm * *target_data : 0;
   );
 }
 
+void THNN_(MarginCriterion_updateOutputAndGradInput)(
+          THNNState *state,
+          THTensor *input,
+          THTensor *target,
+          THTensor *output,
+          THTensor *gradInput,
+          bool sizeAverage,
+          accreal margin_)
+{
+  real margin = TH_CONVERT_ACCREAL_TO_REAL(margin_);
+  THNN_CHECK_NELEMENT(input, target);
+  THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
+  real norm = (sizeAverage ? 1./((real)THTensor_(nElement)(input)) : 1.);
+  accreal sum = 0;
+
+  THTensor_(resizeAs)(gradInput, input);
+  THNN_TENSOR_APPLY3_REDUCE(real, gradInput, real, input, real, target, reduction(+:sum),
+    real y = *target_data;
+    real xy = *input_data * y;
+    sum += margin - xy > 0 ? margin - xy : 0;
+    *gradInput_data = xy < margin ? -norm * y : 0;
+  );
+
+  if (sizeAverage)
+    sum /= THTensor_(nElement)(input);
+
+  THTensor_(set1d)(output, 0, sum);
+}
+
 #endif
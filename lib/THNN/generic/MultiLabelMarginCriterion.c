@@ -143,8 +143,7 @@ void THNN_(MultiLabelMarginCriterion_updateGradInput)(
 
   g = sizeAverage ? ( 1./((real)(nframe*dim)) ) : ( 1./((real)dim) );
 
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
   gradInput_data = THTensor_(data)(gradInput);
 
   for (t = 0; t < nframe; t++)
@@ -2,23 +2,87 @@
 #define TH_GENERIC_FILE "generic/MultiMarginCriterion.c"
 #else
 
-// TODO: improve error messages
-void THNN_(MultiMarginCriterion_updateOutput)(
-          THNNState *state,
+/* Sums the hinge terms max(0, base + input[d])^p of n consecutive non-target
+ * classes and, when gradInput is not NULL, writes their gradients (scaled by
+ * g) and adds them to *gradSum. */
+static accreal THNN_(MultiMarginCriterion_terms)(
+          const real *input,
+          real *gradInput,
+          long n,
+          real base,
+          int p,
+          real g,
+          accreal *gradSum)
+{
+  accreal sum = 0, gsum = 0;
+  long d;
+
+  if (gradInput) {
+    THNN_SIMD_REDUCE(reduction(+:sum) reduction(+:gsum))
+    for (d = 0; d < n; d++) {
+      real z = base + input[d];
+      real zp = z > 0 ? z : 0;
+      real h = (p == 1) ? (z > 0 ? g : 0) : 2*g*zp;
+      sum += (p == 1) ? zp : zp*zp;
+      gsum += h;
+      gradInput[d] = h;
+    }
+    *gradSum += gsum;
+  } else {
+    THNN_SIMD_REDUCE(reduction(+:sum))
+    for (d = 0; d < n; d++) {
+      real z = base + input[d];
+      real zp = z > 0 ? z : 0;
+      sum += (p == 1) ? zp : zp*zp;
+    }
+  }
+  return sum;
+}
+
+/* Loss of one frame, already scaled by the weight of its target class; the
+ * classes before and after the target are two branch-free loops. */
+static accreal THNN_(MultiMarginCriterion_frame)(
+          const real *input,
+          real *gradInput,
+          long target_idx,
+          long dim,
+          int p,
+          real margin,
+          real weight,
+          real g)
+{
+  real base = margin - input[target_idx];
+  real *after = gradInput ? gradInput + target_idx + 1 : NULL;
+  accreal gradTarget = 0;
+  accreal sum;
+
+  g *= weight;
+  sum = THNN_(MultiMarginCriterion_terms)(input, gradInput, target_idx,
+                                          base, p, g, &gradTarget)
+      + THNN_(MultiMarginCriterion_terms)(input + target_idx + 1, after, dim - target_idx - 1,
+                                          base, p, g, &gradTarget);
+  if (gradInput)
+    gradInput[target_idx] = -gradTarget;
+  return sum * weight;
+}
+
+/* Shared by the three entry points: output and gradInput may each be NULL. */
+static void THNN_(MultiMarginCriterion_compute)(
           THTensor *input,
           THIndexTensor *target,
           THTensor *output,
+          THTensor *gradInput,
           bool sizeAverage,
           int p,
           THTensor *weights,
-          accreal margin_)
+          real margin)
 {
-  real margin = TH_CONVERT_ACCREAL_TO_REAL(margin_);
-  real *input_data, *weights_data;
+  real *input_data, *gradInput_data, *weights_data;
   THIndex_t *target_data;
   long nframe, dim;
-  long t, d;
-  real sum;
+  long t;
+  accreal sum;
+  real g;
 
   THArgCheck((input->nDimension == 1) || (input->nDimension == 2), 2,
 	     "vector or matrix expected");
@@ -43,39 +107,38 @@ void THNN_(MultiMarginCriterion_updateOutput)(
 	       "target out of range");
   }
 
+  g = (sizeAverage ? 1./((real)(nframe*dim)) : 1./((real)dim));
+
   input = THTensor_(newContiguous)(input);
   target = THIndexTensor_(newContiguous)(target);
   weights = weights ? THTensor_(newContiguous)(weights) : NULL;
   input_data = THTensor_(data)(input);
   target_data = THIndexTensor_(data)(target);
   weights_data = weights ? THTensor_(data)(weights) : NULL;
+  gradInput_data = NULL;
+  if (gradInput) {
+    THTensor_(resizeAs)(gradInput, input);
+    gradInput_data = THTensor_(data)(gradInput);
+  }
 
   sum = 0;
+#pragma omp parallel for private(t) reduction(+:sum) if (nframe * dim > THNN_OMP_OVERHEAD_THRESHOLD)
   for (t = 0; t < nframe; t++)
   {
     THIndex_t target_idx = target_data[t] - TH_INDEX_BASE;
-    real input_target = input_data[target_idx];
-    for (d = 0; d < dim; d++)
-    {
-      real z = margin - input_target + input_data[d];
-      if (d == target_idx)
-        continue;
-
-      if (z > 0) {
-        real h = (p==1) ? z : z*z;
-        if(weights_data)
-          h *= weights_data[target_idx];
-        sum += h;
-      }
-    }
-    input_data += dim;
+    real weight = weights_data ? weights_data[target_idx] : 1;
+    sum += THNN_(MultiMarginCriterion_frame)(input_data + t*dim,
+                                             gradInput_data ? gradInput_data + t*dim : NULL,
+                                             target_idx, dim, p, margin, weight, g);
   }
 
-  sum /= dim;
-  if(sizeAverage)
-    sum /= nframe;
+  if (output) {
+    sum /= dim;
+    if(sizeAverage)
+      sum /= nframe;
 
-  THTensor_(set1d)(output, 0, sum);
+    THTensor_(set1d)(output, 0, sum);
+  }
 
   THTensor_(free)(input);
   THIndexTensor_(free)(target);
@@ -83,6 +146,21 @@ void THNN_(MultiMarginCriterion_updateOutput)(
     THTensor_(free)(weights);
 }
 
+void THNN_(MultiMarginCriterion_updateOutput)(
+          THNNState *state,
+          THTensor *input,
+          THIndexTensor *target,
+          THTensor *output,
+          bool sizeAverage,
+          int p,
+          THTensor *weights,
+          accreal margin_)
+{
+  real margin = TH_CONVERT_ACCREAL_TO_REAL(margin_);
+  THNN_(MultiMarginCriterion_compute)(input, target, output, NULL,
+                                      sizeAverage, p, weights, margin);
+}
+
 void THNN_(MultiMarginCriterion_updateGradInput)(
           THNNState *state,
           THTensor *input,
@@ -94,75 +172,24 @@ void THNN_(MultiMarginCriterion_updateGradInput)(
           accreal margin_)
 {
   real margin = TH_CONVERT_ACCREAL_TO_REAL(margin_);
-  real *input_data;
-  real *gradInput_data;
-  THIndex_t *target_data;
-  real *weights_data;
-  long nframe, dim;
-  long t, d;
-  real g;
-
-  THArgCheck((input->nDimension == 1) || (input->nDimension == 2), 2,
-	     "vector or matrix expected");
-
-  if (input->nDimension == 1)
-  {
-    nframe = 1;
-    dim = input->size[0];
-  }
-  else
-  {
-    nframe = input->size[0];
-    dim = input->size[1];
-    THArgCheck((target->nDimension == 1) && (target->size[0] == nframe), 3,
-	       "inconsistent target size");
-  }
-
-  g = (sizeAverage ? 1./((real)(nframe*dim)) : 1./((real)dim));
-
-  input = THTensor_(newContiguous)(input);
-  target = THIndexTensor_(newContiguous)(target);
-  input_data = THTensor_(data)(input);
-
-  THTensor_(resizeAs)(gradInput, input);
-  gradInput_data = THTensor_(data)(gradInput);
-
-  target_data = THIndexTensor_(data)(target);
-  weights = weights ? THTensor_(newContiguous)(weights) : NULL;
-  weights_data = weights ? THTensor_(data)(weights) : NULL;
-
-  for (t = 0; t < nframe; t++)
-  {
-    THIndex_t target_idx = target_data[t] - TH_INDEX_BASE;
-    real input_target = input_data[target_idx];
-    real gradInput_target = 0;
-    for (d = 0; d < dim; d++)
-    {
-      real z = margin - input_target + input_data[d];
-      if (d == target_idx)
-        continue;
-
-      if (z > 0)
-      {
-        real h = (p == 1) ? g : 2*g*z;
-        if(weights_data)
-          h *= weights_data[target_idx];
-        gradInput_target -= h;
-        gradInput_data[d] = h;
-      }
-      else
-        gradInput_data[d] = 0;
-    }
-    gradInput_data[target_idx] = gradInput_target;
-
-    input_data += dim;
-    gradInput_data += dim;
-  }
+  THNN_(MultiMarginCriterion_compute)(input, target, NULL, gradInput,
+                                      sizeAverage, p, weights, margin);
+}
 
-  THTensor_(free)(input);
-  THIndexTensor_(free)(target);
-  if(weights)
-    THTensor_(free)(weights);
+void THNN_(MultiMarginCriterion_updateOutputAndGradInput)(
+          THNNState *state,
+          THTensor *input,
+          THIndexTensor *target,
+          THTensor *output,
+          THTensor *gradInput,
+          bool sizeAverage,
+          int p,
+          THTensor *weights,
+          accreal margin_)
+{
+  real margin = TH_CONVERT_ACCREAL_TO_REAL(margin_);
+  THNN_(MultiMarginCriterion_compute)(input, target, output, gradInput,
+                                      sizeAverage, p, weights, margin);
 }
 
 #endif
@@ -57,23 +57,12 @@ void THNN_(RReLU_updateOutput)(
   {
     const real negSlope = (lower + upper) / 2;
     if (inplace)
-    {
-      TH_TENSOR_APPLY(real, input,
-        if (*input_data <= 0)
-        {
-          *input_data = *input_data * negSlope;
-        }
-      );
       THTensor_(set)(output, input);
-    }
     else
-    {
       THTensor_(resizeAs)(output, input);
-      TH_TENSOR_APPLY2(real, input, real, output,
-        const real r = (*input_data) <= 0 ? negSlope : 1;
-        *output_data = *input_data * r;
-      );
-    }
+    THNN_TENSOR_APPLY2(real, output, real, input,
+      *output_data = (*input_data) <= 0 ? *input_data * negSlope : *input_data;
+    );
   }
 }
 
@@ -110,22 +99,12 @@ void THNN_(RReLU_updateGradInput)(
     // use constant factor for negative input values
     const real negSlope = (lower + upper) / 2;
     if (inplace)
-    {
-      TH_TENSOR_APPLY2(real, gradOutput, real, input,
-        if (*input_data <= 0)
-        {
-          *gradOutput_data = (*gradOutput_data) * negSlope;
-        }
-      );
       THTensor_(set)(gradInput, gradOutput);
-    }
     else
-    {
       THTensor_(resizeAs)(gradInput, input);
-      TH_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, input,
-        *gradInput_data = (*input_data) <= 0 ? (*gradOutput_data) * negSlope : (*gradOutput_data);
-      );
-    }
+    THNN_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, input,
+      *gradInput_data = (*input_data) <= 0 ? (*gradOutput_data) * negSlope : (*gradOutput_data);
+    );
   }
 }
 
@@ -7,7 +7,10 @@ void THNN_(Sigmoid_updateOutput)(
           THTensor *input,
           THTensor *output)
 {
-  THTensor_(sigmoid)(output, input);
+  THTensor_(resizeAs)(output, input);
+  THNN_TENSOR_APPLY2(real, output, real, input,
+    *output_data = 1. / (1. + exp(-*input_data));
+  );
 }
 
 void THNN_(Sigmoid_updateGradInput)(
@@ -19,7 +22,7 @@ void THNN_(Sigmoid_updateGradInput)(
 {
   THNN_CHECK_NELEMENT(output, gradOutput);
   THTensor_(resizeAs)(gradInput, output);
-  TH_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, output,
+  THNN_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, output,
     real z = *output_data;
     *gradInput_data = *gradOutput_data * (1. - z) * z;
   );
@@ -12,8 +12,8 @@ void THNN_(SmoothL1Criterion_updateOutput)(
   THNN_CHECK_NELEMENT(input, target);
   THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
   
-  real sum = 0;
-  TH_TENSOR_APPLY2(real, input, real, target,
+  accreal sum = 0;
+  THNN_TENSOR_APPLY2_REDUCE(real, input, real, target, reduction(+:sum),
     real z = fabs(*input_data - *target_data);
     sum += z < 1 ? 0.5*z*z : z - 0.5;
   );
@@ -35,15 +35,39 @@ void THNN_(SmoothL1Criterion_updateGradInput)(
   real norm = (sizeAverage ? 1./((real)THTensor_(nElement)(input)) : 1.);
 
   THTensor_(resizeAs)(gradInput, input);
-  TH_TENSOR_APPLY3(real, gradInput, real, input, real, target,
+  THNN_TENSOR_APPLY3(real, gradInput, real, input, real, target,
     real x = *input_data - *target_data;
-    if (x < -1.)
-     *gradInput_data = - norm;
-    else if (x > 1.)
-     *gradInput_data = norm;
-    else
-     *gradInput_data = norm * x;
+    x = x < -1. ? -1. : x;
+    *gradInput_data = norm * (x > 1. ? 1. : x);
   );
 }
 
+void THNN_(SmoothL1Criterion_updateOutputAndGradInput)(
+          THNNState *state,
+          THTensor *input,
+          THTensor *target,
+          THTensor *output,
+          THTensor *gradInput,
+          bool sizeAverage)
+{
+  THNN_CHECK_NELEMENT(input, target);
+  THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
+  real norm = (sizeAverage ? 1./((real)THTensor_(nElement)(input)) : 1.);
+
+  accreal sum = 0;
+  THTensor_(resizeAs)(gradInput, input);
+  THNN_TENSOR_APPLY3_REDUCE(real, gradInput, real, input, real, target, reduction(+:sum),
+    real x = *input_data - *target_data;
+    real z = fabs(x);
+    sum += z < 1 ? 0.5*z*z : z - 0.5;
+    x = x < -1. ? -1. : x;
+    *gradInput_data = norm * (x > 1. ? 1. : x);
+  );
+
+  if (sizeAverage)
+    sum /= THTensor_(nElement)(input);
+
+  THTensor_(set1d)(output, 0, sum);
+}
+
 #endif
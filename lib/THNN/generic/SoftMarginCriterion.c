@@ -12,10 +12,10 @@ void THNN_(SoftMarginCriterion_updateOutput)(
   THNN_CHECK_NELEMENT(input, target);
   THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
 
-  real sum;
+  accreal sum;
 
   sum = 0;
-  TH_TENSOR_APPLY2(real, input, real, target,
+  THNN_TENSOR_APPLY2_REDUCE(real, input, real, target, reduction(+:sum),
                    real z = log(1. + exp(-*input_data* *target_data));
                    sum += z;)
 
@@ -36,9 +36,35 @@ void THNN_(SoftMarginCriterion_updateGradInput)(
   real norm = (sizeAverage ? 1./((real)THTensor_(nElement)(input)) : 1.);
 
   THTensor_(resizeAs)(gradInput, input);
-  TH_TENSOR_APPLY3(real, gradInput, real, input, real, target,
+  THNN_TENSOR_APPLY3(real, gradInput, real, input, real, target,
                    real z = exp(-*target_data * *input_data);
                    *gradInput_data = -norm*(*target_data)*z/(1. + z);)
 }
 
+void THNN_(SoftMarginCriterion_updateOutputAndGradInput)(
+  THNNState *state,
+  THTensor *input,
+  THTensor *target,
+  THTensor *output,
+  THTensor *gradInput,
+  bool sizeAverage)
+{
+  THNN_CHECK_NELEMENT(input, target);
+  THNN_CHECK_DIM_SIZE(output, 1, 0, 1);
+  real norm = (sizeAverage ? 1./((real)THTensor_(nElement)(input)) : 1.);
+
+  accreal sum = 0;
+  THTensor_(resizeAs)(gradInput, input);
+  THNN_TENSOR_APPLY3_REDUCE(real, gradInput, real, input, real, target, reduction(+:sum),
+                   real y = *target_data;
+                   real z = exp(-y * *input_data);
+                   sum += log(1. + z);
+                   *gradInput_data = -norm*y*z/(1. + z);)
+
+  if(sizeAverage)
+    sum /= THTensor_(nElement)(input);
+
+  THTensor_(set1d)(output, 0, sum);
+}
+
 #endif
@@ -46,32 +46,48 @@ void THNN_(SoftMax_updateOutput)(
   input_data = THTensor_(data)(input);
   output_data = THTensor_(data)(output);
 
-#pragma omp parallel for private(t)
-  for (t = 0; t < stride*nframe; t++)
+  if (stride == 1)
   {
-    real *input_ptr = input_data + (t/stride)*dim*stride + t % stride;
-    real *output_ptr = output_data + (t/stride)*dim*stride + t % stride;
-
-    real inputMax = -THInf;
-    accreal sum;
-
-    ptrdiff_t d;
-    for (d = 0; d < dim; d++)
-    {
-      if (input_ptr[d*stride] >= inputMax) inputMax = input_ptr[d*stride];
-    }
-
-    sum = 0;
-    for (d = 0; d < dim; d++)
+#pragma omp parallel for private(t) if (nframe*dim > THNN_SOFTMAX_OMP_THRESHOLD)
+    for (t = 0; t < nframe; t++)
     {
-      real z = exp(input_ptr[d*stride] - inputMax);
-      output_ptr[d*stride] = z;
-      sum += z;
+      real *input_ptr = input_data + t*dim;
+      real *output_ptr = output_data + t*dim;
+      real inputMax, scale;
+      accreal sum;
+      ptrdiff_t d;
+
+      THNN_(softmax_rowMaxSum)(input_ptr, dim, &inputMax, &sum);
+      scale = 1/sum;
+      for (d = 0; d < dim; d++)
+        output_ptr[d] = THNN_(softmax_exp)(input_ptr[d] - inputMax) * scale;
     }
+  }
+  else
+  {
+    ptrdiff_t nblock = (stride + THNN_SOFTMAX_BLOCK - 1) / THNN_SOFTMAX_BLOCK;
 
-    for (d = 0; d < dim; d++)
+#pragma omp parallel for private(t) if (nframe*dim*stride > THNN_SOFTMAX_OMP_THRESHOLD)
+    for (t = 0; t < nframe*nblock; t++)
     {
-      output_ptr[d*stride] *= 1/sum;
+      ptrdiff_t s0 = (t % nblock) * THNN_SOFTMAX_BLOCK;
+      ptrdiff_t len = stride - s0 < THNN_SOFTMAX_BLOCK ? stride - s0 : THNN_SOFTMAX_BLOCK;
+      real *input_ptr = input_data + (t/nblock)*dim*stride + s0;
+      real *output_ptr = output_data + (t/nblock)*dim*stride + s0;
+      real inputMax[THNN_SOFTMAX_BLOCK], scale[THNN_SOFTMAX_BLOCK];
+      accreal sum[THNN_SOFTMAX_BLOCK];
+      ptrdiff_t d, s;
+
+      THNN_(softmax_lanesMaxSum)(input_ptr, dim, stride, len, inputMax, sum);
+      for (s = 0; s < len; s++)
+        scale[s] = 1/sum[s];
+      for (d = 0; d < dim; d++)
+      {
+        real *in = input_ptr + d*stride;
+        real *out = output_ptr + d*stride;
+        for (s = 0; s < len; s++)
+          out[s] = THNN_(softmax_exp)(in[s] - inputMax[s]) * scale[s];
+      }
     }
   }
 
@@ -85,7 +101,7 @@ void THNN_(SoftMax_updateGradInput)(
           THTensor *gradInput,
           THTensor *output)
 {
-  THNN_CHECK_SHAPE(input, gradOutput);  
+  THNN_CHECK_SHAPE(input, gradOutput);
   real *gradInput_data, *gradOutput_data, *output_data;
   ptrdiff_t nframe = 0, dim = 0, stride = 0;
   ptrdiff_t t;
@@ -127,20 +143,54 @@ void THNN_(SoftMax_updateGradInput)(
   output_data = THTensor_(data)(output);
   gradOutput_data = THTensor_(data)(gradOutput);
 
-#pragma omp parallel for private(t)
-  for (t = 0; t < stride*nframe; t++)
+  if (stride == 1)
   {
-    real *gradInput_ptr = gradInput_data + (t/stride)*dim*stride + t % stride;
-    real *output_ptr = output_data + (t/stride)*dim*stride + t % stride;
-    real *gradOutput_ptr = gradOutput_data + (t/stride)*dim*stride + t % stride;
-
-    ptrdiff_t d;
-    accreal sum = 0;
-    for (d = 0; d < dim; d++)
-      sum += (accreal)gradOutput_ptr[d*stride] * output_ptr[d*stride];
+#pragma omp parallel for private(t) if (nframe*dim > THNN_SOFTMAX_OMP_THRESHOLD)
+    for (t = 0; t < nframe; t++)
+    {
+      real *gradInput_ptr = gradInput_data + t*dim;
+      real *output_ptr = output_data + t*dim;
+      real *gradOutput_ptr = gradOutput_data + t*dim;
+      accreal sum = 0;
+      ptrdiff_t d;
+
+      for (d = 0; d < dim; d++)
+        sum += (accreal)gradOutput_ptr[d] * output_ptr[d];
+      for (d = 0; d < dim; d++)
+        gradInput_ptr[d] = output_ptr[d] * (gradOutput_ptr[d] - sum);
+    }
+  }
+  else
+  {
+    ptrdiff_t nblock = (stride + THNN_SOFTMAX_BLOCK - 1) / THNN_SOFTMAX_BLOCK;
 
-    for (d = 0; d < dim; d++)
-      gradInput_ptr[d*stride] = output_ptr[d*stride] * (gradOutput_ptr[d*stride] - sum);
+#pragma omp parallel for private(t) if (nframe*dim*stride > THNN_SOFTMAX_OMP_THRESHOLD)
+    for (t = 0; t < nframe*nblock; t++)
+    {
+      ptrdiff_t s0 = (t % nblock) * THNN_SOFTMAX_BLOCK;
+      ptrdiff_t len = stride - s0 < THNN_SOFTMAX_BLOCK ? stride - s0 : THNN_SOFTMAX_BLOCK;
+      ptrdiff_t offset = (t/nblock)*dim*stride + s0;
+      accreal sum[THNN_SOFTMAX_BLOCK];
+      ptrdiff_t d, s;
+
+      for (s = 0; s < len; s++)
+        sum[s] = 0;
+      for (d = 0; d < dim; d++)
+      {
+        real *out = output_data + offset + d*stride;
+        real *gradOut = gradOutput_data + offset + d*stride;
+        for (s = 0; s < len; s++)
+          sum[s] += (accreal)gradOut[s] * out[s];
+      }
+      for (d = 0; d < dim; d++)
+      {
+        real *gradIn = gradInput_data + offset + d*stride;
+        real *out = output_data + offset + d*stride;
+        real *gradOut = gradOutput_data + offset + d*stride;
+        for (s = 0; s < len; s++)
+          gradIn[s] = out[s] * (gradOut[s] - sum[s]);
+      }
+    }
   }
 
   THTensor_(free)(gradOutput);
@@ -14,7 +14,7 @@ void THNN_(SoftPlus_updateOutput)(
   THTensor_(resizeAs)(output, input);
 
   // f(x) = 1/beta * log(1 + exp(beta * x))
-  TH_TENSOR_APPLY2(real, output, real, input,               \
+  THNN_TENSOR_APPLY2(real, output, real, input,
     *output_data = (*input_data * beta) > threshold ? *input_data : THLog1p(exp(*input_data * beta)) / beta;
   );
 }
@@ -38,7 +38,7 @@ void THNN_(SoftPlus_updateGradInput)(
   // y = (1/k)*log(1+exp(k*x)) --> x = (1/k)*log(exp(k*y)-1)
   // THEREFORE:
   // d/dx(f(x)) = (exp(k*y) - 1) / exp(k*y)
-  TH_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, output,
+  THNN_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, output,
     real z = exp(*output_data * beta);
     *gradInput_data = (*output_data * beta) > threshold ? *gradOutput_data : *gradOutput_data * (z - 1.)/z;
   );
@@ -11,13 +11,9 @@ void THNN_(SoftShrink_updateOutput)(
   real lambda = TH_CONVERT_ACCREAL_TO_REAL(lambda_);
   THTensor_(resizeAs)(output, input);
 
-  TH_TENSOR_APPLY2(real, output, real, input,
-    if ((*input_data) > lambda)
-     *output_data = *input_data - lambda;
-    else if ((*input_data) < -lambda)
-     *output_data = *input_data + lambda;
-    else
-     *output_data = 0;
+  THNN_TENSOR_APPLY2(real, output, real, input,
+    real x = *input_data;
+    *output_data = x > lambda ? x - lambda : (x < -lambda ? x + lambda : 0);
   );
 }
 
@@ -31,11 +27,8 @@ void THNN_(SoftShrink_updateGradInput)(
   real lambda = TH_CONVERT_ACCREAL_TO_REAL(lambda_);
   THNN_CHECK_NELEMENT(input, gradOutput);
   THTensor_(resizeAs)(gradInput, input);
-  TH_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, input,
-    if ((*input_data) > lambda || (*input_data) < -lambda)
-      *gradInput_data = (*gradOutput_data);
-    else
-      *gradInput_data = 0;
+  THNN_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, input,
+    *gradInput_data = (*input_data > lambda || *input_data < -lambda) ? *gradOutput_data : 0;
   );
 }
 
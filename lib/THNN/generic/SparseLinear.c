@@ -41,6 +41,98 @@ static real THNN_(get2d)(const THTensor *t, long x0, long x1) {
                          x0*t->stride[0] + x1*t->stride[1]);
 }
 
+/* Converts the nnz x 3 (row, column, value) input, 1-based and sorted by
+ * row, to a CSR batch of batchSize rows with 0-based columns. */
+static void THNN_(SparseLinear_toCSR)(
+          THTensor *input,
+          long batchSize,
+          long *rowPtr,
+          long *cols,
+          real *values)
+{
+  long nnz = THTensor_(size)(input, 0);
+  real *data = THTensor_(data)(input);
+  long s0 = input->stride[0], s1 = input->stride[1];
+  long h, i;
+
+  for (h = 0; h <= batchSize; h++)
+    rowPtr[h] = 0;
+
+  // the rows are sorted: nonzero i closes the rows up to the next one's
+#pragma omp parallel for private(i, h) schedule(static) if (nnz > THNN_SPARSE_OMP_THRESHOLD)
+  for (i = 0; i < nnz; i++) {
+    long hp0 = (long)data[i*s0] - 1;
+    long hp1 = i+1 == nnz ? batchSize : (long)data[(i+1)*s0] - 1;
+    for (h = hp0 < 0 ? 0 : hp0; h < hp1 && h < batchSize; h++)
+      rowPtr[h+1] = i+1;
+    values[i] = data[i*s0 + 2*s1];
+    // zeros are skipped whatever their column
+    cols[i] = values[i] != 0 ? (long)data[i*s0 + s1] - 1 : 0;
+  }
+}
+
+/* output = batch * weight' + bias, base being the index of the first
+ * column in the error messages. */
+static void THNN_(SparseLinear_csrOutput)(
+          THNN_(CSRBatch) *batch,
+          THTensor *output,
+          THTensor *weight,
+          THTensor *bias,
+          int base)
+{
+  long outDim = THTensor_(size)(weight, 0);
+  long inDim = THTensor_(size)(weight, 1);
+  long first;
+
+  if (THNN_(CSRBatch_checkColumns)(batch, inDim, &first))
+    THError("index out of bound. updateOutput: %ld not between %d and %ld",
+            first + base, base, inDim - 1 + base);
+
+  weight = THTensor_(newContiguous)(weight);
+  bias = THTensor_(newContiguous)(bias);
+  THNN_(CSRBatch_multiply)(batch, THTensor_(data)(weight), 1, inDim, outDim,
+                           THTensor_(data)(bias), THTensor_(data)(output));
+  THTensor_(free)(weight);
+  THTensor_(free)(bias);
+}
+
+/* gradWeight += scale * gradOutput' * batch (+ weightDecay * weight),
+ * gradBias += scale * sum of the rows of gradOutput. */
+static void THNN_(SparseLinear_csrGradParameters)(
+          THNN_(CSRBatch) *batch,
+          THTensor *gradOutput,
+          THTensor *gradWeight,
+          THTensor *gradBias,
+          THTensor *weight,
+          real weightDecay,
+          real scale,
+          int base)
+{
+  long outDim = THTensor_(size)(weight, 0);
+  long inDim = THTensor_(size)(weight, 1);
+  long first;
+
+  if (THNN_(CSRBatch_checkColumns)(batch, inDim, &first))
+    THError("index out of bound. accGradParameters: %ld not between %d and %ld",
+            first + base, base, inDim - 1 + base);
+
+  // gradWeight += gradOutput * input, each column of gradWeight being
+  // updated by a single thread
+  THNN_(CSRBatch_accumulate)(batch, THTensor_(data)(gradOutput), outDim,
+                             THTensor_(data)(gradWeight),
+                             gradWeight->stride[1], gradWeight->stride[0], scale);
+
+  // gradBias += gradOutput
+  THTensor* buf = THTensor_(new)();
+  THTensor_(sum)(buf, gradOutput, 0, 1);
+  THTensor_(cadd)(gradBias, gradBias, scale, buf);
+  THTensor_(free)(buf);
+
+  if (weightDecay != 0) {
+    THTensor_(cadd)(gradWeight, gradWeight, weightDecay, weight);
+  }
+}
+
 void THNN_(SparseLinear_updateOutput)(
           THNNState *state,
           THTensor *input,
@@ -48,9 +140,7 @@ void THNN_(SparseLinear_updateOutput)(
           THTensor *weight,
           THTensor *bias)
 {
-  long h, i, j, hp0, hp1;
   long outDim = THTensor_(size)(weight, 0);
-  long inDim = THTensor_(size)(weight, 1);
   long batchSize = THTensor_(size)(output, 0);
 
   THArgCheck(THNN_(checkInput)(input), 2, "input must be in coo format, nnz x 3");
@@ -58,57 +148,70 @@ void THNN_(SparseLinear_updateOutput)(
   THArgCheck(THNN_(checkSize1D)(bias, outDim), 5, "bias size wrong");
 
   long nnz = THTensor_(size)(input, 0);
+  long *rowPtr = THAlloc(sizeof(long) * (batchSize + 1));
+  long *cols = THAlloc(sizeof(long) * nnz);
+  real *values = THAlloc(sizeof(real) * nnz);
+  THNN_(SparseLinear_toCSR)(input, batchSize, rowPtr, cols, values);
 
-  THLongTensor * csr = THLongTensor_newWithSize1d(batchSize+1);
-  THLongTensor_zero(csr);
+  THNN_(CSRBatch) batch = {batchSize, rowPtr, cols, values, 0};
+  THNN_(SparseLinear_csrOutput)(&batch, output, weight, bias, 1);
 
-  weight = THTensor_(newContiguous)(weight);
-
-//#pragma omp parallel for private(i, h, hp0, hp1) schedule(static) if (nnz > 10000)
-  for (i=0; i<nnz; i++) {
-    hp0 = (long)(THNN_(get2d)(input, i, 0)) - 1;
-    hp1 = (i+1 == nnz) ?
-            batchSize :
-            (long)(THNN_(get2d)(input, i+1, 0)) - 1;
-    if (hp0 != hp1) for (h = hp0; h < hp1; h++) {
-      THLongTensor_set1d(csr, h+1, i+1);
-    }
-  }
+  THFree(rowPtr);
+  THFree(cols);
+  THFree(values);
+}
 
+/* Checks a CSR batch and points batch at it. */
+static void THNN_(SparseLinear_checkCSR)(
+          THNN_(CSRBatch) *batch,
+          THLongTensor *rowPtr,
+          THLongTensor *cols,
+          THTensor *values)
+{
+  THArgCheck(THLongTensor_nDimension(rowPtr) == 1 && THLongTensor_isContiguous(rowPtr), 2,
+             "rowPtr must be a contiguous vector of batchSize+1 offsets");
+  THArgCheck(THLongTensor_nDimension(cols) == 1 && THLongTensor_isContiguous(cols), 3,
+             "cols must be a contiguous vector");
+  THArgCheck(THTensor_(nDimension)(values) == 1 && THTensor_(isContiguous)(values), 4,
+             "values must be a contiguous vector");
+
+  long batchSize = THLongTensor_size(rowPtr, 0) - 1;
+  long nnz = THLongTensor_size(cols, 0);
+  long *rowPtr_data = THLongTensor_data(rowPtr);
+  long h;
+
+  THArgCheck(THTensor_(size)(values, 0) == nnz, 4,
+             "cols and values should have the same number of elements");
+  THArgCheck(rowPtr_data[0] == 0 && rowPtr_data[batchSize] == nnz, 2,
+             "rowPtr should run from 0 to the number of nonzeros %ld", nnz);
+  for (h = 0; h < batchSize; h++)
+    THArgCheck(rowPtr_data[h] <= rowPtr_data[h+1], 2, "rowPtr should be non-decreasing");
+
+  batch->batchSize = batchSize;
+  batch->rowPtr = rowPtr_data;
+  batch->cols = THLongTensor_data(cols);
+  batch->values = THTensor_(data)(values);
+  batch->colOffset = 0;
+}
 
-  // output = weight * input + bias
-  THTensor_(zero)(output);
-#pragma omp parallel for private(h, i) schedule(static) if (nnz > 10000)
-  for (h = 0; h < batchSize; h++) {
-    long i_start = THLongTensor_get1d(csr, h);
-    long i_end = THLongTensor_get1d(csr, h+1);
-    for (i = i_start; i < i_end; i++) {
-      real val = THNN_(get2d)(input, i, 2);
-      if (val == 0) {
-        continue;
-      }
+void THNN_(SparseLinearCSR_updateOutput)(
+          THNNState *state,
+          THLongTensor *rowPtr,
+          THLongTensor *cols,
+          THTensor *values,
+          THTensor *output,
+          THTensor *weight,
+          THTensor *bias)
+{
+  long outDim = THTensor_(size)(weight, 0);
+  THNN_(CSRBatch) batch;
 
-      long offset = (long)(THNN_(get2d)(input, i, 1)) - 1;
-      if (offset >= 0 && offset < inDim) {
-        THBlas_(axpy)(outDim,
-            val,
-            COL_PTR2(weight, offset), weight->stride[0],
-            ROW_PTR2(output, h), output->stride[1]);
-      } else {
-        THError("index out of bound. updateOutput: %d not between 1 and %d",
-            offset + 1, inDim);
-      }
-    }
-  }
+  THNN_(SparseLinear_checkCSR)(&batch, rowPtr, cols, values);
+  THArgCheck(THNN_(checkSize1D)(bias, outDim), 7, "bias size wrong");
 
-  THTensor* output_row = THTensor_(new)();
-  for (h = 0; h < batchSize; h++) {
-    THTensor_(select)(output_row, output, 0, h);
-    THTensor_(cadd)(output_row, bias, 1.0, output_row);
-  }
-  THTensor_(free)(output_row);
-  THLongTensor_free(csr);
-  THTensor_(free)(weight);
+  THTensor_(resize2d)(output, batch.batchSize, outDim);
+  THArgCheck(THTensor_(isContiguous)(output), 5, "output must be contiguous");
+  THNN_(SparseLinear_csrOutput)(&batch, output, weight, bias, 0);
 }
 
 void THNN_(SparseLinear_legacyUpdateOutput)(
@@ -178,7 +281,6 @@ void THNN_(SparseLinear_accGradParameters)(
 {
   real weightDecay = TH_CONVERT_ACCREAL_TO_REAL(weightDecay_);
   real scale = TH_CONVERT_ACCREAL_TO_REAL(scale_);
-  long h, i, col, hp0, hp1;
   long outDim = THTensor_(size)(weight, 0);
   long inDim = THTensor_(size)(weight, 1);
 
@@ -191,58 +293,52 @@ void THNN_(SparseLinear_accGradParameters)(
   THArgCheck(THTensor_(isContiguous)(gradOutput), 1,
              "gradOutput must be contiguous");
 
+  long batchSize = THTensor_(size)(gradOutput, 0);
   long nnz = THTensor_(size)(input, 0);
+  long *rowPtr = THAlloc(sizeof(long) * (batchSize + 1));
+  long *cols = THAlloc(sizeof(long) * nnz);
+  real *values = THAlloc(sizeof(real) * nnz);
+  THNN_(SparseLinear_toCSR)(input, batchSize, rowPtr, cols, values);
+
+  THNN_(CSRBatch) batch = {batchSize, rowPtr, cols, values, 0};
+  THNN_(SparseLinear_csrGradParameters)(&batch, gradOutput, gradWeight, gradBias,
+                                        weight, weightDecay, scale, 1);
+
+  THFree(rowPtr);
+  THFree(cols);
+  THFree(values);
+}
 
-  THLongTensor* csc = THLongTensor_newWithSize1d(inDim+1);
-  THLongTensor_zero(csc);
-  weight = THTensor_(newContiguous)(weight);
-
-#pragma omp parallel for private(i, h, hp0, hp1) schedule(static) if (nnz > 10000)
-  for (i = 0; i < nnz; i++) {
-    hp0 = (long)(THNN_(get2d)(input, i, 1)) - 1;
-    hp1 = (i+1 == nnz) ?
-            inDim :
-            (long)(THNN_(get2d)(input, i+1, 1)) - 1;
-    if (hp0 != hp1) for (h = hp0; h < hp1; h++) {
-      THLongTensor_set1d(csc, h+1, i+1);
-    }
-  }
-
-  // gradWeight += gradOutput * input
-#pragma omp parallel for private(h, i, col) schedule(static) if (nnz > 10000)
-  for (col = 0; col < inDim; col++) {
-    long i_start = THLongTensor_get1d(csc, col);
-    long i_end = THLongTensor_get1d(csc, col+1);
-    for (i = i_start; i < i_end; i++) {
-      real val = scale * THNN_(get2d)(input, i, 2);
-
-      h = (long)(THNN_(get2d)(input, i, 0)) - 1;
-      long offset = (long)(THNN_(get2d)(input, i, 1)) - 1;
-      if (offset >= 0 && offset < inDim) {
-        THBlas_(axpy)(outDim,
-            val,
-            ROW_PTR2(gradOutput, h), gradOutput->stride[1],
-            COL_PTR2(gradWeight, offset), gradWeight->stride[0]);
-      } else {
-        THError(
-            "index out of bound. accGradParameters: %d not between 1 and %d",
-            offset + 1,
-            inDim);
-      }
-    }
-  }
+void THNN_(SparseLinearCSR_accGradParameters)(
+          THNNState *state,
+          THLongTensor *rowPtr,
+          THLongTensor *cols,
+          THTensor *values,
+          THTensor *gradOutput,
+          THTensor *gradWeight,
+          THTensor *gradBias,
+          THTensor *weight,
+          THTensor *bias,
+          accreal weightDecay_,
+          accreal scale_)
+{
+  real weightDecay = TH_CONVERT_ACCREAL_TO_REAL(weightDecay_);
+  real scale = TH_CONVERT_ACCREAL_TO_REAL(scale_);
+  long outDim = THTensor_(size)(weight, 0);
+  long inDim = THTensor_(size)(weight, 1);
+  THNN_(CSRBatch) batch;
 
-  // gradBias += gradOutput
-  THTensor* buf = THTensor_(new)();
-  THTensor_(sum)(buf, gradOutput, 0, 1);
-  THTensor_(cadd)(gradBias, gradBias, scale, buf);
-  THTensor_(free)(buf);
-  THLongTensor_free(csc);
+  THNN_(SparseLinear_checkCSR)(&batch, rowPtr, cols, values);
+  THArgCheck(THNN_(checkSize2D)(gradOutput, batch.batchSize, outDim) &&
+             THTensor_(isContiguous)(gradOutput), 5,
+             "gradOutput must be a contiguous batchSize x outDim matrix");
+  THArgCheck(THNN_(checkSize2D)(gradWeight, outDim, inDim), 6,
+             "gradWeight size wrong");
+  THArgCheck(THNN_(checkSize1D)(gradBias, outDim), 7,
+             "gradBias size wrong");
 
-  if (weightDecay != 0) {
-    THTensor_(cadd)(gradWeight, gradWeight, weightDecay, weight);
-  }
-  THTensor_(free)(weight);
+  THNN_(SparseLinear_csrGradParameters)(&batch, gradOutput, gradWeight, gradBias,
+                                        weight, weightDecay, scale, 0);
 }
 
 void THNN_(SparseLinear_legacyAccGradParameters)(
@@ -223,8 +223,7 @@ void THNN_(SpatialAdaptiveMaxPooling_updateGradInput)(
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
   /* resize */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   if (input->nDimension == 4) {
     nbatch = input->size[0];
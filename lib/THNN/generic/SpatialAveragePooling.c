@@ -85,6 +85,7 @@ void THNN_(SpatialAveragePooling_updateOutput)(
 {
   real *output_data;
   real *input_data;
+  real *divH, *divW;
 
   int dimw = 2;
   int dimh = 1;
@@ -143,56 +144,37 @@ void THNN_(SpatialAveragePooling_updateOutput)(
   input_data = THTensor_(data)(input);
   output_data = THTensor_(data)(output);
 
+  /* the divisors are separable: height extent times width extent */
+  divH = THAlloc(sizeof(real) * (outputHeight + outputWidth));
+  divW = divH + outputHeight;
+  THNN_(pooling_windowSizes)(divH, inputHeight, outputHeight, kH, dH, padH, count_include_pad);
+  THNN_(pooling_windowSizes)(divW, inputWidth, outputWidth, kW, dW, padW, count_include_pad);
+
+  /* planes of all the samples are independent */
 #pragma omp parallel for private(k)
-  for(k = 0; k < nInputPlane; k++)
+  for(k = 0; k < nbatch*nInputPlane; k++)
   {
-    long p;
-    for(p = 0; p < nbatch; p++)
+    real *ptr_output = output_data + k*outputWidth*outputHeight;
+    real *ptr_input = input_data + k*inputWidth*inputHeight;
+    long xx, yy, ky;
+
+    for(yy = 0; yy < outputHeight; yy++)
     {
-      long xx, yy;
-      /* For all output pixels... */
-      real *ptr_output = output_data + p*nInputPlane*outputWidth*outputHeight + k*outputWidth*outputHeight;
-      real *ptr_input = input_data + p*nInputPlane*inputWidth*inputHeight + k*inputWidth*inputHeight;
-      long i;
-      for(i = 0; i < outputWidth*outputHeight; i++)
-        ptr_output[i] = 0;
-
-      for(yy = 0; yy < outputHeight; yy++)
-      {
-        for(xx = 0; xx < outputWidth; xx++)
-        {
-          /* Compute the mean of the input image... */
-          long hstart = yy * dH - padH;
-          long wstart = xx * dW - padW;
-          long hend = fminf(hstart + kH, inputHeight + padH);
-          long wend = fminf(wstart + kW, inputWidth + padW);
-          int pool_size = (hend - hstart) * (wend - wstart);
-          hstart = fmaxf(hstart, 0);
-          wstart = fmaxf(wstart, 0);
-          hend = fminf(hend, inputHeight);
-          wend = fminf(wend, inputWidth);
-
-          real sum = 0;
-
-          int divide_factor;
-          if(count_include_pad)
-            divide_factor = pool_size;
-          else
-            divide_factor = (hend - hstart) * (wend - wstart);
-
-          long kx, ky;
-
-          for(ky = hstart; ky < hend; ky++)
-          {
-            for(kx = wstart; kx < wend; kx++)
-              sum += ptr_input[ky*inputWidth + kx];
-          }
-          /* Update output */
-          *ptr_output++ += sum/divide_factor;
-        }
-      }
+      real *op = ptr_output + yy*outputWidth;
+      long hstart = yy * dH - padH;
+      long hend = hstart + kH < inputHeight ? hstart + kH : inputHeight;
+      hstart = hstart > 0 ? hstart : 0;
+
+      for(xx = 0; xx < outputWidth; xx++)
+        op[xx] = 0;
+      /* sum the rows of the windows, then divide */
+      for(ky = hstart; ky < hend; ky++)
+        THNN_(pooling_sumRow)(ptr_input + ky*inputWidth, inputWidth, op, outputWidth, kW, dW, padW);
+      for(xx = 0; xx < outputWidth; xx++)
+        op[xx] /= divH[yy] * divW[xx];
     }
   }
+  THFree(divH);
   THTensor_(free)(input);
 }
 
@@ -223,7 +205,8 @@ void THNN_(SpatialAveragePooling_updateGradInput)(
   long nInputPlane; // number of channels (or colors)
 
   real *gradOutput_data;
-  real *input_data, *gradInput_data;
+  real *gradInput_data;
+  real *divH, *divW;
 
   long k;
 
@@ -274,54 +257,36 @@ void THNN_(SpatialAveragePooling_updateGradInput)(
   gradInput_data = THTensor_(data)(gradInput);
   gradOutput_data = THTensor_(data)(gradOutput);
 
+  divH = THAlloc(sizeof(real) * (outputHeight + outputWidth));
+  divW = divH + outputHeight;
+  THNN_(pooling_windowSizes)(divH, inputHeight, outputHeight, kH, dH, padH, count_include_pad);
+  THNN_(pooling_windowSizes)(divW, inputWidth, outputWidth, kW, dW, padW, count_include_pad);
+
+  /* planes of all the samples are independent */
 #pragma omp parallel for private(k)
-  for(k = 0; k < nInputPlane; k++)
+  for(k = 0; k < nbatch*nInputPlane; k++)
   {
-    long p;
-    for(p = 0; p < nbatch; p++)
+    real *ptr_gradOutput = gradOutput_data + k*outputWidth*outputHeight;
+    real *ptr_gradInput = gradInput_data + k*inputWidth*inputHeight;
+    long i, yy, ky;
+
+    for(i = 0; i < inputWidth*inputHeight; i++)
+      ptr_gradInput[i] = 0;
+
+    for(yy = 0; yy < outputHeight; yy++)
     {
-      real *ptr_gradOutput = gradOutput_data + p*nInputPlane*outputHeight*outputWidth + k*outputWidth*outputHeight;
-      long xx, yy;
-
-      real* ptr_gi = gradInput_data + p*nInputPlane*inputWidth*inputHeight + k*inputWidth*inputHeight;
-      real *ptr_gradInput = gradInput_data + p*nInputPlane*inputWidth*inputHeight + k*inputWidth*inputHeight;
-
-      long i;
-      for(i=0; i<inputWidth*inputHeight; i++)
-        ptr_gi[i] = 0.0;
-
-      for(yy = 0; yy < outputHeight; yy++)
-      {
-        for(xx = 0; xx < outputWidth; xx++)
-        {
-          long hstart = yy * dH - padH;
-          long wstart = xx * dW - padW;
-          long hend = fminf(hstart + kH, inputHeight + padH);
-          long wend = fminf(wstart + kW, inputWidth + padW);
-          int pool_size = (hend - hstart) * (wend - wstart);
-          hstart = fmaxf(hstart, 0);
-          wstart = fmaxf(wstart, 0);
-          hend = fminf(hend, inputHeight);
-          wend = fminf(wend, inputWidth);
-
-          real z = *ptr_gradOutput++;
-
-          int divide_factor;
-          if(count_include_pad)
-            divide_factor = pool_size;
-          else
-            divide_factor = (hend - hstart) * (wend - wstart);
-
-          long kx, ky;
-          for(ky = hstart ; ky < hend; ky++)
-          {
-            for(kx = wstart; kx < wend; kx++)
-              ptr_gradInput[ky*inputWidth + kx] += z/divide_factor;
-          }
-        }
-      }
+      long hstart = yy * dH - padH;
+      long hend = hstart + kH < inputHeight ? hstart + kH : inputHeight;
+      hstart = hstart > 0 ? hstart : 0;
+
+      /* scatter the divided gradient of the row to each row of its windows */
+      for(ky = hstart; ky < hend; ky++)
+        THNN_(pooling_scatterRow)(ptr_gradInput + ky*inputWidth, inputWidth,
+                                  ptr_gradOutput + yy*outputWidth, divW, divH[yy],
+                                  outputWidth, kW, dW, padW);
     }
   }
+  THFree(divH);
 
   THTensor_(free)(gradOutput);
 }
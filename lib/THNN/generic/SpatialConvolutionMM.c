@@ -86,15 +86,16 @@ static void THNN_(SpatialConvolutionMM_updateOutput_frame)(
           long outputHeight)
 {
   long i;
+  THTensorView output2dView;
   THTensor *output2d;
 
   THNN_(unfolded_copy)(finput, input, kW, kH, dW, dH, padW, padH,
 		       nInputPlane, inputWidth, inputHeight,
 		       outputWidth, outputHeight);
 
-  output2d = THTensor_(newWithStorage2d)(output->storage, output->storageOffset,
-                                         nOutputPlane, -1,
-                                         outputHeight*outputWidth, -1);
+  output2d = THTensor_(viewWithStorage2d)(&output2dView, output->storage, output->storageOffset,
+                                          nOutputPlane, -1,
+                                          outputHeight*outputWidth, -1);
   if (bias) {
     for(i = 0; i < nOutputPlane; i++)
         THVector_(fill)
@@ -105,8 +106,6 @@ static void THNN_(SpatialConvolutionMM_updateOutput_frame)(
   }
 
   THTensor_(addmm)(output2d, 1, output2d, 1, weight, finput);
-
-  THTensor_(free)(output2d);
 }
 
 void THNN_(SpatialConvolutionMM_updateOutput)(
@@ -170,19 +169,16 @@ void THNN_(SpatialConvolutionMM_updateOutput)(
 #pragma omp parallel for private(t)
     for(t = 0; t < T; t++)
     {
-      THTensor *input_t = THTensor_(newSelect)(input, 0, t);
-      THTensor *output_t = THTensor_(newSelect)(output, 0, t);
-      THTensor *finput_t = THTensor_(newSelect)(finput, 0, t);
+      THTensorView input_v, output_v, finput_v;
+      THTensor *input_t = THTensor_(viewSelect)(&input_v, input, 0, t);
+      THTensor *output_t = THTensor_(viewSelect)(&output_v, output, 0, t);
+      THTensor *finput_t = THTensor_(viewSelect)(&finput_v, finput, 0, t);
 
       THNN_(SpatialConvolutionMM_updateOutput_frame)
 	(input_t, output_t, weight, bias, finput_t,
 	 kW, kH, dW, dH, padW, padH,
 	 nInputPlane, inputWidth, inputHeight,
 	 nOutputPlane, outputWidth, outputHeight);
-
-      THTensor_(free)(input_t);
-      THTensor_(free)(output_t);
-      THTensor_(free)(finput_t);
     }
   }
 
@@ -202,12 +198,12 @@ static void THNN_(SpatialConvolutionMM_updateGradInput_frame)(
           int padW,
           int padH)
 {
-  THTensor *gradOutput2d = THTensor_(newWithStorage2d)
-    (gradOutput->storage, gradOutput->storageOffset,
+  THTensorView gradOutput2dView;
+  THTensor *gradOutput2d = THTensor_(viewWithStorage2d)
+    (&gradOutput2dView, gradOutput->storage, gradOutput->storageOffset,
      gradOutput->size[0], -1,
      gradOutput->size[1]*gradOutput->size[2], -1);
   THTensor_(addmm)(fgradInput, 0, fgradInput, 1, weight, gradOutput2d);
-  THTensor_(free)(gradOutput2d);
 
   THTensor_(zero)(gradInput);
 
@@ -264,17 +260,14 @@ void THNN_(SpatialConvolutionMM_updateGradInput)(
 #pragma omp parallel for private(t)
     for(t = 0; t < T; t++)
     {
-      THTensor *gradInput_t = THTensor_(newSelect)(gradInput, 0, t);
-      THTensor *gradOutput_t = THTensor_(newSelect)(gradOutput, 0, t);
-      THTensor *fgradInput_t = THTensor_(newSelect)(fgradInput, 0, t);
+      THTensorView gradInput_v, gradOutput_v, fgradInput_v;
+      THTensor *gradInput_t = THTensor_(viewSelect)(&gradInput_v, gradInput, 0, t);
+      THTensor *gradOutput_t = THTensor_(viewSelect)(&gradOutput_v, gradOutput, 0, t);
+      THTensor *fgradInput_t = THTensor_(viewSelect)(&fgradInput_v, fgradInput, 0, t);
 
       THNN_(SpatialConvolutionMM_updateGradInput_frame)(gradInput_t, gradOutput_t,
 							tweight, fgradInput_t,
 							kW, kH, dW, dH, padW, padH);
-
-      THTensor_(free)(gradInput_t);
-      THTensor_(free)(gradOutput_t);
-      THTensor_(free)(fgradInput_t);
     }
   }
 
@@ -292,15 +285,14 @@ static void THNN_(SpatialConvolutionMM_accGradParameters_frame)(
           real scale)
 {
   long i;
-  THTensor *gradOutput2d = THTensor_(newWithStorage2d)
-    (gradOutput->storage, gradOutput->storageOffset,
+  THTensorView gradOutput2dView, tfinputView;
+  THTensor *gradOutput2d = THTensor_(viewWithStorage2d)
+    (&gradOutput2dView, gradOutput->storage, gradOutput->storageOffset,
      gradOutput->size[0], -1,
      gradOutput->size[1]*gradOutput->size[2], -1);
 
-  THTensor *tfinput = THTensor_(new)();
-  THTensor_(transpose)(tfinput, finput, 0, 1);
+  THTensor *tfinput = THTensor_(viewTranspose)(&tfinputView, finput, 0, 1);
   THTensor_(addmm)(gradWeight, 1, gradWeight, scale, gradOutput2d, tfinput);
-  THTensor_(free)(tfinput);
 
   if (gradBias) {
     for(i = 0; i < gradBias->size[0]; i++)
@@ -313,8 +305,6 @@ static void THNN_(SpatialConvolutionMM_accGradParameters_frame)(
       (gradBias->storage->data + gradBias->storageOffset)[i] += scale*sum;
     }
   }
-
-  THTensor_(free)(gradOutput2d);
 }
 
 void THNN_(SpatialConvolutionMM_accGradParameters)(
@@ -358,14 +348,12 @@ void THNN_(SpatialConvolutionMM_accGradParameters)(
 
     for(t = 0; t < T; t++)
     {
-      THTensor *gradOutput_t = THTensor_(newSelect)(gradOutput, 0, t);
-      THTensor *finput_t = THTensor_(newSelect)(finput, 0, t);
+      THTensorView gradOutput_v, finput_v;
+      THTensor *gradOutput_t = THTensor_(viewSelect)(&gradOutput_v, gradOutput, 0, t);
+      THTensor *finput_t = THTensor_(viewSelect)(&finput_v, finput, 0, t);
 
       THNN_(SpatialConvolutionMM_accGradParameters_frame)(gradOutput_t, gradWeight,
 							  gradBias, finput_t, scale);
-
-      THTensor_(free)(gradOutput_t);
-      THTensor_(free)(finput_t);
     }
   }
 
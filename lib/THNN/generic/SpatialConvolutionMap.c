@@ -139,8 +139,7 @@ void THNN_(SpatialConvolutionMap_updateGradInput)(
   connTable = THTensor_(newContiguous)(connTable);
 
   /* Resize/Zero */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   /* get raw pointers */
   real *gradInput_data = THTensor_(data)(gradInput);
@@ -83,101 +83,29 @@ void THNN_(SpatialDilatedConvolution_updateOutput)(
   input = THTensor_(newContiguous)(input);
   weight = THTensor_(newContiguous)(weight);
   bias = bias ? THTensor_(newContiguous)(bias) : bias;
-  int batch = 1;
-  if (input->nDimension == 3) {
-    // Force batch
-    batch = 0;
-    THTensor_(resize4d)(input, 1, input->size[0], input->size[1], input->size[2]);
-  }
-  long inputWidth   = input->size[3];
-  long inputHeight  = input->size[2];
-  long outputWidth  = (inputWidth + 2*padW - (dilationW * (kW - 1) + 1)) / dW + 1;
-  long outputHeight = (inputHeight + 2*padH - (dilationH * (kH - 1) + 1)) / dH + 1;
-
-  // Batch size + input planes
-  long batchSize = input->size[0];
-
-  // Resize output
-  THTensor_(resize4d)(output, batchSize, nOutputPlane, outputHeight, outputWidth);
-  THTensor_(zero)(output);
-
-  // Resize temporary columns
-  THTensor_(resize2d)(columns, nInputPlane*kW*kH, outputHeight*outputWidth);
-
-  // Define a buffer of ones, for bias accumulation
-  // Note: this buffer can be shared with other modules, it only ever gets increased,
-  // and always contains ones.
-  if (ones->nDimension != 2 || ones->size[0]*ones->size[1] < outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THTensor_(resize2d)(ones, outputHeight, outputWidth);
-    THTensor_(fill)(ones, 1);
-  }
-
-  // Helpers
-  THTensor *input_n = THTensor_(new)();
-  THTensor *output_n = THTensor_(new)();
-
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per output:
-    THTensor_(select)(input_n, input, 0, elt);
-    THTensor_(select)(output_n, output, 0, elt);
-
-    // Do Bias first:
-    // M,N,K are dims of matrix A and B
-    long m_ = nOutputPlane;
-    long n_ = outputHeight * outputWidth;
-    long k_ = 1;
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    if (bias) {
-      THBlas_(gemm)(
-        't', 'n',
-        n_, m_, k_,
-        1,
-        THTensor_(data)(ones), k_,
-        THTensor_(data)(bias), k_,
-        0,
-        THTensor_(data)(output_n), n_
-      );
-    } else {
-      THTensor_(zero)(output_n);
-    }
-
-    // Extract columns:
-    THNN_(im2col)(
-      THTensor_(data)(input_n),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      dilationH, dilationW,
-      THTensor_(data)(columns)
-    );
-
-    // M,N,K are dims of matrix A and B
-    long m = nOutputPlane;
-    long n = columns->size[1];
-    long k = nInputPlane*kH*kW;
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THBlas_(gemm)(
-      'n', 'n',
-      n, m, k,
-      1,
-      THTensor_(data)(columns), n,
-      THTensor_(data)(weight), k,
-      1,
-      THTensor_(data)(output_n), n
-    );
-  }
+  int batch = input->nDimension == 4;
+  long batchSize = batch ? input->size[0] : 1;
 
-  // Free
-  THTensor_(free)(input_n);
-  THTensor_(free)(output_n);
+  THNN_(VolumetricColumns) g;
+  THNN_(VolumetricColumns_initSpatial)(
+    &g, nInputPlane, input->size[batch+1], input->size[batch+2],
+    kH, kW, padH, padW, dH, dW, dilationH, dilationW);
 
   // Resize output
-  if (batch == 0) {
-    THTensor_(resize3d)(output, nOutputPlane, outputHeight, outputWidth);
-    THTensor_(resize3d)(input, nInputPlane, inputHeight, inputWidth);
-  }
+  if (batch)
+    THTensor_(resize4d)(output, batchSize, nOutputPlane, g.depth_col, g.width_col);
+  else
+    THTensor_(resize3d)(output, nOutputPlane, g.depth_col, g.width_col);
+
+  // Unfold and multiply, in parallel over frames and bands of rows (the
+  // bias is written before the GEMM, so ones is not needed)
+  THNN_(VolumetricColumns_unfoldMultiply)(
+    &g, batchSize,
+    THTensor_(data)(input), g.channels * g.depth * g.width,
+    THTensor_(data)(weight), nOutputPlane,
+    bias ? THTensor_(data)(bias) : NULL,
+    THTensor_(data)(output), nOutputPlane * g.depth_col * g.width_col,
+    columns);
 
   THTensor_(free)(input);
   THTensor_(free)(weight);
@@ -207,75 +135,24 @@ void THNN_(SpatialDilatedConvolution_updateGradInput)(
   input = THTensor_(newContiguous)(input);
   weight = THTensor_(newContiguous)(weight);
   gradOutput = THTensor_(newContiguous)(gradOutput);
-  int batch = 1;
-  if (input->nDimension == 3) {
-    // Force batch
-    batch = 0;
-    THTensor_(resize4d)(input, 1, input->size[0], input->size[1], input->size[2]);
-    THTensor_(resize4d)(gradOutput, 1, gradOutput->size[0], gradOutput->size[1],
-			gradOutput->size[2]);
-  }
-
-  long inputWidth   = input->size[3];
-  long inputHeight  = input->size[2];
-  long outputWidth  = (inputWidth + 2*padW - (dilationW * (kW - 1) + 1)) / dW + 1;
-  long outputHeight = (inputHeight + 2*padH - (dilationH * (kH - 1) + 1)) / dH + 1;
+  int batch = input->nDimension == 4;
+  long batchSize = batch ? input->size[0] : 1;
 
-  // Batch size + input planes
-  long batchSize = input->size[0];
+  THNN_(VolumetricColumns) g;
+  THNN_(VolumetricColumns_initSpatial)(
+    &g, nInputPlane, input->size[batch+1], input->size[batch+2],
+    kH, kW, padH, padW, dH, dW, dilationH, dilationW);
 
   // Resize output
-  THTensor_(resize4d)(gradInput, batchSize, nInputPlane, inputHeight, inputWidth);
-
-  // Resize temporary columns
-  THTensor_(resize2d)(gradColumns, nInputPlane*kW*kH, outputHeight*outputWidth);
-  THTensor_(zero)(gradColumns);
-
-  // Helpers
-  THTensor *gradInput_n = THTensor_(new)();
-  THTensor *gradOutput_n = THTensor_(new)();
-
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per sample:
-    THTensor_(select)(gradInput_n, gradInput, 0, elt);
-    THTensor_(select)(gradOutput_n, gradOutput, 0, elt);
-
-    // M,N,K are dims of matrix A and B
-    long m = nInputPlane*kW*kH;
-    long n = gradColumns->size[1];
-    long k = nOutputPlane;
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THBlas_(gemm)(
-        'n', 't',
-        n, m, k,
-        1,
-        THTensor_(data)(gradOutput_n), n,
-        THTensor_(data)(weight), m,
-        0,
-        THTensor_(data)(gradColumns), n
-    );
-
-    // Unpack columns back into input:
-    THNN_(col2im)(
-      THTensor_(data)(gradColumns),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      dilationH, dilationW,
-      THTensor_(data)(gradInput_n)
-    );
-  }
+  THTensor_(resizeAs)(gradInput, input);
 
-  // Free
-  THTensor_(free)(gradInput_n);
-  THTensor_(free)(gradOutput_n);
-
-  // Resize output
-  if (batch == 0) {
-    THTensor_(resize3d)(gradOutput, nOutputPlane, outputHeight, outputWidth);
-    THTensor_(resize3d)(input, nInputPlane, inputHeight, inputWidth);
-    THTensor_(resize3d)(gradInput, nInputPlane, inputHeight, inputWidth);
-  }
+  // Multiply and fold back into the input
+  THNN_(VolumetricColumns_multiplyFold)(
+    &g, batchSize,
+    THTensor_(data)(gradOutput), nOutputPlane * g.depth_col * g.width_col,
+    THTensor_(data)(weight), nOutputPlane,
+    THTensor_(data)(gradInput), g.channels * g.depth * g.width,
+    gradColumns);
 
   THTensor_(free)(input);
   THTensor_(free)(gradOutput);
@@ -311,95 +188,28 @@ void THNN_(SpatialDilatedConvolution_accGradParameters)(
   THArgCheck(THTensor_(isContiguous)(gradWeight), 4, "gradWeight needs to be contiguous");
   if (gradBias)
     THArgCheck(THTensor_(isContiguous)(gradBias), 5, "gradBias needs to be contiguous");
-  int batch = 1;
-  if (input->nDimension == 3) {
-    // Force batch
-    batch = 0;
-    THTensor_(resize4d)(input, 1, input->size[0], input->size[1], input->size[2]);
-    THTensor_(resize4d)(gradOutput, 1, gradOutput->size[0],
-			gradOutput->size[1], gradOutput->size[2]);
-  }
-
-  long inputWidth   = input->size[3];
-  long inputHeight  = input->size[2];
-  long outputWidth  = (inputWidth + 2*padW - (dilationW * (kW - 1) + 1)) / dW + 1;
-  long outputHeight = (inputHeight + 2*padH - (dilationH * (kH - 1) + 1)) / dH + 1;
-
-  // Batch size + input planes
-  long batchSize = input->size[0];
-
-  // Define a buffer of ones, for bias accumulation
-  if (ones->nDimension != 2 || ones->size[0]*ones->size[1] < outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THTensor_(resize2d)(ones, outputHeight, outputWidth);
-    THTensor_(fill)(ones, 1);
-  }
-
-  // Resize temporary columns
-  THTensor_(resize2d)(columns, nInputPlane*kW*kH, outputHeight*outputWidth);
-
-  // Helpers
-  THTensor *input_n = THTensor_(new)();
-  THTensor *gradOutput_n = THTensor_(new)();
-
-  // For each elt in batch, do:
-  for (int elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per output:
-    THTensor_(select)(input_n, input, 0, elt);
-    THTensor_(select)(gradOutput_n, gradOutput, 0, elt);
-
-    // Extract columns:
-    THNN_(im2col)(
-      THTensor_(data)(input_n),
-      nInputPlane, inputHeight, inputWidth, kH, kW, padH, padW, dH, dW,
-      dilationH, dilationW,
-      THTensor_(data)(columns)
-    );
-
-    // M,N,K are dims of matrix A and B
-    long m = nOutputPlane;
-    long n = nInputPlane*kW*kH;
-    long k = columns->size[1];
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THBlas_(gemm)(
-        't', 'n',
-        n, m, k,
-        scale,
-        THTensor_(data)(columns), k,
-        THTensor_(data)(gradOutput_n), k,
-        1,
-        THTensor_(data)(gradWeight), n
-    );
-
-    // Do Bias:
-    // M,N,K are dims of matrix A and B
-    long m_ = nOutputPlane;
-    long k_ = outputHeight * outputWidth;
-
-    // Do GEMV (note: this is a bit confusing because gemv assumes column-major matrices)
-    if (gradBias) {
-      THBlas_(gemv)(
-          't',
-          k_, m_,
-          scale,
-          THTensor_(data)(gradOutput_n), k_,
-          THTensor_(data)(ones), 1,
-          1,
-          THTensor_(data)(gradBias), 1
-      );
-    }
-  }
-
-  // Free
-  THTensor_(free)(input_n);
-  THTensor_(free)(gradOutput_n);
-
-  // Resize
-  if (batch == 0) {
-    THTensor_(resize3d)(gradOutput, nOutputPlane, outputHeight, outputWidth);
-    THTensor_(resize3d)(input, nInputPlane, inputHeight, inputWidth);
-  }
+  int batch = input->nDimension == 4;
+  long batchSize = batch ? input->size[0] : 1;
+
+  THNN_(VolumetricColumns) g;
+  THNN_(VolumetricColumns_initSpatial)(
+    &g, nInputPlane, input->size[batch+1], input->size[batch+2],
+    kH, kW, padH, padW, dH, dW, dilationH, dilationW);
+  long outputSize = g.depth_col * g.width_col;
+
+  // Weight gradient, summed over per-thread copies
+  THNN_(VolumetricColumns_accumulateOuter)(
+    &g, batchSize,
+    THTensor_(data)(gradOutput), nOutputPlane * outputSize,
+    THTensor_(data)(input), g.channels * g.depth * g.width,
+    THTensor_(data)(gradWeight), nOutputPlane, scale,
+    columns);
+
+  // Bias gradient
+  if (gradBias)
+    THNN_(VolumetricColumns_planeSums)(
+      THTensor_(data)(gradOutput), batchSize, nOutputPlane * outputSize,
+      nOutputPlane, outputSize, THTensor_(data)(gradBias), scale);
 
   THTensor_(free)(input);
   THTensor_(free)(gradOutput);
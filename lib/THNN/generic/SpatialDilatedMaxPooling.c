@@ -78,11 +78,13 @@ static inline void THNN_(SpatialDilatedMaxPooling_shapeCheck)(
   }
 }
 
+/* Max pooling of one plane: each output row folds in its input rows in
+ * increasing order, so ties resolve to the first maximum in row-major order
+ * as in a window scan. ind_p may be NULL in inference mode. */
 static void THNN_(SpatialDilatedMaxPooling_updateOutput_frame)(
           real *input_p,
           real *output_p,
           THIndex_t *ind_p,
-          long nslices,
           long iwidth,
           long iheight,
           long owidth,
@@ -97,55 +99,29 @@ static void THNN_(SpatialDilatedMaxPooling_updateOutput_frame)(
           int dilationH
           )
 {
-  long k;
-#pragma omp parallel for private(k)
-  for (k = 0; k < nslices; k++)
+  long i, j, y;
+  for (i = 0; i < oheight; i++)
   {
-    /* loop over output */
-    long i, j;
-    real *ip = input_p   + k*iwidth*iheight;
-    for(i = 0; i < oheight; i++)
+    real *op = output_p + i*owidth;
+    THIndex_t *indp = ind_p ? ind_p + i*owidth : NULL;
+    long hstart = i * dH - padH;
+    long hend = hstart + (kH - 1) * dilationH + 1;
+    hend = hend < iheight ? hend : iheight;
+    while(hstart < 0)
+      hstart += dilationH;
+
+    for (j = 0; j < owidth; j++)
+    {
+      op[j] = -THInf;
+      if (indp)
+        indp[j] = TH_INDEX_BASE - 1;
+    }
+    for (y = hstart; y < hend; y += dilationH)
     {
-      for(j = 0; j < owidth; j++)
-      {
-        long hstart = i * dH - padH;
-        long wstart = j * dW - padW;
-        long hend = fminf(hstart + (kH - 1) * dilationH + 1, iheight);
-        long wend = fminf(wstart + (kW - 1) * dilationW + 1, iwidth);
-        while(hstart < 0)
-          hstart += dilationH;
-        while(wstart < 0)
-          wstart += dilationW;
-
-        /* local pointers */
-        real *op = output_p  + k*owidth*oheight + i*owidth + j;
-        THIndex_t *indp = ind_p   + k*owidth*oheight + i*owidth + j;
-
-        /* compute local max: */
-        long maxindex = -1;
-        real maxval = -THInf;
-        long tcntr = 0;
-        long x,y;
-        for(y = hstart; y < hend; y += dilationH)
-        {
-          for(x = wstart; x < wend; x += dilationW)
-          {
-            tcntr = y*iwidth + x;
-            real val = *(ip + tcntr);
-            if (val > maxval)
-            {
-              maxval = val;
-              maxindex = tcntr;
-            }
-          }
-        }
-
-        /* set output to local max */
-        *op = maxval;
-
-        /* store location of max */
-        *indp = maxindex + TH_INDEX_BASE;
-      }
+      /* the index of input (y, x) is y*iwidth + x */
+      THNN_(pooling_maxRow)(input_p + y*iwidth, iwidth, op, indp, owidth,
+                            kW, dW, padW, dilationW,
+                            y*iwidth - padW + TH_INDEX_BASE, dW, dilationW);
     }
   }
 }
@@ -177,6 +153,7 @@ void THNN_(SpatialDilatedMaxPooling_updateOutput)(
   real *input_data;
   real *output_data;
   THIndex_t *indices_data;
+  long k;
 
   THNN_(SpatialDilatedMaxPooling_shapeCheck)
     (input, NULL, NULL, kH, kW, dH, dW,
@@ -222,16 +199,29 @@ void THNN_(SpatialDilatedMaxPooling_updateOutput)(
   {
     THTensor_(resize3d)(output, nInputPlane, outputHeight, outputWidth);
     /* indices will contain the locations for each output point */
-    THIndexTensor_(resize3d)(indices,  nInputPlane, outputHeight, outputWidth);
+    if (indices)
+      THIndexTensor_(resize3d)(indices,  nInputPlane, outputHeight, outputWidth);
+  }
+  else
+  {
+    THTensor_(resize4d)(output, nbatch, nInputPlane, outputHeight, outputWidth);
+    /* indices will contain the locations for each output point */
+    if (indices)
+      THIndexTensor_(resize4d)(indices, nbatch, nInputPlane, outputHeight, outputWidth);
+  }
 
-    input_data = THTensor_(data)(input);
-    output_data = THTensor_(data)(output);
-    indices_data = THIndexTensor_(data)(indices);
+  input_data = THTensor_(data)(input);
+  output_data = THTensor_(data)(output);
+  indices_data = indices ? THIndexTensor_(data)(indices) : NULL;
 
+  /* planes of all the samples are independent */
+#pragma omp parallel for private(k)
+  for (k = 0; k < nbatch*nInputPlane; k++)
+  {
     THNN_(SpatialDilatedMaxPooling_updateOutput_frame)
-      (input_data, output_data,
-       indices_data,
-       nInputPlane,
+      (input_data + k*inputWidth*inputHeight,
+       output_data + k*outputWidth*outputHeight,
+       indices_data ? indices_data + k*outputWidth*outputHeight : NULL,
        inputWidth, inputHeight,
        outputWidth, outputHeight,
        kW, kH, dW, dH,
@@ -239,34 +229,6 @@ void THNN_(SpatialDilatedMaxPooling_updateOutput)(
        dilationW, dilationH
        );
   }
-  else
-  {
-    long p;
-
-    THTensor_(resize4d)(output, nbatch, nInputPlane, outputHeight, outputWidth);
-    /* indices will contain the locations for each output point */
-    THIndexTensor_(resize4d)(indices, nbatch, nInputPlane, outputHeight, outputWidth);
-
-    input_data = THTensor_(data)(input);
-    output_data = THTensor_(data)(output);
-    indices_data = THIndexTensor_(data)(indices);
-
-#pragma omp parallel for private(p)
-    for (p = 0; p < nbatch; p++)
-    {
-      THNN_(SpatialDilatedMaxPooling_updateOutput_frame)
-	(input_data+p*nInputPlane*inputWidth*inputHeight,
-	 output_data+p*nInputPlane*outputWidth*outputHeight,
-	 indices_data+p*nInputPlane*outputWidth*outputHeight,
-	 nInputPlane,
-	 inputWidth, inputHeight,
-	 outputWidth, outputHeight,
-	 kW, kH, dW, dH,
-	 padW, padH,
-	 dilationW, dilationH
-	 );
-    }
-  }
 
   /* cleanup */
   THTensor_(free)(input);
@@ -276,39 +238,57 @@ static void THNN_(SpatialDilatedMaxPooling_updateGradInput_frame)(
           real *gradInput_p,
           real *gradOutput_p,
           THIndex_t *ind_p,
-          long nInputPlane,
           long inputWidth,
           long inputHeight,
           long outputWidth,
-          long outputHeight,
-          int dW,
-          int dH)
+          long outputHeight)
 {
-  long k;
-#pragma omp parallel for private(k)
-  for (k = 0; k < nInputPlane; k++)
+  long i;
+  for (i = 0; i < outputWidth*outputHeight; i++)
   {
-    real *gradInput_p_k = gradInput_p + k*inputWidth*inputHeight;
-    real *gradOutput_p_k = gradOutput_p + k*outputWidth*outputHeight;
-    THIndex_t *ind_p_k = ind_p + k*outputWidth*outputHeight;
-
-    /* calculate max points */
-    long i, j;
-    for(i = 0; i < outputHeight; i++)
-    {
-      for(j = 0; j < outputWidth; j++)
-      {
-        /* retrieve position of max */
-        long maxp = ind_p_k[i*outputWidth + j] - TH_INDEX_BASE;
-	if (maxp != -1) {
-	  /* update gradient */
-	  gradInput_p_k[maxp] += gradOutput_p_k[i*outputWidth + j];
-	}
-      }
+    /* retrieve position of max */
+    long maxp = ind_p[i] - TH_INDEX_BASE;
+    if (maxp != -1) {
+      /* update gradient */
+      gradInput_p[maxp] += gradOutput_p[i];
     }
   }
 }
 
+/* Gradient of one input row y of a plane: the output rows whose window
+ * has a tap on row y give their gradient to the inputs of the row that
+ * they picked. */
+static void THNN_(SpatialDilatedMaxPooling_updateGradInput_row)(
+          real *gradInput_p,
+          real *gradOutput_p,
+          THIndex_t *ind_p,
+          long y,
+          long iwidth,
+          long owidth,
+          long oheight,
+          int kW,
+          int kH,
+          int dW,
+          int dH,
+          int padW,
+          int padH,
+          int dilationW,
+          int dilationH)
+{
+  int kh;
+  for (kh = 0; kh < kH; kh++)
+  {
+    long t = y + padH - (long)kh * dilationH;
+    long i = t / dH;
+    if (t < 0 || t % dH != 0 || i >= oheight)
+      continue;
+    THNN_(pooling_maxGradRow)(gradInput_p + y*iwidth, iwidth,
+                              gradOutput_p + i*owidth, ind_p + i*owidth, owidth,
+                              kW, dW, padW, dilationW,
+                              y*iwidth - padW + TH_INDEX_BASE, dW, dilationW);
+  }
+}
+
 void THNN_(SpatialDilatedMaxPooling_updateGradInput)(
           THNNState *state,
           THTensor *input,
@@ -336,7 +316,10 @@ void THNN_(SpatialDilatedMaxPooling_updateGradInput)(
   real *gradInput_data;
   real *gradOutput_data;
   THIndex_t *indices_data;
+  long k;
+  int gather = 0;
 
+  THArgCheck(indices != NULL, 5, "indices of the forward pass are required");
   THNN_(SpatialDilatedMaxPooling_shapeCheck)
     (input, gradOutput, indices, kH, kW, dH, dW,
      padH, padW, dilationH, dilationW, ceil_mode);
@@ -345,8 +328,7 @@ void THNN_(SpatialDilatedMaxPooling_updateGradInput)(
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
   /* resize */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   if (input->nDimension == 4) {
     nbatch = input->size[0];
@@ -366,32 +348,39 @@ void THNN_(SpatialDilatedMaxPooling_updateGradInput)(
   gradOutput_data = THTensor_(data)(gradOutput);
   indices_data = THIndexTensor_(data)(indices);
 
-  /* backprop */
-  if (input->nDimension == 3)
-  {
-    THNN_(SpatialDilatedMaxPooling_updateGradInput_frame)
-      (gradInput_data, gradOutput_data,
-       indices_data,
-       nInputPlane,
-       inputWidth, inputHeight,
-       outputWidth, outputHeight,
-       dW, dH);
-  }
-  else
+  /* backprop: the planes of all the samples are independent; when they
+     are too few to keep the threads busy, the rows of a plane are, if
+     each gathers its gradient from the outputs instead */
+#ifdef _OPENMP
+  gather = nbatch*nInputPlane < omp_get_max_threads();
+#endif
+  if (!gather)
   {
-    long p;
-#pragma omp parallel for private(p)
-    for (p = 0; p < nbatch; p++)
+#pragma omp parallel for private(k)
+    for (k = 0; k < nbatch*nInputPlane; k++)
     {
       THNN_(SpatialDilatedMaxPooling_updateGradInput_frame)
-	(gradInput_data+p*nInputPlane*inputWidth*inputHeight,
-	 gradOutput_data+p*nInputPlane*outputWidth*outputHeight,
-	 indices_data+p*nInputPlane*outputWidth*outputHeight,
-	 nInputPlane,
-	 inputWidth, inputHeight,
-	 outputWidth, outputHeight,
-	 dW, dH);
+        (gradInput_data + k*inputWidth*inputHeight,
+         gradOutput_data + k*outputWidth*outputHeight,
+         indices_data + k*outputWidth*outputHeight,
+         inputWidth, inputHeight,
+         outputWidth, outputHeight);
     }
+    THTensor_(free)(gradOutput);
+    return;
+  }
+
+#pragma omp parallel for private(k)
+  for (k = 0; k < nbatch*nInputPlane*inputHeight; k++)
+  {
+    long plane = k / inputHeight;
+    THNN_(SpatialDilatedMaxPooling_updateGradInput_row)
+      (gradInput_data + plane*inputWidth*inputHeight,
+       gradOutput_data + plane*outputWidth*outputHeight,
+       indices_data + plane*outputWidth*outputHeight,
+       k % inputHeight, inputWidth,
+       outputWidth, outputHeight,
+       kW, kH, dW, dH, padW, padH, dilationW, dilationH);
   }
 
   /* cleanup */
@@ -224,8 +224,7 @@ void THNN_(SpatialFractionalMaxPooling_updateGradInput)(
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
   /* resize */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   /* backprop */
   if (numInputDims == 3) {
@@ -2,61 +2,6 @@
 #define TH_GENERIC_FILE "generic/SpatialFullConvolution.c"
 #else
 
-static void THNN_(im2col)(const real* data_im, const int channels,
-      const int height, const int width, const int kernel_h, const int kernel_w,
-      const int pad_h, const int pad_w,
-      const int stride_h, const int stride_w,
-      const int dilation_h, const int dilation_w,
-      real* data_col) {
-  const int height_col = (height + 2 * pad_h -
-                          (dilation_h * (kernel_h - 1) + 1)) / stride_h + 1;
-  const int width_col = (width + 2 * pad_w -
-                         (dilation_w * (kernel_w - 1) + 1)) / stride_w + 1;
-  const int channels_col = channels * kernel_h * kernel_w;
-  for (int c_col = 0; c_col < channels_col; ++c_col) {
-    int w_offset = c_col % kernel_w;
-    int h_offset = (c_col / kernel_w) % kernel_h;
-    int c_im = c_col / kernel_h / kernel_w;
-    for (int h_col = 0; h_col < height_col; ++h_col) {
-      for (int w_col = 0; w_col < width_col; ++w_col) {
-        int h_im = h_col * stride_h - pad_h + h_offset * dilation_h;
-        int w_im = w_col * stride_w - pad_w + w_offset * dilation_w;
-        data_col[(c_col * height_col + h_col) * width_col + w_col] =
-          (h_im >= 0 && w_im >= 0 && h_im < height && w_im < width) ?
-          data_im[(c_im * height + h_im) * width + w_im] : 0;
-      }
-    }
-  }
-}
-
-static void THNN_(col2im)(const real* data_col, const int channels,
-      const int height, const int width, const int kernel_h, const int kernel_w,
-      const int pad_h, const int pad_w,
-      const int stride_h, const int stride_w,
-      const int dilation_h, const int dilation_w,
-      real* data_im) {
-  memset(data_im, 0, sizeof(real) * height * width * channels);
-  const int height_col = (height + 2 * pad_h -
-                          (dilation_h * (kernel_h - 1) + 1)) / stride_h + 1;
-  const int width_col = (width + 2 * pad_w -
-                         (dilation_w * (kernel_w - 1) + 1)) / stride_w + 1;
-  const int channels_col = channels * kernel_h * kernel_w;
-  for (int c_col = 0; c_col < channels_col; ++c_col) {
-    int w_offset = c_col % kernel_w;
-    int h_offset = (c_col / kernel_w) % kernel_h;
-    int c_im = c_col / kernel_h / kernel_w;
-    for (int h_col = 0; h_col < height_col; ++h_col) {
-      for (int w_col = 0; w_col < width_col; ++w_col) {
-        int h_im = h_col * stride_h - pad_h + h_offset * dilation_h;
-        int w_im = w_col * stride_w - pad_w + w_offset * dilation_w;
-        if (h_im >= 0 && h_im < height && w_im >= 0 && w_im < width)
-          data_im[(c_im * height + h_im) * width + w_im] +=
-            data_col[(c_col * height_col + h_col) * width_col + w_col];
-      }
-    }
-  }
-}
-
 static inline void THNN_(SpatialFullConvolution_shapeCheck)(
 	THTensor *input, THTensor *gradOutput,
 	THTensor *weight, THTensor *bias,
@@ -71,6 +16,8 @@ static inline void THNN_(SpatialFullConvolution_shapeCheck)(
         adjH, adjW, dH, dW);
   THNN_ARGCHECK(weight->nDimension == 2 || weight->nDimension == 4, 5, weight,
 		"2D or 4D weight tensor expected, but got: %s");
+  THArgCheck(THTensor_(nElement)(weight) == weight->size[0] * weight->size[1] * kH * kW, 5,
+             "weight does not hold a %d x %d kernel per pair of planes", kH, kW);
 
   if (bias != NULL) {
     THNN_CHECK_DIM_SIZE(bias, 1, 0, weight->size[1]);
@@ -111,6 +58,26 @@ static inline void THNN_(SpatialFullConvolution_shapeCheck)(
   }
 }
 
+/* Geometry of the columns of one frame of output: the transposed
+   convolution folds the columns of its input into the output. */
+static void THNN_(SpatialFullConvolution_columns)(
+    THNN_(VolumetricColumns) *g,
+    THTensor *input,
+    long nOutputPlane,
+    int kW, int kH,
+    int dW, int dH,
+    int padW, int padH,
+    int adjW, int adjH)
+{
+  int dimh = input->nDimension == 4 ? 2 : 1;
+
+  THNN_(VolumetricColumns_initSpatial)(
+    g, nOutputPlane,
+    (input->size[dimh]   - 1) * dH - 2*padH + kH + adjH,
+    (input->size[dimh+1] - 1) * dW - 2*padW + kW + adjW,
+    kH, kW, padH, padW, dH, dW, 1, 1);
+}
+
 void THNN_(SpatialFullConvolution_updateOutput)(
     THNNState *state,
     THTensor *input,
@@ -133,104 +100,42 @@ void THNN_(SpatialFullConvolution_updateOutput)(
   input = THTensor_(newContiguous)(input);
   weight = THTensor_(newContiguous)(weight);
   bias = bias ? THTensor_(newContiguous)(bias) : bias;
-  int batch = 1;
-  if (input->nDimension == 3) {
-    // Force batch
-    batch = 0;
-    THTensor_(resize4d)(input, 1, input->size[0], input->size[1], input->size[2]);
-  }
-
-  long inputHeight  = input->size[2];
-  long inputWidth   = input->size[3];
-  long outputHeight = (inputHeight - 1) * dH - 2*padH + kH + adjH;
-  long outputWidth  = (inputWidth - 1) * dW - 2*padW + kW + adjW;
+  int batch = input->nDimension == 4;
+  long batchSize = batch ? input->size[0] : 1;
 
-  // Batch size + input planes
-  long batchSize = input->size[0];
+  THNN_(VolumetricColumns) g;
+  THNN_(SpatialFullConvolution_columns)
+    (&g, input, nOutputPlane, kW, kH, dW, dH, padW, padH, adjW, adjH);
+  long inputSize = g.depth_col * g.width_col;
+  long outputSize = g.depth * g.width;
 
   // Resize output
-  THTensor_(resize4d)(output, batchSize, nOutputPlane, outputHeight, outputWidth);
-
-  // Resize temporary columns
-  THTensor_(resize2d)(columns, nOutputPlane*kW*kH, inputHeight*inputWidth);
-  THTensor_(zero)(columns);
-
-  // Define a buffer of ones, for bias accumulation
-  // Note: this buffer can be shared with other modules, it only ever gets increased,
-  // and always contains ones.
-  if (ones->nDimension != 2 || ones->size[0]*ones->size[1] < outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THTensor_(resize2d)(ones, outputHeight, outputWidth);
-    THTensor_(fill)(ones, 1);
-  }
-
-  // Helpers
-  THTensor *input_n = THTensor_(new)();
-  THTensor *output_n = THTensor_(new)();
-
-  int elt;
-  // For each elt in batch, do:
-  for (elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per output:
-    THTensor_(select)(input_n, input, 0, elt);
-    THTensor_(select)(output_n, output, 0, elt);
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m = weight->size[1] * weight->size[2] * weight->size[3];
-    long n = columns->size[1];
-    long k = weight->size[0];
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THBlas_(gemm)(
-        'n', 't',
-        n, m, k,
-        1,
-        THTensor_(data)(input_n), n,
-        THTensor_(data)(weight), m,
-        0,
-        THTensor_(data)(columns), n
-    );
-
-    // Unpack columns back into input:
-    THNN_(col2im)(
-      THTensor_(data)(columns),
-      nOutputPlane, outputHeight, outputWidth, kH, kW, padH, padW, dH, dW,
-      1, 1,
-      THTensor_(data)(output_n)
-    );
-
-    // Do Bias after:
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m_ = nOutputPlane;
-    long n_ = outputHeight * outputWidth;
-    long k_ = 1;
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    if (bias) {
-      THBlas_(gemm)(
-          't', 'n',
-          n_, m_, k_,
-          1,
-          THTensor_(data)(ones), k_,
-          THTensor_(data)(bias), k_,
-          1,
-          THTensor_(data)(output_n), n_
-      );
+  if (batch)
+    THTensor_(resize4d)(output, batchSize, nOutputPlane, g.depth, g.width);
+  else
+    THTensor_(resize3d)(output, nOutputPlane, g.depth, g.width);
+
+  // Multiply the input by the weight and fold the columns into the output,
+  // in parallel over frames and bands of rows
+  THNN_(VolumetricColumns_multiplyFold)(
+    &g, batchSize,
+    THTensor_(data)(input), nInputPlane * inputSize,
+    THTensor_(data)(weight), nInputPlane,
+    THTensor_(data)(output), nOutputPlane * outputSize,
+    columns);
+
+  // Do Bias after (the ones buffer is not needed)
+  if (bias) {
+    real *output_data = THTensor_(data)(output);
+    real *bias_data = THTensor_(data)(bias);
+    long p;
+#pragma omp parallel for if (batchSize * nOutputPlane * outputSize > THNN_OMP_OVERHEAD_THRESHOLD) private(p)
+    for (p = 0; p < batchSize * nOutputPlane; p++) {
+      real *plane = output_data + p * outputSize;
+      THVector_(adds)(plane, plane, bias_data[p % nOutputPlane], outputSize);
     }
   }
 
-  // Free
-  THTensor_(free)(input_n);
-  THTensor_(free)(output_n);
-
-  // Resize output
-  if (batch == 0) {
-    THTensor_(resize3d)(output, nOutputPlane, outputHeight, outputWidth);
-    THTensor_(resize3d)(input, nInputPlane, inputHeight, inputWidth);
-  }
-
   THTensor_(free)(input);
   THTensor_(free)(weight);
   if (bias) THTensor_(free)(bias);
@@ -257,78 +162,24 @@ void THNN_(SpatialFullConvolution_updateGradInput)(
   input = THTensor_(newContiguous)(input);
   gradOutput = THTensor_(newContiguous)(gradOutput);
   weight = THTensor_(newContiguous)(weight);
-  int batch = 1;
-  if (input->nDimension == 3) {
-    // Force batch
-    batch = 0;
-    THTensor_(resize4d)(input, 1, input->size[0], input->size[1], input->size[2]);
-    THTensor_(resize4d)(gradOutput, 1, gradOutput->size[0], gradOutput->size[1], gradOutput->size[2]);
-  }
+  int batch = input->nDimension == 4;
+  long batchSize = batch ? input->size[0] : 1;
 
-  long inputWidth   = input->size[3];
-  long inputHeight  = input->size[2];
-  long outputWidth  = (inputWidth - 1) * dW - 2*padW + kW + adjW;
-  long outputHeight = (inputHeight - 1) * dH - 2*padH + kH + adjH;
-
-  // Batch size + input planes
-  long batchSize = input->size[0];
+  THNN_(VolumetricColumns) g;
+  THNN_(SpatialFullConvolution_columns)
+    (&g, input, nOutputPlane, kW, kH, dW, dH, padW, padH, adjW, adjH);
 
   // Resize output
-  THTensor_(resize4d)(gradInput, batchSize, nInputPlane, inputHeight, inputWidth);
-  THTensor_(zero)(gradInput);
-
-  // Resize temporary columns
-  THTensor_(resize2d)(gradColumns, nOutputPlane*kW*kH, inputHeight*inputWidth);
-
-  // Helpers
-  THTensor *gradInput_n = THTensor_(new)();
-  THTensor *gradOutput_n = THTensor_(new)();
-
-  int elt;
-  // For each elt in batch, do:
-  for (elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per sample:
-    THTensor_(select)(gradInput_n, gradInput, 0, elt);
-    THTensor_(select)(gradOutput_n, gradOutput, 0, elt);
-
-    // Extract columns:
-    THNN_(im2col)(
-      THTensor_(data)(gradOutput_n),
-      nOutputPlane, outputHeight, outputWidth, kH, kW, padH, padW, dH, dW,
-      1, 1,
-      THTensor_(data)(gradColumns)
-    );
-
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m = weight->size[0];
-    long n = gradColumns->size[1];
-    long k = weight->size[1] * weight->size[2] * weight->size[3];
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THBlas_(gemm)(
-        'n', 'n',
-        n, m, k,
-        1,
-        THTensor_(data)(gradColumns), n,
-        THTensor_(data)(weight), k,
-        0,
-        THTensor_(data)(gradInput_n), n
-    );
-  }
+  THTensor_(resizeAs)(gradInput, input);
 
-
-  // Free
-  THTensor_(free)(gradInput_n);
-  THTensor_(free)(gradOutput_n);
-
-  // Resize output
-  if (batch == 0) {
-    THTensor_(resize3d)(gradOutput, nOutputPlane, outputHeight, outputWidth);
-    THTensor_(resize3d)(input, nInputPlane, inputHeight, inputWidth);
-    THTensor_(resize3d)(gradInput, nInputPlane, inputHeight, inputWidth);
-  }
+  // Unfold gradOutput and multiply by the weight
+  THNN_(VolumetricColumns_unfoldMultiply)(
+    &g, batchSize,
+    THTensor_(data)(gradOutput), nOutputPlane * g.depth * g.width,
+    THTensor_(data)(weight), nInputPlane,
+    NULL,
+    THTensor_(data)(gradInput), nInputPlane * g.depth_col * g.width_col,
+    gradColumns);
 
   THTensor_(free)(input);
   THTensor_(free)(gradOutput);
@@ -362,98 +213,28 @@ void THNN_(SpatialFullConvolution_accGradParameters)(
   THArgCheck(THTensor_(isContiguous)(gradWeight), 4, "gradWeight needs to be contiguous");
   if (gradBias)
     THArgCheck(THTensor_(isContiguous)(gradBias), 5, "gradBias needs to be contiguous");
-  int batch = 1;
-  if (input->nDimension == 3) {
-    // Force batch
-    batch = 0;
-    THTensor_(resize4d)(input, 1, input->size[0], input->size[1], input->size[2]);
-    THTensor_(resize4d)(gradOutput, 1, gradOutput->size[0], gradOutput->size[1], gradOutput->size[2]);
-  }
-
-  long inputWidth   = input->size[3];
-  long inputHeight  = input->size[2];
-  long outputWidth  = (inputWidth - 1) * dW - 2*padW + kW + adjW;
-  long outputHeight = (inputHeight - 1) * dH - 2*padH + kH + adjH;
-
-  // Batch size + input planes
-  long batchSize = input->size[0];
-
-  // Define a buffer of ones, for bias accumulation
-  if (ones->nDimension != 2 || ones->size[0]*ones->size[1] < outputHeight*outputWidth) {
-    // Resize plane and fill with ones...
-    THTensor_(resize2d)(ones, outputHeight, outputWidth);
-    THTensor_(fill)(ones, 1);
-  }
-
-  // Resize temporary columns
-  THTensor_(resize2d)(columns, nOutputPlane*kW*kH, inputHeight*inputWidth);
-
-  // Helpers
-  THTensor *input_n = THTensor_(new)();
-  THTensor *gradOutput_n = THTensor_(new)();
-
-  int elt;
-  // For each elt in batch, do:
-  for (elt = 0; elt < batchSize; elt ++) {
-    // Matrix mulitply per output:
-    THTensor_(select)(input_n, input, 0, elt);
-    THTensor_(select)(gradOutput_n, gradOutput, 0, elt);
-
-    // Extract columns:
-    THNN_(im2col)(
-      THTensor_(data)(gradOutput_n),
-      nOutputPlane, outputHeight, outputWidth, kH, kW, padH, padW, dH, dW,
-      1, 1,
-      THTensor_(data)(columns)
-    );
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long n = columns->size[0];   // nOutputPlane * kh * kw
-    long m = input_n->size[0];   // nInputPlane
-    long k = columns->size[1];   // inputHeight * inputWidth
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THBlas_(gemm)(
-        't', 'n',
-        n, m, k,
-        scale,
-        THTensor_(data)(columns), k,
-        THTensor_(data)(input_n), k,
-        1,
-        THTensor_(data)(gradWeight), n
-    );
-
-
-    // Do Bias:
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    long m_ = nOutputPlane;
-    long k_ = outputHeight * outputWidth;
-
-    // Do GEMV (note: this is a bit confusing because gemv assumes column-major matrices)
-    if (gradBias) {
-      THBlas_(gemv)(
-          't',
-          k_, m_,
-          scale,
-          THTensor_(data)(gradOutput_n), k_,
-          THTensor_(data)(ones), 1,
-          1,
-          THTensor_(data)(gradBias), 1
-      );
-    }
-  }
-
-  // Free
-  THTensor_(free)(input_n);
-  THTensor_(free)(gradOutput_n);
-
-  // Resize
-  if (batch == 0) {
-    THTensor_(resize3d)(gradOutput, nOutputPlane, outputHeight, outputWidth);
-    THTensor_(resize3d)(input, nInputPlane, inputHeight, inputWidth);
-  }
+  int batch = input->nDimension == 4;
+  long batchSize = batch ? input->size[0] : 1;
+
+  THNN_(VolumetricColumns) g;
+  THNN_(SpatialFullConvolution_columns)
+    (&g, input, nOutputPlane, kW, kH, dW, dH, padW, padH, adjW, adjH);
+  long outputSize = g.depth * g.width;
+
+  // Weight gradient: input times the columns of gradOutput, summed over
+  // per-thread copies
+  THNN_(VolumetricColumns_accumulateOuter)(
+    &g, batchSize,
+    THTensor_(data)(input), nInputPlane * g.depth_col * g.width_col,
+    THTensor_(data)(gradOutput), nOutputPlane * outputSize,
+    THTensor_(data)(gradWeight), nInputPlane, scale,
+    columns);
+
+  // Bias gradient
+  if (gradBias)
+    THNN_(VolumetricColumns_planeSums)(
+      THTensor_(data)(gradOutput), batchSize, nOutputPlane * outputSize,
+      nOutputPlane, outputSize, THTensor_(data)(gradBias), scale);
 
   THTensor_(free)(input);
   THTensor_(free)(gradOutput);
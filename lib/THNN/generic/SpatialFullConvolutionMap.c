@@ -101,8 +101,7 @@ void THNN_(SpatialFullConvolutionMap_updateGradInput)(
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
   /* Resize/Zero */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   /* get raw pointers */
   real *gradInput_data = THTensor_(data)(gradInput);
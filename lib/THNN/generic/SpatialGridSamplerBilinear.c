@@ -2,9 +2,6 @@
 #define TH_GENERIC_FILE "generic/SpatialGridSamplerBilinear.c"
 #else
 
-#undef MIN
-#define MIN(a,b) ( ((a)<(b)) ? (a) : (b) )
-
 static inline void THNN_(SpatialGridSamplerBilinear_shapeCheck)
      (THTensor *input, THTensor *grid, THTensor *gradOutput) {
   THNN_ARGCHECK(input->nDimension == 4, 2, input,
@@ -21,7 +18,7 @@ static inline void THNN_(SpatialGridSamplerBilinear_shapeCheck)
 
   THNN_CHECK_DIM_SIZE(grid, 4, 0, nbatch);
   THNN_CHECK_DIM_SIZE(grid, 4, 3, 2);
-  
+
   if (gradOutput != NULL) {
     THNN_CHECK_DIM_SIZE(gradOutput, 4, 0, nbatch);
     THNN_CHECK_DIM_SIZE(gradOutput, 4, 1, channels);
@@ -30,8 +27,88 @@ static inline void THNN_(SpatialGridSamplerBilinear_shapeCheck)
   }
 }
 
-#define SAFE_GET(input, x, y, n, c, H, W) x >= 0 && x < W && y >=0 \
-    && y < H ? THTensor_fastGet4d(input, n, c, y, x) : 0
+/* The four input pixels (nw, ne, sw, se) each output location of a row
+ * samples, as offsets into an input plane and bilinear weights. Corners
+ * outside the input get offset 0 and weight 0, so the loops over the
+ * locations need no bounds checks. gradX/gradY hold the derivatives of the
+ * weights with respect to the (unnormalized) x and y coordinates. The table
+ * is filled once per row and reused for every channel. */
+typedef struct {
+  long *offset[4];
+  real *weight[4];
+  real *gradX[4];
+  real *gradY[4];
+  long size;
+} THNN_(GridSamplerTable);
+
+static void THNN_(GridSamplerTable_init)(
+          THNN_(GridSamplerTable) *table,
+          long size)
+{
+  long *offsets = THAlloc(sizeof(long) * 4 * size);
+  real *weights = THAlloc(sizeof(real) * 12 * size);
+  int k;
+  for (k = 0; k < 4; k++) {
+    table->offset[k] = offsets + k * size;
+    table->weight[k] = weights + k * size;
+    table->gradX[k] = weights + (4 + k) * size;
+    table->gradY[k] = weights + (8 + k) * size;
+  }
+  table->size = size;
+}
+
+static void THNN_(GridSamplerTable_free)(THNN_(GridSamplerTable) *table)
+{
+  THFree(table->offset[0]);
+  THFree(table->weight[0]);
+}
+
+/* Fills the table from table->size (x, y) pairs of grid in [-1, 1]. */
+static void THNN_(GridSamplerTable_fill)(
+          THNN_(GridSamplerTable) *table,
+          const real *grid,
+          long IH, long IW,
+          int withGrad)
+{
+  long i;
+  for (i = 0; i < table->size; i++) {
+    // normalize ix, iy from [-1, 1] to [0, IW-1] & [0, IH-1]
+    real ix = ((grid[2*i] + 1) / 2) * (IW-1);
+    real iy = ((grid[2*i+1] + 1) / 2) * (IH-1);
+
+    long ix_nw = floor(ix);
+    long iy_nw = floor(iy);
+
+    // distances to the west/east columns and north/south rows
+    real dw = (ix_nw + 1) - ix;
+    real de = ix - ix_nw;
+    real dn = (iy_nw + 1) - iy;
+    real ds = iy - iy_nw;
+
+    int insideX[2], insideY[2];
+    insideX[0] = ix_nw >= 0 && ix_nw < IW;
+    insideX[1] = ix_nw + 1 >= 0 && ix_nw + 1 < IW;
+    insideY[0] = iy_nw >= 0 && iy_nw < IH;
+    insideY[1] = iy_nw + 1 >= 0 && iy_nw + 1 < IH;
+
+    // surfaces to each neighbor, and their derivatives along x and y
+    real weight[4] = {dw * dn, de * dn, dw * ds, de * ds};
+    real gradX[4] = {-dn, dn, -ds, ds};
+    real gradY[4] = {-dw, -de, dw, de};
+
+    int k;
+    for (k = 0; k < 4; k++) {
+      int x = k & 1, y = k >> 1;
+      int inside = insideX[x] && insideY[y];
+      table->offset[k][i] = inside ? (iy_nw + y) * IW + ix_nw + x : 0;
+      table->weight[k][i] = inside ? weight[k] : 0;
+      if (withGrad) {
+        table->gradX[k][i] = inside ? gradX[k] : 0;
+        table->gradY[k][i] = inside ? gradY[k] : 0;
+      }
+    }
+  }
+}
 
 TH_API void THNN_(SpatialGridSamplerBilinear_updateOutput)(
 	  THNNState *state,
@@ -40,69 +117,53 @@ TH_API void THNN_(SpatialGridSamplerBilinear_updateOutput)(
 	  THTensor *output) {
 
   THNN_(SpatialGridSamplerBilinear_shapeCheck)(input, grid, NULL);
-  int N = THTensor_(size)(input, 0);
-  int C = THTensor_(size)(input, 1);
-  int IH = THTensor_(size)(input, 2);
-  int IW = THTensor_(size)(input, 3);
-  int H = THTensor_(size)(grid, 1);
-  int W = THTensor_(size)(grid, 2);
-	  
+  long N = THTensor_(size)(input, 0);
+  long C = THTensor_(size)(input, 1);
+  long IH = THTensor_(size)(input, 2);
+  long IW = THTensor_(size)(input, 3);
+  long H = THTensor_(size)(grid, 1);
+  long W = THTensor_(size)(grid, 2);
+
+  input = THTensor_(newContiguous)(input);
+  grid = THTensor_(newContiguous)(grid);
   // resize output to the same shape as input
   THTensor_(resize4d)(output, N, C, H, W);
+  THArgCheck(THTensor_(isContiguous)(output), 4, "output must be contiguous");
 
-  // loop over each output pixel
-  int n, h, w, c;
-#pragma omp parallel for private(n, h, w, c)
-  for (n = 0; n < N; ++n) {
-    for (h = 0; h < H; ++h) {
-      for (w = 0; w < W; ++w) {
-	// get the corresponding input x, y co-ordinates from grid
-	real ix = THTensor_fastGet4d(grid, n, h, w, 0);
-	real iy = THTensor_fastGet4d(grid, n, h, w, 1);
-
-	// normalize ix, iy from [-1, 1] to [0, IH-1] & [0, IW-1]
-	ix = ((ix + 1) / 2) * (IW-1);
-	iy = ((iy + 1) / 2) * (IH-1);
-
-	// get NE, NW, SE, SW pixel values from (x, y)
-	int ix_nw = floor(ix);
-	int iy_nw = floor(iy);
-	int ix_ne = ix_nw + 1;
-	int iy_ne = iy_nw;
-	int ix_sw = ix_nw;
-	int iy_sw = iy_nw + 1;
-	int ix_se = ix_nw + 1;
-	int iy_se = iy_nw + 1;
-
-	// get surfaces to each neighbor:
-	real nw = (ix_se - ix)    * (iy_se - iy);
-	real ne = (ix    - ix_sw) * (iy_sw - iy);
-	real sw = (ix_ne - ix)    * (iy    - iy_ne);
-	real se = (ix    - ix_nw) * (iy    - iy_nw);
-	  
-	// calculate bilinear weighted pixel value and set output pixel
-	for (c = 0; c < C; ++c) {
-	  //   (c, iy_nw, ix_nw) * nw + (c, iy_ne, ix_ne) * ne
-	  // + (c, iy_sw, ix_sw) * sw + (c, iy_se, ix_se) * se
-	  real nw_val = SAFE_GET(input, ix_nw, iy_nw, n, c, IH, IW);
-	  real ne_val = SAFE_GET(input, ix_ne, iy_ne, n, c, IH, IW);
-	  real sw_val = SAFE_GET(input, ix_sw, iy_sw, n, c, IH, IW);
-	  real se_val = SAFE_GET(input, ix_se, iy_se, n, c, IH, IW);
-	  real out_val = nw_val * nw + ne_val * ne + sw_val * sw + se_val * se;
-	  THTensor_fastSet4d(output, n, c, h, w, out_val);
-	}
+  real *input_data = THTensor_(data)(input);
+  real *grid_data = THTensor_(data)(grid);
+  real *output_data = THTensor_(data)(output);
+
+  // loop over the output rows; each computes its corners and weights once,
+  // then interpolates every channel with them
+#pragma omp parallel if (N * C * H * W > THNN_OMP_OVERHEAD_THRESHOLD / 4)
+  {
+    THNN_(GridSamplerTable) table;
+    THNN_(GridSamplerTable_init)(&table, W);
+    long row;
+#pragma omp for
+    for (row = 0; row < N * H; row++) {
+      long n = row / H, h = row % H, c;
+      long **off = table.offset;
+      real **wt = table.weight;
+      THNN_(GridSamplerTable_fill)(&table, grid_data + row * W * 2, IH, IW, 0);
+
+      for (c = 0; c < C; c++) {
+        const real *in = input_data + (n * C + c) * IH * IW;
+        real *out = output_data + ((n * C + c) * H + h) * W;
+        long w;
+        THNN_SIMD
+        for (w = 0; w < W; w++)
+          out[w] = in[off[0][w]] * wt[0][w] + in[off[1][w]] * wt[1][w]
+                 + in[off[2][w]] * wt[2][w] + in[off[3][w]] * wt[3][w];
       }
     }
+    THNN_(GridSamplerTable_free)(&table);
   }
-}
 
-#define SAFE_ADD(input, x, y, n, c, H, W, value)		\
-  do {								\
-    if (x >= 0 && x < W && y >=0 && y < H) {			\
-      real old_value = THTensor_fastGet4d(input, n, c, y, x);	\
-      THTensor_fastSet4d(input, n, c, y, x, value + old_value);	\
-    }								\
-  } while(0)
+  THTensor_(free)(input);
+  THTensor_(free)(grid);
+}
 
 TH_API void THNN_(SpatialGridSamplerBilinear_updateGradInput)(
 	  THNNState *state,
@@ -111,94 +172,118 @@ TH_API void THNN_(SpatialGridSamplerBilinear_updateGradInput)(
 	  THTensor *gradOutput) {
 
   THNN_(SpatialGridSamplerBilinear_shapeCheck)(input, grid, gradOutput);
-  int N = THTensor_(size)(input, 0);
-  int C = THTensor_(size)(input, 1);
-  int IH = THTensor_(size)(input, 2);
-  int IW = THTensor_(size)(input, 3);
-  int H = THTensor_(size)(grid, 1);
-  int W = THTensor_(size)(grid, 2);
+  long N = THTensor_(size)(input, 0);
+  long C = THTensor_(size)(input, 1);
+  long IH = THTensor_(size)(input, 2);
+  long IW = THTensor_(size)(input, 3);
+  long H = THTensor_(size)(grid, 1);
+  long W = THTensor_(size)(grid, 2);
 
+  input = THTensor_(newContiguous)(input);
+  grid = THTensor_(newContiguous)(grid);
+  gradOutput = THTensor_(newContiguous)(gradOutput);
   THTensor_(resize4d)(gradInput, N, C, IH, IW);
   THTensor_(resize4d)(gradGrid, N, H, W, 2);
-  THTensor_(zero)(gradInput);
-  THTensor_(zero)(gradGrid);
-
-  // loop over each output pixel
-  int n, h, w;
-#pragma omp parallel for private(n, h, w)
-  for (n = 0; n < N; ++n) {
-    for (h = 0; h < H; ++h) {
-      for (w = 0; w < W; ++w) {
-	// get the corresponding input x, y co-ordinates from grid
-	real ix = THTensor_fastGet4d(grid, n, h, w, 0);
-	real iy = THTensor_fastGet4d(grid, n, h, w, 1);
-
-	real gix = 0;
-	real giy = 0;
-
-	// normalize ix, iy from [-1, 1] to [0, H-1] & [0, W-1]
-	ix = ((ix + 1) / 2) * (IW-1);
-	iy = ((iy + 1) / 2) * (IH-1);
-
-	// get NE, NW, SE, SW pixel values from (x, y)
-	int ix_nw = floor(ix);
-	int iy_nw = floor(iy);
-	int ix_ne = ix_nw + 1;
-	int iy_ne = iy_nw;
-	int ix_sw = ix_nw;
-	int iy_sw = iy_nw + 1;
-	int ix_se = ix_nw + 1;
-	int iy_se = iy_nw + 1;
-
-	// get surfaces to each neighbor:
-	real nw = (ix_se - ix)    * (iy_se - iy);
-	real ne = (ix    - ix_sw) * (iy_sw - iy);
-	real sw = (ix_ne - ix)    * (iy    - iy_ne);
-	real se = (ix    - ix_nw) * (iy    - iy_nw);
-	  
-	for (int c = 0; c < C; ++c) {
-	  real gradout = THTensor_fastGet4d(gradOutput, n, c, h, w);
-
-	  // calculate and set gradInput
-	  SAFE_ADD(gradInput, ix_nw, iy_nw, n, c, IH, IW, nw * gradout);
-	  SAFE_ADD(gradInput, ix_ne, iy_ne, n, c, IH, IW, ne * gradout);
-	  SAFE_ADD(gradInput, ix_sw, iy_sw, n, c, IH, IW, sw * gradout);
-	  SAFE_ADD(gradInput, ix_se, iy_se, n, c, IH, IW, se * gradout);
-
-	  // calculate gradGrid
-	  real nw_val = SAFE_GET(input, ix_nw, iy_nw, n, c, IH, IW);
-	  real ne_val = SAFE_GET(input, ix_ne, iy_ne, n, c, IH, IW);
-	  real sw_val = SAFE_GET(input, ix_sw, iy_sw, n, c, IH, IW);
-	  real se_val = SAFE_GET(input, ix_se, iy_se, n, c, IH, IW);
-
-	  gix -= nw_val * (iy_se - iy) * gradout;
-	  gix += ne_val * (iy_sw - iy) * gradout;
-	  gix -= sw_val * (iy - iy_ne) * gradout;
-	  gix += se_val * (iy - iy_nw) * gradout;
-
-	  giy -= nw_val * (ix_se - ix) * gradout;
-	  giy -= ne_val * (ix - ix_sw) * gradout;
-	  giy += sw_val * (ix_ne - ix) * gradout;
-	  giy += se_val * (ix - ix_nw) * gradout;
-	}
-
-	// un-normalize gradGrid values back to [-1, 1] constraints
-	gix = gix * (IW - 1) / 2;
-	giy = giy * (IH - 1) / 2;
-
-	real gix_old = THTensor_fastGet4d(gradGrid, n, h, w, 0);
-	real giy_old = THTensor_fastGet4d(gradGrid, n, h, w, 1);
-
-	THTensor_fastSet4d(gradGrid, n, h, w, 0, gix_old + gix);
-	THTensor_fastSet4d(gradGrid, n, h, w, 1, giy_old + giy);
+  THArgCheck(THTensor_(isContiguous)(gradInput), 3, "gradInput must be contiguous");
+  THArgCheck(THTensor_(isContiguous)(gradGrid), 5, "gradGrid must be contiguous");
+
+  real *input_data = THTensor_(data)(input);
+  real *grid_data = THTensor_(data)(grid);
+  real *gradOutput_data = THTensor_(data)(gradOutput);
+  real *gradInput_data = THTensor_(data)(gradInput);
+  real *gradGrid_data = THTensor_(data)(gradGrid);
+
+  // The gradient of a sample scatters into arbitrary pixels of its input
+  // planes, so each work item owns whole planes: a sample, or a block of its
+  // channels when there are fewer samples than threads. The gradient of the
+  // grid sums over the channels; with several blocks per sample each block
+  // writes its share to a partial grid gradient, which is reduced afterwards.
+  int nthreads = 1;
+#ifdef _OPENMP
+  nthreads = omp_get_max_threads();
+#endif
+  int parallel = N * C * H * W > THNN_OMP_OVERHEAD_THRESHOLD / 4;
+  long blocks = parallel && N < nthreads ? (nthreads + N - 1) / N : 1;
+  if (blocks > C)
+    blocks = C;
+  long blockSize = (C + blocks - 1) / blocks;
+  blocks = (C + blockSize - 1) / blockSize;
+  real *partial = blocks > 1 ? THAlloc(sizeof(real) * N * blocks * H * W * 2) : NULL;
+
+#pragma omp parallel if (parallel)
+  {
+    THNN_(GridSamplerTable) table;
+    THNN_(GridSamplerTable_init)(&table, W);
+    real *gx = THAlloc(sizeof(real) * 2 * W);
+    real *gy = gx + W;
+    long item;
+#pragma omp for
+    for (item = 0; item < N * blocks; item++) {
+      long n = item / blocks;
+      long c0 = (item % blocks) * blockSize;
+      long c1 = c0 + blockSize < C ? c0 + blockSize : C;
+      real *gridGrad = partial ? partial + item * H * W * 2 : gradGrid_data + n * H * W * 2;
+      long **off = table.offset;
+      real **wt = table.weight;
+      real **tx = table.gradX;
+      real **ty = table.gradY;
+      long h, c, w;
+
+      memset(gradInput_data + n * C * IH * IW + c0 * IH * IW, 0,
+             sizeof(real) * (c1 - c0) * IH * IW);
 
+      for (h = 0; h < H; h++) {
+        THNN_(GridSamplerTable_fill)(&table, grid_data + (n * H + h) * W * 2, IH, IW, 1);
+        memset(gx, 0, sizeof(real) * 2 * W);
+
+        for (c = c0; c < c1; c++) {
+          const real *in = input_data + (n * C + c) * IH * IW;
+          const real *go = gradOutput_data + ((n * C + c) * H + h) * W;
+          real *gi = gradInput_data + (n * C + c) * IH * IW;
+
+          THNN_SIMD
+          for (w = 0; w < W; w++) {
+            real nw = in[off[0][w]], ne = in[off[1][w]];
+            real sw = in[off[2][w]], se = in[off[3][w]];
+            gx[w] += (nw * tx[0][w] + ne * tx[1][w] + sw * tx[2][w] + se * tx[3][w]) * go[w];
+            gy[w] += (nw * ty[0][w] + ne * ty[1][w] + sw * ty[2][w] + se * ty[3][w]) * go[w];
+          }
+          // corners of neighbouring locations may coincide: keep this serial
+          for (w = 0; w < W; w++) {
+            gi[off[0][w]] += wt[0][w] * go[w];
+            gi[off[1][w]] += wt[1][w] * go[w];
+            gi[off[2][w]] += wt[2][w] * go[w];
+            gi[off[3][w]] += wt[3][w] * go[w];
+          }
+        }
+
+        // un-normalize gradGrid values back to [-1, 1] constraints
+        for (w = 0; w < W; w++) {
+          gridGrad[(h * W + w) * 2] = gx[w] * (IW - 1) / 2;
+          gridGrad[(h * W + w) * 2 + 1] = gy[w] * (IH - 1) / 2;
+        }
       }
     }
+    THFree(gx);
+    THNN_(GridSamplerTable_free)(&table);
   }
-}
 
-#undef MIN
-#undef SAFE_GET
-#undef SAFE_ADD
+  if (partial) {
+    long i;
+#pragma omp parallel for if (parallel) private(i)
+    for (i = 0; i < N * H * W * 2; i++) {
+      long n = i / (H * W * 2), b;
+      real sum = 0;
+      for (b = 0; b < blocks; b++)
+        sum += partial[(n * blocks + b) * H * W * 2 + i % (H * W * 2)];
+      gradGrid_data[i] = sum;
+    }
+    THFree(partial);
+  }
+
+  THTensor_(free)(input);
+  THTensor_(free)(grid);
+  THTensor_(free)(gradOutput);
+}
 
 #endif
@@ -180,8 +180,7 @@ void THNN_(SpatialMaxUnpooling_updateGradInput)(
   indices = THIndexTensor_(newContiguous)(indices);
 
   /* resize */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   if (input->nDimension == 4) {
     nbatch = input->size[0];
@@ -225,8 +225,7 @@ void THNN_(SpatialReflectionPadding_updateGradInput)(THNNState *state,
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
   /* resize */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   /* backprop */
   if (input->nDimension == 3) {
@@ -51,53 +51,52 @@ void THNN_(SpatialUpSamplingBilinear_updateOutput)(
 		      THTensor_(size)(input, 0), 
 		      THTensor_(size)(input, 1), 
 		      outputHeight, outputWidth);
-  THTensor_(zero)(output);
-  real *idata = THTensor_(data)(input);
-  real *odata = THTensor_(data)(output);
-  channels = nbatch * channels;
   THAssert(inputHeight > 0 && inputWidth > 0 && outputHeight > 0 && outputWidth > 0);
   // special case: just copy
   if (inputHeight == outputHeight && inputWidth == outputWidth) {
-    for (int h2 = 0; h2 < outputHeight; ++h2) {
-      const int h1 = h2;
-      for (int w2 = 0; w2 < outputWidth; ++w2) {
-        const int w1 = w2;
-        const real* pos1 = &idata[h1 * inputWidth + w1];
-        real* pos2 = &odata[h2 * outputWidth + w2];
-        for (int c = 0; c < channels; ++c) {
-          pos2[0] = pos1[0];
-          pos1 += inputWidth * inputHeight;
-          pos2 += outputWidth * outputHeight;
-        }
-      }
-    }
+    THTensor_(copy)(output, input);
+    THTensor_(free)(input);
     return;
   }
-  const float rheight =(outputHeight > 1) ? (float)(inputHeight - 1)/(outputHeight - 1) : 0.f;
-  const float rwidth = (outputWidth > 1) ? (float)(inputWidth - 1) / (outputWidth - 1) : 0.f;
-  for (int h2 = 0; h2 < outputHeight; ++h2) {
-    const float h1r = rheight * h2;
-    const int h1 = h1r;
-    const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
-    const real h1lambda = h1r - h1;
-    const real h0lambda = (real)1. - h1lambda;
-    for (int w2 = 0; w2 < outputWidth; ++w2) {
-      const float w1r = rwidth * w2;
-      const int w1 = w1r;
-      const int w1p = (w1 < inputWidth - 1) ? 1 : 0;
-      const real w1lambda = w1r - w1;
-      const real w0lambda = (real)1. - w1lambda;
-      const real* pos1 = &idata[h1 * inputWidth + w1];
-      real* pos2 = &odata[h2 * outputWidth + w2];
-      for (int c = 0; c < channels; ++c) {
-        pos2[0] = h0lambda * (w0lambda * pos1[0]+ w1lambda * pos1[w1p])
-                  + h1lambda * (w0lambda * pos1[h1p * inputWidth]
-                  + w1lambda * pos1[h1p * inputWidth + w1p]);
-        pos1 += inputWidth * inputHeight;
-        pos2 += outputWidth * outputHeight;
+
+  real *idata = THTensor_(data)(input);
+  real *odata = THTensor_(data)(output);
+  long planes = (long)nbatch * channels;
+  int maxthreads = 1;
+#ifdef _OPENMP
+  maxthreads = omp_get_max_threads();
+#endif
+  real *rows = THAlloc(sizeof(real) * inputWidth * maxthreads);
+  THNN_(UpSamplingLinearTable) htable, wtable;
+  THNN_(UpSamplingLinearTable_init)(&htable, inputHeight, outputHeight);
+  THNN_(UpSamplingLinearTable_init)(&wtable, inputWidth, outputWidth);
+
+#pragma omp parallel
+  {
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    real *row = rows + tid * inputWidth;
+    long c;
+#pragma omp for
+    for (c = 0; c < planes; c++) {
+      const real *pos1 = idata + c * inputHeight * inputWidth;
+      real *pos2 = odata + c * outputHeight * outputWidth;
+      for (int h2 = 0; h2 < outputHeight; ++h2) {
+        // blend the two input rows, then interpolate across the width
+        THNN_(upsampling_blendRows)(row,
+                                    pos1 + htable.index0[h2] * inputWidth,
+                                    pos1 + htable.index1[h2] * inputWidth,
+                                    htable.lambda0[h2], htable.lambda1[h2], inputWidth);
+        THNN_(upsampling_interpolateRow)(pos2 + h2 * outputWidth, row, &wtable, outputWidth);
       }
     }
   }
+
+  THNN_(UpSamplingLinearTable_free)(&htable);
+  THNN_(UpSamplingLinearTable_free)(&wtable);
+  THFree(rows);
   THTensor_(free)(input);
 }
 
@@ -119,55 +118,59 @@ void THNN_(SpatialUpSamplingBilinear_updateGradInput)(
      outputHeight, outputWidth);
 
   THTensor_(resize4d)(gradInput, nbatch, channels, inputHeight, inputWidth);
-  THTensor_(zero)(gradInput);
   gradOutput = THTensor_(newContiguous)(gradOutput);
-  real *data1 = THTensor_(data)(gradInput);
-  real *data2 = THTensor_(data)(gradOutput);
-  channels = nbatch * channels;
+  THArgCheck(THTensor_(isContiguous)(gradInput), 3, "gradInput must be contiguous");
 
   // special case: same-size matching grids
   if (inputHeight == outputHeight && inputWidth == outputWidth) {
-    for (int h2 = 0; h2 < outputHeight; ++h2) {
-      const int h1 = h2;
-      for (int w2 = 0; w2 < outputWidth; ++w2) {
-        const int w1 = w2;
-        real* pos1 = &data1[h1 * inputWidth + w1];
-        const real* pos2 = &data2[h2 * outputWidth + w2];
-        for (int c = 0; c < channels; ++c) {
-          pos1[0] += pos2[0];
-          pos1 += inputWidth * inputHeight;
-          pos2 += outputWidth * outputHeight;
-        }
-      }
-    }
+    THTensor_(copy)(gradInput, gradOutput);
+    THTensor_(free)(gradOutput);
     return;
   }
-  const float rheight =(outputHeight > 1) ? (float)(inputHeight - 1)/(outputHeight - 1) : 0.f;
-  const float rwidth = (outputWidth > 1) ? (float)(inputWidth - 1)/(outputWidth - 1) : 0.f;
-  for (int h2 = 0; h2 < outputHeight; ++h2) {
-    const float h1r = rheight * h2;
-    const int h1 = h1r;
-    const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
-    const real h1lambda = h1r - h1;
-    const real h0lambda = (real)1. - h1lambda;
-    for (int w2 = 0; w2 < outputWidth; ++w2) {
-      const float w1r = rwidth * w2;
-      const int w1 = w1r;
-      const int w1p = (w1 < inputWidth - 1) ? 1 : 0;
-      const real w1lambda = w1r - w1;
-      const real w0lambda = (real)1. - w1lambda;
-      real* pos1 = &data1[h1 * inputWidth + w1];
-      const real* pos2 = &data2[h2 * outputWidth + w2];
-      for (int c = 0; c < channels; ++c) {
-        pos1[0] += h0lambda * w0lambda * pos2[0];
-        pos1[w1p] += h0lambda * w1lambda * pos2[0];
-        pos1[h1p * inputWidth] += h1lambda * w0lambda * pos2[0];
-        pos1[h1p * inputWidth + w1p] += h1lambda * w1lambda * pos2[0];
-        pos1 += inputWidth * inputHeight;
-        pos2 += outputWidth * outputHeight;
+
+  real *data1 = THTensor_(data)(gradInput);
+  real *data2 = THTensor_(data)(gradOutput);
+  long planes = (long)nbatch * channels;
+  int maxthreads = 1;
+#ifdef _OPENMP
+  maxthreads = omp_get_max_threads();
+#endif
+  real *rows = THAlloc(sizeof(real) * inputWidth * maxthreads);
+  THNN_(UpSamplingLinearTable) htable, wtable;
+  THNN_(UpSamplingLinearTable_init)(&htable, inputHeight, outputHeight);
+  THNN_(UpSamplingLinearTable_init)(&wtable, inputWidth, outputWidth);
+
+#pragma omp parallel
+  {
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    real *row = rows + tid * inputWidth;
+    long c;
+#pragma omp for
+    for (c = 0; c < planes; c++) {
+      real *pos1 = data1 + c * inputHeight * inputWidth;
+      const real *pos2 = data2 + c * outputHeight * outputWidth;
+      for (long i = 0; i < inputHeight * inputWidth; i++)
+        pos1[i] = 0;
+      for (int h2 = 0; h2 < outputHeight; ++h2) {
+        // reduce the output row to the input width, then split it
+        // between the two input rows
+        for (int w1 = 0; w1 < inputWidth; ++w1)
+          row[w1] = 0;
+        THNN_(upsampling_interpolateRowBackward)(row, pos2 + h2 * outputWidth, &wtable, outputWidth);
+        THNN_(upsampling_accumulateRow)(pos1 + htable.index0[h2] * inputWidth, row,
+                                        htable.lambda0[h2], inputWidth);
+        THNN_(upsampling_accumulateRow)(pos1 + htable.index1[h2] * inputWidth, row,
+                                        htable.lambda1[h2], inputWidth);
       }
     }
   }
+
+  THNN_(UpSamplingLinearTable_free)(&htable);
+  THNN_(UpSamplingLinearTable_free)(&wtable);
+  THFree(rows);
   THTensor_(free)(gradOutput);
 }
 
@@ -4,146 +4,189 @@
 
 TH_API void THNN_(Abs_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
+          THTensor *input,             // [IN] input tensor
           THTensor *output);           // [OUT] Abs output
 TH_API void THNN_(Abs_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *gradOutput,        // gradient w.r.t. output
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [IN] gradient w.r.t. output
           THTensor *gradInput);        // [OUT] gradient w.r.t. input
 
 TH_API void THNN_(AbsCriterion_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *target,            // tensor with target values
+          THTensor *input,             // [IN] input tensor
+          THTensor *target,            // [IN] tensor with target values
           THTensor *output,            // [OUT] a one-element tensor with loss
           bool sizeAverage);           // if true, the loss will be divided by batch size
 TH_API void THNN_(AbsCriterion_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *target,            // tensor with target values
+          THTensor *input,             // [IN] input tensor
+          THTensor *target,            // [IN] tensor with target values
           THTensor *gradInput,         // [OUT] gradient w.r.t. input
           bool sizeAverage);           // if true, the gradient will be normalized by batch size
+TH_API void THNN_(AbsCriterion_updateOutputAndGradInput)(
+          THNNState *state,            // library's state
+          THTensor *input,             // [IN] input tensor
+          THTensor *target,            // [IN] tensor with target values
+          THTensor *output,            // [OUT] a one-element tensor with loss
+          THTensor *gradInput,         // [OUT] gradient w.r.t. input, computed in the same pass
+          bool sizeAverage);           // if true, the loss and gradient will be normalized by batch size
 
 TH_API void THNN_(BCECriterion_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *target,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *output,            // [OUT]
           bool sizeAverage,
-          THTensor *weights);          // [OPTIONAL]
+          THTensor *weights);          // [IN] [OPTIONAL]
 TH_API void THNN_(BCECriterion_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *target,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *gradInput,         // [OUT]
+          bool sizeAverage,
+          THTensor *weights);          // [IN] [OPTIONAL]
+TH_API void THNN_(BCECriterion_updateOutputAndGradInput)(
+          THNNState *state,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *gradInput,         // [OUT]
           bool sizeAverage,
-          THTensor *weights);          // [OPTIONAL]
+          THTensor *weights);          // [IN] [OPTIONAL]
 
 TH_API void THNN_(ClassNLLCriterion_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor (1D/2D)
-          THIndexTensor *target,       // tensor containing indexes of target classes
+          THTensor *input,             // [IN] input tensor (1D/2D)
+          THIndexTensor *target,       // [IN] tensor containing indexes of target classes
           THTensor *output,            // [OUT] a one-element tensor with loss
           bool sizeAverage,            // if true, the loss will be normalized by batch size and class weights
-          THTensor *weights,           // [OPTIONAL] class weights
+          THTensor *weights,           // [IN] [OPTIONAL] class weights
           THTensor *total_weight,      // [BUFFER]
           long ignore_index);          // target index to ignore (loss = 0, gradInput = 0)
 TH_API void THNN_(ClassNLLCriterion_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor (1D/2D)
-          THIndexTensor *target,       // tensor containing indexes of target classes
+          THTensor *input,             // [IN] input tensor (1D/2D)
+          THIndexTensor *target,       // [IN] tensor containing indexes of target classes
           THTensor *gradInput,         // [OUT] gradient w.r.t. input
           bool sizeAverage,            // if true, the loss will be normalized by batch size and class weights
-          THTensor *weights,           // [OPTIONAL] class weights
+          THTensor *weights,           // [IN] [OPTIONAL] class weights
+          THTensor *total_weight,      // [IN]
+          long ignore_index);          // target index to ignore (loss = 0, gradInput = 0)
+
+TH_API void THNN_(CrossEntropyCriterion_updateOutput)(
+          THNNState *state,            // library's state
+          THTensor *input,             // [IN] input tensor (1D/2D) of unnormalized scores
+          THIndexTensor *target,       // [IN] tensor containing indexes of target classes
+          THTensor *output,            // [OUT] a one-element tensor with loss
+          bool sizeAverage,            // if true, the loss will be normalized by batch size and class weights
+          THTensor *weights,           // [IN] [OPTIONAL] class weights
           THTensor *total_weight,      // [BUFFER]
+          THTensor *logsumexp,         // [BUFFER] max and log(sum(exp(x - max))) of each input row
+          long ignore_index);          // target index to ignore (loss = 0, gradInput = 0)
+TH_API void THNN_(CrossEntropyCriterion_updateGradInput)(
+          THNNState *state,            // library's state
+          THTensor *input,             // [IN] input tensor (1D/2D) of unnormalized scores
+          THIndexTensor *target,       // [IN] tensor containing indexes of target classes
+          THTensor *gradInput,         // [OUT] gradient w.r.t. input
+          bool sizeAverage,            // if true, the loss will be normalized by batch size and class weights
+          THTensor *weights,           // [IN] [OPTIONAL] class weights
+          THTensor *total_weight,      // [IN]
+          THTensor *logsumexp,         // [IN] max and log(sum(exp(x - max))) of each input row
           long ignore_index);          // target index to ignore (loss = 0, gradInput = 0)
 
 TH_API void THNN_(SpatialClassNLLCriterion_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor (4D)
-          THIndexTensor *target,       // tensor containing indexes of target classes (3D)
+          THTensor *input,             // [IN] input tensor (4D)
+          THIndexTensor *target,       // [IN] tensor containing indexes of target classes (3D)
           THTensor *output,            // [OUT] a one-element tensor with loss
           bool sizeAverage,            // if true, the loss will be normalized by batch size and class weights
-          THTensor *weights,           // [OPTIONAL] class weights
+          THTensor *weights,           // [IN] [OPTIONAL] class weights
           THTensor *total_weight,      // [BUFFER]
           long ignore_index);          // target index to ignore (loss = 0, gradInput = 0)
 TH_API void THNN_(SpatialClassNLLCriterion_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor (4D)
-          THIndexTensor *target,       // tensor containing indexes of target classes (3D)
+          THTensor *input,             // [IN] input tensor (4D)
+          THIndexTensor *target,       // [IN] tensor containing indexes of target classes (3D)
           THTensor *gradInput,         // [OUT] gradient w.r.t. input
           bool sizeAverage,            // if true, the loss will be normalized by batch size and class weights
-          THTensor *weights,           // [OPTIONAL] class weights
-          THTensor *total_weight,      // [BUFFER]
+          THTensor *weights,           // [IN] [OPTIONAL] class weights
+          THTensor *total_weight,      // [IN]
           long ignore_index);          // target index to ignore (loss = 0, gradInput = 0)
 
 
 TH_API void THNN_(ELU_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
+          THTensor *input,             // [OUT if inplace] input tensor
           THTensor *output,            // [OUT] ELU output
           accreal alpha,               // an ELU parameter (as in paper)
           bool inplace);               // if true, modifies gradOutput and sets gradInput onto it (no additional memory is allocated)
 TH_API void THNN_(ELU_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *gradOutput,        // gradient w.r.t. output
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [OUT if inplace] gradient w.r.t. output
           THTensor *gradInput,         // [OUT] gradient w.r.t. input
-          THTensor *output,            // output from a forward pass
+          THTensor *output,            // [IN] output from a forward pass
           accreal alpha,               // an ELU parameter (as in paper)
           bool inplace);               // if true, modifies gradOutput and sets gradInput onto it (no additional memory is allocated)
 
 TH_API void THNN_(DistKLDivCriterion_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *target,            // target tensor
+          THTensor *input,             // [IN] input tensor
+          THTensor *target,            // [IN] target tensor
           THTensor *output,            // [OUT] a one-element tensor containing the loss
           bool sizeAverage);           // if true, the loss will be normalized **by total number of elements**
 TH_API void THNN_(DistKLDivCriterion_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *target,            // target tensor
+          THTensor *input,             // [IN] input tensor
+          THTensor *target,            // [IN] target tensor
           THTensor *gradInput,         // [OUT] gradient w.r.t. input
           bool sizeAverage);           // if true, the loss will be normalized **by total number of elements**
+TH_API void THNN_(DistKLDivCriterion_updateOutputAndGradInput)(
+          THNNState *state,            // library's state
+          THTensor *input,             // [IN] input tensor
+          THTensor *target,            // [IN] target tensor
+          THTensor *output,            // [OUT] a one-element tensor containing the loss
+          THTensor *gradInput,         // [OUT] gradient w.r.t. input, computed in the same pass
+          bool sizeAverage);           // if true, the loss will be normalized **by total number of elements**
 
 TH_API void THNN_(GatedLinear_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
+          THTensor *input,             // [IN] input tensor
           THTensor *output,            // [OUT] output tensor, half size of input along dimension dim
           int dim);                    // dimension for halving operation
 TH_API void THNN_(GatedLinear_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *gradOutput,        // gradient w.r.t module's output
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [IN] gradient w.r.t module's output
           THTensor *gradInput,         // [OUT] gradient w.r.t input
           int dim);                    // dimension for halving operation
 
 // HardShink outputs 0 on interval of (-lambda; lambda) or original value otherwise.
 TH_API void THNN_(HardShrink_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
+          THTensor *input,             // [IN] input tensor
           THTensor *output,            // [OUT] output tensor
           accreal lambda);             // HardShrink parameter
 TH_API void THNN_(HardShrink_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *gradOutput,        // gradient w.r.t. module's output
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [IN] gradient w.r.t. module's output
           THTensor *gradInput,         // [OUT] gradient w.r.t. input
           accreal lambda);             // HardShrink parameter
 
 // HardTanh clamps the values to the interval [min_val; max_val].
 TH_API void THNN_(HardTanh_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
+          THTensor *input,             // [OUT if inplace] input tensor
           THTensor *output,            // [OUT] output tensor
           accreal min_val,             // lower threshold
           accreal max_val,             // upper threshold
           bool inplace);
 TH_API void THNN_(HardTanh_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *gradOutput,        // gradient w.r.t. module's output
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [OUT if inplace] gradient w.r.t. module's output
           THTensor *gradInput,         // [OUT] gradient w.r.t. the input
           accreal min_val,             // lower threshold
           accreal max_val,             // upper threshold
@@ -151,238 +194,389 @@ TH_API void THNN_(HardTanh_updateGradInput)(
 
 TH_API void THNN_(L1Cost_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
+          THTensor *input,             // [IN] input tensor
           THTensor *output);           // [OUT] output tensor
 TH_API void THNN_(L1Cost_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *gradOutput,        // [OPTIONAL] gradient w.r.t module's output
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [IN] [OPTIONAL] gradient w.r.t module's output
           THTensor *gradInput);        // [OUT] gradient w.r.t the input
 
 TH_API void THNN_(LeakyReLU_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // [MODIFIED] input tensor
+          THTensor *input,             // [OUT if inplace] [MODIFIED] input tensor
           THTensor *output,            // [OUT] output tensor
           accreal negval,              // negative part slope
           bool inplace);               // if true, modifies the input tensor and sets the output tensor on it (no additional memory is allocated)
 TH_API void THNN_(LeakyReLU_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *gradOutput,        // [MODIFIED] gradient w.r.t. module's output
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [OUT if inplace] [MODIFIED] gradient w.r.t. module's output
           THTensor *gradInput,         // [OUT] gradient w.r.t. the input
           accreal negval,              // negative part slope
           bool inplace);               // if true, modifies gradOutput and sets gradInput onto it (no additional memory is allocated)
 
 TH_API void THNN_(GRUFused_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *hidden,
-          THTensor *bias1, // [OPTIONAL]
-          THTensor *bias2, // [OPTIONAL]
-          THTensor *hx,
-          THTensor *output,
-          THTensor *storage);
+          THTensor *input,             // [IN]
+          THTensor *hidden,            // [IN]
+          THTensor *bias1,             // [IN] [OPTIONAL]
+          THTensor *bias2,             // [IN] [OPTIONAL]
+          THTensor *hx,                // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *storage);          // [OUT]
 TH_API void THNN_(GRUFused_updateGradInput)(
           THNNState *state,
-          THTensor *gradInInput,
-          THTensor *gradInHidden,
-          THTensor *gradOutput,
-          THTensor *gradInputHx,
-          THTensor *storage);
+          THTensor *gradInInput,       // [OUT]
+          THTensor *gradInHidden,      // [OUT]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInputHx,       // [OUT]
+          THTensor *storage);          // [IN]
 
 TH_API void THNN_(LSTMFused_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *hidden,
-          THTensor *bias1, // [OPTIONAL]
-          THTensor *bias2, // [OPTIONAL]
-          THTensor *cell,
-          THTensor *output,
-          THTensor *outputCell);
+          THTensor *input,             // [OUT]
+          THTensor *hidden,            // [IN]
+          THTensor *bias1,             // [IN] [OPTIONAL]
+          THTensor *bias2,             // [IN] [OPTIONAL]
+          THTensor *cell,              // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *outputCell);       // [OUT]
 TH_API void THNN_(LSTMFused_updateGradInput)(
           THNNState *state,
-          THTensor *storage,
-          THTensor *gradInGates,
-          THTensor *cx,
-          THTensor *cy,
-          THTensor *gradOutput,
-          THTensor *gradOutputCell,
-          THTensor *gradInputCx);
+          THTensor *storage,           // [IN]
+          THTensor *gradInGates,       // [OUT]
+          THTensor *cx,                // [IN]
+          THTensor *cy,                // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradOutputCell,    // [IN]
+          THTensor *gradInputCx);      // [OUT]
+
+TH_API void THNN_(LSTMSequence_updateOutput)(
+          THNNState *state,
+          THTensor *input,             // [IN] packed input (sum(batchSizes) x inputSize)
+          THIndexTensor *batchSizes,   // [IN] number of sequences still running at each timestep (non-increasing)
+          THTensor *weightIH,          // [IN] input-hidden weight (4*hiddenSize x inputSize)
+          THTensor *weightHH,          // [IN] hidden-hidden weight (4*hiddenSize x hiddenSize)
+          THTensor *bias1,             // [IN] [OPTIONAL] input-hidden bias
+          THTensor *bias2,             // [IN] [OPTIONAL] hidden-hidden bias
+          THTensor *hx,                // [IN] initial hidden state (batchSizes[0] x hiddenSize)
+          THTensor *cx,                // [IN] initial cell state
+          THTensor *output,            // [OUT] packed hidden states (sum(batchSizes) x hiddenSize)
+          THTensor *hy,                // [OUT] final hidden state of each sequence
+          THTensor *cy,                // [OUT] final cell state of each sequence
+          THTensor *gates,             // [BUFFER] activated gates, kept for backward
+          THTensor *cells,             // [BUFFER] packed cell states, kept for backward
+          THTensor *packedWeight);     // [BUFFER]
+TH_API void THNN_(LSTMSequence_backward)(
+          THNNState *state,
+          THTensor *input,             // [IN]
+          THIndexTensor *batchSizes,   // [IN]
+          THTensor *weightIH,          // [IN]
+          THTensor *weightHH,          // [IN]
+          THTensor *hx,                // [IN]
+          THTensor *cx,                // [IN]
+          THTensor *output,            // [IN] output of LSTMSequence_updateOutput
+          THTensor *gates,             // [IN] gates buffer of LSTMSequence_updateOutput
+          THTensor *cells,             // [IN] cells buffer of LSTMSequence_updateOutput
+          THTensor *gradOutput,        // [IN] gradient w.r.t. the packed output
+          THTensor *gradHy,            // [IN] [OPTIONAL] gradient w.r.t. the final hidden state
+          THTensor *gradCy,            // [IN] [OPTIONAL] gradient w.r.t. the final cell state
+          THTensor *gradInput,         // [OUT] gradient w.r.t. the packed input
+          THTensor *gradHx,            // [OUT] gradient w.r.t. hx
+          THTensor *gradCx,            // [OUT] gradient w.r.t. cx
+          THTensor *gradWeightIH,      // [OUT] accumulated
+          THTensor *gradWeightHH,      // [OUT] accumulated
+          THTensor *gradBias1,         // [OUT] [OPTIONAL] accumulated
+          THTensor *gradBias2,         // [OUT] [OPTIONAL] accumulated
+          THTensor *gradGates,         // [BUFFER]
+          accreal scale);
+
+TH_API void THNN_(GRUSequence_updateOutput)(
+          THNNState *state,
+          THTensor *input,             // [IN] packed input (sum(batchSizes) x inputSize)
+          THIndexTensor *batchSizes,   // [IN] number of sequences still running at each timestep (non-increasing)
+          THTensor *weightIH,          // [IN] input-hidden weight (3*hiddenSize x inputSize)
+          THTensor *weightHH,          // [IN] hidden-hidden weight (3*hiddenSize x hiddenSize)
+          THTensor *bias1,             // [IN] [OPTIONAL] input-hidden bias
+          THTensor *bias2,             // [IN] [OPTIONAL] hidden-hidden bias
+          THTensor *hx,                // [IN] initial hidden state (batchSizes[0] x hiddenSize)
+          THTensor *output,            // [OUT] packed hidden states (sum(batchSizes) x hiddenSize)
+          THTensor *hy,                // [OUT] final hidden state of each sequence
+          THTensor *gates,             // [BUFFER] activated gates, kept for backward
+          THTensor *packedWeight);     // [BUFFER]
+TH_API void THNN_(GRUSequence_backward)(
+          THNNState *state,
+          THTensor *input,             // [IN]
+          THIndexTensor *batchSizes,   // [IN]
+          THTensor *weightIH,          // [IN]
+          THTensor *weightHH,          // [IN]
+          THTensor *hx,                // [IN]
+          THTensor *output,            // [IN] output of GRUSequence_updateOutput
+          THTensor *gates,             // [IN] gates buffer of GRUSequence_updateOutput
+          THTensor *gradOutput,        // [IN] gradient w.r.t. the packed output
+          THTensor *gradHy,            // [IN] [OPTIONAL] gradient w.r.t. the final hidden state
+          THTensor *gradInput,         // [OUT] gradient w.r.t. the packed input
+          THTensor *gradHx,            // [OUT] gradient w.r.t. hx
+          THTensor *gradWeightIH,      // [OUT] accumulated
+          THTensor *gradWeightHH,      // [OUT] accumulated
+          THTensor *gradBias1,         // [OUT] [OPTIONAL] accumulated
+          THTensor *gradBias2,         // [OUT] [OPTIONAL] accumulated
+          THTensor *gradGates,         // [BUFFER]
+          accreal scale);
 
 TH_API void THNN_(LogSigmoid_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *output,            // output tensor
+          THTensor *input,             // [IN] input tensor
+          THTensor *output,            // [OUT] output tensor
           THTensor *buffer);           // [BUFFER]
 TH_API void THNN_(LogSigmoid_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input
-          THTensor *gradOutput,        // gradient w.r.t. module's output
+          THTensor *input,             // [IN] input
+          THTensor *gradOutput,        // [IN] gradient w.r.t. module's output
           THTensor *gradInput,         // [OUT] gradient w.r.t. input
-          THTensor *buffer);           // [BUFFER]
+          THTensor *buffer);           // [IN]
 
 TH_API void THNN_(LogSoftMax_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
+          THTensor *input,             // [IN] input tensor
           THTensor *output);           // [OUT] output tensor
 TH_API void THNN_(LogSoftMax_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *gradOutput,        // gradient w.r.t. module's output
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [IN] gradient w.r.t. module's output
           THTensor *gradInput,         // [OUT] gradient w.r.t. input
-          THTensor *output);           // module's output
+          THTensor *output);           // [IN] module's output
 
 TH_API void THNN_(LookupTable_accGradParameters)(
           THNNState *state,
-          THIndexTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THIntegerTensor *count,
-          THTensor *sorted,            // [OPTIONAL]
-          THIndexTensor *indices,      // [OPTIONAL]
+          THIndexTensor *input,        // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THIntegerTensor *count,      // [BUFFER]
+          THTensor *sorted,            // [BUFFER] [OPTIONAL]
+          THIndexTensor *indices,      // [BUFFER] [OPTIONAL]
+          bool scaleGradByFreq,
+          int paddingValue,
+          accreal scale);
+
+TH_API void THNN_(LookupTable_sparseGradParameters)(
+          THNNState *state,            // library's state
+          THIndexTensor *input,        // [IN] input indices (1D/2D)
+          THTensor *gradOutput,        // [IN] gradient w.r.t. module's output
+          THIndexTensor *gradIndices,  // [OUT] 1 x nnz sorted, unique rows of the sparse gradient
+          THTensor *gradValues,        // [OUT] nnz x dim values of the sparse gradient
+          THIntegerTensor *count,      // [BUFFER]
+          long numWeights,             // number of rows of the weight
           bool scaleGradByFreq,
           int paddingValue,
           accreal scale);
 
 TH_API void THNN_(LookupTable_renorm)(
           THNNState *state,            // library's state
-          THIndexTensor *idx,          // vector containing row indices (modified in function)
-          THTensor *weight,            // 2D tensor whose rows will be renormalized
+          THIndexTensor *idx,          // [OUT] vector containing row indices (modified in function)
+          THTensor *weight,            // [OUT] 2D tensor whose rows will be renormalized
           accreal maxNorm,             // maximum norm
           accreal normType);           // the norm type (e.g., normType=2, then it's 2-norm)
 
+TH_API void THNN_(EmbeddingBag_updateOutput)(
+          THNNState *state,            // library's state
+          THIndexTensor *input,        // [IN] indices of all bags, back to back (1D)
+          THIndexTensor *offsets,      // [IN] position in input of the first index of each bag (1D)
+          THTensor *weight,            // [IN] 2D embedding matrix
+          THTensor *output,            // [OUT] nbag x dim pooled embeddings
+          THTensor *perSampleWeights,  // [IN] [OPTIONAL] weight of each index (sum and mean only)
+          THIndexTensor *maxIndices,   // [OUT] nbag x dim rows selected by max pooling (max only)
+          int mode);                   // 0 = sum, 1 = mean, 2 = max
+TH_API void THNN_(EmbeddingBag_accGradParameters)(
+          THNNState *state,            // library's state
+          THIndexTensor *input,        // [IN] indices of all bags, back to back (1D)
+          THIndexTensor *offsets,      // [IN] position in input of the first index of each bag (1D)
+          THTensor *gradOutput,        // [IN] gradient w.r.t. module's output
+          THTensor *gradWeight,        // [OUT] gradient w.r.t. weight, accumulated
+          THTensor *perSampleWeights,  // [IN] [OPTIONAL] weight of each index (sum and mean only)
+          THIndexTensor *maxIndices,   // [IN] rows selected by max pooling (max only)
+          int mode,                    // 0 = sum, 1 = mean, 2 = max
+          accreal scale);              // scaling factor
+TH_API void THNN_(EmbeddingBag_sparseGradParameters)(
+          THNNState *state,            // library's state
+          THIndexTensor *input,        // [IN] indices of all bags, back to back (1D)
+          THIndexTensor *offsets,      // [IN] position in input of the first index of each bag (1D)
+          THTensor *gradOutput,        // [IN] gradient w.r.t. module's output
+          THIndexTensor *gradIndices,  // [OUT] 1 x nnz sorted, unique rows of the sparse gradient
+          THTensor *gradValues,        // [OUT] nnz x dim values of the sparse gradient
+          THTensor *perSampleWeights,  // [IN] [OPTIONAL] weight of each index (sum and mean only)
+          THIndexTensor *maxIndices,   // [IN] rows selected by max pooling (max only)
+          long numWeights,             // number of rows of the weight
+          int mode,                    // 0 = sum, 1 = mean, 2 = max
+          accreal scale);              // scaling factor
+
 TH_API void THNN_(MarginCriterion_updateOutput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *target,            // target tensor (should contain only 1s and -1s)
+          THTensor *input,             // [IN] input tensor
+          THTensor *target,            // [IN] target tensor (should contain only 1s and -1s)
           THTensor *output,            // [OUT] a one-element tensor containing the loss
           bool sizeAverage,            // if true, the loss is normalized by **total number of elements**
           accreal margin);             // a margin that is required for the loss to be 0
 
 TH_API void THNN_(MarginCriterion_updateGradInput)(
           THNNState *state,            // library's state
-          THTensor *input,             // input tensor
-          THTensor *target,            // target tensor (should contin only 1s and -1s)
+          THTensor *input,             // [IN] input tensor
+          THTensor *target,            // [IN] target tensor (should contin only 1s and -1s)
           THTensor *gradInput,         // [OUT] gradient w.r.t. module's input
           bool sizeAverage,            // if true, the gradient is normalized by **total number of elements**
           accreal margin);             // a margin that is required for the loss to be 0
 
+TH_API void THNN_(MarginCriterion_updateOutputAndGradInput)(
+          THNNState *state,            // library's state
+          THTensor *input,             // [IN] input tensor
+          THTensor *target,            // [IN] target tensor (should contain only 1s and -1s)
+          THTensor *output,            // [OUT] a one-element tensor containing the loss
+          THTensor *gradInput,         // [OUT] gradient w.r.t. module's input, computed in the same pass
+          bool sizeAverage,            // if true, the loss is normalized by **total number of elements**
+          accreal margin);             // a margin that is required for the loss to be 0
+
 TH_API void THNN_(SoftMarginCriterion_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *target,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *output,            // [OUT]
           bool sizeAverage);
 
 TH_API void THNN_(SoftMarginCriterion_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *target,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *gradInput,         // [OUT]
+          bool sizeAverage);
+
+TH_API void THNN_(SoftMarginCriterion_updateOutputAndGradInput)(
+          THNNState *state,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *gradInput,         // [OUT]
           bool sizeAverage);
 
 TH_API void THNN_(MSECriterion_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *target,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *output,            // [OUT]
           bool sizeAverage);
 TH_API void THNN_(MSECriterion_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *target,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *gradInput,         // [OUT]
+          bool sizeAverage);
+TH_API void THNN_(MSECriterion_updateOutputAndGradInput)(
+          THNNState *state,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *gradInput,         // [OUT]
           bool sizeAverage);
 
 TH_API void THNN_(MultiLabelMarginCriterion_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THIndexTensor *target,
-          THTensor *output,
-          THTensor *isTarget,
+          THTensor *input,             // [IN]
+          THIndexTensor *target,       // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *isTarget,          // [OUT]
           bool sizeAverage);
 TH_API void THNN_(MultiLabelMarginCriterion_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THIndexTensor *target,
-          THTensor *gradInput,
-          THTensor *isTarget,
+          THTensor *input,             // [IN]
+          THIndexTensor *target,       // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *isTarget,          // [IN]
           bool sizeAverage);
 
 TH_API void THNN_(MultiMarginCriterion_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THIndexTensor *target,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THIndexTensor *target,       // [IN]
+          THTensor *output,            // [OUT]
           bool sizeAverage,
           int p,
-          THTensor* weights,      // [OPTIONAL]
+          THTensor* weights,           // [IN] [OPTIONAL]
           accreal margin);
 TH_API void THNN_(MultiMarginCriterion_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THIndexTensor *target,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THIndexTensor *target,       // [IN]
+          THTensor *gradInput,         // [OUT]
+          bool sizeAverage,
+          int p,
+          THTensor *weights,           // [IN] [OPTIONAL]
+          accreal margin);
+TH_API void THNN_(MultiMarginCriterion_updateOutputAndGradInput)(
+          THNNState *state,
+          THTensor *input,             // [IN]
+          THIndexTensor *target,       // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *gradInput,         // [OUT]
           bool sizeAverage,
           int p,
-          THTensor *weights,      // [OPTIONAL]
+          THTensor *weights,           // [IN] [OPTIONAL]
           accreal margin);
 
 TH_API void THNN_(PReLU_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
           THIndex_t nOutputPlane);
 TH_API void THNN_(PReLU_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
           THIndex_t nOutputPlane);
 TH_API void THNN_(PReLU_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
-          THTensor *gradWeight,
-          THTensor *gradWeightBuf,
-          THTensor *gradWeightBuf2,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [IN]
+          THTensor *weight,            // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradWeightBuf,     // [OUT]
+          THTensor *gradWeightBuf2,    // [OUT]
           THIndex_t nOutputPlane,
           accreal scale);
 
 TH_API void THNN_(Linear_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,
-          THTensor *addBuffer);
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
+          THTensor *addBuffer);        // [BUFFER]
 TH_API void THNN_(Linear_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight);
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight);           // [IN]
 TH_API void THNN_(Linear_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
-          THTensor *bias,
-          THTensor *gradWeight,
-          THTensor *gradBias,
-          THTensor *addBuffer,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [IN]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
+          THTensor *addBuffer,         // [BUFFER]
           accreal scale);
 
 TH_API void THNN_(RReLU_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *noise,
+          THTensor *input,             // [OUT if inplace]
+          THTensor *output,            // [OUT]
+          THTensor *noise,             // [OUT if train]
           accreal lower,
           accreal upper,
           bool train,
@@ -390,10 +584,10 @@ TH_API void THNN_(RReLU_updateOutput)(
           THGenerator *generator);
 TH_API void THNN_(RReLU_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *noise,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [OUT if inplace]
+          THTensor *gradInput,         // [OUT]
+          THTensor *noise,             // [IN]
           accreal lower,
           accreal upper,
           bool train,
@@ -401,319 +595,399 @@ TH_API void THNN_(RReLU_updateGradInput)(
 
 TH_API void THNN_(Sigmoid_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output);
+          THTensor *input,             // [IN]
+          THTensor *output);           // [OUT]
 TH_API void THNN_(Sigmoid_updateGradInput)(
           THNNState *state,
-          THTensor *input,             // [OPTIONAL]
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *output);
+          THTensor *input,             // [IN] [OPTIONAL]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *output);           // [IN]
 
 TH_API void THNN_(SmoothL1Criterion_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *target,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *output,            // [OUT]
           bool sizeAverage);
 TH_API void THNN_(SmoothL1Criterion_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *target,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *gradInput,         // [OUT]
+          bool sizeAverage);
+TH_API void THNN_(SmoothL1Criterion_updateOutputAndGradInput)(
+          THNNState *state,
+          THTensor *input,             // [IN]
+          THTensor *target,            // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *gradInput,         // [OUT]
           bool sizeAverage);
 
 TH_API void THNN_(SoftMax_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output);
+          THTensor *input,             // [IN]
+          THTensor *output);           // [OUT]
 TH_API void THNN_(SoftMax_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *output);
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *output);           // [IN]
 
 TH_API void THNN_(SoftPlus_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           accreal beta,
           accreal threshold);
 TH_API void THNN_(SoftPlus_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *output,            // [IN]
           accreal beta,
           accreal threshold);
 
 TH_API void THNN_(SoftShrink_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           accreal lambda);
 TH_API void THNN_(SoftShrink_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           accreal lambda);
 
 
 TH_API void THNN_(IndexLinear_updateOutput)(
           THNNState *state,
-          THIndexTensor *keys,
+          THIndexTensor *keys,         // [IN]
           long keysOffset,
-          THTensor *values,
-          THIndexTensor *sizes,
-          THIndexTensor *cumSumSizes,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,
-          THTensor *normalizedValues,
+          THTensor *values,            // [IN]
+          THIndexTensor *sizes,        // [IN]
+          THIndexTensor *cumSumSizes,  // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [OUT if train]
+          THTensor *bias,              // [IN]
+          THTensor *normalizedValues,  // [OUT]
           int   train);
 TH_API void THNN_(IndexLinear_accGradParameters)(
           THNNState *state,
-          THIndexTensor *keys,
+          THIndexTensor *keys,         // [IN]
           long keysOffset,
-          THTensor *values,
-          THIndexTensor *sizes,
-          THIndexTensor *cumSumSizes,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,
-          THTensor *weight,
-          THTensor *bias,
-          THTensor* valuesBuffer,
+          THTensor *values,            // [IN]
+          THIndexTensor *sizes,        // [IN]
+          THIndexTensor *cumSumSizes,  // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
+          THTensor* valuesBuffer,      // [BUFFER]
           accreal weightDecay,
           accreal scale);
 TH_API void THNN_(IndexLinear_accUpdateGradParameters)(
           THNNState *state,
-          THIndexTensor *keys,
+          THIndexTensor *keys,         // [IN]
           long keysOffset,
-          THTensor *values,
-          THIndexTensor *sizes,
-          THIndexTensor *cumSumSizes,
-          THTensor *gradOutput,
-          THTensor *weight,
-          THTensor *bias,
+          THTensor *values,            // [IN]
+          THIndexTensor *sizes,        // [IN]
+          THIndexTensor *cumSumSizes,  // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *weight,            // [OUT]
+          THTensor *bias,              // [OUT]
           accreal weightDecay,
           accreal scale);
 TH_API void THNN_(IndexLinear_updateParameters)(
           THNNState *state,
-          THTensor *gradWeight,
-          THTensor *gradBias,
-          THTensor *weight,
-          THTensor *bias,
-          THIndexTensor *runningKeys,
-          THIndexTensor *cumSumSizes,
+          THTensor *gradWeight,        // [IN]
+          THTensor *gradBias,          // [IN]
+          THTensor *weight,            // [OUT]
+          THTensor *bias,              // [OUT]
+          THIndexTensor *runningKeys,  // [IN]
+          THIndexTensor *cumSumSizes,  // [IN]
           long keysOffset,
           accreal weightDecay,
           accreal learningRate);
 
+// Hashed mode of IndexLinear: key k (64 bits) uses the row hash(k, hashSeed)
+// modulo the number of rows of weight, so the weight has a fixed size
+// whatever the number of keys. With signHash the value of a key is also
+// multiplied by a sign drawn from the hash. updateOutput writes the rows of
+// the keys to hashedKeys: pass them as runningKeys, with keysOffset 0, to
+// IndexLinear_updateParameters.
+TH_API void THNN_(HashedIndexLinear_updateOutput)(
+          THNNState *state,
+          THIndexTensor *keys,         // [IN]
+          long keysOffset,
+          THTensor *values,            // [IN]
+          THIndexTensor *sizes,        // [IN]
+          THIndexTensor *cumSumSizes,  // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [OUT if train]
+          THTensor *bias,              // [IN]
+          THTensor *normalizedValues,  // [OUT]
+          THIndexTensor *hashedKeys,   // [OUT]
+          int   train,
+          long  hashSeed,
+          int   signHash);
+TH_API void THNN_(HashedIndexLinear_accGradParameters)(
+          THNNState *state,
+          THIndexTensor *keys,         // [IN]
+          long keysOffset,
+          THTensor *values,            // [IN]
+          THIndexTensor *sizes,        // [IN]
+          THIndexTensor *cumSumSizes,  // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
+          THTensor* valuesBuffer,      // [BUFFER]
+          accreal weightDecay,
+          accreal scale,
+          long  hashSeed,
+          int   signHash);
+TH_API void THNN_(HashedIndexLinear_accUpdateGradParameters)(
+          THNNState *state,
+          THIndexTensor *keys,         // [IN]
+          long keysOffset,
+          THTensor *values,            // [IN]
+          THIndexTensor *sizes,        // [IN]
+          THIndexTensor *cumSumSizes,  // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *weight,            // [OUT]
+          THTensor *bias,              // [OUT]
+          accreal weightDecay,
+          accreal scale,
+          long  hashSeed,
+          int   signHash);
+
 TH_API void THNN_(SparseLinear_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias);
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias);             // [IN]
 TH_API void THNN_(SparseLinear_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,
-          THTensor *weight,
-          THTensor *bias,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
           accreal weightDecay,
           accreal scale);
 TH_API void THNN_(SparseLinear_zeroGradParameters)(
           THNNState *state,
-          THTensor *gradWeight,
-          THTensor *gradBias,
-          THTensor *lastInput);
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
+          THTensor *lastInput);        // [IN]
 TH_API void THNN_(SparseLinear_updateParameters)(
           THNNState *state,
-          THTensor *weight,
-          THTensor *bias,
-          THTensor *gradWeight,
-          THTensor *gradBias,
-          THTensor *lastInput,
+          THTensor *weight,            // [OUT]
+          THTensor *bias,              // [OUT]
+          THTensor *gradWeight,        // [IN]
+          THTensor *gradBias,          // [IN]
+          THTensor *lastInput,         // [IN]
           accreal learningRate);
+TH_API void THNN_(SparseLinearCSR_updateOutput)(
+          THNNState *state,
+          THIndexTensor *rowPtr,       // [IN]
+          THIndexTensor *cols,         // [IN]
+          THTensor *values,            // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias);             // [IN]
+TH_API void THNN_(SparseLinearCSR_accGradParameters)(
+          THNNState *state,
+          THIndexTensor *rowPtr,       // [IN]
+          THIndexTensor *cols,         // [IN]
+          THTensor *values,            // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
+          accreal weightDecay,
+          accreal scale);
 TH_API void THNN_(SparseLinear_legacyUpdateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias);
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias);             // [IN]
 TH_API void THNN_(SparseLinear_legacyAccGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,
-          THTensor *weight,
-          THTensor *bias,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
           accreal weightDecay,
           accreal scale);
 TH_API void THNN_(SparseLinear_legacyZeroGradParameters)(
           THNNState *state,
-          THTensor *gradWeight,
-          THTensor *gradBias,
-          THTensor *lastInput);
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
+          THTensor *lastInput);        // [IN]
 TH_API void THNN_(SparseLinear_legacyUpdateParameters)(
           THNNState *state,
-          THTensor *weight,
-          THTensor *bias,
-          THTensor *gradWeight,
-          THTensor *gradBias,
-          THTensor *lastInput,
+          THTensor *weight,            // [OUT]
+          THTensor *bias,              // [OUT]
+          THTensor *gradWeight,        // [IN]
+          THTensor *gradBias,          // [IN]
+          THTensor *lastInput,         // [IN]
           accreal learningRate);
 
 TH_API void THNN_(Sqrt_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           accreal eps);
 TH_API void THNN_(Sqrt_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *output);
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *output);           // [IN]
 
 TH_API void THNN_(Square_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output);
+          THTensor *input,             // [IN]
+          THTensor *output);           // [OUT]
 TH_API void THNN_(Square_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput);
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput);        // [OUT]
 
 TH_API void THNN_(Tanh_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output);
+          THTensor *input,             // [IN]
+          THTensor *output);           // [OUT]
 TH_API void THNN_(Tanh_updateGradInput)(
           THNNState *state,
-          THTensor *input,             // [OPTIONAL]
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *output);
+          THTensor *input,             // [IN] [OPTIONAL]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *output);           // [IN]
 
 TH_API void THNN_(Threshold_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [OUT if inplace]
+          THTensor *output,            // [OUT]
           accreal threshold,
           accreal val,
           bool inplace);
 TH_API void THNN_(Threshold_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [OUT if inplace]
+          THTensor *gradInput,         // [OUT]
           accreal threshold,
           accreal val,
           bool inplace);
 
 TH_API void THNN_(TemporalConvolution_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
           int kW, int dW,
           int inputFrameSize,
           int outputFrameSize);
 TH_API void THNN_(TemporalConvolution_updateGradInput)(
           THNNState* state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
           int kW, int dW);
 TH_API void THNN_(TemporalConvolution_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
           int kW, int dW,
           accreal scale);
 TH_API void THNN_(TemporalMaxPooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THIndexTensor *indices,      // [OUT] [OPTIONAL] not needed for inference
           int kW, int dW);
 TH_API void THNN_(TemporalMaxPooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THIndexTensor *indices,      // [IN]
           int kW, int dW);
 TH_API void THNN_(TemporalSubSampling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
           int kW, int dW,
           int inputFrameSize);
 TH_API void THNN_(TemporalSubSampling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
           int kW, int dW);
 TH_API void THNN_(TemporalSubSampling_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
           int kW, int dW,
           accreal scale);
 
 TH_API void THNN_(TemporalRowConvolution_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW,
           int dW,
           int padW,
           bool featFirst);
 TH_API void THNN_(TemporalRowConvolution_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW,
           int dW,
           int padW,
           bool featFirst);
 TH_API void THNN_(TemporalRowConvolution_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW,
           int dW,
           int padW,
@@ -722,61 +996,61 @@ TH_API void THNN_(TemporalRowConvolution_accGradParameters)(
 
 TH_API void THNN_(BatchNormalization_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,       // [OPTIONAL]
-          THTensor *bias,         // [OPTIONAL]
-          THTensor *running_mean,
-          THTensor *running_var,
-          THTensor *save_mean,
-          THTensor *save_std,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN] [OPTIONAL]
+          THTensor *bias,              // [IN] [OPTIONAL]
+          THTensor *running_mean,      // [OUT if train]
+          THTensor *running_var,       // [OUT if train]
+          THTensor *save_mean,         // [OUT if train]
+          THTensor *save_std,          // [OUT if train]
           bool train,
           double momentum,
           double eps);
 TH_API void THNN_(BatchNormalization_backward)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,    // [OPTIONAL]
-          THTensor *gradWeight,   // [OPTIONAL]
-          THTensor *gradBias,     // [OPTIONAL]
-          THTensor *weight,       // [OPTIONAL]
-          THTensor *running_mean,
-          THTensor *running_var,
-          THTensor *save_mean,
-          THTensor *save_std,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT] [OPTIONAL]
+          THTensor *gradWeight,        // [OUT] [OPTIONAL]
+          THTensor *gradBias,          // [OUT] [OPTIONAL]
+          THTensor *weight,            // [IN] [OPTIONAL]
+          THTensor *running_mean,      // [IN]
+          THTensor *running_var,       // [IN]
+          THTensor *save_mean,         // [IN]
+          THTensor *save_std,          // [IN]
           bool train,
           double scale,
           double eps);
 
 TH_API void THNN_(SpatialConvolutionMap_updateOutput)(
           THNNState *state,       // library state
-          THTensor *input,        // input tensor
-          THTensor *output,       // [OUT] convolution output
-          THTensor *weight,       // 3D weight tensor (connTable:size(1) x kH x kW)
-          THTensor *bias,         // 1D bias tensor (nOutputPlane)
-          THTensor *connTable,    // connection table
+          THTensor *input,             // [IN] input tensor
+          THTensor *output,            // [OUT] convolution output
+          THTensor *weight,            // [IN] 3D weight tensor (connTable:size(1) x kH x kW)
+          THTensor *bias,              // [IN] 1D bias tensor (nOutputPlane)
+          THTensor *connTable,         // [IN] connection table
           int nInputPlane,        // number of input planes
           int nOutputPlane,       // number of output planes
           int dW, int dH);        // stride
 TH_API void THNN_(SpatialConvolutionMap_updateGradInput)(
           THNNState *state,       // library state
-          THTensor *input,        // input tensor
-          THTensor *gradOutput,   // gradient w.r.t. output
-          THTensor *gradInput,    // [OUT] gradient w.r.t. input
-          THTensor *weight,       // 3D weight tensor (connTable:size(1) x kH x kW)
-          THTensor *bias,         // 1D bias tensor (nOutputPlane)
-          THTensor *connTable,    // connection table
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [IN] gradient w.r.t. output
+          THTensor *gradInput,         // [OUT] gradient w.r.t. input
+          THTensor *weight,            // [IN] 3D weight tensor (connTable:size(1) x kH x kW)
+          THTensor *bias,              // [IN] 1D bias tensor (nOutputPlane)
+          THTensor *connTable,         // [IN] connection table
           int nInputPlane,        // number of input planes
           int nOutputPlane,       // number of output planes
           int dW, int dH);        // stride
 TH_API void THNN_(SpatialConvolutionMap_accGradParameters)(
           THNNState *state,       // library state
-          THTensor *input,        // input tensor
-          THTensor *gradOutput,   // gradient w.r.t. output
-          THTensor *gradWeight,   // 3D gradWeight tensor (connTable:size(1) x kH x kW)
-          THTensor *gradBias,     // 1D gradBias tensor (nOutputPlane)
-          THTensor *connTable,    // connection table
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [IN] gradient w.r.t. output
+          THTensor *gradWeight,        // [OUT] 3D gradWeight tensor (connTable:size(1) x kH x kW)
+          THTensor *gradBias,          // [OUT] 1D gradBias tensor (nOutputPlane)
+          THTensor *connTable,         // [IN] connection table
           int nInputPlane,        // number of input planes
           int nOutputPlane,       // number of output planes
           int dW, int dH,         // stride
@@ -784,34 +1058,34 @@ TH_API void THNN_(SpatialConvolutionMap_accGradParameters)(
 
 TH_API void THNN_(SpatialConvolutionMM_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,         // [OPTIONAL]
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN] [OPTIONAL]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH);
 TH_API void THNN_(SpatialConvolutionMM_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH);
 TH_API void THNN_(SpatialConvolutionMM_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,     // [OPTIONAL]
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT] [OPTIONAL]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -819,34 +1093,34 @@ TH_API void THNN_(SpatialConvolutionMM_accGradParameters)(
 
 TH_API void THNN_(SpatialDepthWiseConvolution_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,         // [OPTIONAL]
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN] [OPTIONAL]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH);
 TH_API void THNN_(SpatialDepthWiseConvolution_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH);
 TH_API void THNN_(SpatialDepthWiseConvolution_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,     // [OPTIONAL]
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT] [OPTIONAL]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -854,12 +1128,12 @@ TH_API void THNN_(SpatialDepthWiseConvolution_accGradParameters)(
 
 TH_API void THNN_(SpatialConvolutionLocal_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -867,12 +1141,12 @@ TH_API void THNN_(SpatialConvolutionLocal_updateOutput)(
           long outputWidth, long outputHeight);
 TH_API void THNN_(SpatialConvolutionLocal_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -880,12 +1154,12 @@ TH_API void THNN_(SpatialConvolutionLocal_updateGradInput)(
           long outputWidth, long outputHeight);
 TH_API void THNN_(SpatialConvolutionLocal_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -895,32 +1169,32 @@ TH_API void THNN_(SpatialConvolutionLocal_accGradParameters)(
 
 TH_API void THNN_(SpatialAdaptiveMaxPooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THIndexTensor *indices,      // [OUT]
           int owidth, int oheight);
 TH_API void THNN_(SpatialAdaptiveMaxPooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THIndexTensor *indices);
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THIndexTensor *indices);     // [IN]
 
 TH_API void THNN_(SpatialAdaptiveAveragePooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           int owidth, int oheight);
 TH_API void THNN_(SpatialAdaptiveAveragePooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput);
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput);        // [OUT]
 
 TH_API void THNN_(SpatialAveragePooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -928,9 +1202,9 @@ TH_API void THNN_(SpatialAveragePooling_updateOutput)(
           bool count_include_pad);
 TH_API void THNN_(SpatialAveragePooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -939,52 +1213,52 @@ TH_API void THNN_(SpatialAveragePooling_updateGradInput)(
 
 TH_API void THNN_(SpatialFractionalMaxPooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           int outputW, int outputH,
           int poolSizeW, int poolSizeH,
-          THIndexTensor *indices,
-          THTensor *randomSamples);
+          THIndexTensor *indices,      // [OUT]
+          THTensor *randomSamples);    // [IN]
 TH_API void THNN_(SpatialFractionalMaxPooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           int outputW, int outputH,
           int poolSizeW, int poolSizeH,
-          THIndexTensor *indices);
+          THIndexTensor *indices);     // [IN]
 
 TH_API void THNN_(SpatialFullConvolution_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,         // [OPTIONAL]
-          THTensor *columns,
-          THTensor *ones,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN] [OPTIONAL]
+          THTensor *columns,           // [BUFFER]
+          THTensor *ones,              // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
           int adjW, int adjH);
 TH_API void THNN_(SpatialFullConvolution_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
-          THTensor *gradColumns,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *gradColumns,       // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
           int adjW, int adjH);
 TH_API void THNN_(SpatialFullConvolution_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,     // [OPTIONAL]
-          THTensor *columns,
-          THTensor *ones,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT] [OPTIONAL]
+          THTensor *columns,           // [BUFFER]
+          THTensor *ones,              // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -993,32 +1267,32 @@ TH_API void THNN_(SpatialFullConvolution_accGradParameters)(
 
 TH_API void THNN_(SpatialFullConvolutionMap_updateOutput)(
           THNNState *state,       // library state
-          THTensor *input,        // input tensor
-          THTensor *output,       // [OUT] convolution output
-          THTensor *weight,       // 3D weight tensor (connTable:size(1) x kH x kW)
-          THTensor *bias,         // 1D bias tensor (nOutputPlane)
-          THTensor *connTable,    // connection table
+          THTensor *input,             // [IN] input tensor
+          THTensor *output,            // [OUT] convolution output
+          THTensor *weight,            // [IN] 3D weight tensor (connTable:size(1) x kH x kW)
+          THTensor *bias,              // [IN] 1D bias tensor (nOutputPlane)
+          THTensor *connTable,         // [IN] connection table
           int nInputPlane,        // number of input planes
           int nOutputPlane,       // number of output planes
           int dW, int dH);        // stride
 TH_API void THNN_(SpatialFullConvolutionMap_updateGradInput)(
           THNNState *state,       // library state
-          THTensor *input,        // input tensor
-          THTensor *gradOutput,   // gradient w.r.t. output
-          THTensor *gradInput,    // [OUT] gradient w.r.t. input
-          THTensor *weight,       // 3D weight tensor (connTable:size(1) x kH x kW)
-          THTensor *bias,         // 1D bias tensor (nOutputPlane)
-          THTensor *connTable,    // connection table
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [IN] gradient w.r.t. output
+          THTensor *gradInput,         // [OUT] gradient w.r.t. input
+          THTensor *weight,            // [IN] 3D weight tensor (connTable:size(1) x kH x kW)
+          THTensor *bias,              // [IN] 1D bias tensor (nOutputPlane)
+          THTensor *connTable,         // [IN] connection table
           int nInputPlane,        // number of input planes
           int nOutputPlane,       // number of output planes
           int dW, int dH);        // stride
 TH_API void THNN_(SpatialFullConvolutionMap_accGradParameters)(
           THNNState *state,       // library state
-          THTensor *input,        // input tensor
-          THTensor *gradOutput,   // gradient w.r.t. output
-          THTensor *gradWeight,   // 3D gradWeight tensor (connTable:size(1) x kH x kW)
-          THTensor *gradBias,     // 1D gradBias tensor (nOutputPlane)
-          THTensor *connTable,    // connection table
+          THTensor *input,             // [IN] input tensor
+          THTensor *gradOutput,        // [IN] gradient w.r.t. output
+          THTensor *gradWeight,        // [OUT] 3D gradWeight tensor (connTable:size(1) x kH x kW)
+          THTensor *gradBias,          // [OUT] 1D gradBias tensor (nOutputPlane)
+          THTensor *connTable,         // [IN] connection table
           int nInputPlane,        // number of input planes
           int nOutputPlane,       // number of output planes
           int dW, int dH,         // stride
@@ -1026,12 +1300,12 @@ TH_API void THNN_(SpatialFullConvolutionMap_accGradParameters)(
 
 TH_API void THNN_(SpatialDilatedConvolution_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,         // [OPTIONAL]
-          THTensor *columns,
-          THTensor *ones,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN] [OPTIONAL]
+          THTensor *columns,           // [BUFFER]
+          THTensor *ones,              // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -1039,11 +1313,11 @@ TH_API void THNN_(SpatialDilatedConvolution_updateOutput)(
 
 TH_API void THNN_(SpatialDilatedConvolution_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
-          THTensor *gradColumns,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *gradColumns,       // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -1051,12 +1325,12 @@ TH_API void THNN_(SpatialDilatedConvolution_updateGradInput)(
 
 TH_API void THNN_(SpatialDilatedConvolution_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,     // [OPTIONAL]
-          THTensor *columns,
-          THTensor *ones,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT] [OPTIONAL]
+          THTensor *columns,           // [BUFFER]
+          THTensor *ones,              // [BUFFER]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -1065,19 +1339,19 @@ TH_API void THNN_(SpatialDilatedConvolution_accGradParameters)(
 
 TH_API void THNN_(SpatialMaxPooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THIndexTensor *indices,      // [OUT] [OPTIONAL] not needed for inference
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
           bool ceil_mode);
 TH_API void THNN_(SpatialMaxPooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THIndexTensor *indices,      // [IN]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -1085,9 +1359,9 @@ TH_API void THNN_(SpatialMaxPooling_updateGradInput)(
 
 TH_API void THNN_(SpatialDilatedMaxPooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THIndexTensor *indices,      // [OUT] [OPTIONAL] not needed for inference
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -1095,10 +1369,10 @@ TH_API void THNN_(SpatialDilatedMaxPooling_updateOutput)(
           bool ceil_mode);
 TH_API void THNN_(SpatialDilatedMaxPooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THIndexTensor *indices,      // [IN]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -1107,66 +1381,66 @@ TH_API void THNN_(SpatialDilatedMaxPooling_updateGradInput)(
 
 TH_API void THNN_(SpatialMaxUnpooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THIndexTensor *indices,      // [IN]
           int owidth, int oheight);
 TH_API void THNN_(SpatialMaxUnpooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THIndexTensor *indices,      // [IN]
           int owidth, int oheight);
 
 TH_API void THNN_(SpatialSubSampling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN]
           int kW, int kH,
           int dW, int dH);
 TH_API void THNN_(SpatialSubSampling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
           int kW, int kH,
           int dW, int dH);
 TH_API void THNN_(SpatialSubSampling_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT]
           int kW, int kH,
           int dW, int dH,
           accreal scale);
 
 TH_API void THNN_(SpatialUpSamplingNearest_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           int scale_factor);
 TH_API void THNN_(SpatialUpSamplingNearest_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           int scale_factor);
 
 TH_API void THNN_(SpatialUpSamplingBilinear_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
 	  int outputHeight,
           int outputWidth);
 TH_API void THNN_(SpatialUpSamplingBilinear_updateGradInput)(
           THNNState *state,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           int nbatch,
           int nchannels,
           int inputHeight,
@@ -1176,19 +1450,21 @@ TH_API void THNN_(SpatialUpSamplingBilinear_updateGradInput)(
 
 TH_API void THNN_(SpatialGridSamplerBilinear_updateOutput)(
 	  THNNState *state,
-	  THTensor *input,
-	  THTensor *grid,
-	  THTensor *output);
+	  THTensor *input,             // [IN]
+	  THTensor *grid,              // [IN]
+	  THTensor *output);           // [OUT]
 
 TH_API void THNN_(SpatialGridSamplerBilinear_updateGradInput)(
 	  THNNState *state,
-	  THTensor *input, THTensor *gradInput,
-	  THTensor *grid, THTensor *gradGrid,
-	  THTensor *gradOutput);
+	  THTensor *input,             // [IN]
+	  THTensor *gradInput,         // [OUT]
+	  THTensor *grid,              // [IN]
+	  THTensor *gradGrid,          // [OUT]
+	  THTensor *gradOutput);       // [IN]
 
 TH_API void THNN_(unfolded_acc)(
-          THTensor *finput,
-          THTensor *input,
+          THTensor *finput,            // [IN]
+          THTensor *input,             // [OUT]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -1196,8 +1472,8 @@ TH_API void THNN_(unfolded_acc)(
           int inputWidth, int inputHeight,
           int outputWidth, int outputHeight);
 TH_API void THNN_(unfolded_copy)(
-          THTensor *finput,
-          THTensor *input,
+          THTensor *finput,            // [BUFFER]
+          THTensor *input,             // [IN]
           int kW, int kH,
           int dW, int dH,
           int padW, int padH,
@@ -1207,77 +1483,77 @@ TH_API void THNN_(unfolded_copy)(
 
 TH_API void THNN_(VolumetricAveragePooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           int kT, int kW, int kH,
           int dT, int dW, int dH);
 TH_API void THNN_(VolumetricAveragePooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           int kT, int kW, int kH,
           int dT, int dW, int dH);
 
 TH_API void THNN_(VolumetricConvolution_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,           // [OPTIONAL]
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN] [OPTIONAL]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int dT, int dW, int dH,
           int pT, int pW, int pH);
 TH_API void THNN_(VolumetricConvolution_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
-          THTensor *finput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *finput,            // [BUFFER]
           int dT, int dW, int dH,
           int pT, int pW, int pH);
 TH_API void THNN_(VolumetricConvolution_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,       // [OPTIONAL]
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT] [OPTIONAL]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int dT, int dW, int dH,
           int pT, int pW, int pH,
           accreal scale);
 
 TH_API void THNN_(VolumetricConvolutionMM_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,           // [OPTIONAL]
-          THTensor *finput,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN] [OPTIONAL]
+          THTensor *finput,            // [BUFFER]
           int kT, int kW, int kH,
           int dT, int dW, int dH,
           int pT, int pW, int pH);
 TH_API void THNN_(VolumetricConvolutionMM_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
-          THTensor *finput,
-          THTensor *fgradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *finput,            // [BUFFER]
+          THTensor *fgradInput,        // [BUFFER]
           int kT, int kW, int kH,
           int dT, int dW, int dH,
           int pT, int pW, int pH);
 TH_API void THNN_(VolumetricConvolutionMM_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,       // [OPTIONAL]
-          THTensor *finput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT] [OPTIONAL]
+          THTensor *finput,            // [BUFFER]
           int kT, int kW, int kH,
           int dT, int dW, int dH,
           int pT, int pW, int pH,
@@ -1285,51 +1561,51 @@ TH_API void THNN_(VolumetricConvolutionMM_accGradParameters)(
 
 TH_API void THNN_(VolumetricFractionalMaxPooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           int outputT, int outputW, int outputH,
           int poolSizeT, int poolSizeW, int poolSizeH,
-          THIndexTensor *indices,
-          THTensor *randomSamples);
+          THIndexTensor *indices,      // [OUT]
+          THTensor *randomSamples);    // [IN]
 TH_API void THNN_(VolumetricFractionalMaxPooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           int outputT, int outputW, int outputH,
           int poolSizeT, int poolSizeW, int poolSizeH,
-          THIndexTensor *indices);
+          THIndexTensor *indices);     // [IN]
 
 TH_API void THNN_(VolumetricFullConvolution_updateOutput)(
           THNNState *state,         // library state
-          THTensor *input,          // 4D or 5D (batch) tensor
-          THTensor *output,         // [OUT] volumetric convolution output
-          THTensor *weight,         // weight tensor (nInputPlane x nOutputPlane x kT x kH x kW)
-          THTensor *bias,           // [OPTIONAL] gradBias tensor (nOutputPlane)
-          THTensor *finput,         // [OUT] internal columns buffer
-          THTensor *fgradInput,     // [OUT] internal ones buffer
+          THTensor *input,             // [IN] 4D or 5D (batch) tensor
+          THTensor *output,            // [OUT] volumetric convolution output
+          THTensor *weight,            // [IN] weight tensor (nInputPlane x nOutputPlane x kT x kH x kW)
+          THTensor *bias,              // [IN] [OPTIONAL] gradBias tensor (nOutputPlane)
+          THTensor *finput,            // [BUFFER] internal columns buffer
+          THTensor *fgradInput,        // [BUFFER] internal ones buffer
           int dT, int dW, int dH,   // stride of the convolution
           int pT, int pW, int pH,   // padding
           int aT, int aW, int aH);  // extra output adjustment
 TH_API void THNN_(VolumetricFullConvolution_updateGradInput)(
           THNNState *state,         // library state
-          THTensor *input,          // 4D or 5D (batch) tensor
-          THTensor *gradOutput,     // gradient w.r.t. output
-          THTensor *gradInput,      // [OUT] gradient w.r.t. input
-          THTensor *weight,         // weight tensor (nInputPlane x nOutputPlane x kT x kH x kW)
-          THTensor *finput,         // internal columns buffer
-          THTensor *fgradInput,     // internal ones buffer
+          THTensor *input,             // [IN] 4D or 5D (batch) tensor
+          THTensor *gradOutput,        // [IN] gradient w.r.t. output
+          THTensor *gradInput,         // [OUT] gradient w.r.t. input
+          THTensor *weight,            // [IN] weight tensor (nInputPlane x nOutputPlane x kT x kH x kW)
+          THTensor *finput,            // [BUFFER] internal columns buffer
+          THTensor *fgradInput,        // [BUFFER] internal ones buffer
           int dT, int dW, int dH,   // stride
           int pT, int pW, int pH,   // padding
           int aT, int aW, int aH);  // extra output adjustment
 TH_API void THNN_(VolumetricFullConvolution_accGradParameters)(
           THNNState *state,         // library state
-          THTensor *input,          // 4D or 5D (batch) tensor
-          THTensor *gradOutput,     // gradient w.r.t. output
-          THTensor *gradWeight,     // gradWeight tensor (nInputPlane x nOutputPlane x kT x kH x kW)
-          THTensor *gradBias,       // [OPTIONAL] gradBias tensor (nOutputPlane)
-          THTensor *finput,         // internal columns buffer
-          THTensor *fgradInput,     // internal ones buffer
+          THTensor *input,             // [IN] 4D or 5D (batch) tensor
+          THTensor *gradOutput,        // [IN] gradient w.r.t. output
+          THTensor *gradWeight,        // [OUT] gradWeight tensor (nInputPlane x nOutputPlane x kT x kH x kW)
+          THTensor *gradBias,          // [OUT] [OPTIONAL] gradBias tensor (nOutputPlane)
+          THTensor *finput,            // [BUFFER] internal columns buffer
+          THTensor *fgradInput,        // [BUFFER] internal ones buffer
           int dT, int dW, int dH,   // stride
           int pT, int pW, int pH,   // padding
           int aT, int aW, int aH,   // extra output adjustment
@@ -1337,12 +1613,12 @@ TH_API void THNN_(VolumetricFullConvolution_accGradParameters)(
 
 TH_API void THNN_(VolumetricDilatedConvolution_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THTensor *weight,
-          THTensor *bias,           // [OPTIONAL]
-          THTensor *columns,
-          THTensor *ones,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *bias,              // [IN] [OPTIONAL]
+          THTensor *columns,           // [BUFFER]
+          THTensor *ones,              // [BUFFER]
           int kT, int kW, int kH,
           int dT, int dW, int dH,
           int padT, int padW, int padH,
@@ -1350,11 +1626,11 @@ TH_API void THNN_(VolumetricDilatedConvolution_updateOutput)(
 
 TH_API void THNN_(VolumetricDilatedConvolution_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THTensor *weight,
-          THTensor *gradColumns,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THTensor *weight,            // [IN]
+          THTensor *gradColumns,       // [BUFFER]
           int kT, int kW, int kH,
           int dT, int dW, int dH,
           int padT, int padW, int padH,
@@ -1362,12 +1638,12 @@ TH_API void THNN_(VolumetricDilatedConvolution_updateGradInput)(
 
 TH_API void THNN_(VolumetricDilatedConvolution_accGradParameters)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradWeight,
-          THTensor *gradBias,       // [OPTIONAL]
-          THTensor *columns,
-          THTensor *ones,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradWeight,        // [OUT]
+          THTensor *gradBias,          // [OUT] [OPTIONAL]
+          THTensor *columns,           // [BUFFER]
+          THTensor *ones,              // [BUFFER]
           int kT, int kW, int kH,
           int dT, int dW, int dH,
           int padT, int padW, int padH,
@@ -1376,19 +1652,19 @@ TH_API void THNN_(VolumetricDilatedConvolution_accGradParameters)(
 
 TH_API void THNN_(VolumetricMaxPooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THIndexTensor *indices,      // [OUT] [OPTIONAL] not needed for inference
           int kT, int kW, int kH,
           int dT, int dW, int dH,
           int pT, int pW, int pH,
           bool ceilMode);
 TH_API void THNN_(VolumetricMaxPooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THIndexTensor *indices,      // [IN]
           int kT, int kW, int kH,
           int dT, int dW, int dH,
           int pT, int pW, int pH,
@@ -1396,9 +1672,9 @@ TH_API void THNN_(VolumetricMaxPooling_updateGradInput)(
 
 TH_API void THNN_(VolumetricDilatedMaxPooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THIndexTensor *indices,      // [OUT] [OPTIONAL] not needed for inference
           int kT, int kW, int kH,
           int dT, int dW, int dH,
           int pT, int pW, int pH,
@@ -1406,10 +1682,10 @@ TH_API void THNN_(VolumetricDilatedMaxPooling_updateOutput)(
           bool ceilMode);
 TH_API void THNN_(VolumetricDilatedMaxPooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THIndexTensor *indices,      // [IN]
           int kT, int kW, int kH,
           int dT, int dW, int dH,
           int pT, int pW, int pH,
@@ -1418,92 +1694,92 @@ TH_API void THNN_(VolumetricDilatedMaxPooling_updateGradInput)(
 
 TH_API void THNN_(VolumetricMaxUnpooling_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
+          THIndexTensor *indices,      // [IN]
           int oT, int oW, int oH,
           int dT, int dW, int dH,
           int pT, int pW, int pH);
 TH_API void THNN_(VolumetricMaxUnpooling_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
-          THIndexTensor *indices,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
+          THIndexTensor *indices,      // [IN]
           int oT, int oW, int oH,
           int dT, int dW, int dH,
           int pT, int pW, int pH);
 
 TH_API void THNN_(SpatialReflectionPadding_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           int pad_l, int pad_r,
           int pad_t, int pad_b);
 
 TH_API void THNN_(SpatialReflectionPadding_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           int pad_l, int pad_r,
           int pad_t, int pad_b);
 
 TH_API void THNN_(SpatialReplicationPadding_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           int pad_l, int pad_r,
           int pad_t, int pad_b);
 
 TH_API void THNN_(SpatialReplicationPadding_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           int pad_l, int pad_r,
           int pad_t, int pad_b);
 
 TH_API void THNN_(VolumetricReplicationPadding_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           int pleft, int pright,
           int ptop, int pbottom,
           int pfront, int pback);
 
 TH_API void THNN_(VolumetricReplicationPadding_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           int pleft, int pright,
           int ptop, int pbottom,
           int pfront, int pback);
 
 TH_API void THNN_(VolumetricUpSamplingNearest_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
           int scale_factor);
 TH_API void THNN_(VolumetricUpSamplingNearest_updateGradInput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *input,             // [IN]
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           int scale_factor);
 
 TH_API void THNN_(VolumetricUpSamplingTrilinear_updateOutput)(
           THNNState *state,
-          THTensor *input,
-          THTensor *output,
+          THTensor *input,             // [IN]
+          THTensor *output,            // [OUT]
 	  int outputDepth,
           int outputHeight,
           int outputWidth);
 TH_API void THNN_(VolumetricUpSamplingTrilinear_updateGradInput)(
           THNNState *state,
-          THTensor *gradOutput,
-          THTensor *gradInput,
+          THTensor *gradOutput,        // [IN]
+          THTensor *gradInput,         // [OUT]
           int nbatch,
           int nchannels,
           int inputDepth,
@@ -7,7 +7,10 @@ void THNN_(Tanh_updateOutput)(
           THTensor *input,
           THTensor *output)
 {
-  THTensor_(tanh)(output, input);
+  THTensor_(resizeAs)(output, input);
+  THNN_TENSOR_APPLY2(real, output, real, input,
+    *output_data = tanh(*input_data);
+  );
 }
 
 void THNN_(Tanh_updateGradInput)(
@@ -20,30 +23,10 @@ void THNN_(Tanh_updateGradInput)(
   THNN_CHECK_SHAPE(output, gradOutput);
   THTensor_(resizeAs)(gradInput, output);
 
-  if (output->nDimension == 1 ||
-      !THTensor_(isContiguous)(output) ||
-      !THTensor_(isContiguous)(gradOutput) ||
-      !THTensor_(isContiguous)(gradInput))
-  {
-    TH_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, output,
-      real z = *output_data;            \
-      *gradInput_data = *gradOutput_data * (1. - z*z);
-    );
-  }
-  else
-  {
-    real* ptr_gradOutput = THTensor_(data)(gradOutput);
-    real* ptr_gradInput  = THTensor_(data)(gradInput);
-    real* ptr_output     = THTensor_(data)(output);
-    long i;
-
-#pragma omp parallel for private(i)
-    for (i = 0; i < THTensor_(nElement)(gradInput); i++)
-    {
-      real z = ptr_output[i];
-      ptr_gradInput[i] = ptr_gradOutput[i] * (1. - z*z);
-    }
-  }
+  THNN_TENSOR_APPLY3(real, gradInput, real, gradOutput, real, output,
+    real z = *output_data;
+    *gradInput_data = *gradOutput_data * (1. - z*z);
+  );
 }
 
 #endif
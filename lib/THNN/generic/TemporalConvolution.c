@@ -34,6 +34,89 @@ static inline void THNN_(TemporalConvolution_shapeCheck)(
              input->size[dimS], kW);
 }
 
+/* The windows of consecutive output frames are rows of a matrix of
+   kW * inputFrameSize columns. When the windows do not overlap (dW >= kW)
+   the input is that matrix, with rows dW * inputFrameSize apart, and is
+   multiplied in place; otherwise the forward copies the windows into a
+   per-thread buffer of at most about THNN_COLUMNS_BUFFER_SIZE elements. The
+   backward passes read and write the windows in place either way, one GEMM
+   per class of windows ceil(kW/dW) frames apart, which never overlap. The
+   output frames of each sequence are cut into chunks that run in
+   parallel. */
+typedef struct {
+  long batch;
+  long nInputFrame, nOutputFrame;
+  long inputFrameSize, outputFrameSize;
+  long kW, dW;
+  int view;      /* windows are multiplied in place */
+  long chunk;    /* output frames per item */
+  long nchunks;
+  long items;
+  int nthreads;
+} THNN_(TemporalConvolutionPlan);
+
+static void THNN_(TemporalConvolution_plan)(
+          THNN_(TemporalConvolutionPlan) *p,
+          THTensor *input,
+          int kW,
+          int dW)
+{
+  long K, parts, minChunk;
+
+  p->batch = input->nDimension == 3 ? input->size[0] : 1;
+  p->nInputFrame = input->size[input->nDimension - 2];
+  p->inputFrameSize = input->size[input->nDimension - 1];
+  p->nOutputFrame = (p->nInputFrame - kW) / dW + 1;
+  p->kW = kW;
+  p->dW = dW;
+  p->view = dW >= kW;
+  p->nthreads = 1;
+#ifdef _OPENMP
+  p->nthreads = omp_get_max_threads();
+#endif
+
+  K = kW * p->inputFrameSize;
+  p->chunk = p->nOutputFrame;
+  if (!p->view)
+    p->chunk = THNN_COLUMNS_BUFFER_SIZE / K;
+  parts = (p->nthreads + p->batch - 1) / p->batch;
+  if (p->chunk > (p->nOutputFrame + parts - 1) / parts)
+    p->chunk = (p->nOutputFrame + parts - 1) / parts;
+  /* chunks two apart must scatter into disjoint input frames */
+  minChunk = (kW - dW + dW - 1) / dW;
+  if (p->chunk < minChunk)
+    p->chunk = minChunk;
+  if (p->chunk < 1)
+    p->chunk = 1;
+  if (p->chunk > p->nOutputFrame)
+    p->chunk = p->nOutputFrame;
+  p->nchunks = (p->nOutputFrame + p->chunk - 1) / p->chunk;
+  p->items = p->batch * p->nchunks;
+}
+
+/* Windows of output frames [t0, t1) of a sequence, as rows *ld elements
+   apart: the sequence itself, or the columns buffer they are copied to. */
+static real* THNN_(TemporalConvolution_windows)(
+          const THNN_(TemporalConvolutionPlan) *p,
+          real *seq,
+          long t0,
+          long t1,
+          real *columns,
+          long *ld)
+{
+  long K = p->kW * p->inputFrameSize;
+  long t;
+
+  if (p->view) {
+    *ld = p->dW * p->inputFrameSize;
+    return seq + t0 * *ld;
+  }
+  for (t = t0; t < t1; t++)
+    memcpy(columns + (t - t0) * K, seq + t * p->dW * p->inputFrameSize, sizeof(real) * K);
+  *ld = K;
+  return columns;
+}
+
 void THNN_(TemporalConvolution_updateOutput)(
           THNNState *state,
           THTensor *input,
@@ -45,123 +128,65 @@ void THNN_(TemporalConvolution_updateOutput)(
           int inputFrameSize,
           int outputFrameSize)
 {
-  THTensor *outputWindow, *inputWindow;
-  int nInputFrame, nOutputFrame;
-  long k, i;
-
-  int dimS = 0; // sequence dimension
-  int dimF = 1; // feature dimension
-
-  if (input->nDimension == 3)
-  {
-    dimS = 1;
-    dimF = 2;
-  }
+  THNN_(TemporalConvolutionPlan) p;
+  real *input_data, *output_data, *weight_data, *bias_data, *scratch;
+  long K, columnsSize;
 
   THArgCheck(THTensor_(isContiguous)(weight), 4, "weight must be contiguous");
   THArgCheck(!bias || THTensor_(isContiguous)(bias), 5, "bias must be contiguous");
   THNN_(TemporalConvolution_shapeCheck)
        (state, input, kW, dW, &inputFrameSize);
   input = THTensor_(newContiguous)(input);
-  outputWindow = THTensor_(new)();
-  inputWindow = THTensor_(new)();
 
-  nInputFrame = input->size[dimS];
-  nOutputFrame = (nInputFrame - kW) / dW + 1;
+  THNN_(TemporalConvolution_plan)(&p, input, kW, dW);
+  p.outputFrameSize = outputFrameSize;
+  K = kW * p.inputFrameSize;
 
   if (input->nDimension == 2)
-  {
-    THTensor_(resize2d)(output,
-                        nOutputFrame,
-                        outputFrameSize);
+    THTensor_(resize2d)(output, p.nOutputFrame, outputFrameSize);
+  else
+    THTensor_(resize3d)(output, p.batch, p.nOutputFrame, outputFrameSize);
 
-    /* bias first */
-    for(k = 0; k < nOutputFrame; k++)
-    {
-      THTensor_(select)(outputWindow, output, 0, k);
-      THTensor_(copy)(outputWindow, bias);
-    }
+  input_data = THTensor_(data)(input);
+  output_data = THTensor_(data)(output);
+  weight_data = THTensor_(data)(weight);
+  bias_data = bias ? THTensor_(data)(bias) : NULL;
+  columnsSize = p.view ? 0 : p.chunk * K;
+  scratch = columnsSize ? THAlloc(sizeof(real) * p.nthreads * columnsSize) : NULL;
 
-    /* ouch */
-    for(k = 0; nOutputFrame > 0; k++)
-    {
-      long outputFrameStride = (kW-1)/dW+1;
-      long inputFrameStride = outputFrameStride*dW;
-      long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-      nOutputFrame -= nFrame;
-
-      THTensor_(setStorage2d)(inputWindow, input->storage,
-                              input->storageOffset+k*dW*input->size[1],
-                              nFrame, inputFrameStride*input->size[1],
-                              kW*input->size[1], 1);
-
-      THTensor_(setStorage2d)(outputWindow, output->storage,
-                              output->storageOffset + k*output->size[1],
-                              nFrame, outputFrameStride*output->size[1],
-                              output->size[1], 1);
-
-      THTensor *tweight = THTensor_(new)();
-      THTensor_(transpose)(tweight, weight, 0, 1);
-      THTensor_(addmm)(outputWindow, 1, outputWindow, 1, inputWindow, tweight);
-      THTensor_(free)(tweight);
-    }
-  }
-  else
+#pragma omp parallel if (p.items > 1)
   {
-    THTensor *outputSample = THTensor_(new)();
-    THTensor *inputSample = THTensor_(new)();
-    int nBatchFrame = input->size[0];
-
-    THTensor_(resize3d)(output,
-                        nBatchFrame,
-                        nOutputFrame,
-                        outputFrameSize);
+    long i;
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    real *columns = scratch + tid * columnsSize;
 
-    for(i = 0; i < nBatchFrame; i++)
+#pragma omp for schedule(dynamic)
+    for (i = 0; i < p.items; i++)
     {
-      THTensor_(select)(outputSample, output, 0, i);
-      THTensor_(select)(inputSample, input, 0, i);
-      long nOutputSampleFrame = nOutputFrame;
+      long b = i / p.nchunks;
+      long t0 = (i % p.nchunks) * p.chunk;
+      long t1 = t0 + p.chunk < p.nOutputFrame ? t0 + p.chunk : p.nOutputFrame;
+      real *out = output_data + (b * p.nOutputFrame + t0) * outputFrameSize;
+      long ld, t;
+      real *windows = THNN_(TemporalConvolution_windows)(
+        &p, input_data + b * p.nInputFrame * p.inputFrameSize, t0, t1, columns, &ld);
 
       /* bias first */
-      for(k = 0; k < nOutputFrame; k++)
-      {
-        THTensor_(select)(outputWindow, outputSample, 0, k);
-        THTensor_(copy)(outputWindow, bias);
-      }
+      if (bias_data)
+        for (t = t0; t < t1; t++)
+          memcpy(out + (t - t0) * outputFrameSize, bias_data, sizeof(real) * outputFrameSize);
 
-      /* ouch */
-      for(k = 0; nOutputSampleFrame > 0; k++)
-      {
-        long outputFrameStride = (kW-1)/dW+1;
-        long inputFrameStride = outputFrameStride*dW;
-        long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-        nOutputSampleFrame -= nFrame;
-
-        THTensor_(setStorage2d)(inputWindow, inputSample->storage,
-                                inputSample->storageOffset+k*dW*inputSample->size[1],
-                                nFrame, inputFrameStride*inputSample->size[1],
-                                kW*inputSample->size[1], 1);
-
-        THTensor_(setStorage2d)(outputWindow, outputSample->storage,
-                                outputSample->storageOffset + k*outputSample->size[1],
-                                nFrame, outputFrameStride*outputSample->size[1],
-                                outputSample->size[1], 1);
-
-        THTensor *tweight = THTensor_(new)();
-        THTensor_(transpose)(tweight, weight, 0, 1);
-        THTensor_(addmm)(outputWindow, 1, outputWindow, 1, inputWindow, tweight);
-        THTensor_(free)(tweight);
-      }
+      THBlas_(gemm)('t', 'n', outputFrameSize, t1 - t0, K,
+                    1, weight_data, K, windows, ld,
+                    bias_data ? 1 : 0, out, outputFrameSize);
     }
-    THTensor_(free)(outputSample);
-    THTensor_(free)(inputSample);
   }
 
-  THTensor_(free)(outputWindow);
-  THTensor_(free)(inputWindow);
+  THFree(scratch);
   THTensor_(free)(input);
-
 }
 
 void THNN_(TemporalConvolution_updateGradInput)(
@@ -173,102 +198,66 @@ void THNN_(TemporalConvolution_updateGradInput)(
           int kW,
           int dW)
 {
-  long nInputFrame;
-  long nOutputFrame;
-
-  THTensor *gradOutputWindow;
-  THTensor *gradInputWindow;
-  long k, i;
-
-  int dimS = 0; // sequence dimension
-  int dimF = 1; // feature dimension
-
-  if (gradOutput->nDimension == 3)
-  {
-    dimS = 1;
-    dimF = 2;
-  }
+  THNN_(TemporalConvolutionPlan) p;
+  real *gradOutput_data, *gradInput_data, *weight_data;
+  long K, b, s = (kW + dW - 1) / dW;
+  int phase, phases;
 
   THArgCheck(THTensor_(isContiguous)(weight), 4, "weight must be contiguous");
   THNN_(TemporalConvolution_shapeCheck)(
         state, input, kW, dW, NULL);
-  nInputFrame = input->size[dimS];
-  nOutputFrame = gradOutput->size[dimS];
 
   input = THTensor_(newContiguous)(input);
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
-  gradOutputWindow = THTensor_(new)();
-  gradInputWindow = THTensor_(new)();
+  THNN_(TemporalConvolution_plan)(&p, input, kW, dW);
+  p.outputFrameSize = gradOutput->size[gradOutput->nDimension - 1];
+  K = kW * p.inputFrameSize;
 
   THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
-
-  if (gradOutput->nDimension == 2)
+  gradOutput_data = THTensor_(data)(gradOutput);
+  gradInput_data = THTensor_(data)(gradInput);
+  weight_data = THTensor_(data)(weight);
+
+  /* frames outside of every window get no gradient */
+#pragma omp parallel for if (THTensor_(nElement)(gradInput) > THNN_OMP_OVERHEAD_THRESHOLD) private(b)
+  for (b = 0; b < p.batch; b++)
+    memset(gradInput_data + b * p.nInputFrame * p.inputFrameSize, 0,
+           sizeof(real) * p.nInputFrame * p.inputFrameSize);
+
+  /* overlapping windows of neighbouring chunks are scattered in two phases */
+  phases = !p.view && p.nchunks > 1 ? 2 : 1;
+  for (phase = 0; phase < phases; phase++)
   {
-    /* ouch */
-    for(k = 0; nOutputFrame > 0; k++)
-    {
-      long outputFrameStride = (kW-1)/dW+1;
-      long inputFrameStride = outputFrameStride*dW;
-      long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-      nOutputFrame -= nFrame;
-
-      THTensor_(setStorage2d)(gradOutputWindow, gradOutput->storage,
-                              gradOutput->storageOffset + k*gradOutput->size[1],
-                              nFrame, outputFrameStride*gradOutput->size[1],
-                              gradOutput->size[1], 1);
-
-      THTensor_(setStorage2d)(gradInputWindow, gradInput->storage,
-                              gradInput->storageOffset+k*dW*gradInput->size[1],
-                              nFrame, inputFrameStride*gradInput->size[1],
-                              kW*gradInput->size[1], 1);
-
-      THTensor_(addmm)(gradInputWindow, 1, gradInputWindow, 1, gradOutputWindow, weight);
-    }
-  }
-  else
-  {
-    THTensor *gradOutputSample = THTensor_(new)();
-    THTensor *gradInputSample = THTensor_(new)();
-    int nBatchFrame = input->size[0];
-
-    for(i = 0; i < nBatchFrame; i++)
+#pragma omp parallel if (p.items > 1)
     {
-      THTensor_(select)(gradOutputSample, gradOutput, 0, i);
-      THTensor_(select)(gradInputSample, gradInput, 0, i);
-      int nOutputSampleFrame = nOutputFrame;
+      long i;
 
-      /* ouch */
-      for(k = 0; nOutputSampleFrame > 0; k++)
+#pragma omp for schedule(dynamic)
+      for (i = 0; i < p.items; i++)
       {
-        long outputFrameStride = (kW-1)/dW+1;
-        long inputFrameStride = outputFrameStride*dW;
-        long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-        nOutputSampleFrame -= nFrame;
-
-        THTensor_(setStorage2d)(gradOutputWindow, gradOutputSample->storage,
-                                gradOutputSample->storageOffset + k*gradOutputSample->size[1],
-                                nFrame, outputFrameStride*gradOutputSample->size[1],
-                                gradOutputSample->size[1], 1);
-
-        THTensor_(setStorage2d)(gradInputWindow, gradInputSample->storage,
-                                gradInputSample->storageOffset+k*dW*gradInputSample->size[1],
-                                nFrame, inputFrameStride*gradInputSample->size[1],
-                                kW*gradInputSample->size[1], 1);
-
-        THTensor_(addmm)(gradInputWindow, 1, gradInputWindow, 1, gradOutputWindow, weight);
+        long b = i / p.nchunks;
+        long t0 = (i % p.nchunks) * p.chunk;
+        long t1 = t0 + p.chunk < p.nOutputFrame ? t0 + p.chunk : p.nOutputFrame;
+        real *gradOut = gradOutput_data + (b * p.nOutputFrame + t0) * p.outputFrameSize;
+        real *seq = gradInput_data + b * p.nInputFrame * p.inputFrameSize;
+        long r;
+
+        if (phases > 1 && (i % p.nchunks) % 2 != phase)
+          continue;
+
+        /* windows s apart do not overlap: accumulate each residue class
+           of the chunk's windows with one GEMM, in place */
+        for (r = 0; r < s && t0 + r < t1; r++)
+          THBlas_(gemm)('n', 'n', K, (t1 - t0 - r + s - 1) / s, p.outputFrameSize,
+                        1, weight_data, K, gradOut + r * p.outputFrameSize, s * p.outputFrameSize,
+                        1, seq + (t0 + r) * dW * p.inputFrameSize, s * dW * p.inputFrameSize);
       }
     }
-    THTensor_(free)(gradOutputSample);
-    THTensor_(free)(gradInputSample);
   }
 
-  THTensor_(free)(gradOutputWindow);
-  THTensor_(free)(gradInputWindow);
   THTensor_(free)(gradOutput);
   THTensor_(free)(input);
-
 }
 
 void THNN_(TemporalConvolution_accGradParameters)(
@@ -282,117 +271,83 @@ void THNN_(TemporalConvolution_accGradParameters)(
           accreal scale_)
 {
   real scale = TH_CONVERT_ACCREAL_TO_REAL(scale_);
-  long nInputFrame;
-  long nOutputFrame;
-
-  THTensor *gradOutputWindow;
-  THTensor *inputWindow;
-  long k, i;
-
-  int dimS = 0; // sequence dimension
-  int dimF = 1; // feature dimension
-
-  if (gradOutput->nDimension == 3)
-  {
-    dimS = 1;
-    dimF = 2;
-  }
+  THNN_(TemporalConvolutionPlan) p;
+  real *input_data, *gradOutput_data, *gradWeight_data, *gradBias_data, *scratch;
+  long K, partialSize, j;
 
   THNN_(TemporalConvolution_shapeCheck)(
         state, input, kW, dW, NULL);
-  nInputFrame = input->size[dimS];
-  nOutputFrame = gradOutput->size[dimS];
+  THArgCheck(THTensor_(isContiguous)(gradWeight), 4, "gradWeight needs to be contiguous");
+  THArgCheck(!gradBias || THTensor_(isContiguous)(gradBias), 5, "gradBias needs to be contiguous");
 
   input = THTensor_(newContiguous)(input);
   gradOutput = THTensor_(newContiguous)(gradOutput);
-  gradOutputWindow = THTensor_(new)();
-  inputWindow = THTensor_(new)();
 
-  if (input->nDimension == 2)
+  THNN_(TemporalConvolution_plan)(&p, input, kW, dW);
+  p.outputFrameSize = gradOutput->size[gradOutput->nDimension - 1];
+  K = kW * p.inputFrameSize;
+
+  input_data = THTensor_(data)(input);
+  gradOutput_data = THTensor_(data)(gradOutput);
+  gradWeight_data = THTensor_(data)(gradWeight);
+  gradBias_data = gradBias ? THTensor_(data)(gradBias) : NULL;
+
+  /* each thread sums into its own gradWeight and gradBias, reduced below */
+  partialSize = p.outputFrameSize * (K + 1);
+  scratch = THAlloc(sizeof(real) * p.nthreads * partialSize);
+  memset(scratch, 0, sizeof(real) * p.nthreads * partialSize);
+
+#pragma omp parallel if (p.items > 1)
   {
-    /* bias first */
-    for(k = 0; k < nOutputFrame; k++)
-    {
-      THTensor_(select)(gradOutputWindow, gradOutput, 0, k);
-      THTensor_(cadd)(gradBias, gradBias, scale, gradOutputWindow);
-    }
+    long i;
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    real *partialWeight = scratch + tid * partialSize;
+    real *partialBias = partialWeight + p.outputFrameSize * K;
 
-    /* ouch */
-    for(k = 0; nOutputFrame > 0; k++)
+#pragma omp for schedule(dynamic)
+    for (i = 0; i < p.items; i++)
     {
-      long outputFrameStride = (kW-1)/dW+1;
-      long inputFrameStride = outputFrameStride*dW;
-      long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-      nOutputFrame -= nFrame;
-
-      THTensor_(setStorage2d)(inputWindow, input->storage,
-                              input->storageOffset+k*dW*input->size[1],
-                              nFrame, inputFrameStride*input->size[1],
-                              kW*input->size[1], 1);
-
-      THTensor_(setStorage2d)(gradOutputWindow, gradOutput->storage,
-                              gradOutput->storageOffset + k*gradOutput->size[1],
-                              nFrame, outputFrameStride*gradOutput->size[1],
-                              gradOutput->size[1], 1);
-
-      THTensor *tgradOutputWindow = THTensor_(new)();
-      THTensor_(transpose)(tgradOutputWindow, gradOutputWindow, 0, 1);
-      THTensor_(addmm)(gradWeight, 1, gradWeight, scale, tgradOutputWindow, inputWindow);
-      THTensor_(free)(tgradOutputWindow);
+      long b = i / p.nchunks;
+      long t0 = (i % p.nchunks) * p.chunk;
+      long t1 = t0 + p.chunk < p.nOutputFrame ? t0 + p.chunk : p.nOutputFrame;
+      real *gradOut = gradOutput_data + (b * p.nOutputFrame + t0) * p.outputFrameSize;
+      real *seq = input_data + b * p.nInputFrame * p.inputFrameSize;
+      long f, r, s = (kW + dW - 1) / dW;
+
+      /* windows s apart do not overlap, so each residue class of the
+         chunk's windows is a strided view of the input */
+      for (r = 0; r < s && t0 + r < t1; r++)
+        THBlas_(gemm)('n', 't', K, p.outputFrameSize, (t1 - t0 - r + s - 1) / s,
+                      scale, seq + (t0 + r) * dW * p.inputFrameSize, s * dW * p.inputFrameSize,
+                      gradOut + r * p.outputFrameSize, s * p.outputFrameSize,
+                      1, partialWeight, K);
+      for (f = t0; f < t1; f++)
+        THVector_(cadd)(partialBias, partialBias, gradOut + (f - t0) * p.outputFrameSize,
+                        1, p.outputFrameSize);
     }
   }
-  else
-  {
-    THTensor *gradOutputSample = THTensor_(new)();
-    THTensor *inputSample = THTensor_(new)();
-    int nBatchFrame = input->size[0];
-
-    for(i = 0; i < nBatchFrame; i++)
-    {
-      THTensor_(select)(gradOutputSample, gradOutput, 0, i);
-      THTensor_(select)(inputSample, input, 0, i);
-      int nOutputSampleFrame = nOutputFrame;
-
-      /* bias first */
-      for(k = 0; k < nOutputFrame; k++)
-      {
-        THTensor_(select)(gradOutputWindow, gradOutputSample, 0, k);
-        THTensor_(cadd)(gradBias, gradBias, scale, gradOutputWindow);
-      }
 
-      /* ouch */
-      for(k = 0; nOutputSampleFrame > 0; k++)
-      {
-        long outputFrameStride = (kW-1)/dW+1;
-        long inputFrameStride = outputFrameStride*dW;
-        long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-        nOutputSampleFrame -= nFrame;
-
-        THTensor_(setStorage2d)(inputWindow, inputSample->storage,
-                                inputSample->storageOffset+k*dW*inputSample->size[1],
-                                nFrame, inputFrameStride*inputSample->size[1],
-                                kW*inputSample->size[1], 1);
-
-        THTensor_(setStorage2d)(gradOutputWindow, gradOutputSample->storage,
-                                gradOutputSample->storageOffset + k*gradOutputSample->size[1],
-                                nFrame, outputFrameStride*gradOutputSample->size[1],
-                                gradOutputSample->size[1], 1);
-
-        THTensor *tgradOutputWindow = THTensor_(new)();
-        THTensor_(transpose)(tgradOutputWindow, gradOutputWindow, 0, 1);
-        THTensor_(addmm)(gradWeight, 1, gradWeight, scale, tgradOutputWindow, inputWindow);
-        THTensor_(free)(tgradOutputWindow);
-      }
-    }
-    THTensor_(free)(gradOutputSample);
-    THTensor_(free)(inputSample);
+#pragma omp parallel for if (partialSize * p.nthreads > THNN_OMP_OVERHEAD_THRESHOLD) private(j)
+  for (j = 0; j < partialSize; j++)
+  {
+    accreal sum = 0;
+    int k;
+    if (j >= p.outputFrameSize * K && !gradBias_data)
+      continue;
+    for (k = 0; k < p.nthreads; k++)
+      sum += scratch[k * partialSize + j];
+    if (j < p.outputFrameSize * K)
+      gradWeight_data[j] += sum;
+    else
+      gradBias_data[j - p.outputFrameSize * K] += scale * sum;
   }
 
-  THTensor_(free)(gradOutputWindow);
-  THTensor_(free)(inputWindow);
+  THFree(scratch);
   THTensor_(free)(gradOutput);
   THTensor_(free)(input);
-
 }
 
 #endif
@@ -64,6 +64,7 @@ void THNN_(TemporalMaxPooling_updateOutput)(
   real *output_data;
   THIndex_t *indices_data;
 
+  long nbframe = 1;
   long t, y;
 
   int dimS = 0; // sequence dimension
@@ -91,93 +92,68 @@ void THNN_(TemporalMaxPooling_updateOutput)(
     THTensor_(resize2d)(output, noframe, framesize);
 
     /* indices will contain index locations for each output point */
-    THIndexTensor_(resize2d)(indices, noframe, framesize);
-
-    /* get raw pointers */
-    input_data = THTensor_(data)(input);
-    output_data = THTensor_(data)(output);
-    indices_data = THIndexTensor_(data)(indices);
-
-    for(t = 0; t < noframe; t++)
-    {
-      real *ip = input_data + t*framesize*dW;
-      real *op = output_data + t*framesize;
-      THIndex_t *xp = indices_data + t*framesize;
-#pragma omp parallel for private(y)
-      for(y = 0; y < framesize; y++)
-      {
-        /* compute local max: */
-        long maxindex = -1;
-        real maxval = -THInf;
-        long x;
-        for(x = 0; x < kW; x++)
-        {
-          real val = ip[x*framesize+y];
-          if (val > maxval)
-          {
-            maxval = val;
-            maxindex = x;
-          }
-        }
-
-        /* set output to local max */
-        op[y] = maxval;
-        xp[y] = (real)maxindex;
-      }
-    }
+    if (indices)
+      THIndexTensor_(resize2d)(indices, noframe, framesize);
   }
   else
   {
     /* number of batch frames */
-    long nbframe = input->size[0];
-    long i;
+    nbframe = input->size[0];
 
     /* resize output */
     THTensor_(resize3d)(output, nbframe, noframe, framesize);
 
     /* indices will contain index locations for each output point */
-    THIndexTensor_(resize3d)(indices, nbframe, noframe, framesize);
+    if (indices)
+      THIndexTensor_(resize3d)(indices, nbframe, noframe, framesize);
+  }
 
-    /* get raw pointers */
-    input_data = THTensor_(data)(input);
-    output_data = THTensor_(data)(output);
-    indices_data = THIndexTensor_(data)(indices);
+  /* get raw pointers */
+  input_data = THTensor_(data)(input);
+  output_data = THTensor_(data)(output);
+  indices_data = indices ? THIndexTensor_(data)(indices) : NULL;
+
+  /* every output frame of every sample is independent; the loops over
+     features are contiguous and carry no branches */
+#pragma omp parallel for private(t, y)
+  for(t = 0; t < nbframe*noframe; t++)
+  {
+    real *ip = input_data + ((t / noframe)*niframe + (t % noframe)*dW)*framesize;
+    real *op = output_data + t*framesize;
+    THIndex_t *xp = indices_data ? indices_data + t*framesize : NULL;
+    long x;
 
-    for(i = 0; i < nbframe; i++)
-    {
-      real *inputSample_data = input_data + i*niframe*framesize;
-      real *outputSample_data = output_data + i*noframe*framesize;
-      THIndex_t *indicesSample_data = indices_data + i*noframe*framesize;
+    for(y = 0; y < framesize; y++)
+      op[y] = -THInf;
 
-      for(t = 0; t < noframe; t++)
+    if (xp)
+    {
+      for(y = 0; y < framesize; y++)
+        xp[y] = -1;
+      for(x = 0; x < kW; x++)
       {
-        real *ip = inputSample_data + t*framesize*dW;
-        real *op = outputSample_data + t*framesize;
-        THIndex_t *xp = indicesSample_data + t*framesize;
-
-#pragma omp parallel for private(y)
+        real *row = ip + x*framesize;
         for(y = 0; y < framesize; y++)
         {
-          /* compute local max: */
-          long maxindex = -1;
-          real maxval = -THInf;
-          long x;
-          for(x = 0; x < kW; x++)
-          {
-            real val = ip[x*framesize+y];
-            if (val > maxval)
-            {
-              maxval = val;
-              maxindex = x;
-            }
-          }
-
-          /* set output to local max */
-          op[y] = maxval;
-          xp[y] = (real)maxindex;
+          /* plain selects, so that both stores stay unconditional */
+          real val = row[y], maxval = op[y];
+          THIndex_t maxindex = xp[y];
+          THIndex_t newindex = val > maxval ? x : maxindex;
+          real newval = val > maxval ? val : maxval;
+          xp[y] = newindex;
+          op[y] = newval;
         }
       }
     }
+    else
+    {
+      for(x = 0; x < kW; x++)
+      {
+        real *row = ip + x*framesize;
+        for(y = 0; y < framesize; y++)
+          op[y] = row[y] > op[y] ? row[y] : op[y];
+      }
+    }
   }
 
   /* cleanup */
@@ -202,15 +178,16 @@ void THNN_(TemporalMaxPooling_updateGradInput)(
   real *gradOutput_data;
   THIndex_t *indices_data;
 
+  long nbframe = 1;
   long t, y;
 
+  THArgCheck(indices != NULL, 5, "indices of the forward pass are required");
   THNN_(TemporalMaxPooling_shapeCheck)(state, input, gradOutput, indices, kW, dW);
   /* get contiguous gradOutput */
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
   /* resize and zero */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   int dimS = 0; // sequence dimension
   int dimF = 1; // feature dimension
@@ -225,53 +202,36 @@ void THNN_(TemporalMaxPooling_updateGradInput)(
   noframe = gradOutput->size[dimS];
   framesize = gradOutput->size[dimF];
 
+  if (input->nDimension == 3)
+    nbframe = input->size[0];
+
   /* get raw pointers */
   gradInput_data = THTensor_(data)(gradInput);
   gradOutput_data = THTensor_(data)(gradOutput);
   indices_data = THIndexTensor_(data)(indices);
 
-  if (input->nDimension == 2)
+  /* gather instead of scatter: every input frame collects the gradient of
+     the output frames whose window covers it, so that the input frames can
+     be processed in parallel */
+#pragma omp parallel for private(t, y)
+  for(t = 0; t < nbframe*niframe; t++)
   {
-    for(t = 0; t < noframe; t++)
+    long sample = t / niframe;
+    long s = t % niframe;
+    long first = s < kW ? 0 : (s - kW + dW) / dW;
+    long last = s / dW < noframe - 1 ? s / dW : noframe - 1;
+    real *gip = gradInput_data + t*framesize;
+    long o;
+
+    for(o = first; o <= last; o++)
     {
-      real *gip = gradInput_data + t*framesize*dW;
-      real *gop = gradOutput_data + t*framesize;
-      THIndex_t *xp = indices_data + t*framesize;
-#pragma omp parallel for private(y)
+      real *gop = gradOutput_data + (sample*noframe + o)*framesize;
+      THIndex_t *xp = indices_data + (sample*noframe + o)*framesize;
+      long x = s - o*dW;
       for(y = 0; y < framesize; y++)
       {
-        /* compute local max: */
-        long maxindex = (long)xp[y];
-	if (maxindex != -1)
-	  gip[maxindex*framesize+y] += gop[y];
-      }
-    }
-  }
-  else
-  {
-    /* number of batch frames */
-    long nbframe = input->size[0];
-    long i;
-
-    for(i = 0; i < nbframe; i++)
-    {
-      real *gradInputSample_data = gradInput_data + i*niframe*framesize;
-      real *gradOutputSample_data = gradOutput_data + i*noframe*framesize;
-      THIndex_t *indicesSample_data = indices_data + i*noframe*framesize;
-
-      for(t = 0; t < noframe; t++)
-      {
-        real *gip = gradInputSample_data + t*framesize*dW;
-        real *gop = gradOutputSample_data + t*framesize;
-        THIndex_t *xp = indicesSample_data + t*framesize;
-#pragma omp parallel for private(y)
-        for(y = 0; y < framesize; y++)
-        {
-          /* compute local max: */
-          long maxindex = (long)xp[y];
-	  if (maxindex != -1)
-	    gip[maxindex*framesize+y] += gop[y];
-        }
+        real grad = gop[y];
+        gip[y] += xp[y] == x ? grad : 0;
       }
     }
   }
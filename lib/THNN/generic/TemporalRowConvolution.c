@@ -56,119 +56,75 @@ static inline void THNN_(TemporalRowConvolution_shapeCheck)(
 	}
 }
 
-static void THNN_(unfolded_acc_row)(
-	THTensor *finput,
-	THTensor *input,
-	int kW,
-	int dW,
-	int padW,
-	long inputFrameSize,
-	long nInputFrame,
-	long nOutputFrame) {
-
-	size_t c;
-	real *input_data = THTensor_(data)(input);
-	real *finput_data = THTensor_(data)(finput);
-
-// #pragma omp parallel for private(c)
-	for (c = 0; c < inputFrameSize; c++) {
-		size_t kw, x;
-		long long ix = 0;
-
-		for (kw = 0; kw < kW; kw++) {
-			real *src = finput_data
-			            + c * (kW * nOutputFrame)
-			            + kw * (nOutputFrame);
-			real *dst = input_data + c * (nInputFrame);
-
-			ix = (long long)(kw);
-			if (dW == 1) {
-			  real *dst_slice = dst + (size_t)(ix);
-			  THVector_(cadd)(dst_slice, dst_slice, src, 1, nOutputFrame);
-			} else {
-				for (x = 0; x < nOutputFrame; x++) {
-				  real *dst_slice = dst + (size_t)(ix + x * dW);
-				  THVector_(cadd)(dst_slice, dst_slice,
-						  src + (size_t)(x), 1, 1);
-				}
-			}
-		}
-	}
+/* Each feature row is convolved with its own kernel, so there is no matrix
+ * product to batch: the rows are processed directly, one tap at a time over
+ * the outputs it reaches, and in parallel over the rows (and over the
+ * features for the parameter gradients, which keeps the sums race-free).
+ * Taps falling into the padding contribute nothing. */
+
+/* Outputs [*lo, *hi) whose tap k falls inside a row of nInputFrame. */
+static inline void THNN_(TemporalRowConvolution_taps)(
+	long nInputFrame, long nOutputFrame, int k, int dW, int padW,
+	long *lo, long *hi) {
+
+	long x = padW - k;
+	long y = nInputFrame + padW - k;
+	*lo = x <= 0 ? 0 : (x + dW - 1) / dW;
+	*hi = y <= 0 ? 0 : (y + dW - 1) / dW;
+	*hi = *hi < nOutputFrame ? *hi : nOutputFrame;
+	*lo = *lo < *hi ? *lo : *hi;
 }
 
-static void THNN_(unfolded_copy_row)(
-	THTensor *finput,
-	THTensor *input,
-	int kW,
-	int dW,
-	int padW,
-	long inputFrameSize,
-	long nInputFrame,
-	long nOutputFrame) {
+/* output += weight (*) input for one row of kW taps. */
+static void THNN_(TemporalRowConvolution_row)(
+	real *output, const real *input, const real *weight,
+	int kW, int dW, int padW, long nInputFrame, long nOutputFrame) {
 
-	long k;
-	real *input_data = THTensor_(data)(input);
-	real *finput_data = THTensor_(data)(finput);
-
-// #pragma omp parallel for private(k)
-	for (k = 0; k < inputFrameSize * kW; k++) {
-		size_t c = k / kW;
-		size_t rest = k % kW;
-		size_t kw = rest % kW;
-		size_t x;
-		long long ix;
-		real *dst = finput_data + c * (kW * nOutputFrame) + kw * (nOutputFrame);
-		real *src = input_data + c * (nInputFrame);
-
-		ix = (long long)(kw);
+	int k;
+	long x, lo, hi;
+
+	for (k = 0; k < kW; k++) {
+		THNN_(TemporalRowConvolution_taps)(nInputFrame, nOutputFrame, k, dW, padW, &lo, &hi);
 		if (dW == 1) {
-			memcpy(dst, src+(size_t)(ix), sizeof(real) * (nOutputFrame));
+			if (hi > lo)
+				THVector_(cadd)(output + lo, output + lo, (real*)input + lo + k - padW,
+				                weight[k], hi - lo);
 		} else {
-			for (x = 0; x < nOutputFrame; x++) {
-				memcpy(dst + (size_t)(x), src + (size_t)(ix + x * dW),
-				       sizeof(real) * 1);
-			}
+			for (x = lo; x < hi; x++)
+				output[x] += weight[k] * input[x * dW + k - padW];
 		}
 	}
 }
 
-static void THNN_(TemporalRowConvolution_updateOutput_frame)(
-	THTensor *input,
-	THTensor *output,
-	THTensor *weight,
-	THTensor *bias,
-	THTensor *finput,
-	int kW,
-	int dW,
-	int padW,
-	long inputFrameSize,
-	long nInputFrame,
-	long nOutputFrame) {
-
-	long i;
-
-	THTensor *output3d = THTensor_(newWithStorage3d)(
-		output->storage, output->storageOffset,
-		inputFrameSize, -1,
-		1, -1,
-		nOutputFrame, -1);
+/* Transpose of TemporalRowConvolution_row: gradInput += weight (*)^T gradOutput. */
+static void THNN_(TemporalRowConvolution_rowBackward)(
+	real *gradInput, const real *gradOutput, const real *weight,
+	int kW, int dW, int padW, long nInputFrame, long nOutputFrame) {
 
-	THNN_(unfolded_copy_row)(finput, input, kW, dW, padW,
-	                         inputFrameSize, nInputFrame, nOutputFrame);
+	int k;
+	long x, lo, hi;
 
-	THTensor_(zero)(output);
-
-	if (bias != NULL) {
-		for (i = 0; i < inputFrameSize; i++)
-			THVector_(fill)
-			        (output->storage->data + output->storageOffset
-			        + output->stride[0] * i,
-			        THTensor_(get1d)(bias, i), nOutputFrame);
+	for (k = 0; k < kW; k++) {
+		THNN_(TemporalRowConvolution_taps)(nInputFrame, nOutputFrame, k, dW, padW, &lo, &hi);
+		if (dW == 1) {
+			if (hi > lo)
+				THVector_(cadd)(gradInput + lo + k - padW, gradInput + lo + k - padW,
+				                (real*)gradOutput + lo, weight[k], hi - lo);
+		} else {
+			for (x = lo; x < hi; x++)
+				gradInput[x * dW + k - padW] += weight[k] * gradOutput[x];
+		}
 	}
+}
 
-	THTensor_(baddbmm)(output3d, 1, output3d, 1, weight, finput);
+/* Resizes t to (T x) rows x n with contiguous strides, which a transposed
+ * result handed back from an earlier call would otherwise keep. */
+static void THNN_(TemporalRowConvolution_resizeRows)(
+	THTensor *t, int ndim, long T, long rows, long n) {
 
-	THTensor_(free)(output3d);
+	long size[3] = {T, rows, n};
+	long stride[3] = {rows * n, n, 1};
+	THTensor_(resizeNd)(t, ndim, size + 3 - ndim, stride + 3 - ndim);
 }
 
 void THNN_(TemporalRowConvolution_updateOutput)(
@@ -177,7 +133,7 @@ void THNN_(TemporalRowConvolution_updateOutput)(
 	THTensor *output,
 	THTensor *weight,
 	THTensor *bias,
-	THTensor *finput,
+	THTensor *finput,         // unused here but needed for Cuda
 	THTensor *fgradInput,     // unused here but needed for Cuda
 	int kW,
 	int dW,
@@ -201,43 +157,24 @@ void THNN_(TemporalRowConvolution_updateOutput)(
 	long nInputFrame = input->size[ndim - 1];
 	long nOutputFrame = (nInputFrame + 2 * padW - kW) / dW + 1;
 
-	if (ndim == 2) { /* non-batch mode */
-
-		THTensor_(resize3d)(finput, inputFrameSize, kW, nOutputFrame);
-		THTensor_(resize2d)(output, inputFrameSize, nOutputFrame);
-
-		THTensor_(zero)(finput);
-		THTensor_(zero)(output);
+	long T = ndim == 3 ? input->size[0] : 1;
+	long r;
 
-		THNN_(TemporalRowConvolution_updateOutput_frame)
-		        (input, output, weight, bias, finput,
-		        kW, dW, padW,
-		        inputFrameSize, nInputFrame, nOutputFrame);
+	THNN_(TemporalRowConvolution_resizeRows)(output, ndim, T, inputFrameSize, nOutputFrame);
 
-	} else {
-		long T = input->size[0];
-		long t;
-
-		THTensor_(resize4d)(finput, T, inputFrameSize, kW, nOutputFrame);
-		THTensor_(resize3d)(output, T, inputFrameSize, nOutputFrame);
-
-		THTensor_(zero)(finput);
-		THTensor_(zero)(output);
-
-#pragma omp parallel for private(t)
-		for (t = 0; t < T; t++) {
-			THTensor *input_t = THTensor_(newSelect)(input, 0, t);
-			THTensor *output_t = THTensor_(newSelect)(output, 0, t);
-			THTensor *finput_t = THTensor_(newSelect)(finput, 0, t);
-
-			THNN_(TemporalRowConvolution_updateOutput_frame)
-			        (input_t, output_t, weight, bias, finput_t,
-			        kW, dW, padW, inputFrameSize, nInputFrame, nOutputFrame);
-
-			THTensor_(free)(input_t);
-			THTensor_(free)(output_t);
-			THTensor_(free)(finput_t);
-		}
+	real *input_data = THTensor_(data)(input);
+	real *output_data = THTensor_(data)(output);
+	real *weight_data = THTensor_(data)(weight);
+	real *bias_data = bias ? THTensor_(data)(bias) : NULL;
+
+#pragma omp parallel for if (T * inputFrameSize * nOutputFrame * kW > THNN_OMP_OVERHEAD_THRESHOLD) private(r)
+	for (r = 0; r < T * inputFrameSize; r++) {
+		long c = r % inputFrameSize;
+		real *out = output_data + r * nOutputFrame;
+		THVector_(fill)(out, bias_data ? bias_data[c] : 0, nOutputFrame);
+		THNN_(TemporalRowConvolution_row)(
+			out, input_data + r * nInputFrame, weight_data + c * kW,
+			kW, dW, padW, nInputFrame, nOutputFrame);
 	}
 
 	if (!featFirst) { // NOTE: output will NOT be contiguous in this case
@@ -248,37 +185,6 @@ void THNN_(TemporalRowConvolution_updateOutput)(
 	THTensor_(free)(input);
 }
 
-static void THNN_(TemporalRowConvolution_updateGradInput_frame)(
-	THTensor *gradInput,
-	THTensor *gradOutput,
-	THTensor *weight,
-	THTensor *fgradInput,
-	int kW,
-	int dW,
-	int padW,
-	long inputFrameSize,
-	long nInputFrame,
-	long nOutputFrame) {
-
-	THTensor *gradOutput3d = THTensor_(newWithStorage3d)(
-		gradOutput->storage, gradOutput->storageOffset,
-		inputFrameSize, -1,
-		1, -1,
-		nOutputFrame, -1);
-
-	// weight:			inputFrameSize x kW x 1
-	// gradOutput3d:	inputFrameSize x 1 x nOutputFrame
-	THTensor_(baddbmm)(fgradInput, 0, fgradInput, 1, weight, gradOutput3d);
-	// fgradInput:		inputFrameSize x kW x nOutputFrame
-	THTensor_(free)(gradOutput3d);
-
-	THTensor_(zero)(gradInput);
-
-	THNN_(unfolded_acc_row)(fgradInput, gradInput,
-	                        kW, dW, padW,
-	                        inputFrameSize, nInputFrame, nOutputFrame);
-}
-
 void THNN_(TemporalRowConvolution_updateGradInput)(
 	THNNState *state,
 	THTensor *input,
@@ -315,44 +221,25 @@ void THNN_(TemporalRowConvolution_updateGradInput)(
 	long nInputFrame = input->size[ndim - 1];
 	long nOutputFrame = (nInputFrame + 2 * padW - kW) / dW + 1;
 
-	THTensor_(resizeAs)(fgradInput, finput);
-	THTensor_(resizeAs)(gradInput, input);
-
-	THTensor_(zero)(fgradInput);
-	THTensor_(zero)(gradInput);
-
-    THTensor *tweight = THTensor_(new)();
-    THTensor_(transpose)(tweight, weight, 1, 2);
+	long T = ndim == 3 ? input->size[0] : 1;
+	long r;
 
-	if (ndim == 2) {
-		THNN_(TemporalRowConvolution_updateGradInput_frame)
-		        (gradInput, gradOutput, tweight, fgradInput,
-		        kW, dW, padW,
-		        inputFrameSize, nInputFrame, nOutputFrame);
-	} else {
-		long T = input->size[0];
-		long t;
-
-#pragma omp parallel for private(t)
-		for (t = 0; t < T; t++) {
-
-			THTensor *gradInput_t = THTensor_(newSelect)(gradInput, 0, t);
-			THTensor *gradOutput_t = THTensor_(newSelect)(gradOutput, 0, t);
-			THTensor *fgradInput_t = THTensor_(newSelect)(fgradInput, 0, t);
+	THNN_(TemporalRowConvolution_resizeRows)(gradInput, ndim, T, inputFrameSize, nInputFrame);
 
-			THNN_(TemporalRowConvolution_updateGradInput_frame)
-			        (gradInput_t, gradOutput_t, tweight, fgradInput_t,
-			        kW, dW, padW,
-			        inputFrameSize, nInputFrame, nOutputFrame);
+	real *gradInput_data = THTensor_(data)(gradInput);
+	real *gradOutput_data = THTensor_(data)(gradOutput);
+	real *weight_data = THTensor_(data)(weight);
 
-			THTensor_(free)(gradInput_t);
-			THTensor_(free)(gradOutput_t);
-			THTensor_(free)(fgradInput_t);
-		}
+#pragma omp parallel for if (T * inputFrameSize * nOutputFrame * kW > THNN_OMP_OVERHEAD_THRESHOLD) private(r)
+	for (r = 0; r < T * inputFrameSize; r++) {
+		real *grad = gradInput_data + r * nInputFrame;
+		memset(grad, 0, sizeof(real) * nInputFrame);
+		THNN_(TemporalRowConvolution_rowBackward)(
+			grad, gradOutput_data + r * nOutputFrame,
+			weight_data + (r % inputFrameSize) * kW,
+			kW, dW, padW, nInputFrame, nOutputFrame);
 	}
 
-    THTensor_(free)(tweight);
-
 	if (!featFirst) { // NOTE: gradInput will NOT be contiguous in this case
 
 		THTensor_(free)(tinput);
@@ -366,44 +253,6 @@ void THNN_(TemporalRowConvolution_updateGradInput)(
 
 }
 
-static void THNN_(TemporalRowConvolution_accGradParameters_frame)(
-	THTensor *gradOutput, THTensor *gradWeight, THTensor *gradBias,
-	THTensor *finput, real scale) {
-
-	long i;
-	THTensor *gradOutput3d = THTensor_(newWithStorage3d)(
-		gradOutput->storage, gradOutput->storageOffset,
-		gradOutput->size[0], -1,
-		1, -1,
-		gradOutput->size[1], -1);
-
-    THTensor *tfinput = THTensor_(new)();
-	THTensor_(transpose)(tfinput, finput, 1, 2);
-	// gradOutput3d:	inputFrameSize x 1 x nOutputFrame
-	// finput:			inputFrameSize x nOutputFrame x kW
-	THTensor_(baddbmm)(gradWeight, 1, gradWeight, scale, gradOutput3d, tfinput);
-	// gradWeight:		inputFrameSize x 1 x kW
-    THTensor_(free)(tfinput);
-
-	if (gradBias != NULL) {
-		for (i = 0; i < gradBias->size[0]; i++) {
-			long k;
-			real sum = 0;
-			real *data = gradOutput3d->storage->data
-			             + gradOutput3d->storageOffset
-			             + i * gradOutput3d->stride[0];
-			for (k = 0; k < gradOutput3d->size[2]; k++) {
-				sum += data[k];
-			}
-			(gradBias->storage->data + gradBias->storageOffset)[i]
-			        += scale * sum;
-		}
-	}
-
-	THTensor_(free)(gradOutput3d);
-
-}
-
 void THNN_(TemporalRowConvolution_accGradParameters)(
 	THNNState *state,
 	THTensor *input,
@@ -441,22 +290,42 @@ void THNN_(TemporalRowConvolution_accGradParameters)(
 	long nInputFrame = input->size[ndim - 1];
 	long nOutputFrame = (nInputFrame + 2 * padW - kW) / dW + 1;
 
-	if (ndim == 2) {
-		THNN_(TemporalRowConvolution_accGradParameters_frame)(
-			gradOutput, gradWeight, gradBias, finput, scale);
-	} else {
-		long T = input->size[0];
-		long t;
+	long T = ndim == 3 ? input->size[0] : 1;
+	long c;
 
-		for (t = 0; t < T; t++) {
-			THTensor *gradOutput_t = THTensor_(newSelect)(gradOutput, 0, t);
-			THTensor *finput_t = THTensor_(newSelect)(finput, 0, t);
+	THArgCheck(THTensor_(isContiguous)(gradWeight), 4, "gradWeight needs to be contiguous");
+	THArgCheck(!gradBias || THTensor_(isContiguous)(gradBias), 5, "gradBias needs to be contiguous");
 
-			THNN_(TemporalRowConvolution_accGradParameters_frame)(
-				gradOutput_t, gradWeight, gradBias, finput_t, scale);
+	real *input_data = THTensor_(data)(input);
+	real *gradOutput_data = THTensor_(data)(gradOutput);
+	real *gradWeight_data = THTensor_(data)(gradWeight);
+	real *gradBias_data = gradBias ? THTensor_(data)(gradBias) : NULL;
 
-			THTensor_(free)(gradOutput_t);
-			THTensor_(free)(finput_t);
+#pragma omp parallel for if (T * inputFrameSize * nOutputFrame * kW > THNN_OMP_OVERHEAD_THRESHOLD) private(c)
+	for (c = 0; c < inputFrameSize; c++) {
+		long t, x, lo, hi;
+		int k;
+
+		for (k = 0; k < kW; k++) {
+			accreal sum = 0;
+			THNN_(TemporalRowConvolution_taps)(nInputFrame, nOutputFrame, k, dW, padW, &lo, &hi);
+			for (t = 0; t < T; t++) {
+				const real *grad = gradOutput_data + (t * inputFrameSize + c) * nOutputFrame;
+				const real *src = input_data + (t * inputFrameSize + c) * nInputFrame;
+				for (x = lo; x < hi; x++)
+					sum += grad[x] * src[x * dW + k - padW];
+			}
+			gradWeight_data[c * kW + k] += scale * sum;
+		}
+
+		if (gradBias_data) {
+			accreal sum = 0;
+			for (t = 0; t < T; t++) {
+				const real *grad = gradOutput_data + (t * inputFrameSize + c) * nOutputFrame;
+				for (x = 0; x < nOutputFrame; x++)
+					sum += grad[x];
+			}
+			gradBias_data[c] += scale * sum;
 		}
 	}
 
@@ -38,6 +38,21 @@ static inline void THNN_(TemporalSubSampling_shapeCheck)(
   }
 }
 
+/* dst = sum of the kW frames of frameSize elements starting at window. */
+static inline void THNN_(TemporalSubSampling_windowSum)(
+          real *dst,
+          const real *window,
+          int kW,
+          long frameSize)
+{
+  long f;
+  int j;
+  memcpy(dst, window, sizeof(real) * frameSize);
+  for (j = 1; j < kW; j++)
+    for (f = 0; f < frameSize; f++)
+      dst[f] += window[j * frameSize + f];
+}
+
 void THNN_(TemporalSubSampling_updateOutput)(
           THNNState *state,
           THTensor *input,
@@ -48,17 +63,15 @@ void THNN_(TemporalSubSampling_updateOutput)(
           int dW,
           int inputFrameSize)
 {
-  THTensor *outputFrame, *inputWindow;
   int nInputFrame, nOutputFrame;
+  real *input_data, *output_data, *weight_data, *bias_data;
   long k;
 
   THArgCheck(THTensor_(isContiguous)(weight), 4, "weight must be contiguous");
   THArgCheck(!bias || THTensor_(isContiguous)(bias), 4, "bias must be contiguous");
   THNN_(TemporalSubSampling_shapeCheck)(state, input, NULL, kW, dW, &inputFrameSize);
 
-  outputFrame = THTensor_(new)();
-  inputWindow = THTensor_(new)();
-
+  input = THTensor_(newContiguous)(input);
   nInputFrame = input->size[0];
   nOutputFrame = (nInputFrame - kW) / dW + 1;
 
@@ -66,17 +79,22 @@ void THNN_(TemporalSubSampling_updateOutput)(
                       nOutputFrame,
                       inputFrameSize);
 
+  input_data = THTensor_(data)(input);
+  output_data = THTensor_(data)(output);
+  weight_data = THTensor_(data)(weight);
+  bias_data = bias ? THTensor_(data)(bias) : NULL;
+
+#pragma omp parallel for if ((long)nOutputFrame * kW * inputFrameSize > THNN_OMP_OVERHEAD_THRESHOLD) private(k)
   for(k = 0; k < nOutputFrame; k++)
   {
-    THTensor_(narrow)(inputWindow, input, 0, k*dW, kW);
-    THTensor_(select)(outputFrame, output, 0, k);
-    THTensor_(sum)(outputFrame, inputWindow, 0, 1);
-    THTensor_(cmul)(outputFrame, outputFrame, weight);
-    THTensor_(cadd)(outputFrame, outputFrame, 1, bias);
+    real *out = output_data + k * inputFrameSize;
+    long f;
+    THNN_(TemporalSubSampling_windowSum)(out, input_data + k * dW * inputFrameSize, kW, inputFrameSize);
+    for (f = 0; f < inputFrameSize; f++)
+      out[f] = out[f] * weight_data[f] + (bias_data ? bias_data[f] : 0);
   }
 
-  THTensor_(free)(outputFrame);
-  THTensor_(free)(inputWindow);
+  THTensor_(free)(input);
 }
 
 void THNN_(TemporalSubSampling_updateGradInput)(
@@ -88,35 +106,42 @@ void THNN_(TemporalSubSampling_updateGradInput)(
           int kW,
           int dW)
 {
-
-  THTensor *gradOutputFrame;
-  THTensor *gradInputWindow, *buffer, *kwunit;
-  long k;
+  long nInputFrame, nOutputFrame, frameSize;
+  real *gradOutput_data, *gradInput_data, *weight_data;
+  long s;
 
   THArgCheck(THTensor_(isContiguous)(weight), 4, "weight must be contiguous");
   THNN_(TemporalSubSampling_shapeCheck)(state, input, gradOutput, kW, dW, NULL);
 
-  gradOutputFrame = THTensor_(new)();
-  gradInputWindow = THTensor_(new)();
-  buffer = THTensor_(new)();
-  kwunit = THTensor_(newWithSize1d)(kW);
-
-  THTensor_(fill)(kwunit, 1);
+  gradOutput = THTensor_(newContiguous)(gradOutput);
   THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THArgCheck(THTensor_(isContiguous)(gradInput), 4, "gradInput must be contiguous");
 
-  for(k = 0; k < gradOutput->size[0]; k++)
+  nInputFrame = input->size[0];
+  nOutputFrame = gradOutput->size[0];
+  frameSize = input->size[1];
+  gradOutput_data = THTensor_(data)(gradOutput);
+  gradInput_data = THTensor_(data)(gradInput);
+  weight_data = THTensor_(data)(weight);
+
+  /* gather the gradient of each input frame from the windows covering it,
+     rather than scattering the windows into overlapping frames */
+#pragma omp parallel for if (nInputFrame * kW / dW * frameSize > THNN_OMP_OVERHEAD_THRESHOLD) private(s)
+  for(s = 0; s < nInputFrame; s++)
   {
-    THTensor_(narrow)(gradInputWindow, gradInput, 0, k*dW, kW);
-    THTensor_(select)(gradOutputFrame, gradOutput, 0, k);
-    THTensor_(cmul)(buffer, weight, gradOutputFrame);
-    THTensor_(addr)(gradInputWindow, 1, gradInputWindow, 1, kwunit, buffer);
+    real *grad = gradInput_data + s * frameSize;
+    long t0 = s < kW ? 0 : (s - kW + dW) / dW;
+    long t1 = s / dW + 1 < nOutputFrame ? s / dW + 1 : nOutputFrame;
+    long t, f;
+
+    memset(grad, 0, sizeof(real) * frameSize);
+    for (t = t0; t < t1; t++)
+      THVector_(cadd)(grad, grad, gradOutput_data + t * frameSize, 1, frameSize);
+    for (f = 0; f < frameSize; f++)
+      grad[f] *= weight_data[f];
   }
 
-  THTensor_(free)(gradOutputFrame);
-  THTensor_(free)(gradInputWindow);
-  THTensor_(free)(buffer);
-  THTensor_(free)(kwunit);
+  THTensor_(free)(gradOutput);
 }
 
 void THNN_(TemporalSubSampling_accGradParameters)(
@@ -130,27 +155,76 @@ void THNN_(TemporalSubSampling_accGradParameters)(
           accreal scale_)
 {
   real scale = TH_CONVERT_ACCREAL_TO_REAL(scale_);
-  THTensor *gradOutputFrame;
-  THTensor *inputWindow, *buffer;
-  long k;
+  long nOutputFrame, frameSize, f;
+  real *input_data, *gradOutput_data, *gradWeight_data, *gradBias_data, *rows;
+  accreal *partial;
+  int nthreads = 1;
 
   THNN_(TemporalSubSampling_shapeCheck)(state, input, gradOutput, kW, dW, NULL);
-  gradOutputFrame = THTensor_(new)();
-  inputWindow = THTensor_(new)();
-  buffer = THTensor_(new)();
+  THArgCheck(THTensor_(isContiguous)(gradWeight), 4, "gradWeight needs to be contiguous");
+  THArgCheck(!gradBias || THTensor_(isContiguous)(gradBias), 5, "gradBias needs to be contiguous");
+
+  input = THTensor_(newContiguous)(input);
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  nOutputFrame = gradOutput->size[0];
+  frameSize = input->size[1];
+  input_data = THTensor_(data)(input);
+  gradOutput_data = THTensor_(data)(gradOutput);
+  gradWeight_data = THTensor_(data)(gradWeight);
+  gradBias_data = gradBias ? THTensor_(data)(gradBias) : NULL;
+
+  /* each thread sums a share of the frames into its own partial sums */
+#ifdef _OPENMP
+  nthreads = omp_get_max_threads();
+#endif
+  rows = THAlloc(sizeof(real) * nthreads * frameSize);
+  partial = THAlloc(sizeof(accreal) * nthreads * 2 * frameSize);
+  for (f = 0; f < nthreads * 2 * frameSize; f++)
+    partial[f] = 0;
 
-  for(k = 0; k < gradOutput->size[0]; k++)
+#pragma omp parallel if (nOutputFrame * kW * frameSize > THNN_OMP_OVERHEAD_THRESHOLD)
   {
-    THTensor_(narrow)(inputWindow, input, 0, k*dW, kW);
-    THTensor_(select)(gradOutputFrame, gradOutput, 0, k);
-    THTensor_(sum)(buffer, inputWindow, 0, 1);
-    THTensor_(addcmul)(gradWeight, gradWeight, scale, buffer, gradOutputFrame);
-    THTensor_(cadd)(gradBias, gradBias, scale, gradOutputFrame);
+    long k;
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    real *sum = rows + tid * frameSize;
+    accreal *partialWeight = partial + tid * 2 * frameSize;
+    accreal *partialBias = partialWeight + frameSize;
+
+#pragma omp for
+    for(k = 0; k < nOutputFrame; k++)
+    {
+      const real *grad = gradOutput_data + k * frameSize;
+      long f;
+      THNN_(TemporalSubSampling_windowSum)(sum, input_data + k * dW * frameSize, kW, frameSize);
+      for (f = 0; f < frameSize; f++)
+      {
+        partialWeight[f] += grad[f] * sum[f];
+        partialBias[f] += grad[f];
+      }
+    }
+  }
+
+  for (f = 0; f < frameSize; f++)
+  {
+    accreal sumWeight = 0, sumBias = 0;
+    int t;
+    for (t = 0; t < nthreads; t++)
+    {
+      sumWeight += partial[t * 2 * frameSize + f];
+      sumBias += partial[t * 2 * frameSize + frameSize + f];
+    }
+    gradWeight_data[f] += scale * sumWeight;
+    if (gradBias_data)
+      gradBias_data[f] += scale * sumBias;
   }
 
-  THTensor_(free)(gradOutputFrame);
-  THTensor_(free)(inputWindow);
-  THTensor_(free)(buffer);
+  THFree(rows);
+  THFree(partial);
+  THTensor_(free)(input);
+  THTensor_(free)(gradOutput);
 }
 
 #endif
@@ -69,7 +69,6 @@ static inline void THNN_(VolumetricAveragePooling_shapeCheck)(
 static void THNN_(VolumetricAveragePooling_updateOutput_frame)(
           real *input_p,
           real *output_p,
-          long nslices,
           long itime,
           long iwidth,
           long iheight,
@@ -83,43 +82,30 @@ static void THNN_(VolumetricAveragePooling_updateOutput_frame)(
           int dW,
           int dH)
 {
-  long k;
-#pragma omp parallel for private(k)
-  for (k = 0; k < nslices; k++)
+  /* loop over output rows */
+  long i, j, ti;
+  for (ti = 0; ti < otime; ti++)
   {
-    /* loop over output */
-    long i, j, ti;
-    for (ti = 0; ti < otime; ti++)
+    for (i = 0; i < oheight; i++)
     {
-      for (i = 0; i < oheight; i++)
+      real *op = output_p + ti * owidth * oheight + i * owidth;
+      int y, z;
+
+      for (j = 0; j < owidth; j++)
+        op[j] = 0;
+
+      /* sum the input rows of the windows */
+      for (z = 0; z < kT; z++)
       {
-        for (j = 0; j < owidth; j++)
+        for (y = 0; y < kH; y++)
         {
-          /* local pointers */
-          real *ip = input_p + k * itime * iwidth * iheight
-            + ti * iwidth * iheight * dT +  i * iwidth * dH + j * dW;
-          real *op = output_p + k * otime * owidth * oheight
-            + ti * owidth * oheight + i * owidth + j;
-
-          /* compute local sum: */
-          real sum = 0.0;
-          int x, y, z;
-
-          for (z=0; z < kT; z++)
-          {
-            for (y = 0; y < kH; y++)
-            {
-              for (x = 0; x < kW; x++)
-              {
-                sum +=  *(ip + z * iwidth * iheight + y * iwidth + x);
-              }
-            }
-          }
-
-          /* set output to local max */
-          *op = sum / (kT * kW * kH);
+          real *ip = input_p + (ti * dT + z) * iwidth * iheight + (i * dH + y) * iwidth;
+          THNN_(pooling_sumRow)(ip, iwidth, op, owidth, kW, dW, 0);
         }
       }
+
+      for (j = 0; j < owidth; j++)
+        op[j] /= (kT * kW * kH);
     }
   }
 }
@@ -144,6 +130,8 @@ void THNN_(VolumetricAveragePooling_updateOutput)(
   long owidth;
   real *input_data;
   real *output_data;
+  long nBatch = 1;
+  long k;
 
   THNN_(VolumetricAveragePooling_shapeCheck)(
         state, input, NULL, kT, kW, kH,
@@ -178,43 +166,30 @@ void THNN_(VolumetricAveragePooling_updateOutput)(
   {
     /* resize output */
     THTensor_(resize4d)(output, nslices, otime, oheight, owidth);
-
-    input_data = THTensor_(data)(input);
-    output_data = THTensor_(data)(output);
-
-    THNN_(VolumetricAveragePooling_updateOutput_frame)(
-      input_data, output_data, nslices,
-      itime, iwidth, iheight,
-      otime, owidth, oheight,
-      kT, kW, kH,
-      dT, dW, dH
-    );
   }
   else  /* batch mode */
   {
-    long p;
-    long nBatch = input->size[0];
-
-    long istride = nslices * itime * iwidth * iheight;
-    long ostride = nslices * otime * owidth * oheight;
+    nBatch = input->size[0];
 
     /* resize output */
     THTensor_(resize5d)(output, nBatch, nslices, otime, oheight, owidth);
+  }
 
-    input_data = THTensor_(data)(input);
-    output_data = THTensor_(data)(output);
+  input_data = THTensor_(data)(input);
+  output_data = THTensor_(data)(output);
 
-#pragma omp parallel for private(p)
-    for (p=0; p < nBatch; p++)
-    {
-      THNN_(VolumetricAveragePooling_updateOutput_frame)(
-        input_data + p * istride, output_data + p * ostride, nslices,
-        itime, iwidth, iheight,
-        otime, owidth, oheight,
-        kT, kW, kH,
-        dT, dW, dH
-      );
-    }
+  /* volumes of all the samples are independent */
+#pragma omp parallel for private(k)
+  for (k = 0; k < nBatch * nslices; k++)
+  {
+    THNN_(VolumetricAveragePooling_updateOutput_frame)(
+      input_data + k * itime * iwidth * iheight,
+      output_data + k * otime * owidth * oheight,
+      itime, iwidth, iheight,
+      otime, owidth, oheight,
+      kT, kW, kH,
+      dT, dW, dH
+    );
   }
 
   /* cleanup */
@@ -224,7 +199,6 @@ void THNN_(VolumetricAveragePooling_updateOutput)(
 static void THNN_(VolumetricAveragePooling_updateGradInput_frame)(
           real *gradInput_p,
           real *gradOutput_p,
-          long nslices,
           long itime,
           long iwidth,
           long iheight,
@@ -238,37 +212,22 @@ static void THNN_(VolumetricAveragePooling_updateGradInput_frame)(
           int dW,
           int dH)
 {
-  long k;
-#pragma omp parallel for private(k)
-  for (k = 0; k < nslices; k++)
+  /* loop over output rows */
+  long i, ti;
+  for (ti = 0; ti < otime; ti++)
   {
-    /* loop over output */
-    long i, j, ti;
-    for (ti = 0; ti < otime; ti++)
+    for (i = 0; i < oheight; i++)
     {
-      for (i = 0; i < oheight; i++)
+      real *op = gradOutput_p + ti * owidth * oheight + i * owidth;
+      int y, z;
+
+      /* scatter gradients out to the input rows of the footprints: */
+      for (z = 0; z < kT; z++)
       {
-        for (j = 0; j < owidth; j++)
+        for (y = 0; y < kH; y++)
         {
-          /* local pointers */
-          real *ip = gradInput_p + k * itime * iwidth * iheight
-            + ti * iwidth * iheight * dT +  i * iwidth * dH + j * dW;
-          real *op = gradOutput_p + k * otime * owidth * oheight
-            + ti * owidth * oheight + i * owidth + j;
-
-          /* scatter gradients out to footprint: */
-          real val  = *op / (kT * kW * kH);
-          int x,y,z;
-          for (z=0; z < kT; z++)
-          {
-            for (y = 0; y < kH; y++)
-            {
-              for (x = 0; x < kW; x++)
-              {
-                *(ip + z * iwidth * iheight + y * iwidth + x) += val;
-              }
-            }
-          }
+          real *ip = gradInput_p + (ti * dT + z) * iwidth * iheight + (i * dH + y) * iwidth;
+          THNN_(pooling_scatterRow)(ip, iwidth, op, NULL, kT * kW * kH, owidth, kW, dW, 0);
         }
       }
     }
@@ -296,6 +255,8 @@ void THNN_(VolumetricAveragePooling_updateGradInput)(
   int owidth;
   real *gradInput_data;
   real *gradOutput_data;
+  long nBatch = 1;
+  long k;
 
   int dimN = 0;
   int dimt = 1;
@@ -310,8 +271,7 @@ void THNN_(VolumetricAveragePooling_updateGradInput)(
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
   /* resize */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   if (input->nDimension == 5)
   {
@@ -334,37 +294,22 @@ void THNN_(VolumetricAveragePooling_updateGradInput)(
   gradInput_data = THTensor_(data)(gradInput);
   gradOutput_data = THTensor_(data)(gradOutput);
 
-  /* backprop */
-  if (input->nDimension == 4) /* non-batch mode*/
+  /* backprop: the volumes of all the samples are independent */
+  if (input->nDimension == 5)
+    nBatch = input->size[0];
+
+#pragma omp parallel for private(k)
+  for (k = 0; k < nBatch * nslices; k++)
   {
     THNN_(VolumetricAveragePooling_updateGradInput_frame)(
-      gradInput_data, gradOutput_data, nslices,
+      gradInput_data + k * itime * iwidth * iheight,
+      gradOutput_data + k * otime * owidth * oheight,
       itime, iwidth, iheight,
       otime, owidth, oheight,
       kT, kW, kH,
       dT, dW, dH
     );
   }
-  else /* batch mode */
-  {
-    long p;
-    long nBatch = input->size[0];
-
-    long istride = nslices * itime * iwidth * iheight;
-    long ostride = nslices * otime * owidth * oheight;
-
-#pragma omp parallel for private(p)
-    for (p = 0; p < nBatch; p++)
-    {
-      THNN_(VolumetricAveragePooling_updateGradInput_frame)(
-        gradInput_data  + p * istride, gradOutput_data + p * ostride, nslices,
-        itime, iwidth, iheight,
-        otime, owidth, oheight,
-        kT, kW, kH,
-        dT, dW, dH
-      );
-    }
-  }
 
   /* cleanup */
   THTensor_(free)(gradOutput);
@@ -2,13 +2,66 @@
 #define TH_GENERIC_FILE "generic/VolumetricConvolution.c"
 #else
 
+static inline void THNN_(VolumetricConvolution_shapeCheck)(
+                         THTensor *input,
+                         THTensor *gradOutput,
+                         THTensor *weight,
+                         int dT, int dW, int dH,
+                         int pT, int pW, int pH)
+{
+  THNN_ARGCHECK(input->nDimension == 4 || input->nDimension == 5, 2, input,
+		"4D or 5D (batch mode) tensor expected for input, but got: %s");
+  THNN_ARGCHECK(weight->nDimension == 5, 4, weight,
+		"5D (nOutputPlane x nInputPlane x kT x kH x kW) tensor "
+		"expected for weight, but got: %s");
+  THArgCheck(dT > 0 && dW > 0 && dH > 0, 8,
+             "stride should be greater than zero, but got dT: %d dH: %d dW: %d", dT, dH, dW);
+  THArgCheck(pT >= 0 && pW >= 0 && pH >= 0, 11,
+             "padding should not be negative, but got pT: %d pH: %d pW: %d", pT, pH, pW);
+
+  int ndim = input->nDimension;
+  int dimf = ndim == 5 ? 1 : 0;
+  long nOutputPlane = weight->size[0];
+  long outputDepth  = (input->size[dimf+1] + 2*pT - weight->size[2]) / dT + 1;
+  long outputHeight = (input->size[dimf+2] + 2*pH - weight->size[3]) / dH + 1;
+  long outputWidth  = (input->size[dimf+3] + 2*pW - weight->size[4]) / dW + 1;
+
+  if (outputDepth < 1 || outputHeight < 1 || outputWidth < 1)
+    THError("Given input size: (%ldx%ldx%ldx%ld). Calculated output size: (%ldx%ldx%ldx%ld). Output size is too small",
+            input->size[dimf], input->size[dimf+1], input->size[dimf+2], input->size[dimf+3],
+            nOutputPlane, outputDepth, outputHeight, outputWidth);
+
+  THNN_CHECK_DIM_SIZE(input, ndim, dimf, weight->size[1]);
+  if (gradOutput != NULL) {
+    THNN_CHECK_DIM_SIZE(gradOutput, ndim, dimf, nOutputPlane);
+    THNN_CHECK_DIM_SIZE(gradOutput, ndim, dimf+1, outputDepth);
+    THNN_CHECK_DIM_SIZE(gradOutput, ndim, dimf+2, outputHeight);
+    THNN_CHECK_DIM_SIZE(gradOutput, ndim, dimf+3, outputWidth);
+  }
+}
+
+/* Geometry of the columns of one frame of input. */
+static void THNN_(VolumetricConvolution_columns)(
+          THNN_(VolumetricColumns) *g,
+          THTensor *input,
+          THTensor *weight,
+          int dT, int dW, int dH,
+          int pT, int pW, int pH)
+{
+  int dimf = input->nDimension == 5 ? 1 : 0;
+  THNN_(VolumetricColumns_init)(
+    g, input->size[dimf], input->size[dimf+1], input->size[dimf+2], input->size[dimf+3],
+    weight->size[2], weight->size[3], weight->size[4],
+    pT, pH, pW, dT, dH, dW, 1, 1, 1);
+}
+
 void THNN_(VolumetricConvolution_updateOutput)(
           THNNState *state,
           THTensor *input,
           THTensor *output,
           THTensor *weight,
           THTensor *bias,
-          THTensor *finput,     // only used by cuda impl
+          THTensor *finput,     // column buffer
           THTensor *fgradInput, // only used by cuda impl
           int dT,
           int dW,
@@ -17,84 +70,37 @@ void THNN_(VolumetricConvolution_updateOutput)(
           int pW,
           int pH)
 {
-  THArgCheck(pT != 0 || pW != 0 || pH != 0, 9, "padding not supported by CPU backend");   // sharing signature with CUDA version
-
-  THNN_ARGCHECK(input->nDimension == 4 || input->nDimension == 5, 2, input,
-		"4D or 5D (batch mode) tensor expected for input, but got: %s");
+  THNN_(VolumetricColumns) g;
+  long nOutputPlane = weight->size[0];
+  long batchSize;
 
-  int dimt = 1;
-  int dimh = 2;
-  int dimw = 3;
+  THNN_(VolumetricConvolution_shapeCheck)(input, NULL, weight, dT, dW, dH, pT, pW, pH);
+  if (bias)
+    THNN_CHECK_DIM_SIZE(bias, 1, 0, nOutputPlane);
+  input = THTensor_(newContiguous)(input);
+  weight = THTensor_(newContiguous)(weight);
+  bias = bias ? THTensor_(newContiguous)(bias) : NULL;
 
-  if (input->nDimension == 5)
-  {
-    dimt++;
-    dimh++;
-    dimw++;
-  }
+  THNN_(VolumetricConvolution_columns)(&g, input, weight, dT, dW, dH, pT, pW, pH);
+  batchSize = input->nDimension == 5 ? input->size[0] : 1;
 
-  long nOutputPlane = weight->size[0];
-  long kT           = weight->size[2];
-  long kH           = weight->size[3];
-  long kW           = weight->size[4];
-  long inputDepth   = input->size[dimt];
-  long inputHeight  = input->size[dimh];
-  long inputWidth   = input->size[dimw];
-  long outputDepth  = (inputDepth - kT) / dT + 1;
-  long outputWidth  = (inputWidth - kW) / dW + 1;
-  long outputHeight = (inputHeight - kH) / dH + 1;
-  THTensor *outn = THTensor_(new)();
-  long i, j;
   if (input->nDimension == 4) /* non-batch mode */
-  {
-    THTensor_(resize4d)(output, nOutputPlane, outputDepth, outputHeight, outputWidth);
-
-    /* add bias */
-    if (bias) {
-      for (i = 0; i < bias->size[0]; i++)
-      {
-        THTensor_(select)(outn, output, 0, i);
-        THTensor_(fill)(outn, THTensor_(get1d)(bias, i));
-      }
-    } else {
-      THTensor_(zero)(output);
-    }
-
-    /* do convolutions */
-    THTensor_(conv3Dmv)(output, 1.0, 1.0, input, weight, dT, dH, dW, "V", "X");
-  }
+    THTensor_(resize4d)(output, nOutputPlane, g.depth_col, g.height_col, g.width_col);
   else /* batch mode */
-  {
-    long nBatch = input->size[0];
-    THTensor_(resize5d)(output, nBatch, nOutputPlane, outputDepth, outputHeight, outputWidth);
-    THTensor *inb = THTensor_(new)();
-    THTensor *outb = THTensor_(new)();
-
-    /* loop over batches */
-    for (j = 0; j < nBatch; j++)
-    {
-      THTensor_(select)(inb, input, 0, j);
-      THTensor_(select)(outb, output, 0, j);
-
-      /* add bias */
-      if (bias) {
-        for (i = 0; i < bias->size[0]; i++)
-        {
-          THTensor_(select)(outn, outb, 0, i);
-          THTensor_(fill)(outn, THTensor_(get1d)(bias, i));
-        }
-      } else {
-        THTensor_(zero)(outb);
-      }
-
-      /* do convolutions */
-      THTensor_(conv3Dmv)(outb, 1.0, 1.0, inb, weight, dT, dH, dW, "V", "X");
-    }
-
-    THTensor_(free)(inb);
-    THTensor_(free)(outb);
-  }
-  THTensor_(free)(outn);
+    THTensor_(resize5d)(output, batchSize, nOutputPlane, g.depth_col, g.height_col, g.width_col);
+
+  THNN_(VolumetricColumns_unfoldMultiply)(
+    &g, batchSize,
+    THTensor_(data)(input), g.channels * g.depth * g.height * g.width,
+    THTensor_(data)(weight), nOutputPlane,
+    bias ? THTensor_(data)(bias) : NULL,
+    THTensor_(data)(output), nOutputPlane * g.depth_col * g.height_col * g.width_col,
+    finput);
+
+  THTensor_(free)(input);
+  THTensor_(free)(weight);
+  if (bias)
+    THTensor_(free)(bias);
 }
 
 void THNN_(VolumetricConvolution_updateGradInput)(
@@ -103,7 +109,7 @@ void THNN_(VolumetricConvolution_updateGradInput)(
           THTensor *gradOutput,
           THTensor *gradInput,
           THTensor *weight,
-          THTensor *finput, // only used by cuda impl
+          THTensor *finput, // column buffer
           int dT,
           int dW,
           int dH,
@@ -111,57 +117,30 @@ void THNN_(VolumetricConvolution_updateGradInput)(
           int pW,
           int pH)
 {
-  THArgCheck(pT != 0 || pW != 0 || pH != 0, 9, "padding not supported by CPU backend");   // sharing signature with CUDA version
-
-  THNN_ARGCHECK(weight->nDimension == 5, 4, weight,
-		"5D (nOutputPlane x nInputPlane x kT x kH x kW) tensor "
-		"expected for weight, but got: %s");
-
-  int nOutputPlane = (int)weight->size[0];
+  THNN_(VolumetricColumns) g;
+  long nOutputPlane = weight->size[0];
+  long batchSize;
 
-  THNN_ARGCHECK(gradOutput->nDimension == 4 || gradOutput->nDimension == 5, 3,
-		gradOutput,
-		"4D or 5D (batch mode) tensor expected for gradOutput, but got: %s");
+  THNN_(VolumetricConvolution_shapeCheck)(input, gradOutput, weight, dT, dW, dH, pT, pW, pH);
+  input = THTensor_(newContiguous)(input);
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  weight = THTensor_(newContiguous)(weight);
 
-  int dimPlane = 0;
-  if (gradOutput->nDimension == 5)
-  {
-    dimPlane++;
-  }
-
-  THArgCheck(nOutputPlane == gradOutput->size[dimPlane], 1,
-    "Number of output features is not equal to nOutputPlane"
-  );
+  THNN_(VolumetricConvolution_columns)(&g, input, weight, dT, dW, dH, pT, pW, pH);
+  batchSize = input->nDimension == 5 ? input->size[0] : 1;
 
   /* gradient to input */
-  THTensor *tweight = THTensor_(newTranspose)(weight, 0, 1);
-  if (gradOutput->nDimension == 4) /* non-batch mode */
-  {
-    THTensor_(conv3Dmv)(gradInput, 0.0, 1.0, gradOutput, tweight, dT, dH, dW, "F", "C");
-  }
-  else /* batch mode */
-  {
-    long nBatch = gradOutput->size[0];
-    THTensor *ginpb = THTensor_(new)();
-    THTensor *goutb = THTensor_(new)();
-    long j;
-
-    THTensor_(resize5d)(gradInput,
-      input->size[0], input->size[1], input->size[2], input->size[3], input->size[4]
-    );
-
-    /* loop over batches */
-    for (j = 0; j < nBatch; j++)
-    {
-      THTensor_(select)(ginpb, gradInput, 0, j);
-      THTensor_(select)(goutb, gradOutput, 0, j);
-      THTensor_(conv3Dmv)(ginpb, 0.0, 1.0, goutb, tweight, dT, dH, dW, "F", "C");
-    }
-    THTensor_(free)(ginpb);
-    THTensor_(free)(goutb);
-  }
-
-  THTensor_(free)(tweight);
+  THTensor_(resizeAs)(gradInput, input);
+  THNN_(VolumetricColumns_multiplyFold)(
+    &g, batchSize,
+    THTensor_(data)(gradOutput), nOutputPlane * g.depth_col * g.height_col * g.width_col,
+    THTensor_(data)(weight), nOutputPlane,
+    THTensor_(data)(gradInput), g.channels * g.depth * g.height * g.width,
+    finput);
+
+  THTensor_(free)(input);
+  THTensor_(free)(gradOutput);
+  THTensor_(free)(weight);
 }
 
 void THNN_(VolumetricConvolution_accGradParameters)(
@@ -170,7 +149,7 @@ void THNN_(VolumetricConvolution_accGradParameters)(
           THTensor *gradOutput,
           THTensor *gradWeight,
           THTensor *gradBias,
-          THTensor *finput,     // only used by cuda impl
+          THTensor *finput,     // column buffer
           THTensor *fgradInput, // only used by cuda impl
           int dT,
           int dW,
@@ -181,80 +160,41 @@ void THNN_(VolumetricConvolution_accGradParameters)(
           accreal scale_)
 {
   real scale = TH_CONVERT_ACCREAL_TO_REAL(scale_);
-  THArgCheck(pT != 0 || pW != 0 || pH != 0, 9, "padding not supported by CPU backend");   // sharing signature with CUDA version
-
-  THNN_ARGCHECK(gradWeight->nDimension == 5, 4, gradWeight,
-		"5D (nOutputPlane x nInputPlane x kT x kH x kW) tensor "
-		"expected for gradWeight, but got: %s");
+  THNN_(VolumetricColumns) g;
+  long nOutputPlane = gradWeight->size[0];
+  long outputSize, batchSize;
 
-  int nOutputPlane = (int)gradWeight->size[0];
+  THNN_(VolumetricConvolution_shapeCheck)(input, gradOutput, gradWeight, dT, dW, dH, pT, pW, pH);
+  THArgCheck(THTensor_(isContiguous)(gradWeight), 4, "gradWeight needs to be contiguous");
   if (gradBias) {
     THArgCheck(gradBias->nDimension == 1 && gradBias->size[0] == nOutputPlane, 5,
       "gradBias tensor has wrong size"
     );
+    THArgCheck(THTensor_(isContiguous)(gradBias), 5, "gradBias needs to be contiguous");
   }
-
-  long k;
-  real *gradBias_data;
-  THTensor *gradOutSlice;
-  int dimPlane = 0;
-  if (gradOutput->nDimension == 5)
-  {
-    dimPlane++;
-  }
-
-  THArgCheck(nOutputPlane == gradOutput->size[dimPlane], 1,
-    "Number of output features is not equal to nOutputPlane"
-  );
-
-  if (gradOutput->nDimension == 4) /* non-batch mode */
-  {
-    /* gradient to bias */
-    if (gradBias) {
-      gradBias_data = THTensor_(data)(gradBias);
-      gradOutSlice = THTensor_(new)();
-      for (k = 0; k < nOutputPlane; k++)
-      {
-        THTensor_(select)(gradOutSlice, gradOutput, 0, k);
-        gradBias_data[k] += scale * THTensor_(sumall)(gradOutSlice);
-      }
-      THTensor_(free)(gradOutSlice);
-    }
-
-    /* gradient to kernels */
-    THTensor_(conv3DRevger)(gradWeight, 1.0, scale, input, gradOutput, dT, dH, dW);
-  }
-  else /* batch mode */
-  {
-    long nBatch = gradOutput->size[0];
-    THTensor *inpb = THTensor_(new)();
-    THTensor *goutb = THTensor_(new)();
-    long j;
-
-    /* loop over batches */
-    for (j = 0; j < nBatch; j++)
-    {
-      THTensor_(select)(inpb, input, 0, j);
-      THTensor_(select)(goutb, gradOutput, 0, j);
-
-      /* gradient to bias */
-      if (gradBias) {
-        gradBias_data = THTensor_(data)(gradBias);
-        gradOutSlice = THTensor_(new)();
-        for (k = 0; k < nOutputPlane; k++)
-        {
-          THTensor_(select)(gradOutSlice, goutb, 0, k);
-          gradBias_data[k] += scale * THTensor_(sumall)(gradOutSlice);
-        }
-        THTensor_(free)(gradOutSlice);
-      }
-
-      /* gradient to kernels */
-      THTensor_(conv3DRevger)(gradWeight, 1.0, scale, inpb, goutb, dT, dH, dW);
-    }
-    THTensor_(free)(inpb);
-    THTensor_(free)(goutb);
-  }
+  input = THTensor_(newContiguous)(input);
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+
+  THNN_(VolumetricConvolution_columns)(&g, input, gradWeight, dT, dW, dH, pT, pW, pH);
+  batchSize = input->nDimension == 5 ? input->size[0] : 1;
+  outputSize = g.depth_col * g.height_col * g.width_col;
+
+  /* gradient to kernels */
+  THNN_(VolumetricColumns_accumulateOuter)(
+    &g, batchSize,
+    THTensor_(data)(gradOutput), nOutputPlane * outputSize,
+    THTensor_(data)(input), g.channels * g.depth * g.height * g.width,
+    THTensor_(data)(gradWeight), nOutputPlane, scale,
+    finput);
+
+  /* gradient to bias */
+  if (gradBias)
+    THNN_(VolumetricColumns_planeSums)(
+      THTensor_(data)(gradOutput), batchSize, nOutputPlane * outputSize,
+      nOutputPlane, outputSize, THTensor_(data)(gradBias), scale);
+
+  THTensor_(free)(input);
+  THTensor_(free)(gradOutput);
 }
 
 #endif
@@ -97,11 +97,14 @@ static inline void THNN_(VolumetricDilatedMaxPooling_shapeCheck)(
   }
 }
 
+/* Max pooling of one volume. Without dilation the windows are folded one
+ * input row at a time, with the tap offsets mz, my, mx packed as
+ * mz << 16 | my << 8 | mx until they are split into the bytes of the index.
+ * indz_p may be NULL in inference mode. */
 static void THNN_(VolumetricDilatedMaxPooling_updateOutput_frame)(
           real *input_p,
           real *output_p,
           THIndex_t *indz_p,
-          long nslices,
           long itime,
           long iwidth,
           long iheight,
@@ -121,79 +124,122 @@ static void THNN_(VolumetricDilatedMaxPooling_updateOutput_frame)(
           int dilationW,
           int dilationH)
 {
-  long k;
-#pragma omp parallel for private(k)
-  for (k = 0; k < nslices; k++)
+  long i, j, ti;
+
+  if (dilationT == 1 && dilationW == 1 && dilationH == 1)
   {
-    /* loop over output */
-    long i, j, ti;
     for (ti = 0; ti < otime; ti++)
     {
+      long start_t = ti * dT - pT;
+      long end_t = start_t + kT < itime ? start_t + kT : itime;
       for (i = 0; i < oheight; i++)
       {
+        long start_h = i * dH - pH;
+        long end_h = start_h + kH < iheight ? start_h + kH : iheight;
+        real *op = output_p + ti * owidth * oheight + i * owidth;
+        THIndex_t *indzp = indz_p ? indz_p + ti * owidth * oheight + i * owidth : NULL;
+        long z, y;
+
         for (j = 0; j < owidth; j++)
         {
-          /* local pointers */
-
-          long start_t = ti * dT - pT;
-          long start_h = i * dH - pH;
-          long start_w = j * dW - pW;
-
-          long kernel_t = fminf(kT, kT + start_t);
-          long kernel_h = fminf(kH, kH + start_h);
-          long kernel_w = fminf(kW, kW + start_w);
-
-          while(start_t < 0)
-            start_t += dilationT;
-          while(start_h < 0)
-            start_h += dilationH;
-          while(start_w < 0)
-            start_w += dilationW;
-
-          real *ip = input_p + k * itime * iwidth * iheight
-            + start_t * iwidth * iheight + start_h * iwidth + start_w;
-          real *op = output_p + k * otime * owidth * oheight
-            + ti * owidth * oheight + i * owidth + j;
-          THIndex_t *indzp = indz_p + k * otime * owidth * oheight
-            + ti * owidth * oheight + i * owidth + j;
-
-	  /* compute local max: */
-	  real maxval = -THInf;
-	  int x,y,z;
-	  int mx, my, mz;
-	  mx = my = mz = -1;
-
-          for (z = 0; z < kernel_t; z++)
+          op[j] = -THInf;
+          if (indzp)
+            indzp[j] = -1;
+        }
+        for (z = start_t > 0 ? start_t : 0; z < end_t; z++)
+        {
+          for (y = start_h > 0 ? start_h : 0; y < end_h; y++)
+          {
+            THNN_(pooling_maxRow)(input_p + z * iwidth * iheight + y * iwidth, iwidth,
+                                  op, indzp, owidth, kW, dW, pW, 1,
+                                  (z - start_t) << 16 | (y - start_h) << 8, 0, 1);
+          }
+        }
+
+        if (indzp)
+        {
+          for (j = 0; j < owidth; j++)
+          {
+            THIndex_t packed = indzp[j];
+            unsigned char *bytes = (unsigned char*)(indzp + j);
+            indzp[j] = 0;
+            bytes[0] = packed < 0 ? 255 : packed >> 16;
+            bytes[1] = packed < 0 ? 255 : (packed >> 8) & 255;
+            bytes[2] = packed < 0 ? 255 : packed & 255;
+          }
+        }
+      }
+    }
+    return;
+  }
+
+  /* loop over output */
+  for (ti = 0; ti < otime; ti++)
+  {
+    for (i = 0; i < oheight; i++)
+    {
+      for (j = 0; j < owidth; j++)
+      {
+        /* local pointers */
+
+        long start_t = ti * dT - pT;
+        long start_h = i * dH - pH;
+        long start_w = j * dW - pW;
+
+        long kernel_t = fminf(kT, kT + start_t);
+        long kernel_h = fminf(kH, kH + start_h);
+        long kernel_w = fminf(kW, kW + start_w);
+
+        while(start_t < 0)
+          start_t += dilationT;
+        while(start_h < 0)
+          start_h += dilationH;
+        while(start_w < 0)
+          start_w += dilationW;
+
+        real *ip = input_p + start_t * iwidth * iheight + start_h * iwidth + start_w;
+        real *op = output_p + ti * owidth * oheight + i * owidth + j;
+
+        /* compute local max: */
+        real maxval = -THInf;
+        int x,y,z;
+        int mx, my, mz;
+        mx = my = mz = -1;
+
+        for (z = 0; z < kernel_t; z++)
+        {
+          for (y = 0; y < kernel_h; y++)
           {
-            for (y = 0; y < kernel_h; y++)
+            for (x = 0; x < kernel_w; x++)
             {
-              for (x = 0; x < kernel_w; x++)
+              if ((start_t + z * dilationT < itime) && (start_h + y * dilationH < iheight) && (start_w + x * dilationW < iwidth))
               {
-                if ((start_t + z * dilationT < itime) && (start_h + y * dilationH < iheight) && (start_w + x * dilationW < iwidth))
+                real val = *(ip + z * dilationT * iwidth * iheight + y * dilationH * iwidth + x * dilationW);
+                if (val > maxval)
                 {
-                  real val = *(ip + z * dilationT * iwidth * iheight + y * dilationH * iwidth + x * dilationW);
-                  if (val > maxval)
-                  {
-                    maxval = val;
-                    // Store indices w.r.t the kernel dimension
-                    mz = z + (kT - kernel_t);
-                    my = y + (kH - kernel_h);
-                    mx = x + (kW - kernel_w);
-                  }
+                  maxval = val;
+                  // Store indices w.r.t the kernel dimension
+                  mz = z + (kT - kernel_t);
+                  my = y + (kH - kernel_h);
+                  mx = x + (kW - kernel_w);
                 }
               }
             }
           }
+        }
 
-          // set max values
+        // set max values
+        if (indz_p)
+        {
+          THIndex_t *indzp = indz_p + ti * owidth * oheight + i * owidth + j;
           ((unsigned char*)(indzp))[0] = mz;
           ((unsigned char*)(indzp))[1] = my;
           ((unsigned char*)(indzp))[2] = mx;
           ((unsigned char*)(indzp))[3] = 0;
-
-          /* set output to local max */
-          *op = maxval;
         }
+
+        /* set output to local max */
+        *op = maxval;
       }
     }
   }
@@ -228,7 +274,8 @@ void THNN_(VolumetricDilatedMaxPooling_updateOutput)(
   real *input_data;
   real *output_data;
   THIndex_t *indices_data;
-
+  long nBatch = 1;
+  long k;
 
   int dimN = 0;
   int dimt = 1;
@@ -286,16 +333,35 @@ void THNN_(VolumetricDilatedMaxPooling_updateOutput)(
     /* resize output */
     THTensor_(resize4d)(output, nslices, otime, oheight, owidth);
     /* indices will contain ti,i,j uchar locations packed into float/double */
-    THIndexTensor_(resize4d)(indices, nslices, otime, oheight, owidth);
+    if (indices)
+      THIndexTensor_(resize4d)(indices, nslices, otime, oheight, owidth);
+  }
+  else /* batch mode */
+  {
+    nBatch = input->size[0];
+
+    /* resize output */
+    THTensor_(resize5d)(output, nBatch, nslices, otime, oheight, owidth);
+    /* indices will contain ti,i,j locations for each output point */
+    if (indices)
+      THIndexTensor_(resize5d)(indices, nBatch, nslices, otime, oheight, owidth);
+  }
 
-    input_data = THTensor_(data)(input);
-    output_data = THTensor_(data)(output);
-    indices_data = THIndexTensor_(data)(indices);
+  input_data = THTensor_(data)(input);
+  output_data = THTensor_(data)(output);
+  indices_data = indices ? THIndexTensor_(data)(indices) : NULL;
+
+  /* volumes of all the samples are independent */
+#pragma omp parallel for private(k)
+  for (k = 0; k < nBatch * nslices; k++)
+  {
+    long istride = itime * iwidth * iheight;
+    long ostride = otime * owidth * oheight;
 
     THNN_(VolumetricDilatedMaxPooling_updateOutput_frame)(
-      input_data, output_data,
-      indices_data,
-      nslices,
+      input_data   + k * istride,
+      output_data  + k * ostride,
+      indices_data ? indices_data + k * ostride : NULL,
       itime, iwidth, iheight,
       otime, owidth, oheight,
       kT, kW, kH,
@@ -304,40 +370,6 @@ void THNN_(VolumetricDilatedMaxPooling_updateOutput)(
       dilationT, dilationW, dilationH
     );
   }
-  else /* batch mode */
-  {
-    long p;
-    long nBatch = input->size[0];
-
-    long istride = nslices * itime * iwidth * iheight;
-    long ostride = nslices * otime * owidth * oheight;
-
-    /* resize output */
-    THTensor_(resize5d)(output, nBatch, nslices, otime, oheight, owidth);
-    /* indices will contain ti,i,j locations for each output point */
-    THIndexTensor_(resize5d)(indices, nBatch, nslices, otime, oheight, owidth);
-
-    input_data = THTensor_(data)(input);
-    output_data = THTensor_(data)(output);
-    indices_data = THIndexTensor_(data)(indices);
-
-#pragma omp parallel for private(p)
-    for (p=0; p < nBatch; p++)
-    {
-      THNN_(VolumetricDilatedMaxPooling_updateOutput_frame)(
-        input_data   + p * istride,
-        output_data  + p * ostride,
-        indices_data + p * ostride,
-        nslices,
-        itime, iwidth, iheight,
-        otime, owidth, oheight,
-        kT, kW, kH,
-        dT, dW, dH,
-        pT, pW, pH,
-        dilationT, dilationW, dilationH
-      );
-    }
-  }
 
   /* cleanup */
   THTensor_(free)(input);
@@ -347,7 +379,6 @@ static void THNN_(VolumetricDilatedMaxPooling_updateGradInput_frame)(
           real *gradInput_p,
           real *gradOutput_p,
           THIndex_t *indz_p,
-          long nslices,
           long itime,
           long iwidth,
           long iheight,
@@ -364,39 +395,78 @@ static void THNN_(VolumetricDilatedMaxPooling_updateGradInput_frame)(
           int dilationW,
           int dilationH)
 {
-  long k;
-#pragma omp parallel for private(k)
-  for (k = 0; k < nslices; k++)
+  /* calculate max points */
+  long ti, i, j;
+  for (ti = 0; ti < otime; ti++)
   {
-    real *gradInput_p_k  = gradInput_p  + k * itime * iwidth * iheight;
-    real *gradOutput_p_k = gradOutput_p + k * otime * owidth * oheight;
-    THIndex_t *indz_p_k = indz_p + k * otime * owidth * oheight;
-
-    /* calculate max points */
-    long ti, i, j;
-    for (ti = 0; ti < otime; ti++)
+    for (i = 0; i < oheight; i++)
     {
-      for (i = 0; i < oheight; i++)
+      for (j = 0; j < owidth; j++)
       {
-        for (j = 0; j < owidth; j++)
-        {
-          /* retrieve position of max */
-          THIndex_t * indzp = &indz_p_k[ti * oheight * owidth + i * owidth + j];
-          long maxti = ((unsigned char*)(indzp))[0] * dilationT + ti * dT - pT;
-          long maxi  = ((unsigned char*)(indzp))[1] * dilationH + i * dH - pH;
-          long maxj  = ((unsigned char*)(indzp))[2] * dilationW + j * dW - pW;
-
-	  if (maxti != -1) {
-	    /* update gradient */
-	    gradInput_p_k[maxti * iheight * iwidth + maxi * iwidth + maxj] +=
-	      gradOutput_p_k[ti * oheight * owidth + i * owidth + j];
-	  }
-        }
+        /* retrieve position of max, skipping windows without one */
+        unsigned char *indzp = (unsigned char*)&indz_p[ti * oheight * owidth + i * owidth + j];
+        if (indzp[0] == 255)
+          continue;
+        long maxti = indzp[0] * dilationT + ti * dT - pT;
+        long maxi  = indzp[1] * dilationH + i * dH - pH;
+        long maxj  = indzp[2] * dilationW + j * dW - pW;
+
+        /* update gradient */
+        gradInput_p[maxti * iheight * iwidth + maxi * iwidth + maxj] +=
+          gradOutput_p[ti * oheight * owidth + i * owidth + j];
       }
     }
   }
 }
 
+/* Gradient of the input row (t, y) of a volume, from the output rows whose
+ * window has a tap on it. The indices are packed as mz << 16 | my << 8 | mx,
+ * -1 without a maximum, as the forward pass folds them. */
+static void THNN_(VolumetricDilatedMaxPooling_updateGradInput_row)(
+          real *gradInput_p,
+          real *gradOutput_p,
+          THIndex_t *packed_p,
+          long t,
+          long y,
+          long iwidth,
+          long iheight,
+          long otime,
+          long owidth,
+          long oheight,
+          int kT,
+          int kW,
+          int kH,
+          int dT,
+          int dW,
+          int dH,
+          int pT,
+          int pW,
+          int pH,
+          int dilationT,
+          int dilationW,
+          int dilationH)
+{
+  int mz, my;
+  for (mz = 0; mz < kT; mz++)
+  {
+    long st = t + pT - (long)mz * dilationT;
+    long ti = st / dT;
+    if (st < 0 || st % dT != 0 || ti >= otime)
+      continue;
+    for (my = 0; my < kH; my++)
+    {
+      long sh = y + pH - (long)my * dilationH;
+      long i = sh / dH;
+      long o = (ti * oheight + i) * owidth;
+      if (sh < 0 || sh % dH != 0 || i >= oheight)
+        continue;
+      THNN_(pooling_maxGradRow)(gradInput_p + (t * iheight + y) * iwidth, iwidth,
+                                gradOutput_p + o, packed_p + o, owidth,
+                                kW, dW, pW, dilationW, mz << 16 | my << 8, 0, 1);
+    }
+  }
+}
+
 void THNN_(VolumetricDilatedMaxPooling_updateGradInput)(
           THNNState *state,
           THTensor *input,
@@ -427,12 +497,17 @@ void THNN_(VolumetricDilatedMaxPooling_updateGradInput)(
   real *gradInput_data;
   real *gradOutput_data;
   THIndex_t *indices_data;
+  THIndex_t *packed;
+  long nBatch = 1;
+  long k, n;
+  int gather = 0;
 
   int dimN = 0;
   int dimt = 1;
   int dimh = 2;
   int dimw = 3;
 
+  THArgCheck(indices != NULL, 5, "indices of the forward pass are required");
   THNN_(VolumetricDilatedMaxPooling_shapeCheck)(
         state, input, gradOutput, indices,
         kT,  kW,  kH, dT,  dW,  dH,
@@ -444,8 +519,7 @@ void THNN_(VolumetricDilatedMaxPooling_updateGradInput)(
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
   /* resize */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   if (input->nDimension == 5)
   {
@@ -469,36 +543,27 @@ void THNN_(VolumetricDilatedMaxPooling_updateGradInput)(
   gradOutput_data = THTensor_(data)(gradOutput);
   indices_data = THIndexTensor_(data)(indices);
 
-  /* backprop */
-  if (input->nDimension == 4) /* non-batch mode*/
-  {
-    THNN_(VolumetricDilatedMaxPooling_updateGradInput_frame)(
-      gradInput_data, gradOutput_data,
-      indices_data,
-      nslices,
-      itime, iwidth, iheight,
-      otime, owidth, oheight,
-      dT, dW, dH,
-      pT, pW, pH,
-      dilationT, dilationW, dilationH
-    );
-  }
-  else /* batch mode */
-  {
-    long p;
-    long nBatch = input->size[0];
-
-    long istride = nslices * itime * iwidth * iheight;
-    long ostride = nslices * otime * owidth * oheight;
+  if (input->nDimension == 5)
+    nBatch = input->size[0];
 
-#pragma omp parallel for private(p)
-    for (p = 0; p < nBatch; p++)
+  /* backprop: the volumes of all the samples are independent; when they
+     are too few to keep the threads busy, the rows of a volume are, if
+     each gathers its gradient from the outputs instead */
+#ifdef _OPENMP
+  gather = nBatch * nslices < omp_get_max_threads();
+#endif
+  if (!gather)
+  {
+#pragma omp parallel for private(k)
+    for (k = 0; k < nBatch * nslices; k++)
     {
+      long istride = itime * iwidth * iheight;
+      long ostride = otime * owidth * oheight;
+
       THNN_(VolumetricDilatedMaxPooling_updateGradInput_frame)(
-        gradInput_data + p * istride,
-        gradOutput_data + p * ostride,
-        indices_data + p * ostride,
-        nslices,
+        gradInput_data + k * istride,
+        gradOutput_data + k * ostride,
+        indices_data + k * ostride,
         itime, iwidth, iheight,
         otime, owidth, oheight,
         dT, dW, dH,
@@ -506,7 +571,41 @@ void THNN_(VolumetricDilatedMaxPooling_updateGradInput)(
         dilationT, dilationW, dilationH
       );
     }
+    THTensor_(free)(gradOutput);
+    return;
+  }
+
+  /* the three bytes of each index, packed back into one number */
+  n = nBatch * nslices * otime * oheight * owidth;
+  packed = THAlloc(sizeof(THIndex_t) * n);
+#pragma omp parallel for private(k)
+  for (k = 0; k < n; k++)
+  {
+    unsigned char *bytes = (unsigned char*)(indices_data + k);
+    packed[k] = bytes[0] == 255 ? -1 : bytes[0] << 16 | bytes[1] << 8 | bytes[2];
+  }
+
+#pragma omp parallel for private(k)
+  for (k = 0; k < nBatch * nslices * itime * iheight; k++)
+  {
+    long volume = k / (itime * iheight);
+    long row = k % (itime * iheight);
+    long ostride = otime * owidth * oheight;
+
+    THNN_(VolumetricDilatedMaxPooling_updateGradInput_row)(
+      gradInput_data + volume * itime * iwidth * iheight,
+      gradOutput_data + volume * ostride,
+      packed + volume * ostride,
+      row / iheight, row % iheight,
+      iwidth, iheight,
+      otime, owidth, oheight,
+      kT, kW, kH,
+      dT, dW, dH,
+      pT, pW, pH,
+      dilationT, dilationW, dilationH
+    );
   }
+  THFree(packed);
 
   /* cleanup */
   THTensor_(free)(gradOutput);
@@ -2,89 +2,6 @@
 #define TH_GENERIC_FILE "generic/VolumetricFullConvolution.c"
 #else
 
-static void THNN_(vol2col)(
-  const real *data_vol, const int channels,
-  const int depth, const int height, const int width,
-  const int kT, const int kH, const int kW,
-  const int pT, const int pH, const int pW,
-  const int dT, const int dH, const int dW,
-  const int dilationT, const int dilationH, const int dilationW,
-  real *data_col)
-{
-  int c, t, h, w;
-  int depth_col  = (depth  + 2 * pT - (dilationT * (kT - 1) + 1)) / dT + 1;
-  int height_col = (height + 2 * pH - (dilationH * (kH - 1) + 1)) / dH + 1;
-  int width_col  = (width  + 2 * pW - (dilationW * (kW - 1) + 1)) / dW + 1;
-  int channels_col = channels * kT * kH * kW;
-  for (c = 0; c < channels_col; ++c)
-  {
-    int w_offset = c % kW;
-    int h_offset = (c / kW) % kH;
-    int t_offset = (c / kW / kH) % kT;
-    int c_vol = c / kT / kH / kW;
-    for (t = 0; t < depth_col; ++t)
-    {
-      for (h = 0; h < height_col; ++h)
-      {
-        for (w = 0; w < width_col; ++w)
-        {
-          int t_pad = t * dT - pT + t_offset * dilationT;
-          int h_pad = h * dH - pH + h_offset * dilationH;
-          int w_pad = w * dW - pW + w_offset * dilationW;
-          if (t_pad >= 0 && t_pad < depth &&
-              h_pad >= 0 && h_pad < height &&
-              w_pad >= 0 && w_pad < width)
-            data_col[((c * depth_col + t) * height_col + h) * width_col + w] =
-              data_vol[((c_vol * depth + t_pad) * height + h_pad) * width + w_pad];
-          else
-            data_col[((c * depth_col + t) * height_col + h) * width_col + w] = 0;
-        }
-      }
-    }
-  }
-}
-
-static void THNN_(col2vol)(
-  const real* data_col, const int channels,
-  const int depth, const int height, const int width,
-  const int kT, const int kH, const int kW,
-  const int pT, const int pH, const int pW,
-  const int dT, const int dH, const int dW,
-  const int dilationT, const int dilationH, const int dilationW,
-  real* data_vol)
-{
-  int c, t, h, w;
-  memset(data_vol, 0, sizeof(real) * depth * height * width * channels);
-  int depth_col  = (depth  + 2 * pT - (dilationT * (kT - 1) + 1)) / dT + 1;
-  int height_col = (height + 2 * pH - (dilationH * (kH - 1) + 1)) / dH + 1;
-  int width_col  = (width  + 2 * pW - (dilationW * (kW - 1) + 1)) / dW + 1;
-  int channels_col = channels * kT * kH * kW;
-  for (c = 0; c < channels_col; ++c)
-  {
-    int w_offset = c % kW;
-    int h_offset = (c / kW) % kH;
-    int t_offset = (c / kW / kH) % kT;
-    int c_vol = c / kT / kH / kW;
-    for (t = 0; t < depth_col; ++t)
-    {
-      for (h = 0; h < height_col; ++h)
-      {
-        for (w = 0; w < width_col; ++w)
-        {
-          int t_pad = t * dT - pT + t_offset * dilationT;
-          int h_pad = h * dH - pH + h_offset * dilationH;
-          int w_pad = w * dW - pW + w_offset * dilationW;
-          if (t_pad >= 0 && t_pad < depth &&
-              h_pad >= 0 && h_pad < height &&
-              w_pad >= 0 && w_pad < width)
-            data_vol[((c_vol * depth + t_pad) * height + h_pad) * width + w_pad] +=
-              data_col[((c * depth_col + t) * height_col + h) * width_col + w];
-        }
-      }
-    }
-  }
-}
-
 static inline void THNN_(VolumetricFullConvolution_shapeCheck)(
                          THTensor *input, THTensor *gradOutput,
                          THTensor *weight, THTensor *bias,
@@ -146,6 +63,29 @@ static inline void THNN_(VolumetricFullConvolution_shapeCheck)(
   }
 }
 
+/* Geometry of the columns of one frame of output: the transposed
+   convolution folds the columns of its input into the output. */
+static void THNN_(VolumetricFullConvolution_columns)(
+  THNN_(VolumetricColumns) *g,
+  THTensor *input,
+  THTensor *weight,
+  int dT, int dW, int dH,
+  int pT, int pW, int pH,
+  int aT, int aW, int aH)
+{
+  const int kT = (int)weight->size[2];
+  const int kH = (int)weight->size[3];
+  const int kW = (int)weight->size[4];
+  int dimd = input->nDimension == 5 ? 2 : 1;
+
+  THNN_(VolumetricColumns_init)(
+    g, weight->size[1],
+    (input->size[dimd]   - 1) * dT - 2*pT + kT + aT,
+    (input->size[dimd+1] - 1) * dH - 2*pH + kH + aH,
+    (input->size[dimd+2] - 1) * dW - 2*pW + kW + aW,
+    kT, kH, kW, pT, pH, pW, dT, dH, dW, 1, 1, 1);
+}
+
 void THNN_(VolumetricFullConvolution_updateOutput)(
   THNNState *state,
   THTensor *input,          // 4D or 5D (batch) tensor
@@ -159,7 +99,6 @@ void THNN_(VolumetricFullConvolution_updateOutput)(
   int aT, int aW, int aH)   // extra output adjustment
 {
   THTensor *columns = finput;
-  THTensor *ones    = fgradInput;
 
   THNN_(VolumetricFullConvolution_shapeCheck)(
         input, NULL, weight, bias,
@@ -167,120 +106,45 @@ void THNN_(VolumetricFullConvolution_updateOutput)(
 
   const int nInputPlane  = (int)weight->size[0];
   const int nOutputPlane = (int)weight->size[1];
-  const int kT           = (int)weight->size[2];
-  const int kH           = (int)weight->size[3];
-  const int kW           = (int)weight->size[4];
 
   input = THTensor_(newContiguous)(input);
   weight = THTensor_(newContiguous)(weight);
   bias = bias ? THTensor_(newContiguous)(bias) : bias;
-  int batch = 1;
-  if (input->nDimension == 4)
-  {
-    // Force batch
-    batch = 0;
-    THTensor_(resize5d)(input, 1, input->size[0], input->size[1], input->size[2], input->size[3]);
-  }
-
-  const long inputWidth   = input->size[4];
-  const long inputHeight  = input->size[3];
-  const long inputDepth   = input->size[2];
-  const long outputWidth  = (inputWidth  - 1) * dW - 2*pW + kW + aW;
-  const long outputHeight = (inputHeight - 1) * dH - 2*pH + kH + aH;
-  const long outputDepth  = (inputDepth  - 1) * dT - 2*pT + kT + aT;
+  const int batch = input->nDimension == 5;
+  const long batchSize = batch ? input->size[0] : 1;
 
-  // Batch size + input planes
-  const long batchSize = input->size[0];
+  THNN_(VolumetricColumns) g;
+  THNN_(VolumetricFullConvolution_columns)(&g, input, weight, dT, dW, dH, pT, pW, pH, aT, aW, aH);
+  const long inputSize = g.depth_col * g.height_col * g.width_col;
+  const long outputSize = g.depth * g.height * g.width;
 
   // Resize output
-  THTensor_(resize5d)(output, batchSize, nOutputPlane, outputDepth, outputHeight, outputWidth);
-
-  // Resize temporary columns
-  THTensor_(resize2d)(columns, nOutputPlane*kW*kH*kT, inputDepth*inputHeight*inputWidth);
-  THTensor_(zero)(columns);
-
-  // Define a buffer of ones, for bias accumulation
-  // Note: this buffer can be shared with other modules, it only ever gets increased,
-  // and always contains ones.
-  if (ones->nDimension != 3 || ones->size[0]*ones->size[1]*ones->size[2] < outputDepth*outputHeight*outputWidth)
-  {
-    // Resize plane and fill with ones...
-    THTensor_(resize3d)(ones, outputDepth, outputHeight, outputWidth);
-    THTensor_(fill)(ones, 1);
-  }
-
-  // Helpers
-  THTensor *input_n = THTensor_(new)();
-  THTensor *output_n = THTensor_(new)();
-
-  int elt;
-  // For each elt in batch, do:
-  for (elt = 0; elt < batchSize; ++elt)
-  {
-    // Matrix mulitply per output:
-    THTensor_(select)(input_n, input, 0, elt);
-    THTensor_(select)(output_n, output, 0, elt);
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    const long m = weight->size[1] * weight->size[2] * weight->size[3] * weight->size[4];
-    const long n = columns->size[1];
-    const long k = weight->size[0];
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THBlas_(gemm)(
-      'n', 't',
-      n, m, k,
-      1,
-      THTensor_(data)(input_n), n,
-      THTensor_(data)(weight), m,
-      0,
-      THTensor_(data)(columns), n
-    );
-
-    // Unpack columns back into input:
-    THNN_(col2vol)(
-      THTensor_(data)(columns),
-      nOutputPlane, outputDepth, outputHeight, outputWidth,
-      kT, kH, kW,
-      pT, pH, pW,
-      dT, dH, dW,
-       1,  1,  1,
-      THTensor_(data)(output_n)
-    );
-
-    // Do Bias after:
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    const long m_ = nOutputPlane;
-    const long n_ = outputDepth * outputHeight * outputWidth;
-    const long k_ = 1;
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-	if (bias) {
-      THBlas_(gemm)(
-        't', 'n',
-        n_, m_, k_,
-        1,
-        THTensor_(data)(ones), k_,
-        THTensor_(data)(bias), k_,
-        1,
-        THTensor_(data)(output_n), n_
-      );
+  if (batch)
+    THTensor_(resize5d)(output, batchSize, nOutputPlane, g.depth, g.height, g.width);
+  else
+    THTensor_(resize4d)(output, nOutputPlane, g.depth, g.height, g.width);
+
+  // Multiply the input by the weight and fold the columns into the output,
+  // with bounded per-thread columns
+  THNN_(VolumetricColumns_multiplyFold)(
+    &g, batchSize,
+    THTensor_(data)(input), nInputPlane * inputSize,
+    THTensor_(data)(weight), nInputPlane,
+    THTensor_(data)(output), nOutputPlane * outputSize,
+    columns);
+
+  // Do Bias after (the ones buffer is not needed)
+  if (bias) {
+    real *output_data = THTensor_(data)(output);
+    real *bias_data = THTensor_(data)(bias);
+    long p;
+#pragma omp parallel for if (batchSize * nOutputPlane * outputSize > THNN_OMP_OVERHEAD_THRESHOLD) private(p)
+    for (p = 0; p < batchSize * nOutputPlane; p++) {
+      real *plane = output_data + p * outputSize;
+      THVector_(adds)(plane, plane, bias_data[p % nOutputPlane], outputSize);
     }
   }
 
-  // Free
-  THTensor_(free)(input_n);
-  THTensor_(free)(output_n);
-
-  // Resize output
-  if (batch == 0)
-  {
-    THTensor_(resize4d)(output, nOutputPlane, outputDepth, outputHeight, outputWidth);
-    THTensor_(resize4d)(input, nInputPlane, inputDepth, inputHeight, inputWidth);
-  }
-
   THTensor_(free)(input);
   THTensor_(free)(weight);
   if (bias) THTensor_(free)(bias);
@@ -307,92 +171,27 @@ void THNN_(VolumetricFullConvolution_updateGradInput)(
 
   const int nInputPlane  = (int)weight->size[0];
   const int nOutputPlane = (int)weight->size[1];
-  const int kT           = (int)weight->size[2];
-  const int kH           = (int)weight->size[3];
-  const int kW           = (int)weight->size[4];
 
   input = THTensor_(newContiguous)(input);
   weight = THTensor_(newContiguous)(weight);
   gradOutput = THTensor_(newContiguous)(gradOutput);
+  const int batch = input->nDimension == 5;
+  const long batchSize = batch ? input->size[0] : 1;
 
-  int batch = 1;
-  if (input->nDimension == 4)
-  {
-    // Force batch
-    batch = 0;
-    THTensor_(resize5d)(input, 1, input->size[0], input->size[1], input->size[2], input->size[3]);
-    THTensor_(resize5d)(gradOutput, 1, gradOutput->size[0], gradOutput->size[1], gradOutput->size[2], gradOutput->size[3]);
-  }
-
-  const long inputWidth   = input->size[4];
-  const long inputHeight  = input->size[3];
-  const long inputDepth   = input->size[2];
-  const long outputWidth  = (inputWidth  - 1) * dW - 2*pW + kW + aW;
-  const long outputHeight = (inputHeight - 1) * dH - 2*pH + kH + aH;
-  const long outputDepth  = (inputDepth  - 1) * dT - 2*pT + kT + aT;
-
-  // Batch size + input planes
-  const long batchSize = input->size[0];
+  THNN_(VolumetricColumns) g;
+  THNN_(VolumetricFullConvolution_columns)(&g, input, weight, dT, dW, dH, pT, pW, pH, aT, aW, aH);
 
   // Resize output
-  THTensor_(resize5d)(gradInput, batchSize, nInputPlane, inputDepth, inputHeight, inputWidth);
-  THTensor_(zero)(gradInput);
-
-  // Resize temporary columns
-  THTensor_(resize2d)(gradColumns, nOutputPlane*kW*kH*kT, inputDepth*inputHeight*inputWidth);
-
-  // Helpers
-  THTensor *gradInput_n = THTensor_(new)();
-  THTensor *gradOutput_n = THTensor_(new)();
-
-  int elt;
-  // For each elt in batch, do:
-  for (elt = 0; elt < batchSize; ++elt)
-  {
-    // Matrix mulitply per sample:
-    THTensor_(select)(gradInput_n, gradInput, 0, elt);
-    THTensor_(select)(gradOutput_n, gradOutput, 0, elt);
-
-    // Extract columns:
-    THNN_(vol2col)(
-      THTensor_(data)(gradOutput_n),
-      nOutputPlane, outputDepth, outputHeight, outputWidth,
-      kT, kH, kW,
-      pT, pH, pW,
-      dT, dH, dW,
-       1,  1,  1,
-      THTensor_(data)(gradColumns)
-    );
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    const long m = weight->size[0];
-    const long n = gradColumns->size[1];
-    const long k = weight->size[1] * weight->size[2] * weight->size[3] * weight->size[4];
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THBlas_(gemm)(
-      'n', 'n',
-      n, m, k,
-      1,
-      THTensor_(data)(gradColumns), n,
-      THTensor_(data)(weight), k,
-      0,
-      THTensor_(data)(gradInput_n), n
-    );
-  }
+  THTensor_(resizeAs)(gradInput, input);
 
-  // Free
-  THTensor_(free)(gradInput_n);
-  THTensor_(free)(gradOutput_n);
-
-  // Resize output
-  if (batch == 0)
-  {
-    THTensor_(resize4d)(gradOutput, nOutputPlane, outputDepth, outputHeight, outputWidth);
-    THTensor_(resize4d)(input, nInputPlane, inputDepth, inputHeight, inputWidth);
-    THTensor_(resize4d)(gradInput, nInputPlane, inputDepth, inputHeight, inputWidth);
-  }
+  // Unfold gradOutput and multiply by the weight
+  THNN_(VolumetricColumns_unfoldMultiply)(
+    &g, batchSize,
+    THTensor_(data)(gradOutput), nOutputPlane * g.depth * g.height * g.width,
+    THTensor_(data)(weight), nInputPlane,
+    NULL,
+    THTensor_(data)(gradInput), nInputPlane * g.depth_col * g.height_col * g.width_col,
+    gradColumns);
 
   THTensor_(free)(input);
   THTensor_(free)(gradOutput);
@@ -420,119 +219,35 @@ void THNN_(VolumetricFullConvolution_accGradParameters)(
 
   int nInputPlane  = (int)gradWeight->size[0];
   int nOutputPlane = (int)gradWeight->size[1];
-  int kT           = (int)gradWeight->size[2];
-  int kH           = (int)gradWeight->size[3];
-  int kW           = (int)gradWeight->size[4];
 
   THTensor *columns = finput;
-  THTensor *ones = fgradInput;
 
   input = THTensor_(newContiguous)(input);
   gradOutput = THTensor_(newContiguous)(gradOutput);
   THArgCheck(THTensor_(isContiguous)(gradWeight), 4, "gradWeight needs to be contiguous");
   if (gradBias)
     THArgCheck(THTensor_(isContiguous)(gradBias), 5, "gradBias needs to be contiguous");
-
-  int batch = 1;
-  if (input->nDimension == 4)
-  {
-    // Force batch
-    batch = 0;
-    THTensor_(resize5d)(input, 1, input->size[0], input->size[1], input->size[2], input->size[3]);
-    THTensor_(resize5d)(gradOutput, 1, gradOutput->size[0], gradOutput->size[1], gradOutput->size[2], gradOutput->size[3]);
-  }
-
-  const long inputWidth   = input->size[4];
-  const long inputHeight  = input->size[3];
-  const long inputDepth   = input->size[2];
-  const long outputWidth  = (inputWidth  - 1) * dW - 2*pW + kW + aW;
-  const long outputHeight = (inputHeight - 1) * dH - 2*pH + kH + aH;
-  const long outputDepth  = (inputDepth  - 1) * dT - 2*pT + kT + aT;
-
-  // Batch size + input planes
-  const long batchSize = input->size[0];
-
-  // Define a buffer of ones, for bias accumulation
-  if (ones->nDimension != 3 || ones->size[0]*ones->size[1]*ones->size[2] < outputDepth*outputHeight*outputWidth)
-  {
-    // Resize plane and fill with ones...
-    THTensor_(resize3d)(ones, outputDepth, outputHeight, outputWidth);
-    THTensor_(fill)(ones, 1);
-  }
-
-  // Resize temporary columns
-  THTensor_(resize2d)(columns, nOutputPlane*kW*kH*kT, inputDepth*inputHeight*inputWidth);
-
-  // Helpers
-  THTensor *input_n = THTensor_(new)();
-  THTensor *gradOutput_n = THTensor_(new)();
-
-  int elt;
-  // For each elt in batch, do:
-  for (elt = 0; elt < batchSize; ++elt)
-  {
-    // Matrix mulitply per output:
-    THTensor_(select)(input_n, input, 0, elt);
-    THTensor_(select)(gradOutput_n, gradOutput, 0, elt);
-
-    // Extract columns:
-    THNN_(vol2col)(
-      THTensor_(data)(gradOutput_n), nOutputPlane,
-      outputDepth, outputHeight, outputWidth,
-      kT, kH, kW,
-      pT, pH, pW,
-      dT, dH, dW,
-       1,  1,  1,
-      THTensor_(data)(columns)
-    );
-
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    const long n = columns->size[0];   // nOutputPlane * kt * kh * kw
-    const long m = input_n->size[0];   // nInputPlane
-    const long k = columns->size[1];   // inputHeight * inputWidth
-
-    // Do GEMM (note: this is a bit confusing because gemm assumes column-major matrices)
-    THBlas_(gemm)(
-      't', 'n',
-      n, m, k,
-      scale,
-      THTensor_(data)(columns), k,
-      THTensor_(data)(input_n), k,
-      1,
-      THTensor_(data)(gradWeight), n
-    );
-
-    // Do Bias:
-    // M,N,K are dims of matrix A and B
-    // (see http://docs.nvidia.com/cuda/cublas/#cublas-lt-t-gt-gemm)
-    const long m_ = nOutputPlane;
-    const long k_ = outputDepth * outputHeight * outputWidth;
-
-    // Do GEMV (note: this is a bit confusing because gemv assumes column-major matrices)
-    if (gradBias) {
-      THBlas_(gemv)(
-        't',
-        k_, m_,
-        scale,
-        THTensor_(data)(gradOutput_n), k_,
-        THTensor_(data)(ones), 1,
-        1,
-        THTensor_(data)(gradBias), 1
-      );
-    }
-  }
-
-  // Free
-  THTensor_(free)(input_n);
-  THTensor_(free)(gradOutput_n);
-
-  // Resize
-  if (batch == 0)
-  {
-    THTensor_(resize4d)(gradOutput, nOutputPlane, outputDepth, outputHeight, outputWidth);
-    THTensor_(resize4d)(input, nInputPlane, inputDepth, inputHeight, inputWidth);
-  }
+  const int batch = input->nDimension == 5;
+  const long batchSize = batch ? input->size[0] : 1;
+
+  THNN_(VolumetricColumns) g;
+  THNN_(VolumetricFullConvolution_columns)(&g, input, gradWeight, dT, dW, dH, pT, pW, pH, aT, aW, aH);
+  const long outputSize = g.depth * g.height * g.width;
+
+  // Weight gradient: input times the columns of gradOutput, summed over
+  // per-thread copies
+  THNN_(VolumetricColumns_accumulateOuter)(
+    &g, batchSize,
+    THTensor_(data)(input), nInputPlane * g.depth_col * g.height_col * g.width_col,
+    THTensor_(data)(gradOutput), nOutputPlane * outputSize,
+    THTensor_(data)(gradWeight), nInputPlane, scale,
+    columns);
+
+  // Bias gradient
+  if (gradBias)
+    THNN_(VolumetricColumns_planeSums)(
+      THTensor_(data)(gradOutput), batchSize, nOutputPlane * outputSize,
+      nOutputPlane, outputSize, THTensor_(data)(gradBias), scale);
 
   THTensor_(free)(input);
   THTensor_(free)(gradOutput);
@@ -312,8 +312,7 @@ void THNN_(VolumetricMaxUnpooling_updateGradInput)(
   indices = THIndexTensor_(newContiguous)(indices);
 
   /* resize */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   if (input->nDimension == 5)
   {
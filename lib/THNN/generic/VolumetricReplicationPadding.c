@@ -320,8 +320,7 @@ THNN_(VolumetricReplicationPadding_shapeCheck)(
   gradOutput = THTensor_(newContiguous)(gradOutput);
 
   /* resize */
-  THTensor_(resizeAs)(gradInput, input);
-  THTensor_(zero)(gradInput);
+  THTensor_(resizeAsAndZero)(gradInput, input);
 
   /* backprop */
   if (input->nDimension == 4) {
@@ -69,71 +69,36 @@ void THNN_(VolumetricUpSamplingNearest_updateOutput)(
 			outputDepth, outputHeight, outputWidth);
   }
 
-  int dT = scale_factor;
-  int dW = scale_factor;
-  int dH = scale_factor;
-  int xDim = input->nDimension-3;
-  int yDim = input->nDimension-2;
-  int zDim = input->nDimension-1;
-
-  // dims
-  int idim = input->nDimension;
-  int osz0 = output->size[0];
-  int osz1 = output->size[1];
-  int osz2 = output->size[2];
-  int osz3 = output->size[3];
-  int osz4 = 1;
-  if (idim > 4) {
-    osz4 = output->size[4];
-  }
-
-  // get strides
-  long *is = input->stride;
-  long *os = output->stride;
-
-  // get raw pointers
+  input = THTensor_(newContiguous)(input);
   real *pin = THTensor_(data)(input);
   real *pout = THTensor_(data)(output);
-
-  // perform the upsampling
-  int i0, i1, i2, i3, i4, isrc, idst;
-  int iout[5];  // Output indices
-  int iin[5];  // Input indices
-
-  for (i0 = 0; i0 < osz0; i0++) {
-    iout[0] = i0;
-    iin[0] = i0;
-    for (i1 = 0; i1 < osz1; i1++) {
-      iout[1] = i1;
-      iin[1] = i1;
-      for (i2 = 0; i2 < osz2; i2++) {
-        iout[2] = i2;
-        iin[2] = i2;
-        for (i3 = 0; i3 < osz3; i3++) {
-          iout[3] = i3;
-          iin[3] = i3;
-          for (i4 = 0; i4 < osz4; i4++) {
-            iout[4] = i4;
-            iin[4] = i4;
-
-            // set the indices for the upsampled dimensions
-            iin[xDim] = iout[xDim] / dW;
-            iin[yDim] = iout[yDim] / dH;
-            iin[zDim] = iout[zDim] / dT;
-
-            idst = i0*os[0] + i1*os[1] + i2*os[2] + i3*os[3];
-            isrc = iin[0]*is[0] + iin[1]*is[1] + iin[2]*is[2] + iin[3]*is[3];
-            if (idim > 4) {
-              idst += i4*os[4];
-              isrc += iin[4]*is[4];
-            }
-
-            pout[idst] = pin[isrc];
-          }
-        }
+  long iplane = (long)inputHeight * inputWidth;
+  long oplane = (long)outputHeight * outputWidth;
+  long volumes = THTensor_(nElement)(input) / (inputDepth * iplane);
+  long p;
+
+  // upsample each input plane into the first output plane it maps to, row
+  // by row as in the spatial case, then replicate that plane over the others
+#pragma omp parallel for private(p)
+  for (p = 0; p < volumes; p++) {
+    const real *ip = pin + p * inputDepth * iplane;
+    real *op = pout + p * outputDepth * oplane;
+    int z, y, d;
+    for (z = 0; z < inputDepth; z++) {
+      real *oslice = op + (long)z * scale_factor * oplane;
+      for (y = 0; y < inputHeight; y++) {
+        real *orow = oslice + (long)y * scale_factor * outputWidth;
+        THNN_(upsampling_nearestRow)(orow, ip + z * iplane + (long)y * inputWidth,
+                                     inputWidth, scale_factor);
+        for (d = 1; d < scale_factor; d++)
+          memcpy(orow + (long)d * outputWidth, orow, sizeof(real) * outputWidth);
       }
+      for (d = 1; d < scale_factor; d++)
+        memcpy(oslice + d * oplane, oslice, sizeof(real) * oplane);
     }
   }
+
+  THTensor_(free)(input);
 }
 
 void THNN_(VolumetricUpSamplingNearest_updateGradInput)(
@@ -146,81 +111,43 @@ void THNN_(VolumetricUpSamplingNearest_updateGradInput)(
   THNN_(VolumetricUpSamplingNearest_shapeCheck)(input, gradOutput, scale_factor);
   THTensor_(resizeAs)(gradInput, input);
 
-  int dW = scale_factor;
-  int dH = scale_factor;
-  int dT = scale_factor;
-  int xDim = gradInput->nDimension-3;
-  int yDim = gradInput->nDimension-2;
-  int zDim = gradInput->nDimension-1;
-
-  // dims
-  int idim = gradInput->nDimension;  // Guaranteed to be between 3 and 5
-  int isz0 = gradInput->size[0];
-  int isz1 = gradInput->size[1];
-  int isz2 = gradInput->size[2];
-  int isz3 = gradInput->size[3];
-  int isz4 = 1;
-  if (idim > 4) {
-    isz4 = gradInput->size[4];
-  }
-
-  // get strides
-  long *is = gradInput->stride;
-  long *os = gradOutput->stride;
+  int inputDepth   = THTensor_(size)(input, input->nDimension-3);
+  int inputHeight  = THTensor_(size)(input, input->nDimension-2);
+  int inputWidth   = THTensor_(size)(input,  input->nDimension-1);
+  int outputHeight = inputHeight * scale_factor;
+  int outputWidth  = inputWidth * scale_factor;
 
-  // get raw pointers
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  THArgCheck(THTensor_(isContiguous)(gradInput), 4, "gradInput must be contiguous");
   real *pin = THTensor_(data)(gradInput);
   real *pout = THTensor_(data)(gradOutput);
-
-  // perform the upsampling
-  int i0, i1, i2, i3, i4, isrc, idst, x, y, z;
-  int iin[5];  // Input indices
-  int iout[5];  // Output indices
-
-  THTensor_(zero)(gradInput);
-
-  for (i0 = 0; i0 < isz0; i0++) {
-    iin[0] = i0;
-    iout[0] = i0;
-    for (i1 = 0; i1 < isz1; i1++) {
-      iin[1] = i1;
-      iout[1] = i1;
-      for (i2 = 0; i2 < isz2; i2++) {
-        iin[2] = i2;
-        iout[2] = i2;
-        for (i3 = 0; i3 < isz3; i3++) {
-          iin[3] = i3;
-          iout[3] = i3;
-
-          for (i4 = 0; i4 < isz4; i4++) {
-            iin[4] = i4;
-            iout[4] = i4;
-
-            idst = i0*is[0] + i1*is[1] + i2*is[2] + i3*is[3];
-            if (idim > 4) {
-              idst += i4*is[4];
-            }
-
-            // Now accumulate the gradients from gradOutput
-            for (z = 0; z < dT; z++) {
-              for (y = 0; y < dH; y++) {
-                for (x = 0; x < dW; x++) {
-                  iout[xDim] = dW * iin[xDim] + x;
-                  iout[yDim] = dH * iin[yDim] + y;
-                  iout[zDim] = dT * iin[zDim] + z;
-                  isrc = iout[0]*os[0] + iout[1]*os[1] + iout[2]*os[2] + iout[3]*os[3];
-                  if (idim > 4) {
-                    isrc += iout[4]*os[4];
-                  }
-                  pin[idst] += pout[isrc];
-                }
-              }
-            }
-          }
-        }
+  long iplane = (long)inputHeight * inputWidth;
+  long oplane = (long)outputHeight * outputWidth;
+  long volumes = THTensor_(nElement)(gradInput) / (inputDepth * iplane);
+  long p;
+
+#pragma omp parallel for private(p)
+  for (p = 0; p < volumes; p++) {
+    real *ip = pin + p * inputDepth * iplane;
+    const real *op = pout + p * inputDepth * scale_factor * oplane;
+    int x, y, z, dz, dy;
+    for (z = 0; z < inputDepth; z++) {
+      for (y = 0; y < inputHeight; y++) {
+        real *irow = ip + z * iplane + (long)y * inputWidth;
+        for (x = 0; x < inputWidth; x++)
+          irow[x] = 0;
+        for (dz = 0; dz < scale_factor; dz++)
+          for (dy = 0; dy < scale_factor; dy++)
+            THNN_(upsampling_nearestRowBackward)(
+              irow,
+              op + ((long)z * scale_factor + dz) * oplane
+                 + ((long)y * scale_factor + dy) * outputWidth,
+              inputWidth, scale_factor);
       }
     }
   }
+
+  THTensor_(free)(gradOutput);
 }
 
 #endif
@@ -54,72 +54,65 @@ void THNN_(VolumetricUpSamplingTrilinear_updateOutput)(
 		      THTensor_(size)(input, 0), 
 		      THTensor_(size)(input, 1), 
 		      outputDepth, outputHeight, outputWidth);
-  THTensor_(zero)(output);
-  real *idata = THTensor_(data)(input);
-  real *odata = THTensor_(data)(output);
-  channels = nbatch * channels;
   THAssert(inputDepth > 0 && inputHeight > 0 && inputWidth > 0 && 
            outputDepth > 0 && outputHeight > 0 && outputWidth > 0);
   // special case: just copy
   if (inputDepth == outputDepth && inputHeight == outputHeight && inputWidth == outputWidth) {
-    for (int t2 = 0; t2 < outputDepth; ++t2) {
-      const int t1 = t2;
-      for (int h2 = 0; h2 < outputHeight; ++h2) {
-        const int h1 = h2;
-        for (int w2 = 0; w2 < outputWidth; ++w2) {
-          const int w1 = w2;
-          const real* pos1 = &idata[t1 * inputHeight * inputWidth + h1 * inputWidth + w1];
-          real* pos2 = &odata[t2 * outputHeight * outputWidth + h2 * outputWidth + w2];
-          for (int c = 0; c < channels; ++c) {
-            pos2[0] = pos1[0];
-            pos1 += inputWidth * inputHeight * inputDepth;
-            pos2 += outputWidth * outputHeight * outputDepth;
-          }
-        }
-      }
-    }
+    THTensor_(copy)(output, input);
+    THTensor_(free)(input);
     return;
   }
-  const float rdepth  = (outputDepth > 1) ? (float)(inputDepth - 1)/(outputDepth - 1) : 0.f;
-  const float rheight = (outputHeight > 1) ? (float)(inputHeight - 1)/(outputHeight - 1) : 0.f;
-  const float rwidth  = (outputWidth > 1) ? (float)(inputWidth - 1) / (outputWidth - 1) : 0.f;
-  for (int t2 = 0; t2 < outputDepth; ++t2) {
-    const float t1r = rdepth * t2;
-    const int t1 = t1r;
-    const int t1p = (t1 < inputDepth - 1) ? 1 : 0;
-    const real t1lambda = t1r - t1;
-    const real t0lambda = (real)1. - t1lambda;
-    for (int h2 = 0; h2 < outputHeight; ++h2) {
-      const float h1r = rheight * h2;
-      const int h1 = h1r;
-      const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
-      const real h1lambda = h1r - h1;
-      const real h0lambda = (real)1. - h1lambda;
-      for (int w2 = 0; w2 < outputWidth; ++w2) {
-        const float w1r = rwidth * w2;
-        const int w1 = w1r;
-        const int w1p = (w1 < inputWidth - 1) ? 1 : 0;
-        const real w1lambda = w1r - w1;
-        const real w0lambda = (real)1. - w1lambda;
-        const real* pos1 = &idata[t1 * inputHeight * inputWidth + h1 * inputWidth + w1];
-        real* pos2 = &odata[t2 * outputHeight * outputWidth + h2 * outputWidth + w2];
-        for (int c = 0; c < channels; ++c) {
-          pos2[0] = t0lambda * (h0lambda * (w0lambda * pos1[0] + w1lambda * pos1[w1p])
-                              + h1lambda * (w0lambda * pos1[h1p * inputWidth]
-                                          + w1lambda * pos1[h1p * inputWidth + w1p]))
-                  + t1lambda * (h0lambda * (w0lambda * pos1[t1p * inputHeight * inputWidth] 
-                                          + w1lambda * pos1[t1p * inputHeight * inputWidth
-                                                            + w1p])
-                              + h1lambda * (w0lambda * pos1[t1p * inputHeight * inputWidth 
-                                                            + h1p * inputWidth]
-                                          + w1lambda * pos1[t1p * inputHeight * inputWidth 
-                                                            + h1p * inputWidth + w1p]));
-          pos1 += inputWidth * inputHeight * inputDepth;
-          pos2 += outputWidth * outputHeight * outputDepth;
+
+  real *idata = THTensor_(data)(input);
+  real *odata = THTensor_(data)(output);
+  long planes = (long)nbatch * channels;
+  long iplane = (long)inputHeight * inputWidth;
+  int maxthreads = 1;
+#ifdef _OPENMP
+  maxthreads = omp_get_max_threads();
+#endif
+  real *rows = THAlloc(sizeof(real) * 2 * inputWidth * maxthreads);
+  THNN_(UpSamplingLinearTable) ttable, htable, wtable;
+  THNN_(UpSamplingLinearTable_init)(&ttable, inputDepth, outputDepth);
+  THNN_(UpSamplingLinearTable_init)(&htable, inputHeight, outputHeight);
+  THNN_(UpSamplingLinearTable_init)(&wtable, inputWidth, outputWidth);
+
+#pragma omp parallel
+  {
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    real *row0 = rows + tid * 2 * inputWidth;
+    real *row1 = row0 + inputWidth;
+    long c;
+#pragma omp for
+    for (c = 0; c < planes; c++) {
+      const real *pos1 = idata + c * inputDepth * iplane;
+      real *pos2 = odata + c * outputDepth * outputHeight * outputWidth;
+      for (int t2 = 0; t2 < outputDepth; ++t2) {
+        const real *slice0 = pos1 + ttable.index0[t2] * iplane;
+        const real *slice1 = pos1 + ttable.index1[t2] * iplane;
+        for (int h2 = 0; h2 < outputHeight; ++h2) {
+          // blend the four input rows, then interpolate across the width
+          long h0 = htable.index0[h2] * inputWidth, h1 = htable.index1[h2] * inputWidth;
+          THNN_(upsampling_blendRows)(row0, slice0 + h0, slice0 + h1,
+                                      htable.lambda0[h2], htable.lambda1[h2], inputWidth);
+          THNN_(upsampling_blendRows)(row1, slice1 + h0, slice1 + h1,
+                                      htable.lambda0[h2], htable.lambda1[h2], inputWidth);
+          THNN_(upsampling_blendRows)(row0, row0, row1,
+                                      ttable.lambda0[t2], ttable.lambda1[t2], inputWidth);
+          THNN_(upsampling_interpolateRow)(pos2 + ((long)t2 * outputHeight + h2) * outputWidth,
+                                           row0, &wtable, outputWidth);
         }
       }
     }
   }
+
+  THNN_(UpSamplingLinearTable_free)(&ttable);
+  THNN_(UpSamplingLinearTable_free)(&htable);
+  THNN_(UpSamplingLinearTable_free)(&wtable);
+  THFree(rows);
   THTensor_(free)(input);
 }
 
@@ -143,70 +136,72 @@ void THNN_(VolumetricUpSamplingTrilinear_updateGradInput)(
      outputDepth, outputHeight, outputWidth);
 
   THTensor_(resize5d)(gradInput, nbatch, channels, inputDepth, inputHeight, inputWidth);
-  THTensor_(zero)(gradInput);
   gradOutput = THTensor_(newContiguous)(gradOutput);
-  real *data1 = THTensor_(data)(gradInput);
-  real *data2 = THTensor_(data)(gradOutput);
-  channels = nbatch * channels;
+  THArgCheck(THTensor_(isContiguous)(gradInput), 3, "gradInput must be contiguous");
 
   // special case: same-size matching grids
   if (inputDepth == outputDepth && inputHeight == outputHeight && inputWidth == outputWidth) {
-    for (int t2 = 0; t2 < outputDepth; ++t2) {
-      const int t1 = t2;
-      for (int h2 = 0; h2 < outputHeight; ++h2) {
-        const int h1 = h2;
-        for (int w2 = 0; w2 < outputWidth; ++w2) {
-          const int w1 = w2;
-          real* pos1 = &data1[t1 * inputHeight * inputWidth + h1 * inputWidth + w1];
-          const real* pos2 = &data2[t2 * outputHeight * outputWidth + h2 * outputWidth + w2];
-          for (int c = 0; c < channels; ++c) {
-            pos1[0] += pos2[0];
-            pos1 += inputWidth * inputHeight * inputDepth;
-            pos2 += outputWidth * outputHeight * outputDepth;
-          }
-        }
-      }
-    }
+    THTensor_(copy)(gradInput, gradOutput);
+    THTensor_(free)(gradOutput);
     return;
   }
-  const float rdepth  = (outputDepth > 1) ? (float)(inputDepth - 1)/(outputDepth - 1) : 0.f;
-  const float rheight = (outputHeight > 1) ? (float)(inputHeight - 1)/(outputHeight - 1) : 0.f;
-  const float rwidth  = (outputWidth > 1) ? (float)(inputWidth - 1)/(outputWidth - 1) : 0.f;
-  for (int t2 = 0; t2 < outputDepth; ++t2) {
-    const float t1r = rdepth * t2;
-    const int t1 = t1r;
-    const int t1p = (t1 < inputDepth - 1) ? 1 : 0;
-    const real t1lambda = t1r - t1;
-    const real t0lambda = (real)1. - t1lambda;
-    for (int h2 = 0; h2 < outputHeight; ++h2) {
-      const float h1r = rheight * h2;
-      const int h1 = h1r;
-      const int h1p = (h1 < inputHeight - 1) ? 1 : 0;
-      const real h1lambda = h1r - h1;
-      const real h0lambda = (real)1. - h1lambda;
-      for (int w2 = 0; w2 < outputWidth; ++w2) {
-        const float w1r = rwidth * w2;
-        const int w1 = w1r;
-        const int w1p = (w1 < inputWidth - 1) ? 1 : 0;
-        const real w1lambda = w1r - w1;
-        const real w0lambda = (real)1. - w1lambda;
-        real* pos1 = &data1[t1 * inputHeight * inputWidth + h1 * inputWidth + w1];
-        const real* pos2 = &data2[t2 * outputHeight * outputWidth + h2 * outputWidth + w2];
-        for (int c = 0; c < channels; ++c) {
-          pos1[0] += t0lambda * h0lambda * w0lambda * pos2[0];
-          pos1[w1p] += t0lambda * h0lambda * w1lambda * pos2[0];
-          pos1[h1p * inputWidth] += t0lambda * h1lambda * w0lambda * pos2[0];
-          pos1[h1p * inputWidth + w1p] += t0lambda * h1lambda * w1lambda * pos2[0];
-          pos1[t1p * inputHeight * inputWidth] += t1lambda * h0lambda * w0lambda * pos2[0];
-          pos1[t1p * inputHeight * inputWidth + w1p] += t1lambda * h0lambda * w1lambda * pos2[0]; 
-          pos1[t1p * inputHeight * inputWidth + h1p * inputWidth] += t1lambda * h1lambda * w0lambda * pos2[0];
-          pos1[t1p * inputHeight * inputWidth + h1p * inputWidth + w1p] += t1lambda * h1lambda * w1lambda * pos2[0]; 
-          pos1 += inputWidth * inputHeight * inputDepth;
-          pos2 += outputWidth * outputHeight * outputDepth;
+
+  real *data1 = THTensor_(data)(gradInput);
+  real *data2 = THTensor_(data)(gradOutput);
+  long planes = (long)nbatch * channels;
+  long iplane = (long)inputHeight * inputWidth;
+  int maxthreads = 1;
+#ifdef _OPENMP
+  maxthreads = omp_get_max_threads();
+#endif
+  real *rows = THAlloc(sizeof(real) * inputWidth * maxthreads);
+  THNN_(UpSamplingLinearTable) ttable, htable, wtable;
+  THNN_(UpSamplingLinearTable_init)(&ttable, inputDepth, outputDepth);
+  THNN_(UpSamplingLinearTable_init)(&htable, inputHeight, outputHeight);
+  THNN_(UpSamplingLinearTable_init)(&wtable, inputWidth, outputWidth);
+
+#pragma omp parallel
+  {
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    real *row = rows + tid * inputWidth;
+    long c;
+#pragma omp for
+    for (c = 0; c < planes; c++) {
+      real *pos1 = data1 + c * inputDepth * iplane;
+      const real *pos2 = data2 + c * outputDepth * outputHeight * outputWidth;
+      for (long i = 0; i < inputDepth * iplane; i++)
+        pos1[i] = 0;
+      for (int t2 = 0; t2 < outputDepth; ++t2) {
+        real *slice0 = pos1 + ttable.index0[t2] * iplane;
+        real *slice1 = pos1 + ttable.index1[t2] * iplane;
+        for (int h2 = 0; h2 < outputHeight; ++h2) {
+          // reduce the output row to the input width, then split it
+          // between the four input rows
+          long h0 = htable.index0[h2] * inputWidth, h1 = htable.index1[h2] * inputWidth;
+          for (int w1 = 0; w1 < inputWidth; ++w1)
+            row[w1] = 0;
+          THNN_(upsampling_interpolateRowBackward)(
+            row, pos2 + ((long)t2 * outputHeight + h2) * outputWidth, &wtable, outputWidth);
+          THNN_(upsampling_accumulateRow)(slice0 + h0, row,
+                                          ttable.lambda0[t2] * htable.lambda0[h2], inputWidth);
+          THNN_(upsampling_accumulateRow)(slice0 + h1, row,
+                                          ttable.lambda0[t2] * htable.lambda1[h2], inputWidth);
+          THNN_(upsampling_accumulateRow)(slice1 + h0, row,
+                                          ttable.lambda1[t2] * htable.lambda0[h2], inputWidth);
+          THNN_(upsampling_accumulateRow)(slice1 + h1, row,
+                                          ttable.lambda1[t2] * htable.lambda1[h2], inputWidth);
         }
       }
     }
   }
+
+  THNN_(UpSamplingLinearTable_free)(&ttable);
+  THNN_(UpSamplingLinearTable_free)(&htable);
+  THNN_(UpSamplingLinearTable_free)(&wtable);
+  THFree(rows);
   THTensor_(free)(gradOutput);
 }
 
@@ -0,0 +1,350 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/pooling.c"
+#else
+
+/* Row kernels shared by the max and average pooling modules.
+ *
+ * A pooling window is the product of one window per dimension, so the
+ * modules reduce a plane (or a volume) one input row at a time into a row of
+ * outputs. The output columns whose window lies inside the input row run
+ * without bound checks, with the loop over output columns innermost (or the
+ * taps unrolled inside it) so that the compiler can vectorize it; the few
+ * columns at the borders take a clipped scalar loop. The common 2x2 and 3x3
+ * windows with stride 2 are dispatched to copies of the kernels with
+ * constant sizes. */
+
+/* Output columns [*jlo, *jhi) whose window lies entirely inside the row. */
+static inline void THNN_(pooling_interior)(
+          long iwidth,
+          long owidth,
+          int kW,
+          int dW,
+          int padW,
+          int dilation,
+          long *jlo,
+          long *jhi)
+{
+  long last = iwidth - 1 + padW - (long)(kW - 1) * dilation;
+  long lo = (padW + dW - 1) / dW;
+  long hi = last >= 0 ? last / dW + 1 : 0;
+
+  hi = hi < owidth ? hi : owidth;
+  *jlo = lo < hi ? lo : hi;
+  *jhi = hi;
+}
+
+/* Max over the taps of output columns [j0, j1) that fall inside the row. */
+static void THNN_(pooling_maxRowClipped)(
+          const real *in,
+          long iwidth,
+          real *out,
+          THIndex_t *ind,
+          long j0,
+          long j1,
+          int kW,
+          int dW,
+          int padW,
+          int dilation,
+          long base,
+          long jStep,
+          long tapStep)
+{
+  long j;
+  int k;
+
+  for (j = j0; j < j1; j++) {
+    long x0 = j * dW - padW;
+    for (k = 0; k < kW; k++) {
+      long x = x0 + (long)k * dilation;
+      if (x < 0 || x >= iwidth)
+        continue;
+      if (in[x] > out[j]) {
+        out[j] = in[x];
+        if (ind)
+          ind[j] = base + j * jStep + k * tapStep;
+      }
+    }
+  }
+}
+
+static inline void THNN_(pooling_maxRowKernel)(
+          const real *in,
+          long iwidth,
+          real *out,
+          THIndex_t *ind,
+          long owidth,
+          int kW,
+          int dW,
+          int padW,
+          int dilation,
+          long base,
+          long jStep,
+          long tapStep)
+{
+  long jlo, jhi, j;
+  int k;
+
+  THNN_(pooling_interior)(iwidth, owidth, kW, dW, padW, dilation, &jlo, &jhi);
+  THNN_(pooling_maxRowClipped)(in, iwidth, out, ind, 0, jlo,
+                               kW, dW, padW, dilation, base, jStep, tapStep);
+  THNN_(pooling_maxRowClipped)(in, iwidth, out, ind, jhi, owidth,
+                               kW, dW, padW, dilation, base, jStep, tapStep);
+
+  if (ind) {
+    for (j = jlo; j < jhi; j++) {
+      const real *ip = in + j * dW - padW;
+      real m = out[j];
+      THIndex_t mi = ind[j];
+      for (k = 0; k < kW; k++) {
+        real v = ip[k * dilation];
+        mi = v > m ? base + j * jStep + k * tapStep : mi;
+        m = v > m ? v : m;
+      }
+      out[j] = m;
+      ind[j] = mi;
+    }
+  } else {
+    for (j = jlo; j < jhi; j++) {
+      const real *ip = in + j * dW - padW;
+      real m = out[j];
+      for (k = 0; k < kW; k++) {
+        real v = ip[k * dilation];
+        m = v > m ? v : m;
+      }
+      out[j] = m;
+    }
+  }
+}
+
+/* Folds one input row into the running max of a row of outputs, which must
+ * start at -THInf. Values that are not strictly larger than the current max
+ * are ignored, so the first of equal maxima wins when rows are folded in
+ * increasing order. The index recorded for the tap k of column j is
+ * base + j*jStep + k*tapStep; ind may be NULL when no indices are needed. */
+static void THNN_(pooling_maxRow)(
+          const real *in,
+          long iwidth,
+          real *out,
+          THIndex_t *ind,
+          long owidth,
+          int kW,
+          int dW,
+          int padW,
+          int dilation,
+          long base,
+          long jStep,
+          long tapStep)
+{
+  if (dilation == 1 && dW == 2 && kW == 2) {
+    THNN_(pooling_maxRowKernel)(in, iwidth, out, ind, owidth, 2, 2, padW, 1,
+                                base, jStep, tapStep);
+  } else if (dilation == 1 && dW == 2 && kW == 3) {
+    THNN_(pooling_maxRowKernel)(in, iwidth, out, ind, owidth, 3, 2, padW, 1,
+                                base, jStep, tapStep);
+  } else {
+    THNN_(pooling_maxRowKernel)(in, iwidth, out, ind, owidth, kW, dW, padW, dilation,
+                                base, jStep, tapStep);
+  }
+}
+
+/* Gradient of pooling_maxRow for one input row: adds grad[j] to the input of
+ * tap k of output column j when its index is base + j*jStep + k*tapStep.
+ * The input row gathers from the windows that cover it, instead of each
+ * output scattering to its maximum, so that the rows of a plane can be
+ * done in parallel. This is several compares per output where a scatter
+ * does one add, so it only pays when the planes are too few for the
+ * threads. */
+static void THNN_(pooling_maxGradRow)(
+          real *gin,
+          long iwidth,
+          const real *grad,
+          const THIndex_t *ind,
+          long owidth,
+          int kW,
+          int dW,
+          int padW,
+          int dilation,
+          long base,
+          long jStep,
+          long tapStep)
+{
+  long j, jlo, jhi;
+  int k;
+
+  /* one pass per tap: the columns of a pass read distinct inputs */
+  for (k = 0; k < kW; k++) {
+    long off = (long)k * dilation - padW;
+    long key = base + k * tapStep;
+    jlo = off < 0 ? (dW - 1 - off) / dW : 0;
+    jhi = iwidth - off > 0 ? (iwidth - 1 - off) / dW + 1 : 0;
+    jhi = jhi < owidth ? jhi : owidth;
+    for (j = jlo; j < jhi; j++) {
+      real g = grad[j];
+      gin[j * dW + off] += ind[j] == key + j * jStep ? g : 0;
+    }
+  }
+}
+
+static void THNN_(pooling_sumRowClipped)(
+          const real *in,
+          long iwidth,
+          real *out,
+          long j0,
+          long j1,
+          int kW,
+          int dW,
+          int padW)
+{
+  long j, x;
+
+  for (j = j0; j < j1; j++) {
+    for (x = j * dW - padW; x < j * dW - padW + kW; x++) {
+      if (x >= 0 && x < iwidth)
+        out[j] += in[x];
+    }
+  }
+}
+
+static inline void THNN_(pooling_sumRowKernel)(
+          const real *in,
+          long iwidth,
+          real *out,
+          long owidth,
+          int kW,
+          int dW,
+          int padW)
+{
+  long jlo, jhi, j;
+  int k;
+
+  THNN_(pooling_interior)(iwidth, owidth, kW, dW, padW, 1, &jlo, &jhi);
+  THNN_(pooling_sumRowClipped)(in, iwidth, out, 0, jlo, kW, dW, padW);
+  THNN_(pooling_sumRowClipped)(in, iwidth, out, jhi, owidth, kW, dW, padW);
+
+  for (j = jlo; j < jhi; j++) {
+    const real *ip = in + j * dW - padW;
+    real sum = 0;
+    for (k = 0; k < kW; k++)
+      sum += ip[k];
+    out[j] += sum;
+  }
+}
+
+/* Adds the sum of each window of one input row to a row of outputs; taps
+ * that fall in the padding are skipped. */
+static void THNN_(pooling_sumRow)(
+          const real *in,
+          long iwidth,
+          real *out,
+          long owidth,
+          int kW,
+          int dW,
+          int padW)
+{
+  if (dW == 2 && kW == 2)
+    THNN_(pooling_sumRowKernel)(in, iwidth, out, owidth, 2, 2, padW);
+  else if (dW == 2 && kW == 3)
+    THNN_(pooling_sumRowKernel)(in, iwidth, out, owidth, 3, 2, padW);
+  else
+    THNN_(pooling_sumRowKernel)(in, iwidth, out, owidth, kW, dW, padW);
+}
+
+static void THNN_(pooling_scatterRowClipped)(
+          real *gin,
+          long iwidth,
+          const real *grad,
+          const real *divisor,
+          real rowDivisor,
+          long j0,
+          long j1,
+          int kW,
+          int dW,
+          int padW)
+{
+  long j, x;
+
+  for (j = j0; j < j1; j++) {
+    real g = grad[j] / (divisor ? rowDivisor * divisor[j] : rowDivisor);
+    for (x = j * dW - padW; x < j * dW - padW + kW; x++) {
+      if (x >= 0 && x < iwidth)
+        gin[x] += g;
+    }
+  }
+}
+
+static inline void THNN_(pooling_scatterRowKernel)(
+          real *gin,
+          long iwidth,
+          const real *grad,
+          const real *divisor,
+          real rowDivisor,
+          long owidth,
+          int kW,
+          int dW,
+          int padW)
+{
+  long jlo, jhi, j;
+  int k;
+
+  THNN_(pooling_interior)(iwidth, owidth, kW, dW, padW, 1, &jlo, &jhi);
+  THNN_(pooling_scatterRowClipped)(gin, iwidth, grad, divisor, rowDivisor, 0, jlo, kW, dW, padW);
+  THNN_(pooling_scatterRowClipped)(gin, iwidth, grad, divisor, rowDivisor, jhi, owidth, kW, dW, padW);
+
+  /* one pass per tap: the columns of a pass write distinct inputs */
+  for (k = 0; k < kW; k++) {
+    if (divisor) {
+      for (j = jlo; j < jhi; j++)
+        gin[j * dW + k - padW] += grad[j] / (rowDivisor * divisor[j]);
+    } else {
+      for (j = jlo; j < jhi; j++)
+        gin[j * dW + k - padW] += grad[j] / rowDivisor;
+    }
+  }
+}
+
+/* Adds grad[j] / (rowDivisor * divisor[j]) to every input of the window of
+ * output column j; divisor may be NULL for a constant divisor. */
+static void THNN_(pooling_scatterRow)(
+          real *gin,
+          long iwidth,
+          const real *grad,
+          const real *divisor,
+          real rowDivisor,
+          long owidth,
+          int kW,
+          int dW,
+          int padW)
+{
+  if (dW == 2 && kW == 2)
+    THNN_(pooling_scatterRowKernel)(gin, iwidth, grad, divisor, rowDivisor, owidth, 2, 2, padW);
+  else if (dW == 2 && kW == 3)
+    THNN_(pooling_scatterRowKernel)(gin, iwidth, grad, divisor, rowDivisor, owidth, 3, 2, padW);
+  else
+    THNN_(pooling_scatterRowKernel)(gin, iwidth, grad, divisor, rowDivisor, owidth, kW, dW, padW);
+}
+
+/* Window extent of each output position along one padded dimension: the
+ * number of taps inside input + padding when count_include_pad is set, the
+ * number of taps inside the input otherwise. */
+static void THNN_(pooling_windowSizes)(
+          real *sizes,
+          long isize,
+          long osize,
+          int k,
+          int d,
+          int pad,
+          bool count_include_pad)
+{
+  long i;
+  for (i = 0; i < osize; i++) {
+    long start = i * d - pad;
+    long end = start + k < isize + pad ? start + k : isize + pad;
+    if (!count_include_pad) {
+      start = start > 0 ? start : 0;
+      end = end < isize ? end : isize;
+    }
+    sizes[i] = end - start;
+  }
+}
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/softmax.c"
+#else
+
+/* Row kernels shared by SoftMax, LogSoftMax and CrossEntropyCriterion.
+ *
+ * Contiguous rows are reduced in blocks of THNN_SOFTMAX_BLOCK elements: the
+ * block max is found first and the running sum of exp(x - max) is rescaled
+ * only when the max grows, so the max and the sum come out of one pass over
+ * the input. Rows with a stride (3D/4D inputs) are handled a block of
+ * positions at a time, so that the inner loops run over contiguous memory.
+ * The inner loops only carry the reductions and are written to be
+ * vectorized by the compiler. */
+
+#ifndef THNN_SOFTMAX_BLOCK
+#define THNN_SOFTMAX_BLOCK 256
+#endif
+#ifndef THNN_SOFTMAX_OMP_THRESHOLD
+#define THNN_SOFTMAX_OMP_THRESHOLD 16384
+#endif
+
+#if defined(TH_REAL_IS_FLOAT)
+/* expf() without a call, so that the loops above it vectorize: Cody-Waite
+ * reduction to x = n*ln(2) + r, the Cephes polynomial for exp(r) and 2^n
+ * assembled in the exponent bits. Results below FLT_MIN flush to zero.
+ * The clamps compare the bits of x as integers: selects on floating point
+ * comparisons are only if-converted under -fno-trapping-math. NaN and +inf
+ * are found the same way and returned as they are, like exp() does. */
+static inline float THNN_(softmax_exp)(float x)
+{
+  union { float f; unsigned int u; int i; } bits, scale, result;
+  const unsigned int lo = 0xC2AEAC50u;  /* -87.33654f; more negative floats are larger */
+  const int hi = 0x42B0999A;            /* 88.3f */
+  float fn, r, p;
+  int n, keep, special, in;
+
+  bits.f = x;
+  in = bits.i;
+  /* all ones for NaN and +inf: the exponent bits are all set, and x is not -inf */
+  special = -(((bits.u & 0x7F800000u) == 0x7F800000u) & (bits.u != 0xFF800000u));
+  keep = -(bits.u <= lo);                /* all ones, unless x underflows */
+  bits.u = bits.u > lo ? lo : bits.u;
+  bits.i = bits.i > hi ? hi : bits.i;
+  x = bits.f;
+  fn = x * 1.44269504088896341f;
+  n = (int)((fn + 12582912.0f) - 12582912.0f);  /* round to nearest */
+  r = x - n * 0.693359375f;
+  r = r + n * 2.12194440e-4f;
+
+  p = 1.9875691500e-4f;
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  p = p * r * r + r + 1.0f;
+
+  scale.i = ((n + 127) << 23) & keep;
+  result.f = p * scale.f;
+  result.i = (result.i & ~special) | (in & special);
+  return result.f;
+}
+#else
+static inline real THNN_(softmax_exp)(real x)
+{
+  return exp(x);
+}
+#endif
+
+/* max(x) and sum(exp(x - max(x))) of a contiguous row */
+static inline void THNN_(softmax_rowMaxSum)(
+          const real *x,
+          ptrdiff_t n,
+          real *max_,
+          accreal *sum_)
+{
+  real max = -THInf;
+  accreal sum = 0;
+  ptrdiff_t i, j;
+
+  for (i = 0; i < n; i += THNN_SOFTMAX_BLOCK)
+  {
+    const real *xb = x + i;
+    ptrdiff_t len = n - i < THNN_SOFTMAX_BLOCK ? n - i : THNN_SOFTMAX_BLOCK;
+    real bmax = max, bsum = 0;
+
+    for (j = 0; j < len; j++)
+      bmax = xb[j] > bmax ? xb[j] : bmax;
+    if (bmax > max)
+    {
+      sum *= THNN_(softmax_exp)(max - bmax);
+      max = bmax;
+    }
+    for (j = 0; j < len; j++)
+      bsum += THNN_(softmax_exp)(xb[j] - max);
+    sum += bsum;
+  }
+
+  *max_ = max;
+  *sum_ = sum;
+}
+
+/* Same as softmax_rowMaxSum for len positions whose rows are spaced by
+ * stride: x[d*stride + s] is element d of the row at position s. */
+static inline void THNN_(softmax_lanesMaxSum)(
+          const real *x,
+          ptrdiff_t dim,
+          ptrdiff_t stride,
+          ptrdiff_t len,
+          real *max,
+          accreal *sum)
+{
+  ptrdiff_t d, s;
+
+  for (s = 0; s < len; s++)
+  {
+    max[s] = -THInf;
+    sum[s] = 0;
+  }
+  for (d = 0; d < dim; d++)
+  {
+    const real *xd = x + d*stride;
+    for (s = 0; s < len; s++)
+      max[s] = xd[s] > max[s] ? xd[s] : max[s];
+  }
+  for (d = 0; d < dim; d++)
+  {
+    const real *xd = x + d*stride;
+    for (s = 0; s < len; s++)
+      sum[s] += THNN_(softmax_exp)(xd[s] - max[s]);
+  }
+}
+
+#endif
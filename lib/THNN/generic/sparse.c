@@ -0,0 +1,261 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/sparse.c"
+#else
+
+/* Kernels on CSR batches shared by SparseLinear and IndexLinear.
+ *
+ * Row h of a batch holds the nonzeros [rowPtr[h], rowPtr[h+1]) (rowPtr[0]
+ * is 0), nonzero i being values[i] at column (feature) cols[i] + colOffset.
+ * The weight element of column c and output o lives at weight[c*colStride +
+ * o*outStride]: SparseLinear stores an outDim x inDim matrix, IndexLinear
+ * one row of outputs per key.
+ *
+ * The product runs in parallel over tiles of rows x outputs. A tile holds
+ * about THNN_SPARSE_TILE_NNZ nonzeros, so that their columns and values stay
+ * in cache while the tile's THNN_SPARSE_TILE_OUTPUTS outputs sweep them.
+ *
+ * The gradient accumulation into the weight is partitioned by ownership:
+ * the nonzeros are bucketed by column modulo the number of parts with a
+ * stable counting sort, and each part is then processed by one thread. No
+ * two threads update the same weight column, only the active columns are
+ * touched, and the updates of a column keep the batch order, so the result
+ * is the same as the serial loop's. */
+
+/* Threshold used to trigger multithreading */
+#ifndef THNN_SPARSE_OMP_THRESHOLD
+#define THNN_SPARSE_OMP_THRESHOLD 100000
+#endif
+
+/* Threshold used to trigger BLAS axpy call */
+#ifndef THNN_SPARSE_OUTDIM_THRESHOLD
+#define THNN_SPARSE_OUTDIM_THRESHOLD 49
+#endif
+
+#ifndef THNN_SPARSE_TILE_NNZ
+#define THNN_SPARSE_TILE_NNZ 4096
+#define THNN_SPARSE_TILE_OUTPUTS 64
+#endif
+
+typedef struct {
+  long batchSize;
+  const long *rowPtr;
+  const long *cols;
+  const real *values;
+  long colOffset;
+} THNN_(CSRBatch);
+
+/* Number of nonzeros i whose column cols[i] + colOffset is outside
+ * [0, numCols); *first is set to the first of them. */
+static long THNN_(CSRBatch_checkColumns)(
+          const THNN_(CSRBatch) *b,
+          long numCols,
+          long *first)
+{
+  long nnz = b->rowPtr[b->batchSize];
+  long i, bad = 0;
+#pragma omp parallel for if (nnz > THNN_SPARSE_OMP_THRESHOLD) reduction(+:bad) private(i)
+  for (i = 0; i < nnz; i++) {
+    long c = b->cols[i] + b->colOffset;
+    bad += c < 0 || c >= numCols;
+  }
+  if (bad) {
+    for (i = 0; i < nnz; i++) {
+      long c = b->cols[i] + b->colOffset;
+      if (c < 0 || c >= numCols) {
+        *first = c;
+        break;
+      }
+    }
+  }
+  return bad;
+}
+
+/* rows[i] = the batch row of nonzero i */
+static void THNN_(CSRBatch_rows)(const THNN_(CSRBatch) *b, long *rows)
+{
+  long h;
+#pragma omp parallel for if (b->rowPtr[b->batchSize] > THNN_SPARSE_OMP_THRESHOLD) private(h)
+  for (h = 0; h < b->batchSize; h++) {
+    long i;
+    for (i = b->rowPtr[h]; i < b->rowPtr[h+1]; i++)
+      rows[i] = h;
+  }
+}
+
+/* output (batchSize x outDim) = bias + batch * weight */
+static void THNN_(CSRBatch_multiply)(
+          const THNN_(CSRBatch) *b,
+          const real *weight,
+          long colStride,
+          long outStride,
+          long outDim,
+          const real *bias,
+          real *output)
+{
+  const long *rowPtr = b->rowPtr;
+  long nnz = rowPtr[b->batchSize];
+  long outTiles = (outDim + THNN_SPARSE_TILE_OUTPUTS - 1) / THNN_SPARSE_TILE_OUTPUTS;
+  long *tiles = THAlloc(sizeof(long) * (b->batchSize + 1));
+  long rowTiles = 0, h, item;
+
+  /* cut the rows into tiles of about THNN_SPARSE_TILE_NNZ nonzeros */
+  tiles[0] = 0;
+  for (h = 0; h < b->batchSize; h++)
+    if (h + 1 == b->batchSize || rowPtr[h+1] - rowPtr[tiles[rowTiles]] >= THNN_SPARSE_TILE_NNZ)
+      tiles[++rowTiles] = h + 1;
+
+#pragma omp parallel for schedule(dynamic) if (nnz * outDim > THNN_SPARSE_OMP_THRESHOLD) private(item)
+  for (item = 0; item < rowTiles * outTiles; item++) {
+    long h0 = tiles[item / outTiles], h1 = tiles[item / outTiles + 1];
+    long o0 = (item % outTiles) * THNN_SPARSE_TILE_OUTPUTS;
+    long o1 = o0 + THNN_SPARSE_TILE_OUTPUTS < outDim ? o0 + THNN_SPARSE_TILE_OUTPUTS : outDim;
+    long h, i, o;
+
+    if (outStride == 1) {
+      /* the outputs of a column are contiguous: add up their slices */
+      for (h = h0; h < h1; h++) {
+        real *out = output + h * outDim;
+        for (o = o0; o < o1; o++)
+          out[o] = bias ? bias[o] : 0;
+        for (i = rowPtr[h]; i < rowPtr[h+1]; i++) {
+          const real *w = weight + (b->cols[i] + b->colOffset) * colStride;
+          real v = b->values[i];
+          if (o1 - o0 > THNN_SPARSE_OUTDIM_THRESHOLD)
+            THBlas_(axpy)(o1 - o0, v, (real*)w + o0, 1, out + o0, 1);
+          else
+            for (o = o0; o < o1; o++)
+              out[o] += w[o] * v;
+        }
+      }
+    } else {
+      /* the columns of an output are contiguous: gather along them */
+      for (o = o0; o < o1; o++) {
+        const real *w = weight + o * outStride + b->colOffset * colStride;
+        for (h = h0; h < h1; h++) {
+          accreal sum = bias ? bias[o] : 0;
+          for (i = rowPtr[h]; i < rowPtr[h+1]; i++)
+            sum += w[b->cols[i] * colStride] * b->values[i];
+          output[h * outDim + o] = sum;
+        }
+      }
+    }
+  }
+
+  THFree(tiles);
+}
+
+/* Buckets the n columns cols[i] + colOffset by owner (column % parts):
+ * order[partPtr[p] .. partPtr[p+1]) lists the i owned by part p, ascending. */
+static void THNN_(sparse_partition)(
+          const long *cols,
+          long colOffset,
+          long n,
+          long parts,
+          long *partPtr,
+          long *order)
+{
+  long chunks = 1, c, p;
+#ifdef _OPENMP
+  chunks = omp_get_max_threads();
+#endif
+  long *counts = THAlloc(sizeof(long) * chunks * parts);
+  for (c = 0; c < chunks * parts; c++)
+    counts[c] = 0;
+
+#pragma omp parallel for schedule(static) private(c)
+  for (c = 0; c < chunks; c++) {
+    long *count = counts + c * parts, i;
+    for (i = n * c / chunks; i < n * (c + 1) / chunks; i++)
+      count[(cols[i] + colOffset) % parts]++;
+  }
+
+  /* the slots of part p, chunk c follow those of the earlier chunks */
+  long start = 0;
+  for (p = 0; p < parts; p++) {
+    partPtr[p] = start;
+    for (c = 0; c < chunks; c++) {
+      long count = counts[c * parts + p];
+      counts[c * parts + p] = start;
+      start += count;
+    }
+  }
+  partPtr[parts] = start;
+
+#pragma omp parallel for schedule(static) private(c)
+  for (c = 0; c < chunks; c++) {
+    long *slot = counts + c * parts, i;
+    for (i = n * c / chunks; i < n * (c + 1) / chunks; i++)
+      order[slot[(cols[i] + colOffset) % parts]++] = i;
+  }
+
+  THFree(counts);
+}
+
+/* Number of ownership parts for n updates of outDim elements each. */
+static long THNN_(sparse_parts)(long n, long outDim)
+{
+  long parts = 1;
+#ifdef _OPENMP
+  if (n * outDim > THNN_SPARSE_OMP_THRESHOLD && omp_get_max_threads() > 1)
+    parts = 4 * omp_get_max_threads();
+#endif
+  return parts;
+}
+
+/* The nonzeros of a batch bucketed by owner part, with their rows. */
+typedef struct {
+  long parts;
+  long *partPtr;
+  long *order;
+  long *rows;
+} THNN_(CSRPartition);
+
+static void THNN_(CSRPartition_init)(
+          THNN_(CSRPartition) *part,
+          const THNN_(CSRBatch) *b,
+          long outDim)
+{
+  long nnz = b->rowPtr[b->batchSize];
+  part->parts = THNN_(sparse_parts)(nnz, outDim);
+  part->partPtr = THAlloc(sizeof(long) * (part->parts + 1));
+  part->order = THAlloc(sizeof(long) * nnz);
+  part->rows = THAlloc(sizeof(long) * nnz);
+  THNN_(CSRBatch_rows)(b, part->rows);
+  THNN_(sparse_partition)(b->cols, b->colOffset, nnz, part->parts, part->partPtr, part->order);
+}
+
+static void THNN_(CSRPartition_free)(THNN_(CSRPartition) *part)
+{
+  THFree(part->partPtr);
+  THFree(part->order);
+  THFree(part->rows);
+}
+
+/* weight(c, o) += scale * sum of values[i] * grad[row(i)][o] over the
+ * nonzeros i of column c, with grad batchSize x outDim contiguous. */
+static void THNN_(CSRBatch_accumulate)(
+          const THNN_(CSRBatch) *b,
+          const real *grad,
+          long outDim,
+          real *weight,
+          long colStride,
+          long outStride,
+          real scale)
+{
+  THNN_(CSRPartition) part;
+  long p;
+
+  THNN_(CSRPartition_init)(&part, b, outDim);
+#pragma omp parallel for schedule(dynamic) if (part.parts > 1) private(p)
+  for (p = 0; p < part.parts; p++) {
+    long k;
+    for (k = part.partPtr[p]; k < part.partPtr[p+1]; k++) {
+      long i = part.order[k];
+      THBlas_(axpy)(outDim, scale * b->values[i], (real*)grad + part.rows[i] * outDim, 1,
+                    weight + (b->cols[i] + b->colOffset) * colStride, outStride);
+    }
+  }
+  THNN_(CSRPartition_free)(&part);
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/upsampling.c"
+#else
+
+/* Helpers shared by the bilinear and trilinear upsampling modules.
+ *
+ * The source indices and weights of the interpolation along each dimension
+ * only depend on the sizes, so they are computed once per call into tables
+ * rather than once per channel. A plane is then produced one output row at
+ * a time: the input rows it interpolates between are blended over the input
+ * width, and the blended row is interpolated across the output width, both
+ * loops running over contiguous memory. */
+
+typedef struct {
+  long *index0;
+  long *index1;
+  real *lambda0;
+  real *lambda1;
+} THNN_(UpSamplingLinearTable);
+
+/* Source indices and weights of the linear interpolation from isize to osize
+ * points along one dimension, with the corners of both grids aligned. */
+static void THNN_(UpSamplingLinearTable_init)(
+          THNN_(UpSamplingLinearTable) *table,
+          long isize,
+          long osize)
+{
+  const float ratio = (osize > 1) ? (float)(isize - 1) / (osize - 1) : 0.f;
+  long o;
+
+  table->index0 = THAlloc(sizeof(long) * 2 * osize);
+  table->index1 = table->index0 + osize;
+  table->lambda0 = THAlloc(sizeof(real) * 2 * osize);
+  table->lambda1 = table->lambda0 + osize;
+  for (o = 0; o < osize; o++) {
+    const float r = ratio * o;
+    const long i = r;
+    table->index0[o] = i;
+    table->index1[o] = (i < isize - 1) ? i + 1 : i;
+    table->lambda1[o] = r - i;
+    table->lambda0[o] = (real)1. - table->lambda1[o];
+  }
+}
+
+static void THNN_(UpSamplingLinearTable_free)(THNN_(UpSamplingLinearTable) *table)
+{
+  THFree(table->index0);
+  THFree(table->lambda0);
+}
+
+/* dst = lambda0 * src0 + lambda1 * src1 over n elements. */
+static inline void THNN_(upsampling_blendRows)(
+          real *dst,
+          const real *src0,
+          const real *src1,
+          real lambda0,
+          real lambda1,
+          long n)
+{
+  long x;
+  for (x = 0; x < n; x++)
+    dst[x] = lambda0 * src0[x] + lambda1 * src1[x];
+}
+
+/* Interpolates a row of the input width to the output width. */
+static inline void THNN_(upsampling_interpolateRow)(
+          real *dst,
+          const real *src,
+          const THNN_(UpSamplingLinearTable) *table,
+          long osize)
+{
+  const long *index0 = table->index0, *index1 = table->index1;
+  const real *lambda0 = table->lambda0, *lambda1 = table->lambda1;
+  long j;
+  for (j = 0; j < osize; j++)
+    dst[j] = lambda0[j] * src[index0[j]] + lambda1[j] * src[index1[j]];
+}
+
+/* Transpose of upsampling_interpolateRow: dst (of the input width) must be
+ * zeroed. Neighbouring output columns hit the same inputs, so this one stays
+ * a scalar loop. */
+static inline void THNN_(upsampling_interpolateRowBackward)(
+          real *dst,
+          const real *grad,
+          const THNN_(UpSamplingLinearTable) *table,
+          long osize)
+{
+  long j;
+  for (j = 0; j < osize; j++) {
+    dst[table->index0[j]] += table->lambda0[j] * grad[j];
+    dst[table->index1[j]] += table->lambda1[j] * grad[j];
+  }
+}
+
+/* dst += lambda * src over n elements. */
+static inline void THNN_(upsampling_accumulateRow)(
+          real *dst,
+          const real *src,
+          real lambda,
+          long n)
+{
+  long x;
+  for (x = 0; x < n; x++)
+    dst[x] += lambda * src[x];
+}
+
+/* Nearest neighbour upsampling of one row by an integer factor. */
+static inline void THNN_(upsampling_nearestRow)(
+          real *dst,
+          const real *src,
+          long isize,
+          int scale)
+{
+  long x;
+  int dx;
+  for (dx = 0; dx < scale; dx++)
+    for (x = 0; x < isize; x++)
+      dst[x * scale + dx] = src[x];
+}
+
+/* Transpose of upsampling_nearestRow, accumulated into dst. */
+static inline void THNN_(upsampling_nearestRowBackward)(
+          real *dst,
+          const real *grad,
+          long isize,
+          int scale)
+{
+  long x;
+  int dx;
+  for (dx = 0; dx < scale; dx++)
+    for (x = 0; x < isize; x++)
+      dst[x] += grad[x * scale + dx];
+}
+
+#endif
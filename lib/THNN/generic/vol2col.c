@@ -0,0 +1,501 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/vol2col.c"
+#else
+
+/* Column (vol2col + GEMM) engine shared by the volumetric convolutions and
+ * the spatial dilated and transposed ones.
+ *
+ * A convolution over a batch of volumes is cut into work items that run in
+ * parallel: either a group of whole frames, whose columns are multiplied in
+ * a single GEMM when the frames are small, or a slab of consecutive output
+ * depths of one frame when they are large or when there are fewer frames
+ * than threads. Each thread unfolds its item into its own column buffer of
+ * at most about THNN_COLUMNS_BUFFER_SIZE elements, so the scratch memory no
+ * longer grows with the batch or the volume. Folding columns back into a
+ * volume (col2vol) is a scatter: two slabs of a frame write disjoint depths
+ * of the volume unless they are adjacent, so the even slabs are folded in
+ * parallel first and the odd ones next. A plane is handled as a volume
+ * whose depth is the height of the plane (see initSpatial), so the slabs of
+ * a spatial frame are bands of output rows. */
+
+typedef struct {
+  long channels, depth, height, width;
+  long depth_col, height_col, width_col;
+  int kT, kH, kW;
+  int pT, pH, pW;
+  int dT, dH, dW;
+  int dilationT, dilationH, dilationW;
+} THNN_(VolumetricColumns);
+
+typedef struct {
+  long batch;
+  long frames;   /* frames per item; 1 when the frames are cut into slabs */
+  long slab;     /* output depths per item */
+  long nslabs;
+  long items;
+  long nthreads;
+  long columnsSize;
+  long scratchSize;  /* per thread */
+} THNN_(VolumetricColumnsPlan);
+
+/* Geometry of the columns of a volume of channels x depth x height x width
+ * for a kernel of kT x kH x kW. */
+static void THNN_(VolumetricColumns_init)(
+          THNN_(VolumetricColumns) *g,
+          long channels, long depth, long height, long width,
+          int kT, int kH, int kW,
+          int pT, int pH, int pW,
+          int dT, int dH, int dW,
+          int dilationT, int dilationH, int dilationW)
+{
+  g->channels = channels;
+  g->depth = depth;
+  g->height = height;
+  g->width = width;
+  g->kT = kT; g->kH = kH; g->kW = kW;
+  g->pT = pT; g->pH = pH; g->pW = pW;
+  g->dT = dT; g->dH = dH; g->dW = dW;
+  g->dilationT = dilationT; g->dilationH = dilationH; g->dilationW = dilationW;
+  g->depth_col  = (depth  + 2 * pT - (dilationT * (kT - 1) + 1)) / dT + 1;
+  g->height_col = (height + 2 * pH - (dilationH * (kH - 1) + 1)) / dH + 1;
+  g->width_col  = (width  + 2 * pW - (dilationW * (kW - 1) + 1)) / dW + 1;
+}
+
+/* Geometry of the columns of a plane of channels x height x width for a
+ * kernel of kH x kW: the rows of the plane become the depth of a volume of
+ * height 1, so that a frame can be cut into bands of rows. */
+static void THNN_(VolumetricColumns_initSpatial)(
+          THNN_(VolumetricColumns) *g,
+          long channels, long height, long width,
+          int kH, int kW,
+          int pH, int pW,
+          int dH, int dW,
+          int dilationH, int dilationW)
+{
+  THNN_(VolumetricColumns_init)(
+    g, channels, height, 1, width,
+    kH, 1, kW, pH, 0, pW, dH, 1, dW,
+    dilationH, 1, dilationW);
+}
+
+/* Cuts a batch into work items. rows is the number of rows of the matrix
+ * the columns are multiplied with, extra the per-thread scratch needed on
+ * top of the columns. */
+static void THNN_(VolumetricColumns_plan)(
+          THNN_(VolumetricColumnsPlan) *p,
+          const THNN_(VolumetricColumns) *g,
+          long batch,
+          long rows,
+          long extra)
+{
+  long K = g->channels * g->kT * g->kH * g->kW;
+  long plane = g->height_col * g->width_col;
+  long frameSize = K * g->depth_col * plane;
+  long perThread, minSlab;
+
+  p->nthreads = 1;
+#ifdef _OPENMP
+  p->nthreads = omp_get_max_threads();
+#endif
+  p->batch = batch;
+  perThread = (batch + p->nthreads - 1) / p->nthreads;
+  p->frames = frameSize > 0 && frameSize <= THNN_COLUMNS_BUFFER_SIZE ?
+    THNN_COLUMNS_BUFFER_SIZE / frameSize : 1;
+  p->frames = p->frames < perThread ? p->frames : perThread;
+  p->slab = g->depth_col;
+  if (p->frames <= 1) {
+    long slabs = (p->nthreads + batch - 1) / batch;
+    long bySize = THNN_COLUMNS_BUFFER_SIZE / (K * plane > 0 ? K * plane : 1);
+    long byThreads = (g->depth_col + slabs - 1) / slabs;
+    p->frames = 1;
+    p->slab = bySize < byThreads ? bySize : byThreads;
+  }
+  /* slabs two apart must fold into disjoint depths of the volume */
+  minSlab = ((long)(g->kT - 1) * g->dilationT) / g->dT;
+  p->slab = p->slab > minSlab ? p->slab : minSlab;
+  p->slab = p->slab > 1 ? p->slab : 1;
+  p->slab = p->slab < g->depth_col ? p->slab : g->depth_col;
+  p->nslabs = (g->depth_col + p->slab - 1) / p->slab;
+  p->items = p->frames > 1 ? (batch + p->frames - 1) / p->frames : batch * p->nslabs;
+  p->columnsSize = K * p->frames * p->slab * plane;
+  p->scratchSize = p->columnsSize + extra;
+  if (p->frames > 1)
+    p->scratchSize += rows * p->frames * g->depth_col * plane;
+}
+
+/* Frames [*b0, *b1) and output depths [*t0, *t1) of work item i. */
+static void THNN_(VolumetricColumns_item)(
+          const THNN_(VolumetricColumnsPlan) *p,
+          const THNN_(VolumetricColumns) *g,
+          long i,
+          long *b0, long *b1, long *t0, long *t1)
+{
+  if (p->frames > 1) {
+    *b0 = i * p->frames;
+    *b1 = *b0 + p->frames < p->batch ? *b0 + p->frames : p->batch;
+    *t0 = 0;
+    *t1 = g->depth_col;
+  } else {
+    *b0 = i / p->nslabs;
+    *b1 = *b0 + 1;
+    *t0 = (i % p->nslabs) * p->slab;
+    *t1 = *t0 + p->slab < g->depth_col ? *t0 + p->slab : g->depth_col;
+  }
+}
+
+/* Columns [lo, hi) of a row of width_col whose taps at offset off fall
+ * inside a row of the volume of the given size. */
+static inline void THNN_(VolumetricColumns_interior)(
+          long size, long size_col, int pad, int stride, long off,
+          long *lo, long *hi)
+{
+  long x = pad - off;
+  long y = size + pad - off;
+  *lo = x <= 0 ? 0 : (x + stride - 1) / stride;
+  *hi = y <= 0 ? 0 : (y + stride - 1) / stride;
+  *hi = *hi < size_col ? *hi : size_col;
+  *lo = *lo < *hi ? *lo : *hi;
+}
+
+/* Unfolds output depths [t0, t1) of vol: row c of the columns holds the
+ * input under tap c of the kernel at each of those positions, and starts
+ * ld elements after row c - 1. */
+static void THNN_(vol2col_rows)(
+          const real *vol,
+          const THNN_(VolumetricColumns) *g,
+          long t0,
+          long t1,
+          real *col,
+          long ld)
+{
+  long channels_col = g->channels * g->kT * g->kH * g->kW;
+  long c, t, h, w;
+
+  for (c = 0; c < channels_col; c++) {
+    long w_offset = (c % g->kW) * g->dilationW;
+    long h_offset = ((c / g->kW) % g->kH) * g->dilationH;
+    long t_offset = ((c / g->kW / g->kH) % g->kT) * g->dilationT;
+    long c_vol = c / g->kT / g->kH / g->kW;
+    real *dst = col + c * ld;
+    long wlo, whi;
+
+    THNN_(VolumetricColumns_interior)(g->width, g->width_col, g->pW, g->dW, w_offset, &wlo, &whi);
+    for (t = t0; t < t1; t++) {
+      long t_pad = t * g->dT - g->pT + t_offset;
+      for (h = 0; h < g->height_col; h++, dst += g->width_col) {
+        long h_pad = h * g->dH - g->pH + h_offset;
+        const real *src;
+        if (t_pad < 0 || t_pad >= g->depth || h_pad < 0 || h_pad >= g->height) {
+          memset(dst, 0, sizeof(real) * g->width_col);
+          continue;
+        }
+        src = vol + ((c_vol * g->depth + t_pad) * g->height + h_pad) * g->width;
+        for (w = 0; w < wlo; w++)
+          dst[w] = 0;
+        if (g->dW == 1) {
+          if (whi > wlo)
+            memcpy(dst + wlo, src + wlo + w_offset - g->pW, sizeof(real) * (whi - wlo));
+        } else {
+          for (w = wlo; w < whi; w++)
+            dst[w] = src[w * g->dW - g->pW + w_offset];
+        }
+        for (w = whi; w < g->width_col; w++)
+          dst[w] = 0;
+      }
+    }
+  }
+}
+
+/* Transpose of vol2col_rows: adds the columns of output depths [t0, t1)
+ * into the taps of vol they were unfolded from. */
+static void THNN_(col2vol_rows)(
+          const real *col,
+          long ld,
+          const THNN_(VolumetricColumns) *g,
+          long t0,
+          long t1,
+          real *vol)
+{
+  long channels_col = g->channels * g->kT * g->kH * g->kW;
+  long c, t, h, w;
+
+  for (c = 0; c < channels_col; c++) {
+    long w_offset = (c % g->kW) * g->dilationW;
+    long h_offset = ((c / g->kW) % g->kH) * g->dilationH;
+    long t_offset = ((c / g->kW / g->kH) % g->kT) * g->dilationT;
+    long c_vol = c / g->kT / g->kH / g->kW;
+    const real *src = col + c * ld;
+    long wlo, whi;
+
+    THNN_(VolumetricColumns_interior)(g->width, g->width_col, g->pW, g->dW, w_offset, &wlo, &whi);
+    for (t = t0; t < t1; t++) {
+      long t_pad = t * g->dT - g->pT + t_offset;
+      for (h = 0; h < g->height_col; h++, src += g->width_col) {
+        long h_pad = h * g->dH - g->pH + h_offset;
+        real *dst;
+        if (t_pad < 0 || t_pad >= g->depth || h_pad < 0 || h_pad >= g->height)
+          continue;
+        dst = vol + ((c_vol * g->depth + t_pad) * g->height + h_pad) * g->width;
+        if (g->dW == 1) {
+          for (w = wlo; w < whi; w++)
+            dst[w + w_offset - g->pW] += src[w];
+        } else {
+          for (w = wlo; w < whi; w++)
+            dst[w * g->dW - g->pW + w_offset] += src[w];
+        }
+      }
+    }
+  }
+}
+
+/* dst[b] = A * columns(src[b]) (+ bias) for each frame b, where A is
+ * rows x K, src[b] is a volume and dst[b] is rows x (depth_col x height_col
+ * x width_col). Frames are srcStride and dstStride elements apart. */
+static void THNN_(VolumetricColumns_unfoldMultiply)(
+          const THNN_(VolumetricColumns) *g,
+          long batch,
+          real *src,
+          long srcStride,
+          real *A,
+          long rows,
+          real *bias,
+          real *dst,
+          long dstStride,
+          THTensor *scratch)
+{
+  THNN_(VolumetricColumnsPlan) p;
+  long K = g->channels * g->kT * g->kH * g->kW;
+  long plane = g->height_col * g->width_col;
+  long frameLen = g->depth_col * plane;
+  real *scratch_data;
+
+  THNN_(VolumetricColumns_plan)(&p, g, batch, rows, 0);
+  THTensor_(resize1d)(scratch, p.nthreads * p.scratchSize);
+  scratch_data = THTensor_(data)(scratch);
+
+#pragma omp parallel if (p.items > 1)
+  {
+    long i;
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    real *columns = scratch_data + tid * p.scratchSize;
+    real *tmp = columns + p.columnsSize;
+
+#pragma omp for schedule(dynamic)
+    for (i = 0; i < p.items; i++) {
+      long b0, b1, t0, t1, b, o;
+      THNN_(VolumetricColumns_item)(&p, g, i, &b0, &b1, &t0, &t1);
+      long nb = b1 - b0;
+      long len = (t1 - t0) * plane;
+
+      for (b = b0; b < b1; b++)
+        THNN_(vol2col_rows)(src + b * srcStride, g, t0, t1,
+                            columns + (b - b0) * len, nb * len);
+
+      if (nb == 1) {
+        /* write the slab of output depths in place */
+        real *out = dst + b0 * dstStride + t0 * plane;
+        for (o = 0; o < rows; o++)
+          THVector_(fill)(out + o * frameLen, bias ? bias[o] : 0, len);
+        THBlas_(gemm)('n', 'n', len, rows, K,
+                      1, columns, len, A, K,
+                      1, out, frameLen);
+      } else {
+        /* one GEMM for the group, then scatter the frames */
+        THBlas_(gemm)('n', 'n', nb * len, rows, K,
+                      1, columns, nb * len, A, K,
+                      0, tmp, nb * len);
+        for (b = 0; b < nb; b++) {
+          for (o = 0; o < rows; o++) {
+            real *out = dst + (b0 + b) * dstStride + o * frameLen;
+            real *in = tmp + o * nb * len + b * len;
+            if (bias)
+              THVector_(adds)(out, in, bias[o], len);
+            else
+              memcpy(out, in, sizeof(real) * len);
+          }
+        }
+      }
+    }
+  }
+}
+
+/* dst[b] = fold(A^T * src[b]) for each frame b: the transpose of
+ * unfoldMultiply, with src[b] rows x (depth_col x height_col x width_col)
+ * and dst[b] a volume, which is overwritten. */
+static void THNN_(VolumetricColumns_multiplyFold)(
+          const THNN_(VolumetricColumns) *g,
+          long batch,
+          real *src,
+          long srcStride,
+          real *A,
+          long rows,
+          real *dst,
+          long dstStride,
+          THTensor *scratch)
+{
+  THNN_(VolumetricColumnsPlan) p;
+  long K = g->channels * g->kT * g->kH * g->kW;
+  long plane = g->height_col * g->width_col;
+  long frameLen = g->depth_col * plane;
+  long volLen = g->channels * g->depth * g->height * g->width;
+  real *scratch_data;
+  long b;
+  int phase;
+
+  THNN_(VolumetricColumns_plan)(&p, g, batch, rows, 0);
+  THTensor_(resize1d)(scratch, p.nthreads * p.scratchSize);
+  scratch_data = THTensor_(data)(scratch);
+
+#pragma omp parallel for if (batch * volLen > THNN_OMP_OVERHEAD_THRESHOLD) private(b)
+  for (b = 0; b < batch; b++)
+    memset(dst + b * dstStride, 0, sizeof(real) * volLen);
+
+  for (phase = 0; phase < (p.nslabs > 1 ? 2 : 1); phase++) {
+#pragma omp parallel if (p.items > 1)
+    {
+      long i;
+      int tid = 0;
+#ifdef _OPENMP
+      tid = omp_get_thread_num();
+#endif
+      real *columns = scratch_data + tid * p.scratchSize;
+      real *tmp = columns + p.columnsSize;
+
+#pragma omp for schedule(dynamic)
+      for (i = 0; i < p.items; i++) {
+        long b0, b1, t0, t1, f, o;
+        if ((i % p.nslabs) % 2 != phase)
+          continue;
+        THNN_(VolumetricColumns_item)(&p, g, i, &b0, &b1, &t0, &t1);
+        long nb = b1 - b0;
+        long len = (t1 - t0) * plane;
+
+        if (nb == 1) {
+          THBlas_(gemm)('n', 't', len, K, rows,
+                        1, src + b0 * srcStride + t0 * plane, frameLen, A, K,
+                        0, columns, len);
+        } else {
+          /* gather the group into one matrix for a single GEMM */
+          for (f = 0; f < nb; f++)
+            for (o = 0; o < rows; o++)
+              memcpy(tmp + o * nb * len + f * len,
+                     src + (b0 + f) * srcStride + o * frameLen, sizeof(real) * len);
+          THBlas_(gemm)('n', 't', nb * len, K, rows,
+                        1, tmp, nb * len, A, K,
+                        0, columns, nb * len);
+        }
+
+        for (f = b0; f < b1; f++)
+          THNN_(col2vol_rows)(columns + (f - b0) * len, nb * len, g, t0, t1,
+                              dst + f * dstStride);
+      }
+    }
+  }
+}
+
+/* G += scale * sum_b src[b] * columns(vol[b])^T, with G rows x K and
+ * src[b] rows x (depth_col x height_col x width_col): the gradient w.r.t.
+ * the A of unfoldMultiply. Each thread sums into its own copy of G. */
+static void THNN_(VolumetricColumns_accumulateOuter)(
+          const THNN_(VolumetricColumns) *g,
+          long batch,
+          real *src,
+          long srcStride,
+          real *vol,
+          long volStride,
+          real *G,
+          long rows,
+          real scale,
+          THTensor *scratch)
+{
+  THNN_(VolumetricColumnsPlan) p;
+  long K = g->channels * g->kT * g->kH * g->kW;
+  long plane = g->height_col * g->width_col;
+  long frameLen = g->depth_col * plane;
+  real *scratch_data;
+  long j;
+
+  THNN_(VolumetricColumns_plan)(&p, g, batch, rows, rows * K);
+  THTensor_(resize1d)(scratch, p.nthreads * p.scratchSize);
+  scratch_data = THTensor_(data)(scratch);
+  /* the team may be smaller than nthreads: clear every copy */
+  for (j = 0; j < p.nthreads; j++)
+    memset(scratch_data + j * p.scratchSize + p.columnsSize, 0, sizeof(real) * rows * K);
+
+#pragma omp parallel if (p.items > 1)
+  {
+    long i;
+    int tid = 0;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+#endif
+    real *columns = scratch_data + tid * p.scratchSize;
+    real *partial = columns + p.columnsSize;
+    real *tmp = partial + rows * K;
+
+#pragma omp for schedule(dynamic)
+    for (i = 0; i < p.items; i++) {
+      long b0, b1, t0, t1, b, o;
+      THNN_(VolumetricColumns_item)(&p, g, i, &b0, &b1, &t0, &t1);
+      long nb = b1 - b0;
+      long len = (t1 - t0) * plane;
+
+      for (b = b0; b < b1; b++)
+        THNN_(vol2col_rows)(vol + b * volStride, g, t0, t1,
+                            columns + (b - b0) * len, nb * len);
+
+      if (nb == 1) {
+        THBlas_(gemm)('t', 'n', K, rows, len,
+                      scale, columns, len, src + b0 * srcStride + t0 * plane, frameLen,
+                      1, partial, K);
+      } else {
+        for (b = 0; b < nb; b++)
+          for (o = 0; o < rows; o++)
+            memcpy(tmp + o * nb * len + b * len,
+                   src + (b0 + b) * srcStride + o * frameLen, sizeof(real) * len);
+        THBlas_(gemm)('t', 'n', K, rows, nb * len,
+                      scale, columns, nb * len, tmp, nb * len,
+                      1, partial, K);
+      }
+    }
+  }
+
+#pragma omp parallel for if (rows * K * p.nthreads > THNN_OMP_OVERHEAD_THRESHOLD) private(j)
+  for (j = 0; j < rows * K; j++) {
+    long t;
+    real sum = 0;
+    for (t = 0; t < p.nthreads; t++)
+      sum += scratch_data[t * p.scratchSize + p.columnsSize + j];
+    G[j] += sum;
+  }
+}
+
+/* sums[o] += scale * sum of plane o over the batch, for frames of planes x
+ * size elements that are stride elements apart. */
+static void THNN_(VolumetricColumns_planeSums)(
+          const real *src,
+          long batch,
+          long stride,
+          long planes,
+          long size,
+          real *sums,
+          real scale)
+{
+  long o;
+#pragma omp parallel for if (batch * planes * size > THNN_OMP_OVERHEAD_THRESHOLD) private(o)
+  for (o = 0; o < planes; o++) {
+    accreal sum = 0;
+    long b, k;
+    for (b = 0; b < batch; b++) {
+      const real *data = src + b * stride + o * size;
+      for (k = 0; k < size; k++)
+        sum += data[k];
+    }
+    sums[o] += scale * sum;
+  }
+}
+
+#endif
@@ -62,6 +62,153 @@
     THArgCheck(COND, ARG, FORMAT, s1.str);	\
   }
 
+/* Elementwise kernels of the pointwise modules.
+ *
+ * THNN_TENSOR_APPLY2/3 take the same arguments as TH_TENSOR_APPLY2/3 and run
+ * CODE once per element with TENSOR_data pointing at it. When all tensors are
+ * contiguous CODE is inlined into a flat loop, split over OpenMP threads above
+ * THNN_OMP_OVERHEAD_THRESHOLD elements and left to the compiler to vectorize,
+ * which it does when CODE selects values rather than branching around stores.
+ * Otherwise they fall back to TH_TENSOR_APPLY2/3.
+ *
+ * TENSOR1 may share its data with TENSOR2, which is how the modules implement
+ * in-place mode: the loop then uses one pointer for both, so that the compiler
+ * does not have to guard the vector loop against the overlap. */
+
+#define THNN_OMP_OVERHEAD_THRESHOLD 100000
+
+/* Elements of the per-thread column (unfolded input) buffers of the
+ * convolutions. */
+#define THNN_COLUMNS_BUFFER_SIZE (1 << 20)
+
+#ifdef _OPENMP
+#ifndef _WIN32
+#define THNN_DO_PRAGMA(P) _Pragma(#P)
+#else
+#define THNN_DO_PRAGMA(P) __pragma(P)
+#endif
+#define THNN_PRAGMA(P) THNN_DO_PRAGMA(P)
+#else
+#define THNN_PRAGMA(P)
+#endif
+
+#define THNN_TENSOR_APPLY2(TYPE1, TENSOR1, TYPE2, TENSOR2, CODE)		\
+{									\
+  ptrdiff_t THNN_i, THNN_n = THTensor_(nElement)(TENSOR1);		\
+  if (THNN_n == THTensor_(nElement)(TENSOR2) &&				\
+      THTensor_(isContiguous)(TENSOR1) && THTensor_(isContiguous)(TENSOR2)) { \
+    TYPE1 *TENSOR1##_base = THTensor_(data)(TENSOR1);			\
+    TYPE2 *TENSOR2##_base = THTensor_(data)(TENSOR2);			\
+    if ((void*)TENSOR1##_base == (void*)TENSOR2##_base) {		\
+      THNN_PRAGMA(omp parallel for if (THNN_n > THNN_OMP_OVERHEAD_THRESHOLD) private(THNN_i)) \
+      for (THNN_i = 0; THNN_i < THNN_n; THNN_i++) {			\
+        TYPE1 *TENSOR1##_data = TENSOR1##_base + THNN_i;		\
+        TYPE2 *TENSOR2##_data = (TYPE2*)TENSOR1##_data;			\
+        CODE								\
+      }									\
+    } else {								\
+      THNN_PRAGMA(omp parallel for if (THNN_n > THNN_OMP_OVERHEAD_THRESHOLD) private(THNN_i)) \
+      for (THNN_i = 0; THNN_i < THNN_n; THNN_i++) {			\
+        TYPE1 *TENSOR1##_data = TENSOR1##_base + THNN_i;		\
+        TYPE2 *TENSOR2##_data = TENSOR2##_base + THNN_i;		\
+        CODE								\
+      }									\
+    }									\
+  } else {								\
+    TH_TENSOR_APPLY2(TYPE1, TENSOR1, TYPE2, TENSOR2, CODE);		\
+  }									\
+}
+
+#define THNN_TENSOR_APPLY3(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE) \
+{									\
+  ptrdiff_t THNN_i, THNN_n = THTensor_(nElement)(TENSOR1);		\
+  if (THNN_n == THTensor_(nElement)(TENSOR2) &&				\
+      THNN_n == THTensor_(nElement)(TENSOR3) &&				\
+      THTensor_(isContiguous)(TENSOR1) && THTensor_(isContiguous)(TENSOR2) && \
+      THTensor_(isContiguous)(TENSOR3)) {				\
+    TYPE1 *TENSOR1##_base = THTensor_(data)(TENSOR1);			\
+    TYPE2 *TENSOR2##_base = THTensor_(data)(TENSOR2);			\
+    TYPE3 *TENSOR3##_base = THTensor_(data)(TENSOR3);			\
+    if ((void*)TENSOR1##_base == (void*)TENSOR2##_base) {		\
+      THNN_PRAGMA(omp parallel for if (THNN_n > THNN_OMP_OVERHEAD_THRESHOLD) private(THNN_i)) \
+      for (THNN_i = 0; THNN_i < THNN_n; THNN_i++) {			\
+        TYPE1 *TENSOR1##_data = TENSOR1##_base + THNN_i;		\
+        TYPE2 *TENSOR2##_data = (TYPE2*)TENSOR1##_data;			\
+        TYPE3 *TENSOR3##_data = TENSOR3##_base + THNN_i;		\
+        CODE								\
+      }									\
+    } else {								\
+      THNN_PRAGMA(omp parallel for if (THNN_n > THNN_OMP_OVERHEAD_THRESHOLD) private(THNN_i)) \
+      for (THNN_i = 0; THNN_i < THNN_n; THNN_i++) {			\
+        TYPE1 *TENSOR1##_data = TENSOR1##_base + THNN_i;		\
+        TYPE2 *TENSOR2##_data = TENSOR2##_base + THNN_i;		\
+        TYPE3 *TENSOR3##_data = TENSOR3##_base + THNN_i;		\
+        CODE								\
+      }									\
+    }									\
+  } else {								\
+    TH_TENSOR_APPLY3(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE); \
+  }									\
+}
+
+/* THNN_TENSOR_APPLY2/3_REDUCE additionally take the OpenMP reduction clause
+ * of the accumulators CODE updates, e.g. reduction(+:sum). The contiguous
+ * loop is then a parallel reduction, and a simd one where the compiler
+ * supports OpenMP 4, which lets it vectorize floating point sums. The partial
+ * sums are added in an unspecified order, so accumulate in accreal.
+ * THNN_SIMD_REDUCE(REDUCE) marks a serial loop as such a simd reduction,
+ * and THNN_SIMD a serial loop whose iterations are independent. */
+
+#if defined(_OPENMP) && _OPENMP >= 201307
+#define THNN_OMP_FOR_REDUCE omp parallel for simd
+#define THNN_SIMD_REDUCE(REDUCE) THNN_PRAGMA(omp simd REDUCE)
+#define THNN_SIMD THNN_PRAGMA(omp simd)
+#else
+#define THNN_OMP_FOR_REDUCE omp parallel for
+#define THNN_SIMD_REDUCE(REDUCE)
+#define THNN_SIMD
+#endif
+
+#define THNN_TENSOR_APPLY2_REDUCE(TYPE1, TENSOR1, TYPE2, TENSOR2, REDUCE, CODE) \
+{									\
+  ptrdiff_t THNN_i, THNN_n = THTensor_(nElement)(TENSOR1);		\
+  if (THNN_n == THTensor_(nElement)(TENSOR2) &&				\
+      THTensor_(isContiguous)(TENSOR1) && THTensor_(isContiguous)(TENSOR2)) { \
+    TYPE1 *TENSOR1##_base = THTensor_(data)(TENSOR1);			\
+    TYPE2 *TENSOR2##_base = THTensor_(data)(TENSOR2);			\
+    THNN_PRAGMA(THNN_OMP_FOR_REDUCE if (THNN_n > THNN_OMP_OVERHEAD_THRESHOLD) REDUCE) \
+    for (THNN_i = 0; THNN_i < THNN_n; THNN_i++) {			\
+      TYPE1 *TENSOR1##_data = TENSOR1##_base + THNN_i;			\
+      TYPE2 *TENSOR2##_data = TENSOR2##_base + THNN_i;			\
+      CODE								\
+    }									\
+  } else {								\
+    TH_TENSOR_APPLY2(TYPE1, TENSOR1, TYPE2, TENSOR2, CODE);		\
+  }									\
+}
+
+#define THNN_TENSOR_APPLY3_REDUCE(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, REDUCE, CODE) \
+{									\
+  ptrdiff_t THNN_i, THNN_n = THTensor_(nElement)(TENSOR1);		\
+  if (THNN_n == THTensor_(nElement)(TENSOR2) &&				\
+      THNN_n == THTensor_(nElement)(TENSOR3) &&				\
+      THTensor_(isContiguous)(TENSOR1) && THTensor_(isContiguous)(TENSOR2) && \
+      THTensor_(isContiguous)(TENSOR3)) {				\
+    TYPE1 *TENSOR1##_base = THTensor_(data)(TENSOR1);			\
+    TYPE2 *TENSOR2##_base = THTensor_(data)(TENSOR2);			\
+    TYPE3 *TENSOR3##_base = THTensor_(data)(TENSOR3);			\
+    THNN_PRAGMA(THNN_OMP_FOR_REDUCE if (THNN_n > THNN_OMP_OVERHEAD_THRESHOLD) REDUCE) \
+    for (THNN_i = 0; THNN_i < THNN_n; THNN_i++) {			\
+      TYPE1 *TENSOR1##_data = TENSOR1##_base + THNN_i;			\
+      TYPE2 *TENSOR2##_data = TENSOR2##_base + THNN_i;			\
+      TYPE3 *TENSOR3##_data = TENSOR3##_base + THNN_i;			\
+      CODE								\
+    }									\
+  } else {								\
+    TH_TENSOR_APPLY3(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE); \
+  }									\
+}
+
 #include "generic/Abs.c"
 #include "THGenerateFloatTypes.h"
 
@@ -71,9 +218,15 @@
 #include "generic/BCECriterion.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/softmax.c"
+#include "THGenerateFloatTypes.h"
+
 #include "generic/ClassNLLCriterion.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/CrossEntropyCriterion.c"
+#include "THGenerateFloatTypes.h"
+
 #include "generic/SpatialClassNLLCriterion.c"
 #include "THGenerateFloatTypes.h"
 
@@ -101,6 +254,9 @@
 #include "generic/FusedRNNKernel.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/FusedRNNSequence.c"
+#include "THGenerateFloatTypes.h"
+
 #include "generic/LogSigmoid.c"
 #include "THGenerateFloatTypes.h"
 
@@ -110,6 +266,9 @@
 #include "generic/LookupTable.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/EmbeddingBag.c"
+#include "THGenerateFloatTypes.h"
+
 #include "generic/MSECriterion.c"
 #include "THGenerateFloatTypes.h"
 
@@ -149,6 +308,9 @@
 #include "generic/SoftShrink.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/sparse.c"
+#include "THGenerateFloatTypes.h"
+
 #include "generic/SparseLinear.c"
 #include "THGenerateFloatTypes.h"
 
@@ -173,6 +335,9 @@
 #include "generic/TemporalSubSampling.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/pooling.c"
+#include "THGenerateFloatTypes.h"
+
 #include "generic/TemporalMaxPooling.c"
 #include "THGenerateFloatTypes.h"
 
@@ -197,6 +362,9 @@
 #include "generic/SpatialConvolutionLocal.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/vol2col.c"
+#include "THGenerateFloatTypes.h"
+
 #include "generic/SpatialFullConvolution.c"
 #include "THGenerateFloatTypes.h"
 
@@ -230,6 +398,9 @@
 #include "generic/SpatialSubSampling.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/upsampling.c"
+#include "THGenerateFloatTypes.h"
+
 #include "generic/SpatialUpSamplingNearest.c"
 #include "THGenerateFloatTypes.h"
 
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "TH/TH.h"
+
+// Per-iteration arena for temporaries (see TH/THArena.h). While an
+// ArenaScope is alive, the CPU tensors and storages created by this thread
+// are bump-allocated from a thread-local arena, and all of them are
+// released at once when it is destroyed. They must not be used past the
+// scope: allocate what outlives the step before entering it, or copy it
+// out.
+//
+//   auto total = CPU(kFloat).zeros({1});
+//   for(auto & batch : batches) {
+//     at::ArenaScope scope;
+//     total.add_(step(batch));
+//   }
+
+namespace at {
+
+struct ArenaScope {
+  ArenaScope()
+  : scope(THArena_enter()) {}
+  ~ArenaScope() {
+    THArena_exit(scope);
+  }
+  ArenaScope(const ArenaScope &) = delete;
+  ArenaScope & operator=(const ArenaScope &) = delete;
+  // bytes held by the arena of this thread
+  static ptrdiff_t reserved() {
+    return THArena_reserved();
+  }
+  // gives the memory of the arena of this thread back to the system; only
+  // outside of a scope
+  static void release() {
+    THArena_release();
+  }
+private:
+  int scope;
+};
+
+}
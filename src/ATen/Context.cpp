@@ -1,4 +1,6 @@
 #include "Context.h"
+#include <algorithm>
+#include <cstring>
 #include <thread>
 #include <mutex>
 #include <sstream>
@@ -8,9 +10,21 @@
 #include "ATen/CUDAGenerator.h"
 #endif
 #include "ATen/CPUGenerator.h"
+#include "TH/TH.h"
+#include "ATen/Storage.h"
 
 namespace at {
 
+static_assert(kMapShared == TH_ALLOCATOR_MAPPED_SHARED &&
+              kMapExclusive == TH_ALLOCATOR_MAPPED_EXCLUSIVE &&
+              kMapNoCreate == TH_ALLOCATOR_MAPPED_NOCREATE &&
+              kMapReadOnly == TH_ALLOCATOR_MAPPED_READONLY &&
+              kMapPopulate == TH_ALLOCATOR_MAPPED_POPULATE &&
+              kMapSequential == TH_ALLOCATOR_MAPPED_SEQUENTIAL &&
+              kMapRandom == TH_ALLOCATOR_MAPPED_RANDOM &&
+              kMapWillNeed == TH_ALLOCATOR_MAPPED_WILLNEED,
+              "MapFlags differ from the TH_ALLOCATOR_MAPPED_* flags");
+
 static inline void errorHandler(const char * msg, void * data) {
   throw std::runtime_error(msg);
 }
@@ -52,6 +66,98 @@ Context & globalContext() {
   return globalContext_;
 }
 
+void Context::setCPUCachingAllocator(bool enabled) {
+  THSetStorageAllocator(enabled ? &THCachingAllocator : nullptr);
+}
+
+bool Context::hasCPUCachingAllocator() const {
+  return THGetStorageAllocator() == &THCachingAllocator;
+}
+
+void Context::emptyCPUCache() {
+  THCachingAllocator_emptyCache();
+}
+
+void Context::setCopyOnWriteClone(bool enabled) {
+  THSetCopyOnWriteClone(enabled);
+}
+
+bool Context::hasCopyOnWriteClone() const {
+  return THGetCopyOnWriteClone() != 0;
+}
+
+static MemoryStats toMemoryStats(const THMemoryCounters & counters) {
+  return {counters.live, counters.peak, counters.allocations, counters.frees};
+}
+
+MemoryStats Context::memoryStats() const {
+  THMemoryCounters counters;
+  THMemoryStats_total(&counters);
+  return toMemoryStats(counters);
+}
+
+MemoryStats Context::memoryStats(ScalarType s) const {
+  int type = 0;
+  switch(s) {
+#define TH_TYPE(_1,n,_2) \
+    case ScalarType::n: type = TH_MEMORY_TYPE_##n; break;
+    AT_FORALL_SCALAR_TYPES(TH_TYPE)
+#undef TH_TYPE
+    default:
+      runtime_error("unknown scalar type");
+  }
+  THMemoryCounters counters;
+  THMemoryStats_byType(type, &counters);
+  return toMemoryStats(counters);
+}
+
+std::vector<std::pair<std::string, MemoryStats>> Context::memoryStatsByAllocator() const {
+  std::vector<std::pair<std::string, MemoryStats>> result;
+  int n = THMemoryStats_numAllocators();
+  for(int i = 0; i < n; i++) {
+    THMemoryCounters counters;
+    const char * name = THMemoryStats_byAllocator(i, &counters);
+    result.emplace_back(name, toMemoryStats(counters));
+  }
+  return result;
+}
+
+void Context::resetPeakMemory() {
+  THMemoryStats_resetPeak();
+}
+
+void Context::setMemorySiteTracking(bool enabled) {
+  THMemoryStats_setSiteTracking(enabled);
+}
+
+bool Context::hasMemorySiteTracking() const {
+  return THMemoryStats_siteTracking() != 0;
+}
+
+std::vector<MemorySiteStats> Context::memorySites() const {
+  std::vector<MemorySiteStats> result;
+  int n = THMemoryStats_numSites();
+  for(int i = 0; i < n; i++) {
+    ptrdiff_t allocations, bytes;
+    const char * site = THMemoryStats_site(i, &allocations, &bytes);
+    // TH tells the sites apart by address
+    auto same = std::find_if(result.begin(), result.end(), [&](const MemorySiteStats & s) {
+      return strcmp(s.site, site) == 0;
+    });
+    if(same != result.end()) {
+      same->allocations += allocations;
+      same->bytes += bytes;
+    } else {
+      result.push_back({site, allocations, bytes});
+    }
+  }
+  return result;
+}
+
+void Context::resetMemorySites() {
+  THMemoryStats_resetSites();
+}
+
 bool Context::hasCUDA() const {
 #ifdef AT_CUDA_ENABLED
   return true;
@@ -2,7 +2,11 @@
 
 #include <memory>
 #include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 #include "ATen/Generator.h"
+#include "ATen/MemoryStats.h"
 #include "ATen/Type.h"
 #include "ATen/Utils.h"
 
@@ -28,6 +32,30 @@ public:
     return *generator;
   }
   bool hasCUDA() const;
+  // CPU storages created from now on come from THCachingAllocator
+  // (enabled) or THDefaultAllocator (disabled)
+  void setCPUCachingAllocator(bool enabled);
+  bool hasCPUCachingAllocator() const;
+  // returns the memory cached by THCachingAllocator to the system
+  void emptyCPUCache();
+  // clone() of a contiguous CPU tensor shares its storage until either
+  // side is written, instead of copying it. Pointers from data() taken
+  // before the clone must not be written through afterwards.
+  void setCopyOnWriteClone(bool enabled);
+  bool hasCopyOnWriteClone() const;
+  // memory held by the data of CPU tensors: in total, of one scalar type,
+  // and by allocator
+  MemoryStats memoryStats() const;
+  MemoryStats memoryStats(ScalarType s) const;
+  std::vector<std::pair<std::string, MemoryStats>> memoryStatsByAllocator() const;
+  // sets the peaks to the live bytes
+  void resetPeakMemory();
+  // counts the allocations by MemorySite while enabled; sites with the
+  // same label are one
+  void setMemorySiteTracking(bool enabled);
+  bool hasMemorySiteTracking() const;
+  std::vector<MemorySiteStats> memorySites() const;
+  void resetMemorySites();
   // defined in header so that getType has ability to inline
   // call_once check. getType is called fairly frequently
   THCState* lazyInitCUDA() {
@@ -2,6 +2,7 @@
 #include "ATen/Tensor.h"
 #include "ATen/Context.h"
 #include "ATen/TensorMethods.h"
+#include <TH/TH.h>
 
 #include <cmath>
 #include <iostream>
@@ -49,13 +50,19 @@ std::ostream& operator<<(std::ostream & out, ScalarType t) {
   return out << toString(t);
 }
 
+// the values of a contiguous CPU double tensor, for reading: data<double>()
+// would take its storage out of copy-on-write sharing first
+static const double* __readData(const Tensor& self) {
+  return THDoubleTensor_data(static_cast<THDoubleTensor*>(self.pImpl->unsafeGetTH(false)));
+}
+
 static std::tuple<double, int64_t> __printFormat(std::ostream& stream, const Tensor& self) {
   auto size = self.numel();
   if(size == 0) {
     return std::make_tuple(1., 0);
   }
   bool intMode = true;
-  auto self_p = self.data<double>();
+  auto self_p = __readData(self);
   for(int64_t i = 0; i < size; i++) {
     auto z = self_p[i];
     if(std::isfinite(z)) {
@@ -177,7 +184,7 @@ static void __printMatrix(std::ostream& stream, const Tensor& self, int64_t line
     }
     for(int64_t l = 0; l < self.size(0); l++) {
       Tensor row = self.select(0,l);
-      double *row_ptr = row.data<double>();
+      const double *row_ptr = __readData(row);
       for(int64_t c = firstColumn; c < lastColumn+1; c++) {
         stream << std::setw(sz) << row_ptr[c]/scale;
         if(c == lastColumn) {
@@ -246,7 +253,7 @@ std::ostream& print(std::ostream& stream, const Tensor & tensor_, int64_t linesi
   } else {
     Tensor tensor = tensor_.toType(getType(kCPU,kDouble)).contiguous();
     if(tensor.ndimension() == 0) {
-      stream << defaultfloat << tensor.data<double>()[0] << std::endl;
+      stream << defaultfloat << __readData(tensor)[0] << std::endl;
       stream << "[ " << tensor_.pImpl->toString() << "{} ]";
     } else if(tensor.ndimension() == 1) {
       double scale;
@@ -255,7 +262,7 @@ std::ostream& print(std::ostream& stream, const Tensor & tensor_, int64_t linesi
       if(scale != 1) {
         printScale(stream, scale);
       }
-      double* tensor_p = tensor.data<double>();
+      const double* tensor_p = __readData(tensor);
       for(int64_t i = 0; i < tensor.size(0); i++) {
         stream << std::setw(sz) << tensor_p[i]/scale << std::endl;
       }
@@ -0,0 +1,31 @@
+#include "ATen/MemoryStats.h"
+#include "TH/TH.h"
+
+namespace at {
+
+MemoryScope::MemoryScope() {
+  THMemoryScope scope;
+  THMemoryStats_beginScope(&scope);
+  base_ = scope.base;
+  start = scope.start;
+  outerPeak = scope.outerPeak;
+}
+
+MemoryScope::~MemoryScope() {
+  THMemoryScope scope = {base_, start, outerPeak};
+  THMemoryStats_endScope(&scope);
+}
+
+int64_t MemoryScope::peak() const {
+  THMemoryScope scope = {base_, start, outerPeak};
+  return THMemoryStats_scopePeak(&scope);
+}
+
+MemorySite::MemorySite(const char * site)
+: previous(THMemoryStats_setSite(site)) {}
+
+MemorySite::~MemorySite() {
+  THMemoryStats_setSite(previous);
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+// Accounting of the memory of CPU tensors (see TH/THMemoryStats.h), as
+// reported by Context::memoryStats() and its variants. It counts the data
+// of the storages, always; the histogram by allocation site is optional.
+//
+//   {
+//     at::MemoryScope scope;
+//     at::MemorySite site("forward");
+//     model.forward(input);
+//     std::cout << scope.peak() - scope.base() << " bytes at most\n";
+//   }
+
+namespace at {
+
+struct MemoryStats {
+  int64_t live;         // bytes
+  int64_t peak;         // bytes, since the start or the last resetPeakMemory()
+  int64_t allocations;
+  int64_t frees;
+};
+
+struct MemorySiteStats {
+  const char * site;
+  int64_t allocations;
+  int64_t bytes;        // allocated in total
+};
+
+// Peak of the live bytes while it is alive, counting the allocations and
+// frees of its own thread. Scopes nest within a thread.
+struct MemoryScope {
+  MemoryScope();
+  ~MemoryScope();
+  MemoryScope(const MemoryScope &) = delete;
+  MemoryScope & operator=(const MemoryScope &) = delete;
+  // live bytes when the scope was entered
+  int64_t base() const {
+    return base_;
+  }
+  // highest live bytes since then, while it is the innermost scope
+  int64_t peak() const;
+private:
+  int64_t base_;
+  int64_t start;
+  int64_t outerPeak;
+};
+
+// Allocation site of the calling thread while it is alive, for the
+// histogram of Context::memorySites(). site has to outlive the
+// histogram: use a literal.
+struct MemorySite {
+  explicit MemorySite(const char * site);
+  ~MemorySite();
+  MemorySite(const MemorySite &) = delete;
+  MemorySite & operator=(const MemorySite &) = delete;
+private:
+  const char * previous;
+};
+
+}
@@ -5,6 +5,20 @@
 
 namespace at {
 
+// Flags of Type::storageFromFile and Type::storageFromSharedMemory, the
+// TH_ALLOCATOR_MAPPED_* ones. Without kMapShared, the mapping of a file is
+// private: writes are not seen in the file.
+enum MapFlags : int {
+  kMapShared = 1,
+  kMapExclusive = 4,      // creates the file or object, which must not exist
+  kMapNoCreate = 8,       // opens an existing one
+  kMapReadOnly = 128,     // private, and writes fault
+  kMapPopulate = 256,     // reads all of the file in when mapping it
+  kMapSequential = 512,   // hints on the access pattern
+  kMapRandom = 1024,
+  kMapWillNeed = 2048,
+};
+
 struct Storage {
   Storage() {}
   Storage(const Storage& other) = delete;
@@ -25,6 +39,9 @@ struct Storage {
   virtual const char * toString() const = 0;
 
   virtual Storage& fill(Scalar value) = 0;
+  // starts reading in the data of [offset, offset+size) of a storage on a
+  // file, without waiting for it
+  virtual Storage& prefetch(std::size_t offset, std::size_t size) = 0;
   virtual Storage& set(std::size_t ind, Scalar value) = 0;
   virtual Storage& fast_set(std::size_t ind, Scalar value) = 0;
   virtual Scalar get(std::size_t ind) = 0;
@@ -26,6 +26,7 @@ private:
       storage.data = (long*)(ref.data());
       storage.size = ref.size();
     }
+    storage.capacity = storage.size;
     storage.refcount = 0;
     storage.flag = 0;
     storage.allocator = nullptr;
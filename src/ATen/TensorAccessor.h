@@ -1,6 +1,7 @@
 #pragma once
 #include <cstddef>
 #include <stdint.h>
+#include <utility>
 
 #include "ATen/Type.h"
 
@@ -47,4 +48,110 @@ public:
   }
 };
 
+// TensorSlice is a strided view held by value: unlike TensorAccessor it
+// keeps its own sizes and strides, so that select, narrow and transpose
+// make new slices without allocating or touching a refcount. Like the
+// accessor it does not keep the tensor alive; it is meant for the inner
+// loops of kernels.
+template<typename T, size_t N>
+class TensorSliceBase {
+public:
+  TensorSliceBase(T * data_, const int64_t * sizes_, const int64_t * strides_)
+  : data_(data_) {
+    for(size_t d = 0; d < N; d++) {
+      this->sizes_[d] = sizes_[d];
+      this->strides_[d] = strides_[d];
+    }
+  }
+  T * data() const { return data_; }
+  IntList sizes() const {
+    return IntList(sizes_,N);
+  }
+  IntList strides() const {
+    return IntList(strides_,N);
+  }
+  int64_t stride(int64_t i) const { return strides_[i]; }
+  int64_t size(int64_t i) const { return sizes_[i]; }
+  int64_t numel() const {
+    int64_t n = 1;
+    for(size_t d = 0; d < N; d++) {
+      n *= sizes_[d];
+    }
+    return n;
+  }
+  bool is_contiguous() const {
+    int64_t expected = 1;
+    for(size_t d = N; d-- > 0;) {
+      if(sizes_[d] != 1 && strides_[d] != expected) {
+        return false;
+      }
+      expected *= sizes_[d];
+    }
+    return true;
+  }
+  // the accessor refers to the sizes and strides of this slice
+  TensorAccessor<T,N> accessor() const {
+    return TensorAccessor<T,N>(data_,sizes_,strides_);
+  }
+protected:
+  void narrow_(int64_t dim, int64_t start, int64_t length) {
+    data_ += strides_[dim]*start;
+    sizes_[dim] = length;
+  }
+  void transpose_(int64_t dim1, int64_t dim2) {
+    std::swap(sizes_[dim1], sizes_[dim2]);
+    std::swap(strides_[dim1], strides_[dim2]);
+  }
+  T * data_;
+  int64_t sizes_[N];
+  int64_t strides_[N];
+};
+
+template<typename T, size_t N>
+class TensorSlice : public TensorSliceBase<T,N> {
+public:
+  TensorSlice(T * data_, const int64_t * sizes_, const int64_t * strides_)
+  : TensorSliceBase<T,N>(data_,sizes_,strides_) {}
+
+  TensorSlice<T,N-1> select(int64_t dim, int64_t i) const {
+    int64_t sizes[N-1], strides[N-1];
+    for(size_t d = 0, e = 0; d < N; d++) {
+      if((int64_t)d != dim) {
+        sizes[e] = this->sizes_[d];
+        strides[e] = this->strides_[d];
+        e++;
+      }
+    }
+    return TensorSlice<T,N-1>(this->data_ + this->strides_[dim]*i,sizes,strides);
+  }
+  TensorSlice<T,N-1> operator[](int64_t i) const {
+    return TensorSlice<T,N-1>(this->data_ + this->strides_[0]*i,this->sizes_+1,this->strides_+1);
+  }
+  TensorSlice narrow(int64_t dim, int64_t start, int64_t length) const {
+    TensorSlice r = *this;
+    r.narrow_(dim,start,length);
+    return r;
+  }
+  TensorSlice transpose(int64_t dim1, int64_t dim2) const {
+    TensorSlice r = *this;
+    r.transpose_(dim1,dim2);
+    return r;
+  }
+};
+
+template<typename T>
+class TensorSlice<T,1> : public TensorSliceBase<T,1> {
+public:
+  TensorSlice(T * data_, const int64_t * sizes_, const int64_t * strides_)
+  : TensorSliceBase<T,1>(data_,sizes_,strides_) {}
+  T & operator[](int64_t i) const {
+    return this->data_[this->strides_[0]*i];
+  }
+  TensorSlice narrow(int64_t dim, int64_t start, int64_t length) const {
+    TensorSlice r = *this;
+    r.narrow_(dim,start,length);
+    return r;
+  }
+};
+
 }
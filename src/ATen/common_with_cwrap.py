@@ -1,6 +1,7 @@
 # this code should be common among cwrap and ATen preprocessing
 # for now, I have put it in one place but right now is copied out of cwrap
 
+import re
 from copy import deepcopy
 from itertools import product
 
@@ -145,15 +146,34 @@ class Function(object):
 
 class Argument(object):
 
-    def __init__(self, _type, name, is_optional):
+    def __init__(self, _type, name, is_optional, written=None):
         self.type = _type
         self.name = name
         self.is_optional = is_optional
+        # None when the header does not say, else what written_marker returns
+        self.written = written
 
     def __repr__(self):
         return self.type + ' ' + self.name
 
 
+WRITTEN_MARKER = re.compile(r'\[(IN|OUT|BUFFER)(?: if (\w+))?\]')
+
+
+def written_marker(comment):
+    # [IN] arguments are read, [OUT] and [BUFFER] ones written, and
+    # [OUT if flag] ones written when the flag argument is set
+    markers = WRITTEN_MARKER.findall(comment)
+    if not markers:
+        return None
+    if len(markers) > 1:
+        raise ValueError('more than one of [IN], [OUT] and [BUFFER] in: ' + comment)
+    kind, flag = markers[0]
+    if flag:
+        return flag
+    return kind != 'IN'
+
+
 def parse_header(path):
     with open(path, 'r') as f:
         lines = f.read().split('\n')
@@ -194,5 +214,5 @@ def parse_header(path):
                 t = t + '*'
                 name = name[1:]
             generic_functions[-1].add_argument(
-                Argument(t, name, '[OPTIONAL]' in c))
+                Argument(t, name, '[OPTIONAL]' in c, written_marker(c)))
     return generic_functions
@@ -27,6 +27,7 @@ void ${Type}::copy(const Tensor & src, Tensor & dst) {
   // code generated by function_wrapper
   auto dst_ = checked_cast<${Tensor}>(dst.pImpl,"dst",0,false);
   (void) dst_; //silence unused warning
+  ${unshare}
   switch(src.type().ID()) {
     ${copy_body}
     default:
@@ -57,7 +58,11 @@ def create_one(env, all_types):
                                          cuda=cuda,
                                          state=state,
                                          ))
-    return FUNCTION.substitute(env, copy_body=copy_body)
+    # a CPU destination may share its storage copy-on-write
+    unshare = []
+    if env['Backend'] == 'CPU':
+        unshare.append('{}_unshare(dst_->tensor);'.format(env['THTensor']))
+    return FUNCTION.substitute(env, copy_body=copy_body, unshare=unshare)
 
 
 def create(all_types):
@@ -141,6 +141,21 @@ CHECKED_CAST = {
                                '${THTensor}>(${arg_name},"${arg_name}",${arg_pos})'),
 }
 
+# copies the copy-on-write storage of a CPU tensor before it is written
+UNSHARE = {
+    'THTensor*': CodeTemplate('${THTensor}_unshare(${arg_name}_->tensor);'),
+    'THBoolTensor*': CodeTemplate('THByteTensor_unshare(${arg_name}_->tensor);'),
+    'THIndexTensor*': CodeTemplate('THLongTensor_unshare(${arg_name}_->tensor);'),
+    'THIntegerTensor*': CodeTemplate('THIntTensor_unshare(${arg_name}_->tensor);'),
+}
+
+# data_ptr hands out a pointer that is read as well as written: read-only
+# storages are not unshared, which would raise, and fault when written
+UNSHARE_DATA = CodeTemplate(
+    'if (!(${arg_name}_->tensor->storage && '
+    '(${arg_name}_->tensor->storage->flag & TH_STORAGE_READONLY))) '
+    '${THTensor}_unshare(${arg_name}_->tensor);')
+
 CHECKED_USE = {
     'THTensor*': '{}_->tensor',
     'THSTensor*': '{}_->tensor',
@@ -192,6 +207,13 @@ def is_mutable_formal_argument(argument, option):
     return argument.get('output') or option['inplace'] and argument['name'] == 'self'
 
 
+def is_written_argument(argument, option):
+    # the arguments of NN functions are marked in THNN.h; 'written' is the
+    # name of a flag when they are written only if it is set
+    return (is_mutable_formal_argument(argument, option) or
+            argument.get('written', False) or option.get('cpu_unshare', False))
+
+
 def to_return_type(arg, option):
     t = arg['type']
     rt = TYPE_RETURN.get(t, t)
@@ -447,6 +469,8 @@ def create_derived(backend_type_env, declarations):
         seen_names = set()
         count = 0
         is_cuda = 'CUDA' in backend_type_env['Backend']
+        is_cpu = not is_cuda
+        is_dense_cpu = backend_type_env['Backend'] == 'CPU'
 
         # scalar_check is the heuristic conditions when a result may be a scalar_check
         # if there is a THSize* argument, then its dimensions are used to determine scalar.
@@ -486,6 +510,23 @@ def create_derived(backend_type_env, declarations):
                 if drop_argument(arg, option):
                     body.append(
                         "(void) {}_; //silence unused warning".format(arg['name']))
+                # dense CPU tensors written by the call must not share their
+                # storage copy-on-write; THTensor* is sparse on SparseCPU
+                if (is_cpu and not arg.get('allocate', False) and
+                        arg['type'] in UNSHARE and
+                        (is_dense_cpu or arg['type'] != 'THTensor*') and
+                        is_written_argument(arg, option)):
+                    unshare = (UNSHARE_DATA if option.get('cpu_unshare', False)
+                               else UNSHARE[arg['type']]).substitute(
+                        env, arg_name=arg['name'])
+                    conditions = []
+                    if isinstance(arg.get('written'), str):
+                        conditions.append(arg['written'])
+                    if nullable_argument(arg):
+                        conditions.append(arg['name'] + '_')
+                    if conditions:
+                        unshare = "if ({}) {}".format(' && '.join(conditions), unshare)
+                    body.append(unshare)
                 # resize tensors for special ops that require it
                 if 'resize' in arg:
                     resize = arg['resize']
@@ -534,8 +575,11 @@ def create_derived(backend_type_env, declarations):
         else:
             prefix = env['THTensor'] + '_'
 
+        cname = option['cname']
+        if is_dense_cpu and not is_nn:
+            cname = option.get('cpu_cname', cname)
         call = prefix + \
-            CodeTemplate("${cname}(${derived_actuals})").substitute(env)
+            CodeTemplate("${cname}(${derived_actuals})").substitute(env, cname=cname)
         ret = option['return']
 
         if ret['kind'] == 'arguments':
@@ -149,6 +149,12 @@ def generate_storage_type_and_tensor(backend, density, scalar_type, declarations
         env['state'] = ['context->thc_state']
         env['isCUDA'] = 'true'
         env['storage_device'] = 'return storage->device;'
+        env['storage_unshare'] = ''
+        env['storage_prefetch'] = ''
+        env['storage_from_file'] = \
+            'throw std::runtime_error("CUDA storages cannot map files");'
+        env['storage_from_shared_memory'] = \
+            'throw std::runtime_error("CUDA storages cannot be in shared memory");'
         env['Generator'] = 'CUDAGenerator'
     else:
         env['th_headers'] = ['#include <TH/TH.h>',
@@ -164,6 +170,16 @@ def generate_storage_type_and_tensor(backend, density, scalar_type, declarations
         env['state'] = []
         env['isCUDA'] = 'false'
         env['storage_device'] = 'throw std::runtime_error("CPU storage has no device");'
+        # the data of read-only storages is handed out as it is
+        env['storage_unshare'] = 'if(!(storage->flag & TH_STORAGE_READONLY)) {}_unshare(storage);'.format(
+            env['THStorage'])
+        env['storage_prefetch'] = '{}_prefetch(storage, offset, size);'.format(env['THStorage'])
+        env['storage_from_file'] = \
+            'return std::unique_ptr<Storage>(new {}(context, {}_newWithMapping(filename, size, flags)));'.format(
+                env['Storage'], env['THStorage'])
+        env['storage_from_shared_memory'] = \
+            'return std::unique_ptr<Storage>(new {}(context, {}_newWithSharedMemory(name, size, flags)));'.format(
+                env['Storage'], env['THStorage'])
         env['Generator'] = 'CPUGenerator'
     env['AS_REAL'] = env['ScalarType']
     if scalar_name == "Half":
@@ -8,13 +8,31 @@ TYPE_TRANSLATIONS = {
 }
 
 
-def argument_to_declaration(arg):
+def written(func, arg, backend):
+    # THNN.h says of every tensor argument whether the function writes it;
+    # the CPU wrappers take the written ones out of copy-on-write storages
+    if arg.written is None:
+        if backend == 'CUDA':
+            return False
+        raise ValueError('{} argument {} of {} is not marked [IN], [OUT] or [BUFFER]'
+                         .format(arg.type, arg.name, func.name))
+    if not isinstance(arg.written, bool) and \
+            arg.written not in [a.name for a in func.arguments]:
+        raise ValueError('{} of {} is written if {}, which is not an argument'
+                         .format(arg.name, func.name, arg.written))
+    return arg.written
+
+
+def argument_to_declaration(func, arg, backend):
     typ = TYPE_TRANSLATIONS.get(arg.type, arg.type)
     result = {
         'arg': typ + ' ' + arg.name,
     }
     if arg.is_optional:
         result['default'] = 'nullptr'
+    is_written = 'Tensor' in typ and written(func, arg, backend)
+    if is_written:
+        result['written'] = is_written
     return result
 
 
@@ -24,13 +42,13 @@ def function_to_declaration(func, backend):
         'name': func.name,
         'types': ['Float', 'Double'],
         # skip state argument...
-        'arguments': [argument_to_declaration(a) for a in func.arguments[1:]],
+        'arguments': [argument_to_declaration(func, a, backend) for a in func.arguments[1:]],
         'backends': [backend],
         'variants': ['function'],
     }
 
 
-include_only = '(updateOutput|updateGradInput|accGradParameters|backward)$'
+include_only = '(updateOutput|updateGradInput|updateOutputAndGradInput|accGradParameters|sparseGradParameters|backward)$'
 exclude = 'LookupTable'
 
 
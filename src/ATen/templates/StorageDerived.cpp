@@ -33,6 +33,7 @@ std::size_t ${Storage}::size() const {
 }
 
 void* ${Storage}::data() {
+  ${storage_unshare}
   return storage->data;
 }
 
@@ -60,6 +61,11 @@ auto ${Storage}::fill(Scalar value) -> ${Storage}& {
   return *this;
 }
 
+auto ${Storage}::prefetch(std::size_t offset, std::size_t size) -> ${Storage}& {
+  ${storage_prefetch}
+  return *this;
+}
+
 auto ${Storage}::set(std::size_t ind, Scalar value) -> ${Storage}& {
   ${THStorage}_set(${state,} storage, ind, ${to_th_type}(value.to${ScalarName}()));
   return *this;
@@ -25,6 +25,7 @@ public:
 
   virtual ${Storage}& resize(long new_size) override;
   virtual ${Storage}& fill(Scalar value) override;
+  virtual ${Storage}& prefetch(std::size_t offset, std::size_t size) override;
   virtual ${Storage}& set(std::size_t ind, Scalar value) override;
   virtual ${Storage}& fast_set(std::size_t ind, Scalar value) override;
   virtual Scalar get(std::size_t ind) override;
@@ -142,6 +142,12 @@ struct Tensor {
     AT_ASSERT(dim() == N, "expected %d dims but tensor has %d",N,dim());
     return TensorAccessor<T,N>(data<T>(),sizes().data(),strides().data());
   }
+  template<typename T, size_t N>
+  TensorSlice<T,N> slice() const {
+    static_assert(N > 0, "slice is used for indexing tensor, for scalars use *data<T>()");
+    AT_ASSERT(dim() == N, "expected %d dims but tensor has %d",N,dim());
+    return TensorSlice<T,N>(data<T>(),sizes().data(),strides().data());
+  }
 
   Tensor operator-();
   Tensor& operator+=(const Tensor & other);
@@ -109,6 +109,13 @@ struct Type {
   virtual std::unique_ptr<Storage> storage() = 0;
   virtual std::unique_ptr<Storage> storage(size_t size) = 0;
   virtual std::unique_ptr<Storage> storageFromBlob(void * data, int64_t size) = 0;
+  // maps size elements of a file (all of it when size is 0); flags are
+  // MapFlags, see ATen/Storage.h
+  virtual std::unique_ptr<Storage> storageFromFile(const char * filename, int64_t size, int flags) = 0;
+  // size elements of the shared memory object name ("/name"), which goes
+  // away when the last process using it frees it; flags are kMapExclusive
+  // to create it, or kMapNoCreate to open it
+  virtual std::unique_ptr<Storage> storageFromSharedMemory(const char * name, int64_t size, int flags) = 0;
   virtual std::unique_ptr<Generator> generator() = 0;
   virtual Tensor unsafeTensorFromTH(void * th_pointer, bool retain) = 0;
   virtual const char * toString() const = 0;
@@ -34,6 +34,12 @@ std::unique_ptr<Storage> ${Type}::storageFromBlob(void * data, int64_t size) {
     return std::unique_ptr<Storage>(
       new ${Storage}(context,data,size));
 }
+std::unique_ptr<Storage> ${Type}::storageFromFile(const char * filename, int64_t size, int flags) {
+  ${storage_from_file}
+}
+std::unique_ptr<Storage> ${Type}::storageFromSharedMemory(const char * name, int64_t size, int flags) {
+  ${storage_from_shared_memory}
+}
 Tensor ${Type}::unsafeTensorFromTH(void * th_pointer, bool retain) {
   if (retain)
     ${THTensor}_retain(${state,} (${THTensor}*) th_pointer);
@@ -16,6 +16,8 @@ struct ${Type} : public Type {
   virtual std::unique_ptr<Storage> storage() override;
   virtual std::unique_ptr<Storage> storage(size_t size) override;
   virtual std::unique_ptr<Storage> storageFromBlob(void * data, int64_t size) override;
+  virtual std::unique_ptr<Storage> storageFromFile(const char * filename, int64_t size, int flags) override;
+  virtual std::unique_ptr<Storage> storageFromSharedMemory(const char * name, int64_t size, int flags) override;
   virtual std::unique_ptr<Generator> generator() override;
   virtual const char * toString() const override;
   virtual std::size_t elementSizeInBytes() const override;
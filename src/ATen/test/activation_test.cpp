@@ -0,0 +1,83 @@
+#include "ATen/ATen.h"
+
+#include <iostream>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the pointwise modules against ATen expressions, on contiguous and
+// transposed inputs, and their in-place mode against the out-of-place one.
+
+static void test(Type & type, int64_t rows, int64_t cols, bool transposed) {
+  std::cout << type.toString() << " activations " << rows << "x" << cols
+            << (transposed ? " transposed" : "") << std::endl;
+  auto input = type.randn({rows, cols}) * 3;
+  auto gradOutput = type.randn({rows, cols});
+  if(transposed) {
+    input = input.t();
+    gradOutput = gradOutput.t();
+  }
+  auto pos = input.gt(0).toType(type);
+  auto neg = 1 - pos;
+  auto output = type.tensor();
+  auto gradInput = type.tensor();
+
+  Threshold_updateOutput(input, output, 0, 0, false);
+  ASSERT((output - input * pos).abs().max().toDouble() == 0);
+  Threshold_updateGradInput(input, gradOutput, gradInput, 0, 0, false);
+  ASSERT((gradInput - gradOutput * pos).abs().max().toDouble() == 0);
+
+  LeakyReLU_updateOutput(input, output, 0.25, false);
+  ASSERT((output - input * (pos + neg * 0.25)).abs().max().toDouble() < 1e-6);
+  LeakyReLU_updateGradInput(input, gradOutput, gradInput, 0.25, false);
+  ASSERT((gradInput - gradOutput * (pos + neg * 0.25)).abs().max().toDouble() < 1e-6);
+
+  ELU_updateOutput(input, output, 1.5, false);
+  ASSERT((output - input * pos - (input.exp() - 1) * neg * 1.5).abs().max().toDouble() < 1e-5);
+
+  Sigmoid_updateOutput(input, output);
+  ASSERT((output - input.sigmoid()).abs().max().toDouble() < 1e-6);
+  Sigmoid_updateGradInput(input, gradOutput, gradInput, output);
+  ASSERT((gradInput - gradOutput * output * (1 - output)).abs().max().toDouble() < 1e-6);
+
+  HardShrink_updateOutput(input, output, 0.5);
+  ASSERT((output - input * input.abs().gt(0.5).toType(type)).abs().max().toDouble() == 0);
+  Abs_updateOutput(input, output);
+  ASSERT((output - input.abs()).abs().max().toDouble() == 0);
+
+  // in-place on a copy gives the same result, for the output and the gradient
+  auto expected = type.tensor();
+  auto copy = input.clone();
+  Threshold_updateOutput(input, expected, 0.25, -2, false);
+  Threshold_updateOutput(copy, output, 0.25, -2, true);
+  ASSERT((output - expected).abs().max().toDouble() == 0);
+  ASSERT((copy - expected).abs().max().toDouble() == 0);
+  auto gradCopy = gradOutput.clone();
+  LeakyReLU_updateGradInput(input, gradOutput, expected, 0.25, false);
+  LeakyReLU_updateGradInput(input, gradCopy, gradInput, 0.25, true);
+  ASSERT((gradCopy - expected).abs().max().toDouble() == 0);
+
+  // modules without an inplace flag accept the input as output
+  copy = input.clone();
+  SoftShrink_updateOutput(input, expected, 0.5);
+  SoftShrink_updateOutput(copy, copy, 0.5);
+  ASSERT((copy - expected).abs().max().toDouble() == 0);
+}
+
+int main() {
+  for(bool transposed : {false, true}) {
+    test(CPU(kFloat), 7, 13, transposed);
+    test(CPU(kDouble), 7, 13, transposed);
+    test(CPU(kFloat), 500, 400, transposed);
+  }
+
+  auto input = CPU(kFloat).randn({64, 1 << 16});
+  auto output = CPU(kFloat).tensor();
+  std::cout << "  Threshold 64x65536: "
+            << timeit(5, [&] { Threshold_updateOutput(input, output, 0, 0, false); })
+            << " us, in-place: "
+            << timeit(5, [&] { Threshold_updateOutput(input, input, 0, 0, true); })
+            << " us" << std::endl;
+  return 0;
+}
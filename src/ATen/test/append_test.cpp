@@ -0,0 +1,145 @@
+#include "ATen/ATen.h"
+#include "TH/TH.h"
+
+#include <iostream>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the capacity of storages and Tensor::append_, and compares
+// appending rows one batch at a time with append_ and with cat.
+
+static void testReserve() {
+  THFloatStorage *s = THFloatStorage_newWithSize(10);
+  for(int i = 0; i < 10; i++) {
+    s->data[i] = i;
+  }
+  ASSERT(THFloatStorage_capacity(s) == 10);
+
+  // reserving keeps the size and the contents
+  THFloatStorage_reserve(s, 100);
+  ASSERT(s->size == 10 && THFloatStorage_capacity(s) == 100);
+  ASSERT(s->data[9] == 9);
+
+  // growing within the capacity does not move the data
+  float *data = s->data;
+  THFloatStorage_resize(s, 60);
+  ASSERT(s->data == data && s->size == 60 && s->capacity == 100);
+  THFloatStorage_reserve(s, 50);
+  ASSERT(s->capacity == 100);
+
+  // growing past it, or shrinking, reallocates to the exact size
+  THFloatStorage_resize(s, 20);
+  ASSERT(s->size == 20 && s->capacity == 20 && s->data[9] == 9);
+  THFloatStorage_resize(s, 30);
+  ASSERT(s->capacity == 30);
+  THFloatStorage_free(s);
+
+  // with an allocator that has no realloc
+  THAllocator noRealloc = THDefaultAllocator;
+  noRealloc.realloc = NULL;
+  s = THFloatStorage_newWithAllocator(4, &noRealloc, NULL);
+  s->data[3] = 3;
+  THFloatStorage_reserve(s, 40);
+  ASSERT(s->size == 4 && s->capacity == 40 && s->data[3] == 3);
+  THFloatStorage_free(s);
+}
+
+static void testAppend() {
+  auto a = CPU(kFloat).randn({3, 4});
+  auto b = CPU(kFloat).randn({5, 4});
+
+  // an empty tensor takes the shape of what is appended
+  auto t = CPU(kFloat).tensor();
+  t.append_(a);
+  ASSERT(t.sizes().equals({3, 4}) && t.equal(a));
+  t.append_(b);
+  ASSERT(t.sizes().equals({8, 4}));
+  ASSERT(t.equal(cat({a, b}, 0)));
+
+  // sources may be non-contiguous
+  auto c = CPU(kFloat).randn({4, 2}).t();
+  t.append_(c);
+  t.append_(a.narrow(0, 1, 1));
+  ASSERT(t.size(0) == 11 && t.equal(cat({a, b, c, a.narrow(0, 1, 1)}, 0)));
+
+  // appending grows the storage geometrically
+  auto th = (THFloatTensor*)t.unsafeGetTH(false);
+  int moves = 0;
+  float *data = t.data<float>();
+  for(int i = 0; i < 10000; i++) {
+    t.append_(a.narrow(0, i % 3, 1));
+    if(t.data<float>() != data) {
+      moves++;
+      data = t.data<float>();
+    }
+  }
+  ASSERT(t.size(0) == 10011 && th->storage->capacity >= th->storage->size);
+  ASSERT(moves < 30);
+  ASSERT(t.select(0, 10010).equal(a.select(0, 9999 % 3)));
+
+  // views, and tensors sharing their storage, move to a storage of their
+  // own instead of writing over the rest of it
+  auto parent = CPU(kFloat).randn({4, 2});
+  auto before = parent.clone();
+  auto head = parent.narrow(0, 0, 2);
+  head.append_(a.narrow(1, 0, 2).narrow(0, 0, 1));
+  ASSERT(parent.equal(before) && head.size(0) == 3);
+  ASSERT(head.narrow(0, 0, 2).equal(before.narrow(0, 0, 2)));
+  ASSERT(head.select(0, 2).equal(a.select(0, 0).narrow(0, 0, 2)));
+  auto shared = CPU(kFloat).tensor();
+  shared.append_(a);
+  auto alias = shared.view({-1});
+  shared.append_(b);
+  ASSERT(alias.equal(a.view({-1})) && shared.equal(cat({a, b}, 0)));
+  ASSERT(alias.data_ptr() != shared.data_ptr());
+
+  // mismatched shapes are refused
+  bool threw = false;
+  try {
+    t.append_(CPU(kFloat).randn({2, 3}));
+  } catch(std::runtime_error &e) {
+    threw = true;
+  }
+  ASSERT(threw);
+  threw = false;
+  try {
+    auto nc = CPU(kFloat).randn({4, 3}).t();
+    nc.append_(CPU(kFloat).randn({1, 4}));
+  } catch(std::runtime_error &e) {
+    threw = true;
+  }
+  ASSERT(threw);
+
+  // other types
+  auto l = CPU(kLong).tensor();
+  l.append_(CPU(kLong).ones({2, 2}));
+  l.append_(CPU(kLong).ones({1, 2}));
+  ASSERT(l.sum().toLong() == 6);
+}
+
+static void bench() {
+  auto row = CPU(kFloat).randn({16, 64});
+  const int n = 2000;
+  auto append = timeit(1, [&] {
+    auto t = CPU(kFloat).tensor();
+    for(int i = 0; i < n; i++) {
+      t.append_(row);
+    }
+  });
+  auto concat = timeit(1, [&] {
+    auto t = row.clone();
+    for(int i = 1; i < n; i++) {
+      t = cat({t, row}, 0);
+    }
+  });
+  std::cout << n << " appends of 16x64: append_ " << append << " us, cat " << concat << " us" << std::endl;
+}
+
+int main() {
+  testReserve();
+  testAppend();
+  bench();
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include "ATen/ATen.h"
+#include "ATen/ArenaScope.h"
+
+#include <iostream>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the arena scope: results match the ones computed without it,
+// tensors from outside the scope survive it, and the arena stops growing
+// once a step has run.
+
+// a step with plenty of temporaries
+static Tensor step(const Tensor & x, const Tensor & w) {
+  auto h = x.mm(w).tanh();
+  for(int64_t i = 0; i < h.size(1); i++) {
+    auto column = h.select(1, i);
+    column.mul_(0.5).add_(x.select(1, i % x.size(1)));
+  }
+  return h.t().contiguous().sum(1);
+}
+
+static void testStep() {
+  std::cout << "step" << std::endl;
+  auto x = CPU(kDouble).randn({32, 20});
+  auto w = CPU(kDouble).randn({20, 30});
+  auto ref = step(x, w);
+
+  auto total = CPU(kDouble).zeros({30});
+  ptrdiff_t reserved = 0;
+  for(int i = 0; i < 5; i++) {
+    ArenaScope scope;
+    auto y = step(x, w);
+    ASSERT(y.equal(ref));
+    total.add_(y);
+    if(i == 1) {
+      reserved = ArenaScope::reserved();
+      ASSERT(reserved > 0);
+    }
+    if(i > 1) {
+      ASSERT(ArenaScope::reserved() == reserved);
+    }
+  }
+  ASSERT(((total - ref * 5).abs().max().toDouble()) < 1e-10);
+  ASSERT(x.size(0) == 32 && w.size(1) == 30);
+}
+
+static void testOutputs() {
+  std::cout << "outputs" << std::endl;
+  // tensors created before the scope can be resized inside it
+  auto out = CPU(kFloat).tensor();
+  auto empty = CPU(kFloat).tensor();
+  {
+    ArenaScope scope;
+    auto a = CPU(kFloat).ones({100, 100});
+    out.resize_({100, 100}).copy_(a * 2);
+    {
+      ArenaScope inner;
+      auto b = CPU(kFloat).ones({1000});
+      empty.resize_({1000}).copy_(b);
+    }
+    // a is still fine after the inner scope
+    ASSERT(a.sum().toDouble() == 10000);
+  }
+  ASSERT(out.sum().toDouble() == 20000);
+  ASSERT(empty.sum().toDouble() == 1000);
+}
+
+static void testErrors() {
+  std::cout << "errors" << std::endl;
+  auto a = CPU(kFloat).ones({3, 4});
+  try {
+    ArenaScope scope;
+    auto b = CPU(kFloat).ones({5, 6});
+    a.mm(b);  // throws
+    ASSERT(false);
+  } catch(std::runtime_error &) {
+  }
+  // the scope is closed again
+  ASSERT(!THArena_active());
+  ASSERT(a.sum().toDouble() == 12);
+}
+
+static void testConvolution() {
+  std::cout << "convolution" << std::endl;
+  // a convolution step in a scope: its temporary headers come from the arena
+  auto input = CPU(kFloat).randn({4, 3, 12, 12});
+  auto weight = CPU(kFloat).randn({8, 3, 3, 3});
+  auto bias = CPU(kFloat).randn({8});
+  auto ref = CPU(kFloat).tensor();
+  auto finput = CPU(kFloat).tensor();
+  auto fgradInput = CPU(kFloat).tensor();
+  SpatialConvolutionMM_updateOutput(input, ref, weight, bias, finput, fgradInput, 3, 3, 1, 1, 1, 1);
+  auto output = CPU(kFloat).tensor();
+  {
+    ArenaScope scope;
+    SpatialConvolutionMM_updateOutput(input, output, weight, bias, finput, fgradInput,
+                                      3, 3, 1, 1, 1, 1);
+    // temporaries of the step
+    auto output_t = CPU(kFloat).tensor();
+    auto finput_t = CPU(kFloat).tensor();
+    SpatialConvolutionMM_updateOutput(input, output_t, weight, bias, finput_t, fgradInput,
+                                      3, 3, 1, 1, 1, 1);
+    ASSERT(output_t.equal(ref));
+  }
+  ASSERT(output.equal(ref));
+}
+
+int main() {
+  testStep();
+  testOutputs();
+  testErrors();
+  testConvolution();
+  ArenaScope::release();
+  ASSERT(ArenaScope::reserved() == 0);
+
+  auto x = CPU(kFloat).randn({64, 64});
+  auto w = CPU(kFloat).randn({64, 64});
+  std::cout << "  step without arena: "
+            << timeit(200, [&] { step(x, w); }) << " us" << std::endl;
+  std::cout << "  step in arena scope: "
+            << timeit(200, [&] { ArenaScope scope; step(x, w); }) << " us" << std::endl;
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include "ATen/ATen.h"
+#include "TH/THCachingAllocator.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the caching CPU allocator: reuse of freed blocks, the thread
+// caches, and that emptyCPUCache gives everything back once it is free.
+
+static THCachingAllocatorStats stats() {
+  THCachingAllocatorStats s;
+  THCachingAllocator_getStats(&s);
+  return s;
+}
+
+static void testReuse() {
+  std::cout << "reuse" << std::endl;
+  auto before = stats();
+  {
+    auto a = CPU(kFloat).ones({100, 100});
+    auto b = CPU(kFloat).ones({1000, 1000});  // a large block
+    ASSERT(a.sum().toDouble() == 10000);
+    ASSERT(b.sum().toDouble() == 1000000);
+    auto s = stats();
+    ASSERT(s.allocated >= (ptrdiff_t)(4 * (10000 + 1000000)));
+    ASSERT(s.reserved == s.allocated + s.cached);
+  }
+  auto freed = stats();
+  ASSERT(freed.allocated == before.allocated);
+
+  // the same sizes again come from the cache
+  for(int i = 0; i < 10; i++) {
+    auto a = CPU(kFloat).ones({100, 100});
+    auto b = CPU(kFloat).ones({1000, 1000});
+    ASSERT(a.sum().toDouble() == 10000);
+  }
+  auto s = stats();
+  ASSERT(s.systemAllocations == freed.systemAllocations);
+  ASSERT(s.threadCacheHits > freed.threadCacheHits);
+  ASSERT(s.allocated == before.allocated);
+}
+
+static void testGrowth() {
+  std::cout << "growth" << std::endl;
+  // resizes go through realloc, which keeps the data
+  auto a = CPU(kDouble).tensor();
+  for(int64_t n = 1; n <= 100000; n *= 3) {
+    int64_t old = a.numel();
+    a.resize_({n});
+    auto acc = a.accessor<double, 1>();
+    for(int64_t i = 0; i < old; i++) {
+      ASSERT(acc[i] == i);
+    }
+    for(int64_t i = old; i < n; i++) {
+      acc[i] = i;
+    }
+  }
+}
+
+static void testThreads(int nthreads) {
+  std::cout << "threads " << nthreads << std::endl;
+  auto before = stats();
+  std::vector<std::thread> threads;
+  for(int t = 0; t < nthreads; t++) {
+    threads.emplace_back([t] {
+      std::vector<Tensor> kept;
+      for(int i = 0; i < 500; i++) {
+        int64_t n = 1 + (i * 7919 + t * 104729) % 20000;
+        auto x = CPU(kFloat).ones({n});
+        ASSERT(x.sum().toDouble() == n);
+        if(i % 3 == 0) {
+          kept.push_back(x);
+        }
+        if(kept.size() > 20) {
+          kept.erase(kept.begin());
+        }
+      }
+    });
+  }
+  for(auto & thread : threads) {
+    thread.join();
+  }
+  auto s = stats();
+  ASSERT(s.allocated == before.allocated);
+  ASSERT(s.reserved == s.allocated + s.cached);
+  // the caches of the threads went back to the shared lists with them
+  ASSERT(s.threadCaches == before.threadCaches);
+  ASSERT(s.threadCacheHits >= before.threadCacheHits);
+}
+
+int main() {
+  ASSERT(!globalContext().hasCPUCachingAllocator());
+  auto untouched = CPU(kFloat).ones({10});  // from the default allocator
+  globalContext().setCPUCachingAllocator(true);
+  ASSERT(globalContext().hasCPUCachingAllocator());
+
+  testReuse();
+  testGrowth();
+  testThreads(1);
+  testThreads(8);
+
+  globalContext().emptyCPUCache();
+  auto s = stats();
+  ASSERT(s.cached == 0 && s.allocated == 0 && s.reserved == 0 && s.segments == 0);
+
+  globalContext().setCPUCachingAllocator(false);
+  std::cout << "  ones(256x256) default: "
+            << timeit(1000, [] { CPU(kFloat).ones({256, 256}); }) << " us" << std::endl;
+  globalContext().setCPUCachingAllocator(true);
+  std::cout << "  ones(256x256) caching: "
+            << timeit(1000, [] { CPU(kFloat).ones({256, 256}); }) << " us" << std::endl;
+
+  globalContext().setCPUCachingAllocator(false);
+  globalContext().emptyCPUCache();
+  untouched.zero_();
+  return 0;
+}
@@ -0,0 +1,222 @@
+#include "ATen/ATen.h"
+#include "TH/TH.h"
+
+#include <iostream>
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the copy-on-write clone of storages and tensors, and compares
+// clone() with and without it, for clones that are only read and for
+// clones that are written.
+
+static float *rawData(Tensor t) {
+  // without data<T>(), which unshares
+  return ((THFloatTensor*)t.unsafeGetTH(false))->storage->data;
+}
+
+static bool isShared(Tensor t) {
+  return ((THFloatTensor*)t.unsafeGetTH(false))->storage->flag & TH_STORAGE_COW;
+}
+
+static void testStorage() {
+  THFloatStorage *a = THFloatStorage_newWithSize(100);
+  for(int i = 0; i < 100; i++) {
+    a->data[i] = i;
+  }
+  THFloatStorage *b = THFloatStorage_newCopyOnWrite(a);
+  THFloatStorage *c = THFloatStorage_newCopyOnWrite(b);
+  ASSERT(b->data == a->data && c->data == a->data);
+  ASSERT(((THCopyOnWriteContext*)a->allocatorContext)->refcount == 3);
+
+  // the writer gets a copy, the others keep the data
+  float *data = a->data;
+  THFloatStorage_set(b, 0, -1);
+  ASSERT(b->data != data && b->data[0] == -1 && b->data[99] == 99);
+  ASSERT(a->data[0] == 0 && c->data[0] == 0);
+  THFloatStorage_free(b);
+
+  // and the last one takes it back
+  THFloatStorage_free(c);
+  THFloatStorage_unshare(a);
+  ASSERT(a->data == data && !(a->flag & TH_STORAGE_COW));
+
+  // resizing unshares
+  b = THFloatStorage_newCopyOnWrite(a);
+  THFloatStorage_resize(b, 200);
+  ASSERT(b->size == 200 && b->data[99] == 99 && a->data == data);
+  THFloatStorage_resizeAndZero(a, 10);
+  ASSERT(a->data[9] == 0 && b->data[9] == 9);
+  THFloatStorage_free(a);
+  THFloatStorage_free(b);
+}
+
+// threads sharing one storage: the first shares race each other, and the
+// unshares of the source race the shares of its clones
+static void testThreads() {
+  for(int round = 0; round < 200; round++) {
+    THFloatStorage *a = THFloatStorage_newWithSize(1000);
+    for(int i = 0; i < 1000; i++) {
+      a->data[i] = i;
+    }
+    std::atomic<int> failures(0);
+    std::vector<THFloatStorage*> clones(8);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 8; t++) {
+      threads.emplace_back([&, t] {
+        THFloatStorage *b = THFloatStorage_newCopyOnWrite(a);
+        THFloatStorage *c = THFloatStorage_newCopyOnWrite(b);
+        THFloatStorage_set(b, 0, t + 1);
+        if(c->data[0] != 0 || c->data[999] != 999 || b->data[0] != t + 1 || b->data[999] != 999) {
+          failures++;
+        }
+        THFloatStorage_free(c);
+        clones[t] = b;
+      });
+    }
+    threads.emplace_back([&] {
+      for(int i = 0; i < 10; i++) {
+        THFloatStorage_unshare(a);
+      }
+    });
+    for(auto & thread : threads) {
+      thread.join();
+    }
+    ASSERT(failures == 0);
+    THFloatStorage_unshare(a);
+    ASSERT(!(a->flag & TH_STORAGE_COW) && a->data[0] == 0 && a->data[999] == 999);
+    THFloatStorage_free(a);
+    for(auto b : clones) {
+      THFloatStorage_free(b);
+    }
+  }
+}
+
+static void testClone() {
+  globalContext().setCopyOnWriteClone(true);
+  ASSERT(globalContext().hasCopyOnWriteClone());
+
+  auto a = CPU(kFloat).randn({64, 32});
+  auto ref = a.toType(CPU(kDouble));
+  auto b = a.clone();
+  ASSERT(rawData(b) == rawData(a) && b.equal(a));
+
+  // in-place and out= functions write to a copy
+  b.add_(1);
+  ASSERT(rawData(b) != rawData(a) && a.toType(CPU(kDouble)).equal(ref));
+  auto c = a.clone();
+  at::add_out(a, a, c);
+  ASSERT(a.toType(CPU(kDouble)).equal(ref));
+
+  // so do copies, resizes and NN functions
+  c = a.clone();
+  c.copy_(b);
+  ASSERT(a.toType(CPU(kDouble)).equal(ref) && c.equal(b));
+  c = a.clone();
+  c.resize_({64, 64});
+  ASSERT(c.view({-1}).narrow(0, 0, 2048).equal(a.view({-1})));
+  c = a.clone();
+  at::Threshold_updateOutput(c, c, 0, 0, true);
+  ASSERT(a.toType(CPU(kDouble)).equal(ref) && c.min().toFloat() >= 0);
+
+  // but not the tensors they only read, nor printing
+  c = a.clone();
+  auto out = CPU(kFloat).tensor();
+  at::Sigmoid_updateOutput(c, out);
+  at::Threshold_updateOutput(c, out, 0, 0, false);
+  ASSERT(isShared(c) && rawData(c) == rawData(a));
+  auto d = ref.clone();
+  std::ostringstream printed;
+  printed << d;
+  ASSERT(((THDoubleTensor*)d.unsafeGetTH(false))->storage->flag & TH_STORAGE_COW);
+
+  // the parent is unshared when written as well
+  c = a.clone();
+  a.mul_(2);
+  ASSERT(c.toType(CPU(kDouble)).equal(ref));
+  ASSERT(a.toType(CPU(kDouble)).equal(ref * 2));
+
+  // and so are tensors whose data pointer is taken
+  c = a.clone();
+  ASSERT(isShared(c));
+  float *p = c.data<float>();
+  ASSERT(!isShared(c) && p != rawData(a));
+  p[0] = 1000;
+  ASSERT(a.data<float>()[0] != 1000);
+
+  // views of a clone see its writes
+  c = a.clone();
+  auto row = c.select(0, 3);
+  c.fill_(5);
+  ASSERT(row.sum().toFloat() == 5 * 32);
+
+  // clones of parts of a storage, or of non-contiguous tensors, are copies
+  ASSERT(!isShared(a.narrow(0, 1, 10).clone()));
+  ASSERT(!isShared(a.t().clone()));
+
+  globalContext().setCopyOnWriteClone(false);
+  ASSERT(!isShared(a.clone()));
+}
+
+static void testMapping() {
+  char name[] = "/tmp/cow_testXXXXXX";
+  int fd = mkstemp(name);
+  ASSERT(fd >= 0);
+  close(fd);
+  THFloatStorage *file = THFloatStorage_newWithMapping(name, 1000, TH_ALLOCATOR_MAPPED_SHARED);
+  THFloatStorage_fill(file, 7);
+  THSetCopyOnWriteClone(1);
+
+  // a private mapping is shared
+  THFloatStorage *priv = THFloatStorage_newWithMapping(name, 1000, 0);
+  THFloatTensor *t = THFloatTensor_newWithStorage1d(priv, 0, 1000, 1);
+  THFloatTensor *clone = THFloatTensor_newCopyOnWrite(t);
+  ASSERT(clone->storage->data == priv->data);
+  THFloatTensor_unshare(clone);
+  THFloatStorage_set(clone->storage, 0, 1);
+  ASSERT(priv->data[0] == 7 && file->data[0] == 7);
+  THFloatTensor_free(clone);
+  THFloatTensor_free(t);
+  THFloatStorage_free(priv);
+
+  // a shared one, whose writes are meant for the file, is not
+  t = THFloatTensor_newWithStorage1d(file, 0, 1000, 1);
+  clone = THFloatTensor_newCopyOnWrite(t);
+  ASSERT(clone->storage->data != file->data && clone->storage->data[999] == 7);
+  THFloatTensor_free(clone);
+  THFloatTensor_free(t);
+
+  THSetCopyOnWriteClone(0);
+  THFloatStorage_free(file);
+  unlink(name);
+}
+
+static void bench() {
+  auto a = CPU(kFloat).randn({1 << 24});  // 64 MiB
+  auto read = [&] { a.clone().sum(); };
+  auto write = [&] { a.clone().add_(1); };
+  auto eagerRead = timeit(5, read);
+  auto eagerWrite = timeit(5, write);
+  globalContext().setCopyOnWriteClone(true);
+  auto cowRead = timeit(5, read);
+  auto cowWrite = timeit(5, write);
+  globalContext().setCopyOnWriteClone(false);
+  std::cout << "clone + sum of 64 MiB: " << eagerRead << " us eager, " << cowRead << " us copy-on-write" << std::endl;
+  std::cout << "clone + add_ of 64 MiB: " << eagerWrite << " us eager, " << cowWrite << " us copy-on-write" << std::endl;
+}
+
+int main() {
+  testStorage();
+  testThreads();
+  testClone();
+  testMapping();
+  bench();
+  return 0;
+}
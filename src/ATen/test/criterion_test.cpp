@@ -0,0 +1,156 @@
+#include "ATen/ATen.h"
+
+#include <iostream>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the loss criterions against the same loss written with tensor ops,
+// and the fused updateOutputAndGradInput entry points against separate
+// updateOutput and updateGradInput calls.
+
+static void check(const char * name, Tensor output, Tensor gradInput,
+                  Tensor fusedOutput, Tensor fusedGradInput, double loss_ref) {
+  std::cout << "  " << name << std::endl;
+  double loss = output.sum().toDouble();
+  ASSERT(std::abs(loss - loss_ref) <= 1e-10 * (1 + std::abs(loss_ref)));
+  ASSERT(std::abs(fusedOutput.sum().toDouble() - loss) <= 1e-12 * (1 + std::abs(loss)));
+  ASSERT((fusedGradInput - gradInput).abs().max().toDouble() == 0);
+}
+
+static void test(int64_t rows, int64_t cols, bool transposed, bool sizeAverage) {
+  std::cout << "Criterions " << rows << "x" << cols << (transposed ? " transposed" : "")
+            << (sizeAverage ? " sizeAverage" : "") << std::endl;
+  auto make = [&](Tensor t) { return transposed ? t.t() : t; };
+  auto dims = transposed ? IntList{cols, rows} : IntList{rows, cols};
+  auto input = make(CPU(kDouble).randn(dims));
+  auto target = make(CPU(kDouble).randn(dims));
+  auto prob = make(CPU(kDouble).rand(dims));
+  auto sign = make(CPU(kDouble).randn(dims).sign());
+  auto weights = make(CPU(kDouble).rand(dims));
+  double n = sizeAverage ? rows * cols : 1;
+
+  auto output = CPU(kDouble).zeros({1}), fusedOutput = CPU(kDouble).zeros({1});
+  auto gradInput = CPU(kDouble).tensor(), fusedGradInput = CPU(kDouble).tensor();
+
+  MSECriterion_updateOutput(input, target, output, sizeAverage);
+  MSECriterion_updateGradInput(input, target, gradInput, sizeAverage);
+  MSECriterion_updateOutputAndGradInput(input, target, fusedOutput, fusedGradInput, sizeAverage);
+  check("MSE", output, gradInput, fusedOutput, fusedGradInput,
+        (input - target).pow(2).sum().toDouble() / n);
+  ASSERT((gradInput - (input - target) * (2 / n)).abs().max().toDouble() < 1e-12);
+
+  AbsCriterion_updateOutput(input, target, output, sizeAverage);
+  AbsCriterion_updateGradInput(input, target, gradInput, sizeAverage);
+  AbsCriterion_updateOutputAndGradInput(input, target, fusedOutput, fusedGradInput, sizeAverage);
+  check("Abs", output, gradInput, fusedOutput, fusedGradInput,
+        (input - target).abs().sum().toDouble() / n);
+
+  auto diff = (input - target).abs();
+  auto small = diff.lt(1).toType(CPU(kDouble));
+  SmoothL1Criterion_updateOutput(input, target, output, sizeAverage);
+  SmoothL1Criterion_updateGradInput(input, target, gradInput, sizeAverage);
+  SmoothL1Criterion_updateOutputAndGradInput(input, target, fusedOutput, fusedGradInput, sizeAverage);
+  check("SmoothL1", output, gradInput, fusedOutput, fusedGradInput,
+        (small * diff.pow(2) * 0.5 + (1 - small) * (diff - 0.5)).sum().toDouble() / n);
+  ASSERT((gradInput - (input - target).clamp(-1, 1) / n).abs().max().toDouble() < 1e-12);
+
+  SoftMarginCriterion_updateOutput(input, sign, output, sizeAverage);
+  SoftMarginCriterion_updateGradInput(input, sign, gradInput, sizeAverage);
+  SoftMarginCriterion_updateOutputAndGradInput(input, sign, fusedOutput, fusedGradInput, sizeAverage);
+  check("SoftMargin", output, gradInput, fusedOutput, fusedGradInput,
+        ((-input * sign).exp() + 1).log().sum().toDouble() / n);
+
+  DistKLDivCriterion_updateOutput(input, prob, output, sizeAverage);
+  DistKLDivCriterion_updateGradInput(input, prob, gradInput, sizeAverage);
+  DistKLDivCriterion_updateOutputAndGradInput(input, prob, fusedOutput, fusedGradInput, sizeAverage);
+  check("DistKLDiv", output, gradInput, fusedOutput, fusedGradInput,
+        (prob * (prob.log() - input)).sum().toDouble() / n);
+
+  MarginCriterion_updateOutput(input, sign, output, sizeAverage, 0.5);
+  MarginCriterion_updateGradInput(input, sign, gradInput, sizeAverage, 0.5);
+  MarginCriterion_updateOutputAndGradInput(input, sign, fusedOutput, fusedGradInput, sizeAverage, 0.5);
+  check("Margin", output, gradInput, fusedOutput, fusedGradInput,
+        (0.5 - input * sign).clamp(0, 1e300).sum().toDouble() / n);
+
+  auto x = make(CPU(kDouble).rand(dims)) * 0.9 + 0.05;
+  auto bce = -(prob * x.log() + (1 - prob) * (1 - x).log());
+  BCECriterion_updateOutput(x, prob, output, sizeAverage);
+  BCECriterion_updateGradInput(x, prob, gradInput, sizeAverage);
+  BCECriterion_updateOutputAndGradInput(x, prob, fusedOutput, fusedGradInput, sizeAverage);
+  check("BCE", output, gradInput, fusedOutput, fusedGradInput, bce.sum().toDouble() / n);
+  BCECriterion_updateOutput(x, prob, output, sizeAverage, weights);
+  BCECriterion_updateGradInput(x, prob, gradInput, sizeAverage, weights);
+  BCECriterion_updateOutputAndGradInput(x, prob, fusedOutput, fusedGradInput, sizeAverage, weights);
+  check("BCE weighted", output, gradInput, fusedOutput, fusedGradInput,
+        (bce * weights).sum().toDouble() / n);
+
+  // out of range inputs are reported once the parallel loop is done
+  auto bad = x.clone();
+  bad.view({-1})[rows * cols / 2] = 1.5;
+  bool thrown = false;
+  try {
+    BCECriterion_updateOutput(bad, prob, output, sizeAverage);
+  } catch (std::runtime_error &) {
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+static void testMultiMargin(int64_t nframe, int64_t dim, int p, bool weighted) {
+  std::cout << "MultiMargin " << nframe << "x" << dim << " p " << p
+            << (weighted ? " weighted" : "") << std::endl;
+  auto input = CPU(kDouble).randn({nframe, dim});
+  auto target = CPU(kLong).zeros({nframe});
+  auto weights = weighted ? CPU(kDouble).rand({dim}) : Tensor();
+  auto in = input.accessor<double, 2>();
+  auto tg = target.accessor<int64_t, 1>();
+  double loss_ref = 0;
+  for(int64_t t = 0; t < nframe; t++) {
+    tg[t] = (t * 7) % dim;
+    double w = weighted ? weights.accessor<double, 1>()[tg[t]] : 1;
+    for(int64_t d = 0; d < dim; d++) {
+      double z = 0.5 - in[t][tg[t]] + in[t][d];
+      if(d != tg[t] && z > 0) loss_ref += (p == 1 ? z : z * z) * w;
+    }
+  }
+  loss_ref /= dim * nframe;
+
+  auto output = CPU(kDouble).zeros({1}), fusedOutput = CPU(kDouble).zeros({1});
+  auto gradInput = CPU(kDouble).tensor(), fusedGradInput = CPU(kDouble).tensor();
+  MultiMarginCriterion_updateOutput(input, target, output, true, p, weights, 0.5);
+  MultiMarginCriterion_updateGradInput(input, target, gradInput, true, p, weights, 0.5);
+  MultiMarginCriterion_updateOutputAndGradInput(input, target, fusedOutput, fusedGradInput, true, p, weights, 0.5);
+  check("MultiMargin", output, gradInput, fusedOutput, fusedGradInput, loss_ref);
+  // each frame's gradient sums to zero
+  ASSERT(gradInput.sum(1).abs().max().toDouble() < 1e-12);
+}
+
+int main() {
+  for(bool sizeAverage : {false, true}) {
+    test(3, 5, false, sizeAverage);
+    test(300, 400, false, sizeAverage);
+    test(300, 400, true, sizeAverage);
+  }
+  for(int p : {1, 2}) {
+    for(bool weighted : {false, true}) {
+      testMultiMargin(1, 7, p, weighted);
+      testMultiMargin(500, 100, p, weighted);
+    }
+  }
+
+  auto input = CPU(kFloat).randn({256, 1 << 14});
+  auto target = CPU(kFloat).randn({256, 1 << 14});
+  auto output = CPU(kFloat).zeros({1});
+  auto gradInput = CPU(kFloat).tensor();
+  std::cout << "  MSECriterion 256x16384: separate "
+            << timeit(5, [&] {
+                 MSECriterion_updateOutput(input, target, output, true);
+                 MSECriterion_updateGradInput(input, target, gradInput, true);
+               })
+            << " us, fused "
+            << timeit(5, [&] { MSECriterion_updateOutputAndGradInput(input, target, output, gradInput, true); })
+            << " us" << std::endl;
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include "ATen/ATen.h"
+
+#include <iostream>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks EmbeddingBag against LookupTable-style index_select followed by a
+// reduction over each bag, for the output and for the dense and sparse
+// gradients w.r.t. the weight.
+
+static const int SUM = 0, MEAN = 1, MAX = 2;
+
+static void test(Type & type, int64_t nbag, int64_t numw, int64_t dim, int mode,
+                 bool weighted, int iters) {
+  std::cout << type.toString() << " EmbeddingBag mode " << mode << " bags " << nbag
+            << " rows " << numw << " dim " << dim << (weighted ? " weighted" : "") << std::endl;
+  // bag b has b % 5 indices, so that some bags are empty
+  auto offsets = CPU(kLong).zeros({nbag});
+  auto off = offsets.accessor<int64_t, 1>();
+  int64_t numel = 0;
+  for(int64_t b = 0; b < nbag; b++) {
+    off[b] = numel;
+    numel += b % 5;
+  }
+  auto input = CPU(kLong).zeros({numel});
+  auto bagOf = CPU(kLong).zeros({numel});
+  auto in = input.accessor<int64_t, 1>();
+  auto bag = bagOf.accessor<int64_t, 1>();
+  for(int64_t i = 0, b = 0; i < numel; i++) {
+    while(b + 1 < nbag && off[b + 1] <= i) b++;
+    // skewed towards the first rows
+    in[i] = (i * i * 7919) % numw % (1 + (i % 3) * numw / 3);
+    bag[i] = b;
+  }
+  auto weight = type.randn({numw, dim});
+  auto psw = weighted ? type.rand({numel}) : Tensor();
+
+  // reference: pooled output, and d(output)/d(weight) applied to gradOutput
+  auto gradOutput = type.randn({nbag, dim});
+  auto output_ref = type.zeros({nbag, dim});
+  auto gradWeight_ref = type.zeros({numw, dim});
+  auto rows = weight.index_select(0, input);
+  auto w = type.ones({numel});
+  if(weighted) w.copy_(psw);
+  if(mode == MEAN) {
+    auto wa = w.accessor<double, 1>();
+    for(int64_t i = 0; i < numel; i++) {
+      int64_t b = bag[i];
+      int64_t len = (b + 1 < nbag ? off[b + 1] : numel) - off[b];
+      wa[i] /= len;
+    }
+  }
+  if(mode != MAX) {
+    auto ww = w.unsqueeze(1).expand({numel, dim});
+    output_ref.index_add_(0, bagOf, rows * ww);
+    gradWeight_ref.index_add_(0, input, gradOutput.index_select(0, bagOf) * ww);
+  } else {
+    auto o = output_ref.accessor<double, 2>();
+    auto g = gradWeight_ref.accessor<double, 2>();
+    auto go = gradOutput.accessor<double, 2>();
+    auto r = rows.accessor<double, 2>();
+    for(int64_t b = 0; b < nbag; b++) {
+      int64_t start = off[b], end = b + 1 < nbag ? off[b + 1] : numel;
+      for(int64_t d = 0; d < dim && end > start; d++) {
+        int64_t best = start;
+        for(int64_t i = start + 1; i < end; i++) {
+          if(r[i][d] > r[best][d]) best = i;
+        }
+        o[b][d] = r[best][d];
+        g[in[best]][d] += go[b][d];
+      }
+    }
+  }
+
+  auto output = type.tensor();
+  auto maxIndices = CPU(kLong).tensor();
+  EmbeddingBag_updateOutput(input, offsets, weight, output, psw, maxIndices, mode);
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-10);
+
+  auto gradWeight = type.zeros({numw, dim});
+  EmbeddingBag_accGradParameters(input, offsets, gradOutput, gradWeight, psw, maxIndices, mode, 1);
+  ASSERT((gradWeight - gradWeight_ref).abs().max().toDouble() < 1e-10);
+
+  auto gradIndices = CPU(kLong).tensor();
+  auto gradValues = type.tensor();
+  EmbeddingBag_sparseGradParameters(input, offsets, gradOutput, gradIndices, gradValues,
+                                    psw, maxIndices, numw, mode, 1);
+  auto idx = gradIndices.accessor<int64_t, 2>();
+  for(int64_t s = 1; s < gradIndices.size(1); s++) {
+    ASSERT(idx[0][s - 1] < idx[0][s]);
+  }
+  auto dense = type.zeros({numw, dim});
+  dense.index_add_(0, gradIndices.select(0, 0), gradValues);
+  ASSERT((dense - gradWeight_ref).abs().max().toDouble() < 1e-10);
+
+  if(iters > 0) {
+    auto fused = timeit(iters, [&] {
+      EmbeddingBag_updateOutput(input, offsets, weight, output, psw, maxIndices, mode);
+    });
+    auto unfused = timeit(iters, [&] {
+      output_ref.zero_();
+      output_ref.index_add_(0, bagOf, weight.index_select(0, input));
+    });
+    std::cout << "  index_select + index_add: " << unfused << " us, EmbeddingBag: "
+              << fused << " us" << std::endl;
+  }
+}
+
+int main() {
+  for(int mode : {SUM, MEAN, MAX}) {
+    test(CPU(kDouble), 3, 4, 3, mode, false, 0);
+    test(CPU(kDouble), 50, 20, 7, mode, false, 0);
+    test(CPU(kDouble), 3000, 500, 33, mode, mode != MAX, 0);
+  }
+  test(CPU(kDouble), 20000, 100000, 64, SUM, false, 5);
+  return 0;
+}
@@ -0,0 +1,235 @@
+#include "ATen/ATen.h"
+
+#include <iostream>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the CPU LSTMFused/GRUFused kernels against the equivalent sequence
+// of unfused pointwise ops, and reports the time taken by both.
+
+static void unfusedLSTM(Tensor input, Tensor hidden, Tensor b1, Tensor b2,
+                        Tensor cx, Tensor & hy, Tensor & cy) {
+  int64_t hsz = cx.size(1);
+  auto gates = input + hidden + b1.expand(input.sizes()) + b2.expand(input.sizes());
+  auto ig = gates.narrow(1, 0*hsz, hsz).sigmoid();
+  auto fg = gates.narrow(1, 1*hsz, hsz).sigmoid();
+  auto cg = gates.narrow(1, 2*hsz, hsz).tanh();
+  auto og = gates.narrow(1, 3*hsz, hsz).sigmoid();
+  cy = fg * cx + ig * cg;
+  hy = og * cy.tanh();
+}
+
+static void unfusedGRU(Tensor input, Tensor hidden, Tensor b1, Tensor b2,
+                       Tensor hx, Tensor & hy) {
+  int64_t hsz = hx.size(1);
+  auto gi = input + b1.expand(input.sizes());
+  auto gh = hidden + b2.expand(hidden.sizes());
+  auto rg = (gi.narrow(1, 0*hsz, hsz) + gh.narrow(1, 0*hsz, hsz)).sigmoid();
+  auto ig = (gi.narrow(1, 1*hsz, hsz) + gh.narrow(1, 1*hsz, hsz)).sigmoid();
+  auto ng = (gi.narrow(1, 2*hsz, hsz) + rg * gh.narrow(1, 2*hsz, hsz)).tanh();
+  hy = ng + ig * (hx - ng);
+}
+
+static void test(Type & type, int64_t batch, int64_t hsz, int iters) {
+  std::cout << type.toString() << " batch " << batch << " hidden " << hsz << std::endl;
+  {
+    auto input = type.randn({batch, 4*hsz});
+    auto hidden = type.randn({batch, 4*hsz});
+    auto b1 = type.randn({4*hsz});
+    auto b2 = type.randn({4*hsz});
+    auto cx = type.randn({batch, hsz});
+    auto hy = type.tensor(), cy = type.tensor();
+    auto hy_ref = type.tensor(), cy_ref = type.tensor();
+
+    unfusedLSTM(input, hidden, b1, b2, cx, hy_ref, cy_ref);
+    auto gates = input.clone();
+    LSTMFused_updateOutput(gates, hidden, b1, b2, cx, hy, cy);
+    ASSERT((hy - hy_ref).abs().max().toDouble() < 1e-4);
+    ASSERT((cy - cy_ref).abs().max().toDouble() < 1e-4);
+
+    // backward: gradient of sum(hy) w.r.t. cx is og * (1 - tanh(cy)^2) * fg
+    auto gradOutput = type.ones({batch, hsz});
+    auto gradOutputCell = type.zeros({batch, hsz});
+    auto gradInGates = type.zeros({batch, 4*hsz});
+    auto gradInputCx = type.tensor();
+    LSTMFused_updateGradInput(gates, gradInGates, cx, cy, gradOutput, gradOutputCell, gradInputCx);
+    ASSERT((gradInputCx - gates.narrow(1, 3*hsz, hsz) * (1 - cy.tanh().pow(2)) * gates.narrow(1, hsz, hsz))
+           .abs().max().toDouble() < 1e-4);
+
+    auto unfused = timeit(iters, [&] { unfusedLSTM(input, hidden, b1, b2, cx, hy_ref, cy_ref); });
+    auto fused = timeit(iters, [&] {
+      gates.copy_(input);
+      LSTMFused_updateOutput(gates, hidden, b1, b2, cx, hy, cy);
+    });
+    std::cout << "  LSTM unfused: " << unfused << " us, fused: " << fused << " us" << std::endl;
+  }
+  {
+    auto input = type.randn({batch, 3*hsz});
+    auto hidden = type.randn({batch, 3*hsz});
+    auto b1 = type.randn({3*hsz});
+    auto b2 = type.randn({3*hsz});
+    auto hx = type.randn({batch, hsz});
+    auto storage = type.zeros({batch, 5*hsz});
+    auto hy = type.tensor(), hy_ref = type.tensor();
+
+    unfusedGRU(input, hidden, b1, b2, hx, hy_ref);
+    GRUFused_updateOutput(input, hidden, b1, b2, hx, hy, storage);
+    ASSERT((hy - hy_ref).abs().max().toDouble() < 1e-4);
+
+    auto gradOutput = type.ones({batch, hsz});
+    auto gradInInput = type.zeros({batch, 3*hsz});
+    auto gradInHidden = type.zeros({batch, 3*hsz});
+    auto gradInputHx = type.tensor();
+    GRUFused_updateGradInput(gradInInput, gradInHidden, gradOutput, gradInputHx, storage);
+    ASSERT((gradInputHx - storage.narrow(1, hsz, hsz)).abs().max().toDouble() < 1e-4);
+
+    auto unfused = timeit(iters, [&] { unfusedGRU(input, hidden, b1, b2, hx, hy_ref); });
+    auto fused = timeit(iters, [&] { GRUFused_updateOutput(input, hidden, b1, b2, hx, hy, storage); });
+    std::cout << "  GRU unfused: " << unfused << " us, fused: " << fused << " us" << std::endl;
+  }
+}
+
+// Per-timestep reference for LSTMSequence/GRUSequence: one input GEMM, one
+// recurrent GEMM and one fused kernel call per timestep.
+static void stepwiseRNN(bool lstm, Tensor input, Tensor batchSizes, Tensor wIH, Tensor wHH,
+                        Tensor b1, Tensor b2, Tensor hx, Tensor cx,
+                        Tensor & output, Tensor & hy, Tensor & cy) {
+  auto & type = input.type();
+  int64_t hsz = hx.size(1);
+  output = type.zeros({input.size(0), hsz});
+  hy = hx.clone();
+  cy = lstm ? cx.clone() : type.tensor();
+  auto sizes = batchSizes.accessor<int64_t, 1>();
+  int64_t off = 0;
+  for(int64_t t = 0; t < sizes.size(0); t++) {
+    int64_t bs = sizes[t];
+    auto igates = input.narrow(0, off, bs).mm(wIH.t());
+    auto hgates = hy.narrow(0, 0, bs).mm(wHH.t());
+    auto h = type.tensor();
+    if(lstm) {
+      auto c = type.tensor();
+      LSTMFused_updateOutput(igates, hgates, b1, b2, cy.narrow(0, 0, bs), h, c);
+      cy.narrow(0, 0, bs).copy_(c);
+    } else {
+      auto storage = type.zeros({bs, 5*hsz});
+      GRUFused_updateOutput(igates, hgates, b1, b2, hy.narrow(0, 0, bs), h, storage);
+    }
+    hy.narrow(0, 0, bs).copy_(h);
+    output.narrow(0, off, bs).copy_(h);
+    off += bs;
+  }
+}
+
+static void testSequence(Type & type, bool lstm, int64_t batch, int64_t isz, int64_t hsz,
+                         int64_t steps, bool check_grad, int iters) {
+  std::cout << type.toString() << (lstm ? " LSTMSequence" : " GRUSequence")
+            << " batch " << batch << " input " << isz << " hidden " << hsz
+            << " steps " << steps << std::endl;
+  int64_t factor = lstm ? 4 : 3;
+  // sequence b runs for steps - b timesteps (at least one)
+  auto batchSizes = CPU(kLong).zeros({steps});
+  auto sizes = batchSizes.accessor<int64_t, 1>();
+  int64_t nrows = 0;
+  for(int64_t t = 0; t < steps; t++) {
+    int64_t bs = 0;
+    for(int64_t b = 0; b < batch; b++) {
+      if(t < std::max<int64_t>(steps - b, 1)) bs++;
+    }
+    sizes[t] = bs;
+    nrows += bs;
+  }
+  auto input = type.randn({nrows, isz});
+  auto wIH = type.randn({factor*hsz, isz}) / 5;
+  auto wHH = type.randn({factor*hsz, hsz}) / 5;
+  auto b1 = type.randn({factor*hsz});
+  auto b2 = type.randn({factor*hsz});
+  auto hx = type.randn({batch, hsz});
+  auto cx = type.randn({batch, hsz});
+  auto output = type.tensor(), hy = type.tensor(), cy = type.tensor();
+  auto gates = type.tensor(), cells = type.tensor(), packed = type.tensor();
+
+  auto forward = [&] {
+    if(lstm) {
+      LSTMSequence_updateOutput(input, batchSizes, wIH, wHH, b1, b2, hx, cx,
+                                output, hy, cy, gates, cells, packed);
+    } else {
+      GRUSequence_updateOutput(input, batchSizes, wIH, wHH, b1, b2, hx,
+                               output, hy, gates, packed);
+    }
+  };
+  Tensor output_ref, hy_ref, cy_ref;
+  auto stepwise = [&] {
+    stepwiseRNN(lstm, input, batchSizes, wIH, wHH, b1, b2, hx, cx, output_ref, hy_ref, cy_ref);
+  };
+
+  forward();
+  stepwise();
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-4);
+  ASSERT((hy - hy_ref).abs().max().toDouble() < 1e-4);
+  if(lstm) {
+    ASSERT((cy - cy_ref).abs().max().toDouble() < 1e-4);
+  }
+
+  if(check_grad) {
+    // loss = sum(output * R) + sum(hy * Rh), checked against finite differences
+    auto R = type.randn({nrows, hsz});
+    auto Rh = type.randn({batch, hsz});
+    auto loss = [&] {
+      forward();
+      return (output * R).sum().toDouble() + (hy * Rh).sum().toDouble();
+    };
+    forward();
+    auto gradInput = type.tensor(), gradHx = type.tensor(), gradCx = type.tensor();
+    auto gradWIH = type.zeros(wIH.sizes()), gradWHH = type.zeros(wHH.sizes());
+    auto gradB1 = type.zeros(b1.sizes()), gradB2 = type.zeros(b2.sizes());
+    auto gradGates = type.tensor();
+    if(lstm) {
+      LSTMSequence_backward(input, batchSizes, wIH, wHH, hx, cx, output, gates, cells,
+                            R, Rh, Tensor(), gradInput, gradHx, gradCx,
+                            gradWIH, gradWHH, gradB1, gradB2, gradGates, 1);
+    } else {
+      GRUSequence_backward(input, batchSizes, wIH, wHH, hx, output, gates,
+                           R, Rh, gradInput, gradHx,
+                           gradWIH, gradWHH, gradB1, gradB2, gradGates, 1);
+    }
+    Tensor params[] = {input, hx, wIH, wHH, b1, b2};
+    Tensor grads[] = {gradInput, gradHx, gradWIH, gradWHH, gradB1, gradB2};
+    for(int p = 0; p < 6; p++) {
+      auto grad_t = grads[p].contiguous();
+      double * flat = params[p].data<double>();
+      double * grad = grad_t.data<double>();
+      for(int64_t i = 0; i < params[p].numel(); i += 7) {
+        double x = flat[i];
+        double eps = 1e-6;
+        flat[i] = x + eps;
+        double lp = loss();
+        flat[i] = x - eps;
+        double lm = loss();
+        flat[i] = x;
+        double numeric = (lp - lm) / (2 * eps);
+        ASSERTM(std::abs(numeric - grad[i]) < 1e-5,
+                "param %d index %ld: numeric %f analytic %f", p, (long) i, numeric, grad[i]);
+      }
+    }
+  }
+
+  if(iters > 0) {
+    auto fused = timeit(iters, forward);
+    auto unfused = timeit(iters, stepwise);
+    std::cout << "  per-step: " << unfused << " us, whole sequence: " << fused << " us" << std::endl;
+  }
+}
+
+int main() {
+  test(CPU(kFloat), 4, 5, 1);
+  test(CPU(kDouble), 3, 300, 1);
+  test(CPU(kFloat), 64, 1024, 20);
+  for(bool lstm : {true, false}) {
+    testSequence(CPU(kDouble), lstm, 4, 3, 5, 4, true, 0);
+    testSequence(CPU(kDouble), lstm, 3, 7, 70, 3, false, 0);
+    testSequence(CPU(kFloat), lstm, 32, 256, 256, 50, false, 5);
+  }
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include "ATen/ATen.h"
+
+#include <iostream>
+#include <cmath>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the bilinear grid sampler against a direct evaluation at every grid
+// point, the gradient of the grid against its derivative, and the gradient
+// of the input through the identity
+// <gradOutput, f(input)> == <f'(gradOutput), input>.
+
+static void testGridSampler(int64_t n, int64_t c, int64_t ih, int64_t iw, int64_t h, int64_t w) {
+  std::cout << "Grid sampler " << n << "x" << c << "x" << ih << "x" << iw << " -> " << h << "x" << w << std::endl;
+  auto input = CPU(kDouble).randn({n, c, ih, iw});
+  // some of the grid points fall outside the input
+  auto grid = CPU(kDouble).randn({n, h, w, 2}) * 0.75;
+  auto gradOutput = CPU(kDouble).randn({n, c, h, w});
+  auto output_ref = CPU(kDouble).zeros({n, c, h, w});
+  auto gradGrid_ref = CPU(kDouble).zeros({n, h, w, 2});
+  auto in = input.accessor<double, 4>();
+  auto g = grid.accessor<double, 4>();
+  auto go = gradOutput.accessor<double, 4>();
+  auto o = output_ref.accessor<double, 4>();
+  auto gg = gradGrid_ref.accessor<double, 4>();
+  auto at = [&](int64_t b, int64_t p, int64_t y, int64_t x) {
+    return x >= 0 && x < iw && y >= 0 && y < ih ? in[b][p][y][x] : 0.;
+  };
+  for(int64_t b = 0; b < n; b++) {
+    for(int64_t y = 0; y < h; y++) {
+      for(int64_t x = 0; x < w; x++) {
+        double ix = (g[b][y][x][0] + 1) / 2 * (iw - 1);
+        double iy = (g[b][y][x][1] + 1) / 2 * (ih - 1);
+        int64_t ix0 = std::floor(ix), iy0 = std::floor(iy);
+        double fx = ix - ix0, fy = iy - iy0;
+        for(int64_t p = 0; p < c; p++) {
+          double nw = at(b, p, iy0, ix0), ne = at(b, p, iy0, ix0 + 1);
+          double sw = at(b, p, iy0 + 1, ix0), se = at(b, p, iy0 + 1, ix0 + 1);
+          o[b][p][y][x] = nw * (1 - fx) * (1 - fy) + ne * fx * (1 - fy) + sw * (1 - fx) * fy + se * fx * fy;
+          gg[b][y][x][0] += ((ne - nw) * (1 - fy) + (se - sw) * fy) * go[b][p][y][x] * (iw - 1) / 2;
+          gg[b][y][x][1] += ((sw - nw) * (1 - fx) + (se - ne) * fx) * go[b][p][y][x] * (ih - 1) / 2;
+        }
+      }
+    }
+  }
+
+  auto output = CPU(kDouble).tensor();
+  SpatialGridSamplerBilinear_updateOutput(input, grid, output);
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-10);
+  auto gradInput = CPU(kDouble).tensor();
+  auto gradGrid = CPU(kDouble).tensor();
+  SpatialGridSamplerBilinear_updateGradInput(input, gradInput, grid, gradGrid, gradOutput);
+  ASSERT((gradGrid - gradGrid_ref).abs().max().toDouble() < 1e-10);
+  // the output is linear in the input
+  ASSERT(std::abs((gradOutput * output).sum().toDouble() - (gradInput * input).sum().toDouble()) < 1e-9);
+
+  // gradients written into copy-on-write clones leave their sources alone
+  auto source = CPU(kDouble).randn({n, h, w, 2});
+  auto source_ref = source.clone();
+  globalContext().setCopyOnWriteClone(true);
+  gradGrid = source.clone();
+  SpatialGridSamplerBilinear_updateGradInput(input, gradInput, grid, gradGrid, gradOutput);
+  globalContext().setCopyOnWriteClone(false);
+  ASSERT((gradGrid - gradGrid_ref).abs().max().toDouble() < 1e-10);
+  ASSERT(source.equal(source_ref));
+}
+
+int main() {
+  testGridSampler(2, 3, 5, 7, 4, 6);
+  testGridSampler(1, 70, 30, 30, 30, 30);
+  testGridSampler(5, 2, 1, 4, 3, 2);
+
+  auto input = CPU(kFloat).randn({16, 64, 56, 56});
+  auto output = CPU(kFloat).tensor();
+  auto grid = CPU(kFloat).rand({16, 56, 56, 2}) * 2 - 1;
+  std::cout << "  SpatialGridSamplerBilinear 16x64x56x56: "
+            << timeit(3, [&] { SpatialGridSamplerBilinear_updateOutput(input, grid, output); })
+            << " us" << std::endl;
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include "ATen/ATen.h"
+#include "TH/TH.h"
+
+#include <iostream>
+#include <sys/resource.h>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the zero-initialized allocation path of zeros() and of the
+// resize-then-zero functions, and compares creating large zero tensors
+// with it to filling them with zeros.
+
+static long minorFaults() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt;
+}
+
+static bool allZero(const float *data, int64_t n) {
+  for(int64_t i = 0; i < n; i++) {
+    if(data[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void testCalloc() {
+  // a reused block comes back zeroed, whether it is zeroed lazily or not
+  for(ptrdiff_t size : {100, 5000, 1 << 20, (1 << 22) + 100}) {
+    char *p = (char*)THAlloc(size);
+    memset(p, 0xff, size);
+    THFree(p);
+    float *q = (float*)THCalloc(size);
+    ASSERT(allZero(q, size / sizeof(float)));
+    ASSERT(((char*)q)[size-1] == 0);
+    THFree(q);
+  }
+}
+
+static void testResizeAndZero() {
+  // a tensor that grows gets zeros, not its old contents
+  auto t = CPU(kFloat).ones({10});
+  auto th = (THFloatTensor*)t.unsafeGetTH(false);
+  THLongStorage *size = THLongStorage_newWithSize1(1 << 20);
+  THFloatTensor_zeros(th, size);
+  ASSERT(t.numel() == 1 << 20 && t.sum().toDouble() == 0);
+
+  // and one that does not is zeroed in place
+  t.fill_(3);
+  THFloatTensor_zeros(th, size);
+  ASSERT(t.sum().toDouble() == 0);
+  THLongStorage_free(size);
+
+  // an offset into a shared storage keeps what lies before it
+  auto base = CPU(kFloat).ones({8});
+  auto tail = base.narrow(0, 4, 4);
+  THFloatTensor_resizeAndZeroNd((THFloatTensor*)tail.unsafeGetTH(false), 1, std::vector<long>{100}.data(), NULL);
+  ASSERT(tail.numel() == 100 && tail.sum().toDouble() == 0);
+  ASSERT(base.sum().toDouble() == 4);
+
+  auto ref = CPU(kFloat).randn({3, 500, 7});
+  auto g = CPU(kFloat).ones({2});
+  THFloatTensor_resizeAsAndZero((THFloatTensor*)g.unsafeGetTH(false), (THFloatTensor*)ref.unsafeGetTH(false));
+  ASSERT(g.sizes().equals(ref.sizes()) && g.abs().sum().toDouble() == 0);
+
+  // storages whose allocator has no calloc are zeroed too
+  THSetStorageAllocator(&THCachingAllocator);
+  auto c = CPU(kFloat).ones({4});
+  c.fill_(5);
+  auto big = CPU(kFloat).zeros({1 << 20});
+  ASSERT(big.sum().toDouble() == 0);
+  auto bth = (THFloatTensor*)c.unsafeGetTH(false);
+  THFloatTensor_resizeAndZeroNd(bth, 1, std::vector<long>{1 << 18}.data(), NULL);
+  ASSERT(c.sum().toDouble() == 0);
+  THSetStorageAllocator(NULL);
+
+  // eye zeroes through the same path
+  auto e = CPU(kFloat).eye(300, 200);
+  ASSERT(e.sum().toDouble() == 200);
+}
+
+static void bench() {
+  const int64_t n = 1 << 26;  // 256 MiB of floats
+  long faults = minorFaults();
+  auto zeros = timeit(3, [&] { CPU(kFloat).zeros({n}); });
+  long zerosFaults = (minorFaults() - faults) / 3;
+  faults = minorFaults();
+  auto fill = timeit(3, [&] { CPU(kFloat).tensor({n}).fill_(0); });
+  long fillFaults = (minorFaults() - faults) / 3;
+  std::cout << "zeros(" << n << "): " << zeros << " us, " << zerosFaults << " faults"
+            << "; tensor + fill_(0): " << fill << " us, " << fillFaults << " faults" << std::endl;
+
+  // a mostly unwritten accumulator only pays for the pages it touches
+  faults = minorFaults();
+  auto sparse = timeit(3, [&] {
+    auto acc = CPU(kFloat).zeros({n});
+    float *data = acc.data<float>();
+    for(int64_t i = 0; i < n; i += n / 64) {
+      data[i] += 1;
+    }
+  });
+  std::cout << "zeros + 64 scattered writes: " << sparse << " us, "
+            << (minorFaults() - faults) / 3 << " faults" << std::endl;
+}
+
+int main() {
+  testCalloc();
+  testResizeAndZero();
+  bench();
+  return 0;
+}
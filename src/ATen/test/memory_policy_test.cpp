@@ -0,0 +1,110 @@
+#include "ATen/ATen.h"
+#include "TH/TH.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <sys/resource.h>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the memory policy of THAlloc and reports, for each policy, the
+// cost of allocating and first writing a large tensor, of reading it back,
+// and of a GEMM on weights allocated under it. The page faults show whether
+// huge pages were used; the NUMA policies only make a difference on a
+// machine with several nodes.
+
+static long minorFaults() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt;
+}
+
+static void testPolicy() {
+  THMemoryPolicy saved, policy;
+  THGetMemoryPolicy(&saved);
+  policy = saved;
+  policy.hugePages = 1;
+  policy.numa = TH_NUMA_INTERLEAVE;
+  policy.firstTouch = 1;
+  policy.minSize = 1 << 20;
+  THSetMemoryPolicy(&policy);
+
+  THMemoryPolicy got;
+  THGetMemoryPolicy(&got);
+  ASSERT(got.hugePages == 1 && got.numa == TH_NUMA_INTERLEAVE && got.firstTouch == 1);
+  ASSERT(got.minSize == 1 << 20);
+  ASSERT(THMemoryPolicy_alignment(1 << 20) == TH_HUGE_PAGE_SIZE);
+  ASSERT(THMemoryPolicy_alignment((1 << 20) - 1) == 64);
+  ASSERT(THMemoryPolicy_numNodes() >= 1);
+
+  // large blocks are aligned for huge pages and keep their contents when
+  // reallocated under the policy
+  int *p = (int*)THAlloc(4 << 20);
+  ASSERT((uintptr_t)p % TH_HUGE_PAGE_SIZE == 0);
+  for(int i = 0; i < (1 << 20); i++) {
+    p[i] = i;
+  }
+  p = (int*)THRealloc(p, 8 << 20);
+  bool same = true;
+  for(int i = 0; i < (1 << 20); i++) {
+    same = same && p[i] == i;
+  }
+  ASSERT(same);
+  THFree(p);
+
+  // and so do storages
+  auto t = CPU(kFloat).tensor({1 << 20});
+  t.fill_(2);
+  ASSERT(t.sum().toDouble() == 2 << 20);
+
+  THSetMemoryPolicy(&saved);
+}
+
+static void bench(const char *name, int hugePages, int numa, int firstTouch) {
+  THMemoryPolicy saved, policy;
+  THGetMemoryPolicy(&saved);
+  policy = saved;
+  policy.hugePages = hugePages;
+  policy.numa = numa;
+  policy.firstTouch = firstTouch;
+  THSetMemoryPolicy(&policy);
+
+  const int64_t n = 1 << 24;  // 64 MiB of floats
+  Tensor t;
+  long faults = minorFaults();
+  auto init = timeit(1, [&] {
+    t = CPU(kFloat).tensor({n});
+    t.fill_(1);
+  });
+  faults = minorFaults() - faults;
+  ASSERT(t.sum().toDouble() == n);
+  auto read = timeit(3, [&] { t.sum(); });
+
+  auto w = CPU(kFloat).randn({1024, 1024});
+  auto x = CPU(kFloat).randn({1024, 1024});
+  auto gemm = timeit(2, [&] { w.mm(x); });
+
+  std::cout << std::left << std::setw(24) << name << std::right
+            << " alloc+fill " << std::setw(7) << init << " us"
+            << std::setw(8) << faults << " faults"
+            << "   sum " << std::setw(7) << read << " us"
+            << "   gemm " << std::setw(7) << gemm << " us" << std::endl;
+
+  THSetMemoryPolicy(&saved);
+}
+
+int main() {
+  testPolicy();
+
+  std::cout << THMemoryPolicy_numNodes() << " NUMA node(s)" << std::endl;
+  bench("default", 0, TH_NUMA_DEFAULT, 0);
+  bench("huge pages", 1, TH_NUMA_DEFAULT, 0);
+  bench("first touch", 0, TH_NUMA_DEFAULT, 1);
+  bench("local + first touch", 0, TH_NUMA_LOCAL, 1);
+  bench("interleave", 0, TH_NUMA_INTERLEAVE, 0);
+  bench("huge pages + interleave", 1, TH_NUMA_INTERLEAVE, 1);
+  return 0;
+}
@@ -0,0 +1,213 @@
+#include "ATen/ATen.h"
+#include "TH/TH.h"
+
+#include <atomic>
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the accounting of the memory of CPU tensors, and reports what
+// creating and freeing a small tensor costs with the site histogram on
+// and off, and how much of it is the accounting.
+
+static MemoryStats byAllocator(const char * name) {
+  for(auto & entry : globalContext().memoryStatsByAllocator()) {
+    if(entry.first == name) {
+      return entry.second;
+    }
+  }
+  return {0, 0, 0, 0};
+}
+
+static void testCounters() {
+  auto & ctx = globalContext();
+  auto total = ctx.memoryStats();
+  auto floats = ctx.memoryStats(kFloat);
+  auto doubles = ctx.memoryStats(kDouble);
+  {
+    auto t = CPU(kFloat).tensor({1000});
+    ASSERT(ctx.memoryStats().live == total.live + 4000);
+    ASSERT(ctx.memoryStats(kFloat).live == floats.live + 4000);
+    ASSERT(ctx.memoryStats(kFloat).allocations == floats.allocations + 1);
+    ASSERT(ctx.memoryStats(kDouble).live == doubles.live);
+    ASSERT(ctx.memoryStats().peak >= total.live + 4000);
+
+    // growing counts the new size, in place or not
+    t.resize_({3000});
+    ASSERT(ctx.memoryStats().live == total.live + 12000);
+    auto l = CPU(kLong).tensor();
+    l.append_(CPU(kLong).ones({100}));
+    l.append_(CPU(kLong).ones({100}));
+    auto th = (THLongTensor*)l.unsafeGetTH(false);
+    ASSERT(ctx.memoryStats(kLong).live >= (int64_t)(th->storage->capacity * sizeof(int64_t)));
+  }
+  ASSERT(ctx.memoryStats().live == total.live);
+  ASSERT(ctx.memoryStats(kFloat).frees > floats.frees);
+
+  // data that is adopted or given up
+  float *data = (float*)THAlloc(400);
+  THFloatStorage *s = THFloatStorage_newWithData(data, 100);
+  ASSERT(ctx.memoryStats().live == total.live + 400);
+  THFloatStorage_clearFlag(s, TH_STORAGE_FREEMEM);
+  ASSERT(ctx.memoryStats().live == total.live);
+  THFloatStorage_free(s);
+  ASSERT(ctx.memoryStats().live == total.live);
+  THFree(data);
+
+  // by allocator
+  auto caching = byAllocator("caching");
+  THSetStorageAllocator(&THCachingAllocator);
+  {
+    auto t = CPU(kDouble).tensor({10});
+    ASSERT(byAllocator("caching").live == caching.live + 80);
+  }
+  THSetStorageAllocator(NULL);
+  ASSERT(byAllocator("caching").live == caching.live);
+  ASSERT(byAllocator("default").live >= 0);
+
+  // a buffer shared copy-on-write counts once
+  ctx.setCopyOnWriteClone(true);
+  {
+    auto a = CPU(kFloat).ones({1000});
+    auto b = a.clone();
+    ASSERT(ctx.memoryStats().live == total.live + 4000);
+    b.add_(1);
+    ASSERT(ctx.memoryStats().live == total.live + 8000);
+    auto c = a.clone();
+    a.reset();
+    c.add_(1);
+    ASSERT(ctx.memoryStats().live == total.live + 8000);
+  }
+  ctx.setCopyOnWriteClone(false);
+  ASSERT(ctx.memoryStats().live == total.live);
+
+  // the counts of a running thread are added when the counters are read
+  floats = ctx.memoryStats(kFloat);
+  std::atomic<int> step(0);
+  std::thread worker([&] {
+    auto t = CPU(kFloat).tensor({100});
+    step = 1;
+    while(step != 2) {
+      std::this_thread::yield();
+    }
+  });
+  while(step != 1) {
+    std::this_thread::yield();
+  }
+  ASSERT(ctx.memoryStats().live == total.live + 400);
+  ASSERT(ctx.memoryStats(kFloat).allocations == floats.allocations + 1);
+  step = 2;
+  worker.join();
+  ASSERT(ctx.memoryStats().live == total.live);
+}
+
+static void testScope() {
+  auto & ctx = globalContext();
+  auto outer = CPU(kFloat).tensor({1 << 20});
+  outer.reset();
+  auto before = ctx.memoryStats();
+  {
+    MemoryScope scope;
+    ASSERT(scope.base() == before.live);
+    ASSERT(scope.peak() == before.live);
+    ASSERT(ctx.memoryStats().peak == before.peak);
+    {
+      MemoryScope inner;
+      CPU(kFloat).tensor({1000});
+      ASSERT(inner.peak() - inner.base() == 4000);
+    }
+    CPU(kFloat).tensor({100});
+    ASSERT(scope.peak() - scope.base() == 4000);
+    // the allocations of other threads are not the scope's
+    std::thread([] { CPU(kFloat).tensor({1 << 20}); }).join();
+    ASSERT(scope.peak() - scope.base() == 4000);
+  }
+  // the peak from before the scopes is kept
+  ASSERT(ctx.memoryStats().peak >= before.peak);
+  ASSERT(ctx.memoryStats().peak >= before.live + (4 << 20));
+
+  ctx.resetPeakMemory();
+  ASSERT(ctx.memoryStats().peak == ctx.memoryStats().live);
+}
+
+static void testSites() {
+  auto & ctx = globalContext();
+  ctx.resetMemorySites();
+  ctx.setMemorySiteTracking(true);
+  ASSERT(ctx.hasMemorySiteTracking());
+  {
+    MemorySite site("forward");
+    CPU(kFloat).tensor({10});
+    CPU(kFloat).tensor({20});
+    {
+      MemorySite inner("loss");
+      CPU(kDouble).tensor({5});
+    }
+  }
+  CPU(kFloat).tensor({1});
+  {
+    // another string with the same label
+    static char label[] = "loss";
+    MemorySite site(label);
+    CPU(kFloat).tensor({2});
+  }
+  ctx.setMemorySiteTracking(false);
+  CPU(kFloat).tensor({1});
+
+  int found = 0;
+  for(auto & site : ctx.memorySites()) {
+    if(!strcmp(site.site, "forward")) {
+      ASSERT(site.allocations == 2 && site.bytes == 120);
+      found++;
+    } else if(!strcmp(site.site, "loss")) {
+      ASSERT(site.allocations == 2 && site.bytes == 48);
+      found++;
+    } else if(!strcmp(site.site, "unknown")) {
+      ASSERT(site.allocations == 1 && site.bytes == 4);
+      found++;
+    }
+  }
+  ASSERT(found == 3);
+  ctx.resetMemorySites();
+  ASSERT(ctx.memorySites().size() == 0);
+}
+
+static void bench() {
+  auto & ctx = globalContext();
+  const int n = 200000;
+  auto plain = timeit<std::chrono::nanoseconds>(n, [] { CPU(kFloat).tensor({16}); });
+  ctx.setMemorySiteTracking(true);
+  MemorySite site("bench");
+  auto sites = timeit<std::chrono::nanoseconds>(n, [] { CPU(kFloat).tensor({16}); });
+  ctx.setMemorySiteTracking(false);
+  std::cout << "tensor({16}) create + free: " << plain << " ns, with sites " << sites << " ns" << std::endl;
+
+  // a build without the accounting would not make the two calls a storage
+  // makes when it allocates and frees its data
+  auto t = CPU(kFloat).tensor({16});
+  auto allocator = ((THFloatTensor*)t.unsafeGetTH(false))->storage->allocator;
+  auto record = [&] {
+    THMemoryStats_record(allocator, TH_MEMORY_TYPE_Float, 64);
+    THMemoryStats_record(allocator, TH_MEMORY_TYPE_Float, -64);
+  };
+  auto accounting = timeit<std::chrono::nanoseconds>(n, record);
+  ctx.setMemorySiteTracking(true);
+  auto siteAccounting = timeit<std::chrono::nanoseconds>(n, record);
+  ctx.setMemorySiteTracking(false);
+  std::cout << "accounting of a create + free: " << accounting << " ns ("
+            << 100. * accounting / plain << "% of it), with sites " << siteAccounting
+            << " ns (" << 100. * siteAccounting / sites << "%)" << std::endl;
+}
+
+int main() {
+  testCounters();
+  testScope();
+  testSites();
+  bench();
+  return 0;
+}
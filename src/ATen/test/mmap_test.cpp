@@ -0,0 +1,185 @@
+#include "ATen/ATen.h"
+#include "TH/TH.h"
+
+#include <iostream>
+#include <functional>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks storages on files: whole-file, read-only and populated mappings,
+// access hints and prefetching, and times random reads of rows of a file
+// out of the page cache with and without them.
+
+// a file of n floats 0, 1, 2, ...
+static std::string makeFile(int64_t n) {
+  char name[] = "/tmp/mmap_testXXXXXX";
+  int fd = mkstemp(name);
+  ASSERT(fd >= 0);
+  close(fd);
+  auto file = CPU(kFloat).storageFromFile(name, n, kMapShared);
+  auto t = CPU(kFloat).tensor(*file, 0, {n});
+  t.copy_(CPU(kFloat).range(0, n - 1));
+  return name;
+}
+
+// drops the pages of the file from the page cache, when they are clean
+static void evict(const std::string & name) {
+  int fd = open(name.c_str(), O_RDONLY);
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+static bool throws(std::function<void()> f) {
+  try {
+    f();
+  } catch(std::runtime_error &) {
+    return true;
+  }
+  return false;
+}
+
+static void testMapping() {
+  auto name = makeFile(1000);
+
+  // all of the file
+  auto whole = CPU(kFloat).storageFromFile(name.c_str(), 0, 0);
+  ASSERT(whole->size() == 1000);
+  ASSERT(whole->get(999).toFloat() == 999);
+
+  // private: writes stay in memory
+  auto t = CPU(kFloat).tensor(*whole, 0, {10, 100});
+  t.fill_(-1);
+  ASSERT(CPU(kFloat).storageFromFile(name.c_str(), 0, 0)->get(0).toFloat() == 0);
+
+  // hints do not change the data
+  for(int flags : std::vector<int>{kMapSequential, kMapRandom | kMapWillNeed, kMapReadOnly | kMapPopulate}) {
+    auto s = CPU(kFloat).storageFromFile(name.c_str(), 1000, flags);
+    ASSERT(CPU(kFloat).tensor(*s, 0, {1000}).sum().toDouble() == 999 * 1000 / 2);
+  }
+  ASSERT(throws([&] { CPU(kFloat).storageFromFile(name.c_str(), 0, kMapSequential | kMapRandom); }));
+  ASSERT(throws([&] { CPU(kFloat).storageFromFile(name.c_str(), 0, kMapShared | kMapReadOnly); }));
+  // a private mapping does not grow the file
+  ASSERT(throws([&] { CPU(kFloat).storageFromFile(name.c_str(), 2000, kMapRandom); }));
+  unlink(name.c_str());
+}
+
+static void testReadOnly() {
+  auto name = makeFile(1024);
+  auto s = CPU(kFloat).storageFromFile(name.c_str(), 0, kMapReadOnly | kMapPopulate);
+  auto t = CPU(kFloat).tensor(*s, 0, {1024});
+
+  // writes fault
+  pid_t pid = fork();
+  if(pid == 0) {
+    ((float*)s->data())[0] = 1;
+    _exit(0);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  ASSERT(WIFSIGNALED(status));
+
+  // functions that would write it raise an error, and leave it as it was
+  auto sum = t.sum().toDouble();
+  ASSERT(throws([&] { t.add_(1); }));
+  ASSERT(throws([&] { t.fill_(0); }));
+  ASSERT(throws([&] { t.copy_(CPU(kFloat).zeros({1024})); }));
+  ASSERT(throws([&] { at::add_out(t, t, t); }));
+  ASSERT(throws([&] { t.narrow(0, 0, 10).zero_(); }));
+  ASSERT(throws([&] { at::Threshold_updateOutput(t, t, 0, 0, true); }));
+  ASSERT(throws([&] { t.resize_({2048}); }));
+  ASSERT(t.sum().toDouble() == sum);
+  // reading its data directly is fine
+  auto a = t.accessor<float, 1>();
+  ASSERT(a[1023] == 1023);
+
+  // but clones can be written, copy-on-write or not
+  for(bool cow : {false, true}) {
+    globalContext().setCopyOnWriteClone(cow);
+    auto c = t.clone();
+    c.add_(1);
+    ASSERT(c.sum().toDouble() == t.sum().toDouble() + 1024);
+  }
+  globalContext().setCopyOnWriteClone(false);
+  unlink(name.c_str());
+}
+
+static void testPrefetch() {
+  auto name = makeFile(4096);
+  auto s = CPU(kFloat).storageFromFile(name.c_str(), 0, kMapRandom);
+  s->prefetch(0, 4096).prefetch(4000, 96).prefetch(1, 0);
+  ASSERT(throws([&] { s->prefetch(4000, 97); }));
+
+  auto t = CPU(kFloat).tensor(*s, 0, {64, 64});
+  t.prefetch(10, 5);
+  t.t().prefetch(63, 1);
+  t.narrow(1, 3, 2).prefetch(0, 64);
+  ASSERT(throws([&] { t.prefetch(60, 5); }));
+  ASSERT(t.select(0, 10).sum().toDouble() == 64 * 640 + 63 * 64 / 2);
+  unlink(name.c_str());
+}
+
+static void bench() {
+  const int64_t rows = 1 << 15, cols = 1024;  // 128 MiB, 4 KiB rows
+  const int batches = 64, batch = 64;
+  auto name = makeFile(rows * cols);
+  std::mt19937 gen(1);
+  std::vector<int64_t> order(batches * batch);
+  for(auto & row : order) {
+    row = gen() % rows;
+  }
+
+  auto gather = [&](int flags, bool prefetch) {
+    evict(name);
+    auto s = CPU(kFloat).storageFromFile(name.c_str(), 0, flags);
+    auto t = CPU(kFloat).tensor(*s, 0, {rows, cols});
+    double sum = 0;
+    return timeit(1, [&] {
+      for(int b = 0; b < batches; b++) {
+        // the rows of the next batch are read in while this one is used
+        if(prefetch && b + 1 < batches) {
+          for(int i = 0; i < batch; i++) {
+            t.prefetch(order[(b+1)*batch + i], 1);
+          }
+        }
+        for(int i = 0; i < batch; i++) {
+          sum += t.select(0, order[b*batch + i]).sum().toDouble();
+        }
+      }
+    });
+  };
+  auto plain = gather(0, false);
+  auto random = gather(kMapRandom, false);
+  auto prefetched = gather(kMapRandom, true);
+  std::cout << "random rows of a file out of the page cache: " << plain << " us, "
+            << random << " us random, " << prefetched << " us random + prefetch" << std::endl;
+
+  // a small table read over and over
+  auto table = [&](int flags) {
+    evict(name);
+    auto s = CPU(kFloat).storageFromFile(name.c_str(), 1 << 20, flags);  // 4 MiB
+    auto t = CPU(kFloat).tensor(*s, 0, {1 << 20});
+    return timeit(1, [&] { t.sum(); });
+  };
+  auto lazy = table(kMapReadOnly);
+  auto populated = table(kMapReadOnly | kMapPopulate);
+  std::cout << "first sum of a 4 MiB table: " << lazy << " us, " << populated
+            << " us populated when mapped" << std::endl;
+  unlink(name.c_str());
+}
+
+int main() {
+  testMapping();
+  testReadOnly();
+  testPrefetch();
+  bench();
+  return 0;
+}
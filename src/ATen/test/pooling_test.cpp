@@ -0,0 +1,250 @@
+#include "ATen/ATen.h"
+
+#include <iostream>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the spatial, temporal and volumetric pooling kernels against window
+// scans over the input, and the inference mode (no indices) against the
+// training mode.
+
+static int64_t outputSize(int64_t in, int k, int d, int pad) {
+  return (in + 2 * pad - k) / d + 1;
+}
+
+static void testSpatial(int64_t h, int64_t w, int k, int d, int pad, bool ties) {
+  std::cout << "Spatial pooling " << h << "x" << w << " k " << k << " d " << d
+            << " pad " << pad << (ties ? " ties" : "") << std::endl;
+  auto input = CPU(kDouble).randn({2, 3, h, w});
+  if(ties) {
+    input = (input * 2).floor();
+  }
+  int64_t oh = outputSize(h, k, d, pad), ow = outputSize(w, k, d, pad);
+  auto in = input.accessor<double, 4>();
+  auto gradOutput = CPU(kDouble).randn({2, 3, oh, ow});
+  auto go = gradOutput.accessor<double, 4>();
+
+  auto max_ref = CPU(kDouble).zeros({2, 3, oh, ow});
+  auto avg_ref = CPU(kDouble).zeros({2, 3, oh, ow});
+  auto maxGrad_ref = CPU(kDouble).zeros({2, 3, h, w});
+  auto avgGrad_ref = CPU(kDouble).zeros({2, 3, h, w});
+  auto mx = max_ref.accessor<double, 4>();
+  auto av = avg_ref.accessor<double, 4>();
+  auto mg = maxGrad_ref.accessor<double, 4>();
+  auto ag = avgGrad_ref.accessor<double, 4>();
+  for(int64_t b = 0; b < 2; b++) {
+    for(int64_t c = 0; c < 3; c++) {
+      for(int64_t i = 0; i < oh; i++) {
+        for(int64_t j = 0; j < ow; j++) {
+          int64_t best = -1;
+          double sum = 0;
+          for(int64_t y = i * d - pad; y < i * d - pad + k; y++) {
+            for(int64_t x = j * d - pad; x < j * d - pad + k; x++) {
+              if(y < 0 || y >= h || x < 0 || x >= w) continue;
+              if(best < 0 || in[b][c][y][x] > in[b][c][best / w][best % w]) best = y * w + x;
+              sum += in[b][c][y][x];
+            }
+          }
+          mx[b][c][i][j] = in[b][c][best / w][best % w];
+          mg[b][c][best / w][best % w] += go[b][c][i][j];
+          av[b][c][i][j] = sum / (k * k);
+          for(int64_t y = i * d - pad; y < i * d - pad + k; y++) {
+            for(int64_t x = j * d - pad; x < j * d - pad + k; x++) {
+              if(y >= 0 && y < h && x >= 0 && x < w) ag[b][c][y][x] += go[b][c][i][j] / (k * k);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  auto output = CPU(kDouble).tensor();
+  auto indices = CPU(kLong).tensor();
+  SpatialMaxPooling_updateOutput(input, output, indices, k, k, d, d, pad, pad, false);
+  ASSERT((output - max_ref).abs().max().toDouble() == 0);
+  auto gradInput = CPU(kDouble).tensor();
+  SpatialMaxPooling_updateGradInput(input, gradOutput, gradInput, indices, k, k, d, d, pad, pad, false);
+  ASSERT((gradInput - maxGrad_ref).abs().max().toDouble() < 1e-12);
+  auto inference = CPU(kDouble).tensor();
+  SpatialMaxPooling_updateOutput(input, inference, k, k, d, d, pad, pad, false);
+  ASSERT((inference - output).abs().max().toDouble() == 0);
+
+  SpatialAveragePooling_updateOutput(input, output, k, k, d, d, pad, pad, false, true);
+  ASSERT((output - avg_ref).abs().max().toDouble() < 1e-12);
+  SpatialAveragePooling_updateGradInput(input, gradOutput, gradInput, k, k, d, d, pad, pad, false, true);
+  ASSERT((gradInput - avgGrad_ref).abs().max().toDouble() < 1e-12);
+}
+
+static void testTemporal(int64_t len, int64_t features, int k, int d) {
+  std::cout << "Temporal max pooling length " << len << " features " << features
+            << " k " << k << " d " << d << std::endl;
+  auto input = CPU(kDouble).randn({2, len, features});
+  int64_t olen = outputSize(len, k, d, 0);
+  auto gradOutput = CPU(kDouble).randn({2, olen, features});
+  auto in = input.accessor<double, 3>();
+  auto go = gradOutput.accessor<double, 3>();
+  auto output_ref = CPU(kDouble).zeros({2, olen, features});
+  auto gradInput_ref = CPU(kDouble).zeros({2, len, features});
+  auto o = output_ref.accessor<double, 3>();
+  auto g = gradInput_ref.accessor<double, 3>();
+  for(int64_t b = 0; b < 2; b++) {
+    for(int64_t t = 0; t < olen; t++) {
+      for(int64_t f = 0; f < features; f++) {
+        int64_t best = t * d;
+        for(int64_t s = t * d + 1; s < t * d + k; s++) {
+          if(in[b][s][f] > in[b][best][f]) best = s;
+        }
+        o[b][t][f] = in[b][best][f];
+        g[b][best][f] += go[b][t][f];
+      }
+    }
+  }
+
+  auto output = CPU(kDouble).tensor();
+  auto indices = CPU(kLong).tensor();
+  TemporalMaxPooling_updateOutput(input, output, indices, k, d);
+  ASSERT((output - output_ref).abs().max().toDouble() == 0);
+  auto gradInput = CPU(kDouble).tensor();
+  TemporalMaxPooling_updateGradInput(input, gradOutput, gradInput, indices, k, d);
+  ASSERT((gradInput - gradInput_ref).abs().max().toDouble() < 1e-12);
+  auto inference = CPU(kDouble).tensor();
+  TemporalMaxPooling_updateOutput(input, inference, k, d);
+  ASSERT((inference - output).abs().max().toDouble() == 0);
+}
+
+static void testDilated(int k, int d, int pad, int dil) {
+  std::cout << "Dilated spatial max pooling k " << k << " d " << d << " pad " << pad
+            << " dilation " << dil << std::endl;
+  int64_t h = 11, w = 14;
+  auto input = CPU(kDouble).randn({2, 3, h, w});
+  int64_t oh = (h + 2 * pad - dil * (k - 1) - 1) / d + 1, ow = (w + 2 * pad - dil * (k - 1) - 1) / d + 1;
+  auto gradOutput = CPU(kDouble).randn({2, 3, oh, ow});
+  auto gradInput_ref = CPU(kDouble).zeros({2, 3, h, w});
+  auto in = input.accessor<double, 4>();
+  auto go = gradOutput.accessor<double, 4>();
+  auto g = gradInput_ref.accessor<double, 4>();
+  for(int64_t b = 0; b < 2; b++) {
+    for(int64_t c = 0; c < 3; c++) {
+      for(int64_t i = 0; i < oh; i++) {
+        for(int64_t j = 0; j < ow; j++) {
+          int64_t by = -1, bx = -1;
+          for(int64_t y = i * d - pad; y < i * d - pad + k * dil; y += dil) {
+            for(int64_t x = j * d - pad; x < j * d - pad + k * dil; x += dil) {
+              if(y < 0 || y >= h || x < 0 || x >= w) continue;
+              if(by < 0 || in[b][c][y][x] > in[b][c][by][bx]) { by = y; bx = x; }
+            }
+          }
+          g[b][c][by][bx] += go[b][c][i][j];
+        }
+      }
+    }
+  }
+
+  auto output = CPU(kDouble).tensor();
+  auto indices = CPU(kLong).tensor();
+  auto gradInput = CPU(kDouble).tensor();
+  SpatialDilatedMaxPooling_updateOutput(input, output, indices, k, k, d, d, pad, pad, dil, dil, false);
+  SpatialDilatedMaxPooling_updateGradInput(input, gradOutput, gradInput, indices, k, k, d, d, pad, pad, dil, dil, false);
+  ASSERT((gradInput - gradInput_ref).abs().max().toDouble() < 1e-12);
+
+  // a single plane: fewer planes than threads, which split its rows
+  auto plane = input[0].narrow(0, 0, 1).contiguous();
+  SpatialDilatedMaxPooling_updateOutput(plane, output, indices, k, k, d, d, pad, pad, dil, dil, false);
+  SpatialDilatedMaxPooling_updateGradInput(plane, gradOutput[0].narrow(0, 0, 1), gradInput, indices,
+                                           k, k, d, d, pad, pad, dil, dil, false);
+  ASSERT((gradInput - gradInput_ref[0].narrow(0, 0, 1)).abs().max().toDouble() < 1e-12);
+}
+
+static void testVolumetric(int k, int d, int pad, int dil) {
+  std::cout << "Volumetric max pooling k " << k << " d " << d << " pad " << pad
+            << " dilation " << dil << std::endl;
+  int64_t size[3] = {6, 7, 9};
+  auto input = CPU(kDouble).randn({2, 3, size[0], size[1], size[2]});
+  auto output = CPU(kDouble).tensor();
+  auto inference = CPU(kDouble).tensor();
+  auto indices = CPU(kLong).tensor();
+  VolumetricDilatedMaxPooling_updateOutput(input, output, indices, k, k, k, d, d, d, pad, pad, pad, dil, dil, dil, false);
+  VolumetricDilatedMaxPooling_updateOutput(input, inference, k, k, k, d, d, d, pad, pad, pad, dil, dil, dil, false);
+  ASSERT((inference - output).abs().max().toDouble() == 0);
+
+  // every output is routed back to the first input of its window holding
+  // its value
+  auto gradOutput = CPU(kDouble).randn(output.sizes());
+  auto gradInput_ref = CPU(kDouble).zeros(input.sizes());
+  auto in = input.accessor<double, 5>();
+  auto out = output.accessor<double, 5>();
+  auto go = gradOutput.accessor<double, 5>();
+  auto g = gradInput_ref.accessor<double, 5>();
+  for(int64_t b = 0; b < 2; b++) {
+    for(int64_t c = 0; c < 3; c++) {
+      for(int64_t ot = 0; ot < output.size(2); ot++) {
+        for(int64_t i = 0; i < output.size(3); i++) {
+          for(int64_t j = 0; j < output.size(4); j++) {
+            bool found = false;
+            for(int64_t t = ot * d - pad; t < ot * d - pad + k * dil && !found; t += dil) {
+              for(int64_t y = i * d - pad; y < i * d - pad + k * dil && !found; y += dil) {
+                for(int64_t x = j * d - pad; x < j * d - pad + k * dil && !found; x += dil) {
+                  if(t < 0 || t >= size[0] || y < 0 || y >= size[1] || x < 0 || x >= size[2]) continue;
+                  if(in[b][c][t][y][x] == out[b][c][ot][i][j]) {
+                    g[b][c][t][y][x] += go[b][c][ot][i][j];
+                    found = true;
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  auto gradInput = CPU(kDouble).tensor();
+  VolumetricDilatedMaxPooling_updateGradInput(input, gradOutput, gradInput, indices,
+                                              k, k, k, d, d, d, pad, pad, pad, dil, dil, dil, false);
+  ASSERT((gradInput - gradInput_ref).abs().max().toDouble() < 1e-12);
+
+  // a single volume: fewer volumes than threads, which split its rows
+  auto volume = input[0].narrow(0, 0, 1).contiguous();
+  VolumetricDilatedMaxPooling_updateOutput(volume, output, indices, k, k, k, d, d, d, pad, pad, pad, dil, dil, dil, false);
+  VolumetricDilatedMaxPooling_updateGradInput(volume, gradOutput[0].narrow(0, 0, 1), gradInput, indices,
+                                              k, k, k, d, d, d, pad, pad, pad, dil, dil, dil, false);
+  ASSERT((gradInput - gradInput_ref[0].narrow(0, 0, 1)).abs().max().toDouble() < 1e-12);
+}
+
+int main() {
+  for(bool ties : {false, true}) {
+    testSpatial(8, 8, 2, 2, 0, ties);
+    testSpatial(9, 11, 3, 2, 1, ties);
+    testSpatial(7, 10, 3, 1, 1, ties);
+    testSpatial(10, 13, 4, 3, 2, ties);
+  }
+  testTemporal(11, 5, 3, 2);
+  testTemporal(12, 17, 2, 2);
+  testTemporal(9, 4, 4, 1);
+  testDilated(3, 1, 1, 2);
+  testDilated(2, 2, 0, 3);
+  testVolumetric(2, 2, 0, 1);
+  testVolumetric(3, 2, 1, 1);
+  testVolumetric(2, 1, 0, 2);
+
+  auto input = CPU(kFloat).randn({32, 64, 56, 56});
+  auto output = CPU(kFloat).tensor();
+  auto indices = CPU(kLong).tensor();
+  std::cout << "  SpatialMaxPooling 2x2/2 32x64x56x56: "
+            << timeit(5, [&] { SpatialMaxPooling_updateOutput(input, output, indices, 2, 2, 2, 2, 0, 0, false); })
+            << " us, inference: "
+            << timeit(5, [&] { SpatialMaxPooling_updateOutput(input, output, 2, 2, 2, 2, 0, 0, false); })
+            << " us" << std::endl;
+  SpatialMaxPooling_updateOutput(input, output, indices, 2, 2, 2, 2, 0, 0, false);
+  auto gradInput = CPU(kFloat).tensor();
+  std::cout << "  SpatialMaxPooling 2x2/2 32x64x56x56 backward: "
+            << timeit(5, [&] { SpatialMaxPooling_updateGradInput(input, output, gradInput, indices, 2, 2, 2, 2, 0, 0, false); })
+            << " us" << std::endl;
+  auto plane = CPU(kFloat).randn({1, 512, 512});
+  SpatialMaxPooling_updateOutput(plane, output, indices, 2, 2, 2, 2, 0, 0, false);
+  std::cout << "  SpatialMaxPooling 2x2/2 1x512x512 backward: "
+            << timeit(5, [&] { SpatialMaxPooling_updateGradInput(plane, output, gradInput, indices, 2, 2, 2, 2, 0, 0, false); })
+            << " us" << std::endl;
+  return 0;
+}
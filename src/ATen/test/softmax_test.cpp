@@ -0,0 +1,172 @@
+#include "ATen/ATen.h"
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks SoftMax/LogSoftMax against a double precision reference, and
+// CrossEntropyCriterion against LogSoftMax followed by ClassNLLCriterion.
+// Rows with NaN and infinities give what exp() and log() make of them.
+
+static double maxdiff(Tensor a, Tensor b) {
+  return (a.toType(kDouble) - b.toType(kDouble)).abs().max().toDouble();
+}
+
+static void testSoftMax(Type & type, IntList sizes) {
+  auto input = type.randn(sizes) * 10;
+  auto x = input.toType(kDouble);
+  auto shifted = x - std::get<0>(x.max(1, true)).expand(x.sizes());
+  auto sum = shifted.exp().sum(1, true).expand(x.sizes());
+  auto softmax_ref = shifted.exp() / sum;
+  auto logsoftmax_ref = shifted - sum.log();
+
+  auto output = type.tensor();
+  SoftMax_updateOutput(input, output);
+  ASSERT(maxdiff(output, softmax_ref) < 1e-5);
+  auto logoutput = type.tensor();
+  LogSoftMax_updateOutput(input, logoutput);
+  ASSERT(maxdiff(logoutput, logsoftmax_ref) < 1e-4);
+
+  auto gradOutput = type.randn(sizes);
+  auto go = gradOutput.toType(kDouble);
+  auto gradInput = type.tensor();
+  SoftMax_updateGradInput(input, gradOutput, gradInput, output);
+  auto dot = (go * softmax_ref).sum(1, true).expand(x.sizes());
+  ASSERT(maxdiff(gradInput, softmax_ref * (go - dot)) < 1e-5);
+  LogSoftMax_updateGradInput(input, gradOutput, gradInput, logoutput);
+  auto gosum = go.sum(1, true).expand(x.sizes());
+  ASSERT(maxdiff(gradInput, go - softmax_ref * gosum) < 1e-4);
+}
+
+// elementwise equal within tol, NaN where ref is NaN
+static bool sameValues(Tensor a, Tensor ref, double tol) {
+  a = a.toType(kDouble).contiguous();
+  ref = ref.toType(kDouble).contiguous();
+  if(a.numel() != ref.numel()) {
+    return false;
+  }
+  auto x = a.data<double>(), y = ref.data<double>();
+  for(int64_t i = 0; i < a.numel(); i++) {
+    bool same = std::isnan(y[i]) ? std::isnan(x[i]) :
+                std::isinf(y[i]) ? x[i] == y[i] : std::abs(x[i] - y[i]) < tol;
+    if(!same) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void testSpecialValues() {
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  const double rows[][4] = {{1, nan, 2, 0}, {1, inf, 2, 0}, {1, -inf, 2, 0},
+                            {-inf, -inf, -inf, -inf}, {-nan, 1, 2, 3}, {-200, 0, 100, 88}};
+  const int64_t n = sizeof(rows) / sizeof(rows[0]);
+  auto x = CPU(kDouble).tensor({n, 4});
+  // the loops of the kernels before the row kernels, as a reference
+  auto softmax_ref = CPU(kDouble).tensor({n, 4});
+  auto logsoftmax_ref = CPU(kDouble).tensor({n, 4});
+  auto xa = x.accessor<double, 2>();
+  auto sa = softmax_ref.accessor<double, 2>();
+  auto la = logsoftmax_ref.accessor<double, 2>();
+  for(int64_t i = 0; i < n; i++) {
+    double max = -inf, sum = 0;
+    for(int d = 0; d < 4; d++) {
+      xa[i][d] = rows[i][d];
+      max = rows[i][d] >= max ? rows[i][d] : max;
+    }
+    for(int d = 0; d < 4; d++) {
+      sum += std::exp(rows[i][d] - max);
+    }
+    for(int d = 0; d < 4; d++) {
+      sa[i][d] = std::exp(rows[i][d] - max) / sum;
+      la[i][d] = rows[i][d] - (max + std::log(sum));
+    }
+  }
+
+  for(auto type : {&CPU(kFloat), &CPU(kDouble)}) {
+    auto input = x.toType(*type);
+    // and with the rows spaced by a stride
+    auto input4 = input.t().contiguous().view({1, 4, n, 1});
+    auto output = type->tensor(), output4 = type->tensor();
+    SoftMax_updateOutput(input, output);
+    SoftMax_updateOutput(input4, output4);
+    ASSERT(sameValues(output, softmax_ref, 1e-6));
+    ASSERT(sameValues(output4.view({4, n}).t(), softmax_ref, 1e-6));
+    LogSoftMax_updateOutput(input, output);
+    LogSoftMax_updateOutput(input4, output4);
+    ASSERT(sameValues(output, logsoftmax_ref, 1e-5));
+    ASSERT(sameValues(output4.view({4, n}).t(), logsoftmax_ref, 1e-5));
+  }
+}
+
+static void testCrossEntropy(Type & type, int64_t batch, int64_t classes, bool weighted,
+                             bool sizeAverage, int iters) {
+  std::cout << type.toString() << " CrossEntropyCriterion batch " << batch
+            << " classes " << classes << std::endl;
+  auto input = type.randn({batch, classes}) * 5;
+  auto target = CPU(kLong).zeros({batch});
+  auto t = target.accessor<int64_t, 1>();
+  for(int64_t i = 0; i < batch; i++) {
+    t[i] = (i * 7919) % classes;
+  }
+  int64_t ignore_index = t[0];
+  auto weights = weighted ? type.rand({classes}) : Tensor();
+  auto total_weight = type.zeros({1}), total_weight_ref = type.zeros({1});
+  auto output = type.zeros({1}), output_ref = type.zeros({1});
+  auto logsumexp = type.tensor(), logprob = type.tensor();
+
+  auto fused = [&] {
+    CrossEntropyCriterion_updateOutput(input, target, output, sizeAverage, weights,
+                                       total_weight, logsumexp, ignore_index);
+  };
+  auto unfused = [&] {
+    LogSoftMax_updateOutput(input, logprob);
+    ClassNLLCriterion_updateOutput(logprob, target, output_ref, sizeAverage, weights,
+                                   total_weight_ref, ignore_index);
+  };
+  fused();
+  unfused();
+  ASSERT(std::abs(output.sum().toDouble() - output_ref.sum().toDouble()) < 1e-4 * std::abs(output_ref.sum().toDouble()) + 1e-5);
+  ASSERT(std::abs(total_weight.sum().toDouble() - total_weight_ref.sum().toDouble()) < 1e-4);
+
+  auto gradInput = type.tensor();
+  CrossEntropyCriterion_updateGradInput(input, target, gradInput, sizeAverage, weights,
+                                        total_weight, logsumexp, ignore_index);
+  auto gradLogprob = type.zeros({batch, classes});
+  auto gradInput_ref = type.tensor();
+  ClassNLLCriterion_updateGradInput(logprob, target, gradLogprob, sizeAverage, weights,
+                                    total_weight_ref, ignore_index);
+  LogSoftMax_updateGradInput(input, gradLogprob, gradInput_ref, logprob);
+  ASSERT(maxdiff(gradInput, gradInput_ref) < 1e-5);
+  ASSERT(gradInput[0].abs().sum().toDouble() == 0);
+
+  if(iters > 0) {
+    auto fused_time = timeit(iters, fused);
+    auto unfused_time = timeit(iters, unfused);
+    std::cout << "  LogSoftMax + ClassNLLCriterion: " << unfused_time
+              << " us, CrossEntropyCriterion: " << fused_time << " us" << std::endl;
+  }
+}
+
+int main() {
+  for(auto type : {&CPU(kFloat), &CPU(kDouble)}) {
+    testSoftMax(*type, {3, 1000});
+    testSoftMax(*type, {2, 7, 5, 3});
+    testSoftMax(*type, {2, 9, 30, 30});
+    testCrossEntropy(*type, 5, 11, false, true, 0);
+    testCrossEntropy(*type, 17, 300, true, true, 0);
+    testCrossEntropy(*type, 17, 300, true, false, 0);
+  }
+  testSpecialValues();
+  testCrossEntropy(CPU(kFloat), 256, 10000, false, true, 20);
+  auto input = CPU(kFloat).randn({256, 10000});
+  auto output = CPU(kFloat).tensor();
+  std::cout << "  SoftMax 256x10000: "
+            << timeit(20, [&] { SoftMax_updateOutput(input, output); }) << " us" << std::endl;
+  return 0;
+}
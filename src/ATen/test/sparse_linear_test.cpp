@@ -0,0 +1,205 @@
+#include "ATen/ATen.h"
+
+#include <iostream>
+#include <cstdlib>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks SparseLinear (coo and csr inputs) and IndexLinear against products
+// with the dense matrix of the batch.
+
+// A random batch of batch rows with 1 to per nonzeros each (every fifth row
+// empty), as csr rowPtr/cols (0-based), coo input (1-based) and dense rows.
+struct Batch {
+  Tensor rowPtr, cols, values, coo, dense;
+};
+
+static Batch randomBatch(int64_t batch, int64_t inDim, int64_t per) {
+  Batch b;
+  b.rowPtr = CPU(kLong).zeros({batch + 1});
+  auto rp = b.rowPtr.accessor<int64_t, 1>();
+  for(int64_t h = 0; h < batch; h++) {
+    rp[h + 1] = rp[h] + (h % 5 == 3 ? 0 : 1 + std::rand() % per);
+  }
+  int64_t nnz = rp[batch];
+  b.cols = CPU(kLong).zeros({nnz});
+  b.values = CPU(kDouble).randn({nnz});
+  b.coo = CPU(kDouble).zeros({nnz, 3});
+  b.dense = CPU(kDouble).zeros({batch, inDim});
+  auto c = b.cols.accessor<int64_t, 1>();
+  auto v = b.values.accessor<double, 1>();
+  auto coo = b.coo.accessor<double, 2>();
+  auto d = b.dense.accessor<double, 2>();
+  for(int64_t h = 0; h < batch; h++) {
+    for(int64_t i = rp[h]; i < rp[h + 1]; i++) {
+      c[i] = std::rand() % inDim;
+      coo[i][0] = h + 1;
+      coo[i][1] = c[i] + 1;
+      coo[i][2] = v[i];
+      d[h][c[i]] += v[i];
+    }
+  }
+  return b;
+}
+
+static void testSparseLinear(int64_t batch, int64_t inDim, int64_t outDim, int64_t per) {
+  std::cout << "SparseLinear batch " << batch << " " << inDim << " -> " << outDim
+            << " nnz/row " << per << std::endl;
+  auto b = randomBatch(batch, inDim, per);
+  auto weight = CPU(kDouble).randn({outDim, inDim});
+  auto bias = CPU(kDouble).randn({outDim});
+  auto gradOutput = CPU(kDouble).randn({batch, outDim});
+  auto output_ref = b.dense.mm(weight.t()) + bias.view({1, outDim}).expand({batch, outDim});
+  auto gradWeight_ref = gradOutput.t().mm(b.dense) * 0.5 + weight * 0.1;
+  auto gradBias_ref = gradOutput.sum(0) * 0.5;
+
+  auto output = CPU(kDouble).tensor();
+  SparseLinearCSR_updateOutput(b.rowPtr, b.cols, b.values, output, weight, bias);
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-10);
+  auto gradWeight = CPU(kDouble).zeros({outDim, inDim});
+  auto gradBias = CPU(kDouble).zeros({outDim});
+  SparseLinearCSR_accGradParameters(b.rowPtr, b.cols, b.values, gradOutput, gradWeight, gradBias,
+                                    weight, bias, 0.1, 0.5);
+  ASSERT((gradWeight - gradWeight_ref).abs().max().toDouble() < 1e-10);
+  ASSERT((gradBias - gradBias_ref).abs().max().toDouble() < 1e-10);
+
+  auto cooOutput = CPU(kDouble).zeros({batch, outDim}); // gives the batch size
+  SparseLinear_updateOutput(b.coo, cooOutput, weight, bias);
+  ASSERT((cooOutput - output_ref).abs().max().toDouble() < 1e-10);
+  gradWeight.zero_();
+  gradBias.zero_();
+  SparseLinear_accGradParameters(b.coo, gradOutput, gradWeight, gradBias, weight, bias, 0.1, 0.5);
+  ASSERT((gradWeight - gradWeight_ref).abs().max().toDouble() < 1e-10);
+  ASSERT((gradBias - gradBias_ref).abs().max().toDouble() < 1e-10);
+}
+
+static void testIndexLinear(int64_t batch, int64_t numKeys, int64_t outDim, int64_t per) {
+  std::cout << "IndexLinear batch " << batch << " keys " << numKeys << " -> " << outDim
+            << " nnz/row " << per << std::endl;
+  auto b = randomBatch(batch, numKeys, per);
+  auto sizes = b.rowPtr.narrow(0, 1, batch) - b.rowPtr.narrow(0, 0, batch);
+  auto cumSumSizes = b.rowPtr.narrow(0, 1, batch).clone();
+  auto weight = CPU(kDouble).randn({numKeys, outDim});
+  auto bias = CPU(kDouble).randn({outDim});
+  auto gradOutput = CPU(kDouble).randn({batch, outDim});
+  auto output_ref = b.dense.mm(weight) + bias.view({1, outDim}).expand({batch, outDim});
+
+  auto output = CPU(kDouble).tensor();
+  auto normalizedValues = CPU(kDouble).tensor();
+  IndexLinear_updateOutput(b.cols, 0, b.values, sizes, cumSumSizes, output, weight, bias,
+                           normalizedValues, 1);
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-10);
+
+  // the gradient has a row per nonzero: its value times its row's gradOutput
+  int64_t nnz = b.cols.size(0);
+  auto gradWeight = CPU(kDouble).tensor();
+  auto gradBias = CPU(kDouble).zeros({outDim});
+  auto valuesBuffer = CPU(kDouble).tensor();
+  IndexLinear_accGradParameters(b.cols, 0, b.values, sizes, cumSumSizes, gradOutput, gradWeight,
+                                gradBias, weight, bias, valuesBuffer, 0, 0.5);
+  ASSERT(gradWeight.size(0) == nnz && gradWeight.size(1) == outDim);
+  auto rp = b.rowPtr.accessor<int64_t, 1>();
+  auto v = b.values.accessor<double, 1>();
+  auto gw = gradWeight.accessor<double, 2>();
+  auto go = gradOutput.accessor<double, 2>();
+  double err = 0;
+  for(int64_t h = 0; h < batch; h++) {
+    for(int64_t i = rp[h]; i < rp[h + 1]; i++) {
+      for(int64_t o = 0; o < outDim; o++) {
+        err = std::max(err, std::abs(gw[i][o] - 0.5 * v[i] * go[h][o]));
+      }
+    }
+  }
+  ASSERT(err < 1e-10);
+  ASSERT((gradBias - gradOutput.sum(0) * 0.5).abs().max().toDouble() < 1e-10);
+}
+
+// The default key hash of the hashed IndexLinear
+static uint64_t hashKey(int64_t key, int64_t seed) {
+  uint64_t h = (uint64_t)key ^ (uint64_t)seed;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static void testHashedIndexLinear(int64_t batch, int64_t buckets, int64_t outDim, int64_t per,
+                                  bool signHash) {
+  std::cout << "HashedIndexLinear batch " << batch << " buckets " << buckets << " -> " << outDim
+            << " nnz/row " << per << " signHash " << signHash << std::endl;
+  auto b = randomBatch(batch, buckets, per);
+  auto sizes = b.rowPtr.narrow(0, 1, batch) - b.rowPtr.narrow(0, 0, batch);
+  auto cumSumSizes = b.rowPtr.narrow(0, 1, batch).clone();
+  int64_t nnz = b.cols.size(0), seed = 12345;
+  // 64-bit keys, hashed into a table of buckets rows
+  auto keys = CPU(kLong).zeros({nnz});
+  auto signs = CPU(kDouble).zeros({nnz});
+  auto k = keys.accessor<int64_t, 1>();
+  auto sg = signs.accessor<double, 1>();
+  auto rows = CPU(kLong).zeros({nnz});
+  auto r = rows.accessor<int64_t, 1>();
+  for(int64_t i = 0; i < nnz; i++) {
+    k[i] = ((int64_t)std::rand() << 31 | std::rand()) + ((int64_t)1 << 40);
+    uint64_t h = hashKey(k[i] + 7, seed);
+    r[i] = h % buckets;
+    sg[i] = signHash && (h >> 63) ? -1 : 1;
+  }
+  auto weight = CPU(kDouble).randn({buckets, outDim});
+  auto bias = CPU(kDouble).randn({outDim});
+  auto gradOutput = CPU(kDouble).randn({batch, outDim});
+
+  // the reference is IndexLinear on the rows of the keys and signed values
+  auto signedValues = b.values * signs;
+  auto output_ref = CPU(kDouble).tensor();
+  auto normalizedValues = CPU(kDouble).tensor();
+  IndexLinear_updateOutput(rows, 0, signedValues, sizes, cumSumSizes, output_ref, weight, bias,
+                           normalizedValues, 1);
+  auto output = CPU(kDouble).tensor();
+  auto hashedKeys = CPU(kLong).tensor();
+  HashedIndexLinear_updateOutput(keys, 7, b.values, sizes, cumSumSizes, output, weight, bias,
+                                 normalizedValues, hashedKeys, 1, seed, signHash);
+  ASSERT(hashedKeys.equal(rows));
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-10);
+
+  auto gradWeight_ref = CPU(kDouble).tensor();
+  auto gradBias_ref = CPU(kDouble).zeros({outDim});
+  auto valuesBuffer = CPU(kDouble).tensor();
+  IndexLinear_accGradParameters(rows, 0, signedValues, sizes, cumSumSizes, gradOutput,
+                                gradWeight_ref, gradBias_ref, weight, bias, valuesBuffer, 0, 0.5);
+  auto gradWeight = CPU(kDouble).tensor();
+  auto gradBias = CPU(kDouble).zeros({outDim});
+  HashedIndexLinear_accGradParameters(keys, 7, b.values, sizes, cumSumSizes, gradOutput,
+                                      gradWeight, gradBias, weight, bias, valuesBuffer, 0, 0.5,
+                                      seed, signHash);
+  ASSERT((gradWeight - gradWeight_ref).abs().max().toDouble() < 1e-10);
+  ASSERT((gradBias - gradBias_ref).abs().max().toDouble() < 1e-10);
+}
+
+int main() {
+  testSparseLinear(1, 10, 3, 4);
+  testSparseLinear(7, 50, 5, 6);
+  testSparseLinear(64, 1000, 70, 20);
+  testSparseLinear(300, 5000, 130, 40);
+  testIndexLinear(1, 10, 1, 4);
+  testIndexLinear(9, 100, 3, 6);
+  testIndexLinear(64, 1000, 70, 20);
+  testIndexLinear(300, 5000, 130, 40);
+  testHashedIndexLinear(9, 16, 1, 6, false);
+  testHashedIndexLinear(9, 16, 1, 6, true);
+  testHashedIndexLinear(64, 1000, 70, 20, true);
+  testHashedIndexLinear(300, 4096, 130, 40, true);
+
+  auto b = randomBatch(512, 200000, 200);
+  auto weight = CPU(kFloat).randn({64, 200000});
+  auto bias = CPU(kFloat).randn({64});
+  auto values = b.values.toType(kFloat);
+  auto output = CPU(kFloat).tensor();
+  std::cout << "  SparseLinearCSR 512x200000 (~100 nnz/row) -> 64: "
+            << timeit(3, [&] { SparseLinearCSR_updateOutput(b.rowPtr, b.cols, values, output, weight, bias); })
+            << " us" << std::endl;
+  return 0;
+}
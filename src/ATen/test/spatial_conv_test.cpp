@@ -0,0 +1,109 @@
+#include "ATen/ATen.h"
+
+#include <iostream>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the dilated convolution against a direct loop, and the transposed
+// (full) convolution against the gradient of the dilated one.
+
+static void testConvolution(int64_t batch, int64_t h, int64_t w, int kH, int kW,
+                            int d, int pad, int dilation) {
+  std::cout << "Spatial convolution batch " << batch << " " << h << "x" << w
+            << " k " << kH << "x" << kW << " d " << d << " pad " << pad
+            << " dilation " << dilation << std::endl;
+  const int64_t nIn = 3, nOut = 4;
+  auto input = CPU(kDouble).randn({batch, nIn, h, w});
+  auto weight = CPU(kDouble).randn({nOut, nIn, kH, kW});
+  auto bias = CPU(kDouble).randn({nOut});
+  int64_t oh = (h + 2 * pad - (dilation * (kH - 1) + 1)) / d + 1;
+  int64_t ow = (w + 2 * pad - (dilation * (kW - 1) + 1)) / d + 1;
+  auto gradOutput = CPU(kDouble).randn({batch, nOut, oh, ow});
+
+  auto output_ref = CPU(kDouble).zeros({batch, nOut, oh, ow});
+  auto gradInput_ref = CPU(kDouble).zeros({batch, nIn, h, w});
+  auto gradWeight_ref = CPU(kDouble).zeros({nOut, nIn, kH, kW});
+  auto in = input.accessor<double, 4>();
+  auto wt = weight.accessor<double, 4>();
+  auto go = gradOutput.accessor<double, 4>();
+  auto o = output_ref.accessor<double, 4>();
+  auto gi = gradInput_ref.accessor<double, 4>();
+  auto gw = gradWeight_ref.accessor<double, 4>();
+  for(int64_t b = 0; b < batch; b++) {
+    for(int64_t p = 0; p < nOut; p++) {
+      for(int64_t y = 0; y < oh; y++) {
+        for(int64_t x = 0; x < ow; x++) {
+          double sum = bias.accessor<double, 1>()[p];
+          for(int64_t c = 0; c < nIn; c++) {
+            for(int ky = 0; ky < kH; ky++) {
+              for(int kx = 0; kx < kW; kx++) {
+                int64_t iy = y * d - pad + ky * dilation, ix = x * d - pad + kx * dilation;
+                if(iy < 0 || iy >= h || ix < 0 || ix >= w) continue;
+                sum += wt[p][c][ky][kx] * in[b][c][iy][ix];
+                gi[b][c][iy][ix] += wt[p][c][ky][kx] * go[b][p][y][x];
+                gw[p][c][ky][kx] += in[b][c][iy][ix] * go[b][p][y][x];
+              }
+            }
+          }
+          o[b][p][y][x] = sum;
+        }
+      }
+    }
+  }
+
+  auto output = CPU(kDouble).tensor();
+  auto columns = CPU(kDouble).tensor();
+  auto ones = CPU(kDouble).tensor();
+  SpatialDilatedConvolution_updateOutput(input, output, weight, bias, columns, ones,
+                                         kW, kH, d, d, pad, pad, dilation, dilation);
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-10);
+  auto gradInput = CPU(kDouble).tensor();
+  SpatialDilatedConvolution_updateGradInput(input, gradOutput, gradInput, weight, columns,
+                                            kW, kH, d, d, pad, pad, dilation, dilation);
+  ASSERT((gradInput - gradInput_ref).abs().max().toDouble() < 1e-10);
+  auto gradWeight = CPU(kDouble).zeros({nOut, nIn, kH, kW});
+  auto gradBias = CPU(kDouble).zeros({nOut});
+  SpatialDilatedConvolution_accGradParameters(input, gradOutput, gradWeight, gradBias, columns, ones,
+                                              kW, kH, d, d, pad, pad, dilation, dilation, 0.5);
+  ASSERT((gradWeight - gradWeight_ref * 0.5).abs().max().toDouble() < 1e-10);
+  ASSERT((gradBias - gradOutput.sum(3).sum(2).sum(0) * 0.5).abs().max().toDouble() < 1e-10);
+
+  // the full convolution is the transpose of the convolution: with the same
+  // weights its output is the convolution's gradInput, and its gradInput
+  // the convolution's output without bias
+  if(dilation != 1) return;
+  int adjH = (h + 2 * pad - kH) % d, adjW = (w + 2 * pad - kW) % d;
+  auto full = CPU(kDouble).tensor();
+  SpatialFullConvolution_updateOutput(gradOutput, full, weight, columns, ones,
+                                      kW, kH, d, d, pad, pad, adjW, adjH);
+  ASSERT((full - gradInput_ref).abs().max().toDouble() < 1e-10);
+  auto fullGradInput = CPU(kDouble).tensor();
+  SpatialFullConvolution_updateGradInput(gradOutput, input, fullGradInput, weight, columns,
+                                         kW, kH, d, d, pad, pad, adjW, adjH);
+  ASSERT((fullGradInput + bias.view({1, nOut, 1, 1}).expand({batch, nOut, oh, ow}) - output).abs().max().toDouble() < 1e-10);
+  auto fullGradWeight = CPU(kDouble).zeros({nOut, nIn, kH, kW});
+  SpatialFullConvolution_accGradParameters(gradOutput, input, fullGradWeight, columns, ones,
+                                           kW, kH, d, d, pad, pad, adjW, adjH, 1);
+  ASSERT((fullGradWeight - gradWeight_ref).abs().max().toDouble() < 1e-10);
+}
+
+int main() {
+  testConvolution(2, 9, 11, 3, 2, 1, 1, 1);
+  testConvolution(1, 13, 10, 3, 3, 2, 1, 1);
+  testConvolution(1, 40, 37, 3, 3, 1, 2, 2);
+  testConvolution(6, 8, 9, 2, 3, 2, 0, 1);
+  testConvolution(3, 12, 12, 3, 3, 1, 2, 3);
+
+  auto input = CPU(kFloat).randn({16, 64, 32, 32});
+  auto weight = CPU(kFloat).randn({64, 32, 4, 4});
+  auto bias = CPU(kFloat).randn({32});
+  auto output = CPU(kFloat).tensor();
+  auto columns = CPU(kFloat).tensor();
+  auto ones = CPU(kFloat).tensor();
+  std::cout << "  SpatialFullConvolution 4x4/2 16x64x32x32 -> 32: "
+            << timeit(3, [&] { SpatialFullConvolution_updateOutput(input, output, weight, bias, columns, ones, 4, 4, 2, 2, 1, 1, 0, 0); })
+            << " us" << std::endl;
+  return 0;
+}
@@ -0,0 +1,176 @@
+#include "ATen/ATen.h"
+
+#include <iostream>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the temporal convolution, row (depthwise) convolution and
+// subsampling modules against direct loops over their windows.
+
+static void testConvolution(int64_t batch, int64_t len, int64_t inF, int64_t outF, int k, int d) {
+  std::cout << "Temporal convolution batch " << batch << " length " << len << " features "
+            << inF << " -> " << outF << " k " << k << " d " << d << std::endl;
+  int64_t olen = (len - k) / d + 1;
+  auto input = CPU(kDouble).randn({batch, len, inF});
+  auto weight = CPU(kDouble).randn({outF, k * inF});
+  auto bias = CPU(kDouble).randn({outF});
+  auto gradOutput = CPU(kDouble).randn({batch, olen, outF});
+  auto output_ref = CPU(kDouble).zeros({batch, olen, outF});
+  auto gradInput_ref = CPU(kDouble).zeros({batch, len, inF});
+  auto gradWeight_ref = CPU(kDouble).zeros({outF, k * inF});
+  auto in = input.accessor<double, 3>();
+  auto w = weight.accessor<double, 2>();
+  auto go = gradOutput.accessor<double, 3>();
+  auto o = output_ref.accessor<double, 3>();
+  auto gi = gradInput_ref.accessor<double, 3>();
+  auto gw = gradWeight_ref.accessor<double, 2>();
+  for(int64_t b = 0; b < batch; b++) {
+    for(int64_t t = 0; t < olen; t++) {
+      for(int64_t p = 0; p < outF; p++) {
+        double sum = bias.accessor<double, 1>()[p];
+        for(int j = 0; j < k; j++) {
+          for(int64_t f = 0; f < inF; f++) {
+            sum += w[p][j * inF + f] * in[b][t * d + j][f];
+            gi[b][t * d + j][f] += w[p][j * inF + f] * go[b][t][p];
+            gw[p][j * inF + f] += in[b][t * d + j][f] * go[b][t][p];
+          }
+        }
+        o[b][t][p] = sum;
+      }
+    }
+  }
+
+  auto output = CPU(kDouble).tensor();
+  TemporalConvolution_updateOutput(input, output, weight, bias, k, d, inF, outF);
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-10);
+  auto gradInput = CPU(kDouble).tensor();
+  TemporalConvolution_updateGradInput(input, gradOutput, gradInput, weight, k, d);
+  ASSERT((gradInput - gradInput_ref).abs().max().toDouble() < 1e-10);
+  auto gradWeight = CPU(kDouble).zeros({outF, k * inF});
+  auto gradBias = CPU(kDouble).zeros({outF});
+  TemporalConvolution_accGradParameters(input, gradOutput, gradWeight, gradBias, k, d, 0.5);
+  ASSERT((gradWeight - gradWeight_ref * 0.5).abs().max().toDouble() < 1e-10);
+  ASSERT((gradBias - gradOutput.sum(1).sum(0) * 0.5).abs().max().toDouble() < 1e-10);
+}
+
+static void testRowConvolution(int64_t batch, int64_t features, int64_t len, int k, int d, int pad) {
+  std::cout << "Temporal row convolution batch " << batch << " features " << features
+            << " length " << len << " k " << k << " d " << d << " pad " << pad << std::endl;
+  int64_t olen = (len + 2 * pad - k) / d + 1;
+  auto input = CPU(kDouble).randn({batch, features, len});
+  auto weight = CPU(kDouble).randn({features, 1, k});
+  auto bias = CPU(kDouble).randn({features});
+  auto gradOutput = CPU(kDouble).randn({batch, features, olen});
+  auto output_ref = CPU(kDouble).zeros({batch, features, olen});
+  auto gradInput_ref = CPU(kDouble).zeros({batch, features, len});
+  auto gradWeight_ref = CPU(kDouble).zeros({features, 1, k});
+  auto in = input.accessor<double, 3>();
+  auto w = weight.accessor<double, 3>();
+  auto go = gradOutput.accessor<double, 3>();
+  auto o = output_ref.accessor<double, 3>();
+  auto gi = gradInput_ref.accessor<double, 3>();
+  auto gw = gradWeight_ref.accessor<double, 3>();
+  for(int64_t b = 0; b < batch; b++) {
+    for(int64_t c = 0; c < features; c++) {
+      for(int64_t t = 0; t < olen; t++) {
+        double sum = bias.accessor<double, 1>()[c];
+        for(int j = 0; j < k; j++) {
+          int64_t s = t * d + j - pad;
+          if(s < 0 || s >= len) continue;
+          sum += w[c][0][j] * in[b][c][s];
+          gi[b][c][s] += w[c][0][j] * go[b][c][t];
+          gw[c][0][j] += in[b][c][s] * go[b][c][t];
+        }
+        o[b][c][t] = sum;
+      }
+    }
+  }
+
+  auto finput = CPU(kDouble).tensor();
+  auto fgradInput = CPU(kDouble).tensor();
+  auto output = CPU(kDouble).tensor();
+  TemporalRowConvolution_updateOutput(input, output, weight, bias, finput, fgradInput, k, d, pad, true);
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-10);
+  auto gradInput = CPU(kDouble).tensor();
+  TemporalRowConvolution_updateGradInput(input, gradOutput, gradInput, weight, finput, fgradInput, k, d, pad, true);
+  ASSERT((gradInput - gradInput_ref).abs().max().toDouble() < 1e-10);
+  auto gradWeight = CPU(kDouble).zeros({features, 1, k});
+  auto gradBias = CPU(kDouble).zeros({features});
+  TemporalRowConvolution_accGradParameters(input, gradOutput, gradWeight, gradBias, finput, fgradInput,
+                                           k, d, pad, true, 0.5);
+  ASSERT((gradWeight - gradWeight_ref * 0.5).abs().max().toDouble() < 1e-10);
+  ASSERT((gradBias - gradOutput.sum(2).sum(0) * 0.5).abs().max().toDouble() < 1e-10);
+
+  // sequence-first layout, twice into the same (transposed) output
+  auto transposed = CPU(kDouble).tensor();
+  auto inputT = input.transpose(1, 2).contiguous();
+  TemporalRowConvolution_updateOutput(inputT, transposed, weight, bias, finput, fgradInput, k, d, pad, false);
+  TemporalRowConvolution_updateOutput(inputT, transposed, weight, bias, finput, fgradInput, k, d, pad, false);
+  ASSERT((transposed.transpose(1, 2) - output_ref).abs().max().toDouble() < 1e-10);
+}
+
+static void testSubSampling(int64_t len, int64_t features, int k, int d) {
+  std::cout << "Temporal subsampling length " << len << " features " << features
+            << " k " << k << " d " << d << std::endl;
+  int64_t olen = (len - k) / d + 1;
+  auto input = CPU(kDouble).randn({len, features});
+  auto weight = CPU(kDouble).randn({features});
+  auto bias = CPU(kDouble).randn({features});
+  auto gradOutput = CPU(kDouble).randn({olen, features});
+  auto output_ref = CPU(kDouble).zeros({olen, features});
+  auto gradInput_ref = CPU(kDouble).zeros({len, features});
+  auto gradWeight_ref = CPU(kDouble).zeros({features});
+  auto in = input.accessor<double, 2>();
+  auto w = weight.accessor<double, 1>();
+  auto go = gradOutput.accessor<double, 2>();
+  auto o = output_ref.accessor<double, 2>();
+  auto gi = gradInput_ref.accessor<double, 2>();
+  auto gw = gradWeight_ref.accessor<double, 1>();
+  for(int64_t t = 0; t < olen; t++) {
+    for(int64_t f = 0; f < features; f++) {
+      double sum = 0;
+      for(int j = 0; j < k; j++) {
+        sum += in[t * d + j][f];
+        gi[t * d + j][f] += w[f] * go[t][f];
+      }
+      o[t][f] = sum * w[f] + bias.accessor<double, 1>()[f];
+      gw[f] += sum * go[t][f];
+    }
+  }
+
+  auto output = CPU(kDouble).tensor();
+  TemporalSubSampling_updateOutput(input, output, weight, bias, k, d, features);
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-10);
+  auto gradInput = CPU(kDouble).tensor();
+  TemporalSubSampling_updateGradInput(input, gradOutput, gradInput, weight, k, d);
+  ASSERT((gradInput - gradInput_ref).abs().max().toDouble() < 1e-10);
+  auto gradWeight = CPU(kDouble).zeros({features});
+  auto gradBias = CPU(kDouble).zeros({features});
+  TemporalSubSampling_accGradParameters(input, gradOutput, gradWeight, gradBias, k, d, 0.5);
+  ASSERT((gradWeight - gradWeight_ref * 0.5).abs().max().toDouble() < 1e-10);
+  ASSERT((gradBias - gradOutput.sum(0) * 0.5).abs().max().toDouble() < 1e-10);
+}
+
+int main() {
+  testConvolution(2, 20, 3, 4, 3, 1);
+  testConvolution(3, 23, 4, 5, 3, 3);
+  testConvolution(2, 31, 3, 2, 2, 5);
+  testConvolution(1, 400, 5, 6, 7, 2);
+  testRowConvolution(2, 5, 20, 3, 1, 0);
+  testRowConvolution(3, 4, 21, 4, 2, 2);
+  testRowConvolution(1, 6, 9, 5, 3, 1);
+  testSubSampling(20, 3, 3, 1);
+  testSubSampling(23, 5, 2, 3);
+  testSubSampling(50, 4, 5, 2);
+
+  auto input = CPU(kFloat).randn({8, 16000, 32});
+  auto weight = CPU(kFloat).randn({64, 5 * 32});
+  auto bias = CPU(kFloat).randn({64});
+  auto output = CPU(kFloat).tensor();
+  std::cout << "  TemporalConvolution k 5 8x16000x32 -> 64: "
+            << timeit(3, [&] { TemporalConvolution_updateOutput(input, output, weight, bias, 5, 1, 32, 64); })
+            << " us" << std::endl;
+  return 0;
+}
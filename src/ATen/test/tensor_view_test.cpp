@@ -0,0 +1,102 @@
+#include "ATen/ATen.h"
+#include "TH/TH.h"
+
+#include <iostream>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the stack views of TH (THTensorView) and ATen (TensorSlice)
+// against the refcounted views they stand in for.
+
+static void testTHViews() {
+  std::cout << "THTensorView" << std::endl;
+  auto a = CPU(kFloat).randn({5, 6, 7});
+  auto th = (THFloatTensor*)a.unsafeGetTH(false);
+  int refcount = th->storage->refcount;
+
+  THFloatTensorView view;
+  THFloatTensor *s = THFloatTensor_viewSelect(&view, th, 1, 2);
+  ASSERT(s->nDimension == 2 && s->size[0] == 5 && s->size[1] == 7);
+  ASSERT(th->storage->refcount == refcount);  // not retained
+  ASSERT(THFloatTensor_sumall(s) == a.select(1, 2).sum().toDouble());
+
+  // math routines take views, as inputs and as results
+  auto b = CPU(kFloat).randn({7, 4});
+  auto out = CPU(kFloat).zeros({3, 4});
+  THFloatTensorView outView;
+  THFloatTensor *n = THFloatTensor_viewNarrow(&view, s, 0, 1, 3);
+  THFloatTensor *o = THFloatTensor_viewOf(&outView, (THFloatTensor*)out.unsafeGetTH(false));
+  THFloatTensor_addmm(o, 0, o, 1, n, (THFloatTensor*)b.unsafeGetTH(false));
+  auto ref = a.select(1, 2).narrow(0, 1, 3).mm(b);
+  ASSERT((out - ref).abs().max().toDouble() < 1e-5);
+
+  THFloatTensor *t = THFloatTensor_viewTranspose(&view, th, 0, 2);
+  ASSERT(t->size[0] == 7 && t->stride[0] == 1);
+  ASSERT((THFloatTensor_get3d(t, 3, 4, 1) == a.accessor<float, 3>()[1][4][3]));
+
+  // a view can be reshaped in place, but not reseated
+  THFloatTensor *v = THFloatTensor_viewWithStorage2d(&view, th->storage, 0, 30, -1, 7, -1);
+  THFloatTensor_resize1d(v, 210);
+  THFloatTensor_unsqueeze1d(v, NULL, 0);
+  ASSERT(v->nDimension == 2 && v->size[0] == 1 && v->size[1] == 210);
+  bool thrown = false;
+  try {
+    THFloatTensor_set(v, (THFloatTensor*)b.unsafeGetTH(false));
+  } catch(std::runtime_error &) {
+    thrown = true;
+  }
+  ASSERT(thrown);
+  THFloatTensor_free(v);  // does nothing
+  THFloatTensor_retain(v);
+  ASSERT(th->storage->refcount == refcount);
+}
+
+static void testSlices() {
+  std::cout << "TensorSlice" << std::endl;
+  auto a = CPU(kDouble).randn({4, 5, 6});
+  auto s = a.slice<double, 3>();
+  ASSERT(s.numel() == 120 && s.is_contiguous());
+  auto sel = s.select(1, 3);
+  auto ref = a.select(1, 3);
+  ASSERT(sel.size(0) == 4 && sel.size(1) == 6 && sel.stride(0) == ref.stride(0));
+  auto tr = s.transpose(0, 2).narrow(1, 1, 3);
+  auto tref = a.transpose(0, 2).narrow(1, 1, 3);
+  ASSERT(!tr.is_contiguous());
+  for(int64_t i = 0; i < 6; i++) {
+    for(int64_t j = 0; j < 3; j++) {
+      for(int64_t k = 0; k < 4; k++) {
+        ASSERT((tr[i][j][k] == tref.accessor<double, 3>()[i][j][k]));
+      }
+    }
+  }
+  auto acc = sel.accessor();
+  ASSERT((acc[2][5] == ref.accessor<double, 2>()[2][5]));
+  sel[2][5] = 42;
+  ASSERT((a.accessor<double, 3>()[2][3][5] == 42));
+}
+
+int main() {
+  testTHViews();
+  testSlices();
+
+  auto a = CPU(kFloat).randn({256, 64});
+  auto th = (THFloatTensor*)a.unsafeGetTH(false);
+  float sum = 0;
+  std::cout << "  256 x newSelect: " << timeit(1000, [&] {
+    for(long i = 0; i < 256; i++) {
+      THFloatTensor *r = THFloatTensor_newSelect(th, 0, i);
+      sum += THFloatTensor_get1d(r, 0);
+      THFloatTensor_free(r);
+    }
+  }) << " us" << std::endl;
+  std::cout << "  256 x viewSelect: " << timeit(1000, [&] {
+    for(long i = 0; i < 256; i++) {
+      THFloatTensorView view;
+      THFloatTensor *r = THFloatTensor_viewSelect(&view, th, 0, i);
+      sum += THFloatTensor_get1d(r, 0);
+    }
+  }) << " us" << std::endl;
+  return sum == 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// average time of iters calls of f, in microseconds unless Unit says
+// otherwise
+template<typename Unit = std::chrono::microseconds, typename F>
+static int64_t timeit(int iters, F f) {
+  auto begin = std::chrono::high_resolution_clock::now();
+  for(int i = 0; i < iters; i++) {
+    f();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration_cast<Unit>(end-begin).count() / iters;
+}
@@ -0,0 +1,143 @@
+#include "ATen/ATen.h"
+
+#include <iostream>
+#include <cmath>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the upsampling kernels against a direct evaluation at every output
+// point, and each backward pass against its forward pass through the
+// identity <gradOutput, f(input)> == <f'(gradOutput), input>.
+
+static void testBilinear(int64_t h, int64_t w, int64_t oh, int64_t ow) {
+  std::cout << "Bilinear " << h << "x" << w << " -> " << oh << "x" << ow << std::endl;
+  auto input = CPU(kDouble).randn({2, 3, h, w});
+  auto output_ref = CPU(kDouble).zeros({2, 3, oh, ow});
+  auto in = input.accessor<double, 4>();
+  auto o = output_ref.accessor<double, 4>();
+  float rh = oh > 1 ? (float)(h - 1) / (oh - 1) : 0.f;
+  float rw = ow > 1 ? (float)(w - 1) / (ow - 1) : 0.f;
+  for(int64_t b = 0; b < 2; b++) {
+    for(int64_t c = 0; c < 3; c++) {
+      for(int64_t i = 0; i < oh; i++) {
+        float y = rh * i;
+        int64_t y0 = (int64_t)y, y1 = y0 < h - 1 ? y0 + 1 : y0;
+        double ly = y - y0;
+        for(int64_t j = 0; j < ow; j++) {
+          float x = rw * j;
+          int64_t x0 = (int64_t)x, x1 = x0 < w - 1 ? x0 + 1 : x0;
+          double lx = x - x0;
+          o[b][c][i][j] = (1 - ly) * ((1 - lx) * in[b][c][y0][x0] + lx * in[b][c][y0][x1])
+                        + ly * ((1 - lx) * in[b][c][y1][x0] + lx * in[b][c][y1][x1]);
+        }
+      }
+    }
+  }
+
+  auto output = CPU(kDouble).tensor();
+  SpatialUpSamplingBilinear_updateOutput(input, output, oh, ow);
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-12);
+
+  auto gradOutput = CPU(kDouble).randn({2, 3, oh, ow});
+  auto gradInput = CPU(kDouble).tensor();
+  SpatialUpSamplingBilinear_updateGradInput(gradOutput, gradInput, 2, 3, h, w, oh, ow);
+  ASSERT(std::abs((gradOutput * output).sum().toDouble() - (gradInput * input).sum().toDouble()) < 1e-9);
+}
+
+static void testTrilinear(int64_t d, int64_t h, int64_t w, int64_t od, int64_t oh, int64_t ow) {
+  std::cout << "Trilinear " << d << "x" << h << "x" << w
+            << " -> " << od << "x" << oh << "x" << ow << std::endl;
+  // a function that is linear in each coordinate is reproduced exactly
+  auto input = CPU(kDouble).zeros({2, 2, d, h, w});
+  auto in = input.accessor<double, 5>();
+  for(int64_t c = 0; c < 2; c++) {
+    for(int64_t z = 0; z < d; z++) {
+      for(int64_t y = 0; y < h; y++) {
+        for(int64_t x = 0; x < w; x++) {
+          in[1][c][z][y][x] = in[0][c][z][y][x] = (c + 1) * (1 + 2 * z) * (3 - y) * (x + 4);
+        }
+      }
+    }
+  }
+  auto output = CPU(kDouble).tensor();
+  VolumetricUpSamplingTrilinear_updateOutput(input, output, od, oh, ow);
+  auto out = output.accessor<double, 5>();
+  double rd = od > 1 ? (double)(d - 1) / (od - 1) : 0;
+  double rh = oh > 1 ? (double)(h - 1) / (oh - 1) : 0;
+  double rw = ow > 1 ? (double)(w - 1) / (ow - 1) : 0;
+  for(int64_t c = 0; c < 2; c++) {
+    for(int64_t z = 0; z < od; z++) {
+      for(int64_t y = 0; y < oh; y++) {
+        for(int64_t x = 0; x < ow; x++) {
+          double v = (c + 1) * (1 + 2 * rd * z) * (3 - rh * y) * (rw * x + 4);
+          ASSERT(std::abs(out[1][c][z][y][x] - v) < 1e-4 * std::abs(v) + 1e-4);
+        }
+      }
+    }
+  }
+
+  input = CPU(kDouble).randn({2, 2, d, h, w});
+  VolumetricUpSamplingTrilinear_updateOutput(input, output, od, oh, ow);
+  auto gradOutput = CPU(kDouble).randn({2, 2, od, oh, ow});
+  auto gradInput = CPU(kDouble).tensor();
+  VolumetricUpSamplingTrilinear_updateGradInput(gradOutput, gradInput, 2, 2, d, h, w, od, oh, ow);
+  ASSERT(std::abs((gradOutput * output).sum().toDouble() - (gradInput * input).sum().toDouble()) < 1e-9);
+}
+
+static void testNearest(int scale) {
+  std::cout << "Nearest scale " << scale << std::endl;
+  auto input = CPU(kDouble).randn({2, 3, 4, 5, 7});
+  auto output = CPU(kDouble).tensor();
+  VolumetricUpSamplingNearest_updateOutput(input, output, scale);
+  auto in = input.accessor<double, 5>();
+  auto out = output.accessor<double, 5>();
+  for(int64_t c = 0; c < 3; c++) {
+    for(int64_t z = 0; z < 4 * scale; z++) {
+      for(int64_t y = 0; y < 5 * scale; y++) {
+        for(int64_t x = 0; x < 7 * scale; x++) {
+          ASSERT(out[1][c][z][y][x] == in[1][c][z / scale][y / scale][x / scale]);
+        }
+      }
+    }
+  }
+  auto gradOutput = CPU(kDouble).randn(output.sizes());
+  auto gradInput = CPU(kDouble).tensor();
+  VolumetricUpSamplingNearest_updateGradInput(input, gradOutput, gradInput, scale);
+  ASSERT(std::abs((gradOutput * output).sum().toDouble() - (gradInput * input).sum().toDouble()) < 1e-9);
+
+  auto plane = input.select(2, 1);
+  SpatialUpSamplingNearest_updateOutput(plane, output, scale);
+  auto spatialOut = output.accessor<double, 4>();
+  auto p = plane.accessor<double, 4>();
+  for(int64_t y = 0; y < 5 * scale; y++) {
+    for(int64_t x = 0; x < 7 * scale; x++) {
+      ASSERT(spatialOut[0][2][y][x] == p[0][2][y / scale][x / scale]);
+    }
+  }
+  gradOutput = CPU(kDouble).randn(output.sizes());
+  SpatialUpSamplingNearest_updateGradInput(plane, gradOutput, gradInput, scale);
+  ASSERT(std::abs((gradOutput * output).sum().toDouble() - (gradInput * plane).sum().toDouble()) < 1e-9);
+}
+
+int main() {
+  testBilinear(5, 7, 9, 13);
+  testBilinear(5, 7, 5, 7);
+  testBilinear(4, 6, 1, 17);
+  testBilinear(8, 8, 5, 3);
+  testTrilinear(3, 4, 5, 5, 7, 9);
+  testTrilinear(3, 4, 5, 3, 4, 5);
+  testTrilinear(2, 3, 4, 1, 6, 8);
+  testNearest(2);
+  testNearest(3);
+
+  auto input = CPU(kFloat).randn({16, 64, 56, 56});
+  auto output = CPU(kFloat).tensor();
+  std::cout << "  SpatialUpSamplingBilinear 16x64x56x56 -> 112x112: "
+            << timeit(3, [&] { SpatialUpSamplingBilinear_updateOutput(input, output, 112, 112); })
+            << " us, nearest x2: "
+            << timeit(3, [&] { SpatialUpSamplingNearest_updateOutput(input, output, 2); })
+            << " us" << std::endl;
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include "ATen/ATen.h"
+
+#include <iostream>
+#include "test_assert.h"
+#include "test_timer.h"
+
+using namespace at;
+
+// Checks the column-based volumetric convolutions against a direct loop, and
+// the modules sharing the column engine against each other: the dilated and
+// plain convolutions against the MM one, and the full convolution against
+// the gradient of the MM one.
+
+static int64_t outputSize(int64_t in, int k, int d, int pad) {
+  return (in + 2 * pad - k) / d + 1;
+}
+
+static void testConvolution(int64_t batch, int64_t t, int64_t h, int64_t w, int k, int d, int pad) {
+  std::cout << "Volumetric convolution batch " << batch << " " << t << "x" << h << "x" << w
+            << " k " << k << " d " << d << " pad " << pad << std::endl;
+  const int64_t nIn = 3, nOut = 4;
+  auto input = CPU(kDouble).randn({batch, nIn, t, h, w});
+  auto weight = CPU(kDouble).randn({nOut, nIn, k, k, k});
+  auto bias = CPU(kDouble).randn({nOut});
+  int64_t ot = outputSize(t, k, d, pad), oh = outputSize(h, k, d, pad), ow = outputSize(w, k, d, pad);
+  auto gradOutput = CPU(kDouble).randn({batch, nOut, ot, oh, ow});
+
+  auto output_ref = CPU(kDouble).zeros({batch, nOut, ot, oh, ow});
+  auto gradInput_ref = CPU(kDouble).zeros({batch, nIn, t, h, w});
+  auto gradWeight_ref = CPU(kDouble).zeros({nOut, nIn, k, k, k});
+  auto in = input.accessor<double, 5>();
+  auto wt = weight.accessor<double, 5>();
+  auto go = gradOutput.accessor<double, 5>();
+  auto o = output_ref.accessor<double, 5>();
+  auto gi = gradInput_ref.accessor<double, 5>();
+  auto gw = gradWeight_ref.accessor<double, 5>();
+  for(int64_t b = 0; b < batch; b++) {
+    for(int64_t p = 0; p < nOut; p++) {
+      for(int64_t z = 0; z < ot; z++) {
+        for(int64_t y = 0; y < oh; y++) {
+          for(int64_t x = 0; x < ow; x++) {
+            double sum = bias.accessor<double, 1>()[p];
+            for(int64_t c = 0; c < nIn; c++) {
+              for(int kz = 0; kz < k; kz++) {
+                for(int ky = 0; ky < k; ky++) {
+                  for(int kx = 0; kx < k; kx++) {
+                    int64_t iz = z * d - pad + kz, iy = y * d - pad + ky, ix = x * d - pad + kx;
+                    if(iz < 0 || iz >= t || iy < 0 || iy >= h || ix < 0 || ix >= w) continue;
+                    sum += wt[p][c][kz][ky][kx] * in[b][c][iz][iy][ix];
+                    gi[b][c][iz][iy][ix] += wt[p][c][kz][ky][kx] * go[b][p][z][y][x];
+                    gw[p][c][kz][ky][kx] += in[b][c][iz][iy][ix] * go[b][p][z][y][x];
+                  }
+                }
+              }
+            }
+            o[b][p][z][y][x] = sum;
+          }
+        }
+      }
+    }
+  }
+
+  auto output = CPU(kDouble).tensor();
+  auto finput = CPU(kDouble).tensor();
+  auto fgradInput = CPU(kDouble).tensor();
+  VolumetricConvolutionMM_updateOutput(input, output, weight, bias, finput, k, k, k, d, d, d, pad, pad, pad);
+  ASSERT((output - output_ref).abs().max().toDouble() < 1e-10);
+  auto gradInput = CPU(kDouble).tensor();
+  VolumetricConvolutionMM_updateGradInput(input, gradOutput, gradInput, weight, finput, fgradInput,
+                                          k, k, k, d, d, d, pad, pad, pad);
+  ASSERT((gradInput - gradInput_ref).abs().max().toDouble() < 1e-10);
+  auto gradWeight = CPU(kDouble).zeros({nOut, nIn, k, k, k});
+  auto gradBias = CPU(kDouble).zeros({nOut});
+  VolumetricConvolutionMM_accGradParameters(input, gradOutput, gradWeight, gradBias, finput,
+                                            k, k, k, d, d, d, pad, pad, pad, 0.5);
+  ASSERT((gradWeight - gradWeight_ref * 0.5).abs().max().toDouble() < 1e-10);
+  auto gradBias_ref = gradOutput.sum(4).sum(3).sum(2).sum(0) * 0.5;
+  ASSERT((gradBias - gradBias_ref).abs().max().toDouble() < 1e-10);
+
+  auto dilated = CPU(kDouble).tensor();
+  VolumetricDilatedConvolution_updateOutput(input, dilated, weight, bias, finput, fgradInput,
+                                            k, k, k, d, d, d, pad, pad, pad, 1, 1, 1);
+  ASSERT((dilated - output).abs().max().toDouble() < 1e-10);
+  auto plain = CPU(kDouble).tensor();
+  VolumetricConvolution_updateOutput(input, plain, weight, bias, finput, fgradInput, d, d, d, pad, pad, pad);
+  ASSERT((plain - output).abs().max().toDouble() < 1e-10);
+
+  // the full convolution is the transpose of the convolution: with the same
+  // weights its output is the convolution's gradInput
+  int adj = (t + 2 * pad - k) % d;
+  if(adj == (h + 2 * pad - k) % d && adj == (w + 2 * pad - k) % d) {
+    auto full = CPU(kDouble).tensor();
+    VolumetricFullConvolution_updateOutput(gradOutput, full, weight, finput, fgradInput,
+                                           d, d, d, pad, pad, pad, adj, adj, adj);
+    ASSERT((full - gradInput_ref).abs().max().toDouble() < 1e-10);
+  }
+}
+
+int main() {
+  testConvolution(2, 5, 6, 7, 3, 1, 1);
+  testConvolution(1, 9, 8, 8, 3, 2, 1);
+  testConvolution(5, 4, 5, 6, 2, 1, 0);
+  testConvolution(3, 7, 7, 7, 3, 2, 0);
+
+  auto input = CPU(kFloat).randn({8, 16, 16, 32, 32});
+  auto weight = CPU(kFloat).randn({32, 16, 3, 3, 3});
+  auto bias = CPU(kFloat).randn({32});
+  auto output = CPU(kFloat).tensor();
+  auto finput = CPU(kFloat).tensor();
+  std::cout << "  VolumetricConvolutionMM 3x3x3 8x16x16x32x32 -> 32: "
+            << timeit(3, [&] { VolumetricConvolutionMM_updateOutput(input, output, weight, bias, finput, 3, 3, 3, 1, 1, 1, 1, 1, 1); })
+            << " us" << std::endl;
+  return 0;
+}
@@ -24,8 +24,11 @@ void BatchDataset::getField(uint64_t idx, std::string& fieldkey, at::Tensor& fie
    assert(idx < size());
    assert(hasField(fieldkey));
 
+   // empty the batch; its storage is kept for the samples:
+   field.resize_({0});
+
    // loop over samples:
-   Tensor singlefield, buffer;
+   Tensor singlefield = field.type().tensor();
    uint64_t maxsize = std::min(batchsize_, size_ - idx * batchsize_);
    for(int n = 0; n < maxsize; n++) {
 
@@ -33,23 +36,8 @@ void BatchDataset::getField(uint64_t idx, std::string& fieldkey, at::Tensor& fie
       uint64_t batchidx = idx * batchsize_ + n;
       dataset_->getField(batchidx, fieldkey, singlefield);
 
-      // allocate memory for batch:
-      if(n == 0) {
-
-         // determine size of batch:
-         std::vector<int64_t> fieldsize;
-         fieldsize.push_back(maxsize);
-         for(uint64_t d = 0; d < singlefield.dim(); ++d) {
-            fieldsize.push_back(singlefield.size(d));
-         }
-
-         // resize buffer:
-         field.resize_(fieldsize);
-      }
-
-      // copy sample into batch:
-      buffer = select(field, 0, n);
-      buffer.copy_(singlefield);
+      // append sample to batch:
+      field.append_(singlefield.toType(field.type()).unsqueeze(0));
    }
 }
 
@@ -0,0 +1,186 @@
+#include "SharedBatchRing.h"
+#include "ATen/ATen.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+using namespace at;
+
+// the control block lives in shared memory: its atomics have to work
+// across processes, which lock-free ones do
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+              "SharedBatchRing needs lock-free atomics");
+
+static const uint64_t ringMagic = 0x676e6952686374ULL;
+
+// a slot is Free, or Writing or Reading for the one who took it, or Ready
+enum SlotState : int32_t { Free, Writing, Ready, Reading };
+
+struct SharedBatchRing::Control {
+   std::atomic<uint64_t> magic;  // ringMagic once the rest is set
+   int32_t nslots;
+   int32_t nfields;
+   struct {
+      char name[32];
+      int32_t type;
+      int32_t ndim;
+      int64_t sizes[maxDims];
+   } fields[maxFields];
+   alignas(64) std::atomic<int64_t> written;  // number of the next batch to write
+   alignas(64) std::atomic<int64_t> read;     // number of the next batch to read
+   alignas(64) std::atomic<int32_t> closed;
+   struct alignas(64) {
+      std::atomic<int32_t> state;
+      std::atomic<int64_t> sequence;
+   } slots[maxSlots];
+};
+
+// spins for a while, then sleeps a little at a time
+static void backoff(int& spins) {
+   if(spins++ < 1000)
+      std::this_thread::yield();
+   else
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+SharedBatchRing::SharedBatchRing(const std::vector<Field>& fields, int nslots, std::string name) {
+   if(nslots < 1 || nslots > maxSlots)
+      throw std::runtime_error("SharedBatchRing: between 1 and " + std::to_string(maxSlots) + " slots");
+   if(fields.size() > maxFields)
+      throw std::runtime_error("SharedBatchRing: at most " + std::to_string(maxFields) + " fields");
+   if(name.empty()) {
+      static std::atomic<int> rings(0);
+      name = "/xtdata-ring-" + std::to_string(getpid()) + "-" + std::to_string(rings++);
+   }
+   name_ = name;
+
+   controlStorage_ = CPU(kByte).storageFromSharedMemory(name_.c_str(), sizeof(Control), kMapExclusive);
+   control_ = static_cast<Control*>(controlStorage_->data());
+   control_->nslots = nslots;
+   control_->nfields = fields.size();
+   for(size_t i = 0; i < fields.size(); i++) {
+      auto& spec = control_->fields[i];
+      if(fields[i].name.size() >= sizeof(spec.name))
+         throw std::runtime_error("SharedBatchRing: field name too long: " + fields[i].name);
+      if(fields[i].sizes.size() > maxDims)
+         throw std::runtime_error("SharedBatchRing: too many dimensions for " + fields[i].name);
+      strcpy(spec.name, fields[i].name.c_str());
+      spec.type = static_cast<int32_t>(fields[i].type);
+      spec.ndim = fields[i].sizes.size();
+      for(size_t d = 0; d < fields[i].sizes.size(); d++)
+         spec.sizes[d] = fields[i].sizes[d];
+   }
+   control_->written.store(0);
+   control_->read.store(0);
+   control_->closed.store(0);
+   for(int slot = 0; slot < nslots; slot++) {
+      control_->slots[slot].state.store(Free);
+      control_->slots[slot].sequence.store(-1);
+   }
+   openFields(kMapExclusive);
+   // the others may open it from now on
+   control_->magic.store(ringMagic, std::memory_order_release);
+}
+
+SharedBatchRing::SharedBatchRing(const std::string& name) {
+   name_ = name;
+   controlStorage_ = CPU(kByte).storageFromSharedMemory(name_.c_str(), sizeof(Control), kMapNoCreate);
+   control_ = static_cast<Control*>(controlStorage_->data());
+   if(control_->magic.load(std::memory_order_acquire) != ringMagic)
+      throw std::runtime_error("SharedBatchRing: " + name + " is not a ring");
+   openFields(kMapNoCreate);
+}
+
+SharedBatchRing::~SharedBatchRing() {
+}
+
+void SharedBatchRing::openFields(int flags) {
+   for(int i = 0; i < control_->nfields; i++) {
+      auto& spec = control_->fields[i];
+      std::vector<int64_t> sizes(1, control_->nslots);
+      sizes.insert(sizes.end(), spec.sizes, spec.sizes + spec.ndim);
+      int64_t size = 1;
+      for(auto s : sizes)
+         size *= s;
+      auto& type = CPU(static_cast<ScalarType>(spec.type));
+      auto fieldName = name_ + "." + std::to_string(i);
+      storages_.push_back(type.storageFromSharedMemory(fieldName.c_str(), size, flags));
+      fields_.push_back(type.tensor(*storages_.back(), 0, sizes));
+   }
+}
+
+const std::string& SharedBatchRing::name() {
+   return name_;
+}
+
+int SharedBatchRing::slots() {
+   return control_->nslots;
+}
+
+int SharedBatchRing::tryBeginWrite(int64_t& sequence) {
+   if(closed())
+      return -1;
+   for(int slot = 0; slot < control_->nslots; slot++) {
+      int32_t state = Free;
+      if(control_->slots[slot].state.compare_exchange_strong(state, Writing, std::memory_order_acquire)) {
+         // numbered once it has a slot, so the next batch to read always has one
+         sequence = control_->written.fetch_add(1);
+         control_->slots[slot].sequence.store(sequence, std::memory_order_relaxed);
+         return slot;
+      }
+   }
+   return -1;
+}
+
+int SharedBatchRing::beginWrite(int64_t& sequence) {
+   int slot;
+   for(int spins = 0; (slot = tryBeginWrite(sequence)) < 0 && !closed(); backoff(spins))
+      ;
+   return slot;
+}
+
+void SharedBatchRing::endWrite(int slot) {
+   assert(slot >= 0 && slot < control_->nslots);
+   assert(control_->slots[slot].state.load() == Writing);
+   control_->slots[slot].state.store(Ready, std::memory_order_release);
+}
+
+int SharedBatchRing::beginRead() {
+   int64_t sequence = control_->read.fetch_add(1);
+   for(int spins = 0; ; backoff(spins)) {
+      for(int slot = 0; slot < control_->nslots; slot++) {
+         auto& s = control_->slots[slot];
+         // the batch stays in its slot until its reader, us, takes it
+         int32_t state = Ready;
+         if(s.sequence.load(std::memory_order_relaxed) == sequence &&
+            s.state.compare_exchange_strong(state, Reading, std::memory_order_acquire))
+            return slot;
+      }
+      if(closed())
+         return -1;
+   }
+}
+
+void SharedBatchRing::endRead(int slot) {
+   assert(slot >= 0 && slot < control_->nslots);
+   assert(control_->slots[slot].state.load() == Reading);
+   control_->slots[slot].state.store(Free, std::memory_order_release);
+}
+
+void SharedBatchRing::batch(int slot, Fields& fields) {
+   assert(slot >= 0 && slot < control_->nslots);
+   for(int i = 0; i < control_->nfields; i++)
+      fields[control_->fields[i].name] = fields_[i].select(0, slot);
+}
+
+void SharedBatchRing::close() {
+   control_->closed.store(1);
+}
+
+bool SharedBatchRing::closed() {
+   return control_->closed.load() != 0;
+}
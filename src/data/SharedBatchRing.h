@@ -0,0 +1,101 @@
+#ifndef AT_SHARED_BATCH_RING_H
+#define AT_SHARED_BATCH_RING_H
+
+#include "Dataset.h"
+#include "ATen/ATen.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// A ring of preallocated batches in shared memory, for batches made in
+// other processes: workers fill free slots in place, and the trainer reads
+// them, in the order they were numbered, without copying. Slots change
+// hands with atomics in the shared control block; nobody takes a lock.
+//
+//    SharedBatchRing ring({{"input", kFloat, {64, 3, 224, 224}},
+//                          {"target", kLong, {64}}}, 8);
+//    if(fork() == 0) {                      // a worker
+//       {
+//          SharedBatchRing worker(ring.name());
+//          int64_t sequence;
+//          int slot;
+//          while((slot = worker.beginWrite(sequence)) >= 0) {
+//             Fields batch;
+//             worker.batch(slot, batch);    // fill batch number sequence
+//             worker.endWrite(slot);
+//          }
+//       }                                   // destroys worker
+//       _exit(0);
+//    }
+//    for(...) {                             // the trainer
+//       int slot = ring.beginRead();        // batches 0, 1, 2, ...
+//       Fields batch;
+//       ring.batch(slot, batch);
+//       ...
+//       ring.endRead(slot);
+//    }
+//    ring.close();
+//
+// The shared memory objects are removed when the last process using the
+// ring has destroyed it. A forked process should not destroy the rings of
+// its parent: it opens the ring by name, and leaves with _exit. _exit runs
+// no destructors, so the worker has to destroy the ring it opened before,
+// by closing its scope as above: otherwise the objects in /dev/shm are
+// never removed. A worker which dies in the middle of a batch leaves its
+// slot taken.
+
+class SharedBatchRing
+{
+public:
+   struct Field {
+      std::string name;
+      at::ScalarType type;
+      std::vector<int64_t> sizes;
+   };
+
+   static const int maxSlots = 64;
+   static const int maxFields = 8;
+   static const int maxDims = 6;
+
+   // creates a ring of nslots batches of fields; the name is made up when
+   // empty
+   SharedBatchRing(const std::vector<Field>& fields, int nslots, std::string name = "");
+   // opens the ring of another process
+   explicit SharedBatchRing(const std::string& name);
+   SharedBatchRing(const SharedBatchRing&) = delete;
+   SharedBatchRing& operator=(const SharedBatchRing&) = delete;
+   ~SharedBatchRing();
+
+   const std::string& name();
+   int slots();
+
+   // writers: wait for a free slot, and number the batch to go there;
+   // returns -1 once the ring is closed
+   int beginWrite(int64_t& sequence);
+   int tryBeginWrite(int64_t& sequence);
+   void endWrite(int slot);
+
+   // readers: wait for the next batch, in order; returns -1 once the ring
+   // is closed, unless the batch is there
+   int beginRead();
+   void endRead(int slot);
+
+   // the tensors of the slot, views of the shared memory
+   void batch(int slot, Fields& fields);
+
+   // stops the writers and readers which wait
+   void close();
+   bool closed();
+
+private:
+   struct Control;
+   void openFields(int flags);
+
+   std::string name_;
+   std::unique_ptr<at::Storage> controlStorage_;
+   Control* control_;
+   std::vector<std::unique_ptr<at::Storage>> storages_;
+   std::vector<at::Tensor> fields_;
+};
+
+#endif
@@ -11,42 +11,25 @@ APMeter::APMeter() {
 void APMeter::reset() {
    outputs_ = CPU(kFloat).tensor();
    targets_ = CPU(kFloat).tensor();
-   n_ = 0;
 }
 
 void APMeter::add(Tensor& output, Tensor& target) {
 
-   // assertions and allocations:
+   // assertions:
    assert(output.dim() == 2 && target.dim() == 2);
    //assert(isSameSizeAs(output, target));
-   assert(output.size(1) == outputs_.size(1));
+   assert(numel(outputs_) == 0 || output.size(1) == outputs_.size(1));
 
-   // get current outputs and targets:
-   Tensor curoutputs = getOutputs();
-   Tensor curtargets = getTargets();
-
-   // make sure underlying storages are sufficiently large:
-   if(numel(outputs_) < numel(curoutputs) + numel(output)) {
-      long long newsize = ceil(numel(outputs_) * 1.5);
-      outputs_.resize_({newsize + numel(output)});
-      targets_.resize_({newsize + numel(output)});
-   }
-   n_ += output.size(0);
-
-   // store scores and targets:
-   uint64_t offset = (numel(curoutputs) > 0) ? curoutputs.size(0) : 0;
-   Tensor outputbuffer = outputs_.narrow( 0, offset, output.size(0));
-   Tensor targetbuffer = targets_.narrow( 0, offset, target.size(0));
-
-   outputbuffer.copy_(output);
-   targetbuffer.copy_(target);
+   // store scores and targets (append_ grows the storages geometrically):
+   outputs_.append_(output.toType(outputs_.type()));
+   targets_.append_(target.toType(targets_.type()));
 }
 
 Tensor APMeter::getOutputs() {
-   return outputs_.narrow(0, 0, n_);
+   return outputs_;
 }
 Tensor APMeter::getTargets() {
-   return targets_.narrow(0, 0, n_);
+   return targets_;
 }
 
 void APMeter::value(Tensor& val) {
@@ -60,29 +43,29 @@ void APMeter::value(Tensor& val) {
    double * val_d = val.data<double>();
    Tensor outputbuffer, targetbuffer, sortval, sortidx, sorttgt;
    Tensor truepos, precision;
-   Tensor range = val.type().range(0,curoutputs.size(0));
+   Tensor range = val.type().range(1,curoutputs.size(0));
 
    // loop over all classes:
    for(uint64_t k = 0; k < curoutputs.size(1); ++k) {
 
       // sort scores:
-      outputbuffer = curoutputs.narrow( 1, k, 1);
-      targetbuffer = curtargets.narrow(1, k, 1).contiguous().toType(CPU(kDouble));
-      double * targetbuffer_d = targetbuffer.data<double>();
-      std::tie(sortval, sortidx) = sort(curoutputs, 0);
+      outputbuffer = curoutputs.select(1, k);
+      targetbuffer = curtargets.select(1, k).contiguous().toType(CPU(kDouble));
+      std::tie(sortval, sortidx) = sort(outputbuffer, 0, true);
       sorttgt = index_select(targetbuffer, 0, sortidx);
+      double * sorttgt_d = sorttgt.data<double>();
 
       // compue true positive sums, and precision:
-      truepos = cumsum(targetbuffer,0);  // NOTE: Cast to double first?
+      truepos = cumsum(sorttgt,0);
       precision = div(truepos, range);
       double * precision_d = precision.data<double>();
       // compute average precision:
       val_d[k] = .0;
       for(uint64_t n = 0; n < precision.size(0); ++n) {
-         if(targetbuffer_d[n] != 0.)
+         if(sorttgt_d[n] != 0.)
             val_d[k] += precision_d[n];
       }
-      auto norm = sum(targetbuffer).toDouble();
+      auto norm = sum(sorttgt).toDouble();
       if(norm > 0)
         val_d[k] /= norm;
    }
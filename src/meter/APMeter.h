@@ -16,7 +16,6 @@ public:
 private:
    Tensor outputs_;
    Tensor targets_;
-   uint64_t n_;
 };
 
 #endif
@@ -18,7 +18,8 @@ int main()
    std::cout << output;
    std::cout << target;
    meter.add(output, target);
-   Tensor val;
+   meter.add(output, target);
+   Tensor val = CPU(kDouble).tensor();
    meter.value(val);
    std::cout << "value: " << val << std::endl;
    return 0;